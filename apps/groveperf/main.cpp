@@ -0,0 +1,693 @@
+/**
+ * groveperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+#include <grove/clustering/ExampleClustererFactory.h>
+#include <grove/features/FeatureCalculatorFactory.h>
+#include <grove/forests/DecisionForestFactory.h>
+#include <grove/ransac/PreemptiveRansacFactory.h>
+#include <grove/relocalisation/ScoreRelocaliserFactory.h>
+#include <grove/relocalisation/interface/ScoreForestRelocaliser.h>
+#include <grove/reservoirs/ExampleReservoirsFactory.h>
+using namespace grove;
+
+#include <orx/base/MemoryBlockFactory.h>
+#include <orx/geometry/GeometryUtil.h>
+using namespace orx;
+
+#include <tvgutil/misc/SettingsContainer.h>
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+#include <tvgutil/timing/AverageTimer.h>
+using namespace tvgutil;
+
+namespace po = boost::program_options;
+
+//#################### TYPEDEFS ####################
+
+typedef ScoreForestRelocaliser::ScoreForest ScoreForest;
+typedef ScoreForestRelocaliser::ScoreForest_Ptr ScoreForest_Ptr;
+typedef PreemptiveRansac::AverageTimer Timer;
+
+//#################### TYPES ####################
+
+struct Arguments
+{
+  std::string deviceTypeName;
+  size_t frameCount;
+  std::vector<std::string> imageSizes;
+  size_t outlierModeCount;
+  std::string outputFilename;
+  uint32_t reservoirCapacity;
+  std::vector<int> threadCounts;
+  uint32_t treeDepth;
+};
+
+/**
+ * \brief An axis-aligned box in the synthetic scene.
+ */
+struct Box
+{
+  Vector3f mins;
+  Vector3f maxs;
+};
+
+/**
+ * \brief The results of benchmarking the relocalisation pipeline for a single image size and thread count.
+ */
+struct Results
+{
+  /** The size of the images used. */
+  Vector2i imageSize;
+
+  /** The fraction of the test frames for which the relocaliser (end to end) found a pose within 5cm/5deg of the ground truth. */
+  double relocalisationSuccessRate;
+
+  /** The timers for the phases of preemptive RANSAC (see PreemptiveRansac::get_timers). */
+  std::vector<Timer> ransacTimers;
+
+  /** The fraction of the test frames for which preemptive RANSAC (in isolation) found a pose within 5cm/5deg of the ground truth. */
+  double ransacSuccessRate;
+
+  /** The timers for the other individual stages and for the relocaliser as a whole. */
+  std::vector<Timer> timers;
+
+  /** The number of threads used. */
+  int threadCount;
+};
+
+/**
+ * \brief A synthetic RGB-D frame, together with the ground truth pose from which it was rendered.
+ */
+struct SyntheticFrame
+{
+  ORUChar4Image_Ptr colourImage;
+  ORFloatImage_Ptr depthImage;
+  Vector4f intrinsics;
+  ORUtils::SE3Pose pose;
+};
+
+//#################### CONSTANTS ####################
+
+/** The namespace in which to look up the relocaliser's settings. */
+const std::string RELOCALISER_NAMESPACE = "ScoreRelocaliser.";
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Makes the synthetic scene, namely a room (whose interior is the first box) containing a few pieces of "furniture" (the other boxes).
+ *
+ * \note  The y axis of the scene points downwards, as for the camera, so the floor of the room is at y = 1.25.
+ */
+std::vector<Box> make_scene()
+{
+  const float boxes[][6] = {
+    { -2.0f, -1.25f, -2.0f,  2.0f, 1.25f,  2.0f },  // the room
+    { -1.6f,  0.45f, -1.6f, -0.6f, 1.25f, -0.9f },  // a table
+    {  1.3f, -1.25f,  1.3f,  1.7f, 1.25f,  1.7f },  // a pillar
+    {  0.9f,  0.25f, -1.9f,  1.9f, 1.25f, -1.4f },  // a cabinet
+    { -1.9f,  0.85f,  0.8f, -1.2f, 1.25f,  1.5f }   // a crate
+  };
+
+  std::vector<Box> scene;
+  for(size_t i = 0; i < sizeof(boxes) / sizeof(boxes[0]); ++i)
+  {
+    Box box;
+    box.mins = Vector3f(boxes[i][0], boxes[i][1], boxes[i][2]);
+    box.maxs = Vector3f(boxes[i][3], boxes[i][4], boxes[i][5]);
+    scene.push_back(box);
+  }
+
+  return scene;
+}
+
+/**
+ * \brief Casts a ray into the synthetic scene.
+ *
+ * \param scene   The scene.
+ * \param origin  The origin of the ray (which must be inside the room).
+ * \param dir     The direction of the ray (which need not be normalised).
+ * \return        The parameter t such that origin + t * dir is the first point along the ray at which it hits the scene.
+ */
+float raycast_scene(const std::vector<Box>& scene, const Vector3f& origin, const Vector3f& dir)
+{
+  // Find the point at which the ray leaves the room.
+  const Box& room = scene[0];
+  float t = FLT_MAX;
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    if(dir[axis] > 0.0f) t = std::min(t, (room.maxs[axis] - origin[axis]) / dir[axis]);
+    else if(dir[axis] < 0.0f) t = std::min(t, (room.mins[axis] - origin[axis]) / dir[axis]);
+  }
+
+  // Check whether the ray hits any of the other boxes before that, using the slab method.
+  for(size_t i = 1, size = scene.size(); i < size; ++i)
+  {
+    const Box& box = scene[i];
+    float tNear = -FLT_MAX, tFar = FLT_MAX;
+    for(int axis = 0; axis < 3 && tNear <= tFar; ++axis)
+    {
+      if(dir[axis] == 0.0f)
+      {
+        if(origin[axis] < box.mins[axis] || origin[axis] > box.maxs[axis]) tNear = FLT_MAX;
+        continue;
+      }
+
+      float t1 = (box.mins[axis] - origin[axis]) / dir[axis], t2 = (box.maxs[axis] - origin[axis]) / dir[axis];
+      if(t1 > t2) std::swap(t1, t2);
+      tNear = std::max(tNear, t1);
+      tFar = std::min(tFar, t2);
+    }
+
+    if(tNear <= tFar && tNear > 0.0f && tNear < t) t = tNear;
+  }
+
+  return t;
+}
+
+/**
+ * \brief Renders a synthetic RGB-D frame of the specified scene from the specified camera-to-world pose.
+ *
+ * The surfaces of the scene are textured with cells of pseudo-random colours, so that the features computed for
+ * different parts of the scene are distinctive.
+ *
+ * \param scene         The scene.
+ * \param cameraToWorld The camera-to-world transformation.
+ * \param imageSize     The size of the frame to render.
+ * \return              The frame.
+ */
+SyntheticFrame render_frame(const std::vector<Box>& scene, const Matrix4f& cameraToWorld, const Vector2i& imageSize)
+{
+  const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+
+  SyntheticFrame frame;
+  frame.colourImage = mbf.make_image<Vector4u>(imageSize, "synthetic data");
+  frame.depthImage = mbf.make_image<float>(imageSize, "synthetic data");
+  frame.pose.SetInvM(cameraToWorld);
+
+  // Use the intrinsics of a Kinect, scaled to the size of the frame.
+  const float f = 585.0f * imageSize.x / 640.0f;
+  frame.intrinsics = Vector4f(f, f, imageSize.x / 2.0f, imageSize.y / 2.0f);
+
+  const Vector3f origin(cameraToWorld.m[12], cameraToWorld.m[13], cameraToWorld.m[14]);
+  Vector4u *colourData = frame.colourImage->GetData(MEMORYDEVICE_CPU);
+  float *depthData = frame.depthImage->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int y = 0; y < imageSize.y; ++y)
+  {
+    for(int x = 0; x < imageSize.x; ++x)
+    {
+      // Since the z component of the ray in camera space is 1, the distance along the ray is also the depth.
+      const Vector4f rayCamera((x - frame.intrinsics.z) / f, (y - frame.intrinsics.w) / f, 1.0f, 0.0f);
+      const Vector4f rayWorld = cameraToWorld * rayCamera;
+      const Vector3f dir(rayWorld.x, rayWorld.y, rayWorld.z);
+      const float t = raycast_scene(scene, origin, dir);
+
+      // Look up the colour of the 12.5cm cell containing the hit point (backing off slightly so that points that
+      // lie exactly on a face are consistently assigned to the cell in front of it).
+      const Vector3f p = origin + dir * (t - 1e-3f);
+      const unsigned int h = static_cast<unsigned int>(static_cast<int>(floorf(p.x * 8.0f))) * 73856093u
+                           ^ static_cast<unsigned int>(static_cast<int>(floorf(p.y * 8.0f))) * 19349663u
+                           ^ static_cast<unsigned int>(static_cast<int>(floorf(p.z * 8.0f))) * 83492791u;
+
+      const int offset = y * imageSize.x + x;
+      colourData[offset] = Vector4u(h & 0xFF, (h >> 8) & 0xFF, (h >> 16) & 0xFF, 255);
+      depthData[offset] = t;
+    }
+  }
+
+  frame.colourImage->UpdateDeviceFromHost();
+  frame.depthImage->UpdateDeviceFromHost();
+  return frame;
+}
+
+/**
+ * \brief Makes the camera-to-world transformation for a camera at the specified angle around a looping trajectory through the room.
+ *
+ * \param theta The angle (in radians).
+ * \return      The camera-to-world transformation.
+ */
+Matrix4f make_trajectory_pose(float theta)
+{
+  const Vector3f position(0.8f * cosf(theta), 0.2f * sinf(3.0f * theta), 0.8f * sinf(theta));
+  const float yaw = theta + static_cast<float>(M_PI) / 2.0f + 0.4f * sinf(2.0f * theta);
+  const float pitch = 0.15f * sinf(5.0f * theta);
+
+  // Construct the camera's axes (x right, y down, z forward), using the scene's down direction to fix its roll.
+  const Vector3f forward(cosf(yaw) * cosf(pitch), sinf(pitch), sinf(yaw) * cosf(pitch));
+  const Vector3f right = normalize(cross(Vector3f(0.0f, 1.0f, 0.0f), forward));
+  const Vector3f down = cross(forward, right);
+
+  Matrix4f cameraToWorld;
+  cameraToWorld.setIdentity();
+  for(int i = 0; i < 3; ++i)
+  {
+    cameraToWorld.m[i] = right[i];
+    cameraToWorld.m[4 + i] = down[i];
+    cameraToWorld.m[8 + i] = forward[i];
+    cameraToWorld.m[12 + i] = position[i];
+  }
+
+  return cameraToWorld;
+}
+
+/**
+ * \brief Renders the synthetic training and test frames for the specified image size.
+ *
+ * The frames are rendered from evenly-spaced poses around a looping trajectory, with the test frames lying in between the training frames.
+ *
+ * \param scene           The scene.
+ * \param imageSize       The size of the frames.
+ * \param frameCount      The number of training (and test) frames to render.
+ * \param trainingFrames  A vector into which to write the training frames.
+ * \param testFrames      A vector into which to write the test frames.
+ */
+void make_frames(const std::vector<Box>& scene, const Vector2i& imageSize, size_t frameCount,
+                 std::vector<SyntheticFrame>& trainingFrames, std::vector<SyntheticFrame>& testFrames)
+{
+  trainingFrames.clear();
+  testFrames.clear();
+
+  for(size_t i = 0; i < 2 * frameCount; ++i)
+  {
+    const float theta = static_cast<float>(M_PI * i / frameCount);
+    SyntheticFrame frame = render_frame(scene, make_trajectory_pose(theta), imageSize);
+    (i % 2 == 0 ? trainingFrames : testFrames).push_back(frame);
+  }
+}
+
+/**
+ * \brief Makes a settings container that configures the relocaliser (and its components) for the benchmark.
+ */
+SettingsContainer_Ptr make_settings(const Arguments& args)
+{
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  settings->add_value("DecisionForest.treeDepth", boost::lexical_cast<std::string>(args.treeDepth));
+  settings->add_value(RELOCALISER_NAMESPACE + "randomlyGenerateForest", "true");
+  settings->add_value(RELOCALISER_NAMESPACE + "reservoirCapacity", boost::lexical_cast<std::string>(args.reservoirCapacity));
+  return settings;
+}
+
+/**
+ * \brief Makes SCoRe predictions for a set of camera-space keypoints, in which the first mode for each keypoint is at its
+ *        ground truth position in the world, and the remaining modes are outliers scattered randomly throughout the room.
+ *
+ * \param keypointsImage    The keypoints.
+ * \param cameraToWorld     The ground truth camera-to-world transformation.
+ * \param room              The room (used to bound the positions of the outlier modes).
+ * \param outlierModeCount  The number of outlier modes to add to each prediction.
+ * \param rng               The random number generator to use to generate the outlier modes.
+ * \param predictionsImage  The image into which to write the predictions.
+ */
+void make_synthetic_predictions(const Keypoint3DColourImage_CPtr& keypointsImage, const Matrix4f& cameraToWorld, const Box& room,
+                                size_t outlierModeCount, RandomNumberGenerator& rng, const ScorePredictionsImage_Ptr& predictionsImage)
+{
+  keypointsImage->UpdateHostFromDevice();
+  predictionsImage->ChangeDims(keypointsImage->noDims);
+
+  const Keypoint3DColour *keypoints = keypointsImage->GetData(MEMORYDEVICE_CPU);
+  ScorePrediction *predictions = predictionsImage->GetData(MEMORYDEVICE_CPU);
+  const int modeCount = std::min(static_cast<int>(outlierModeCount) + 1, static_cast<int>(ScorePrediction::Capacity));
+
+  for(int i = 0, pixelCount = static_cast<int>(keypointsImage->dataSize); i < pixelCount; ++i)
+  {
+    ScorePrediction& prediction = predictions[i];
+    prediction.size = keypoints[i].valid ? modeCount : 0;
+
+    for(int j = 0; j < prediction.size; ++j)
+    {
+      Keypoint3DColourCluster& mode = prediction.elts[j];
+      if(j == 0)
+      {
+        mode.colour = keypoints[i].colour;
+        mode.position = cameraToWorld * keypoints[i].position;
+      }
+      else
+      {
+        mode.colour = Vector3u(rng.generate_int_from_uniform(0, 255), rng.generate_int_from_uniform(0, 255), rng.generate_int_from_uniform(0, 255));
+        for(int axis = 0; axis < 3; ++axis) mode.position[axis] = rng.generate_real_from_uniform(room.mins[axis], room.maxs[axis]);
+      }
+
+      mode.determinant = 1.0f;
+      mode.nbInliers = 1;
+      mode.positionInvCovariance.setIdentity();
+    }
+  }
+
+  predictionsImage->UpdateDeviceFromHost();
+}
+
+/**
+ * \brief Runs the benchmark for a single image size and thread count.
+ *
+ * Each stage is first timed in isolation, using components constructed in the same way as those in a forest-based SCoRe
+ * relocaliser, and then the relocaliser as a whole is trained on the training frames and timed on the test frames.
+ *
+ * \param args            The command-line arguments.
+ * \param deviceType      The device on which to run the stages.
+ * \param forest          The forest to use for the isolated stages.
+ * \param scene           The scene from which the frames were rendered.
+ * \param trainingFrames  The training frames.
+ * \param testFrames      The test frames.
+ * \return                The results of the benchmark.
+ */
+Results run_benchmark(const Arguments& args, ORUtils::DeviceType deviceType, const ScoreForest_Ptr& forest, const std::vector<Box>& scene,
+                      const std::vector<SyntheticFrame>& trainingFrames, const std::vector<SyntheticFrame>& testFrames)
+{
+  typedef ScoreRelocaliser::Clusterer Clusterer;
+  typedef ScoreRelocaliser::Reservoirs Reservoirs;
+
+  const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  const SettingsContainer_CPtr settings = make_settings(args);
+
+  Results results;
+  results.imageSize = trainingFrames[0].colourImage->noDims;
+  results.threadCount = 1;
+#ifdef WITH_OPENMP
+  results.threadCount = omp_get_max_threads();
+#endif
+
+  Timer featuresTimer("features"), findLeavesTimer("findLeaves"), addExamplesTimer("addExamples"), clusterExamplesTimer("clusterExamples");
+  Timer trainTimer("relocaliser/train"), updateAllClustersTimer("relocaliser/updateAllClusters"), relocaliseTimer("relocaliser/relocalise");
+
+  {
+    // Make the components, in the same way as a forest-based SCoRe relocaliser would.
+    DA_RGBDPatchFeatureCalculator_CPtr featureCalculator = FeatureCalculatorFactory::make_da_rgbd_patch_feature_calculator(deviceType);
+    const uint32_t reservoirCount = forest->get_nb_leaves();
+    boost::shared_ptr<Reservoirs> reservoirs = ExampleReservoirsFactory<Keypoint3DColour>::make_reservoirs(reservoirCount, args.reservoirCapacity, deviceType);
+    boost::shared_ptr<Clusterer> clusterer = ExampleClustererFactory<Keypoint3DColour,Keypoint3DColourCluster,ScorePrediction::Capacity>::make_clusterer(
+      0.1f, 0.05f, ScorePrediction::Capacity, 20, deviceType
+    );
+    PreemptiveRansac_Ptr preemptiveRansac = PreemptiveRansacFactory::make_preemptive_ransac(settings, RELOCALISER_NAMESPACE + "PreemptiveRansac.", deviceType);
+
+    Keypoint3DColourImage_Ptr keypointsImage = mbf.make_image<Keypoint3DColour>(Vector2i(0, 0), "benchmark");
+    RGBDPatchDescriptorImage_Ptr descriptorsImage = mbf.make_image<RGBDPatchDescriptor>(Vector2i(0, 0), "benchmark");
+    ScoreForestRelocaliser::LeafIndicesImage_Ptr leafIndicesImage = mbf.make_image<ScoreForestRelocaliser::LeafIndices>(Vector2i(0, 0), "benchmark");
+    ScorePredictionsMemoryBlock_Ptr clustersBlock = mbf.make_block<ScorePrediction>(reservoirCount, "benchmark");
+    ScorePredictionsImage_Ptr predictionsImage = mbf.make_image<ScorePrediction>(Vector2i(0, 0), "benchmark");
+
+    // Run the training stages once on the first frame without timing them, so that one-off allocations are not counted.
+    const SyntheticFrame& firstFrame = trainingFrames[0];
+    featureCalculator->compute_keypoints_and_features(firstFrame.colourImage.get(), firstFrame.depthImage.get(), firstFrame.pose.GetInvM(), firstFrame.intrinsics, keypointsImage.get(), descriptorsImage.get());
+    forest->find_leaves(descriptorsImage, leafIndicesImage);
+    reservoirs->add_examples(keypointsImage, leafIndicesImage);
+    clusterer->cluster_examples(reservoirs->get_reservoirs(), reservoirs->get_reservoir_sizes(), 0, std::min(256u, reservoirCount), clustersBlock);
+    reservoirs->reset();
+
+    // Time the training stages on each training frame, clustering the next batch of reservoirs after each frame, as the relocaliser does.
+    uint32_t reservoirStartIdx = 0;
+    for(size_t i = 0, size = trainingFrames.size(); i < size; ++i)
+    {
+      const SyntheticFrame& frame = trainingFrames[i];
+
+      featuresTimer.start_sync();
+      featureCalculator->compute_keypoints_and_features(frame.colourImage.get(), frame.depthImage.get(), frame.pose.GetInvM(), frame.intrinsics, keypointsImage.get(), descriptorsImage.get());
+      featuresTimer.stop_sync();
+
+      findLeavesTimer.start_sync();
+      forest->find_leaves(descriptorsImage, leafIndicesImage);
+      findLeavesTimer.stop_sync();
+
+      addExamplesTimer.start_sync();
+      reservoirs->add_examples(keypointsImage, leafIndicesImage);
+      addExamplesTimer.stop_sync();
+
+      const uint32_t reservoirsToCluster = std::min(256u, reservoirCount - reservoirStartIdx);
+      clusterExamplesTimer.start_sync();
+      clusterer->cluster_examples(reservoirs->get_reservoirs(), reservoirs->get_reservoir_sizes(), reservoirStartIdx, reservoirsToCluster, clustersBlock);
+      clusterExamplesTimer.stop_sync();
+      reservoirStartIdx = (reservoirStartIdx + reservoirsToCluster) % reservoirCount;
+    }
+
+    // Time preemptive RANSAC on each test frame, using synthetic predictions so that its cost does not depend on the quality of the (random) forest.
+    RandomNumberGenerator rng(42);
+    size_t ransacSuccessCount = 0;
+    Matrix4f identity;
+    identity.setIdentity();
+    for(size_t i = 0, size = testFrames.size(); i < size; ++i)
+    {
+      const SyntheticFrame& frame = testFrames[i];
+      featureCalculator->compute_keypoints_and_features(frame.colourImage.get(), frame.depthImage.get(), identity, frame.intrinsics, keypointsImage.get(), descriptorsImage.get());
+      make_synthetic_predictions(keypointsImage, frame.pose.GetInvM(), scene[0], args.outlierModeCount, rng, predictionsImage);
+
+      boost::optional<PoseCandidate> candidate = preemptiveRansac->estimate_pose(keypointsImage, predictionsImage);
+      if(candidate)
+      {
+        ORUtils::SE3Pose pose;
+        pose.SetInvM(candidate->cameraPose);
+        if(GeometryUtil::poses_are_similar(pose, frame.pose, 5 * M_PI / 180, 0.05f)) ++ransacSuccessCount;
+      }
+    }
+
+    results.ransacSuccessRate = static_cast<double>(ransacSuccessCount) / testFrames.size();
+
+    results.timers.push_back(featuresTimer);
+    results.timers.push_back(findLeavesTimer);
+    results.timers.push_back(addExamplesTimer);
+    results.timers.push_back(clusterExamplesTimer);
+    results.ransacTimers = preemptiveRansac->get_timers();
+  }
+
+  // Finally, time the relocaliser as a whole. This is done once the components used for the isolated stages have
+  // been destroyed, since the relocaliser makes its own reservoirs, which can be large.
+  ScoreRelocaliser_Ptr relocaliser = ScoreRelocaliserFactory::make_score_relocaliser("forest", RELOCALISER_NAMESPACE, settings, deviceType);
+
+  for(size_t i = 0, size = trainingFrames.size(); i < size; ++i)
+  {
+    const SyntheticFrame& frame = trainingFrames[i];
+    trainTimer.start_sync();
+    relocaliser->train(frame.colourImage.get(), frame.depthImage.get(), frame.intrinsics, frame.pose);
+    trainTimer.stop_sync();
+  }
+
+  updateAllClustersTimer.start_sync();
+  relocaliser->update_all_clusters();
+  updateAllClustersTimer.stop_sync();
+
+  size_t relocalisationSuccessCount = 0;
+  for(size_t i = 0, size = testFrames.size(); i < size; ++i)
+  {
+    const SyntheticFrame& frame = testFrames[i];
+    relocaliseTimer.start_sync();
+    std::vector<Relocaliser::Result> relocalisationResults = relocaliser->relocalise(frame.colourImage.get(), frame.depthImage.get(), frame.intrinsics);
+    relocaliseTimer.stop_sync();
+
+    if(!relocalisationResults.empty() && GeometryUtil::poses_are_similar(relocalisationResults[0].pose, frame.pose, 5 * M_PI / 180, 0.05f))
+    {
+      ++relocalisationSuccessCount;
+    }
+  }
+
+  results.relocalisationSuccessRate = static_cast<double>(relocalisationSuccessCount) / testFrames.size();
+
+  results.timers.push_back(trainTimer);
+  results.timers.push_back(updateAllClustersTimer);
+  results.timers.push_back(relocaliseTimer);
+
+  return results;
+}
+
+/**
+ * \brief Parses an image size of the form WxH (e.g. 640x480).
+ *
+ * \param s The string to parse.
+ * \return  The image size.
+ *
+ * \throws std::runtime_error If the string is not a valid image size.
+ */
+Vector2i parse_image_size(const std::string& s)
+try
+{
+  const size_t i = s.find('x');
+  if(i == std::string::npos) throw std::runtime_error("");
+
+  const Vector2i imageSize(boost::lexical_cast<int>(s.substr(0, i)), boost::lexical_cast<int>(s.substr(i + 1)));
+  if(imageSize.x <= 0 || imageSize.y <= 0) throw std::runtime_error("");
+
+  return imageSize;
+}
+catch(std::exception&)
+{
+  throw std::runtime_error("Error: Invalid image size '" + s + "' (expected WxH, e.g. 640x480)");
+}
+
+void output_timer(std::ostream& os, const Timer& timer, bool last)
+{
+  os << "        { \"name\": \"" << timer.name() << "\", \"count\": " << timer.count()
+     << ", \"meanMs\": " << timer.average_duration().count() / 1000000.0
+     << ", \"totalMs\": " << timer.total_duration().count() / 1000000.0 << " }" << (last ? "\n" : ",\n");
+}
+
+/**
+ * \brief Writes the results of the benchmark runs to a stream in JSON format, so that they can be tracked for regressions.
+ */
+void output_json(std::ostream& os, const Arguments& args, const std::vector<Results>& runs)
+{
+  os << "{\n"
+     << "  \"deviceType\": \"" << args.deviceTypeName << "\",\n"
+     << "  \"frameCount\": " << args.frameCount << ",\n"
+     << "  \"outlierModeCount\": " << args.outlierModeCount << ",\n"
+     << "  \"reservoirCapacity\": " << args.reservoirCapacity << ",\n"
+     << "  \"treeDepth\": " << args.treeDepth << ",\n"
+     << "  \"runs\": [\n";
+
+  for(size_t i = 0, size = runs.size(); i < size; ++i)
+  {
+    const Results& results = runs[i];
+    os << "    {\n"
+       << "      \"imageSize\": [" << results.imageSize.x << ", " << results.imageSize.y << "],\n"
+       << "      \"threadCount\": " << results.threadCount << ",\n"
+       << "      \"ransacSuccessRate\": " << results.ransacSuccessRate << ",\n"
+       << "      \"relocalisationSuccessRate\": " << results.relocalisationSuccessRate << ",\n"
+       << "      \"stages\": [\n";
+
+    for(size_t j = 0, timerCount = results.timers.size(); j < timerCount; ++j)
+    {
+      output_timer(os, results.timers[j], j + 1 == timerCount);
+    }
+
+    os << "      ],\n"
+       << "      \"preemptiveRansac\": [\n";
+
+    for(size_t j = 0, timerCount = results.ransacTimers.size(); j < timerCount; ++j)
+    {
+      output_timer(os, results.ransacTimers[j], j + 1 == timerCount);
+    }
+
+    os << "      ]\n"
+       << "    }" << (i + 1 == size ? "\n" : ",\n");
+  }
+
+  os << "  ]\n"
+     << "}\n";
+}
+
+bool parse_command_line(int argc, char *argv[], Arguments& args)
+{
+  // Specify the possible options.
+  po::options_description options;
+  options.add_options()
+    ("help", "produce help message")
+    ("deviceType,d", po::value<std::string>(&args.deviceTypeName)->default_value("cpu"), "the device on which to run the stages (cpu|cuda)")
+    ("frameCount,n", po::value<size_t>(&args.frameCount)->default_value(20), "the number of synthetic training (and test) frames to render")
+    ("imageSize,s", po::value<std::vector<std::string> >(&args.imageSizes)->multitoken(), "the image sizes to sweep over (default: 320x240 640x480)")
+    ("outlierModeCount,m", po::value<size_t>(&args.outlierModeCount)->default_value(9), "the number of outlier modes to add to each synthetic prediction passed to preemptive RANSAC")
+    ("outputFile,o", po::value<std::string>(&args.outputFilename)->default_value("groveperf.json"), "the file to which to write the results (in JSON format)")
+    ("reservoirCapacity,r", po::value<uint32_t>(&args.reservoirCapacity)->default_value(1024), "the capacity of each example reservoir")
+    ("threads,t", po::value<std::vector<int> >(&args.threadCounts)->multitoken(), "the thread counts to sweep over (default: powers of two up to the number of cores)")
+    ("treeDepth", po::value<uint32_t>(&args.treeDepth)->default_value(12), "the depth of each tree in the randomly-generated forest")
+  ;
+
+  // Actually parse the command line.
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, options), vm);
+  po::notify(vm);
+
+  // If the user specifies the --help flag, print a help message.
+  if(vm.count("help"))
+  {
+    std::cout << options << '\n';
+    return false;
+  }
+
+  // Fill in the defaults for the sweeps if necessary.
+  if(args.imageSizes.empty())
+  {
+    args.imageSizes.push_back("320x240");
+    args.imageSizes.push_back("640x480");
+  }
+
+#ifdef WITH_OPENMP
+  if(args.threadCounts.empty())
+  {
+    const int maxThreadCount = omp_get_max_threads();
+    for(int threadCount = 1; threadCount < maxThreadCount; threadCount *= 2) args.threadCounts.push_back(threadCount);
+    args.threadCounts.push_back(maxThreadCount);
+  }
+#else
+  // Without OpenMP, the stages always run on a single thread.
+  args.threadCounts.assign(1, 1);
+#endif
+
+  if(args.frameCount == 0) throw std::runtime_error("Error: The frame count must be positive");
+
+  return true;
+}
+
+int main(int argc, char *argv[])
+try
+{
+  // Parse the command-line arguments.
+  Arguments args;
+  if(!parse_command_line(argc, argv, args))
+  {
+    return EXIT_SUCCESS;
+  }
+
+  ORUtils::DeviceType deviceType = ORUtils::DEVICE_CPU;
+  if(args.deviceTypeName == "cuda")
+  {
+#ifdef WITH_CUDA
+    deviceType = ORUtils::DEVICE_CUDA;
+#else
+    throw std::runtime_error("Error: Cannot run the stages on the GPU, since CUDA support is not available");
+#endif
+  }
+  else if(args.deviceTypeName != "cpu") throw std::runtime_error("Error: Unknown device type '" + args.deviceTypeName + "'");
+
+  MemoryBlockFactory::instance().set_device_type(deviceType);
+
+  // Make the forest that is used for the isolated stages (this is shared between all of the runs, since it never changes).
+  const std::vector<Box> scene = make_scene();
+  const ScoreForest_Ptr forest = DecisionForestFactory<RGBDPatchDescriptor,ScoreForestRelocaliser::FOREST_TREE_COUNT>::make_randomly_generated_forest(make_settings(args), deviceType);
+
+  std::vector<Results> runs;
+  for(size_t i = 0, sizeCount = args.imageSizes.size(); i < sizeCount; ++i)
+  {
+    const Vector2i imageSize = parse_image_size(args.imageSizes[i]);
+
+    std::cout << "Rendering " << args.frameCount << " training and " << args.frameCount << " test frames of size " << imageSize.x << 'x' << imageSize.y << "...\n";
+    std::vector<SyntheticFrame> trainingFrames, testFrames;
+    make_frames(scene, imageSize, args.frameCount, trainingFrames, testFrames);
+
+    for(size_t j = 0, threadCountCount = args.threadCounts.size(); j < threadCountCount; ++j)
+    {
+#ifdef WITH_OPENMP
+      omp_set_num_threads(args.threadCounts[j]);
+#endif
+
+      std::cout << "Benchmarking with " << args.threadCounts[j] << " thread(s)...\n";
+      runs.push_back(run_benchmark(args, deviceType, forest, scene, trainingFrames, testFrames));
+    }
+  }
+
+  std::ofstream fs(args.outputFilename.c_str());
+  if(!fs) throw std::runtime_error("Error: Could not open '" + args.outputFilename + "' for writing");
+  output_json(fs, args, runs);
+  std::cout << "Wrote the results to " << args.outputFilename << '\n';
+
+  return 0;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
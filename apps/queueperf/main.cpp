@@ -0,0 +1,228 @@
+/**
+ * queueperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <boost/chrono.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+
+#include <tvgutil/containers/LockFreePooledQueue.h>
+#include <tvgutil/containers/PooledQueue.h>
+using namespace tvgutil;
+
+namespace bc = boost::chrono;
+namespace po = boost::program_options;
+
+//#################### TYPEDEFS ####################
+
+typedef std::vector<unsigned char> Message;
+typedef boost::shared_ptr<Message> Message_Ptr;
+
+//#################### TYPES ####################
+
+struct Arguments
+{
+  size_t capacity;
+  size_t messageCount;
+  size_t messageSize;
+  pooled_queue::PoolEmptyStrategy poolEmptyStrategy;
+  size_t workIterations;
+};
+
+/**
+ * \brief The results of a single benchmark run.
+ */
+struct Results
+{
+  /** The number of messages that were delivered to the consumer. */
+  size_t deliveredCount;
+
+  /** The time taken by each push (from the start of begin_push to the end of end_push), in nanoseconds. */
+  std::vector<double> pushTimes;
+
+  /** The total time taken by the run, in seconds. */
+  double totalSeconds;
+};
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Simulates a small amount of per-message work (e.g. decompression) on the consumer side.
+ */
+unsigned int do_work(const Message& msg, size_t workIterations)
+{
+  unsigned int checksum = 0;
+  for(size_t i = 0; i < workIterations; ++i)
+  {
+    checksum = checksum * 31 + msg[i % msg.size()];
+  }
+  return checksum;
+}
+
+Message_Ptr make_message(size_t messageSize)
+{
+  return boost::make_shared<Message>(messageSize);
+}
+
+/**
+ * \brief Pushes the specified number of messages onto a queue, timing each push.
+ */
+template <typename Queue>
+void run_producer(Queue *queue, const Arguments *args, Results *results)
+{
+  std::vector<unsigned char> payload(args->messageSize, 0xAB);
+  results->pushTimes.reserve(args->messageCount);
+
+  for(size_t i = 0; i <= args->messageCount; ++i)
+  {
+    bc::high_resolution_clock::time_point begin = bc::high_resolution_clock::now();
+    {
+      typename Queue::PushHandler_Ptr pushHandler = queue->begin_push();
+      boost::optional<Message_Ptr&> elt = pushHandler->get();
+      if(elt)
+      {
+        // The final message is an empty sentinel that tells the consumer to stop.
+        if(i == args->messageCount) (*elt)->clear();
+        else
+        {
+          (*elt)->resize(args->messageSize);
+          memcpy(&(**elt)[0], &payload[0], args->messageSize);
+        }
+      }
+      else if(i == args->messageCount)
+      {
+        // Make sure that the sentinel is never discarded.
+        --i;
+        continue;
+      }
+    }
+    bc::high_resolution_clock::time_point end = bc::high_resolution_clock::now();
+
+    if(i < args->messageCount) results->pushTimes.push_back(static_cast<double>(bc::duration_cast<bc::nanoseconds>(end - begin).count()));
+  }
+}
+
+/**
+ * \brief Runs a single benchmark, in which a producer thread pushes messages onto a queue and the main thread consumes them.
+ */
+template <typename Queue>
+Results run_benchmark(const Arguments& args)
+{
+  Queue queue(args.poolEmptyStrategy);
+  queue.initialise(args.capacity, boost::bind(&make_message, args.messageSize));
+
+  Results results;
+  results.deliveredCount = 0;
+
+  bc::high_resolution_clock::time_point begin = bc::high_resolution_clock::now();
+  boost::thread producer(&run_producer<Queue>, &queue, &args, &results);
+
+  unsigned int checksum = 0;
+  while(true)
+  {
+    Message_Ptr msg = queue.peek();
+    const bool done = msg->empty();
+    if(!done)
+    {
+      checksum += do_work(*msg, args.workIterations);
+      ++results.deliveredCount;
+    }
+    queue.pop();
+    if(done) break;
+  }
+
+  producer.join();
+  bc::high_resolution_clock::time_point end = bc::high_resolution_clock::now();
+  results.totalSeconds = bc::duration_cast<bc::duration<double> >(end - begin).count();
+
+  // Prevent the compiler from optimising the work away.
+  if(checksum == 12345) std::cout << ' ';
+
+  return results;
+}
+
+double percentile(std::vector<double> values, double p)
+{
+  if(values.empty()) return 0.0;
+  const size_t k = std::min(static_cast<size_t>(p * values.size()), values.size() - 1);
+  std::nth_element(values.begin(), values.begin() + k, values.end());
+  return values[k];
+}
+
+void output_results(const std::string& name, const Results& results)
+{
+  std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(0)
+            << std::setw(12) << results.deliveredCount / results.totalSeconds
+            << std::setw(10) << results.deliveredCount
+            << std::setw(10) << percentile(results.pushTimes, 0.5)
+            << std::setw(10) << percentile(results.pushTimes, 0.99)
+            << std::setw(12) << percentile(results.pushTimes, 0.999)
+            << std::setw(12) << percentile(results.pushTimes, 1.0) << '\n';
+}
+
+bool parse_command_line(int argc, char *argv[], Arguments& args)
+{
+  // Specify the possible options.
+  po::options_description options;
+  options.add_options()
+    ("help", "produce help message")
+    ("capacity,c", po::value<size_t>(&args.capacity)->default_value(8), "the capacity of the queues' pools")
+    ("messageCount,n", po::value<size_t>(&args.messageCount)->default_value(1000000), "the number of messages to push")
+    ("messageSize,s", po::value<size_t>(&args.messageSize)->default_value(64), "the size of each message (in bytes)")
+    ("poolEmptyStrategy,p", po::value<pooled_queue::PoolEmptyStrategy>(&args.poolEmptyStrategy)->default_value(pooled_queue::PES_WAIT), "the pool empty strategy (discard|grow|replacerandom|wait)")
+    ("workIterations,w", po::value<size_t>(&args.workIterations)->default_value(0), "the amount of simulated work to do for each message on the consumer side")
+  ;
+
+  // Actually parse the command line.
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, options), vm);
+  po::notify(vm);
+
+  // If the user specifies the --help flag, print a help message.
+  if(vm.count("help"))
+  {
+    std::cout << options << '\n';
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char *argv[])
+try
+{
+  // Parse the command-line arguments.
+  Arguments args;
+  if(!parse_command_line(argc, argv, args))
+  {
+    return EXIT_SUCCESS;
+  }
+
+  std::cout << "Pushing " << args.messageCount << " messages of " << args.messageSize << " bytes through queues with capacity "
+            << args.capacity << " using the '" << args.poolEmptyStrategy << "' strategy\n\n";
+
+  std::cout << std::left << std::setw(22) << "Queue" << std::right
+            << std::setw(12) << "Msgs/s"
+            << std::setw(10) << "Delivered"
+            << std::setw(10) << "p50 (ns)"
+            << std::setw(10) << "p99 (ns)"
+            << std::setw(12) << "p99.9 (ns)"
+            << std::setw(12) << "Max (ns)" << '\n';
+
+  output_results("PooledQueue", run_benchmark<PooledQueue<Message_Ptr> >(args));
+  output_results("LockFreePooledQueue", run_benchmark<LockFreePooledQueue<Message_Ptr> >(args));
+
+  return 0;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
@@ -11,7 +11,9 @@
 #include <boost/assign/list_of.hpp>
 #include <boost/bind.hpp>
 #include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/timer/timer.hpp>
 using boost::assign::list_of;
 
@@ -37,11 +39,13 @@ namespace po = boost::program_options;
 
 struct Arguments
 {
+  std::string costCacheSpecifier;
   std::string datasetDir;
   bf::path dir;
   std::string iniSpecifier;
   bf::path logPath;
   std::string logSpecifier;
+  size_t maxConcurrentEvaluations;
   std::string outputSpecifier;
   bf::path scriptPath;
   std::string scriptSpecifier;
@@ -53,12 +57,30 @@ struct Arguments
   {}
 };
 
+//#################### GLOBAL VARIABLES ####################
+
+/** A mutex used to synchronise access to the log file and the evaluation counter (the cost function may be called concurrently). */
+boost::mutex g_mutex;
+
+/** The number of evaluations that have been started so far (used to give each evaluation its own files and experiment tags). */
+size_t g_evaluationCount = 0;
+
 //#################### FUNCTIONS ####################
 
 float grove_cost_fn(const Arguments& args, const ParamSet& params)
 {
+  // Make a unique index for this evaluation. This is used to name the files used by the evaluation, and is passed to the
+  // script so that it can name its own files and experiments uniquely, so that concurrent evaluations do not interfere.
+  std::string evaluationIndex;
+  {
+    boost::lock_guard<boost::mutex> lock(g_mutex);
+    evaluationIndex = boost::lexical_cast<std::string>(g_evaluationCount++);
+  }
+
+  const std::string suffix = "-" + evaluationIndex;
+
   // Write the parameters to the specified .ini file.
-  const bf::path iniPath = args.dir / (args.iniSpecifier + ".ini");
+  const bf::path iniPath = args.dir / (args.iniSpecifier + suffix + ".ini");
 
   {
     std::ofstream fs(iniPath.string().c_str());
@@ -69,8 +91,8 @@ float grove_cost_fn(const Arguments& args, const ParamSet& params)
   }
 
   // Run the specified script.
-  const bf::path outputPath = args.dir / (args.outputSpecifier + ".txt");
-  const std::string command = "\"" + args.scriptPath.string() + "\" \"" + iniPath.string() + "\" \"" + outputPath.string() + "\" \"" + bf::path(args.datasetDir).string() + "\"";
+  const bf::path outputPath = args.dir / (args.outputSpecifier + suffix + ".txt");
+  const std::string command = "\"" + args.scriptPath.string() + "\" \"" + iniPath.string() + "\" \"" + outputPath.string() + "\" \"" + bf::path(args.datasetDir).string() + "\" \"" + evaluationIndex + "\"";
 
   // Wrap the system call with a timer.
   bt::cpu_timer timer;
@@ -115,17 +137,20 @@ float grove_cost_fn(const Arguments& args, const ParamSet& params)
     }
   }
 
-  std::ofstream logStream(args.logPath.c_str(), std::ios::app);
-  logStream << cost << ';'
-            << elapsedSeconds << ';'
-            << relocLoss << ';'
-            << icpLoss << ';'
-            << trainingMicroseconds << ';'
-            << updateMicroseconds << ';'
-            << initialRelocalisationMicroseconds << ';'
-            << icpRefinementMicroseconds << ';'
-            << totalRelocalisationMicroseconds << ';'
-            << ParamSetUtil::param_set_to_string(params) << '\n';
+  {
+    boost::lock_guard<boost::mutex> lock(g_mutex);
+    std::ofstream logStream(args.logPath.c_str(), std::ios::app);
+    logStream << cost << ';'
+              << elapsedSeconds << ';'
+              << relocLoss << ';'
+              << icpLoss << ';'
+              << trainingMicroseconds << ';'
+              << updateMicroseconds << ';'
+              << initialRelocalisationMicroseconds << ';'
+              << icpRefinementMicroseconds << ';'
+              << totalRelocalisationMicroseconds << ';'
+              << ParamSetUtil::param_set_to_string(params) << '\n';
+  }
 
   // Delete the .ini file and the output file again.
   bf::remove(iniPath);
@@ -144,8 +169,10 @@ bool parse_command_line(int argc, char *argv[], Arguments& args)
   po::options_description options;
   options.add_options()
     ("help", "produce help message")
+    ("costCache,c", po::value<std::string>(&args.costCacheSpecifier)->default_value(""), "the cost cache specifier (if any), used to resume an interrupted optimisation")
     ("datasetDir,d", po::value<std::string>(&args.datasetDir)->default_value(""), "the dataset directory")
     ("logSpecifier,l", po::value<std::string>(&args.logSpecifier)->default_value("relocopt.log"), "the log specifier")
+    ("maxConcurrentEvaluations,w", po::value<size_t>(&args.maxConcurrentEvaluations)->default_value(1), "the maximum number of parameter sets to evaluate concurrently")
     ("scriptSpecifier,s", po::value<std::string>(&args.scriptSpecifier)->default_value(""), "the script specifier")
   ;
 
@@ -210,6 +237,10 @@ try
   CoordinateDescentParameterOptimiser optimiser(boost::bind(grove_cost_fn, args, _1), epochCount, seed);
 #endif
 
+  // Evaluate independent parameter sets concurrently if requested, and reuse the costs from any previous runs.
+  optimiser.set_max_concurrent_evaluations(args.maxConcurrentEvaluations);
+  if(args.costCacheSpecifier != "") optimiser.set_cost_cache_file((args.dir / args.costCacheSpecifier).string());
+
 //  // Scene parameters.
 //  optimiser.add_param("SceneParams.mu", list_of<float>(2.0f)(4.0f)(6.0f)(8.0f)(10.0f)); // It's a multiplicative coefficient applied to the voxelSize, requires a change in the main spaintgui app at the moment.
 //  optimiser.add_param("SceneParams.voxelSize", list_of<float>(0.005f)(0.010f)(0.015f)(0.020f)(0.025f)(0.030f)(0.040f)(0.050f));
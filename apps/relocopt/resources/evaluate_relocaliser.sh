@@ -1,11 +1,13 @@
 #! /usr/bin/env bash
 
-# Parameters are: iniPath outputPath datasetPath
+# Parameters are: iniPath outputPath datasetPath [evaluationIndex]
 # spaintgui is located in the parent folder
+# The evaluation index must be unique among any evaluations that are run concurrently, since it is used to name
+# the temporary .ini file and the experiments (and thus the directories into which the poses are saved).
 
 set -e
 
-tag='Relocopt_Batch'
+tag="Relocopt_Batch_${4:-0}"
 # We skip heads because there aren't enough subsequences to split the training set in train + validation
 sequences='chess fire office pumpkin redkitchen stairs'
 sequence_count=6
@@ -24,6 +24,7 @@ using namespace itmx;
 
 #include <oglx/WrappedGL.h>
 
+#include <orx/base/MemoryBlockFactory.h>
 #include <orx/persistence/ImagePersister.h>
 #include <orx/persistence/PosePersister.h>
 using namespace orx;
@@ -55,9 +56,11 @@ Application::Application(const MultiScenePipeline_Ptr& pipeline, bool renderFidu
 : m_activeSubwindowIndex(0),
   m_batchModeEnabled(false),
   m_commandManager(10),
+  m_memoryUsageSampleIndex(0),
   m_pauseBetweenFrames(true),
   m_paused(true),
   m_pipeline(pipeline),
+  m_renderClientImages(pipeline->get_model()->get_settings(), "Application.renderClientImages", true),
   m_renderFiducials(renderFiducials),
   m_saveModelsOnExit(false),
   m_usePoseMirroring(true),
@@ -94,7 +97,7 @@ bool Application::run()
     else                   { if(eventQuit || escQuit) break; }
 
     // If desired, save the memory usage for later analysis.
-    if(m_memoryUsageOutputStream) save_current_memory_usage();
+    if(m_memoryBlockUsageOutputStream) save_current_memory_usage();
 
     // Take action as relevant based on the current input state.
     process_input();
@@ -111,7 +114,7 @@ bool Application::run()
         if(m_frameDebugHook) m_frameDebugHook(m_pipeline->get_model());
 
         // If we're currently recording the sequence, save the frame to disk.
-        if(m_sequencePathGenerator) save_sequence_frame();
+        if(m_sequencePathGenerator || m_packedSequenceRecorder) save_sequence_frame();
       }
       else if(m_batchModeEnabled)
       {
@@ -124,8 +127,7 @@ bool Application::run()
     m_renderer->render(m_fracWindowPos, m_renderFiducials);
 
     // If we're running a mapping server and we want to render any scene images requested by remote clients, do so.
-    const Model_CPtr model = m_pipeline->get_model();
-    if(model->get_mapping_server() && model->get_settings()->get_first_value<bool>("Application.renderClientImages", true))
+    if(m_pipeline->get_model()->get_mapping_server() && *m_renderClientImages)
     {
       m_renderer->render_client_images();
     }
@@ -167,29 +169,39 @@ void Application::set_frame_debug_hook(const FrameDebugHook& frameDebugHook)
 
 void Application::set_save_memory_usage(bool saveMemoryUsage)
 {
-#ifdef WITH_CUDA
-  // If we're trying to turn off memory usage saving, reset the output stream and early out.
+  // If we're trying to turn off memory usage saving, reset the output streams and early out.
   if(!saveMemoryUsage)
   {
+    m_memoryBlockUsageOutputStream.reset();
     m_memoryUsageOutputStream.reset();
     return;
   }
 
-  // Otherwise, prepare the output stream:
+  // Otherwise, prepare the output streams:
 
   // Step 1: Find the profiling subdirectory and make sure that it exists.
   const boost::filesystem::path profilingSubdir = find_subdir_from_executable("profiling");
   boost::filesystem::create_directories(profilingSubdir);
 
-  // Step 2: Determine the name of the file to which to save the memory usage. We base this on the
+  // Step 2: Determine the base name of the files to which to save the memory usage. We base this on the
   //         (global) experiment tag, if available, and the current timestamp if not.
   std::string profilingFileName = m_pipeline->get_model()->get_settings()->get_first_value<std::string>("experimentTag", "");
   if(profilingFileName == "") profilingFileName = "spaint-" + TimeUtil::get_iso_timestamp();
-  profilingFileName += ".csv";
 
-  // Step 3: Open the file and write a header row for the table. The table has three columns for each available GPU
-  //         (denoting the free, used and total memory on that GPU in MB at each frame).
-  const boost::filesystem::path profilingFile = profilingSubdir / profilingFileName;
+  // Step 3: Open the file for the memory usage of the blocks made by the memory block factory, and write a header row for the table.
+  //         Since the tags with which the blocks are made only become known as the blocks are made, the table has a row for each tag
+  //         at each frame (denoting the number of live blocks with the tag, and the live and peak memory they use in MB), rather than
+  //         a column for each tag. The memory held by the factory's pool of released blocks is recorded using the tag "<pooled>".
+  const boost::filesystem::path blockProfilingFile = profilingSubdir / (profilingFileName + "-blocks.csv");
+  m_memoryBlockUsageOutputStream.reset(new std::ofstream(blockProfilingFile.string().c_str()));
+  std::cout << "Saving memory block usage information in: " << blockProfilingFile << '\n';
+  *m_memoryBlockUsageOutputStream << "Frame;Tag;Live Blocks;Live (MB);Peak (MB)\n";
+  m_memoryUsageSampleIndex = 0;
+
+#ifdef WITH_CUDA
+  // Step 4: Open the file for the GPU memory usage and write a header row for the table. The table has three columns for each
+  //         available GPU (denoting the free, used and total memory on that GPU in MB at each frame).
+  const boost::filesystem::path profilingFile = profilingSubdir / (profilingFileName + ".csv");
   m_memoryUsageOutputStream.reset(new std::ofstream(profilingFile.string().c_str()));
   std::cout << "Saving memory usage information in: " << profilingFile << '\n';
 
@@ -303,7 +315,12 @@ void Application::handle_key_down(const SDL_Keysym& keysym)
   // If right shift + / is pressed, toggle video recording.
   if(keysym.sym == SDLK_SLASH)
   {
-    if(m_inputState.key_down(KEYCODE_LSHIFT)) toggle_recording("sequence", m_sequencePathGenerator);
+    if(m_inputState.key_down(KEYCODE_LSHIFT))
+    {
+      const bool packSequences = m_pipeline->get_model()->get_settings()->get_first_value<bool>("Application.packSequences", false);
+      if(packSequences) toggle_packed_sequence_recording();
+      else toggle_recording("sequence", m_sequencePathGenerator);
+    }
     else if(m_inputState.key_down(KEYCODE_RSHIFT)) toggle_recording("video", m_videoPathGenerator);
     else save_screenshot();
   }
@@ -909,6 +926,28 @@ void Application::process_voice_input()
 
 void Application::save_current_memory_usage()
 {
+  const size_t bytesPerMb = 1024 * 1024;
+
+  // Make sure that the memory block usage output stream has been initialised, and throw if not.
+  if(!m_memoryBlockUsageOutputStream)
+  {
+    throw std::runtime_error("Error: Memory block usage output stream has not been initialised");
+  }
+
+  // Save the memory usage of the blocks made by the memory block factory, broken down by tag.
+  const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  const std::map<std::string,MemoryBlockFactory::Usage> usages = mbf.get_usages();
+  for(std::map<std::string,MemoryBlockFactory::Usage>::const_iterator it = usages.begin(), iend = usages.end(); it != iend; ++it)
+  {
+    const MemoryBlockFactory::Usage& usage = it->second;
+    *m_memoryBlockUsageOutputStream << m_memoryUsageSampleIndex << ';' << it->first << ';' << usage.m_liveBlockCount << ';'
+                                    << static_cast<double>(usage.m_liveBytes) / bytesPerMb << ';'
+                                    << static_cast<double>(usage.m_peakBytes) / bytesPerMb << '\n';
+  }
+
+  *m_memoryBlockUsageOutputStream << m_memoryUsageSampleIndex << ";<pooled>;;" << static_cast<double>(mbf.get_pooled_bytes()) / bytesPerMb << ";\n";
+  ++m_memoryUsageSampleIndex;
+
 #ifdef WITH_CUDA
   // Make sure that the memory usage output stream has been initialised, and throw if not.
   if(!m_memoryUsageOutputStream)
@@ -936,7 +975,6 @@ void Application::save_current_memory_usage()
     ORcudaSafeCall(cudaMemGetInfo(&freeMemory, &totalMemory));
 
     // Convert the memory usage to MB.
-    const size_t bytesPerMb = 1024 * 1024;
     const size_t freeMb = freeMemory / bytesPerMb;
     const size_t usedMb = (totalMemory - freeMemory) / bytesPerMb;
     const size_t totalMb = totalMemory / bytesPerMb;
@@ -1062,8 +1100,17 @@ void Application::save_sequence_frame()
   const Subwindow& mainSubwindow = m_renderer->get_subwindow_configuration()->subwindow(0);
   const std::string& sceneID = mainSubwindow.get_scene_id();
 
-  // If the RGBD calibration hasn't already been saved, save it now.
   SLAMState_CPtr slamState = m_pipeline->get_model()->get_slam_state(sceneID);
+
+  // If we're recording a packed sequence, hand the frame to the recorder, which will compress and write it on its own thread.
+  // Note that, unlike the pose files saved below, the recorder expects the pose itself (i.e. the world -> camera transformation).
+  if(m_packedSequenceRecorder)
+  {
+    m_packedSequenceRecorder->record_frame(slamState->get_input_rgb_image_copy(), slamState->get_input_raw_depth_image_copy(), slamState->get_pose());
+    return;
+  }
+
+  // If the RGBD calibration hasn't already been saved, save it now.
   boost::filesystem::path calibrationFile = m_sequencePathGenerator->get_base_dir() / "calib.txt";
   if(!boost::filesystem::exists(calibrationFile))
   {
@@ -1159,6 +1206,37 @@ void Application::switch_to_windowed_renderer(size_t subwindowConfigurationIndex
   m_renderer.reset(new WindowedRenderer(title, m_pipeline->get_model(), subwindowConfiguration, windowViewportSize));
 }
 
+void Application::toggle_packed_sequence_recording()
+{
+  if(m_packedSequenceRecorder)
+  {
+    // Stopping the recorder waits for any frames that are still queued to be written.
+    m_packedSequenceRecorder.reset();
+    std::cout << "[spaint] Stopped saving packed sequence.\n";
+  }
+  else
+  {
+    const Subwindow& mainSubwindow = m_renderer->get_subwindow_configuration()->subwindow(0);
+    SLAMState_CPtr slamState = m_pipeline->get_model()->get_slam_state(mainSubwindow.get_scene_id());
+    if(!slamState->get_view())
+    {
+      std::cout << "[spaint] Cannot start saving a packed sequence until the first frame has been processed.\n";
+      return;
+    }
+
+    const boost::filesystem::path p = find_subdir_from_executable("sequences") / (TimeUtil::get_iso_timestamp() + ".rgbd");
+    boost::filesystem::create_directories(p.parent_path());
+
+    const Settings_CPtr& settings = m_pipeline->get_model()->get_settings();
+    const size_t capacity = settings->get_first_value<size_t>("Application.packedSequenceBufferCapacity", 30);
+    m_packedSequenceRecorder.reset(new PackedRGBDSequenceRecorder(
+      p.string(), slamState->get_view()->calib, slamState->get_rgb_image_size(), slamState->get_depth_image_size(), capacity
+    ));
+
+    std::cout << "[spaint] Started saving packed sequence to " << p << "...\n";
+  }
+}
+
 void Application::toggle_recording(const std::string& type, boost::optional<tvgutil::SequentialPathGenerator>& pathGenerator)
 {
   if(pathGenerator)
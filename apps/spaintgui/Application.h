@@ -16,10 +16,13 @@
 
 #include <ITMLib/Engines/Meshing/Interface/ITMMeshingEngine.h>
 
+#include <itmx/persistence/PackedRGBDSequenceRecorder.h>
+
 #include <tvginput/InputState.h>
 
 #include <tvgutil/commands/CommandManager.h>
 #include <tvgutil/filesystem/SequentialPathGenerator.h>
+#include <tvgutil/misc/Setting.h>
 
 #include "core/MultiScenePipeline.h"
 #include "renderers/Renderer.h"
@@ -63,12 +66,21 @@ private:
   /** The current state of the keyboard and mouse. */
   tvginput::InputState m_inputState;
 
+  /** The stream on which to output the memory usage of the blocks made by the memory block factory (if memory usage saving is enabled). */
+  boost::shared_ptr<std::ofstream> m_memoryBlockUsageOutputStream;
+
   /** The stream on which to output the memory usage (if memory usage saving is enabled). */
   boost::shared_ptr<std::ofstream> m_memoryUsageOutputStream;
 
+  /** The index of the next memory usage sample to save (if memory usage saving is enabled). */
+  size_t m_memoryUsageSampleIndex;
+
   /** The meshing engine. */
   MeshingEngine_Ptr m_meshingEngine;
 
+  /** The recorder for the current packed sequence recording (if any). */
+  itmx::PackedRGBDSequenceRecorder_Ptr m_packedSequenceRecorder;
+
   /** Whether or not to pause between frames (for debugging purposes). */
   bool m_pauseBetweenFrames;
 
@@ -81,6 +93,9 @@ private:
   /** The current renderer. */
   Renderer_Ptr m_renderer;
 
+  /** Whether or not to render any scene images requested by the clients of the mapping server (if any). */
+  tvgutil::Setting<bool> m_renderClientImages;
+
   /** Whether or not to render the fiducials (if any) that have been detected in the 3D scene. */
   bool m_renderFiducials;
 
@@ -346,6 +361,11 @@ private:
    */
   void switch_to_windowed_renderer(size_t subwindowConfigurationIndex);
 
+  /**
+   * \brief Toggles packed sequence recording on or off.
+   */
+  void toggle_packed_sequence_recording();
+
   /**
    * \brief Toggles sequence or video recording on or off.
    *
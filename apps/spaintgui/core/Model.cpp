@@ -17,16 +17,13 @@ using namespace ITMLib;
 #include <spaint/selectiontransformers/SelectionTransformerFactory.h>
 #include <spaint/selectors/NullSelector.h>
 #include <spaint/selectors/PickingSelector.h>
+#include <spaint/selectors/TouchSelector.h>
 using namespace spaint;
 
 #ifdef WITH_LEAP
 #include <spaint/selectors/LeapSelector.h>
 #endif
 
-#ifdef WITH_ARRAYFIRE
-#include <spaint/selectors/TouchSelector.h>
-#endif
-
 //#################### CONSTRUCTORS ####################
 
 Model::Model(const Settings_CPtr& settings, const std::string& resourcesDir, size_t maxLabelCount, const MappingServer_Ptr& mappingServer)
@@ -187,7 +184,6 @@ void Model::update_selector(const InputState& inputState, const SLAMState_CPtr&
       m_selector.reset(new LeapSelector(m_settings, m_voxelVisualisationEngine, LeapSelector::MODE_POINT, m_leapFiducialID));
     }
 #endif
-#ifdef WITH_ARRAYFIRE
     else if(inputState.key_down(KEYCODE_4))
     {
       const TouchSettings_Ptr touchSettings(new TouchSettings(m_resourcesDir + "/TouchSettings.xml"));
@@ -197,7 +193,6 @@ void Model::update_selector(const InputState& inputState, const SLAMState_CPtr&
       const int initialSelectionRadius = 1;
       m_selectionTransformer = SelectionTransformerFactory::make_voxel_to_cube(initialSelectionRadius, m_settings->deviceType);
     }
-#endif
   }
 
   // Update the current selection transformer (if any).
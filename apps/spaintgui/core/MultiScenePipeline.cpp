@@ -7,11 +7,19 @@
 using namespace itmx;
 using namespace spaint;
 
+#include <algorithm>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
 #include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 namespace bf = boost::filesystem;
 
 #include <tvgutil/containers/MapUtil.h>
+#include <tvgutil/misc/TaskGroup.h>
 using namespace tvgutil;
 
 //#################### CONSTRUCTORS ####################
@@ -31,11 +39,28 @@ MultiScenePipeline::MultiScenePipeline(const std::string& type, const Settings_P
 
   // Set up the spaint model.
   m_model.reset(new Model(settings, resourcesDir, maxLabelCount, mappingServer));
+
+  // Determine how the scenes should be scheduled. By default, the scenes are processed one after the other, since not all of the
+  // components they use are safe to run concurrently. Note that the Vicon interface (if any) is shared between all the scenes and
+  // is not thread-safe, so if it's in use we always process the scenes one after the other, even if parallel processing is enabled.
+  const std::string settingsNamespace = "MultiScenePipeline.";
+  m_printSceneTimers = settings->get_first_value<bool>(settingsNamespace + "printSceneTimers", false);
+  m_processScenesInParallel = settings->get_first_value<bool>(settingsNamespace + "processScenesInParallel", false) && !m_model->get_vicon();
 }
 
 //#################### DESTRUCTOR ####################
 
-MultiScenePipeline::~MultiScenePipeline() {}
+MultiScenePipeline::~MultiScenePipeline()
+{
+  if(m_printSceneTimers)
+  {
+    for(std::map<std::string,AverageTimer>::const_iterator it = m_sceneTimers.begin(), iend = m_sceneTimers.end(); it != iend; ++it)
+    {
+      const AverageTimer& timer = it->second;
+      std::cout << "SLAM (" << timer.name() << "): " << timer.count() << " frames, avg: " << timer.average_duration() << ", total: " << timer.total_duration() << ".\n";
+    }
+  }
+}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
@@ -59,6 +84,11 @@ Model_CPtr MultiScenePipeline::get_model() const
   return m_model;
 }
 
+const std::map<std::string,MultiScenePipeline::AverageTimer>& MultiScenePipeline::get_scene_timers() const
+{
+  return m_sceneTimers;
+}
+
 const std::string& MultiScenePipeline::get_type() const
 {
   return m_type;
@@ -76,11 +106,26 @@ void MultiScenePipeline::reset_scene(const std::string& sceneID)
 
 std::set<std::string> MultiScenePipeline::run_main_section()
 {
-  std::set<std::string> result;
+  // Divide the scenes into those that can be processed independently and those that mirror the pose of another scene
+  // (the latter need to be processed after the scenes they mirror). We also make sure that every scene has a timer,
+  // and that every per-scene entry that a SLAM component might look up in the model already exists, so that the
+  // worker threads never need to modify any of the maps involved.
+  std::vector<std::string> independentSceneIDs, mirroringSceneIDs;
   for(std::map<std::string,SLAMComponent_Ptr>::const_iterator it = m_slamComponents.begin(), iend = m_slamComponents.end(); it != iend; ++it)
   {
-    if(it->second->process_frame()) result.insert(it->first);
+    const std::string& sceneID = it->first;
+    if(it->second->get_mirror_scene_id().empty()) independentSceneIDs.push_back(sceneID);
+    else mirroringSceneIDs.push_back(sceneID);
+
+    if(m_sceneTimers.find(sceneID) == m_sceneTimers.end()) m_sceneTimers.insert(std::make_pair(sceneID, AverageTimer(sceneID)));
+    m_model->get_mapping_client(sceneID);
+    m_model->get_relocaliser(sceneID);
+    m_model->get_slam_state(sceneID);
   }
+
+  std::set<std::string> result;
+  process_scenes(independentSceneIDs, m_processScenesInParallel, result);
+  process_scenes(mirroringSceneIDs, false, result);
   return result;
 }
 
@@ -178,3 +223,69 @@ void MultiScenePipeline::load_models(const SLAMComponent_Ptr& slamComponent, con
   std::cout << "Loading models for " << slamComponent->get_scene_id() << " from: " << inputDir << std::endl;
   slamComponent->load_models(inputDir);
 }
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void MultiScenePipeline::process_scene_frame(const std::string& sceneID, int maxOpenMPThreads, char& frameProcessed, boost::exception_ptr& error)
+{
+#ifdef WITH_OPENMP
+  // Limit the number of OpenMP threads the scene can use (note that this only affects the calling thread).
+  const int oldMaxOpenMPThreads = omp_get_max_threads();
+  if(maxOpenMPThreads > 0) omp_set_num_threads(maxOpenMPThreads);
+#endif
+
+  try
+  {
+    AverageTimer& timer = m_sceneTimers.find(sceneID)->second;
+    timer.start_nosync();
+    frameProcessed = MapUtil::lookup(m_slamComponents, sceneID)->process_frame();
+    timer.stop_nosync();
+  }
+  catch(...)
+  {
+    error = boost::current_exception();
+  }
+
+#ifdef WITH_OPENMP
+  omp_set_num_threads(oldMaxOpenMPThreads);
+#endif
+}
+
+void MultiScenePipeline::process_scenes(const std::vector<std::string>& sceneIDs, bool runInParallel, std::set<std::string>& result)
+{
+  const size_t sceneCount = sceneIDs.size();
+  std::vector<char> framesProcessed(sceneCount, 0);
+  std::vector<boost::exception_ptr> errors(sceneCount);
+
+  if(runInParallel && sceneCount > 1)
+  {
+    // Divide the OpenMP threads between the scenes, so that the scenes' parallel regions don't oversubscribe the cores between them.
+    int maxOpenMPThreadsPerScene = 0;
+#ifdef WITH_OPENMP
+    maxOpenMPThreadsPerScene = std::max(omp_get_max_threads() / static_cast<int>(sceneCount), 1);
+#endif
+
+    // Process the scenes as high-priority tasks on the shared task scheduler, and wait for all of them to finish.
+    TaskGroup tasks;
+    for(size_t i = 0; i < sceneCount; ++i)
+    {
+      tasks.run(boost::bind(&MultiScenePipeline::process_scene_frame, this, boost::cref(sceneIDs[i]), maxOpenMPThreadsPerScene, boost::ref(framesProcessed[i]), boost::ref(errors[i])), TP_HIGH);
+    }
+    tasks.wait();
+  }
+  else
+  {
+    for(size_t i = 0; i < sceneCount; ++i)
+    {
+      process_scene_frame(sceneIDs[i], 0, framesProcessed[i], errors[i]);
+      if(errors[i]) break;
+    }
+  }
+
+  // Collect the results in scene ID order, rethrowing the first exception (if any) so that the behaviour is deterministic.
+  for(size_t i = 0; i < sceneCount; ++i)
+  {
+    if(errors[i]) boost::rethrow_exception(errors[i]);
+    if(framesProcessed[i]) result.insert(sceneIDs[i]);
+  }
+}
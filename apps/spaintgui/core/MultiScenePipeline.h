@@ -6,12 +6,16 @@
 #ifndef H_SPAINTGUI_MULTISCENEPIPELINE
 #define H_SPAINTGUI_MULTISCENEPIPELINE
 
+#include <boost/exception_ptr.hpp>
+
 #include <spaint/pipelinecomponents/ObjectSegmentationComponent.h>
 #include <spaint/pipelinecomponents/PropagationComponent.h>
 #include <spaint/pipelinecomponents/SemanticSegmentationComponent.h>
 #include <spaint/pipelinecomponents/SLAMComponent.h>
 #include <spaint/pipelinecomponents/SmoothingComponent.h>
 
+#include <tvgutil/timing/AverageTimer.h>
+
 #include "Model.h"
 
 /**
@@ -54,6 +58,21 @@ public:
     MODE_TRAINING
   };
 
+  //#################### TYPEDEFS ####################
+public:
+  typedef tvgutil::AverageTimer<boost::chrono::microseconds> AverageTimer;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** Whether or not to print the per-scene SLAM timings when the pipeline is destroyed. */
+  bool m_printSceneTimers;
+
+  /** Whether or not to run the SLAM components for independent scenes concurrently, as tasks on the shared task scheduler (off by default). */
+  bool m_processScenesInParallel;
+
+  /** Timers recording how long the SLAM component for each scene takes to process a frame. */
+  std::map<std::string,AverageTimer> m_sceneTimers;
+
   //#################### PROTECTED VARIABLES ####################
 protected:
   /** The mode in which the multi-scene pipeline is currently running. */
@@ -161,12 +180,24 @@ public:
    */
   void reset_scene(const std::string& sceneID);
 
+  /**
+   * \brief Gets the timers recording how long the SLAM component for each scene takes to process a frame.
+   *
+   * \return  The timers recording how long the SLAM component for each scene takes to process a frame.
+   */
+  const std::map<std::string,AverageTimer>& get_scene_timers() const;
+
   /**
    * \brief Runs the main section of the multi-scene pipeline.
    *
-   * This involves processing the next frame (if any) for each individual scene.
+   * This involves processing the next frame (if any) for each individual scene. If parallel scene processing is enabled,
+   * the SLAM components for scenes that do not depend on each other are run concurrently on the shared task scheduler,
+   * and this function only returns once all of them have finished (so the mode-specific section can safely be run next).
+   * Scenes that mirror the pose of another scene are processed afterwards, since they depend on that scene's new pose.
    *
    * \return  The scenes for a which a new frame was available.
+   *
+   * \throws std::exception If processing any scene fails (if several fail, the exception from the first in scene ID order is rethrown).
    */
   virtual std::set<std::string> run_main_section();
 
@@ -235,6 +266,31 @@ protected:
    * \throws std::runtime_error If the input directory does not contain at least a voxel model for a SLAM component.
    */
   void load_models(const spaint::SLAMComponent_Ptr& slamComponent, const std::string& inputDir);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Runs the SLAM component for the specified scene for a single frame, and records how long it took.
+   *
+   * \note  This is designed to be run on a worker thread: any exception thrown is captured rather than propagated.
+   *
+   * \param sceneID           The scene ID.
+   * \param maxOpenMPThreads  The maximum number of OpenMP threads that the scene may use (0 means no limit).
+   * \param frameProcessed    A variable into which to write whether or not a frame was processed for the scene.
+   * \param error             A variable into which to write any exception that was thrown whilst processing the frame.
+   */
+  void process_scene_frame(const std::string& sceneID, int maxOpenMPThreads, char& frameProcessed, boost::exception_ptr& error);
+
+  /**
+   * \brief Runs the SLAM components for the specified scenes for a single frame, either concurrently or one after the other.
+   *
+   * \param sceneIDs      The IDs of the scenes to process.
+   * \param runInParallel Whether or not to process the scenes concurrently (if so, the OpenMP threads are divided between them).
+   * \param result        The set to which to add the IDs of the scenes for which a new frame was available.
+   *
+   * \throws std::exception If processing any scene fails.
+   */
+  void process_scenes(const std::vector<std::string>& sceneIDs, bool runInParallel, std::set<std::string>& result);
 };
 
 //#################### TYPEDEFS ####################
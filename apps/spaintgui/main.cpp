@@ -4,6 +4,7 @@
  */
 
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <string>
 
@@ -49,6 +50,7 @@
 #ifdef WITH_ZED
 #include <itmx/imagesources/ZedImageSourceEngine.h>
 #endif
+#include <itmx/persistence/PackedRGBDSequenceReader.h>
 
 #include <orx/base/MemoryBlockFactory.h>
 #include <orx/geometry/GeometryUtil.h>
@@ -59,6 +61,7 @@
 #include "core/ObjectivePipeline.h"
 #include "core/SemanticPipeline.h"
 #include "core/SLAMPipeline.h"
+#include "sequences/PackedSequence.h"
 #include "sequences/SpaintSequence.h"
 
 using namespace InputSource;
@@ -88,6 +91,7 @@ struct CommandLineArguments
   std::vector<std::string> depthImageMasks;
   std::vector<float> depthNoiseSigmas;
   bool detectFiducials;
+  std::string effectiveSettingsFile;
   std::string experimentTag;
   std::string fiducialDetectorType;
   std::string globalPosesSpecifier;
@@ -150,6 +154,7 @@ struct CommandLineArguments
       ADD_SETTINGS(depthNoiseSigmas);
       ADD_SETTING(detectFiducials);
       ADD_SETTINGS(diskTrackerConfigs);
+      ADD_SETTING(effectiveSettingsFile);
       ADD_SETTING(experimentTag);
       ADD_SETTING(fiducialDetectorType);
       ADD_SETTING(globalPosesSpecifier);
@@ -301,21 +306,25 @@ std::vector<Sequence_CPtr> determine_sequences(const CommandLineArguments& args)
     double missingDepthFraction = i < args.missingDepthFractions.size() ? args.missingDepthFractions[i] : 0.0;
     float depthNoiseSigma = i < args.depthNoiseSigmas.size() ? args.depthNoiseSigmas[i] : 0.0f;
 
-    const std::string& sequenceSpecifier = args.sequenceSpecifiers[i];
-    if(!bf::is_regular_file(sequenceSpecifier))
-    {
-      // Determine the sequence type.
-      const std::string sequenceType = i < args.sequenceTypes.size() ? args.sequenceTypes[i] : "sequence";
+    // Determine the sequence type.
+    const std::string sequenceType = i < args.sequenceTypes.size() ? args.sequenceTypes[i] : "sequence";
 
-      // Determine the directory containing the sequence.
-      bf::path dir = bf::is_directory(sequenceSpecifier)
-        ? sequenceSpecifier
-        : find_subdir_from_executable(sequenceType + "s") / sequenceSpecifier;
+    // Determine the location of the sequence (either a directory or a packed sequence file).
+    const std::string& sequenceSpecifier = args.sequenceSpecifiers[i];
+    bf::path path = bf::exists(sequenceSpecifier)
+      ? sequenceSpecifier
+      : find_subdir_from_executable(sequenceType + "s") / sequenceSpecifier;
 
-      // Add the sequence to the list.
-      sequences.push_back(Sequence_CPtr(new SpaintSequence(dir, initialFrameNumber, missingDepthFraction, depthNoiseSigma)));
+    // Add the sequence to the list.
+    if(!bf::is_regular_file(path))
+    {
+      sequences.push_back(Sequence_CPtr(new SpaintSequence(path, initialFrameNumber, missingDepthFraction, depthNoiseSigma)));
     }
-    else throw std::runtime_error("Error: The sequence specifier '" + sequenceSpecifier + "' denotes a file rather than a directory");
+    else if(PackedRGBDSequenceReader::is_packed_sequence(path.string()))
+    {
+      sequences.push_back(Sequence_CPtr(new PackedSequence(path, initialFrameNumber, missingDepthFraction, depthNoiseSigma)));
+    }
+    else throw std::runtime_error("Error: The sequence specifier '" + sequenceSpecifier + "' denotes a file that is not a packed sequence");
   }
 
   // Add any sequence that the user specifies implicitly via depth/RGB/pose masks.
@@ -675,6 +684,7 @@ bool parse_command_line(int argc, char *argv[], CommandLineArguments& args, cons
     ("configFile,f", po::value<std::string>(), "additional parameters filename")
     ("depthNoiseSigma", po::value<std::vector<float> >(&args.depthNoiseSigmas)->multitoken(), "depth noise sigma")
     ("detectFiducials", po::bool_switch(&args.detectFiducials), "enable fiducial detection")
+    ("effectiveSettingsFile", po::value<std::string>(&args.effectiveSettingsFile)->default_value(""), "the file (if any) to which to write the effective settings used for the run")
     ("experimentTag", po::value<std::string>(&args.experimentTag)->default_value(Settings::NOT_SET), "experiment tag")
     ("fiducialDetectorType", po::value<std::string>(&args.fiducialDetectorType)->default_value("aruco"), "fiducial detector type (aruco|vicon)")
     ("globalPosesSpecifier,g", po::value<std::string>(&args.globalPosesSpecifier)->default_value(""), "global poses specifier")
@@ -959,7 +969,17 @@ try
   {
     std::cout << "Setting mapping client for host '" << args.host << "' and port '" << args.port << "'\n";
     const pooled_queue::PoolEmptyStrategy poolEmptyStrategy = settings->get_first_value<pooled_queue::PoolEmptyStrategy>("MappingClient.poolEmptyStrategy", pooled_queue::PES_DISCARD);
-    pipeline->set_mapping_client(Model::get_world_scene_id(), MappingClient_Ptr(new MappingClient(args.host, args.port, poolEmptyStrategy)));
+    const uint32_t frameWindowSize = settings->get_first_value<uint32_t>("MappingClient.frameWindowSize", 1);
+    const size_t maxFramePoolSize = settings->get_first_value<size_t>("MappingClient.maxFramePoolSize", 0);
+
+    // Note that the mapping client's frame pool is lock-free and so cannot grow without bound: with the 'grow' strategy, pushes wait once it is full.
+    if(poolEmptyStrategy == pooled_queue::PES_GROW)
+    {
+      std::cerr << "Warning: The mapping client's frame pool cannot grow without bound: once it reaches its maximum size "
+                << "(MappingClient.maxFramePoolSize, by default twice its initial size), new frames will wait to be sent\n";
+    }
+
+    pipeline->set_mapping_client(Model::get_world_scene_id(), MappingClient_Ptr(new MappingClient(args.host, args.port, poolEmptyStrategy, frameWindowSize, maxFramePoolSize)));
   }
 
 #ifdef WITH_LEAP
@@ -974,6 +994,17 @@ try
   app.set_save_memory_usage(args.profileMemory);
   app.set_save_mesh_on_exit(args.saveMeshOnExit);
   app.set_save_models_on_exit(args.saveModelsOnExit);
+
+  // If requested, write out the effective settings for the run, so that it can later be reproduced. We do this once
+  // everything has been constructed (and so has registered its settings), but before running, so that the file is
+  // still written if the run crashes or is killed.
+  if(args.effectiveSettingsFile != "")
+  {
+    std::ofstream fs(args.effectiveSettingsFile.c_str());
+    if(fs) settings->output_effective_settings(fs);
+    else std::cerr << "Warning: Could not write the effective settings to " << args.effectiveSettingsFile << '\n';
+  }
+
   bool runSucceeded = app.run();
 
   // Close all open joysticks.
@@ -10,6 +10,13 @@ using namespace orx;
 using namespace rigging;
 using namespace tvgutil;
 
+#include <algorithm>
+#include <set>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
 #include <itmx/util/CameraPoseConverter.h>
 using namespace itmx;
 
@@ -23,12 +30,12 @@ using namespace orx;
 #include <spaint/ogl/CameraRenderer.h>
 #include <spaint/selectiontransformers/interface/VoxelToCubeSelectionTransformer.h>
 #include <spaint/selectors/PickingSelector.h>
+#include <spaint/selectors/TouchSelector.h>
 #include <spaint/util/CameraFactory.h>
 using namespace spaint;
 
 #ifdef WITH_ARRAYFIRE
 #include <spaint/imageprocessing/MedianFilterer.h>
-#include <spaint/selectors/TouchSelector.h>
 #endif
 
 #ifdef WITH_LEAP
@@ -122,7 +129,6 @@ public:
     render_orb(*pickPoint, m_selectionRadius * m_base->m_model->get_settings()->sceneParams.voxelSize);
   }
 
-#ifdef WITH_ARRAYFIRE
   /** Override */
   virtual void visit(const TouchSelector& selector) const
   {
@@ -161,7 +167,6 @@ public:
       glPopAttrib();
     OpenGLUtil::end_2d();
   }
-#endif
 
   /** Override */
   virtual void visit(const VoxelToCubeSelectionTransformer& transformer) const
@@ -190,8 +195,10 @@ private:
 
 Renderer::Renderer(const Model_CPtr& model, const SubwindowConfiguration_Ptr& subwindowConfiguration, const Vector2i& windowViewportSize)
 : m_model(model),
+  m_renderCamera(model->get_settings(), "renderCamera", true),
   m_subwindowConfiguration(subwindowConfiguration),
   m_supersamplingEnabled(false),
+  m_usePixelDebugging(model->get_settings(), "usePixelDebugging", true),
   m_windowViewportSize(windowViewportSize)
 {
   const std::string pipelineType = model->get_settings()->get_first_value<std::string>("pipelineType");
@@ -263,8 +270,18 @@ void Renderer::render_client_images() const
   MappingServer_CPtr mappingServer = m_model->get_mapping_server();
   if(!mappingServer) return;
 
-  // Otherwise, for each client of the mapping server:
   std::vector<int> clients = mappingServer->get_active_clients();
+
+  // Discard the scene compositors of any clients that have disconnected (client IDs are never reused,
+  // so the compositors would otherwise accumulate for the lifetime of the server).
+  const std::set<int> activeClients(clients.begin(), clients.end());
+  for(std::map<int,SceneCompositor>::iterator it = m_clientSceneCompositors.begin(), iend = m_clientSceneCompositors.end(); it != iend;)
+  {
+    if(activeClients.find(it->first) == activeClients.end()) m_clientSceneCompositors.erase(it++);
+    else ++it;
+  }
+
+  // For each client of the mapping server:
   for(size_t i = 0, size = clients.size(); i < size; ++i)
   {
     // Get the most recent rendering request from the client.
@@ -282,7 +299,7 @@ void Renderer::render_client_images() const
 
     // Render the requested image for the client.
     // FIXME: The camera intrinsics shouldn't be hard-coded.
-    // FIXME: The render states should be cached unless the size changes.
+    // FIXME: The render states for the primary scene should be cached unless the size changes.
     std::string primarySceneID = mappingServer->get_scene_id(clients[i]);
     if(primarySceneID == "") primarySceneID = Model::get_world_scene_id();
     ITMIntrinsics intrinsics(image->noDims);
@@ -292,7 +309,7 @@ void Renderer::render_client_images() const
 
     render_all_reconstructed_scenes(
       request->extract_pose(), primarySceneID, static_cast<VisualisationGenerator::VisualisationType>(request->extract_visualisation_type()),
-      voxelRenderState, surfelRenderState, intrinsics, surfelFlag, image
+      voxelRenderState, surfelRenderState, intrinsics, surfelFlag, m_clientSceneCompositors[clients[i]], image
     );
   }
 }
@@ -407,7 +424,7 @@ void Renderer::render_scene(const Vector2f& fracWindowPos, bool renderFiducials,
 
 #if WITH_GLUT && USE_PIXEL_DEBUGGING
     // If desired, render the value of the pixel to which the user is pointing (for debugging purposes).
-    if(m_model->get_settings()->get_first_value<bool>("usePixelDebugging", true))
+    if(*m_usePixelDebugging)
     {
       render_pixel_value(fracWindowPos, subwindow);
     }
@@ -500,108 +517,138 @@ const boost::optional<VisualisationGenerator::Postprocessor>& Renderer::get_post
   return postprocessor;
 }
 
+bool Renderer::is_voxel_scene_visualisation(VisualisationGenerator::VisualisationType visualisationType)
+{
+  switch(visualisationType)
+  {
+    case VisualisationGenerator::VT_INPUT_COLOUR:
+    case VisualisationGenerator::VT_INPUT_DEPTH:
+    case VisualisationGenerator::VT_RELOCALISER_GTPOINTS:
+    case VisualisationGenerator::VT_RELOCALISER_LEAVES:
+    case VisualisationGenerator::VT_RELOCALISER_POINTS:
+      return false;
+    default:
+      return true;
+  }
+}
+
 void Renderer::render_all_reconstructed_scenes(const ORUtils::SE3Pose& primaryPose, const std::string& primarySceneID,
                                                VisualisationGenerator::VisualisationType primaryVisualisationType,
                                                VoxelRenderState_Ptr& voxelRenderState, SurfelRenderState_Ptr& surfelRenderState,
-                                               const ITMIntrinsics& intrinsics, bool surfelFlag, const ORUChar4Image_Ptr& output) const
+                                               const ITMIntrinsics& intrinsics, bool surfelFlag, SceneCompositor& compositor,
+                                               const ORUChar4Image_Ptr& output) const
 {
-  static std::vector<ORUChar4Image_Ptr> colourImages;
-  static std::vector<ORFloatImage_Ptr> depthImages;
   const std::vector<std::string> sceneIDs = m_model->get_scene_ids();
-  std::vector<VisualisationGenerator::VisualisationType> visualisationTypes(sceneIDs.size());
+  const int sceneCount = static_cast<int>(sceneIDs.size());
 
-  // Step 1: If the output image size has changed since the last time we rendered the scenes, arrange for the colour and depth images for the scenes to be reallocated.
-  if(!colourImages.empty() && colourImages[0]->noDims != output->noDims)
-  {
-    colourImages.clear();
-    depthImages.clear();
-  }
+  // Step 1: Make sure that the compositor has a cleared layer of the right size for each scene.
+  compositor.prepare_layers(sceneIDs.size(), output->noDims);
 
-  // Step 2: Reallocate the colour and depth images for the scenes if needed.
-  while(colourImages.size() < sceneIDs.size())
+  // Step 2: Determine the pose and visualisation type to use for each scene that we have started to reconstruct.
+  std::vector<SLAMState_CPtr> slamStates(sceneCount);
+  std::vector<SE3Pose> poses(sceneCount, primaryPose);
+  std::vector<VisualisationGenerator::VisualisationType> visualisationTypes(sceneCount, primaryVisualisationType);
+  for(int i = 0; i < sceneCount; ++i)
   {
-    colourImages.push_back(ORUChar4Image_Ptr(new ORUChar4Image(output->noDims, true, true)));
-    depthImages.push_back(ORFloatImage_Ptr(new ORFloatImage(output->noDims, true, true)));
-  }
-
-  // Step 3: Render colour and depth images for each scene, making sure to render the primary scene for the
-  //         subwindow last so that the raycast result ultimately contains the correct voxels for picking.
-  size_t primarySceneIdx = 0;
-  for(size_t i = 0; i < sceneIDs.size() + 1; ++i)
-  {
-    // Determine which scene we should be rendering in this iteration of the loop. This will be the scene
-    // indicated by the loop counter unless either (i) i < sceneIDs[i] && sceneIDs[i] == primarySceneID,
-    // in which case we record the array index of the primary scene for later and skip the loop iteration,
-    // or (ii) i == sceneIDs.size(), in which case we arrange for the primary scene to be rendered.
-    size_t sceneIdx;
-    if(i < sceneIDs.size())
+    // If we have not yet started reconstruction for this scene, avoid rendering it.
+    slamStates[i] = m_model->get_slam_state(sceneIDs[i]);
+    if(!slamStates[i] || !slamStates[i]->get_view())
     {
-      if(sceneIDs[i] == primarySceneID)
-      {
-        primarySceneIdx = i;
-        continue;
-      }
-      else sceneIdx = i;
+      slamStates[i].reset();
+      continue;
     }
-    else sceneIdx = primarySceneIdx;
-
-    // Clear the colour and depth images for the chosen scene.
-    colourImages[sceneIdx]->Clear();
-    depthImages[sceneIdx]->Fill(-1.0f);
-
-    // If we have not yet started reconstruction for this scene, avoid rendering it and early out.
-    SLAMState_CPtr slamState = m_model->get_slam_state(sceneIDs[sceneIdx]);
-    if(!slamState || !slamState->get_view()) continue;
 
-    // Determine the pose and visualisation type to use for the scene.
-    SE3Pose tempPose = primaryPose;
-    visualisationTypes[sceneIdx] = primaryVisualisationType;
-
-    if(sceneIDs[sceneIdx] != primarySceneID)
+    if(sceneIDs[i] != primarySceneID)
     {
-      boost::optional<std::pair<SE3Pose,size_t> > result = m_model->get_collaborative_pose_optimiser()->try_get_relative_transform(primarySceneID, sceneIDs[sceneIdx]);
-      SE3Pose relativeTransform = result ? result->first : SE3Pose(static_cast<float>((sceneIdx + 1) * 2.0f), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-      if(!result || result->second < static_cast<size_t>(CollaborativePoseOptimiser::confidence_threshold())) visualisationTypes[sceneIdx] = VisualisationGenerator::VT_SCENE_SEMANTICPHONG;
+      boost::optional<std::pair<SE3Pose,size_t> > result = m_model->get_collaborative_pose_optimiser()->try_get_relative_transform(primarySceneID, sceneIDs[i]);
+      SE3Pose relativeTransform = result ? result->first : SE3Pose(static_cast<float>((i + 1) * 2.0f), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+      if(!result || result->second < static_cast<size_t>(CollaborativePoseOptimiser::confidence_threshold())) visualisationTypes[i] = VisualisationGenerator::VT_SCENE_SEMANTICPHONG;
 
       // ciTwi * wiTwj = ciTwj
-      tempPose.SetM(tempPose.GetM() * relativeTransform.GetM());
+      poses[i].SetM(poses[i].GetM() * relativeTransform.GetM());
     }
 
-    // Actually render the colour and depth images for the scene.
-    Relocaliser_CPtr relocaliser = m_model->get_relocaliser(sceneIDs[sceneIdx]);
-    generate_visualisation(
-      colourImages[sceneIdx], slamState->get_voxel_scene(), slamState->get_surfel_scene(),
-      voxelRenderState, surfelRenderState, relocaliser, tempPose, slamState->get_view(), intrinsics,
-      visualisationTypes[sceneIdx], surfelFlag
-    );
+    // Scenes that are rendered using Phong lighting are drawn behind all of the other scenes.
+    compositor.get_layer(i).m_pushedBack = visualisationTypes[i] == VisualisationGenerator::VT_SCENE_SEMANTICPHONG;
+  }
 
-    m_model->get_visualisation_generator()->generate_depth_from_voxels(
-      depthImages[sceneIdx], slamState->get_voxel_scene(), tempPose, intrinsics,
-      voxelRenderState, DepthVisualiser::DT_ORTHOGRAPHIC
-    );
+  // Step 3: Render colour and depth images for each scene into its layer. Each voxel scene is raycast only once, with the depth image
+  //         being computed from the points hit by the raycast used to generate the colour image. The primary scene is rendered using
+  //         the render states that were passed in, so that they ultimately contain the correct voxels for picking. The other scenes
+  //         are rendered using the render states of their layers, which means that (in CPU mode, where the visualisation engines do
+  //         not use any shared scratch memory) the scenes can all be rendered concurrently.
+  VisualisationGenerator_CPtr visualisationGenerator = m_model->get_visualisation_generator();
+  const boost::optional<VisualisationGenerator::Postprocessor>& postprocessor = get_postprocessor();
 
-    // Make sure the depth image for the scene is available on the CPU so that it can be used for depth testing.
-    depthImages[sceneIdx]->UpdateHostFromDevice();
+  std::vector<int> activeSceneIndices;
+  for(int i = 0; i < sceneCount; ++i)
+  {
+    if(slamStates[i]) activeSceneIndices.push_back(i);
   }
 
-  // Step 4: Combine the colour images for the different scenes using per-pixel depth testing to produce the final output image.
-  output->Clear();
-  for(int k = 0; k < output->noDims.width * output->noDims.height; ++k)
+  // Only render the scenes concurrently if there is more than one of them to render. If we do, then we divide the OpenMP
+  // threads between the scenes, and allow their own parallel regions to run nested inside the one that renders them,
+  // so that each scene can still be rendered using its share of the cores rather than a single thread.
+  const int activeSceneCount = static_cast<int>(activeSceneIndices.size());
+  const bool renderConcurrently = activeSceneCount > 1 && m_model->get_settings()->deviceType == DEVICE_CPU && !surfelFlag && is_voxel_scene_visualisation(primaryVisualisationType);
+
+#ifdef WITH_OPENMP
+  const int oldMaxActiveLevels = omp_get_max_active_levels();
+  int maxOpenMPThreadsPerScene = 0;
+  if(renderConcurrently)
+  {
+    maxOpenMPThreadsPerScene = std::max(omp_get_max_threads() / activeSceneCount, 1);
+    omp_set_max_active_levels(std::max(oldMaxActiveLevels, 2));
+  }
+
+  #pragma omp parallel for if(renderConcurrently) num_threads(std::max(activeSceneCount, 1))
+#endif
+  for(int j = 0; j < activeSceneCount; ++j)
   {
-    float smallestDepth = static_cast<float>(INT_MAX);
-    for(size_t i = 0, size = colourImages.size(); i < size; ++i)
+#ifdef WITH_OPENMP
+    // Note that this only affects the thread that is rendering this scene.
+    if(renderConcurrently) omp_set_num_threads(maxOpenMPThreadsPerScene);
+#endif
+
+    const int i = activeSceneIndices[j];
+    SceneCompositor::Layer& layer = compositor.get_layer(i);
+    const bool isPrimaryScene = sceneIDs[i] == primarySceneID;
+    VoxelRenderState_Ptr& sceneVoxelRenderState = isPrimaryScene ? voxelRenderState : layer.m_voxelRenderState;
+    SurfelRenderState_Ptr& sceneSurfelRenderState = isPrimaryScene ? surfelRenderState : layer.m_surfelRenderState;
+
+    if(!surfelFlag && is_voxel_scene_visualisation(visualisationTypes[i]))
     {
-      const float arbitrarilyLargeDepth = 100.0f;
-      float depth = depthImages[i]->GetData(MEMORYDEVICE_CPU)[k];
-      if(depth != -1.0f && visualisationTypes[i] == VisualisationGenerator::VT_SCENE_SEMANTICPHONG) depth = arbitrarilyLargeDepth;
-      if(depth != -1.0f && depth < smallestDepth)
-      {
-        smallestDepth = depth;
-        output->GetData(MEMORYDEVICE_CPU)[k] = colourImages[i]->GetData(MEMORYDEVICE_CPU)[k];
-      }
+      visualisationGenerator->generate_voxel_visualisation_and_depth(
+        layer.m_colourImage, layer.m_depthImage, slamStates[i]->get_voxel_scene(), poses[i], intrinsics,
+        sceneVoxelRenderState, visualisationTypes[i], DepthVisualiser::DT_ORTHOGRAPHIC, postprocessor
+      );
+    }
+    else
+    {
+      Relocaliser_CPtr relocaliser = m_model->get_relocaliser(sceneIDs[i]);
+      generate_visualisation(
+        layer.m_colourImage, slamStates[i]->get_voxel_scene(), slamStates[i]->get_surfel_scene(),
+        sceneVoxelRenderState, sceneSurfelRenderState, relocaliser, poses[i], slamStates[i]->get_view(), intrinsics,
+        visualisationTypes[i], surfelFlag
+      );
+
+      visualisationGenerator->generate_depth_from_voxels(
+        layer.m_depthImage, slamStates[i]->get_voxel_scene(), poses[i], intrinsics,
+        sceneVoxelRenderState, DepthVisualiser::DT_ORTHOGRAPHIC
+      );
+
+      // Make sure the depth image for the scene is available on the CPU so that it can be used for depth testing.
+      layer.m_depthImage->UpdateHostFromDevice();
     }
   }
 
+#ifdef WITH_OPENMP
+  omp_set_max_active_levels(oldMaxActiveLevels);
+#endif
+
+  // Step 4: Combine the colour images for the different scenes using per-pixel depth testing to produce the final output image.
+  compositor.composite(output);
+
   // Step 5: Render a quad textured with the final output image.
   render_image(output);
 }
@@ -610,7 +657,7 @@ void Renderer::render_all_reconstructed_scenes(const ORUtils::SE3Pose& primaryPo
 {
   render_all_reconstructed_scenes(
     primaryPose, subwindow.get_scene_id(), subwindow.get_type(), subwindow.get_voxel_render_state(viewIndex), subwindow.get_surfel_render_state(viewIndex),
-    subwindow.get_camera_intrinsics(), subwindow.get_surfel_flag(), subwindow.get_image()
+    subwindow.get_camera_intrinsics(), subwindow.get_surfel_flag(), subwindow.get_scene_compositor(viewIndex), subwindow.get_image()
   );
 }
 
@@ -704,7 +751,7 @@ void Renderer::render_synthetic_scene(const std::string& sceneID, const SE3Pose&
       glLoadMatrixf(CameraPoseConverter::pose_to_modelview(pose).data());
 
       // If desired, render the default camera.
-      if(m_model->get_settings()->get_first_value<bool>("renderCamera", true))
+      if(*m_renderCamera)
       {
         static SimpleCamera defaultCam = *CameraFactory::make_default_camera();
         CameraRenderer::render_camera(defaultCam);
@@ -19,6 +19,8 @@
 
 #include <rigging/MoveableCamera.h>
 
+#include <tvgutil/misc/Setting.h>
+
 #include "../core/Model.h"
 #include "../subwindows/SubwindowConfiguration.h"
 
@@ -37,12 +39,18 @@ private:
   /** The OpenGL context for the window. */
   SDL_GLContext_Ptr m_context;
 
+  /** The scene compositors to use when rendering images for the active clients of the mapping server (indexed by client ID). */
+  mutable std::map<int,spaint::SceneCompositor> m_clientSceneCompositors;
+
   /** A flag indicating whether or not to use median filtering when rendering the scene raycast. */
   bool m_medianFilteringEnabled;
 
   /** The spaint model. */
   Model_CPtr m_model;
 
+  /** Whether or not to render the default camera over the top of the scene. */
+  tvgutil::Setting<bool> m_renderCamera;
+
   /** The sub-window configuration to use for visualising the scene. */
   SubwindowConfiguration_Ptr m_subwindowConfiguration;
 
@@ -52,6 +60,9 @@ private:
   /** The ID of a texture in which to temporarily store the scene raycast and touch image when rendering. */
   GLuint m_textureID;
 
+  /** Whether or not to render the value of the pixel to which the user is pointing (for debugging purposes). */
+  tvgutil::Setting<bool> m_usePixelDebugging;
+
   /** The window into which to render. */
   SDL_Window_Ptr m_window;
 
@@ -247,9 +258,19 @@ private:
    */
   const boost::optional<spaint::VisualisationGenerator::Postprocessor>& get_postprocessor() const;
 
+  /**
+   * \brief Determines whether or not the specified type of visualisation is generated by raycasting a voxel scene.
+   *
+   * \param visualisationType The type of visualisation.
+   * \return                  true, if the visualisation is generated by raycasting a voxel scene, or false otherwise.
+   */
+  static bool is_voxel_scene_visualisation(spaint::VisualisationGenerator::VisualisationType visualisationType);
+
   /**
    * \brief Renders all the reconstructed scenes into an image, with appropriate depth testing.
    *
+   * Each scene is rendered into its own layer of the specified compositor, and the layers are then combined to produce the output image.
+   *
    * \param primaryPose               The camera pose in the primary scene.
    * \param primarySceneID            The ID of the primary scene.
    * \param primaryVisualisationType  The type of visualisation to use for the primary scene.
@@ -257,12 +278,14 @@ private:
    * \param surfelRenderState         The surfel render state to use for intermediate storage (if relevant).
    * \param intrinsics                The intrinsics to use when rendering synthetic scene visualisations.
    * \param surfelFlag                Whether or not to render a surfel visualisation rather than a voxel one.
+   * \param compositor                The compositor to use to combine the renderings of the individual scenes.
    * \param output                    The location into which to put the output image.
    */
   void render_all_reconstructed_scenes(const ORUtils::SE3Pose& primaryPose, const std::string& primarySceneID,
                                        spaint::VisualisationGenerator::VisualisationType primaryVisualisationType,
                                        VoxelRenderState_Ptr& voxelRenderState, SurfelRenderState_Ptr& surfelRenderState,
-                                       const ITMLib::ITMIntrinsics& intrinsics, bool surfelFlag, const ORUChar4Image_Ptr& output) const;
+                                       const ITMLib::ITMIntrinsics& intrinsics, bool surfelFlag, spaint::SceneCompositor& compositor,
+                                       const ORUChar4Image_Ptr& output) const;
 
   /**
    * \brief Renders all the reconstructed scenes into a sub-window, with appropriate depth testing.
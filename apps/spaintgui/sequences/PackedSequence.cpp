@@ -0,0 +1,46 @@
+/**
+ * spaintgui: PackedSequence.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "PackedSequence.h"
+using namespace InputSource;
+
+#include <boost/lexical_cast.hpp>
+namespace bf = boost::filesystem;
+
+#include <itmx/imagesources/DepthCorruptingImageSourceEngine.h>
+#include <itmx/imagesources/PackedRGBDSequenceImageSourceEngine.h>
+using namespace itmx;
+
+//#################### CONSTRUCTORS ####################
+
+PackedSequence::PackedSequence(const bf::path& path, size_t initialFrameNumber, double missingDepthFraction, float depthNoiseSigma)
+: Sequence(initialFrameNumber), m_depthNoiseSigma(depthNoiseSigma), m_missingDepthFraction(missingDepthFraction), m_path(path)
+{}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+std::string PackedSequence::make_disk_tracker_config() const
+{
+  return "<tracker type='packed'><params>path=" + m_path.string() + ",initialFrameNo=" +
+         boost::lexical_cast<std::string>(m_initialFrameNumber) + "</params></tracker>";
+}
+
+ImageSourceEngine *PackedSequence::make_image_source_engine(const std::string& calibrationFilename) const
+{
+  ImageSourceEngine *packedSource = new PackedRGBDSequenceImageSourceEngine(m_path.string(), calibrationFilename, m_initialFrameNumber);
+  return m_missingDepthFraction > 0.0 || m_depthNoiseSigma > 0.0f ? new DepthCorruptingImageSourceEngine(packedSource, m_missingDepthFraction, m_depthNoiseSigma) : packedSource;
+}
+
+std::string PackedSequence::to_string() const
+{
+  return m_path.string();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+bf::path PackedSequence::dir() const
+{
+  return m_path;
+}
@@ -0,0 +1,64 @@
+/**
+ * spaintgui: PackedSequence.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_SPAINTGUI_PACKEDSEQUENCE
+#define H_SPAINTGUI_PACKEDSEQUENCE
+
+#include "Sequence.h"
+
+/**
+ * \brief An instance of this class represents an RGB-D disk sequence that is stored in a single packed sequence file.
+ */
+class PackedSequence : public Sequence
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The sigma of the Gaussian to use when corrupting the depth with zero-mean, depth-dependent Gaussian noise (0 = disabled). */
+  float m_depthNoiseSigma;
+
+  /** The fraction of the depth images to zero out (in the range [0,1]). */
+  double m_missingDepthFraction;
+
+  /** The path to the packed sequence file. */
+  boost::filesystem::path m_path;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a packed sequence.
+   *
+   * \param path                  The path to the packed sequence file.
+   * \param initialFrameNumber    The number of the initial frame that we want to use.
+   * \param missingDepthFraction  The fraction of the depth images to zero out (in the range [0,1]).
+   * \param depthNoiseSigma       The sigma of the Gaussian to use when corrupting the depth with zero-mean, depth-dependent Gaussian noise (0 = disabled).
+   */
+  PackedSequence(const boost::filesystem::path& path, size_t initialFrameNumber, double missingDepthFraction, float depthNoiseSigma);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual std::string make_disk_tracker_config() const;
+
+  /** Override */
+  virtual InputSource::ImageSourceEngine *make_image_source_engine(const std::string& calibrationFilename) const;
+
+  /** Override */
+  virtual std::string to_string() const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets the path to the packed sequence file.
+   *
+   * \note  A packed sequence is a single file rather than a directory, so this yields the file itself. This has the effect of
+   *        making the sequence ID the stem of the file, and of making the default calibration path one that never exists
+   *        (which is what we want, since the calibration is stored in the file).
+   *
+   * \return  The path to the packed sequence file.
+   */
+  virtual boost::filesystem::path dir() const;
+};
+
+#endif
@@ -82,6 +82,11 @@ bool Subwindow::get_remote_flag() const
   return m_remoteFlag;
 }
 
+SceneCompositor& Subwindow::get_scene_compositor(int viewIndex)
+{
+  return m_sceneCompositors[viewIndex];
+}
+
 const std::string& Subwindow::get_scene_id() const
 {
   return m_sceneID;
@@ -133,6 +138,7 @@ void Subwindow::resize_image(const Vector2i& newImgSize)
   m_image.reset(new ORUChar4Image(newImgSize, true, true));
   m_voxelRenderStates.clear();
   m_surfelRenderStates.clear();
+  m_sceneCompositors.clear();
 }
 
 void Subwindow::set_all_scenes_flag(bool allScenesFlag)
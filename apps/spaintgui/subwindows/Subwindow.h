@@ -8,6 +8,7 @@
 
 #include <rigging/CompositeCamera.h>
 
+#include <spaint/visualisation/SceneCompositor.h>
 #include <spaint/visualisation/VisualisationGenerator.h>
 
 /**
@@ -56,6 +57,9 @@ private:
   /** A flag indicating whether or not to ask the mapping server to render the image for this sub-window. */
   bool m_remoteFlag;
 
+  /** The scene compositor(s) to use when rendering all scenes for the free camera view(s). */
+  std::map<int,spaint::SceneCompositor> m_sceneCompositors;
+
   /** The ID of the primary scene to render in the sub-window. */
   std::string m_sceneID;
 
@@ -159,6 +163,13 @@ public:
    */
   bool get_remote_flag() const;
 
+  /**
+   * \brief Gets the scene compositor to use when rendering all scenes for the specified free camera view.
+   *
+   * \param viewIndex The index of the free camera view.
+   */
+  spaint::SceneCompositor& get_scene_compositor(int viewIndex = 0);
+
   /**
    * \brief Gets the ID of the primary scene to render in the sub-window.
    *
@@ -0,0 +1,15 @@
+##########################
+# OfferAVX2Support.cmake #
+##########################
+
+OPTION(WITH_AVX2 "Enable AVX2 code paths? (The resulting binaries will only run on CPUs that support AVX2 and FMA.)" OFF)
+
+IF(WITH_AVX2)
+  IF(MSVC_IDE)
+    SET(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} /arch:AVX2")
+  ELSE()
+    SET(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -mavx2 -mfma")
+  ENDIF()
+
+  ADD_DEFINITIONS(-DWITH_AVX2)
+ENDIF()
@@ -6,8 +6,13 @@
 #ifndef H_EVALUATION_EPOCHBASEDPARAMETEROPTIMISER
 #define H_EVALUATION_EPOCHBASEDPARAMETEROPTIMISER
 
+#include <fstream>
+
+#include <boost/exception_ptr.hpp>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/spirit/home/support/detail/hold_any.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <tvgutil/numbers/RandomNumberGenerator.h>
 
@@ -17,6 +22,11 @@ namespace evaluation {
 
 /**
  * \brief An instance of a class deriving from this one can be used to try to find (over a series of optimisation epochs) a parameter set with as low a cost as possible.
+ *
+ * The cost of each parameter set is only ever computed once: the results are memoised, and can optionally be persisted to a cost cache file,
+ * so that an optimisation that is interrupted or repeated can pick up where it left off without re-running any evaluations. Derived classes
+ * evaluate independent parameter sets in batches (e.g. all the values of a parameter in a coordinate descent sweep), and the parameter sets
+ * in a batch whose costs are not yet known can be evaluated concurrently on a bounded number of threads.
  */
 class EpochBasedParameterOptimiser
 {
@@ -26,12 +36,24 @@ protected:
 
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** The costs of the parameter sets that have been evaluated so far. */
+  mutable std::map<ParamSet,float> m_costCache;
+
+  /** The stream to which to append newly-computed costs (if a cost cache file is being used). */
+  mutable boost::shared_ptr<std::ofstream> m_costCacheStream;
+
   /** The cost function to use to evaluate the different parameter sets. */
   CostFunction m_costFunction;
 
   /** The number of epochs for which optimisation should be run. */
   size_t m_epochCount;
 
+  /** The maximum number of parameter sets whose costs can be computed concurrently. */
+  size_t m_maxConcurrentEvaluations;
+
+  /** A mutex used to synchronise access to the cost cache and the evaluation workers' shared state. */
+  mutable boost::mutex m_mutex;
+
   //#################### PROTECTED VARIABLES ####################
 protected:
   /** A list of the possible values for each parameter (e.g. [("A", [1,2]), ("B", [3,4])]). */
@@ -94,6 +116,29 @@ public:
    */
   ParamSet optimise_for_parameters(float *bestCost = NULL) const;
 
+  /**
+   * \brief Sets the file used to persist the costs of the parameter sets that are evaluated.
+   *
+   * Any costs already in the file are loaded (so that the corresponding parameter sets will not be re-evaluated), and
+   * the cost of each parameter set that is evaluated from now on is appended to the file as soon as it is known.
+   *
+   * \param path  The path to the cost cache file (this will be created if it does not already exist).
+   * \return      The optimiser itself (so that calls to it may be chained).
+   *
+   * \throws std::runtime_error If the cost cache file cannot be opened for writing.
+   */
+  EpochBasedParameterOptimiser& set_cost_cache_file(const std::string& path);
+
+  /**
+   * \brief Sets the maximum number of parameter sets whose costs can be computed concurrently.
+   *
+   * \note  If this is greater than one, the cost function must be safe to call from multiple threads at once.
+   *
+   * \param maxConcurrentEvaluations  The maximum number of parameter sets whose costs can be computed concurrently.
+   * \return                          The optimiser itself (so that calls to it may be chained).
+   */
+  EpochBasedParameterOptimiser& set_max_concurrent_evaluations(size_t maxConcurrentEvaluations);
+
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
   /**
@@ -105,8 +150,17 @@ protected:
    */
   float compute_cost(const std::vector<size_t>& valueIndices) const;
 
-  //#################### PRIVATE MEMBER FUNCTIONS ####################
-private:
+  /**
+   * \brief Computes the costs associated with a batch of independent sets of parameter value indices.
+   *
+   * The costs of any parameter sets that have not previously been evaluated are computed concurrently (subject to the maximum
+   * number of concurrent evaluations). This is equivalent to calling compute_cost on each set of indices in turn.
+   *
+   * \param valueIndicesBatch The sets of parameter value indices.
+   * \return                  The costs associated with the sets of parameter value indices (in the same order).
+   */
+  std::vector<float> compute_costs(const std::vector<std::vector<size_t> >& valueIndicesBatch) const;
+
   /**
    * \brief Generates a random set of parameter value indices, denoting particular settings for the parameters.
    *
@@ -114,6 +168,15 @@ private:
    */
   std::vector<size_t> generate_random_value_indices() const;
 
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Computes the costs of the specified parameter sets (none of which has previously been evaluated), and adds them to the cost cache.
+   *
+   * \param paramSets The parameter sets.
+   */
+  void evaluate_param_sets(const std::vector<ParamSet>& paramSets) const;
+
   /**
    * \brief Makes the parameter set corresponding to the specified parameter value indices.
    *
@@ -121,6 +184,39 @@ private:
    * \return              The corresponding parameter set.
    */
   ParamSet make_param_set(const std::vector<size_t>& valueIndices) const;
+
+  /**
+   * \brief Runs the specified number of optimisation epochs, each of which starts from a randomly-generated set of parameter value indices.
+   *
+   * By default, the epochs are run one after the other. Derived classes whose epochs are independent of each other can override
+   * this to evaluate the costs for all of the epochs as a single batch.
+   *
+   * \param epochCount  The number of epochs to run.
+   * \return            The optimised set of parameter value indices and the associated cost for each epoch.
+   */
+  virtual std::vector<std::pair<std::vector<size_t>,float> > optimise_epochs(size_t epochCount) const;
+
+  /**
+   * \brief Repeatedly takes the next unevaluated parameter set from a shared list, computes its cost and adds it to the cost cache.
+   *
+   * This runs on each of the evaluation threads, and terminates when there are no more parameter sets left to evaluate
+   * (or when an evaluation on one of the threads has failed).
+   *
+   * \param paramSets The parameter sets to evaluate.
+   * \param nextIndex The index of the next parameter set to evaluate (shared between the threads).
+   * \param error     The exception thrown by the first evaluation to fail (if any).
+   */
+  void run_evaluation_worker(const std::vector<ParamSet>& paramSets, size_t& nextIndex, boost::exception_ptr& error) const;
+
+  /**
+   * \brief Adds the cost of a parameter set to the cost cache (and the cost cache file, if any).
+   *
+   * \note  The caller must hold the mutex.
+   *
+   * \param paramSet  The parameter set.
+   * \param cost      The cost of the parameter set.
+   */
+  void store_cost(const ParamSet& paramSet, float cost) const;
 };
 
 }
@@ -28,6 +28,9 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /** Override */
+  virtual std::vector<std::pair<std::vector<size_t>,float> > optimise_epochs(size_t epochCount) const;
+
   /** Override */
   virtual std::pair<std::vector<size_t>,float> optimise_value_indices(const std::vector<size_t>& initialValueIndices) const;
 };
@@ -41,20 +41,27 @@ std::pair<std::vector<size_t>,float> CoordinateDescentParameterOptimiser::optimi
     // Record the parameter value for which we already have the corresponding cost so that we can avoid re-evaluating it.
     size_t originalValueIndex = currentValueIndices[paramIndex];
 
-    // For each possible new value that the parameter can take:
-    std::vector<size_t> newValueIndices = currentValueIndices;
+    // Compute the costs for all of the possible new values that the parameter can take in one batch (this allows them to be
+    // evaluated concurrently). The cost for the original value is already known, so there's no need to re-evaluate it.
+    std::vector<std::vector<size_t> > candidateValueIndices;
+    std::vector<size_t> candidateValues;
     for(size_t valueIndex = 0; valueIndex < valueCount; ++valueIndex)
     {
-      // If we already know that the cost for the new value is no better than the cost for the current value, skip it.
       if(valueIndex == originalValueIndex) continue;
+      candidateValueIndices.push_back(currentValueIndices);
+      candidateValueIndices.back()[paramIndex] = valueIndex;
+      candidateValues.push_back(valueIndex);
+    }
+
+    const std::vector<float> candidateCosts = compute_costs(candidateValueIndices);
 
-      // Compute the cost for the new value. If it's better than the cost for the current value, update the current value.
-      newValueIndices[paramIndex] = valueIndex;
-      float newCost = compute_cost(newValueIndices);
-      if(newCost < currentCost)
+    // For each possible new value, if its cost is better than the cost for the current value, update the current value.
+    for(size_t i = 0, size = candidateValues.size(); i < size; ++i)
+    {
+      if(candidateCosts[i] < currentCost)
       {
-        currentValueIndices[paramIndex] = valueIndex;
-        currentCost = newCost;
+        currentValueIndices[paramIndex] = candidateValues[i];
+        currentCost = candidateCosts[i];
       }
     }
 
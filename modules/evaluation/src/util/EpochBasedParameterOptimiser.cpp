@@ -5,9 +5,14 @@
 
 #include "util/EpochBasedParameterOptimiser.h"
 
+#include <algorithm>
+#include <iomanip>
 #include <limits>
+#include <stdexcept>
 
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
 using boost::spirit::hold_any;
 
 namespace evaluation {
@@ -15,7 +20,7 @@ namespace evaluation {
 //#################### CONSTRUCTORS ####################
 
 EpochBasedParameterOptimiser::EpochBasedParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed)
-: m_costFunction(costFunction), m_epochCount(epochCount), m_rng(seed)
+: m_costFunction(costFunction), m_epochCount(epochCount), m_maxConcurrentEvaluations(1), m_rng(seed)
 {}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -31,22 +36,17 @@ ParamSet EpochBasedParameterOptimiser::optimise_for_parameters(float *bestCost)
   std::vector<size_t> bestValueIndicesAllTime;
   float bestCostAllTime = std::numeric_limits<float>::max();
 
-  // For each epoch:
-  for(size_t i = 0; i < m_epochCount; ++i)
-  {
-    // Randomly generate an initial set of parameter value indices.
-    std::vector<size_t> initialValueIndices = generate_random_value_indices();
-
-    // Optimise the initial set of parameter value indices.
-    std::vector<size_t> optimisedValueIndices;
-    float optimisedCost;
-    boost::tie(optimisedValueIndices, optimisedCost) = optimise_value_indices(initialValueIndices);
+  // Run the epochs.
+  const std::vector<std::pair<std::vector<size_t>,float> > results = optimise_epochs(m_epochCount);
 
+  // Find the best set of parameter value indices found in any epoch.
+  for(size_t i = 0, size = results.size(); i < size; ++i)
+  {
     // If the optimised cost is the best we've seen so far, update the best cost and best parameter value indices.
-    if(optimisedCost < bestCostAllTime)
+    if(results[i].second < bestCostAllTime)
     {
-      bestCostAllTime = optimisedCost;
-      bestValueIndicesAllTime = optimisedValueIndices;
+      bestCostAllTime = results[i].second;
+      bestValueIndicesAllTime = results[i].first;
     }
   }
 
@@ -55,11 +55,101 @@ ParamSet EpochBasedParameterOptimiser::optimise_for_parameters(float *bestCost)
   return make_param_set(bestValueIndicesAllTime);
 }
 
-//#################### PRIVATE MEMBER FUNCTIONS ####################
+EpochBasedParameterOptimiser& EpochBasedParameterOptimiser::set_cost_cache_file(const std::string& path)
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+
+  // Load any costs that are already in the file. Each line contains a cost, followed by the parameters and their values,
+  // all separated by tabs. A line that was only partially written (e.g. because the process was killed) is ignored.
+  bool endsWithNewline = true;
+  {
+    std::ifstream fs(path.c_str());
+    std::string line;
+    while(std::getline(fs, line))
+    {
+      endsWithNewline = !fs.eof();
+      if(!endsWithNewline) break;
+
+      std::vector<std::string> fields;
+      for(size_t begin = 0, end; begin <= line.size(); begin = end + 1)
+      {
+        end = std::min(line.find('\t', begin), line.size());
+        fields.push_back(line.substr(begin, end - begin));
+      }
+
+      ParamSet paramSet;
+      for(size_t i = 1, size = fields.size(); i < size; ++i)
+      {
+        const size_t pos = fields[i].find('=');
+        if(pos != std::string::npos) paramSet.insert(std::make_pair(fields[i].substr(0, pos), fields[i].substr(pos + 1)));
+      }
+
+      try
+      {
+        m_costCache[paramSet] = boost::lexical_cast<float>(fields[0]);
+      }
+      catch(boost::bad_lexical_cast&) {}
+    }
+  }
+
+  // Open the file so that we can append any new costs to it.
+  m_costCacheStream.reset(new std::ofstream(path.c_str(), std::ios::app));
+  if(!*m_costCacheStream) throw std::runtime_error("Error: Could not open cost cache file for writing: " + path);
+  if(!endsWithNewline) *m_costCacheStream << '\n';
+
+  return *this;
+}
+
+EpochBasedParameterOptimiser& EpochBasedParameterOptimiser::set_max_concurrent_evaluations(size_t maxConcurrentEvaluations)
+{
+  m_maxConcurrentEvaluations = std::max<size_t>(maxConcurrentEvaluations, 1);
+  return *this;
+}
+
+//#################### PROTECTED MEMBER FUNCTIONS ####################
 
 float EpochBasedParameterOptimiser::compute_cost(const std::vector<size_t>& valueIndices) const
 {
-  return m_costFunction(make_param_set(valueIndices));
+  return compute_costs(std::vector<std::vector<size_t> >(1, valueIndices))[0];
+}
+
+std::vector<float> EpochBasedParameterOptimiser::compute_costs(const std::vector<std::vector<size_t> >& valueIndicesBatch) const
+{
+  const size_t batchSize = valueIndicesBatch.size();
+  std::vector<ParamSet> paramSets(batchSize);
+  for(size_t i = 0; i < batchSize; ++i)
+  {
+    paramSets[i] = make_param_set(valueIndicesBatch[i]);
+  }
+
+  // Determine which of the parameter sets have not yet been evaluated (making sure not to evaluate any of them more than once).
+  std::vector<ParamSet> unevaluatedParamSets;
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    for(size_t i = 0; i < batchSize; ++i)
+    {
+      if(m_costCache.find(paramSets[i]) == m_costCache.end() &&
+         std::find(unevaluatedParamSets.begin(), unevaluatedParamSets.end(), paramSets[i]) == unevaluatedParamSets.end())
+      {
+        unevaluatedParamSets.push_back(paramSets[i]);
+      }
+    }
+  }
+
+  // Evaluate them.
+  evaluate_param_sets(unevaluatedParamSets);
+
+  // Look up the costs of all of the parameter sets in the cache.
+  std::vector<float> costs(batchSize);
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    for(size_t i = 0; i < batchSize; ++i)
+    {
+      costs[i] = m_costCache[paramSets[i]];
+    }
+  }
+
+  return costs;
 }
 
 std::vector<size_t> EpochBasedParameterOptimiser::generate_random_value_indices() const
@@ -72,6 +162,32 @@ std::vector<size_t> EpochBasedParameterOptimiser::generate_random_value_indices(
   return valueIndices;
 }
 
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void EpochBasedParameterOptimiser::evaluate_param_sets(const std::vector<ParamSet>& paramSets) const
+{
+  // If there are several parameter sets to evaluate and we're allowed to evaluate them concurrently, start a bounded
+  // number of worker threads to evaluate them; otherwise, just evaluate them on the calling thread.
+  const size_t threadCount = std::min(m_maxConcurrentEvaluations, paramSets.size());
+  size_t nextIndex = 0;
+  boost::exception_ptr error;
+
+  if(threadCount > 1)
+  {
+    boost::thread_group threads;
+    for(size_t i = 0; i < threadCount; ++i)
+    {
+      threads.create_thread(boost::bind(&EpochBasedParameterOptimiser::run_evaluation_worker, this, boost::cref(paramSets), boost::ref(nextIndex), boost::ref(error)));
+    }
+    threads.join_all();
+  }
+  else run_evaluation_worker(paramSets, nextIndex, error);
+
+  // If any of the evaluations failed, propagate the exception to the caller. Note that the costs of any parameter sets
+  // that were successfully evaluated will already have been cached.
+  if(error) boost::rethrow_exception(error);
+}
+
 ParamSet EpochBasedParameterOptimiser::make_param_set(const std::vector<size_t>& valueIndices) const
 {
   ParamSet paramSet;
@@ -84,4 +200,64 @@ ParamSet EpochBasedParameterOptimiser::make_param_set(const std::vector<size_t>&
   return paramSet;
 }
 
+std::vector<std::pair<std::vector<size_t>,float> > EpochBasedParameterOptimiser::optimise_epochs(size_t epochCount) const
+{
+  std::vector<std::pair<std::vector<size_t>,float> > results;
+
+  // For each epoch, randomly generate an initial set of parameter value indices, and then optimise it. Note that the initial
+  // indices must be generated just before each epoch is run, since the optimisation may itself make use of the random number
+  // generator.
+  for(size_t i = 0; i < epochCount; ++i)
+  {
+    results.push_back(optimise_value_indices(generate_random_value_indices()));
+  }
+
+  return results;
+}
+
+void EpochBasedParameterOptimiser::run_evaluation_worker(const std::vector<ParamSet>& paramSets, size_t& nextIndex, boost::exception_ptr& error) const
+{
+  while(true)
+  {
+    // Claim the next parameter set to evaluate (if any).
+    size_t i;
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      if(nextIndex >= paramSets.size() || error) return;
+      i = nextIndex++;
+    }
+
+    // Evaluate it (without holding the lock, since this may take a very long time), and store the result.
+    try
+    {
+      const float cost = m_costFunction(paramSets[i]);
+
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      store_cost(paramSets[i], cost);
+    }
+    catch(...)
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      if(!error) error = boost::current_exception();
+    }
+  }
+}
+
+void EpochBasedParameterOptimiser::store_cost(const ParamSet& paramSet, float cost) const
+{
+  m_costCache[paramSet] = cost;
+
+  // If we're using a cost cache file, append the cost to it straight away, so that it will survive if the optimisation is interrupted.
+  if(m_costCacheStream)
+  {
+    std::ofstream& fs = *m_costCacheStream;
+    fs << std::setprecision(std::numeric_limits<float>::digits10 + 3) << cost;
+    for(ParamSet::const_iterator it = paramSet.begin(), iend = paramSet.end(); it != iend; ++it)
+    {
+      fs << '\t' << it->first << '=' << it->second;
+    }
+    fs << std::endl;
+  }
+}
+
 }
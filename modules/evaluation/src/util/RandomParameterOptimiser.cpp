@@ -15,6 +15,27 @@ RandomParameterOptimiser::RandomParameterOptimiser(const CostFunction& costFunct
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+std::vector<std::pair<std::vector<size_t>,float> > RandomParameterOptimiser::optimise_epochs(size_t epochCount) const
+{
+  // Since the epochs are independent, generate the parameter value indices for all of them up-front, and then
+  // compute all of their costs in one batch (this allows them to be evaluated concurrently).
+  std::vector<std::vector<size_t> > valueIndicesBatch;
+  for(size_t i = 0; i < epochCount; ++i)
+  {
+    valueIndicesBatch.push_back(generate_random_value_indices());
+  }
+
+  const std::vector<float> costs = compute_costs(valueIndicesBatch);
+
+  std::vector<std::pair<std::vector<size_t>,float> > results;
+  for(size_t i = 0; i < epochCount; ++i)
+  {
+    results.push_back(std::make_pair(valueIndicesBatch[i], costs[i]));
+  }
+
+  return results;
+}
+
 std::pair<std::vector<size_t>,float> RandomParameterOptimiser::optimise_value_indices(const std::vector<size_t>& initialValueIndices) const
 {
   // Don't perform any actual optimisation, just compute the cost of the initial parameters.
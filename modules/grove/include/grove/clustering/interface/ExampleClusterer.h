@@ -142,6 +142,26 @@ public:
   void cluster_examples(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
                         uint32_t exampleSetStart, uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers);
 
+  /**
+   * \brief Clusters several sets of examples in parallel, writing the clusters for the sets into a specified range of the output containers.
+   *
+   * \note  This makes it possible to cluster a batch of example sets into a staging buffer that only has room for the batch.
+   *
+   * \param exampleSets           An image containing the sets of examples to be clustered (one set per row). The width of
+   *                              the image specifies the maximum number of examples that can be contained in each set.
+   * \param exampleSetSizes       The number of valid examples in each example set.
+   * \param exampleSetStart       The index of the first example set for which to compute clusters.
+   * \param exampleSetCount       The number of example sets for which to compute clusters.
+   * \param clusterContainers     Output containers that will hold the clusters computed for each example set.
+   * \param clusterContainerStart The index of the container into which to write the clusters for the first example set.
+   *
+   * \throws std::invalid_argument If exampleSetStart + exampleSetCount would result in out-of-bounds access in exampleSets,
+   *                               or clusterContainerStart + exampleSetCount would result in out-of-bounds access in clusterContainers.
+   */
+  void cluster_examples(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
+                        uint32_t exampleSetStart, uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers,
+                        uint32_t clusterContainerStart);
+
   //#################### PRIVATE ABSTRACT MEMBER FUNCTIONS ####################
 private:
   /**
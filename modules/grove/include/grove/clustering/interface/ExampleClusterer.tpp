@@ -27,13 +27,13 @@ ExampleClusterer<ExampleType, ClusterType, MaxClusters>::ExampleClusterer(float
   // Initially, all are empty. We resize them later, once we know the right sizes.
   orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
 
-  m_clusterIndices = mbf.make_image<int>();
-  m_clusterSizeHistograms = mbf.make_image<int>();
-  m_clusterSizes = mbf.make_image<int>();
-  m_densities = mbf.make_image<float>();
-  m_nbClustersPerExampleSet = mbf.make_block<int>();
-  m_parents = mbf.make_image<int>();
-  m_selectedClusters = mbf.make_image<int>();
+  m_clusterIndices = mbf.make_image<int>(Vector2i(0, 0), "clustering");
+  m_clusterSizeHistograms = mbf.make_image<int>(Vector2i(0, 0), "clustering");
+  m_clusterSizes = mbf.make_image<int>(Vector2i(0, 0), "clustering");
+  m_densities = mbf.make_image<float>(Vector2i(0, 0), "clustering");
+  m_nbClustersPerExampleSet = mbf.make_block<int>(0, "clustering");
+  m_parents = mbf.make_image<int>(Vector2i(0, 0), "clustering");
+  m_selectedClusters = mbf.make_image<int>(Vector2i(0, 0), "clustering");
 }
 
 //#################### DESTRUCTOR ####################
@@ -47,6 +47,14 @@ ExampleClusterer<ExampleType,ClusterType,MaxClusters>::~ExampleClusterer()
 template <typename ExampleType, typename ClusterType, int MaxClusters>
 void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::cluster_examples(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
                                                                              uint32_t exampleSetStart, uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers)
+{
+  cluster_examples(exampleSets, exampleSetSizes, exampleSetStart, exampleSetCount, clusterContainers, exampleSetStart);
+}
+
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::cluster_examples(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
+                                                                             uint32_t exampleSetStart, uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers,
+                                                                             uint32_t clusterContainerStart)
 {
   const uint32_t nbExampleSets = exampleSets->noDims.height;
   const uint32_t exampleSetCapacity = exampleSets->noDims.width;
@@ -56,6 +64,11 @@ void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::cluster_examples(con
     throw std::invalid_argument("Error: exampleSetStart + exampleSetCount > nbExampleSets");
   }
 
+  if(clusterContainerStart + exampleSetCount > clusterContainers->dataSize)
+  {
+    throw std::invalid_argument("Error: clusterContainerStart + exampleSetCount > clusterContainers->dataSize");
+  }
+
   // Reallocate the temporary variables needed for the call as necessary. In practice, this tends to be a no-op for
   // all calls to cluster_examples except the first, since we only need to reallocate if more memory is required,
   // and the way in which cluster_examples is usually called tends not to cause this to happen.
@@ -65,7 +78,7 @@ void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::cluster_examples(con
   reset_temporaries(exampleSetCapacity, exampleSetCount);
 
   // Reset the cluster containers for each example set of interest.
-  ClusterContainer *clusterContainersPtr = get_pointer_to_cluster_container(clusterContainers, exampleSetStart);
+  ClusterContainer *clusterContainersPtr = get_pointer_to_cluster_container(clusterContainers, clusterContainerStart);
   reset_cluster_containers(clusterContainersPtr, exampleSetCount);
 
   // Compute the density of examples around each example in the example sets of interest.
@@ -13,6 +13,7 @@
 
 #include "../base/Descriptor.h"
 #include "../base/RGBDPatchFeatureDifferenceType.h"
+#include "../shared/RGBDPatchFeatureCalculator_Shared.h"
 #include "../../keypoints/Keypoint2D.h"
 #include "../../keypoints/Keypoint3DColour.h"
 
@@ -171,33 +172,44 @@ public:
                                       KeypointsImage *keypointsImage, DescriptorsImage *descriptorsImage) const;
 
   /**
-   * \brief Gets the step used when selecting keypoints and computing the features.
+   * \brief Computes the size of feature image to generate.
    *
-   * \return  The step used when selecting keypoints and computing the features.
+   * \note This also checks whether or not the input images needed to compute the desired features are available.
+   *
+   * \param rgbImage    The colour image.
+   * \param depthImage  The depth image.
+   * \return            The size of feature image to generate.
+   *
+   * \throws std::invalid_argument If the features cannot be computed.
    */
-  uint32_t get_feature_step() const;
+  Vector2i compute_output_dims(const ORUChar4Image *rgbImage, const ORFloatImage *depthImage) const;
 
   /**
-   * \brief Sets the step used when selecting keypoints and computing the features.
+   * \brief Gets the step used when selecting keypoints and computing the features.
    *
-   * \param featureStep The step used when selecting keypoints and computing the features.
+   * \return  The step used when selecting keypoints and computing the features.
    */
-  void set_feature_step(uint32_t featureStep);
+  uint32_t get_feature_step() const;
 
-  //#################### PROTECTED MEMBER FUNCTIONS ####################
-protected:
   /**
-   * \brief Computes the size of feature image to generate.
+   * \brief Makes an evaluator that can be used to compute individual features of the descriptors for an RGBD image on demand.
    *
-   * \note This also checks whether or not the input images needed to compute the desired features are available.
+   * \note  The per-pixel parameters of the evaluator (xyDepth, xyRgb) are left for the caller to fill in.
+   * \note  The evaluator refers to the images and to the feature calculator's offsets, so it must not outlive any of them.
    *
    * \param rgbImage    The colour image.
    * \param depthImage  The depth image.
-   * \return            The size of feature image to generate.
+   * \param memoryType  The type of memory (CPU or CUDA) on which the evaluator will be used.
+   * \return            The evaluator.
+   */
+  RGBDPatchFeatureEvaluator make_feature_evaluator(const ORUChar4Image *rgbImage, const ORFloatImage *depthImage, MemoryDeviceType memoryType) const;
+
+  /**
+   * \brief Sets the step used when selecting keypoints and computing the features.
    *
-   * \throws std::invalid_argument If the features cannot be computed.
+   * \param featureStep The step used when selecting keypoints and computing the features.
    */
-  Vector2i compute_output_dims(const ORUChar4Image *rgbImage, const ORFloatImage *depthImage) const;
+  void set_feature_step(uint32_t featureStep);
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
@@ -74,20 +74,6 @@ void RGBDPatchFeatureCalculator<KeypointType,DescriptorType>::compute_keypoints_
   compute_keypoints_and_features(rgbImage, depthImage, identity, intrinsics, keypointsImage, descriptorsImage);
 }
 
-template <typename KeypointType, typename DescriptorType>
-uint32_t RGBDPatchFeatureCalculator<KeypointType,DescriptorType>::get_feature_step() const
-{
-  return m_featureStep;
-}
-
-template <typename KeypointType, typename DescriptorType>
-void RGBDPatchFeatureCalculator<KeypointType,DescriptorType>::set_feature_step(uint32_t featureStep)
-{
-  m_featureStep = featureStep;
-}
-
-//#################### PROTECTED MEMBER FUNCTIONS ####################
-
 template <typename KeypointType, typename DescriptorType>
 Vector2i RGBDPatchFeatureCalculator<KeypointType,DescriptorType>::compute_output_dims(const ORUChar4Image *rgbImage, const ORFloatImage *depthImage) const
 {
@@ -119,6 +105,48 @@ Vector2i RGBDPatchFeatureCalculator<KeypointType,DescriptorType>::compute_output
   );
 }
 
+template <typename KeypointType, typename DescriptorType>
+uint32_t RGBDPatchFeatureCalculator<KeypointType,DescriptorType>::get_feature_step() const
+{
+  return m_featureStep;
+}
+
+template <typename KeypointType, typename DescriptorType>
+RGBDPatchFeatureEvaluator RGBDPatchFeatureCalculator<KeypointType,DescriptorType>::make_feature_evaluator(const ORUChar4Image *rgbImage, const ORFloatImage *depthImage,
+                                                                                                           MemoryDeviceType memoryType) const
+{
+  RGBDPatchFeatureEvaluator evaluator;
+
+  evaluator.depthDifferenceType = m_depthDifferenceType;
+  evaluator.depthFeatureCount = m_depthFeatureCount;
+  evaluator.depthFeatureOffset = m_depthFeatureOffset;
+  evaluator.depthOffsets = m_depthOffsets->GetData(memoryType);
+  evaluator.depths = depthImage ? depthImage->GetData(memoryType) : NULL;
+  evaluator.depthSize = depthImage ? depthImage->noDims : Vector2i(0, 0);
+  evaluator.depthOffsetRatio = compute_offset_ratio(evaluator.depthSize);
+  evaluator.normaliseDepth = m_normaliseDepth;
+
+  evaluator.normaliseRgb = m_normaliseRgb;
+  evaluator.rgb = rgbImage ? rgbImage->GetData(memoryType) : NULL;
+  evaluator.rgbChannels = m_rgbChannels->GetData(memoryType);
+  evaluator.rgbDifferenceType = m_rgbDifferenceType;
+  evaluator.rgbFeatureCount = m_rgbFeatureCount;
+  evaluator.rgbFeatureOffset = m_rgbFeatureOffset;
+  evaluator.rgbOffsets = m_rgbOffsets->GetData(memoryType);
+  evaluator.rgbSize = rgbImage ? rgbImage->noDims : Vector2i(0, 0);
+  evaluator.rgbOffsetRatio = compute_offset_ratio(evaluator.rgbSize);
+
+  evaluator.xyDepth = evaluator.xyRgb = Vector2i(0, 0);
+
+  return evaluator;
+}
+
+template <typename KeypointType, typename DescriptorType>
+void RGBDPatchFeatureCalculator<KeypointType,DescriptorType>::set_feature_step(uint32_t featureStep)
+{
+  m_featureStep = featureStep;
+}
+
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
 template <typename KeypointType, typename DescriptorType>
@@ -73,6 +73,115 @@ inline void calculate_secondary_points(const Vector2i& xyIn, const Vector4i& off
   raster2 = y2 * imgSize.width + x2;
 }
 
+/**
+ * \brief Computes the ratio between the size of the image we're currently using and the size of image used to train the forest.
+ *
+ * \note  We use this ratio to scale the feature offsets before sampling pixels.
+ *
+ * \param imgSize The size of the RGB or depth image (whichever is being used).
+ * \return        The ratio between the size of the image and the size of the training image.
+ */
+_CPU_AND_GPU_CODE_
+inline Vector2f compute_offset_ratio(const Vector2i& imgSize)
+{
+  // FIXME: The training image size should be passed in, not hard-coded.
+  const Vector2f trainImgSize(640.0f, 480.0f);
+  return Vector2f(imgSize.x / trainImgSize.x, imgSize.y / trainImgSize.y);
+}
+
+/**
+ * \brief Rescales the unnormalised offsets of the secondary point(s) used to compute a feature using the specified offset ratio.
+ *
+ * \param offsets     The offsets to rescale.
+ * \param offsetRatio The ratio between the size of the image we're currently using and the size of image used to train the forest.
+ * \return            The rescaled offsets.
+ */
+_CPU_AND_GPU_CODE_
+inline Vector4i rescale_offsets(const Vector4i& offsets, const Vector2f& offsetRatio)
+{
+  return Vector4i(
+    static_cast<int>(offsets[0] * offsetRatio.x),
+    static_cast<int>(offsets[1] * offsetRatio.y),
+    static_cast<int>(offsets[2] * offsetRatio.x),
+    static_cast<int>(offsets[3] * offsetRatio.y)
+  );
+}
+
+/**
+ * \brief Computes a single colour feature for a pixel in the RGBD image.
+ *
+ * \param xyRgb       The coordinates of the pixel in the colour image.
+ * \param rgbSize     The size of the colour image.
+ * \param rgb         A pointer to the colour image.
+ * \param offsets     The (unnormalised, but already rescaled) offsets needed to specify the colour feature to be computed.
+ * \param channel     The colour channel needed to specify the colour feature to be computed.
+ * \param normalise   Whether or not to normalise the RGB offsets by the pixel's depth value.
+ * \param depth       The pixel's depth value (or 1 if no depth is available).
+ * \return            The value of the colour feature.
+ */
+template <RGBDPatchFeatureDifferenceType DifferenceType>
+_CPU_AND_GPU_CODE_TEMPLATE_
+inline float compute_colour_feature(const Vector2i& xyRgb, const Vector2i& rgbSize, const Vector4u *rgb, const Vector4i& offsets,
+                                    int channel, bool normalise, float depth)
+{
+  // Calculate the raster position(s) of the secondary point(s) to use when computing the feature.
+  int raster1, raster2;
+  calculate_secondary_points<DifferenceType>(xyRgb, offsets, rgbSize, normalise, depth, raster1, raster2);
+
+  // Compute the feature.
+  if(DifferenceType == PAIRWISE_DIFFERENCE)
+  {
+    // This is the "correct" definition, but the SCoRe Forests code uses the other one.
+    return static_cast<float>(rgb[raster1][channel] - rgb[raster2][channel]);
+  }
+  else
+  {
+    // This is the definition used in the SCoRe Forests code.
+    const int rasterIdxRgb = xyRgb.y * rgbSize.width + xyRgb.x;
+    return static_cast<float>(rgb[raster1][channel] - rgb[rasterIdxRgb][channel]);
+  }
+}
+
+/**
+ * \brief Computes a single depth feature for a pixel in the RGBD image.
+ *
+ * \param xyDepth     The coordinates of the pixel in the depth image.
+ * \param depthSize   The size of the depth image.
+ * \param depths      A pointer to the depth image.
+ * \param offsets     The (unnormalised, but already rescaled) offsets needed to specify the depth feature to be computed.
+ * \param normalise   Whether or not to normalise the depth offsets by the pixel's depth value.
+ * \param depth       The pixel's depth value.
+ * \return            The value of the depth feature.
+ */
+template <RGBDPatchFeatureDifferenceType DifferenceType>
+_CPU_AND_GPU_CODE_TEMPLATE_
+inline float compute_depth_feature(const Vector2i& xyDepth, const Vector2i& depthSize, const float *depths, const Vector4i& offsets,
+                                   bool normalise, float depth)
+{
+  // Calculate the raster position(s) of the secondary point(s) to use when computing the feature.
+  int raster1, raster2;
+  calculate_secondary_points<DifferenceType>(xyDepth, offsets, depthSize, normalise, depth, raster1, raster2);
+
+  // Convert the depth of the first secondary point to millimetres.
+  const float depth1Mm = fmaxf(depths[raster1] * 1000.f, 0.0f);  // we use max because InfiniTAM sometimes has invalid depths stored as -1
+
+  // Compute the feature.
+  if(DifferenceType == PAIRWISE_DIFFERENCE)
+  {
+    // This is the "correct" definition, but the SCoRe Forests code uses the other one.
+    const float depth2Mm = fmaxf(depths[raster2] * 1000.0f, 0.0f);
+    return depth1Mm - depth2Mm;
+  }
+  else
+  {
+    // Convert the depth of the central point to millimetres.
+    const float depthMm = depth * 1000.0f;
+
+    // This is the definition used in the SCoRe Forests code.
+    return depth1Mm - depthMm;
+  }
+}
+
 /**
  * \brief Computes colour features for a pixel in the RGBD image and writes them into the relevant descriptor.
  *
@@ -115,39 +224,14 @@ inline void compute_colour_features(const Vector2i& xyDepth, const Vector2i& xyR
 
   // Compute the ratio between the size of colour image we're currently using and the size of colour
   // image used to train the forest. We use this to scale the offsets before sampling pixels.
-  // FIXME: The RGB training image size should be passed in, not hard-coded.
-  const Vector2f trainRgbSize(640.0f, 480.0f);
-  const Vector2f offsetRatio(rgbSize.x / trainRgbSize.x, rgbSize.y / trainRgbSize.y);
+  const Vector2f offsetRatio = compute_offset_ratio(rgbSize);
 
   // Compute the features and fill in the descriptor.
   DescriptorType& descriptor = descriptors[rasterIdxOut];
-  const int rasterIdxRgb = xyRgb.y * rgbSize.width + xyRgb.x;
   for(uint32_t featIdx = 0; featIdx < rgbFeatureCount; ++featIdx)
   {
-    const int channel = rgbChannels[featIdx];
-    Vector4i offsets = rgbOffsets[featIdx];
-
-    // Rescale the offsets using the offset ratio.
-    offsets[0] = static_cast<int>(offsets[0] * offsetRatio.x);
-    offsets[1] = static_cast<int>(offsets[1] * offsetRatio.y);
-    offsets[2] = static_cast<int>(offsets[2] * offsetRatio.x);
-    offsets[3] = static_cast<int>(offsets[3] * offsetRatio.y);
-
-    // Calculate the raster position(s) of the secondary point(s) to use when computing the feature.
-    int raster1, raster2;
-    calculate_secondary_points<DifferenceType>(xyRgb, offsets, rgbSize, normalise, depth, raster1, raster2);
-
-    // Compute the feature and write it into the descriptor.
-    if(DifferenceType == PAIRWISE_DIFFERENCE)
-    {
-      // This is the "correct" definition, but the SCoRe Forests code uses the other one.
-      descriptor.data[rgbFeatureOffset + featIdx] = static_cast<float>(rgb[raster1][channel] - rgb[raster2][channel]);
-    }
-    else
-    {
-      // This is the definition used in the SCoRe Forests code.
-      descriptor.data[rgbFeatureOffset + featIdx] = static_cast<float>(rgb[raster1][channel] - rgb[rasterIdxRgb][channel]);
-    }
+    const Vector4i offsets = rescale_offsets(rgbOffsets[featIdx], offsetRatio);
+    descriptor.data[rgbFeatureOffset + featIdx] = compute_colour_feature<DifferenceType>(xyRgb, rgbSize, rgb, offsets, rgbChannels[featIdx], normalise, depth);
   }
 }
 
@@ -182,46 +266,121 @@ inline void compute_depth_features(const Vector2i& xyDepth, const Vector2i& xyOu
 
   // Compute the ratio between the size of depth image we're currently using and the size of depth
   // image used to train the forest. We use this to scale the offsets before sampling pixels.
-  // FIXME: The depth training image size should be passed in, not hard-coded.
-  const Vector2f trainDepthSize(640.0f, 480.0f);
-  const Vector2f offsetRatio(depthSize.x / trainDepthSize.x, depthSize.y / trainDepthSize.y);
+  const Vector2f offsetRatio = compute_offset_ratio(depthSize);
 
   // Compute the features and fill in the descriptor.
   DescriptorType& descriptor = descriptors[rasterIdxOut];
   for(uint32_t featIdx = 0; featIdx < depthFeatureCount; ++featIdx)
   {
-    Vector4i offsets = depthOffsets[featIdx];
+    const Vector4i offsets = rescale_offsets(depthOffsets[featIdx], offsetRatio);
+    descriptor.data[depthFeatureOffset + featIdx] = compute_depth_feature<DifferenceType>(xyDepth, depthSize, depths, offsets, normalise, depth);
+  }
+}
 
-    // Rescale the offsets using the offset ratio.
-    offsets[0] = static_cast<int>(offsets[0] * offsetRatio.x);
-    offsets[1] = static_cast<int>(offsets[1] * offsetRatio.y);
-    offsets[2] = static_cast<int>(offsets[2] * offsetRatio.x);
-    offsets[3] = static_cast<int>(offsets[3] * offsetRatio.y);
+/**
+ * \brief An instance of this struct can be used to compute individual features of a pixel's RGBD patch descriptor on demand.
+ *
+ * This makes it possible to evaluate only those features that are actually needed (e.g. the ones tested by the branch nodes
+ * visited when passing the pixel down a decision forest), rather than always computing the entire descriptor up-front.
+ * The features computed are identical to the ones written into the descriptor by compute_depth_features/compute_colour_features.
+ *
+ * \note  The per-calculator parameters are typically filled in by RGBDPatchFeatureCalculator::make_feature_evaluator, after which
+ *        the per-pixel parameters (xyDepth, xyRgb) should be set for each pixel whose features are to be computed. The pixel's
+ *        keypoint must be valid (i.e. it must have a valid depth) if any depth features, or any depth-normalised features, are needed.
+ */
+struct RGBDPatchFeatureEvaluator
+{
+  //#################### PUBLIC VARIABLES ####################
 
-    // Calculate the raster position(s) of the secondary point(s) to use when computing the feature.
-    int raster1, raster2;
-    calculate_secondary_points<DifferenceType>(xyDepth, offsets, depthSize, normalise, depth, raster1, raster2);
+  /** The type of difference to use to compute depth features. */
+  RGBDPatchFeatureDifferenceType depthDifferenceType;
 
-    // Convert the depth of the first secondary point to millimetres.
-    const float depth1Mm = fmaxf(depths[raster1] * 1000.f, 0.0f);  // we use max because InfiniTAM sometimes has invalid depths stored as -1
+  /** The number of features to compute from the depth image. */
+  uint32_t depthFeatureCount;
 
-    // Compute the feature and write it into the descriptor.
-    if(DifferenceType == PAIRWISE_DIFFERENCE)
+  /** The offset in the descriptor after which the depth features are stored. */
+  uint32_t depthFeatureOffset;
+
+  /** The offsets used to sample the depth values used in the descriptor. */
+  const Vector4i *depthOffsets;
+
+  /** The ratio used to rescale the depth offsets for the size of the depth image. */
+  Vector2f depthOffsetRatio;
+
+  /** A pointer to the depth image (may be NULL). */
+  const float *depths;
+
+  /** The size of the depth image. */
+  Vector2i depthSize;
+
+  /** Whether or not to normalise depth offsets by the depth associated with the pixel. */
+  bool normaliseDepth;
+
+  /** Whether or not to normalise RGB offsets by the depth associated with the pixel. */
+  bool normaliseRgb;
+
+  /** A pointer to the colour image (may be NULL). */
+  const Vector4u *rgb;
+
+  /** The colour channels associated with the RGB part of the descriptor. */
+  const uchar *rgbChannels;
+
+  /** The type of difference to use to compute RGB features. */
+  RGBDPatchFeatureDifferenceType rgbDifferenceType;
+
+  /** The number of features to compute from the RGB image. */
+  uint32_t rgbFeatureCount;
+
+  /** The offset in the descriptor after which the RGB features are stored. */
+  uint32_t rgbFeatureOffset;
+
+  /** The offsets used to sample the colour pixels used in the descriptor. */
+  const Vector4i *rgbOffsets;
+
+  /** The ratio used to rescale the colour offsets for the size of the colour image. */
+  Vector2f rgbOffsetRatio;
+
+  /** The size of the colour image. */
+  Vector2i rgbSize;
+
+  /** The coordinates of the pixel whose features are to be computed in the depth image. */
+  Vector2i xyDepth;
+
+  /** The coordinates of the pixel whose features are to be computed in the colour image. */
+  Vector2i xyRgb;
+
+  //#################### PUBLIC OPERATORS ####################
+
+  /**
+   * \brief Computes the specified feature of the current pixel's descriptor.
+   *
+   * \param featureIdx  The index of the feature in the descriptor.
+   * \return            The value of the feature, or 0 if the feature is not one that would be computed by the feature calculator.
+   */
+  _CPU_AND_GPU_CODE_
+  inline float operator()(uint32_t featureIdx) const
+  {
+    if(depths && featureIdx >= depthFeatureOffset && featureIdx < depthFeatureOffset + depthFeatureCount)
     {
-      // This is the "correct" definition, but the SCoRe Forests code uses the other one.
-      const float depth2Mm = fmaxf(depths[raster2] * 1000.0f, 0.0f);
-      descriptor.data[depthFeatureOffset + featIdx] = depth1Mm - depth2Mm;
+      const float depth = depths[xyDepth.y * depthSize.width + xyDepth.x];
+      const Vector4i offsets = rescale_offsets(depthOffsets[featureIdx - depthFeatureOffset], depthOffsetRatio);
+      return depthDifferenceType == PAIRWISE_DIFFERENCE
+        ? compute_depth_feature<PAIRWISE_DIFFERENCE>(xyDepth, depthSize, depths, offsets, normaliseDepth, depth)
+        : compute_depth_feature<CENTRAL_DIFFERENCE>(xyDepth, depthSize, depths, offsets, normaliseDepth, depth);
     }
-    else
+    else if(rgb && featureIdx >= rgbFeatureOffset && featureIdx < rgbFeatureOffset + rgbFeatureCount)
     {
-      // Convert the depth of the central point to millimetres.
-      const float depthMm = depth * 1000.0f;
-
-      // This is the definition used in the SCoRe Forests code.
-      descriptor.data[depthFeatureOffset + featIdx] = depth1Mm - depthMm;
+      const float depth = normaliseRgb && depths ? depths[xyDepth.y * depthSize.width + xyDepth.x] : 1.0f;
+      const uint32_t rgbFeatureIdx = featureIdx - rgbFeatureOffset;
+      const Vector4i offsets = rescale_offsets(rgbOffsets[rgbFeatureIdx], rgbOffsetRatio);
+      const int channel = rgbChannels[rgbFeatureIdx];
+      return rgbDifferenceType == PAIRWISE_DIFFERENCE
+        ? compute_colour_feature<PAIRWISE_DIFFERENCE>(xyRgb, rgbSize, rgb, offsets, channel, normaliseRgb, depth)
+        : compute_colour_feature<CENTRAL_DIFFERENCE>(xyRgb, rgbSize, rgb, offsets, channel, normaliseRgb, depth);
     }
+    else return 0.0f;
   }
-}
+};
 
 /**
  * \brief Computes a keypoint for the specified pixel in the RGBD image.
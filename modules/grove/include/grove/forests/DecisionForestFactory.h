@@ -34,11 +34,12 @@ struct DecisionForestFactory
    *
    * \param filename   The path to the file containing the forest.
    * \param deviceType The device on which the decision forest should operate.
+   * \param branchFree Whether or not to evaluate the forest using the branch-free evaluator (see BranchFreeDecisionForest_CPU) when on the CPU.
    * \return           The constructed forest.
    *
    * \throws std::runtime_error If the forest cannot be loaded.
    */
-  static Forest_Ptr make_forest(const std::string& filename, ORUtils::DeviceType deviceType);
+  static Forest_Ptr make_forest(const std::string& filename, ORUtils::DeviceType deviceType, bool branchFree = false);
 
 #ifdef WITH_SCOREFORESTS
   /**
@@ -46,11 +47,12 @@ struct DecisionForestFactory
    *
    * \param pretrainedForest  The pre-trained forest to convert.
    * \param deviceType        The device on which the decision forest should operate.
+   * \param branchFree        Whether or not to evaluate the forest using the branch-free evaluator (see BranchFreeDecisionForest_CPU) when on the CPU.
    * \return                  The constructed forest.
    *
    * \throws std::runtime_error If the forest cannot be converted.
    */
-  static Forest_Ptr make_forest(const EnsembleLearner& pretrainedForest, ORUtils::DeviceType deviceType);
+  static Forest_Ptr make_forest(const EnsembleLearner& pretrainedForest, ORUtils::DeviceType deviceType, bool branchFree = false);
 #endif
 
   /**
@@ -58,11 +60,12 @@ struct DecisionForestFactory
    *
    * \param settings   The settings to use to create the forest.
    * \param deviceType The device on which the decision forest should operate.
+   * \param branchFree Whether or not to evaluate the forest using the branch-free evaluator (see BranchFreeDecisionForest_CPU) when on the CPU.
    * \return           The constructed forest.
    *
    * \throws std::runtime_error If the forest cannot be created.
    */
-  static Forest_Ptr make_randomly_generated_forest(const tvgutil::SettingsContainer_CPtr& settings, ORUtils::DeviceType deviceType);
+  static Forest_Ptr make_randomly_generated_forest(const tvgutil::SettingsContainer_CPtr& settings, ORUtils::DeviceType deviceType, bool branchFree = false);
 };
 
 }
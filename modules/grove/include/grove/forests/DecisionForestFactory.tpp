@@ -5,6 +5,7 @@
 
 #include "DecisionForestFactory.h"
 
+#include "cpu/BranchFreeDecisionForest_CPU.h"
 #include "cpu/DecisionForest_CPU.h"
 
 #ifdef WITH_CUDA
@@ -17,7 +18,7 @@ namespace grove {
 
 template <typename DescriptorType, int TreeCount>
 typename DecisionForestFactory<DescriptorType,TreeCount>::Forest_Ptr
-DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const std::string& filename, ORUtils::DeviceType deviceType)
+DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const std::string& filename, ORUtils::DeviceType deviceType, bool branchFree)
 {
   Forest_Ptr forest;
 
@@ -29,6 +30,10 @@ DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const std::string&
     throw std::runtime_error("Error: CUDA support not currently available. Reconfigure in CMake with the WITH_CUDA option set to on.");
 #endif
   }
+  else if(branchFree)
+  {
+    forest.reset(new BranchFreeDecisionForest_CPU<DescriptorType,TreeCount>(filename));
+  }
   else
   {
     forest.reset(new DecisionForest_CPU<DescriptorType,TreeCount>(filename));
@@ -40,7 +45,7 @@ DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const std::string&
 #ifdef WITH_SCOREFORESTS
 template <typename DescriptorType, int TreeCount>
 typename DecisionForestFactory<DescriptorType,TreeCount>::Forest_Ptr
-DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const EnsembleLearner& pretrainedForest, ORUtils::DeviceType deviceType)
+DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const EnsembleLearner& pretrainedForest, ORUtils::DeviceType deviceType, bool branchFree)
 {
   Forest_Ptr forest;
 
@@ -52,6 +57,10 @@ DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const EnsembleLearn
     throw std::runtime_error("Error: CUDA support not currently available. Reconfigure in CMake with the WITH_CUDA option set to on.");
 #endif
   }
+  else if(branchFree)
+  {
+    forest.reset(new BranchFreeDecisionForest_CPU<DescriptorType,TreeCount>(pretrainedForest));
+  }
   else
   {
     forest.reset(new DecisionForest_CPU<DescriptorType,TreeCount>(pretrainedForest));
@@ -63,7 +72,7 @@ DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const EnsembleLearn
 
 template <typename DescriptorType, int TreeCount>
 typename DecisionForestFactory<DescriptorType,TreeCount>::Forest_Ptr
-DecisionForestFactory<DescriptorType,TreeCount>::make_randomly_generated_forest(const tvgutil::SettingsContainer_CPtr& settings, ORUtils::DeviceType deviceType)
+DecisionForestFactory<DescriptorType,TreeCount>::make_randomly_generated_forest(const tvgutil::SettingsContainer_CPtr& settings, ORUtils::DeviceType deviceType, bool branchFree)
 {
   Forest_Ptr forest;
 
@@ -75,6 +84,10 @@ DecisionForestFactory<DescriptorType,TreeCount>::make_randomly_generated_forest(
     throw std::runtime_error("Error: CUDA support not currently available. Reconfigure in CMake with the WITH_CUDA option set to on.");
 #endif
   }
+  else if(branchFree)
+  {
+    forest.reset(new BranchFreeDecisionForest_CPU<DescriptorType,TreeCount>(settings));
+  }
   else
   {
     forest.reset(new DecisionForest_CPU<DescriptorType,TreeCount>(settings));
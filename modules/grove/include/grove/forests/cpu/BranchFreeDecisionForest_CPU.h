@@ -0,0 +1,128 @@
+/**
+ * grove: BranchFreeDecisionForest_CPU.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_GROVE_BRANCHFREEDECISIONFOREST_CPU
+#define H_GROVE_BRANCHFREEDECISIONFOREST_CPU
+
+#include "../interface/DecisionForest.h"
+
+namespace grove {
+
+/**
+ * \brief An instance of this class represents a binary decision forest composed of a fixed number of trees, which is evaluated
+ *        on the CPU without any data-dependent branches.
+ *
+ * When the forest is constructed, each tree is copied into a compact, breadth-first layout in which every leaf is made to point
+ * back to itself and to test a feature against an infinite threshold. A descriptor can then be routed through a tree by taking
+ * exactly as many steps as the depth of the tree, without ever checking whether it has reached a leaf. Blocks of descriptors are
+ * routed through each tree in lockstep, so that the memory accesses for the different descriptors can be overlapped.
+ *
+ * \note  The leaf indices produced are identical to those produced by DecisionForest_CPU.
+ *
+ * \tparam DescriptorType The type of descriptor used to find the leaves. Must have a floating-point member array named "data".
+ * \tparam TreeCount      The number of trees in the forest. Fixed at compilation time to allow the definition of a data type
+ *                        representing the leaf indices.
+ */
+template <typename DescriptorType, int TreeCount>
+class BranchFreeDecisionForest_CPU : public DecisionForest<DescriptorType,TreeCount>
+{
+  //#################### TYPEDEFS AND USINGS ####################
+public:
+  typedef DecisionForest<DescriptorType,TreeCount> Base;
+
+  using Base::TREE_COUNT;
+  using typename Base::DescriptorImage;
+  using typename Base::DescriptorImage_Ptr;
+  using typename Base::DescriptorImage_CPtr;
+  using typename Base::LeafIndices;
+  using typename Base::LeafIndicesImage;
+  using typename Base::LeafIndicesImage_Ptr;
+  using typename Base::LeafIndicesImage_CPtr;
+  using typename Base::NodeEntry;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct represents a single node in the compact layout of a tree.
+   */
+  struct FlatNode
+  {
+    /** The threshold against which to compare the feature (+infinity for a leaf, so that we always stay at the leaf). */
+    float featureThreshold;
+
+    /** The index of the feature in a feature descriptor that should be compared to the threshold. */
+    uint32_t featureIdx;
+
+    /** The index (within the compact layout of the tree) of the node's left child, or of the node itself if it's a leaf. */
+    uint32_t leftChildIdx;
+  };
+
+  //#################### CONSTANTS ####################
+private:
+  /** The number of descriptors that are routed through each tree in lockstep. */
+  enum { BLOCK_SIZE = 16 };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The nodes of all of the trees, stored in a compact, breadth-first layout (the nodes of tree i start at m_treeOffsets[i]). */
+  std::vector<FlatNode> m_flatNodes;
+
+  /** The leaf index associated with each node in m_flatNodes (or -1 for a branch node). */
+  std::vector<int> m_flatLeafIndices;
+
+  /** The maximum depth of each tree (i.e. the number of steps needed to route a descriptor from the root to a leaf). */
+  std::vector<uint32_t> m_treeDepths;
+
+  /** The offset of the first node of each tree in m_flatNodes. */
+  std::vector<uint32_t> m_treeOffsets;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Loads the branching structure of a pre-trained decision forest from a file on disk.
+   *
+   * \param filename The path to the file containing the forest.
+   *
+   * \throws std::runtime_error If the forest cannot be loaded.
+   */
+  explicit BranchFreeDecisionForest_CPU(const std::string& filename);
+
+  /**
+   * \brief Constructs a balanced decision forest with random split functions, using parameters specified by the user.
+   *
+   * \param settings  The settings to use to create the forest.
+   */
+  explicit BranchFreeDecisionForest_CPU(const tvgutil::SettingsContainer_CPtr& settings);
+
+#ifdef WITH_SCOREFORESTS
+  /**
+   * \brief Constructs a decision forest by converting an EnsembleLearner that was pre-trained using ScoreForests.
+   *
+   * \param pretrainedForest The pre-trained forest to convert.
+   *
+   * \throws std::runtime_error If the pre-trained forest cannot be converted.
+   */
+  explicit BranchFreeDecisionForest_CPU(const EnsembleLearner& pretrainedForest);
+#endif
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual void find_leaves(const DescriptorImage_CPtr& descriptors, LeafIndicesImage_Ptr& leafIndices) const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Copies the trees in the node image into the compact, breadth-first layout used for evaluation.
+   */
+  void build_flat_layout();
+
+  /** Override */
+  virtual void load_structure_sub();
+};
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * grove: BranchFreeDecisionForest_CPU.tpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "BranchFreeDecisionForest_CPU.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace grove {
+
+//#################### CONSTRUCTORS ####################
+
+template <typename DescriptorType, int TreeCount>
+BranchFreeDecisionForest_CPU<DescriptorType,TreeCount>::BranchFreeDecisionForest_CPU(const std::string& filename)
+: Base(filename)
+{
+  build_flat_layout();
+}
+
+template <typename DescriptorType, int TreeCount>
+BranchFreeDecisionForest_CPU<DescriptorType,TreeCount>::BranchFreeDecisionForest_CPU(const tvgutil::SettingsContainer_CPtr& settings)
+: Base(settings)
+{
+  build_flat_layout();
+}
+
+#ifdef WITH_SCOREFORESTS
+template <typename DescriptorType, int TreeCount>
+BranchFreeDecisionForest_CPU<DescriptorType,TreeCount>::BranchFreeDecisionForest_CPU(const EnsembleLearner& pretrainedForest)
+: Base(pretrainedForest)
+{
+  build_flat_layout();
+}
+#endif
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+template <typename DescriptorType, int TreeCount>
+void BranchFreeDecisionForest_CPU<DescriptorType,TreeCount>::find_leaves(const DescriptorImage_CPtr& descriptors, LeafIndicesImage_Ptr& leafIndices) const
+{
+  // Ensure that the leaf indices image is the same size as the descriptors image.
+  const Vector2i imgSize = descriptors->noDims;
+  leafIndices->ChangeDims(imgSize);
+
+  const DescriptorType *descriptorsPtr = descriptors->GetData(MEMORYDEVICE_CPU);
+  const FlatNode *flatNodes = &m_flatNodes[0];
+  const int *flatLeafIndices = &m_flatLeafIndices[0];
+  LeafIndices *leafIndicesPtr = leafIndices->GetData(MEMORYDEVICE_CPU);
+
+  const int descriptorCount = imgSize.x * imgSize.y;
+  const int blockCount = (descriptorCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  // For each block of descriptors in the descriptors image:
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int blockIdx = 0; blockIdx < blockCount; ++blockIdx)
+  {
+    const int blockStart = blockIdx * BLOCK_SIZE;
+    const int blockSize = std::min<int>(BLOCK_SIZE, descriptorCount - blockStart);
+    const DescriptorType *blockDescriptors = descriptorsPtr + blockStart;
+
+    // For each tree in the forest:
+    for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+    {
+      // Route all of the descriptors in the block from the root of the tree to the leaves in lockstep. Since the leaves
+      // point back to themselves, we can simply take as many steps as the depth of the tree without checking for leaves.
+      uint32_t nodeIndices[BLOCK_SIZE];
+      std::fill(nodeIndices, nodeIndices + blockSize, m_treeOffsets[treeIdx]);
+
+      for(uint32_t step = 0, depth = m_treeDepths[treeIdx]; step < depth; ++step)
+      {
+        for(int i = 0; i < blockSize; ++i)
+        {
+          const FlatNode& node = flatNodes[nodeIndices[i]];
+          nodeIndices[i] = node.leftChildIdx + static_cast<uint32_t>(blockDescriptors[i].data[node.featureIdx] > node.featureThreshold);
+        }
+      }
+
+      // Write the indices of the leaves that have been reached into the leaf indices image.
+      for(int i = 0; i < blockSize; ++i)
+      {
+        leafIndicesPtr[blockStart + i][treeIdx] = flatLeafIndices[nodeIndices[i]];
+      }
+    }
+  }
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+template <typename DescriptorType, int TreeCount>
+void BranchFreeDecisionForest_CPU<DescriptorType,TreeCount>::build_flat_layout()
+{
+  const NodeEntry *nodeImage = this->m_nodeImage->GetData(MEMORYDEVICE_CPU);
+
+  m_flatNodes.clear();
+  m_flatLeafIndices.clear();
+  m_treeDepths.clear();
+  m_treeOffsets.clear();
+
+  for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+  {
+    const uint32_t treeOffset = static_cast<uint32_t>(m_flatNodes.size());
+    m_treeOffsets.push_back(treeOffset);
+
+    // Visit the nodes of the tree in breadth-first order, copying each node into the compact layout. Note that the children of each
+    // branch node are added to the queue consecutively, so the right child is always stored immediately after the left child.
+    std::vector<uint32_t> queue(1, 0);
+    std::vector<uint32_t> nodeDepths(1, 0);
+    uint32_t treeDepth = 0;
+
+    for(size_t i = 0; i < queue.size(); ++i)
+    {
+      const NodeEntry& node = nodeImage[queue[i] * TREE_COUNT + treeIdx];
+      const uint32_t flatNodeIdx = treeOffset + static_cast<uint32_t>(i);
+
+      FlatNode flatNode;
+      if(node.leafIdx >= 0)
+      {
+        // A leaf points back to itself, and compares feature 0 against +infinity so that it never descends to the "right child".
+        flatNode.featureThreshold = std::numeric_limits<float>::infinity();
+        flatNode.featureIdx = 0;
+        flatNode.leftChildIdx = flatNodeIdx;
+        treeDepth = std::max(treeDepth, nodeDepths[i]);
+      }
+      else
+      {
+        flatNode.featureThreshold = node.featureThreshold;
+        flatNode.featureIdx = node.featureIdx;
+        flatNode.leftChildIdx = treeOffset + static_cast<uint32_t>(queue.size());
+
+        queue.push_back(node.leftChildIdx);
+        queue.push_back(node.leftChildIdx + 1);
+        nodeDepths.push_back(nodeDepths[i] + 1);
+        nodeDepths.push_back(nodeDepths[i] + 1);
+      }
+
+      m_flatNodes.push_back(flatNode);
+      m_flatLeafIndices.push_back(node.leafIdx);
+    }
+
+    m_treeDepths.push_back(treeDepth);
+  }
+}
+
+template <typename DescriptorType, int TreeCount>
+void BranchFreeDecisionForest_CPU<DescriptorType,TreeCount>::load_structure_sub()
+{
+  // The structure of the forest has changed, so the compact layout must be rebuilt.
+  build_flat_layout();
+}
+
+}
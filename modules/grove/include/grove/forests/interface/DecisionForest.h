@@ -22,6 +22,13 @@ class Learner;
 class PredictionGaussianMean;
 #endif
 
+namespace orx {
+
+class BinaryModelReader;
+class BinaryModelWriter;
+
+}
+
 namespace grove {
 
 /**
@@ -83,9 +90,9 @@ public:
   typedef ORUtils::Image<LeafIndices> LeafIndicesImage;
   typedef boost::shared_ptr<LeafIndicesImage> LeafIndicesImage_Ptr;
   typedef boost::shared_ptr<const LeafIndicesImage> LeafIndicesImage_CPtr;
-private:
   typedef ORUtils::Image<NodeEntry> NodeImage;
   typedef boost::shared_ptr<ORUtils::Image<NodeEntry> > NodeImage_Ptr;
+  typedef boost::shared_ptr<const ORUtils::Image<NodeEntry> > NodeImage_CPtr;
 
   //#################### PROTECTED MEMBER VARIABLES ####################
 protected:
@@ -191,6 +198,16 @@ public:
    */
   uint32_t get_nb_trees() const;
 
+  /**
+   * \brief Gets the image storing the indexing structure of the forest.
+   *
+   * \note  This can be used to evaluate the forest without first computing the full descriptor for each pixel
+   *        (see compute_leaf_indices_on_demand in DecisionForest_Shared.h).
+   *
+   * \return The image storing the indexing structure of the forest.
+   */
+  NodeImage_CPtr get_node_image() const;
+
   /**
    * \brief Loads the branching structure of a pre-trained decision forest from a file on disk.
    *
@@ -214,6 +231,15 @@ public:
    */
   void load_structure_from_file(const std::string& filename);
 
+  /**
+   * \brief Loads the branching structure of a pre-trained decision forest from a binary model file.
+   *
+   * \param reader  The reader for the binary model file containing the forest.
+   *
+   * \throws std::runtime_error If the forest cannot be loaded.
+   */
+  void load_structure_from_model(const orx::BinaryModelReader& reader);
+
   /**
    * \brief Saves the branching structure of the decision forest to a file on disk.
    *
@@ -223,6 +249,18 @@ public:
    */
   void save_structure_to_file(const std::string& filename) const;
 
+  /**
+   * \brief Saves the branching structure of the decision forest to a binary model file.
+   *
+   * \note The structure is stored in two chunks: "forestShape" (nbTrees, the height of the node image, the number of nodes
+   *       in each tree and the number of leaves in each tree, as uint32_t) and "forestNodes" (the raw node image).
+   *
+   * \param writer  The writer for the binary model file into which to save the forest.
+   *
+   * \throws std::runtime_error If the forest cannot be saved.
+   */
+  void save_structure_to_model(orx::BinaryModelWriter& writer) const;
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
 #ifdef WITH_SCOREFORESTS
@@ -261,6 +299,15 @@ private:
    */
   int create_node(uint32_t treeIdx, uint32_t nbTrees, uint32_t depthLeft, uint32_t outputIdx,
                   uint32_t outputFirstFreeIdx, NodeEntry *outputNodes, uint32_t& outputNbLeaves);
+
+  /**
+   * \brief An overridable hook function that is called at the end of load_structure_from_file and load_structure_from_model
+   *        to allow subclasses to update any state they derive from the structure of the forest.
+   *
+   * \note  When the structure is loaded by a constructor, this resolves to the (empty) base implementation, since subclasses
+   *        are not yet constructed at that point. Subclasses must thus also update their derived state in their constructors.
+   */
+  virtual void load_structure_sub();
 };
 
 }
@@ -14,6 +14,8 @@
 #endif
 
 #include <orx/base/MemoryBlockFactory.h>
+#include <orx/persistence/BinaryModelReader.h>
+#include <orx/persistence/BinaryModelWriter.h>
 
 #include <tvgutil/numbers/RandomNumberGenerator.h>
 
@@ -69,7 +71,7 @@ DecisionForest<DescriptorType,TreeCount>::DecisionForest(const tvgutil::Settings
 
   // Allocate node texture.
   const orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
-  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(TREE_COUNT, nbNodesPerTree));
+  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(TREE_COUNT, nbNodesPerTree), "forest");
   m_nodeImage->Clear();
 
   uint32_t currentLeafIdx = 0;
@@ -143,7 +145,7 @@ DecisionForest<DescriptorType,TreeCount>::DecisionForest(const EnsembleLearner&
 
   // Allocate the texture to store the nodes.
   const orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
-  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes));
+  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes), "forest");
   m_nodeImage->Clear();
 
   // Fill the nodes.
@@ -218,6 +220,12 @@ uint32_t DecisionForest<DescriptorType,TreeCount>::get_nb_trees() const
   return TREE_COUNT;
 }
 
+template <typename DescriptorType, int TreeCount>
+typename DecisionForest<DescriptorType,TreeCount>::NodeImage_CPtr DecisionForest<DescriptorType,TreeCount>::get_node_image() const
+{
+  return m_nodeImage;
+}
+
 template <typename DescriptorType, int TreeCount>
 void DecisionForest<DescriptorType,TreeCount>::load_structure_from_file(const std::string& filename)
 {
@@ -268,7 +276,7 @@ void DecisionForest<DescriptorType,TreeCount>::load_structure_from_file(const st
 
   // Allocate and clear the node image.
   const orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
-  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes));
+  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes), "forest");
   m_nodeImage->Clear();
 
 #if RANDOM_FEATURES
@@ -332,6 +340,53 @@ void DecisionForest<DescriptorType,TreeCount>::load_structure_from_file(const st
 
   // Ensure that the node image is available on the GPU (if we're using it).
   m_nodeImage->UpdateDeviceFromHost();
+
+  // Call the overridable hook function to allow subclasses to update any derived state.
+  load_structure_sub();
+}
+
+template <typename DescriptorType, int TreeCount>
+void DecisionForest<DescriptorType,TreeCount>::load_structure_from_model(const orx::BinaryModelReader& reader)
+{
+  // Read the shape of the forest, and check that the number of trees is the same as the template instantiation.
+  const std::vector<uint32_t> shape = reader.read_vector<uint32_t>("forestShape");
+  const uint32_t nbTrees = get_nb_trees();
+  if(shape.size() != 2 + 2 * nbTrees || shape[0] != nbTrees)
+  {
+    throw std::runtime_error(
+      "Number of trees of the loaded forest is incorrect. Should be " +
+      boost::lexical_cast<std::string>(nbTrees) + " - Read: " +
+      boost::lexical_cast<std::string>(shape.empty() ? 0 : shape[0])
+    );
+  }
+
+  const uint32_t maxNbNodes = shape[1];
+  std::vector<uint32_t> nbNodesPerTree(shape.begin() + 2, shape.begin() + 2 + nbTrees);
+  std::vector<uint32_t> nbLeavesPerTree(shape.begin() + 2 + nbTrees, shape.end());
+
+  uint32_t nbTotalLeaves = 0;
+  for(uint32_t i = 0; i < nbTrees; ++i)
+  {
+    if(nbNodesPerTree[i] > maxNbNodes) throw std::runtime_error("Error reading the dimensions of tree: " + boost::lexical_cast<std::string>(i));
+    nbTotalLeaves += nbLeavesPerTree[i];
+  }
+
+  // Copy the nodes straight out of the mapped file into a new node image.
+  const orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
+  NodeImage_Ptr nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes), "forest");
+  reader.read_block("forestNodes", *nodeImage);
+
+  // Replace the current forest.
+  m_nodeImage = nodeImage;
+  m_nbNodesPerTree.swap(nbNodesPerTree);
+  m_nbLeavesPerTree.swap(nbLeavesPerTree);
+  m_nbTotalLeaves = nbTotalLeaves;
+
+  // Ensure that the node image is available on the GPU (if we're using it).
+  m_nodeImage->UpdateDeviceFromHost();
+
+  // Call the overridable hook function to allow subclasses to update any derived state.
+  load_structure_sub();
 }
 
 template <typename DescriptorType, int TreeCount>
@@ -363,6 +418,21 @@ void DecisionForest<DescriptorType,TreeCount>::save_structure_to_file(const std:
   if(!out) throw std::runtime_error("Error saving the forest to a file: " + filename);
 }
 
+template <typename DescriptorType, int TreeCount>
+void DecisionForest<DescriptorType,TreeCount>::save_structure_to_model(orx::BinaryModelWriter& writer) const
+{
+  const uint32_t nbTrees = get_nb_trees();
+
+  std::vector<uint32_t> shape;
+  shape.push_back(nbTrees);
+  shape.push_back(static_cast<uint32_t>(m_nodeImage->noDims.y));
+  shape.insert(shape.end(), m_nbNodesPerTree.begin(), m_nbNodesPerTree.end());
+  shape.insert(shape.end(), m_nbLeavesPerTree.begin(), m_nbLeavesPerTree.end());
+
+  writer.write_vector("forestShape", shape);
+  writer.write_block("forestNodes", *m_nodeImage);
+}
+
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
 #ifdef WITH_SCOREFORESTS
@@ -467,4 +537,10 @@ int DecisionForest<DescriptorType,TreeCount>::create_node(uint32_t treeIdx, uint
   return outputFirstFreeIdx;
 }
 
+template <typename DescriptorType, int TreeCount>
+void DecisionForest<DescriptorType,TreeCount>::load_structure_sub()
+{
+  // No-op by default
+}
+
 }
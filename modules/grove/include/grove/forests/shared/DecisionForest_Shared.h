@@ -52,6 +52,38 @@ inline void compute_leaf_indices(int x, int y, const DescriptorType *descriptors
   }
 }
 
+/**
+ * \brief Finds the leaf indices associated with a pixel whose descriptor features are computed on demand during the traversal of the forest.
+ *
+ * \note  This produces the same leaf indices as compute_leaf_indices, but only the features tested by the branch nodes that are actually
+ *        visited are ever computed. For a forest containing a handful of fairly shallow trees, this is much cheaper than computing every
+ *        feature in the descriptor up-front.
+ *
+ * \param featureEvaluator A function object that, when called with the index of a feature in the descriptor, returns the value of that feature.
+ * \param nodeImage        The forest indexing structure.
+ * \param leafIndices      A location in which to store the leaf indices computed for the pixel.
+ */
+template <typename NodeType, typename FeatureEvaluator, int TreeCount>
+_CPU_AND_GPU_CODE_TEMPLATE_
+inline void compute_leaf_indices_on_demand(const FeatureEvaluator& featureEvaluator, const NodeType *nodeImage, ORUtils::VectorX<int,TreeCount>& leafIndices)
+{
+  // For each tree in the forest:
+  for(int treeIdx = 0; treeIdx < TreeCount; ++treeIdx)
+  {
+    // Start from the root node and iteratively walk down the tree until a leaf is reached,
+    // computing the feature tested by each branch node as we go.
+    NodeType node = nodeImage[treeIdx];
+    while(node.leafIdx < 0)
+    {
+      const uint32_t currentNodeIdx = node.leftChildIdx + static_cast<int>(featureEvaluator(node.featureIdx) > node.featureThreshold);
+      node = nodeImage[currentNodeIdx * TreeCount + treeIdx];
+    }
+
+    // Write the index of the leaf that has been reached into the output.
+    leafIndices[treeIdx] = node.leafIdx;
+  }
+}
+
 }
 
 #endif
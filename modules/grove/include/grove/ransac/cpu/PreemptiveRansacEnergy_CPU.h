@@ -0,0 +1,109 @@
+/**
+ * grove: PreemptiveRansacEnergy_CPU.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_GROVE_PREEMPTIVERANSACENERGY_CPU
+#define H_GROVE_PREEMPTIVERANSACENERGY_CPU
+
+#include <cstddef>
+
+#include <boost/cstdint.hpp>
+
+#include "../../scoreforests/Keypoint3DColourCluster.h"
+
+namespace grove {
+
+/**
+ * \brief The functions in this namespace compute the energies of pose candidates for PreemptiveRansac_CPU.
+ *
+ * They work on flat arrays into which the sampled inliers, their modes and the pose candidates have been packed
+ * (see PreemptiveRansac_CPU::pack_energy_inputs), and are exposed here (rather than being local to the .cpp file)
+ * so that the vectorised and scalar versions can be tested against each other.
+ */
+namespace ransac_detail {
+
+//#################### CONSTANTS ####################
+
+/** The number of floats used to store each packed mode: the position (3), the columns of the inverse covariance matrix (9), the log weight and the log inlier count. */
+const int PACKED_MODE_SIZE = 14;
+
+/** The number of rows in the packed pose array: the columns of the rotation matrix (9) and the translation (3). */
+const int PACKED_POSE_ROWS = 12;
+
+/** The number of pose candidates whose energies are computed together by the AVX2 kernel. */
+const int CANDIDATE_BATCH_SIZE = 8;
+
+/** The natural logarithm of the minimum energy an inlier can contribute (the same clamping is performed in compute_energy_sum_for_inlier_subset). */
+const float LOG_MIN_ENERGY = -13.815510558f;
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Computes the sum of the log energies contributed by the sampled inliers for a single pose candidate, using the packed inputs.
+ *
+ * \note  This is equivalent to compute_energy_sum_for_inliers, but works in the log domain, which means that it never needs to evaluate
+ *        an exponential: the mode with the largest energy is the one with the largest log energy, and that is all we need.
+ *
+ * \param packedPoses               The packed pose candidates.
+ * \param poseStride                The stride between the rows of the packed pose candidates.
+ * \param candidateIdx              The index of the pose candidate whose log energy sum we want to compute.
+ * \param inlierPoints              The packed camera-space positions of the sampled inliers.
+ * \param inlierLogModeCounts       The natural logarithms of the numbers of modes associated with the sampled inliers.
+ * \param inlierModeOffsets         The offsets of the modes associated with each sampled inlier in the packed modes.
+ * \param packedModes               The packed modes.
+ * \param nbInliers                 The number of sampled inliers.
+ * \return                          The sum of the natural logarithms of the (clamped) energies contributed by the sampled inliers.
+ */
+float compute_log_energy_sum(const float *packedPoses, size_t poseStride, int candidateIdx, const float *inlierPoints, const float *inlierLogModeCounts,
+                             const uint32_t *inlierModeOffsets, const float *packedModes, uint32_t nbInliers);
+
+/**
+ * \brief Packs a mode into PACKED_MODE_SIZE consecutive floats.
+ *
+ * The energy of a mode is nbInliers * N(x; position, covariance), so we store the logarithm of its constant factor,
+ * nbInliers / sqrt((2*pi)^3 * determinant), as its log weight. Modes with a non-positive determinant are given a log
+ * weight of -infinity so that they are never chosen. This is deliberately not an error: compute_energy_sum_for_inlier_subset
+ * computes a NaN energy for such modes, which also never wins the comparison, and if none of an inlier's modes is usable,
+ * both versions clamp the inlier's energy to the minimum.
+ *
+ * \param mode        The mode (must have at least one inlier).
+ * \param packedMode  The location into which to write the packed mode.
+ */
+void pack_mode(const Keypoint3DColourCluster& mode, float *packedMode);
+
+/**
+ * \brief Packs a pose candidate into a column of the packed pose array.
+ *
+ * \param pose          The pose candidate (a rigid transformation from camera -> world coordinates).
+ * \param packedPoses   The packed pose array (PACKED_POSE_ROWS rows of poseStride floats).
+ * \param poseStride    The stride between the rows of the packed pose array.
+ * \param candidateIdx  The index of the column into which to write the pose candidate.
+ */
+void pack_pose(const Matrix4f& pose, float *packedPoses, size_t poseStride, int candidateIdx);
+
+#ifdef WITH_AVX2
+/**
+ * \brief Computes the sums of the log energies contributed by the sampled inliers for a batch of 8 consecutive pose candidates.
+ *
+ * \note  This computes exactly the same thing as compute_log_energy_sum, but for 8 pose candidates at once (one per AVX lane).
+ *
+ * \param packedPoses               The packed pose candidates.
+ * \param poseStride                The stride between the rows of the packed pose candidates (must be a multiple of 8).
+ * \param firstCandidateIdx         The index of the first pose candidate in the batch.
+ * \param inlierPoints              The packed camera-space positions of the sampled inliers.
+ * \param inlierLogModeCounts       The natural logarithms of the numbers of modes associated with the sampled inliers.
+ * \param inlierModeOffsets         The offsets of the modes associated with each sampled inlier in the packed modes.
+ * \param packedModes               The packed modes.
+ * \param nbInliers                 The number of sampled inliers.
+ * \param logEnergySums             An output array into which to write the log energy sums for the 8 pose candidates.
+ */
+void compute_log_energy_sums_avx2(const float *packedPoses, size_t poseStride, int firstCandidateIdx, const float *inlierPoints, const float *inlierLogModeCounts,
+                                  const uint32_t *inlierModeOffsets, const float *packedModes, uint32_t nbInliers, float *logEnergySums);
+#endif
+
+}
+
+}
+
+#endif
@@ -6,6 +6,8 @@
 #ifndef H_GROVE_PREEMPTIVERANSAC_CPU
 #define H_GROVE_PREEMPTIVERANSAC_CPU
 
+#include <vector>
+
 #include "../interface/PreemptiveRansac.h"
 #include "../../numbers/CPURNG.h"
 
@@ -24,6 +26,21 @@ class PreemptiveRansac_CPU : public PreemptiveRansac
 {
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** The positions (in camera space) of the sampled inliers, packed as (x,y,z) triples. */
+  std::vector<float> m_packedInlierPoints;
+
+  /** The natural logarithms of the numbers of modes in the predictions associated with the sampled inliers. */
+  std::vector<float> m_packedInlierLogModeCounts;
+
+  /** The offsets of the modes associated with each sampled inlier in m_packedModes (there is one extra offset at the end). */
+  std::vector<uint32_t> m_packedInlierModeOffsets;
+
+  /** The modes associated with the sampled inliers, each packed as PACKED_MODE_SIZE consecutive floats (see PreemptiveRansacEnergy_CPU.h). */
+  std::vector<float> m_packedModes;
+
+  /** The candidate poses, packed in structure-of-arrays form (12 rows, each with one entry per candidate, padded to a multiple of 8). */
+  std::vector<float> m_packedPoses;
+
   /** The random number generators used during the P-RANSAC process. */
   CPURNGMemoryBlock_Ptr m_rngs;
 
@@ -65,16 +82,16 @@ protected:
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Computes the energy of a single pose candidate.
-   *
-   * \param candidate The pose candidate whose energy we want to compute.
+   * \brief Initialises the random number generators in a deterministic manner.
    */
-  void compute_pose_energy(PoseCandidate& candidate) const;
+  void init_random();
 
   /**
-   * \brief Initialises the random number generators in a deterministic manner.
+   * \brief Packs the sampled inliers, their modes and the pose candidates into the flat layouts used when computing the candidate energies.
+   *
+   * \throws std::runtime_error If the prediction associated with any of the sampled inliers has no modes.
    */
-  void init_random();
+  void pack_energy_inputs();
 };
 
 }
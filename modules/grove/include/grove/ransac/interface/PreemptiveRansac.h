@@ -276,6 +276,16 @@ public:
    */
   uint32_t get_min_nb_required_points() const;
 
+  /**
+   * \brief Gets the timers for the phases of the algorithm, accumulated over all of the calls to estimate_pose so far.
+   *
+   * The timer for the entire process comes first, followed by those for the phases that precede the RANSAC iterations,
+   * and then the timers for the phases of each RANSAC iteration in turn.
+   *
+   * \return The timers for the phases of the algorithm.
+   */
+  std::vector<AverageTimer> get_timers() const;
+
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
   /**
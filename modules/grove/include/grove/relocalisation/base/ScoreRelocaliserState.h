@@ -6,6 +6,8 @@
 #ifndef H_GROVE_SCORERELOCALISERSTATE
 #define H_GROVE_SCORERELOCALISERSTATE
 
+#include <boost/thread/shared_mutex.hpp>
+
 #include <ORUtils/DeviceType.h>
 
 #include "../../keypoints/Keypoint3DColour.h"
@@ -21,6 +23,10 @@ namespace grove {
  *
  * - The example reservoirs used when training the relocaliser.
  * - A memory block containing the 3D modal clusters used for the actual camera relocalisation.
+ *
+ * The clusterer writes each batch of newly-computed clusters into a small staging buffer (owned by the relocaliser),
+ * which is then copied into the clusters block under a short exclusive lock. Relocalisation only needs to hold a shared
+ * lock on the clusters block whilst it reads the clusters for the current frame, so it is not blocked by clustering.
  */
 class ScoreRelocaliserState
 {
@@ -51,9 +57,12 @@ public:
   /** The index of the first reservoir that was clustered when the train function was last called. */
   uint32_t lastExamplesAddedStartIdx;
 
-  /** A memory block storing the 3D modal clusters associated with each leaf in the forest. */
+  /** A memory block storing the 3D modal clusters associated with each leaf in the forest (must only be read whilst holding a shared lock on predictionsMutex). */
   ScorePredictionsMemoryBlock_Ptr predictionsBlock;
 
+  /** The mutex used to synchronise the publication of newly-computed clusters with their use for relocalisation. */
+  mutable boost::shared_mutex predictionsMutex;
+
   /** The index of the first reservoir to cluster when the relocaliser is updated. */
   uint32_t reservoirUpdateStartIdx;
 
@@ -80,6 +89,26 @@ public:
    */
   void load_from_disk(const std::string& inputFolder);
 
+  /**
+   * \brief Loads the relocaliser state from a binary model file.
+   *
+   * \note  If the model does not contain any reservoirs (e.g. because it was saved after training was finished), the reservoirs are left empty.
+   *
+   * \param reader  The reader for the binary model file containing the relocaliser state.
+   *
+   * \throws std::runtime_error If loading the relocaliser state fails.
+   */
+  void load_from_model(const orx::BinaryModelReader& reader);
+
+  /**
+   * \brief Publishes a batch of newly-computed clusters, making them available for relocalisation.
+   *
+   * \param stagedPredictions A memory block whose first count elements contain the newly-computed clusters.
+   * \param startIdx          The index of the first reservoir whose clusters were updated.
+   * \param count             The number of reservoirs whose clusters were updated.
+   */
+  void publish_predictions(const ScorePredictionsMemoryBlock_CPtr& stagedPredictions, uint32_t startIdx, uint32_t count);
+
   /**
    * \brief Resets the relocaliser state.
    */
@@ -93,6 +122,15 @@ public:
    * \throws std::runtime_error If saving the relocaliser state fails.
    */
   void save_to_disk(const std::string& outputFolder) const;
+
+  /**
+   * \brief Saves the relocaliser state to a binary model file.
+   *
+   * \param writer  The writer for the binary model file into which to save the relocaliser state.
+   *
+   * \throws std::runtime_error If saving the relocaliser state fails.
+   */
+  void save_to_model(orx::BinaryModelWriter& writer) const;
 };
 
 //#################### TYPEDEFS ####################
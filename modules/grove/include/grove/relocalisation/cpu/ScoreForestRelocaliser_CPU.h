@@ -16,6 +16,15 @@ namespace grove {
  */
 class ScoreForestRelocaliser_CPU : public ScoreForestRelocaliser
 {
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /**
+   * Whether or not to compute the features needed by the forest on demand while passing each keypoint down the trees,
+   * rather than computing the full descriptor for each keypoint up-front. This yields exactly the same leaves, but
+   * computes only the handful of features tested by the branch nodes that are actually visited.
+   */
+  bool m_computeFeaturesOnDemand;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -30,6 +39,10 @@ public:
 
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
+  /** Override */
+  virtual void compute_features(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                                const Matrix4f& cameraPose, const Vector4f& depthIntrinsics) const;
+
   /** Override */
   virtual void merge_predictions_for_keypoints(const LeafIndicesImage_CPtr& leafIndices, ScorePredictionsImage_Ptr& outputPredictions) const;
 };
@@ -30,14 +30,24 @@ public:
   typedef DecisionForest<DescriptorType, FOREST_TREE_COUNT> ScoreForest;
   typedef boost::shared_ptr<ScoreForest> ScoreForest_Ptr;
 
+  //#################### NESTED TYPES ####################
+protected:
+  /**
+   * \brief A workspace that additionally stores the forest leaves associated with the keypoints.
+   */
+  struct ForestWorkspace : Workspace
+  {
+    /** The image containing the indices of the forest leaves associated with the keypoint/descriptor pairs. */
+    LeafIndicesImage_Ptr leafIndicesImage;
+  };
+
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The image containing the indices of the forest leaves associated with the keypoint/descriptor pairs. */
-  mutable LeafIndicesImage_Ptr m_leafIndicesImage;
-
   /** An image in which to store a visualisation of the mapping from pixels to forest leaves (for debugging purposes). */
   mutable ORUChar4Image_Ptr m_pixelsToLeavesImage;
 
+  //#################### PROTECTED VARIABLES ####################
+protected:
   /** The SCoRe forest on which the relocaliser is based. */
   ScoreForest_Ptr m_scoreForest;
 
@@ -99,6 +109,21 @@ public:
 
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
+  /**
+   * \brief Extracts keypoints from an RGB-D image and finds the leaves in the forest that are associated with them.
+   *
+   * \note  This implementation computes the full descriptor for each keypoint before passing it down the forest.
+   *        Derived classes may override it to compute only those features that are actually tested during the traversal.
+   *
+   * \param workspace       The workspace (a ForestWorkspace) into which to write the keypoints, descriptors and leaf indices.
+   * \param colourImage     The colour image.
+   * \param depthImage      The depth image.
+   * \param cameraPose      A transformation from the camera's reference frame to the reference frame in which the keypoints should be expressed.
+   * \param depthIntrinsics The intrinsic parameters of the depth sensor.
+   */
+  virtual void compute_features(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                                const Matrix4f& cameraPose, const Vector4f& depthIntrinsics) const;
+
   /**
    * \brief Checks whether or not the specified leaf is valid, and throws if not.
    *
@@ -110,22 +135,33 @@ protected:
   void ensure_valid_leaf(uint32_t treeIdx, uint32_t leafIdx) const;
 
   /** Override */
-  virtual void make_predictions(const ORUChar4Image *colourImage) const;
+  virtual void load_from_model_sub(const orx::BinaryModelReader& reader);
+
+  /** Override */
+  virtual void make_predictions(Workspace& workspace, const ORUChar4Image *colourImage) const;
+
+  /** Override */
+  virtual void make_visualisation_images(const Workspace& workspace, const ORFloatImage *depthImage, const std::vector<Result>& results) const;
+
+  /** Override */
+  virtual Workspace_Ptr make_workspace() const;
 
   /** Override */
-  virtual void make_visualisation_images(const ORFloatImage *depthImage, const std::vector<Result>& results) const;
+  virtual void save_to_model_sub(orx::BinaryModelWriter& writer) const;
 
   /** Override */
-  virtual void train_sub(const ORUChar4Image *colourImage, const ORFloatImage *depthImage, const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose);
+  virtual void train_sub(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                         const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose);
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
    * \brief Updates the pixels to leaves image (for debugging purposes).
    *
-   * \param depthImage  The current depth image.
+   * \param leafIndicesImage  The image containing the indices of the forest leaves associated with the keypoints.
+   * \param depthImage        The current depth image.
    */
-  void update_pixels_to_leaves_image(const ORFloatImage *depthImage) const;
+  void update_pixels_to_leaves_image(const LeafIndicesImage_CPtr& leafIndicesImage, const ORFloatImage *depthImage) const;
 };
 
 //#################### TYPEDEFS ####################
@@ -29,10 +29,11 @@ protected:
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
   /** Override */
-  virtual void make_predictions(const ORUChar4Image *colourImage) const;
+  virtual void make_predictions(Workspace& workspace, const ORUChar4Image *colourImage) const;
 
   /** Override */
-  virtual void train_sub(const ORUChar4Image *colourImage, const ORFloatImage *depthImage, const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose);
+  virtual void train_sub(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                         const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose);
 };
 
 }
@@ -45,11 +45,22 @@ protected:
   typedef boost::shared_ptr<ORUtils::MemoryBlock<float> > ScoreNetOutput_Ptr;
   typedef boost::shared_ptr<const ORUtils::MemoryBlock<float> > ScoreNetOutput_CPtr;
 
+  //#################### NESTED TYPES ####################
+protected:
+  /**
+   * \brief A workspace that additionally stores the bucket indices and network output associated with the keypoints.
+   */
+  struct NetWorkspace : Workspace
+  {
+    /** An image containing the bucket (example reservoir) indices associated with the keypoints. */
+    BucketIndicesImage_Ptr bucketIndicesImage;
+
+    /** A memory block into which to copy the output tensor produced by the SCoRe network for downstream processing. */
+    ScoreNetOutput_Ptr scoreNetOutput;
+  };
+
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** An image containing the bucket (example reservoir) indices associated with the keypoints. */
-  BucketIndicesImage_Ptr m_bucketIndicesImage;
-
   /** A mapping from indices of cells in the grid placed over the training scene to example reservoir indices. */
   // FIXME: This should be in the relocaliser state, not in the relocaliser itself.
   mutable std::map<int,int> m_bucketRemapper;
@@ -57,6 +68,9 @@ private:
   /** The size of each bucket (in cm). */
   int m_bucketSizeCm;
 
+  /** A mutex used to serialise access to the network, the bucket remapper and the random number generator. */
+  mutable boost::mutex m_netMutex;
+
   /** The type of network being used (dsac|vgg). */
   std::string m_netType;
 
@@ -72,9 +86,6 @@ private:
   /** The SCoRe network on which the relocaliser is based. */
   std::shared_ptr<torch::jit::script::Module> m_scoreNet;
 
-  /** A memory block into which to copy the output tensor produced by the SCoRe network for downstream processing. */
-  ScoreNetOutput_Ptr m_scoreNetOutput;
-
   /** Whether or not to use the bucket predictions in preference to the raw output of the network (necessary if testing on a scene other than the training scene). */
   bool m_useBucketPredictions;
 
@@ -121,27 +132,37 @@ protected:
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
   /** Override */
-  virtual void make_predictions(const ORUChar4Image *colourImage) const;
+  virtual void make_predictions(Workspace& workspace, const ORUChar4Image *colourImage) const;
+
+  /** Override */
+  virtual Workspace_Ptr make_workspace() const;
 
   /** Override */
-  virtual void train_sub(const ORUChar4Image *colourImage, const ORFloatImage *depthImage, const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose);
+  virtual void train_sub(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                         const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose);
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
    * \brief Finds the example reservoir corresponding to each keypoint in the specified colour image.
    *
+   * \note  The caller must hold m_netMutex.
+   *
+   * \param workspace       The workspace containing the keypoints, into which to write the bucket indices.
    * \param colourImage     The colour image for whose keypoints we want to find the example reservoirs.
    * \param allowAllocation Whether or not to allocate new reservoirs if necessary.
    */
-  void find_reservoirs(const ORUChar4Image *colourImage, bool allowAllocation) const;
+  void find_reservoirs(NetWorkspace& workspace, const ORUChar4Image *colourImage, bool allowAllocation) const;
 
   /**
    * \brief Runs the network on the specified colour image to predict a world space point for each keypoint.
    *
+   * \note  The caller must hold m_netMutex.
+   *
+   * \param workspace   The workspace containing the keypoints, into which to write the network output.
    * \param colourImage The colour image on which to run the network.
    */
-  void run_net(const ORUChar4Image *colourImage) const;
+  void run_net(NetWorkspace& workspace, const ORUChar4Image *colourImage) const;
 };
 
 }
@@ -11,6 +11,8 @@
 
 #include <orx/relocalisation/Relocaliser.h>
 
+#include <tvgutil/misc/Setting.h>
+
 #include "../base/ScoreRelocaliserState.h"
 #include "../../clustering/interface/ExampleClusterer.h"
 #include "../../features/interface/RGBDPatchFeatureCalculator.h"
@@ -43,10 +45,67 @@ public:
   typedef ExampleReservoirs<ExampleType> Reservoirs;
   typedef boost::shared_ptr<Reservoirs> Reservoirs_Ptr;
 
-//#################### PRIVATE VARIABLES ####################
+  //#################### NESTED TYPES ####################
+protected:
+  /**
+   * \brief An instance of this struct holds the scratch state (images, P-RANSAC instance, etc.) used by a single call to relocalise or train.
+   *
+   * Each call to relocalise takes a workspace from a pool for the duration of the call, so several calls can run concurrently.
+   * Derived classes that need additional scratch state should derive from this struct and override make_workspace.
+   */
+  struct Workspace
+  {
+    /** The image containing the descriptors extracted from the RGB-D image. */
+    RGBDPatchDescriptorImage_Ptr descriptorsImage;
+
+    /** The index of the ground truth pose (if any) associated with the RGB-D image. */
+    size_t groundTruthFrameIndex;
+
+    /** The image containing the keypoints extracted from the RGB-D image. */
+    Keypoint3DColourImage_Ptr keypointsImage;
+
+    /** The Preemptive RANSAC instance used to estimate the camera pose (only allocated for workspaces used for relocalisation). */
+    PreemptiveRansac_Ptr preemptiveRansac;
+
+    /** The image containing the SCoRe predictions associated with the keypoint/descriptor pairs. */
+    ScorePredictionsImage_Ptr predictionsImage;
+
+    virtual ~Workspace() {}
+  };
+
+  typedef boost::shared_ptr<Workspace> Workspace_Ptr;
+
+  //#################### PRIVATE VARIABLES ####################
 private:
-  /** The mutex used to synchronise access to the relocaliser in a multithreaded environment. */
-  mutable boost::recursive_mutex m_mutex;
+  /**
+   * The mutex used to synchronise clustering (i.e. the train, update and finish_training functions) in a multithreaded environment.
+   * Relocalisation does not need this mutex, since the clusterer writes into a staging buffer that is only published once it's ready.
+   */
+  mutable boost::recursive_mutex m_clusteringMutex;
+
+  /** The mutex used to synchronise access to the debug visualisation images and the ground truth frame index. */
+  mutable boost::mutex m_debuggingMutex;
+
+  /** The workspaces that are not currently being used by a call to relocalise. */
+  mutable std::vector<Workspace_Ptr> m_freeWorkspaces;
+
+  /** The workspace used by the most recent call to relocalise to finish (if any). */
+  mutable Workspace_Ptr m_lastWorkspace;
+
+  /**
+   * The mutex used to prevent the parts of the model that are not protected by the relocaliser state (e.g. the forest) from being
+   * replaced whilst they are in use. Relocalisation and training hold a shared lock; loading and resetting hold an exclusive lock.
+   */
+  mutable boost::shared_mutex m_modelMutex;
+
+  /** A memory block into which the clusterer writes each batch of clusters before they are published to the relocaliser state. */
+  ScorePredictionsMemoryBlock_Ptr m_stagedPredictionsBlock;
+
+  /** The workspace used when training the relocaliser (only used whilst holding the clustering mutex). */
+  Workspace_Ptr m_trainingWorkspace;
+
+  /** The mutex used to synchronise access to the pool of workspaces. */
+  mutable boost::mutex m_workspacesMutex;
 
   //#################### PROTECTED VARIABLES ####################
 protected:
@@ -59,9 +118,6 @@ protected:
   /** The maximum distance there can be between two examples that are part of the same cluster (used during clustering). */
   float m_clustererTau;
 
-  /** The image containing the descriptors extracted from the RGB-D image. */
-  RGBDPatchDescriptorImage_Ptr m_descriptorsImage;
-
   /** The device on which the relocaliser should operate. */
   ORUtils::DeviceType m_deviceType;
 
@@ -74,7 +130,7 @@ protected:
   /** The feature calculator used to extract keypoints and descriptors from the RGB-D image. */
   DA_RGBDPatchFeatureCalculator_Ptr m_featureCalculator;
 
-  /** The index of the next ground truth pose to use (if the ground truth camera trajectory is available). */
+  /** The index of the ground truth pose to use for the next call to relocalise (if the ground truth camera trajectory is available). */
   mutable size_t m_groundTruthFrameIndex;
 
   /** An image in which to store a visualisation of the ground truth mapping from pixels to world-space points (if available). */
@@ -86,8 +142,8 @@ protected:
   /** The ground truth camera trajectory (if available). */
   boost::optional<std::vector<ORUtils::SE3Pose> > m_groundTruthTrajectory;
 
-  /** The image containing the keypoints extracted from the RGB-D image. */
-  Keypoint3DColourImage_Ptr m_keypointsImage;
+  /** Whether or not to also produce a visualisation of the ground truth mapping from pixels to world-space points when debugging. */
+  tvgutil::Setting<bool> m_makeGroundTruthPointsImage;
 
   /** The maximum number of clusters to store in each reservoir (used during clustering). */
   uint32_t m_maxClusterCount;
@@ -110,12 +166,6 @@ protected:
   /** An image in which to store a visualisation of the mapping from pixels to world-space points (for debugging purposes). */
   mutable ORUChar4Image_Ptr m_pixelsToPointsImage;
 
-  /** The image containing the SCoRe predictions associated with the keypoint/descriptor pairs. */
-  mutable ScorePredictionsImage_Ptr m_predictionsImage;
-
-  /** The Preemptive RANSAC instance, used to estimate the 6DOF camera pose from a set of 3D keypoints and their associated SCoRe predictions. */
-  PreemptiveRansac_Ptr m_preemptiveRansac;
-
   /** The state of the relocaliser. Can be replaced at runtime to relocalise (and train) in a different environment. */
   ScoreRelocaliserState_Ptr m_relocaliserState;
 
@@ -157,23 +207,26 @@ public:
   //#################### PROTECTED ABSTRACT MEMBER FUNCTIONS ####################
 protected:
   /**
-   * \brief Fills the SCoRe predictions image with a set of clusters for each keypoint extracted from the RGB-D image.
+   * \brief Fills the SCoRe predictions image in the workspace with a set of clusters for each keypoint extracted from the RGB-D image.
    *
+   * \param workspace   The workspace for the current call to relocalise.
    * \param colourImage The colour image.
    */
-  virtual void make_predictions(const ORUChar4Image *colourImage) const = 0;
+  virtual void make_predictions(Workspace& workspace, const ORUChar4Image *colourImage) const = 0;
 
   /**
    * \brief Trains the relocaliser using information from an RGB-D image pair captured from a known pose in the world.
    *
    * \note  This is a hook function - derived classes should override this rather than overriding train() directly, since train() also does some clustering.
    *
+   * \param workspace       The workspace to use for training.
    * \param colourImage     The colour image.
    * \param depthImage      The depth image.
    * \param depthIntrinsics The intrinsic parameters of the depth sensor.
    * \param cameraPose      The position of the camera in the world.
    */
-  virtual void train_sub(const ORUChar4Image *colourImage, const ORFloatImage *depthImage, const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose) = 0;
+  virtual void train_sub(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                         const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose) = 0;
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -186,22 +239,28 @@ public:
    *
    * \pre   This function should only be called after a prior call to relocalise.
    * \note  The first entry of the vector will be the candidate (if any) returned by the last run of P-RANSAC.
+   * \note  If several calls to relocalise are made concurrently, this refers to the one that finished most recently,
+   *        and is only meaningful if no other call to relocalise is in progress.
    *
    * \param poseCandidates An output array that will be filled with the candidate poses as described.
    */
   void get_best_poses(std::vector<PoseCandidate>& poseCandidates) const;
 
   /**
-   * \brief Gets the image containing the keypoints extracted from the RGB-D image.
+   * \brief Gets the image containing the keypoints extracted from the RGB-D image by the most recent call to relocalise.
+   *
+   * \note  As for get_best_poses, this is only meaningful if no other call to relocalise is in progress.
    *
-   * \return  The image containing the keypoints extracted from the RGB-D image.
+   * \return  The image containing the keypoints extracted from the RGB-D image (or NULL, if relocalise has not yet been called).
    */
   Keypoint3DColourImage_CPtr get_keypoints_image() const;
 
   /**
-   * \brief Gets the image containing the SCoRe predictions associated with the keypoint/descriptor pairs.
+   * \brief Gets the image containing the SCoRe predictions made by the most recent call to relocalise.
    *
-   * \return  The image containing the SCoRe predictions associated with the keypoint/descriptor pairs.
+   * \note  As for get_best_poses, this is only meaningful if no other call to relocalise is in progress.
+   *
+   * \return  The image containing the SCoRe predictions made by the most recent call to relocalise (or NULL, if relocalise has not yet been called).
    */
   ScorePredictionsImage_CPtr get_predictions_image() const;
 
@@ -251,13 +310,57 @@ public:
 
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
+  /**
+   * \brief Allocates the images that are common to all workspaces (for use by make_workspace).
+   *
+   * \param workspace The workspace whose images should be allocated.
+   */
+  void allocate_workspace_images(Workspace& workspace) const;
+
+  /**
+   * \brief Extracts keypoints from an RGB-D image and computes whatever per-keypoint information make_predictions needs.
+   *
+   * \note  By default, this fills in the keypoints and descriptors images in the workspace. Derived classes that do not
+   *        need the full descriptors (or that can compute what they need more cheaply) can override it.
+   *
+   * \param workspace       The workspace into which to write the keypoints and per-keypoint information.
+   * \param colourImage     The colour image.
+   * \param depthImage      The depth image.
+   * \param cameraPose      A transformation from the camera's reference frame to the reference frame in which the keypoints should be expressed.
+   * \param depthIntrinsics The intrinsic parameters of the depth sensor.
+   */
+  virtual void compute_features(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                                const Matrix4f& cameraPose, const Vector4f& depthIntrinsics) const;
+
+  /**
+   * \brief An overridable hook function that is called by load_from_disk (before the relocaliser state is loaded) when the relocaliser
+   *        is being loaded from a binary model file, to allow subclasses to load any additional data they saved in save_to_model_sub.
+   *
+   * \param reader  The reader for the binary model file.
+   *
+   * \throws std::runtime_error If the loading fails.
+   */
+  virtual void load_from_model_sub(const orx::BinaryModelReader& reader);
+
   /**
    * \brief Makes debug visualisation images to help the user better understand what happened during the most recent attempt to relocalise the camera.
    *
+   * \note  This is called whilst holding the debugging mutex, so implementations do not need to synchronise access to the visualisation images.
+   *
+   * \param workspace   The workspace used by the most recent attempt to relocalise.
    * \param depthImage  The depth image from which we were trying to relocalise.
    * \param results     The results of the most recent attempt to relocalise.
    */
-  virtual void make_visualisation_images(const ORFloatImage *depthImage, const std::vector<Result>& results) const;
+  virtual void make_visualisation_images(const Workspace& workspace, const ORFloatImage *depthImage, const std::vector<Result>& results) const;
+
+  /**
+   * \brief Makes a workspace that can be used for a call to relocalise or train.
+   *
+   * \note  Derived classes that need additional scratch state should override this to make a workspace of the appropriate type.
+   *
+   * \return The workspace.
+   */
+  virtual Workspace_Ptr make_workspace() const;
 
   /**
    * \brief Sets a SCoRe prediction for each keypoint that contains a single cluster consisting of the ground truth position of the keypoint in world space.
@@ -269,8 +372,32 @@ protected:
   virtual void set_ground_truth_predictions_for_keypoints(const Keypoint3DColourImage_CPtr& keypointsImage, const Matrix4f& cameraToWorld,
                                                           ScorePredictionsImage_Ptr& outputPredictions) const;
 
+  /**
+   * \brief An overridable hook function that is called by save_to_disk (before the relocaliser state is saved) to allow subclasses
+   *        to save any additional data they need into the binary model file.
+   *
+   * \param writer  The writer for the binary model file.
+   *
+   * \throws std::runtime_error If the saving fails.
+   */
+  virtual void save_to_model_sub(orx::BinaryModelWriter& writer) const;
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Takes a workspace (with a P-RANSAC instance) from the pool for a call to relocalise, making a new one if none are free.
+   *
+   * \return The workspace.
+   */
+  Workspace_Ptr acquire_workspace() const;
+
+  /**
+   * \brief Clusters the contents of the next batch of reservoirs and publishes the resulting clusters for use during relocalisation.
+   *
+   * \return  The index of the first reservoir that was clustered.
+   */
+  uint32_t cluster_next_reservoirs();
+
   /**
    * \brief Computes the number of reservoirs to subject to clustering during a train/update call.
    *
@@ -278,14 +405,35 @@ private:
    */
   uint32_t compute_nb_reservoirs_to_update() const;
 
+  /**
+   * \brief Relocalises the camera using the specified workspace.
+   *
+   * \param workspace       The workspace to use.
+   * \param colourImage     The colour image.
+   * \param depthImage      The depth image.
+   * \param depthIntrinsics The intrinsic parameters of the depth sensor.
+   * \return                The results of the relocalisation.
+   */
+  std::vector<Result> relocalise_with_workspace(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                                                const Vector4f& depthIntrinsics) const;
+
+  /**
+   * \brief Returns a workspace to the pool once the call to relocalise that was using it has finished.
+   *
+   * \param workspace The workspace.
+   */
+  void release_workspace(const Workspace_Ptr& workspace) const;
+
   /**
    * \brief Updates one of the pixels to points images (for debugging purposes).
    *
    * \param worldToCamera       The transformation to use from world to camera space.
+   * \param keypointsImage      An image containing the keypoints extracted from the RGB-D image.
    * \param predictionsImage    An image containing SCoRe predictions associated with the keypoint/descriptor pairs.
    * \param pixelsToPointsImage An image in which to store a visualisation of a mapping from pixels to world-space points.
    */
-  void update_pixels_to_points_image(const ORUtils::SE3Pose& worldToCamera, const ScorePredictionsImage_Ptr& predictionsImage, ORUChar4Image_Ptr& pixelsToPointsImage) const;
+  void update_pixels_to_points_image(const ORUtils::SE3Pose& worldToCamera, const Keypoint3DColourImage_CPtr& keypointsImage,
+                                     const ScorePredictionsImage_CPtr& predictionsImage, ORUChar4Image_Ptr& pixelsToPointsImage) const;
 
   /**
    * \brief Updates the index of the first reservoir to subject to clustering during the next train/update call.
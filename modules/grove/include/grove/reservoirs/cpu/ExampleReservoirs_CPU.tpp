@@ -11,6 +11,8 @@ namespace bf = boost::filesystem;
 #include <ORUtils/MemoryBlockPersister.h>
 
 #include <orx/base/MemoryBlockFactory.h>
+#include <orx/persistence/BinaryModelReader.h>
+#include <orx/persistence/BinaryModelWriter.h>
 
 #include "../shared/ExampleReservoirs_Shared.h"
 
@@ -23,7 +25,7 @@ ExampleReservoirs_CPU<ExampleType>::ExampleReservoirs_CPU(uint32_t reservoirCoun
 : ExampleReservoirs<ExampleType>(reservoirCount, reservoirCapacity, rngSeed)
 {
   orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
-  m_rngs = mbf.make_block<CPURNG>();
+  m_rngs = mbf.make_block<CPURNG>(0, "reservoirs");
 
   reset();
 }
@@ -92,6 +94,13 @@ void ExampleReservoirs_CPU<ExampleType>::load_from_disk_sub(const std::string& i
   ORUtils::MemoryBlockPersister::LoadMemoryBlock((inputPath / "reservoirRngs.bin").string(), *m_rngs, MEMORYDEVICE_CPU);
 }
 
+template<typename ExampleType>
+void ExampleReservoirs_CPU<ExampleType>::load_from_model_sub(const orx::BinaryModelReader& reader)
+{
+  // Load the RNG states.
+  reader.read_block("reservoirRngs", *m_rngs);
+}
+
 template <typename ExampleType>
 void ExampleReservoirs_CPU<ExampleType>::reinit_rngs()
 {
@@ -112,4 +121,11 @@ void ExampleReservoirs_CPU<ExampleType>::save_to_disk_sub(const std::string& out
   ORUtils::MemoryBlockPersister::SaveMemoryBlock((outputPath / "reservoirRngs.bin").string(), *m_rngs, MEMORYDEVICE_CPU);
 }
 
+template<typename ExampleType>
+void ExampleReservoirs_CPU<ExampleType>::save_to_model_sub(orx::BinaryModelWriter& writer)
+{
+  // Save the RNG states.
+  writer.write_block("reservoirRngs", *m_rngs);
+}
+
 }
@@ -58,6 +58,9 @@ private:
   /** Override */
   virtual void load_from_disk_sub(const std::string& inputFolder);
 
+  /** Override */
+  virtual void load_from_model_sub(const orx::BinaryModelReader& reader);
+
   /**
    * \brief Reinitialises the random number generators using known seeds.
    */
@@ -66,6 +69,9 @@ private:
   /** Override */
   virtual void save_to_disk_sub(const std::string& outputFolder);
 
+  /** Override */
+  virtual void save_to_model_sub(orx::BinaryModelWriter& writer);
+
   //#################### FRIENDS ####################
 
   friend class ExampleReservoirs<ExampleType>;
@@ -9,6 +9,15 @@
 #include <orx/base/ORImagePtrTypes.h>
 #include <orx/base/ORMemoryBlockPtrTypes.h>
 
+namespace orx {
+
+//#################### FORWARD DECLARATIONS ####################
+
+class BinaryModelReader;
+class BinaryModelWriter;
+
+}
+
 namespace grove {
 
 //#################### FORWARD DECLARATIONS ####################
@@ -120,6 +129,15 @@ private:
    */
   virtual void load_from_disk_sub(const std::string& inputFolder) = 0;
 
+  /**
+   * \brief An overridable hook function that is called at the end of load_from_model to allow subclasses to perform additional loading steps.
+   *
+   * \param reader  The reader for the binary model file containing the reservoir state.
+   *
+   * \throws std::runtime_error If the loading fails.
+   */
+  virtual void load_from_model_sub(const orx::BinaryModelReader& reader) = 0;
+
   /**
    * \brief An overridable hook function that is called at the end of save_to_disk to allow subclasses to perform additional saving steps.
    *
@@ -129,6 +147,15 @@ private:
    */
   virtual void save_to_disk_sub(const std::string& outputFolder) = 0;
 
+  /**
+   * \brief An overridable hook function that is called at the end of save_to_model to allow subclasses to perform additional saving steps.
+   *
+   * \param writer  The writer for the binary model file into which to save the reservoir state.
+   *
+   * \throws std::runtime_error If the saving fails.
+   */
+  virtual void save_to_model_sub(orx::BinaryModelWriter& writer) = 0;
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /**
@@ -196,6 +223,15 @@ public:
    */
   void load_from_disk(const std::string& inputFolder);
 
+  /**
+   * \brief Loads the reservoir state from a binary model file.
+   *
+   * \param reader  The reader for the binary model file containing the reservoir state.
+   *
+   * \throws std::runtime_error If the loading fails (e.g. if the file contains reservoirs of a different size).
+   */
+  void load_from_model(const orx::BinaryModelReader& reader);
+
   /**
    * \brief Clears the reservoirs, discards all examples and reinitialises the random number generators.
    */
@@ -209,6 +245,15 @@ public:
    * \throws std::runtime_error If the saving fails.
    */
   void save_to_disk(const std::string& outputFolder);
+
+  /**
+   * \brief Saves the reservoir state to a binary model file.
+   *
+   * \param writer  The writer for the binary model file into which to save the reservoir state.
+   *
+   * \throws std::runtime_error If the saving fails.
+   */
+  void save_to_model(orx::BinaryModelWriter& writer);
 };
 
 }
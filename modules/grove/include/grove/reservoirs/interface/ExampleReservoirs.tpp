@@ -11,6 +11,8 @@ namespace bf = boost::filesystem;
 #include <ORUtils/MemoryBlockPersister.h>
 
 #include <orx/base/MemoryBlockFactory.h>
+#include <orx/persistence/BinaryModelReader.h>
+#include <orx/persistence/BinaryModelWriter.h>
 
 namespace grove {
 
@@ -23,9 +25,9 @@ ExampleReservoirs<ExampleType>::ExampleReservoirs(uint32_t reservoirCount, uint3
   orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
 
   // One row per reservoir, width equal to the capacity.
-  m_reservoirs = mbf.make_image<ExampleType>(Vector2i(reservoirCapacity, reservoirCount));
-  m_reservoirAddCalls = mbf.make_block<int>(reservoirCount);
-  m_reservoirSizes = mbf.make_block<int>(reservoirCount);
+  m_reservoirs = mbf.make_image<ExampleType>(Vector2i(reservoirCapacity, reservoirCount), "reservoirs");
+  m_reservoirAddCalls = mbf.make_block<int>(reservoirCount, "reservoirs");
+  m_reservoirSizes = mbf.make_block<int>(reservoirCount, "reservoirs");
 }
 
 //#################### DESTRUCTOR ####################
@@ -100,6 +102,23 @@ void ExampleReservoirs<ExampleType>::load_from_disk(const std::string& inputFold
   load_from_disk_sub(inputFolder);
 }
 
+template <typename ExampleType>
+void ExampleReservoirs<ExampleType>::load_from_model(const orx::BinaryModelReader& reader)
+{
+  // Copy the data from the mapped file into memory on the CPU.
+  reader.read_block("reservoirs", *m_reservoirs);
+  reader.read_block("reservoirAddCalls", *m_reservoirAddCalls);
+  reader.read_block("reservoirSizes", *m_reservoirSizes);
+
+  // If we're using the GPU, copy the data across.
+  m_reservoirs->UpdateDeviceFromHost();
+  m_reservoirAddCalls->UpdateDeviceFromHost();
+  m_reservoirSizes->UpdateDeviceFromHost();
+
+  // Call the overridable hook function to allow subclasses to perform additional loading steps.
+  load_from_model_sub(reader);
+}
+
 template <typename ExampleType>
 void ExampleReservoirs<ExampleType>::reset()
 {
@@ -127,4 +146,21 @@ void ExampleReservoirs<ExampleType>::save_to_disk(const std::string& outputFolde
   save_to_disk_sub(outputFolder);
 }
 
+template<typename ExampleType>
+void ExampleReservoirs<ExampleType>::save_to_model(orx::BinaryModelWriter& writer)
+{
+  // If we're using the GPU, copy the data across to the CPU so that it can be saved.
+  m_reservoirs->UpdateHostFromDevice();
+  m_reservoirAddCalls->UpdateHostFromDevice();
+  m_reservoirSizes->UpdateHostFromDevice();
+
+  // Write the data into the model file.
+  writer.write_block("reservoirs", *m_reservoirs);
+  writer.write_block("reservoirAddCalls", *m_reservoirAddCalls);
+  writer.write_block("reservoirSizes", *m_reservoirSizes);
+
+  // Call the overridable hook function to allow subclasses to perform additional saving steps.
+  save_to_model_sub(writer);
+}
+
 }
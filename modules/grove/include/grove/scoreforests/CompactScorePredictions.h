@@ -0,0 +1,131 @@
+/**
+ * grove: CompactScorePredictions.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_GROVE_COMPACTSCOREPREDICTIONS
+#define H_GROVE_COMPACTSCOREPREDICTIONS
+
+#include <orx/base/ORMemoryBlockPtrTypes.h>
+
+#include "ScorePrediction.h"
+
+namespace orx {
+
+//#################### FORWARD DECLARATIONS ####################
+
+class BinaryModelReader;
+class BinaryModelWriter;
+
+}
+
+namespace grove {
+
+/**
+ * \brief An instance of this class stores a set of SCoRe predictions in a compact, variable-length (CSR-style) form,
+ *        for use when saving them to (and loading them from) a binary model file.
+ *
+ * The modes of all of the predictions are stored contiguously in a single flat pool, and a separate array of offsets
+ * records where the modes of each prediction start in that pool. The modes of prediction i are thus the elements
+ * in the range [modeOffsets[i], modeOffsets[i+1]) of the mode pool.
+ *
+ * By contrast, a ScorePrediction always reserves space for ScorePrediction::Capacity modes, even though most leaves
+ * of a typical relocalisation forest only contain a handful of modes. This is purely a storage format: the relocaliser
+ * works with the fixed-capacity representation in memory, since that allows the modes of each leaf to be rewritten
+ * in place on the GPU during online adaptation, so the predictions are expanded again on loading. The per-pixel
+ * predictions image used by P-RANSAC also keeps the fixed-capacity representation, since it is filled in and read
+ * by the CUDA kernels; the CPU implementation of P-RANSAC instead packs the modes of the sampled inliers into the
+ * same kind of flat pool before computing the energies of the pose candidates (see PreemptiveRansac_CPU::pack_energy_inputs).
+ */
+class CompactScorePredictions
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The offsets of the first mode of each prediction in the mode pool (there is one extra offset at the end, equal to the total number of modes). */
+  ORUIntMemoryBlock_Ptr m_modeOffsets;
+
+  /** The flat pool containing the modes of all of the predictions. */
+  Keypoint3DColourClusterMemoryBlock_Ptr m_modes;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty set of compact SCoRe predictions.
+   */
+  CompactScorePredictions();
+
+  /**
+   * \brief Constructs a compact copy of a block of fixed-capacity SCoRe predictions.
+   *
+   * \note  The predictions are read from the CPU, so the caller must make sure that the CPU copy of the block is up to date.
+   *
+   * \param predictions The block of fixed-capacity SCoRe predictions.
+   */
+  explicit CompactScorePredictions(const ScorePredictionsMemoryBlock& predictions);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Copies the predictions back into a block of fixed-capacity SCoRe predictions.
+   *
+   * \note  Only the CPU copy of the output block is written. If the block is used on the GPU, the caller must update it from the host.
+   *
+   * \param predictions The output block (must contain exactly one entry per prediction).
+   *
+   * \throws std::invalid_argument  If the output block has the wrong size.
+   */
+  void expand_into(ScorePredictionsMemoryBlock& predictions) const;
+
+  /**
+   * \brief Gets the total number of modes stored across all of the predictions.
+   *
+   * \return  The total number of modes stored across all of the predictions.
+   */
+  uint32_t get_mode_count() const;
+
+  /**
+   * \brief Gets the number of predictions stored.
+   *
+   * \return  The number of predictions stored.
+   */
+  uint32_t get_prediction_count() const;
+
+  /**
+   * \brief Loads the predictions from a binary model file.
+   *
+   * \param reader  The reader for the binary model file containing the predictions.
+   *
+   * \throws std::runtime_error If the predictions cannot be loaded.
+   */
+  void load_from_model(const orx::BinaryModelReader& reader);
+
+  /**
+   * \brief Saves the predictions to a binary model file.
+   *
+   * \note The predictions are stored in three chunks: "predictionsFormat" (ScorePrediction::Capacity and sizeof(Keypoint3DColourCluster),
+   *       as uint32_t), "predictionModeOffsets" and "predictionModes".
+   *
+   * \param writer  The writer for the binary model file into which to save the predictions.
+   *
+   * \throws std::runtime_error If the predictions cannot be saved.
+   */
+  void save_to_model(orx::BinaryModelWriter& writer) const;
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Checks that a set of mode offsets that has been loaded from a binary model file is consistent.
+   *
+   * \param modeOffsets     The mode offsets (predictionCount + 1 of them).
+   * \param predictionCount The number of predictions.
+   * \param modeCount       The total number of modes.
+   * \param capacity        The maximum number of modes per prediction.
+   *
+   * \throws std::runtime_error If the mode offsets are inconsistent.
+   */
+  static void check_mode_offsets(const uint *modeOffsets, uint32_t predictionCount, uint32_t modeCount, uint32_t capacity);
+};
+
+}
+
+#endif
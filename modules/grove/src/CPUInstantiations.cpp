@@ -10,6 +10,7 @@
 #include "features/cpu/RGBDPatchFeatureCalculator_CPU.tpp"
 #include "features/interface/RGBDPatchFeatureCalculator.tpp"
 #include "forests/DecisionForestFactory.tpp"
+#include "forests/cpu/BranchFreeDecisionForest_CPU.tpp"
 #include "forests/cpu/DecisionForest_CPU.tpp"
 #include "forests/interface/DecisionForest.tpp"
 #include "reservoirs/ExampleReservoirsFactory.tpp"
@@ -71,6 +72,7 @@ template class RGBDPatchFeatureCalculator<Keypoint3DColour,RGBDPatchDescriptor>;
 template class RGBDPatchFeatureCalculator_CPU<Keypoint2D,RGBDPatchDescriptor>;
 template class RGBDPatchFeatureCalculator_CPU<Keypoint3DColour,RGBDPatchDescriptor>;
 
+template class BranchFreeDecisionForest_CPU<RGBDPatchDescriptor, FOREST_TREES>;
 template class DecisionForest<RGBDPatchDescriptor, FOREST_TREES>;
 template class DecisionForest_CPU<RGBDPatchDescriptor, FOREST_TREES>;
 template struct DecisionForestFactory<RGBDPatchDescriptor, FOREST_TREES>;
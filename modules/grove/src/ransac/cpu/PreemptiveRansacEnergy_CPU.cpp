@@ -0,0 +1,156 @@
+/**
+ * grove: PreemptiveRansacEnergy_CPU.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "ransac/cpu/PreemptiveRansacEnergy_CPU.h"
+
+#include <cmath>
+
+#ifdef WITH_AVX2
+  #include <immintrin.h>
+#endif
+
+namespace grove {
+
+namespace ransac_detail {
+
+//#################### FUNCTIONS ####################
+
+float compute_log_energy_sum(const float *packedPoses, size_t poseStride, int candidateIdx, const float *inlierPoints, const float *inlierLogModeCounts,
+                             const uint32_t *inlierModeOffsets, const float *packedModes, uint32_t nbInliers)
+{
+  float pose[PACKED_POSE_ROWS];
+  for(int k = 0; k < PACKED_POSE_ROWS; ++k)
+  {
+    pose[k] = packedPoses[k * poseStride + candidateIdx];
+  }
+
+  float logEnergySum = 0.0f;
+
+  for(uint32_t inlierIdx = 0; inlierIdx < nbInliers; ++inlierIdx)
+  {
+    // Compute the hypothesised position of the inlier in world space.
+    const float *p = inlierPoints + inlierIdx * 3;
+    const float wx = pose[9] + pose[0] * p[0] + pose[3] * p[1] + pose[6] * p[2];
+    const float wy = pose[10] + pose[1] * p[0] + pose[4] * p[1] + pose[7] * p[2];
+    const float wz = pose[11] + pose[2] * p[0] + pose[5] * p[1] + pose[8] * p[2];
+
+    // Find the mode with the largest log energy.
+    float bestLogEnergy = -INFINITY, bestLogInlierCount = 0.0f;
+    for(uint32_t modeIdx = inlierModeOffsets[inlierIdx], modeEnd = inlierModeOffsets[inlierIdx + 1]; modeIdx < modeEnd; ++modeIdx)
+    {
+      const float *mode = packedModes + modeIdx * PACKED_MODE_SIZE;
+      const float dx = wx - mode[0], dy = wy - mode[1], dz = wz - mode[2];
+      const float ax = dx * mode[3] + dy * mode[6] + dz * mode[9];
+      const float ay = dx * mode[4] + dy * mode[7] + dz * mode[10];
+      const float az = dx * mode[5] + dy * mode[8] + dz * mode[11];
+      const float logEnergy = mode[12] - 0.5f * (dx * ax + dy * ay + dz * az);
+
+      if(logEnergy > bestLogEnergy)
+      {
+        bestLogEnergy = logEnergy;
+        bestLogInlierCount = mode[13];
+      }
+    }
+
+    // Normalise the energy by the number of modes and the number of inliers in the best mode, clamp it and add it to the sum.
+    const float logEnergy = bestLogEnergy - inlierLogModeCounts[inlierIdx] - bestLogInlierCount;
+    logEnergySum += logEnergy > LOG_MIN_ENERGY ? logEnergy : LOG_MIN_ENERGY;
+  }
+
+  return logEnergySum;
+}
+
+void pack_mode(const Keypoint3DColourCluster& mode, float *packedMode)
+{
+  const Vector3f unitX(1.0f, 0.0f, 0.0f), unitY(0.0f, 1.0f, 0.0f), unitZ(0.0f, 0.0f, 1.0f);
+  const Vector3f invCovCols[] = { mode.positionInvCovariance * unitX, mode.positionInvCovariance * unitY, mode.positionInvCovariance * unitZ };
+
+  packedMode[0] = mode.position.x;
+  packedMode[1] = mode.position.y;
+  packedMode[2] = mode.position.z;
+
+  for(int k = 0; k < 3; ++k)
+  {
+    packedMode[3 + k * 3] = invCovCols[k].x;
+    packedMode[4 + k * 3] = invCovCols[k].y;
+    packedMode[5 + k * 3] = invCovCols[k].z;
+  }
+
+  const float logExponent = 3.0f * logf(2.0f * static_cast<float>(M_PI));
+  const float logInlierCount = logf(static_cast<float>(mode.nbInliers));
+  packedMode[12] = mode.determinant > 0.0f ? logInlierCount - 0.5f * (logf(mode.determinant) + logExponent) : -INFINITY;
+  packedMode[13] = logInlierCount;
+}
+
+void pack_pose(const Matrix4f& pose, float *packedPoses, size_t poseStride, int candidateIdx)
+{
+  // Extract the rotation columns and the translation from the pose by transforming the origin and the unit vectors.
+  const Vector3f t = pose * Vector3f(0.0f, 0.0f, 0.0f);
+  const Vector3f cols[] = { pose * Vector3f(1.0f, 0.0f, 0.0f) - t, pose * Vector3f(0.0f, 1.0f, 0.0f) - t, pose * Vector3f(0.0f, 0.0f, 1.0f) - t, t };
+
+  for(int k = 0; k < 4; ++k)
+  {
+    packedPoses[(k * 3 + 0) * poseStride + candidateIdx] = cols[k].x;
+    packedPoses[(k * 3 + 1) * poseStride + candidateIdx] = cols[k].y;
+    packedPoses[(k * 3 + 2) * poseStride + candidateIdx] = cols[k].z;
+  }
+}
+
+#ifdef WITH_AVX2
+void compute_log_energy_sums_avx2(const float *packedPoses, size_t poseStride, int firstCandidateIdx, const float *inlierPoints, const float *inlierLogModeCounts,
+                                  const uint32_t *inlierModeOffsets, const float *packedModes, uint32_t nbInliers, float *logEnergySums)
+{
+  __m256 pose[PACKED_POSE_ROWS];
+  for(int k = 0; k < PACKED_POSE_ROWS; ++k)
+  {
+    pose[k] = _mm256_loadu_ps(packedPoses + k * poseStride + firstCandidateIdx);
+  }
+
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 logMinEnergy = _mm256_set1_ps(LOG_MIN_ENERGY);
+  const __m256 negInf = _mm256_set1_ps(-INFINITY);
+  __m256 logEnergySum = _mm256_setzero_ps();
+
+  for(uint32_t inlierIdx = 0; inlierIdx < nbInliers; ++inlierIdx)
+  {
+    // Compute the hypothesised positions of the inlier in world space (one per candidate).
+    const float *p = inlierPoints + inlierIdx * 3;
+    const __m256 px = _mm256_set1_ps(p[0]), py = _mm256_set1_ps(p[1]), pz = _mm256_set1_ps(p[2]);
+    const __m256 wx = _mm256_fmadd_ps(pose[6], pz, _mm256_fmadd_ps(pose[3], py, _mm256_fmadd_ps(pose[0], px, pose[9])));
+    const __m256 wy = _mm256_fmadd_ps(pose[7], pz, _mm256_fmadd_ps(pose[4], py, _mm256_fmadd_ps(pose[1], px, pose[10])));
+    const __m256 wz = _mm256_fmadd_ps(pose[8], pz, _mm256_fmadd_ps(pose[5], py, _mm256_fmadd_ps(pose[2], px, pose[11])));
+
+    // Find the mode with the largest log energy for each candidate.
+    __m256 bestLogEnergy = negInf, bestLogInlierCount = _mm256_setzero_ps();
+    for(uint32_t modeIdx = inlierModeOffsets[inlierIdx], modeEnd = inlierModeOffsets[inlierIdx + 1]; modeIdx < modeEnd; ++modeIdx)
+    {
+      const float *mode = packedModes + modeIdx * PACKED_MODE_SIZE;
+      const __m256 dx = _mm256_sub_ps(wx, _mm256_set1_ps(mode[0]));
+      const __m256 dy = _mm256_sub_ps(wy, _mm256_set1_ps(mode[1]));
+      const __m256 dz = _mm256_sub_ps(wz, _mm256_set1_ps(mode[2]));
+      const __m256 ax = _mm256_fmadd_ps(dz, _mm256_set1_ps(mode[9]), _mm256_fmadd_ps(dy, _mm256_set1_ps(mode[6]), _mm256_mul_ps(dx, _mm256_set1_ps(mode[3]))));
+      const __m256 ay = _mm256_fmadd_ps(dz, _mm256_set1_ps(mode[10]), _mm256_fmadd_ps(dy, _mm256_set1_ps(mode[7]), _mm256_mul_ps(dx, _mm256_set1_ps(mode[4]))));
+      const __m256 az = _mm256_fmadd_ps(dz, _mm256_set1_ps(mode[11]), _mm256_fmadd_ps(dy, _mm256_set1_ps(mode[8]), _mm256_mul_ps(dx, _mm256_set1_ps(mode[5]))));
+      const __m256 mahalanobisSq = _mm256_fmadd_ps(dz, az, _mm256_fmadd_ps(dy, ay, _mm256_mul_ps(dx, ax)));
+      const __m256 logEnergy = _mm256_fnmadd_ps(half, mahalanobisSq, _mm256_set1_ps(mode[12]));
+
+      const __m256 better = _mm256_cmp_ps(logEnergy, bestLogEnergy, _CMP_GT_OQ);
+      bestLogEnergy = _mm256_blendv_ps(bestLogEnergy, logEnergy, better);
+      bestLogInlierCount = _mm256_blendv_ps(bestLogInlierCount, _mm256_set1_ps(mode[13]), better);
+    }
+
+    // Normalise the energies by the number of modes and the number of inliers in the best modes, clamp them and add them to the sums.
+    const __m256 logEnergy = _mm256_sub_ps(_mm256_sub_ps(bestLogEnergy, _mm256_set1_ps(inlierLogModeCounts[inlierIdx])), bestLogInlierCount);
+    const __m256 aboveMin = _mm256_cmp_ps(logEnergy, logMinEnergy, _CMP_GT_OQ);
+    logEnergySum = _mm256_add_ps(logEnergySum, _mm256_blendv_ps(logMinEnergy, logEnergy, aboveMin));
+  }
+
+  _mm256_storeu_ps(logEnergySums, logEnergySum);
+}
+#endif
+
+}
+
+}
@@ -6,15 +6,20 @@
 #include "ransac/cpu/PreemptiveRansac_CPU.h"
 using namespace tvgutil;
 
+#include <cmath>
+
 #include <Eigen/Dense>
 
 #include <orx/base/MemoryBlockFactory.h>
 using namespace orx;
 
+#include "ransac/cpu/PreemptiveRansacEnergy_CPU.h"
 #include "ransac/shared/PreemptiveRansac_Shared.h"
 
 namespace grove {
 
+using namespace ransac_detail;
+
 //#################### CONSTRUCTORS ####################
 
 PreemptiveRansac_CPU::PreemptiveRansac_CPU(const SettingsContainer_CPtr& settings, const std::string& settingsNamespace)
@@ -54,15 +59,49 @@ void PreemptiveRansac_CPU::compute_energies_and_sort()
 {
   const int nbPoseCandidates = static_cast<int>(m_poseCandidates->dataSize);
   PoseCandidate *poseCandidates = m_poseCandidates->GetData(MEMORYDEVICE_CPU);
+  const uint32_t nbInliers = static_cast<uint32_t>(m_inlierRasterIndicesBlock->dataSize);
+
+  // Pack the inliers, their modes and the pose candidates into flat arrays that are better suited to the energy computation.
+  pack_energy_inputs();
+
+  const float *packedPoses = &m_packedPoses[0];
+  const size_t poseStride = m_packedPoses.size() / PACKED_POSE_ROWS;
+  const float *inlierPoints = m_packedInlierPoints.empty() ? NULL : &m_packedInlierPoints[0];
+  const float *inlierLogModeCounts = m_packedInlierLogModeCounts.empty() ? NULL : &m_packedInlierLogModeCounts[0];
+  const uint32_t *inlierModeOffsets = &m_packedInlierModeOffsets[0];
+  const float *packedModes = m_packedModes.empty() ? NULL : &m_packedModes[0];
+
+  // The energy of a candidate is the mean over the inliers of the negative log10 of their energies, so we convert the log energy sums accordingly.
+  const float energyScale = -1.0f / (logf(10.0f) * static_cast<float>(nbInliers));
 
   // Compute the energies for all pose candidates.
+#ifdef WITH_AVX2
+  const int nbBatches = (nbPoseCandidates + CANDIDATE_BATCH_SIZE - 1) / CANDIDATE_BATCH_SIZE;
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int batchIdx = 0; batchIdx < nbBatches; ++batchIdx)
+  {
+    const int firstCandidateIdx = batchIdx * CANDIDATE_BATCH_SIZE;
+    float logEnergySums[CANDIDATE_BATCH_SIZE];
+    compute_log_energy_sums_avx2(packedPoses, poseStride, firstCandidateIdx, inlierPoints, inlierLogModeCounts, inlierModeOffsets, packedModes, nbInliers, logEnergySums);
+
+    for(int i = 0; i < CANDIDATE_BATCH_SIZE && firstCandidateIdx + i < nbPoseCandidates; ++i)
+    {
+      poseCandidates[firstCandidateIdx + i].energy = logEnergySums[i] * energyScale;
+    }
+  }
+#else
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
   for(int i = 0; i < nbPoseCandidates; ++i)
   {
-    compute_pose_energy(poseCandidates[i]);
+    const float logEnergySum = compute_log_energy_sum(packedPoses, poseStride, i, inlierPoints, inlierLogModeCounts, inlierModeOffsets, packedModes, nbInliers);
+    poseCandidates[i].energy = logEnergySum * energyScale;
   }
+#endif
 
   // Sort the candidates into non-decreasing order of energy.
   std::sort(poseCandidates, poseCandidates + nbPoseCandidates);
@@ -187,17 +226,6 @@ void PreemptiveRansac_CPU::update_candidate_poses()
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void PreemptiveRansac_CPU::compute_pose_energy(PoseCandidate& candidate) const
-{
-  const int *inlierRasterIndices = m_inlierRasterIndicesBlock->GetData(MEMORYDEVICE_CPU);
-  const Keypoint3DColour *keypointsImage = m_keypointsImage->GetData(MEMORYDEVICE_CPU);
-  const uint32_t nbInliers = static_cast<uint32_t>(m_inlierRasterIndicesBlock->dataSize);
-  const ScorePrediction *predictionsImage = m_predictionsImage->GetData(MEMORYDEVICE_CPU);
-
-  const float energySum = compute_energy_sum_for_inliers(candidate.cameraPose, keypointsImage, predictionsImage, inlierRasterIndices, nbInliers);
-  candidate.energy = energySum / static_cast<float>(nbInliers);
-}
-
 void PreemptiveRansac_CPU::init_random()
 {
   // Initialise each random number generator based on the specified seed.
@@ -208,4 +236,71 @@ void PreemptiveRansac_CPU::init_random()
   }
 }
 
+void PreemptiveRansac_CPU::pack_energy_inputs()
+{
+  const int *inlierRasterIndices = m_inlierRasterIndicesBlock->GetData(MEMORYDEVICE_CPU);
+  const Keypoint3DColour *keypoints = m_keypointsImage->GetData(MEMORYDEVICE_CPU);
+  const uint32_t nbInliers = static_cast<uint32_t>(m_inlierRasterIndicesBlock->dataSize);
+  const int nbPoseCandidates = static_cast<int>(m_poseCandidates->dataSize);
+  const PoseCandidate *poseCandidates = m_poseCandidates->GetData(MEMORYDEVICE_CPU);
+  const ScorePrediction *predictions = m_predictionsImage->GetData(MEMORYDEVICE_CPU);
+
+  // Compute the offsets of the modes associated with each inlier. We expect each inlier to have at least one valid mode
+  // (this is guaranteed by the inlier sampling process), and each mode to have at least some inliers (this is guaranteed
+  // by the clustering process). If this isn't the case for some reason, defensively throw. These are the same checks as
+  // in compute_energy_sum_for_inlier_subset, but they are made here, before the energies are computed in parallel, since
+  // exceptions cannot propagate out of an OpenMP parallel region.
+  m_packedInlierModeOffsets.resize(nbInliers + 1);
+  m_packedInlierModeOffsets[0] = 0;
+  for(uint32_t i = 0; i < nbInliers; ++i)
+  {
+    const ScorePrediction& prediction = predictions[inlierRasterIndices[i]];
+    if(prediction.size == 0) throw std::runtime_error("prediction has no valid modes");
+
+    for(int j = 0; j < prediction.size; ++j)
+    {
+      if(prediction.elts[j].nbInliers == 0) throw std::runtime_error("mode has no inliers");
+    }
+
+    m_packedInlierModeOffsets[i + 1] = m_packedInlierModeOffsets[i] + static_cast<uint32_t>(prediction.size);
+  }
+
+  // Pack the inliers and their modes (see pack_mode).
+  m_packedInlierPoints.resize(nbInliers * 3);
+  m_packedInlierLogModeCounts.resize(nbInliers);
+  m_packedModes.resize(m_packedInlierModeOffsets[nbInliers] * PACKED_MODE_SIZE);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < static_cast<int>(nbInliers); ++i)
+  {
+    const int rasterIdx = inlierRasterIndices[i];
+    const Vector3f& position = keypoints[rasterIdx].position;
+    const ScorePrediction& prediction = predictions[rasterIdx];
+
+    float *packedPoint = &m_packedInlierPoints[i * 3];
+    packedPoint[0] = position.x;
+    packedPoint[1] = position.y;
+    packedPoint[2] = position.z;
+
+    m_packedInlierLogModeCounts[i] = logf(static_cast<float>(prediction.size));
+
+    for(int j = 0; j < prediction.size; ++j)
+    {
+      pack_mode(prediction.elts[j], &m_packedModes[(m_packedInlierModeOffsets[i] + j) * PACKED_MODE_SIZE]);
+    }
+  }
+
+  // Pack the pose candidates in structure-of-arrays form, padding the number of candidates to a multiple of the batch size.
+  const size_t poseStride = ((nbPoseCandidates + CANDIDATE_BATCH_SIZE - 1) / CANDIDATE_BATCH_SIZE) * CANDIDATE_BATCH_SIZE;
+  m_packedPoses.assign(std::max<size_t>(poseStride, CANDIDATE_BATCH_SIZE) * PACKED_POSE_ROWS, 0.0f);
+  const size_t paddedStride = m_packedPoses.size() / PACKED_POSE_ROWS;
+
+  for(int i = 0; i < nbPoseCandidates; ++i)
+  {
+    pack_pose(poseCandidates[i].cameraPose, &m_packedPoses[0], paddedStride, i);
+  }
+}
+
 }
@@ -104,17 +104,10 @@ PreemptiveRansac::~PreemptiveRansac()
 {
   if(m_printTimers)
   {
-    print_timer(m_timerTotal);
-    print_timer(m_timerCandidateGeneration);
-    print_timer(m_timerFirstTrim);
-    print_timer(m_timerFirstComputeEnergy);
-
-    for(size_t i = 0; i < m_timerInlierSampling.size(); ++i)
+    const std::vector<AverageTimer> timers = get_timers();
+    for(size_t i = 0, size = timers.size(); i < size; ++i)
     {
-      print_timer(m_timerInlierSampling[i]);
-      print_timer(m_timerComputeEnergy[i]);
-      print_timer(m_timerPrepareOptimisation[i]);
-      print_timer(m_timerOptimisation[i]);
+      print_timer(timers[i]);
     }
   }
 }
@@ -310,6 +303,25 @@ uint32_t PreemptiveRansac::get_min_nb_required_points() const
   return m_ransacInliersPerIteration;
 }
 
+std::vector<PreemptiveRansac::AverageTimer> PreemptiveRansac::get_timers() const
+{
+  std::vector<AverageTimer> timers;
+  timers.push_back(m_timerTotal);
+  timers.push_back(m_timerCandidateGeneration);
+  timers.push_back(m_timerFirstTrim);
+  timers.push_back(m_timerFirstComputeEnergy);
+
+  for(size_t i = 0; i < m_timerInlierSampling.size(); ++i)
+  {
+    timers.push_back(m_timerInlierSampling[i]);
+    timers.push_back(m_timerComputeEnergy[i]);
+    timers.push_back(m_timerPrepareOptimisation[i]);
+    timers.push_back(m_timerOptimisation[i]);
+  }
+
+  return timers;
+}
+
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
 void PreemptiveRansac::compute_candidate_poses_kabsch()
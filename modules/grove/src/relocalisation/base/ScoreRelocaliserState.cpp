@@ -12,9 +12,12 @@ namespace bf = boost::filesystem;
 using namespace ORUtils;
 
 #include <orx/base/MemoryBlockFactory.h>
+#include <orx/persistence/BinaryModelReader.h>
+#include <orx/persistence/BinaryModelWriter.h>
 using namespace orx;
 
 #include "reservoirs/ExampleReservoirsFactory.h"
+#include "scoreforests/CompactScorePredictions.h"
 
 namespace grove {
 
@@ -35,6 +38,9 @@ void ScoreRelocaliserState::load_from_disk(const std::string& inputFolder)
   // Load the reservoirs.
   exampleReservoirs->load_from_disk(inputFolder);
 
+  // Prevent the predictions from being used for relocalisation whilst they are being loaded.
+  boost::unique_lock<boost::shared_mutex> lock(predictionsMutex);
+
   // Load the predictions.
   MemoryBlockPersister::LoadMemoryBlock((inputPath / "scorePredictions.bin").string(), *predictionsBlock, MEMORYDEVICE_CPU);
 
@@ -48,6 +54,51 @@ void ScoreRelocaliserState::load_from_disk(const std::string& inputFolder)
   if(!inFile) throw std::runtime_error("Error: Couldn't load relocaliser data from " + dataFile);
 }
 
+void ScoreRelocaliserState::load_from_model(const BinaryModelReader& reader)
+{
+  // Load the reservoirs (if they were saved).
+  if(exampleReservoirs && reader.has_chunk("reservoirs")) exampleReservoirs->load_from_model(reader);
+  else if(exampleReservoirs) exampleReservoirs->reset();
+
+  // Load the rest of the data.
+  const std::vector<uint32_t> indices = reader.read_vector<uint32_t>("relocaliserIndices");
+  if(indices.size() != 2) throw std::runtime_error("Error: Couldn't load relocaliser data from the model");
+
+  // Prevent the predictions from being used for relocalisation whilst they are being loaded.
+  boost::unique_lock<boost::shared_mutex> lock(predictionsMutex);
+
+  // Load the predictions, and copy them across to the GPU if necessary.
+  CompactScorePredictions compactPredictions;
+  compactPredictions.load_from_model(reader);
+  compactPredictions.expand_into(*predictionsBlock);
+  predictionsBlock->UpdateDeviceFromHost();
+
+  lastExamplesAddedStartIdx = indices[0];
+  reservoirUpdateStartIdx = indices[1];
+}
+
+void ScoreRelocaliserState::publish_predictions(const ScorePredictionsMemoryBlock_CPtr& stagedPredictions, uint32_t startIdx, uint32_t count)
+{
+  // Copy the newly-computed clusters into place. Any relocalisation that is currently reading
+  // the clusters will finish doing so before we are able to take the lock.
+  boost::unique_lock<boost::shared_mutex> lock(predictionsMutex);
+
+  if(m_deviceType == DEVICE_CUDA)
+  {
+#ifdef WITH_CUDA
+    ORcudaSafeCall(cudaMemcpy(
+      predictionsBlock->GetData(MEMORYDEVICE_CUDA) + startIdx, stagedPredictions->GetData(MEMORYDEVICE_CUDA),
+      count * sizeof(ScorePrediction), cudaMemcpyDeviceToDevice
+    ));
+#endif
+  }
+  else
+  {
+    const ScorePrediction *src = stagedPredictions->GetData(MEMORYDEVICE_CPU);
+    std::copy(src, src + count, predictionsBlock->GetData(MEMORYDEVICE_CPU) + startIdx);
+  }
+}
+
 void ScoreRelocaliserState::reset()
 {
   // Set up the reservoirs if they aren't currently allocated.
@@ -59,13 +110,15 @@ void ScoreRelocaliserState::reset()
   // Set up the predictions block if it isn't currently allocated.
   if(!predictionsBlock)
   {
-    predictionsBlock = MemoryBlockFactory::instance().make_block<ScorePrediction>(m_reservoirCount);
+    predictionsBlock = MemoryBlockFactory::instance().make_block<ScorePrediction>(m_reservoirCount, "relocaliser");
   }
 
   exampleReservoirs->reset();
   lastExamplesAddedStartIdx = 0;
-  predictionsBlock->Clear();
   reservoirUpdateStartIdx = 0;
+
+  boost::unique_lock<boost::shared_mutex> lock(predictionsMutex);
+  predictionsBlock->Clear();
 }
 
 void ScoreRelocaliserState::save_to_disk(const std::string& outputFolder) const
@@ -75,6 +128,9 @@ void ScoreRelocaliserState::save_to_disk(const std::string& outputFolder) const
   // Save the reservoirs.
   exampleReservoirs->save_to_disk(outputFolder);
 
+  // Prevent the predictions from being updated whilst they are being saved.
+  boost::shared_lock<boost::shared_mutex> lock(predictionsMutex);
+
   // If we're using the GPU, copy the predictions across to the CPU so that they can be saved.
   predictionsBlock->UpdateHostFromDevice();
 
@@ -88,4 +144,23 @@ void ScoreRelocaliserState::save_to_disk(const std::string& outputFolder) const
   if(!outFile) throw std::runtime_error("Error: Couldn't save relocaliser data in " + dataFile);
 }
 
+void ScoreRelocaliserState::save_to_model(BinaryModelWriter& writer) const
+{
+  // Save the reservoirs (if they still exist).
+  if(exampleReservoirs) exampleReservoirs->save_to_model(writer);
+
+  // Save the predictions in compact form, preventing them from being updated whilst doing so.
+  {
+    boost::shared_lock<boost::shared_mutex> lock(predictionsMutex);
+    predictionsBlock->UpdateHostFromDevice();
+    CompactScorePredictions(*predictionsBlock).save_to_model(writer);
+  }
+
+  // Save the rest of the data.
+  std::vector<uint32_t> indices(2);
+  indices[0] = lastExamplesAddedStartIdx;
+  indices[1] = reservoirUpdateStartIdx;
+  writer.write_vector("relocaliserIndices", indices);
+}
+
 }
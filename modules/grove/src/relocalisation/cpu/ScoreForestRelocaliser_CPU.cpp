@@ -7,6 +7,8 @@
 using namespace ORUtils;
 using namespace tvgutil;
 
+#include "features/shared/RGBDPatchFeatureCalculator_Shared.h"
+#include "forests/shared/DecisionForest_Shared.h"
 #include "relocalisation/shared/ScoreForestRelocaliser_Shared.h"
 
 namespace grove {
@@ -15,10 +17,77 @@ namespace grove {
 
 ScoreForestRelocaliser_CPU::ScoreForestRelocaliser_CPU(const SettingsContainer_CPtr& settings, const std::string& settingsNamespace)
 : ScoreForestRelocaliser(settings, settingsNamespace, DEVICE_CPU)
-{}
+{
+  m_computeFeaturesOnDemand = m_settings->get_first_value<bool>(settingsNamespace + "computeFeaturesOnDemand", false);
+}
 
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
+void ScoreForestRelocaliser_CPU::compute_features(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                                                  const Matrix4f& cameraPose, const Vector4f& depthIntrinsics) const
+{
+  // If we're not computing the features on demand, compute the full descriptors and then pass them down the forest.
+  if(!m_computeFeaturesOnDemand)
+  {
+    ScoreForestRelocaliser::compute_features(workspace, colourImage, depthImage, cameraPose, depthIntrinsics);
+    return;
+  }
+
+  const Keypoint3DColourImage_Ptr& keypointsImage = workspace.keypointsImage;
+  const LeafIndicesImage_Ptr& leafIndicesImage = static_cast<ForestWorkspace&>(workspace).leafIndicesImage;
+
+  // Check that the input images are valid and compute the output dimensions.
+  const Vector2i outSize = m_featureCalculator->compute_output_dims(colourImage, depthImage);
+
+  // Ensure the output images are the right size (this is a no-op after the first time).
+  keypointsImage->ChangeDims(outSize);
+  leafIndicesImage->ChangeDims(outSize);
+
+  const float *depths = depthImage->GetData(MEMORYDEVICE_CPU);
+  const Vector2i& depthSize = depthImage->noDims;
+  const Vector4u *rgb = colourImage ? colourImage->GetData(MEMORYDEVICE_CPU) : NULL;
+  const Vector2i rgbSize = colourImage ? colourImage->noDims : depthSize;
+  const ScoreForest::NodeEntry *nodeImage = m_scoreForest->get_node_image()->GetData(MEMORYDEVICE_CPU);
+  const RGBDPatchFeatureEvaluator featureEvaluator = m_featureCalculator->make_feature_evaluator(colourImage, depthImage, MEMORYDEVICE_CPU);
+
+  Keypoint3DColour *keypoints = keypointsImage->GetData(MEMORYDEVICE_CPU);
+  LeafIndices *leafIndices = leafIndicesImage->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int yOut = 0; yOut < outSize.height; ++yOut)
+  {
+    // Make a copy of the feature evaluator for the current row (its per-pixel parameters will be overwritten for each pixel).
+    RGBDPatchFeatureEvaluator pixelEvaluator = featureEvaluator;
+
+    for(int xOut = 0; xOut < outSize.width; ++xOut)
+    {
+      const Vector2i xyOut(xOut, yOut);
+      const int rasterIdxOut = yOut * outSize.width + xOut;
+      pixelEvaluator.xyDepth = map_pixel_coordinates(xyOut, outSize, depthSize);
+      pixelEvaluator.xyRgb = map_pixel_coordinates(xyOut, outSize, rgbSize);
+
+      // Compute the keypoint for the pixel.
+      compute_keypoint(pixelEvaluator.xyDepth, pixelEvaluator.xyRgb, xyOut, depthSize, rgbSize, outSize, depths, rgb, cameraPose, depthIntrinsics, keypoints);
+
+      // If the keypoint is valid, pass it down the forest, computing the features tested at each branch node as we go.
+      // Otherwise, its leaves will never be used, so we simply point it at the first leaf of each tree.
+      if(keypoints[rasterIdxOut].valid)
+      {
+        compute_leaf_indices_on_demand(pixelEvaluator, nodeImage, leafIndices[rasterIdxOut]);
+      }
+      else
+      {
+        for(int treeIdx = 0; treeIdx < FOREST_TREE_COUNT; ++treeIdx)
+        {
+          leafIndices[rasterIdxOut][treeIdx] = 0;
+        }
+      }
+    }
+  }
+}
+
 void ScoreForestRelocaliser_CPU::merge_predictions_for_keypoints(const LeafIndicesImage_CPtr& leafIndices, ScorePredictionsImage_Ptr& outputPredictions) const
 {
   const Vector2i imgSize = leafIndices->noDims;
@@ -11,6 +11,8 @@ using namespace ORUtils;
 #endif
 
 #include <orx/base/MemoryBlockFactory.h>
+#include <orx/persistence/BinaryModelReader.h>
+#include <orx/persistence/BinaryModelWriter.h>
 using namespace orx;
 
 #include <tvgutil/filesystem/PathFinder.h>
@@ -25,21 +27,18 @@ namespace grove {
 ScoreForestRelocaliser::ScoreForestRelocaliser(const SettingsContainer_CPtr& settings, const std::string& settingsNamespace, DeviceType deviceType)
 : ScoreRelocaliser(settings, settingsNamespace, deviceType)
 {
-  // Allocate the internal images.
-  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
-  m_leafIndicesImage = mbf.make_image<LeafIndices>();
-
-  // Either construct a random SCoRe forest, or load one from disk.
+  // Either construct a random SCoRe forest, or load one from disk. When on the CPU, the forest can optionally be evaluated without branching.
+  const bool branchFreeForest = m_settings->get_first_value<bool>(settingsNamespace + "branchFreeForest", false);
   const bool randomlyGenerateForest = m_settings->get_first_value<bool>(settingsNamespace + "randomlyGenerateForest", false);
   if(randomlyGenerateForest)
   {
-    m_scoreForest = DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_randomly_generated_forest(m_settings, deviceType);
+    m_scoreForest = DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_randomly_generated_forest(m_settings, deviceType, branchFreeForest);
   }
   else
   {
     const std::string modelFilename = m_settings->get_first_value<std::string>(settingsNamespace + "modelFilename", (find_subdir_from_executable("resources") / "DefaultRelocalisationForest.rf").string());
     std::cout << "Loading relocalisation forest from: " << modelFilename << '\n';
-    m_scoreForest = DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_forest(modelFilename, deviceType);
+    m_scoreForest = DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_forest(modelFilename, deviceType, branchFreeForest);
   }
 
   // Set the number of reservoirs to allocate to the number of leaves in the forest (i.e. there will be one reservoir per leaf).
@@ -58,6 +57,7 @@ ScorePrediction ScoreForestRelocaliser::get_prediction(uint32_t treeIdx, uint32_
 
   // Look up the prediction associated with the leaf and return it.
   const MemoryDeviceType memoryType = m_deviceType == DEVICE_CUDA ? MEMORYDEVICE_CUDA : MEMORYDEVICE_CPU;
+  boost::shared_lock<boost::shared_mutex> lock(m_relocaliserState->predictionsMutex);
   return m_relocaliserState->predictionsBlock->GetElement(leafIdx * m_scoreForest->get_nb_trees() + treeIdx, memoryType);
 }
 
@@ -95,6 +95,16 @@ ORUChar4Image_CPtr ScoreForestRelocaliser::get_visualisation_image(const std::st
 
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
+void ScoreForestRelocaliser::compute_features(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                                              const Matrix4f& cameraPose, const Vector4f& depthIntrinsics) const
+{
+  // Extract keypoints from the RGB-D image and compute descriptors for them.
+  ScoreRelocaliser::compute_features(workspace, colourImage, depthImage, cameraPose, depthIntrinsics);
+
+  // Find all of the leaves in the forest that are associated with the descriptors for the keypoints.
+  m_scoreForest->find_leaves(workspace.descriptorsImage, static_cast<ForestWorkspace&>(workspace).leafIndicesImage);
+}
+
 void ScoreForestRelocaliser::ensure_valid_leaf(uint32_t treeIdx, uint32_t leafIdx) const
 {
   if(treeIdx >= m_scoreForest->get_nb_trees() || leafIdx >= m_scoreForest->get_nb_leaves_in_tree(treeIdx))
@@ -103,60 +113,88 @@ void ScoreForestRelocaliser::ensure_valid_leaf(uint32_t treeIdx, uint32_t leafId
   }
 }
 
-void ScoreForestRelocaliser::make_visualisation_images(const ORFloatImage *depthImage, const std::vector<Result>& results) const
+void ScoreForestRelocaliser::load_from_model_sub(const BinaryModelReader& reader)
 {
-  ScoreRelocaliser::make_visualisation_images(depthImage, results);
-  update_pixels_to_leaves_image(depthImage);
+  // If the model doesn't contain a forest, keep the current one.
+  if(!reader.has_chunk("forestShape")) return;
+
+  // Otherwise, check that the forest in the model has the same number of leaves as the current one (the relocaliser
+  // state has one reservoir and one prediction per leaf, so it can't be resized here), and then replace the forest.
+  const std::vector<uint32_t> shape = reader.read_vector<uint32_t>("forestShape");
+  const uint32_t treeCount = m_scoreForest->get_nb_trees();
+  uint32_t leafCount = 0;
+  for(size_t i = 2 + treeCount; i < shape.size(); ++i) leafCount += shape[i];
+
+  if(leafCount != m_reservoirCount)
+  {
+    throw std::runtime_error("Error: The forest in the model has a different number of leaves from the relocaliser's current forest");
+  }
+
+  m_scoreForest->load_structure_from_model(reader);
 }
 
-void ScoreForestRelocaliser::make_predictions(const ORUChar4Image *colourImage) const
+void ScoreForestRelocaliser::make_predictions(Workspace& workspace, const ORUChar4Image *colourImage) const
 {
-  // Find all of the leaves in the forest that are associated with the descriptors for the keypoints.
-  m_scoreForest->find_leaves(m_descriptorsImage, m_leafIndicesImage);
+  // Note: The leaves in the forest that are associated with the keypoints have already been found by compute_features.
 
   // Merge the SCoRe predictions (sets of clusters) associated with each keypoint to create a single SCoRe prediction per keypoint.
-  merge_predictions_for_keypoints(m_leafIndicesImage, m_predictionsImage);
+  merge_predictions_for_keypoints(static_cast<ForestWorkspace&>(workspace).leafIndicesImage, workspace.predictionsImage);
 }
 
-void ScoreForestRelocaliser::train_sub(const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
-                                       const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose)
+void ScoreForestRelocaliser::make_visualisation_images(const Workspace& workspace, const ORFloatImage *depthImage, const std::vector<Result>& results) const
 {
-  // Extract keypoints from the RGB-D image and compute descriptors for them.
-  const Matrix4f invCameraPose = cameraPose.GetInvM();
-  m_featureCalculator->compute_keypoints_and_features(colourImage, depthImage, invCameraPose, depthIntrinsics, m_keypointsImage.get(), m_descriptorsImage.get());
+  ScoreRelocaliser::make_visualisation_images(workspace, depthImage, results);
+  update_pixels_to_leaves_image(static_cast<const ForestWorkspace&>(workspace).leafIndicesImage, depthImage);
+}
 
-  // Find all of the leaves in the forest that are associated with the descriptors for the keypoints.
-  m_scoreForest->find_leaves(m_descriptorsImage, m_leafIndicesImage);
+ScoreRelocaliser::Workspace_Ptr ScoreForestRelocaliser::make_workspace() const
+{
+  boost::shared_ptr<ForestWorkspace> workspace(new ForestWorkspace);
+  allocate_workspace_images(*workspace);
+  workspace->leafIndicesImage = MemoryBlockFactory::instance().make_image<LeafIndices>(Vector2i(0, 0), "relocaliser");
+  return workspace;
+}
+
+void ScoreForestRelocaliser::save_to_model_sub(BinaryModelWriter& writer) const
+{
+  m_scoreForest->save_structure_to_model(writer);
+}
+
+void ScoreForestRelocaliser::train_sub(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                                       const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose)
+{
+  // Extract keypoints from the RGB-D image and find all of the leaves in the forest that are associated with them.
+  compute_features(workspace, colourImage, depthImage, cameraPose.GetInvM(), depthIntrinsics);
 
   // Add the keypoints to the relevant reservoirs.
-  m_relocaliserState->exampleReservoirs->add_examples(m_keypointsImage, m_leafIndicesImage);
+  m_relocaliserState->exampleReservoirs->add_examples(workspace.keypointsImage, static_cast<ForestWorkspace&>(workspace).leafIndicesImage);
 }
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void ScoreForestRelocaliser::update_pixels_to_leaves_image(const ORFloatImage *depthImage) const
+void ScoreForestRelocaliser::update_pixels_to_leaves_image(const LeafIndicesImage_CPtr& leafIndicesImage, const ORFloatImage *depthImage) const
 {
 #ifdef WITH_OPENCV
   // Ensure that the depth image and leaf indices are available on the CPU.
   depthImage->UpdateHostFromDevice();
-  m_leafIndicesImage->UpdateHostFromDevice();
+  leafIndicesImage->UpdateHostFromDevice();
 
   // Make a map showing which pixels are in which leaves (for the first tree).
   std::map<int,std::vector<int> > leafToRegionMap;
-  for(int i = 0, pixelCount = static_cast<int>(m_leafIndicesImage->dataSize); i < pixelCount; ++i)
+  for(int i = 0, pixelCount = static_cast<int>(leafIndicesImage->dataSize); i < pixelCount; ++i)
   {
-    const ORUtils::VectorX<int,FOREST_TREE_COUNT>& elt = m_leafIndicesImage->GetData(MEMORYDEVICE_CPU)[i];
+    const ORUtils::VectorX<int,FOREST_TREE_COUNT>& elt = leafIndicesImage->GetData(MEMORYDEVICE_CPU)[i];
     leafToRegionMap[elt[0]].push_back(i);
   }
 
   // Make greyscale and colour images showing which pixels are in which leaves (for the first tree).
-  cv::Mat1b imageG = cv::Mat1b::zeros(m_leafIndicesImage->noDims.y, m_leafIndicesImage->noDims.x);
+  cv::Mat1b imageG = cv::Mat1b::zeros(leafIndicesImage->noDims.y, leafIndicesImage->noDims.x);
   const uint32_t featureStep = m_featureCalculator->get_feature_step();
   for(std::map<int,std::vector<int> >::const_iterator jt = leafToRegionMap.begin(), jend = leafToRegionMap.end(); jt != jend; ++jt)
   {
     for(std::vector<int>::const_iterator kt = jt->second.begin(), kend = jt->second.end(); kt != kend; ++kt)
     {
-      int x = *kt % m_leafIndicesImage->noDims.x, y = *kt / m_leafIndicesImage->noDims.x;
+      int x = *kt % leafIndicesImage->noDims.x, y = *kt / leafIndicesImage->noDims.x;
       if(depthImage->GetData(MEMORYDEVICE_CPU)[y * featureStep * depthImage->noDims.x + x * featureStep] > 0.0f)
       {
         imageG(y,x) = jt->first % 256;
@@ -23,19 +23,20 @@ ScoreGTRelocaliser::ScoreGTRelocaliser(const tvgutil::SettingsContainer_CPtr& se
 
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
-void ScoreGTRelocaliser::make_predictions(const ORUChar4Image *colourImage) const
+void ScoreGTRelocaliser::make_predictions(Workspace& workspace, const ORUChar4Image *colourImage) const
 {
   // If a ground truth pose is available for this frame, create a "ground truth" SCoRe prediction
   // that has only one cluster (containing a single world-space point) for each keypoint.
-  if(m_groundTruthTrajectory && m_groundTruthFrameIndex < m_groundTruthTrajectory->size())
+  const size_t frameIndex = workspace.groundTruthFrameIndex;
+  if(m_groundTruthTrajectory && frameIndex < m_groundTruthTrajectory->size())
   {
-    const Matrix4f& cameraToWorld = (*m_groundTruthTrajectory)[m_groundTruthFrameIndex].GetInvM();
-    set_ground_truth_predictions_for_keypoints(m_keypointsImage, cameraToWorld, m_predictionsImage);
+    const Matrix4f& cameraToWorld = (*m_groundTruthTrajectory)[frameIndex].GetInvM();
+    set_ground_truth_predictions_for_keypoints(workspace.keypointsImage, cameraToWorld, workspace.predictionsImage);
   }
-  else throw std::runtime_error("Error: Ground truth pose not available for frame " + boost::lexical_cast<std::string>(m_groundTruthFrameIndex));
+  else throw std::runtime_error("Error: Ground truth pose not available for frame " + boost::lexical_cast<std::string>(frameIndex));
 }
 
-void ScoreGTRelocaliser::train_sub(const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+void ScoreGTRelocaliser::train_sub(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
                                    const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose)
 {
   // No-op
@@ -31,18 +31,11 @@ ScoreNetRelocaliser::ScoreNetRelocaliser(const tvgutil::SettingsContainer_CPtr&
   m_reservoirCount = m_settings->get_first_value<unsigned int>(settingsNamespace + "reservoirCount", 40000);
   m_sceneSizeCm = m_settings->get_first_value<int>(settingsNamespace + "sceneSizeCm", 10000);
 
-  // Allocate the internal images.
-  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
-  m_bucketIndicesImage = mbf.make_image<BucketIndices>();
-
   // Load the SCoRe network from disk.
   const std::string modelFilename = m_settings->get_first_value<std::string>(settingsNamespace + "modelFilename", (find_subdir_from_executable("resources") / "DefaultScoreNet.pt").string());
   m_scoreNet = torch::jit::load(modelFilename);
   if(deviceType == DEVICE_CUDA) m_scoreNet->to(torch::kCUDA);
 
-  // Allocate a memory block to hold the output of the SCoRe network.
-  m_scoreNetOutput = MemoryBlockFactory::instance().make_block<float>();
-
   // Set the step for the feature calculator to ensure that the keypoint/descriptor images are the same size as the network output.
   m_featureCalculator->set_feature_step(8);
 
@@ -55,33 +48,55 @@ ScoreNetRelocaliser::ScoreNetRelocaliser(const tvgutil::SettingsContainer_CPtr&
 void ScoreNetRelocaliser::reset()
 {
   ScoreRelocaliser::reset();
+
+  boost::lock_guard<boost::mutex> lock(m_netMutex);
   m_bucketRemapper.clear();
   m_rng.reset(new RandomNumberGenerator(m_rngSeed));
 }
 
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
-void ScoreNetRelocaliser::make_predictions(const ORUChar4Image *colourImage) const
+void ScoreNetRelocaliser::make_predictions(Workspace& workspace, const ORUChar4Image *colourImage) const
 {
+  NetWorkspace& netWorkspace = static_cast<NetWorkspace&>(workspace);
+
   if(m_useBucketPredictions)
   {
     // Find the buckets (example reservoirs) corresponding to the keypoints.
-    find_reservoirs(colourImage, false);
+    {
+      boost::lock_guard<boost::mutex> lock(m_netMutex);
+      find_reservoirs(netWorkspace, colourImage, false);
+    }
 
     // Copy the clusters for each keypoint across to the SCoRe predictions image.
-    set_bucket_predictions_for_keypoints(m_bucketIndicesImage, m_predictionsImage);
+    set_bucket_predictions_for_keypoints(netWorkspace.bucketIndicesImage, workspace.predictionsImage);
   }
   else
   {
     // Run the network on the colour image to predict a world space point for each keypoint.
-    run_net(colourImage);
+    {
+      boost::lock_guard<boost::mutex> lock(m_netMutex);
+      run_net(netWorkspace, colourImage);
+    }
 
     // For each keypoint, copy its corresponding world space point into a single cluster for the keypoint in the SCoRe predictions image.
-    set_net_predictions_for_keypoints(m_keypointsImage, m_scoreNetOutput, m_predictionsImage);
+    set_net_predictions_for_keypoints(workspace.keypointsImage, netWorkspace.scoreNetOutput, workspace.predictionsImage);
   }
 }
 
-void ScoreNetRelocaliser::train_sub(const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+ScoreRelocaliser::Workspace_Ptr ScoreNetRelocaliser::make_workspace() const
+{
+  boost::shared_ptr<NetWorkspace> workspace(new NetWorkspace);
+  allocate_workspace_images(*workspace);
+
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  workspace->bucketIndicesImage = mbf.make_image<BucketIndices>(Vector2i(0, 0), "relocaliser");
+  workspace->scoreNetOutput = mbf.make_block<float>(0, "relocaliser");
+
+  return workspace;
+}
+
+void ScoreNetRelocaliser::train_sub(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
                                     const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose)
 {
   // If we're not using bucketing, don't waste any time filling the reservoirs (we'll be using the raw network predictions instead).
@@ -90,30 +105,36 @@ void ScoreNetRelocaliser::train_sub(const ORUChar4Image *colourImage, const ORFl
   // Extract keypoints from the RGB-D image and compute descriptors for them.
   // FIXME: We don't need to compute the descriptors when we're using the net (we should allow keypoints to be computed without also computing the descriptors).
   const Matrix4f invCameraPose = cameraPose.GetInvM();
-  m_featureCalculator->compute_keypoints_and_features(colourImage, depthImage, invCameraPose, depthIntrinsics, m_keypointsImage.get(), m_descriptorsImage.get());
+  m_featureCalculator->compute_keypoints_and_features(
+    colourImage, depthImage, invCameraPose, depthIntrinsics, workspace.keypointsImage.get(), workspace.descriptorsImage.get()
+  );
 
   // Find the reservoirs to which we should add the keypoints, allocating new reservoirs if necessary.
-  find_reservoirs(colourImage, true);
+  NetWorkspace& netWorkspace = static_cast<NetWorkspace&>(workspace);
+  {
+    boost::lock_guard<boost::mutex> lock(m_netMutex);
+    find_reservoirs(netWorkspace, colourImage, true);
+  }
 
   // Add the keypoints to the relevant reservoirs.
-  m_relocaliserState->exampleReservoirs->add_examples(m_keypointsImage, m_bucketIndicesImage);
+  m_relocaliserState->exampleReservoirs->add_examples(workspace.keypointsImage, netWorkspace.bucketIndicesImage);
 }
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void ScoreNetRelocaliser::find_reservoirs(const ORUChar4Image *colourImage, bool allowAllocation) const
+void ScoreNetRelocaliser::find_reservoirs(NetWorkspace& workspace, const ORUChar4Image *colourImage, bool allowAllocation) const
 {
   // Run the network on the colour image to predict a world space point for each keypoint.
-  run_net(colourImage);
+  run_net(workspace, colourImage);
 
   // Ensure that the bucket indices image is the same size as the keypoints image.
-  const Vector2i imgSize = m_keypointsImage->noDims;
-  m_bucketIndicesImage->ChangeDims(imgSize);
+  const Vector2i imgSize = workspace.keypointsImage->noDims;
+  workspace.bucketIndicesImage->ChangeDims(imgSize);
 
   // Compute a bucket index for each keypoint.
-  const float *scoreNetOutputPtr = m_scoreNetOutput->GetData(MEMORYDEVICE_CPU);
+  const float *scoreNetOutputPtr = workspace.scoreNetOutput->GetData(MEMORYDEVICE_CPU);
   const int planeOffset = imgSize.x * imgSize.y;
-  BucketIndices *bucketIndices = m_bucketIndicesImage->GetData(MEMORYDEVICE_CPU);
+  BucketIndices *bucketIndices = workspace.bucketIndicesImage->GetData(MEMORYDEVICE_CPU);
 
 #ifdef WITH_OPENMP
   #pragma omp parallel for
@@ -182,14 +203,14 @@ void ScoreNetRelocaliser::find_reservoirs(const ORUChar4Image *colourImage, bool
   }
 
   // Copy the bucket indices image across to the GPU (if we're using it).
-  m_bucketIndicesImage->UpdateDeviceFromHost();
+  workspace.bucketIndicesImage->UpdateDeviceFromHost();
 
 #if DEBUGGING
   std::cout << "Buckets Used: " << m_bucketRemapper.size() << std::endl;
 #endif
 }
 
-void ScoreNetRelocaliser::run_net(const ORUChar4Image *colourImage) const
+void ScoreNetRelocaliser::run_net(NetWorkspace& workspace, const ORUChar4Image *colourImage) const
 {
   // Copy the colour image across to the CPU if necessary.
   colourImage->UpdateHostFromDevice();
@@ -243,10 +264,10 @@ void ScoreNetRelocaliser::run_net(const ORUChar4Image *colourImage) const
 
   // Copy the output tensor into a memory block so that it can be used later.
   const float *outData = out.data<float>();
-  const int outputLen = 3 * m_keypointsImage->noDims.y * m_keypointsImage->noDims.x;
-  m_scoreNetOutput->Resize(outputLen);
-  std::copy(outData, outData + outputLen, m_scoreNetOutput->GetData(MEMORYDEVICE_CPU));
-  m_scoreNetOutput->UpdateDeviceFromHost();
+  const int outputLen = 3 * workspace.keypointsImage->noDims.y * workspace.keypointsImage->noDims.x;
+  workspace.scoreNetOutput->Resize(outputLen);
+  std::copy(outData, outData + outputLen, workspace.scoreNetOutput->GetData(MEMORYDEVICE_CPU));
+  workspace.scoreNetOutput->UpdateDeviceFromHost();
 }
 
 }
@@ -7,10 +7,14 @@
 using namespace ORUtils;
 using namespace tvgutil;
 
+#include <iostream>
+
 #include <boost/filesystem.hpp>
 namespace bf = boost::filesystem;
 
 #include <orx/base/MemoryBlockFactory.h>
+#include <orx/persistence/BinaryModelReader.h>
+#include <orx/persistence/BinaryModelWriter.h>
 using namespace orx;
 
 #include "clustering/ExampleClustererFactory.h"
@@ -25,6 +29,7 @@ namespace grove {
 ScoreRelocaliser::ScoreRelocaliser(const SettingsContainer_CPtr& settings, const std::string& settingsNamespace, DeviceType deviceType)
 : m_backed(false),
   m_deviceType(deviceType),
+  m_makeGroundTruthPointsImage(settings, settingsNamespace + "makeGroundTruthPointsImage", false),
   m_maxX(static_cast<float>(INT_MIN)),
   m_maxY(static_cast<float>(INT_MIN)),
   m_maxZ(static_cast<float>(INT_MIN)),
@@ -55,16 +60,13 @@ ScoreRelocaliser::ScoreRelocaliser(const SettingsContainer_CPtr& settings, const
     throw std::invalid_argument(settingsNamespace + "maxClusterCount > ScorePrediction::Capacity");
   }
 
-  // Allocate the internal images.
+  // Allocate the internal images, and the staging buffer for the clusters (which only needs room for one batch of reservoirs).
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
-  m_descriptorsImage = mbf.make_image<DescriptorType>();
-  m_groundTruthPredictionsImage = mbf.make_image<ScorePrediction>();
-  m_keypointsImage = mbf.make_image<ExampleType>();
-  m_predictionsImage = mbf.make_image<ScorePrediction>();
+  m_groundTruthPredictionsImage = mbf.make_image<ScorePrediction>(Vector2i(0, 0), "relocaliser");
+  m_stagedPredictionsBlock = mbf.make_block<ScorePrediction>(m_maxReservoirsToUpdate, "relocaliser");
 
   // Instantiate the sub-components.
   m_featureCalculator = FeatureCalculatorFactory::make_da_rgbd_patch_feature_calculator(deviceType);
-  m_preemptiveRansac = PreemptiveRansacFactory::make_preemptive_ransac(settings, settingsNamespace + "PreemptiveRansac.", deviceType);
 }
 
 //#################### DESTRUCTOR ####################
@@ -78,7 +80,7 @@ void ScoreRelocaliser::finish_training()
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> lock(m_clusteringMutex);
 
   // First update all of the clusters.
   update_all_clusters();
@@ -94,17 +96,21 @@ void ScoreRelocaliser::finish_training()
 
 void ScoreRelocaliser::get_best_poses(std::vector<PoseCandidate>& poseCandidates) const
 {
-  m_preemptiveRansac->get_best_poses(poseCandidates);
+  boost::lock_guard<boost::mutex> lock(m_workspacesMutex);
+  if(m_lastWorkspace) m_lastWorkspace->preemptiveRansac->get_best_poses(poseCandidates);
+  else poseCandidates.clear();
 }
 
 Keypoint3DColourImage_CPtr ScoreRelocaliser::get_keypoints_image() const
 {
-  return m_keypointsImage;
+  boost::lock_guard<boost::mutex> lock(m_workspacesMutex);
+  return m_lastWorkspace ? m_lastWorkspace->keypointsImage : Keypoint3DColourImage_CPtr();
 }
 
 ScorePredictionsImage_CPtr ScoreRelocaliser::get_predictions_image() const
 {
-  return m_predictionsImage;
+  boost::lock_guard<boost::mutex> lock(m_workspacesMutex);
+  return m_lastWorkspace ? m_lastWorkspace->predictionsImage : ScorePredictionsImage_CPtr();
 }
 
 ORUChar4Image_CPtr ScoreRelocaliser::get_visualisation_image(const std::string& key) const
@@ -119,72 +125,73 @@ void ScoreRelocaliser::load_from_disk(const std::string& inputFolder)
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  // Otherwise, load its internal state from disk.
-  m_relocaliserState->load_from_disk(inputFolder);
-}
-
-std::vector<Relocaliser::Result> ScoreRelocaliser::relocalise(const ORUChar4Image *colourImage, const ORFloatImage *depthImage, const Vector4f& depthIntrinsics) const
-{
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
-
-  std::vector<Result> results;
-
-  // Iff we have enough valid depth values, try to estimate the camera pose:
-  if(m_preemptiveRansac->count_valid_depths(depthImage) > m_preemptiveRansac->get_min_nb_required_points())
+  // Otherwise, load its internal state from disk (making sure that we're not clustering at the same time). If the folder contains
+  // a binary model file, we load everything from that; if not, we fall back to loading the state from the legacy separate files.
+  boost::lock_guard<boost::recursive_mutex> lock(m_clusteringMutex);
+  const bf::path modelPath = bf::path(inputFolder) / "relocaliser.model";
+  if(bf::exists(modelPath))
   {
-    // Step 1: Extract keypoints from the RGB-D image and compute descriptors for them.
-    // FIXME: We only need to compute the descriptors if we're using the forest.
-    m_featureCalculator->compute_keypoints_and_features(colourImage, depthImage, depthIntrinsics, m_keypointsImage.get(), m_descriptorsImage.get());
-
-    // Step 2: Create a single SCoRe prediction (a single set of clusters) for each keypoint.
-    make_predictions(colourImage);
-
-    // Step 3: Perform P-RANSAC to try to estimate the camera pose.
-    boost::optional<PoseCandidate> poseCandidate = m_preemptiveRansac->estimate_pose(m_keypointsImage, m_predictionsImage);
-
-    // Step 4: If we succeeded in estimating a camera pose:
-    if(poseCandidate)
+    // Open the model file. If it is unusable (e.g. because it was truncated whilst being written), but the legacy files
+    // are also present, fall back to loading the state from those instead. If not, there's nothing more we can do.
+    boost::shared_ptr<BinaryModelReader> reader;
+    try
     {
-      // Add the pose to the results.
-      Result result;
-      result.pose.SetInvM(poseCandidate->cameraPose);
-      result.quality = RELOCALISATION_GOOD;
-      result.score = poseCandidate->energy;
-      results.push_back(result);
+      reader.reset(new BinaryModelReader(modelPath.string()));
+    }
+    catch(std::runtime_error& e)
+    {
+      if(!bf::exists(bf::path(inputFolder) / "scoreState.txt")) throw;
+      std::cerr << "Warning: Could not load " << modelPath.string() << " (" << e.what() << "). Falling back to the legacy relocaliser files.\n";
+    }
 
-      // If we're outputting multiple poses:
-      if(m_maxRelocalisationsToOutput > 1)
+    if(reader)
+    {
+      try
       {
-        // Get all of the candidates that survived the initial culling process during P-RANSAC.
-        std::vector<PoseCandidate> candidates;
-        m_preemptiveRansac->get_best_poses(candidates);
-
-        // Add the best candidates to the results (skipping the first one, since it's the same one returned by estimate_pose above).
-        const size_t maxElements = std::min<size_t>(candidates.size(), m_maxRelocalisationsToOutput);
-        for(size_t i = 1; i < maxElements; ++i)
-        {
-          Result result;
-          result.pose.SetInvM(candidates[i].cameraPose);
-          result.quality = RELOCALISATION_GOOD;
-          result.score = candidates[i].energy;
-          results.push_back(result);
-        }
+        // Note: Subclasses may replace data that is used during relocalisation (e.g. the forest), so we also need to prevent concurrent relocalisation.
+        boost::unique_lock<boost::shared_mutex> modelLock(m_modelMutex);
+        load_from_model_sub(*reader);
+        m_relocaliserState->load_from_model(*reader);
       }
+      catch(...)
+      {
+        // If loading fails part-way through, some of the relocaliser's data may already have been replaced, so falling back to
+        // the legacy files (or carrying on with the current state) would leave it inconsistent. Instead, we reset the state.
+        reset();
+        throw;
+      }
+
+      return;
     }
   }
 
-  // If debugging is enabled, update the visualisation images.
-  if(m_enableDebugging)
+  m_relocaliserState->load_from_disk(inputFolder);
+}
+
+std::vector<Relocaliser::Result> ScoreRelocaliser::relocalise(const ORUChar4Image *colourImage, const ORFloatImage *depthImage, const Vector4f& depthIntrinsics) const
+{
+  // Take a workspace from the pool for the duration of the call, so that concurrent calls do not share any scratch state.
+  Workspace_Ptr workspace = acquire_workspace();
+
+  // Claim the ground truth pose (if any) for this frame.
   {
-    make_visualisation_images(depthImage, results);
+    boost::lock_guard<boost::mutex> lock(m_debuggingMutex);
+    workspace->groundTruthFrameIndex = m_groundTruthFrameIndex;
+    if(m_groundTruthTrajectory && m_groundTruthFrameIndex < m_groundTruthTrajectory->size()) ++m_groundTruthFrameIndex;
   }
 
-  // If we're using the ground truth camera trajectory, increment the ground truth frame index.
-  if(m_groundTruthTrajectory && m_groundTruthFrameIndex < m_groundTruthTrajectory->size())
+  std::vector<Result> results;
+  try
+  {
+    results = relocalise_with_workspace(*workspace, colourImage, depthImage, depthIntrinsics);
+  }
+  catch(...)
   {
-    ++m_groundTruthFrameIndex;
+    release_workspace(workspace);
+    throw;
   }
 
+  release_workspace(workspace);
   return results;
 }
 
@@ -193,7 +200,8 @@ void ScoreRelocaliser::reset()
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> clusteringLock(m_clusteringMutex);
+  boost::unique_lock<boost::shared_mutex> modelLock(m_modelMutex);
 
   // Set up the clusterer if it isn't currently allocated (note that it can be deallocated by finish_training, so this can't just be moved to the constructor).
   if(!m_exampleClusterer)
@@ -208,7 +216,10 @@ void ScoreRelocaliser::reset()
   else m_relocaliserState.reset(new ScoreRelocaliserState(m_reservoirCount, m_reservoirCapacity, m_deviceType, m_rngSeed));
 
   // Reset the ground truth frame index.
-  m_groundTruthFrameIndex = 0;
+  {
+    boost::lock_guard<boost::mutex> lock(m_debuggingMutex);
+    m_groundTruthFrameIndex = 0;
+  }
 }
 
 void ScoreRelocaliser::save_to_disk(const std::string& outputFolder) const
@@ -219,8 +230,12 @@ void ScoreRelocaliser::save_to_disk(const std::string& outputFolder) const
   // First make sure that the output folder exists.
   bf::create_directories(outputFolder);
 
-  // Then save the relocaliser's internal state to disk.
-  m_relocaliserState->save_to_disk(outputFolder);
+  // Then save the relocaliser's internal state (together with any additional data needed by subclasses) to a single binary model file.
+  boost::lock_guard<boost::recursive_mutex> lock(m_clusteringMutex);
+  BinaryModelWriter writer((bf::path(outputFolder) / "relocaliser.model").string());
+  save_to_model_sub(writer);
+  m_relocaliserState->save_to_model(writer);
+  writer.close();
 }
 
 void ScoreRelocaliser::set_backing_relocaliser(const ScoreRelocaliser_Ptr& backingRelocaliser)
@@ -237,7 +252,7 @@ void ScoreRelocaliser::set_ground_truth_trajectory(const std::vector<ORUtils::SE
 void ScoreRelocaliser::train(const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
                              const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose)
 {
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> clusteringLock(m_clusteringMutex);
 
   // If debugging is enabled, update the maximum and minimum x, y and z coordinates visited by the camera during training.
   if(m_enableDebugging)
@@ -260,23 +275,18 @@ void ScoreRelocaliser::train(const ORUChar4Image *colourImage, const ORFloatImag
   }
 
   // Call the hook function (a function that should be overridden by derived classes to perform the actual training).
-  train_sub(colourImage, depthImage, depthIntrinsics, cameraPose);
+  // This uses a workspace of its own, so it can run concurrently with relocalisation.
+  {
+    boost::shared_lock<boost::shared_mutex> modelLock(m_modelMutex);
+    if(!m_trainingWorkspace) m_trainingWorkspace = make_workspace();
+    train_sub(*m_trainingWorkspace, colourImage, depthImage, depthIntrinsics, cameraPose);
+  }
 
   // If there are any reservoirs:
   if(m_reservoirCount > 0)
   {
-    // Cluster some of the reservoirs.
-    const uint32_t nbReservoirsToUpdate = compute_nb_reservoirs_to_update();
-    m_exampleClusterer->cluster_examples(
-      m_relocaliserState->exampleReservoirs->get_reservoirs(), m_relocaliserState->exampleReservoirs->get_reservoir_sizes(),
-      m_relocaliserState->reservoirUpdateStartIdx, nbReservoirsToUpdate, m_relocaliserState->predictionsBlock
-    );
-
-    // Store the index of the first reservoir that was just updated so that we can tell when there are no more clusters to update.
-    m_relocaliserState->lastExamplesAddedStartIdx = m_relocaliserState->reservoirUpdateStartIdx;
-
-    // Update the index of the first reservoir to subject to clustering during the next train/update call.
-    update_reservoir_start_idx();
+    // Cluster some of the reservoirs, and store the index of the first reservoir that was updated so that we can tell when there are no more clusters to update.
+    m_relocaliserState->lastExamplesAddedStartIdx = cluster_next_reservoirs();
   }
 }
 
@@ -285,7 +295,7 @@ void ScoreRelocaliser::update()
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> lock(m_clusteringMutex);
 
   if(!m_relocaliserState->exampleReservoirs)
   {
@@ -297,15 +307,8 @@ void ScoreRelocaliser::update()
   // this check only works if m_maxReservoirsToUpdate remains constant throughout the whole program.
   if(m_relocaliserState->reservoirUpdateStartIdx == m_relocaliserState->lastExamplesAddedStartIdx) return;
 
-  // Otherwise, cluster the next batch of reservoirs, and update the index of the first reservoir to subject to
-  // clustering during the next train/update call.
-  const uint32_t updateCount = compute_nb_reservoirs_to_update();
-  m_exampleClusterer->cluster_examples(
-    m_relocaliserState->exampleReservoirs->get_reservoirs(), m_relocaliserState->exampleReservoirs->get_reservoir_sizes(),
-    m_relocaliserState->reservoirUpdateStartIdx, updateCount, m_relocaliserState->predictionsBlock
-  );
-
-  update_reservoir_start_idx();
+  // Otherwise, cluster the next batch of reservoirs.
+  cluster_next_reservoirs();
 }
 
 void ScoreRelocaliser::update_all_clusters()
@@ -313,7 +316,7 @@ void ScoreRelocaliser::update_all_clusters()
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> lock(m_clusteringMutex);
 
   // Repeatedly call update until we get back to the batch of reservoirs that was updated last time train() was called.
   while(m_relocaliserState->reservoirUpdateStartIdx != m_relocaliserState->lastExamplesAddedStartIdx)
@@ -324,30 +327,60 @@ void ScoreRelocaliser::update_all_clusters()
 
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
-void ScoreRelocaliser::make_visualisation_images(const ORFloatImage *depthImage, const std::vector<Result>& results) const
+void ScoreRelocaliser::allocate_workspace_images(Workspace& workspace) const
+{
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  workspace.descriptorsImage = mbf.make_image<DescriptorType>(Vector2i(0, 0), "relocaliser");
+  workspace.groundTruthFrameIndex = 0;
+  workspace.keypointsImage = mbf.make_image<ExampleType>(Vector2i(0, 0), "relocaliser");
+  workspace.predictionsImage = mbf.make_image<ScorePrediction>(Vector2i(0, 0), "relocaliser");
+}
+
+void ScoreRelocaliser::compute_features(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                                        const Matrix4f& cameraPose, const Vector4f& depthIntrinsics) const
+{
+  m_featureCalculator->compute_keypoints_and_features(
+    colourImage, depthImage, cameraPose, depthIntrinsics, workspace.keypointsImage.get(), workspace.descriptorsImage.get()
+  );
+}
+
+void ScoreRelocaliser::load_from_model_sub(const BinaryModelReader& reader)
+{
+  // No-op by default
+}
+
+void ScoreRelocaliser::make_visualisation_images(const Workspace& workspace, const ORFloatImage *depthImage, const std::vector<Result>& results) const
 {
-  if(m_groundTruthTrajectory && m_groundTruthFrameIndex < m_groundTruthTrajectory->size())
+  const size_t frameIndex = workspace.groundTruthFrameIndex;
+  if(m_groundTruthTrajectory && frameIndex < m_groundTruthTrajectory->size())
   {
     // Update the normal pixel to points image, using the ground truth world to camera transformation.
-    const Matrix4f& worldToCamera = (*m_groundTruthTrajectory)[m_groundTruthFrameIndex].GetM();
-    update_pixels_to_points_image(worldToCamera, m_predictionsImage, m_pixelsToPointsImage);
+    const Matrix4f& worldToCamera = (*m_groundTruthTrajectory)[frameIndex].GetM();
+    update_pixels_to_points_image(worldToCamera, workspace.keypointsImage, workspace.predictionsImage, m_pixelsToPointsImage);
 
     // If requested, also update the ground truth pixel to points image.
-    if(m_settings->get_first_value<bool>(m_settingsNamespace + "makeGroundTruthPointsImage", false))
+    if(*m_makeGroundTruthPointsImage)
     {
-      const Matrix4f& cameraToWorld = (*m_groundTruthTrajectory)[m_groundTruthFrameIndex].GetInvM();
-      set_ground_truth_predictions_for_keypoints(m_keypointsImage, cameraToWorld, m_groundTruthPredictionsImage);
-      update_pixels_to_points_image(worldToCamera, m_groundTruthPredictionsImage, m_groundTruthPixelsToPointsImage);
+      const Matrix4f& cameraToWorld = (*m_groundTruthTrajectory)[frameIndex].GetInvM();
+      set_ground_truth_predictions_for_keypoints(workspace.keypointsImage, cameraToWorld, m_groundTruthPredictionsImage);
+      update_pixels_to_points_image(worldToCamera, workspace.keypointsImage, m_groundTruthPredictionsImage, m_groundTruthPixelsToPointsImage);
     }
   }
   else if(!results.empty())
   {
     // Update the normal pixel to points image, using the "best" relocalised pose as the world to camera transformation.
     // Note: We use this pose as a default, even though it may later be either refined by ICP or discarded in favour of a different pose.
-    update_pixels_to_points_image(results[0].pose, m_predictionsImage, m_pixelsToPointsImage);
+    update_pixels_to_points_image(results[0].pose, workspace.keypointsImage, workspace.predictionsImage, m_pixelsToPointsImage);
   }
 }
 
+ScoreRelocaliser::Workspace_Ptr ScoreRelocaliser::make_workspace() const
+{
+  Workspace_Ptr workspace(new Workspace);
+  allocate_workspace_images(*workspace);
+  return workspace;
+}
+
 void ScoreRelocaliser::set_ground_truth_predictions_for_keypoints(const Keypoint3DColourImage_CPtr& keypointsImage, const Matrix4f& cameraToWorld,
                                                                   ScorePredictionsImage_Ptr& outputPredictions) const
 {
@@ -377,23 +410,140 @@ void ScoreRelocaliser::set_ground_truth_predictions_for_keypoints(const Keypoint
   if(m_deviceType == DEVICE_CUDA) outputPredictions->UpdateDeviceFromHost();
 }
 
+void ScoreRelocaliser::save_to_model_sub(BinaryModelWriter& writer) const
+{
+  // No-op by default
+}
+
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+ScoreRelocaliser::Workspace_Ptr ScoreRelocaliser::acquire_workspace() const
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_workspacesMutex);
+    if(!m_freeWorkspaces.empty())
+    {
+      Workspace_Ptr workspace = m_freeWorkspaces.back();
+      m_freeWorkspaces.pop_back();
+      return workspace;
+    }
+  }
+
+  // If there are no free workspaces, make a new one (without holding the lock, since this allocates a fair amount of memory).
+  Workspace_Ptr workspace = make_workspace();
+  workspace->preemptiveRansac = PreemptiveRansacFactory::make_preemptive_ransac(m_settings, m_settingsNamespace + "PreemptiveRansac.", m_deviceType);
+  return workspace;
+}
+
+uint32_t ScoreRelocaliser::cluster_next_reservoirs()
+{
+  const uint32_t startIdx = m_relocaliserState->reservoirUpdateStartIdx;
+  const uint32_t count = compute_nb_reservoirs_to_update();
+
+  // Cluster the reservoirs into the staging buffer, which isn't used for relocalisation, and then publish the new clusters.
+  m_exampleClusterer->cluster_examples(
+    m_relocaliserState->exampleReservoirs->get_reservoirs(), m_relocaliserState->exampleReservoirs->get_reservoir_sizes(),
+    startIdx, count, m_stagedPredictionsBlock, 0
+  );
+
+  m_relocaliserState->publish_predictions(m_stagedPredictionsBlock, startIdx, count);
+
+  // Update the index of the first reservoir to subject to clustering during the next train/update call.
+  update_reservoir_start_idx();
+
+  return startIdx;
+}
+
 uint32_t ScoreRelocaliser::compute_nb_reservoirs_to_update() const
 {
   // Either the standard number of reservoirs to update, or the number remaining before the end of the memory block.
   return std::min(m_maxReservoirsToUpdate, m_reservoirCount - m_relocaliserState->reservoirUpdateStartIdx);
 }
 
-void ScoreRelocaliser::update_pixels_to_points_image(const ORUtils::SE3Pose& worldToCamera, const ScorePredictionsImage_Ptr& predictionsImage,
-                                                     ORUChar4Image_Ptr& pixelsToPointsImage) const
+std::vector<Relocaliser::Result> ScoreRelocaliser::relocalise_with_workspace(Workspace& workspace, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                                                                              const Vector4f& depthIntrinsics) const
+{
+  std::vector<Result> results;
+
+  // Prevent the parts of the model used below (e.g. the forest) from being replaced whilst we are using them.
+  boost::shared_lock<boost::shared_mutex> modelLock(m_modelMutex);
+
+  // Iff we have enough valid depth values, try to estimate the camera pose:
+  const PreemptiveRansac_Ptr& preemptiveRansac = workspace.preemptiveRansac;
+  if(preemptiveRansac->count_valid_depths(depthImage) > preemptiveRansac->get_min_nb_required_points())
+  {
+    // Step 1: Extract keypoints (in camera coordinates) from the RGB-D image and compute features for them.
+    Matrix4f identity;
+    identity.setIdentity();
+    compute_features(workspace, colourImage, depthImage, identity, depthIntrinsics);
+
+    // Step 2: Create a single SCoRe prediction (a single set of clusters) for each keypoint. We hold a shared lock on
+    //         the relocaliser's clusters whilst doing so to make sure that they aren't updated underneath us.
+    {
+      boost::shared_lock<boost::shared_mutex> predictionsLock(m_relocaliserState->predictionsMutex);
+      make_predictions(workspace, colourImage);
+    }
+
+    // Step 3: Perform P-RANSAC to try to estimate the camera pose.
+    boost::optional<PoseCandidate> poseCandidate = preemptiveRansac->estimate_pose(workspace.keypointsImage, workspace.predictionsImage);
+
+    // Step 4: If we succeeded in estimating a camera pose:
+    if(poseCandidate)
+    {
+      // Add the pose to the results.
+      Result result;
+      result.pose.SetInvM(poseCandidate->cameraPose);
+      result.quality = RELOCALISATION_GOOD;
+      result.score = poseCandidate->energy;
+      results.push_back(result);
+
+      // If we're outputting multiple poses:
+      if(m_maxRelocalisationsToOutput > 1)
+      {
+        // Get all of the candidates that survived the initial culling process during P-RANSAC.
+        std::vector<PoseCandidate> candidates;
+        preemptiveRansac->get_best_poses(candidates);
+
+        // Add the best candidates to the results (skipping the first one, since it's the same one returned by estimate_pose above).
+        const size_t maxElements = std::min<size_t>(candidates.size(), m_maxRelocalisationsToOutput);
+        for(size_t i = 1; i < maxElements; ++i)
+        {
+          Result result;
+          result.pose.SetInvM(candidates[i].cameraPose);
+          result.quality = RELOCALISATION_GOOD;
+          result.score = candidates[i].energy;
+          results.push_back(result);
+        }
+      }
+    }
+  }
+
+  // If debugging is enabled, update the visualisation images.
+  if(m_enableDebugging)
+  {
+    boost::lock_guard<boost::mutex> lock(m_debuggingMutex);
+    make_visualisation_images(workspace, depthImage, results);
+  }
+
+  return results;
+}
+
+void ScoreRelocaliser::release_workspace(const Workspace_Ptr& workspace) const
+{
+  boost::lock_guard<boost::mutex> lock(m_workspacesMutex);
+  m_freeWorkspaces.push_back(workspace);
+  m_lastWorkspace = workspace;
+}
+
+void ScoreRelocaliser::update_pixels_to_points_image(const ORUtils::SE3Pose& worldToCamera, const Keypoint3DColourImage_CPtr& keypointsImage,
+                                                     const ScorePredictionsImage_CPtr& predictionsImage, ORUChar4Image_Ptr& pixelsToPointsImage) const
 {
   // Ensure that the keypoints and SCoRe predictions are available on the CPU.
-  m_keypointsImage->UpdateHostFromDevice();
+  keypointsImage->UpdateHostFromDevice();
   predictionsImage->UpdateHostFromDevice();
 
   // If the pixels to points image hasn't been allocated yet, allocate it now.
-  if(!pixelsToPointsImage) pixelsToPointsImage.reset(new ORUChar4Image(m_keypointsImage->noDims, true, true));
+  if(!pixelsToPointsImage) pixelsToPointsImage.reset(new ORUChar4Image(keypointsImage->noDims, true, true));
 
   // For each pixel:
   Vector4u *p = pixelsToPointsImage->GetData(MEMORYDEVICE_CPU);
@@ -403,7 +553,7 @@ void ScoreRelocaliser::update_pixels_to_points_image(const ORUtils::SE3Pose& wor
     p->a = 255;
 
     // If the pixel has a valid keypoint, look up the position of the cluster (if any) in the corresponding prediction that is closest to it.
-    const ExampleType& keypoint = m_keypointsImage->GetData(MEMORYDEVICE_CPU)[i];
+    const ExampleType& keypoint = keypointsImage->GetData(MEMORYDEVICE_CPU)[i];
     if(!keypoint.valid) continue;
     const PredictionType& prediction = predictionsImage->GetData(MEMORYDEVICE_CPU)[i];
     const int closestModeIdx = find_closest_mode(worldToCamera.GetInvM() * keypoint.position, prediction);
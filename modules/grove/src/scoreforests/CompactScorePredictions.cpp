@@ -0,0 +1,153 @@
+/**
+ * grove: CompactScorePredictions.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "scoreforests/CompactScorePredictions.h"
+
+#include <stdexcept>
+
+#include <orx/base/MemoryBlockFactory.h>
+#include <orx/persistence/BinaryModelReader.h>
+#include <orx/persistence/BinaryModelWriter.h>
+using namespace orx;
+
+namespace grove {
+
+//#################### CONSTRUCTORS ####################
+
+CompactScorePredictions::CompactScorePredictions()
+{
+  const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  m_modeOffsets = mbf.make_block<uint>(1, "relocaliser");
+  m_modeOffsets->GetData(MEMORYDEVICE_CPU)[0] = 0;
+  m_modes = mbf.make_block<Keypoint3DColourCluster>(0, "relocaliser");
+}
+
+CompactScorePredictions::CompactScorePredictions(const ScorePredictionsMemoryBlock& predictions)
+{
+  const ScorePrediction *predictionsPtr = predictions.GetData(MEMORYDEVICE_CPU);
+  const size_t predictionCount = predictions.dataSize;
+
+  // First, compute the offset of each prediction's modes in the mode pool.
+  const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  m_modeOffsets = mbf.make_block<uint>(predictionCount + 1, "relocaliser");
+  uint *modeOffsets = m_modeOffsets->GetData(MEMORYDEVICE_CPU);
+
+  modeOffsets[0] = 0;
+  for(size_t i = 0; i < predictionCount; ++i)
+  {
+    modeOffsets[i + 1] = modeOffsets[i] + static_cast<uint>(predictionsPtr[i].size);
+  }
+
+  // Then, copy the modes across into the pool.
+  m_modes = mbf.make_block<Keypoint3DColourCluster>(modeOffsets[predictionCount], "relocaliser");
+  Keypoint3DColourCluster *modes = m_modes->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < static_cast<int>(predictionCount); ++i)
+  {
+    std::copy(predictionsPtr[i].elts, predictionsPtr[i].elts + predictionsPtr[i].size, modes + modeOffsets[i]);
+  }
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void CompactScorePredictions::expand_into(ScorePredictionsMemoryBlock& predictions) const
+{
+  const uint32_t predictionCount = get_prediction_count();
+  if(predictions.dataSize != predictionCount)
+  {
+    throw std::invalid_argument("Error: Cannot expand the compact SCoRe predictions into a block of the wrong size");
+  }
+
+  const uint *modeOffsets = m_modeOffsets->GetData(MEMORYDEVICE_CPU);
+  const Keypoint3DColourCluster *modes = m_modes->GetData(MEMORYDEVICE_CPU);
+  ScorePrediction *predictionsPtr = predictions.GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < static_cast<int>(predictionCount); ++i)
+  {
+    ScorePrediction& prediction = predictionsPtr[i];
+    prediction.size = static_cast<int>(modeOffsets[i + 1] - modeOffsets[i]);
+    std::copy(modes + modeOffsets[i], modes + modeOffsets[i + 1], prediction.elts);
+  }
+}
+
+uint32_t CompactScorePredictions::get_mode_count() const
+{
+  return static_cast<uint32_t>(m_modes->dataSize);
+}
+
+uint32_t CompactScorePredictions::get_prediction_count() const
+{
+  return static_cast<uint32_t>(m_modeOffsets->dataSize - 1);
+}
+
+void CompactScorePredictions::load_from_model(const BinaryModelReader& reader)
+{
+  // Check that the predictions in the model are compatible with this build.
+  const std::vector<uint32_t> format = reader.read_vector<uint32_t>("predictionsFormat");
+  if(format.size() != 2 || format[0] > ScorePrediction::Capacity || format[1] != sizeof(Keypoint3DColourCluster))
+  {
+    throw std::runtime_error("Error: The compact SCoRe predictions in the model are incompatible with this build");
+  }
+
+  // Work out how many predictions and modes there are from the sizes of the relevant chunks.
+  size_t offsetsSize, modesSize;
+  reader.get_chunk("predictionModeOffsets", offsetsSize);
+  reader.get_chunk("predictionModes", modesSize);
+  if(offsetsSize < sizeof(uint) || offsetsSize % sizeof(uint) != 0 || modesSize % sizeof(Keypoint3DColourCluster) != 0)
+  {
+    throw std::runtime_error("Error: The compact SCoRe predictions in the model are corrupt");
+  }
+
+  const uint32_t predictionCount = static_cast<uint32_t>(offsetsSize / sizeof(uint) - 1);
+  const uint32_t modeCount = static_cast<uint32_t>(modesSize / sizeof(Keypoint3DColourCluster));
+
+  // Copy the offsets and the modes out of the mapped file, and check that they are consistent before accepting them.
+  const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  ORUIntMemoryBlock_Ptr modeOffsets = mbf.make_block<uint>(predictionCount + 1, "relocaliser");
+  Keypoint3DColourClusterMemoryBlock_Ptr modes = mbf.make_block<Keypoint3DColourCluster>(modeCount, "relocaliser");
+  reader.read_block("predictionModeOffsets", *modeOffsets);
+  reader.read_block("predictionModes", *modes);
+  check_mode_offsets(modeOffsets->GetData(MEMORYDEVICE_CPU), predictionCount, modeCount, format[0]);
+
+  m_modeOffsets = modeOffsets;
+  m_modes = modes;
+}
+
+void CompactScorePredictions::save_to_model(BinaryModelWriter& writer) const
+{
+  std::vector<uint32_t> format(2);
+  format[0] = ScorePrediction::Capacity;
+  format[1] = sizeof(Keypoint3DColourCluster);
+
+  writer.write_vector("predictionsFormat", format);
+  writer.write_block("predictionModeOffsets", *m_modeOffsets);
+  writer.write_block("predictionModes", *m_modes);
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+void CompactScorePredictions::check_mode_offsets(const uint *modeOffsets, uint32_t predictionCount, uint32_t modeCount, uint32_t capacity)
+{
+  if(modeOffsets[0] != 0 || modeOffsets[predictionCount] != modeCount)
+  {
+    throw std::runtime_error("Error: The compact SCoRe predictions in the model are corrupt");
+  }
+
+  for(uint32_t i = 0; i < predictionCount; ++i)
+  {
+    if(modeOffsets[i + 1] < modeOffsets[i] || modeOffsets[i + 1] - modeOffsets[i] > capacity)
+    {
+      throw std::runtime_error("Error: The compact SCoRe predictions in the model are corrupt");
+    }
+  }
+}
+
+}
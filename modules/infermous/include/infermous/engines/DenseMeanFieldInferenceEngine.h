@@ -0,0 +1,381 @@
+/**
+ * infermous: DenseMeanFieldInferenceEngine.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_INFERMOUS_DENSEMEANFIELDINFERENCEENGINE
+#define H_INFERMOUS_DENSEMEANFIELDINFERENCEENGINE
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <vector>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+#include "../base/CRF2D.h"
+
+namespace infermous {
+
+/**
+ * \brief An instance of an instantiation of this class template can be used to run mean-field inference on a 2D CRF
+ *        using dense, contiguous arrays rather than the CRF's grids of label -> probability maps.
+ *
+ * The engine performs exactly the same update as MeanFieldInferenceEngine, but converts the CRF's unaries and marginals
+ * into [H][W][L] float arrays (over the union of the labels that appear in the unaries) when it is constructed, and only
+ * converts the marginals back into the CRF at the end of each call to update_crf. In between, each iteration:
+ *
+ * 1) Sums the previous marginals over each pixel's neighbourhood, i.e. S_i(L') = \sum_{j in N(i)} Q_j^{t-1}(L').
+ *    Each neighbour offset contributes a contiguous span of each row, so these sums are simple vectorisable loops.
+ * 2) Computes M_i(L) = phi_i(L) + \sum_{L'} phi(L,L') S_i(L') using a precomputed table of pairwise potentials,
+ *    and normalises e^-M_i(L) to get the new marginals Q_i^t(L).
+ *
+ * Rows are processed in parallel (when OpenMP is available), each thread using its own row of scratch space.
+ *
+ * Labels that are absent from a pixel's unaries are treated as having zero probability, which is equivalent to the
+ * behaviour of MeanFieldInferenceEngine, in which they are simply not present in the pixel's maps.
+ */
+template <typename Label>
+class DenseMeanFieldInferenceEngine
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef infermous::CRF2D_Ptr<Label> CRF2D_Ptr;
+  typedef infermous::CRF2D_CPtr<Label> CRF2D_CPtr;
+  typedef infermous::ProbabilitiesGrid<Label> ProbabilitiesGrid;
+  typedef infermous::ProbabilitiesGrid_Ptr<Label> ProbabilitiesGrid_Ptr;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The CRF on which the mean-field inference engine works. */
+  CRF2D_Ptr m_crf;
+
+  /** The height of the CRF. */
+  int m_height;
+
+  /** The labels that appear in the CRF's unaries (in ascending order). The index of a label in this array is its index in the dense arrays. */
+  std::vector<Label> m_labels;
+
+  /** The current marginal probabilities, stored as a [H][W][L] array. */
+  std::vector<float> m_marginals;
+
+  /** A list of offsets used to specify the neighbours of each pixel. */
+  std::vector<Eigen::Vector2i> m_neighbourOffsets;
+
+  /** A [H][W][L] array into which to write the updated marginal probabilities, which will be swapped with m_marginals at the end of each iteration. */
+  std::vector<float> m_newMarginals;
+
+  /** A grid of marginal probabilities into which to write the results, which will be swapped with the grid in the CRF at the end of each call to update_crf. */
+  ProbabilitiesGrid_Ptr m_newMarginalsGrid;
+
+  /** The pairwise potentials between the labels, stored as an [L][L] array. */
+  std::vector<float> m_pairwisePotentials;
+
+  /** The unary potentials, phi_i(L) = -log(psi_i(L)), stored as a [H][W][L] array (labels that are absent from a pixel's unaries have infinite potential). */
+  std::vector<float> m_unaryPotentials;
+
+  /** The width of the CRF. */
+  int m_width;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a dense mean-field inference engine.
+   *
+   * \param crf               The CRF on which the mean-field inference engine works.
+   * \param neighbourOffsets  A list of offsets used to specify the neighbours of each pixel.
+   */
+  DenseMeanFieldInferenceEngine(const CRF2D_Ptr& crf, const std::vector<Eigen::Vector2i>& neighbourOffsets)
+  : m_crf(crf),
+    m_height(crf->get_height()),
+    m_neighbourOffsets(neighbourOffsets),
+    m_newMarginalsGrid(new ProbabilitiesGrid(crf->get_height(), crf->get_width())),
+    m_width(crf->get_width())
+  {
+    // Determine the set of labels that appear in the unaries.
+    std::set<Label> labels;
+    for(int y = 0; y < m_height; ++y)
+    {
+      for(int x = 0; x < m_width; ++x)
+      {
+        const std::map<Label,float>& psi_i = m_crf->get_unaries_at(Eigen::Vector2i(x, y));
+        for(typename std::map<Label,float>::const_iterator kt = psi_i.begin(), kend = psi_i.end(); kt != kend; ++kt)
+        {
+          labels.insert(kt->first);
+        }
+      }
+    }
+    m_labels.assign(labels.begin(), labels.end());
+
+    // Tabulate the pairwise potentials between the labels.
+    const size_t labelCount = m_labels.size();
+    PairwisePotentialCalculator_CPtr<Label> pairwisePotentialCalculator = m_crf->get_pairwise_potential_calculator();
+    m_pairwisePotentials.resize(labelCount * labelCount);
+    for(size_t k = 0; k < labelCount; ++k)
+    {
+      for(size_t kDash = 0; kDash < labelCount; ++kDash)
+      {
+        m_pairwisePotentials[k * labelCount + kDash] = pairwisePotentialCalculator->calculate_potential(m_labels[k], m_labels[kDash]);
+      }
+    }
+
+    // Convert the unaries and the current marginals into dense arrays.
+    const size_t size = m_height * m_width * labelCount;
+    m_marginals.assign(size, 0.0f);
+    m_newMarginals.assign(size, 0.0f);
+    m_unaryPotentials.assign(size, std::numeric_limits<float>::infinity());
+
+    for(int y = 0; y < m_height; ++y)
+    {
+      for(int x = 0; x < m_width; ++x)
+      {
+        const Eigen::Vector2i i(x, y);
+        const size_t offset = (y * m_width + x) * labelCount;
+        scatter(m_crf->get_unaries_at(i), &m_unaryPotentials[offset]);
+        scatter(m_crf->get_marginals_at(i), &m_marginals[offset]);
+
+        // Note: Unary probabilities of zero yield infinite potentials, as do the labels that are absent from the pixel.
+        for(size_t k = 0; k < labelCount; ++k)
+        {
+          float& phi_i_L = m_unaryPotentials[offset + k];
+          if(phi_i_L != std::numeric_limits<float>::infinity()) phi_i_L = -logf(phi_i_L);
+        }
+
+        // Prepare the pixel's map in the output grid so that its entries can be updated in place later.
+        (*m_newMarginalsGrid)(y, x) = m_crf->get_unaries_at(i);
+      }
+    }
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the CRF on which the mean-field inference engine works.
+   *
+   * \return  The CRF on which the mean-field inference engine works.
+   */
+  CRF2D_CPtr get_crf() const
+  {
+    return m_crf;
+  }
+
+  /**
+   * \brief Gets the labels that index the dense arrays used by the engine.
+   *
+   * \return  The labels that index the dense arrays used by the engine (in ascending order).
+   */
+  const std::vector<Label>& get_labels() const
+  {
+    return m_labels;
+  }
+
+  /**
+   * \brief Gets the current marginal probabilities as a dense [H][W][L] array.
+   *
+   * This allows clients that care about speed to consume the results without going via the CRF's label -> probability maps.
+   *
+   * \return  The current marginal probabilities, in which the probability of the k'th label at (x,y) is at index (y * W + x) * L + k.
+   */
+  const std::vector<float>& get_marginals() const
+  {
+    return m_marginals;
+  }
+
+  /**
+   * \brief Updates the CRF on which the mean-field inference engine works.
+   *
+   * \param iterations  The number of update iterations to run.
+   */
+  void update_crf(size_t iterations)
+  {
+    for(size_t i = 0; i < iterations; ++i)
+    {
+      run_iteration();
+    }
+
+    // Copy the dense marginals into the output grid and swap it into the CRF.
+    const size_t labelCount = m_labels.size();
+    for(int y = 0; y < m_height; ++y)
+    {
+      for(int x = 0; x < m_width; ++x)
+      {
+        gather(&m_marginals[(y * m_width + x) * labelCount], (*m_newMarginalsGrid)(y, x));
+      }
+    }
+
+    m_crf->swap_marginals(m_newMarginalsGrid);
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Computes the updated marginals for a row of the CRF.
+   *
+   * \param y             The row.
+   * \param neighbourSums Scratch space (of size W * L) into which to accumulate the sums of the neighbours' marginals for each pixel in the row.
+   * \param M_i           Scratch space (of size L) into which to write the marginal potentials for a pixel.
+   */
+  void compute_updated_row(int y, std::vector<float>& neighbourSums, std::vector<float>& M_i)
+  {
+    const int labelCount = static_cast<int>(m_labels.size());
+    const int rowSize = m_width * labelCount;
+
+    // Calculate S_i(L') = \sum_{j in N(i)} Q_j^{t-1}(L') for each pixel i in the row. For a given offset, the in-bounds neighbours
+    // of the pixels in the row form a contiguous span of a single row of the marginals, so we can add them all in one go.
+    std::fill(neighbourSums.begin(), neighbourSums.end(), 0.0f);
+    for(std::vector<Eigen::Vector2i>::const_iterator nt = m_neighbourOffsets.begin(), nend = m_neighbourOffsets.end(); nt != nend; ++nt)
+    {
+      const int yDash = y + nt->y();
+      if(yDash < 0 || yDash >= m_height) continue;
+
+      const int dx = nt->x();
+      const int xBegin = std::max(0, -dx), xEnd = std::min(m_width, m_width - dx);
+      if(xBegin >= xEnd) continue;
+
+      float *dest = &neighbourSums[xBegin * labelCount];
+      const float *src = &m_marginals[(yDash * m_width + xBegin + dx) * labelCount];
+      for(int k = 0, count = (xEnd - xBegin) * labelCount; k < count; ++k)
+      {
+        dest[k] += src[k];
+      }
+    }
+
+    // Calculate the new marginals for each pixel in the row.
+    const float *unaryPotentials = &m_unaryPotentials[y * rowSize];
+    float *newMarginals = &m_newMarginals[y * rowSize];
+    for(int x = 0; x < m_width; ++x)
+    {
+      const float *S_i = &neighbourSums[x * labelCount];
+      const float *phi_i = &unaryPotentials[x * labelCount];
+      float *Q_i = &newMarginals[x * labelCount];
+
+      // Compute M_i(L) = phi_i(L) + \sum_{L'} phi(L,L') S_i(L') for each label L.
+      float minM_i = std::numeric_limits<float>::infinity();
+      for(int k = 0; k < labelCount; ++k)
+      {
+        const float *phi_L = &m_pairwisePotentials[k * labelCount];
+        float M_i_L = 0.0f;
+        for(int kDash = 0; kDash < labelCount; ++kDash)
+        {
+          M_i_L += phi_L[kDash] * S_i[kDash];
+        }
+
+        M_i[k] = M_i_L + phi_i[k];
+        minM_i = std::min(minM_i, M_i[k]);
+      }
+
+      // If none of the labels has a finite potential (e.g. because all of the pixel's unary probabilities are zero), the
+      // normalisation below would produce NaNs, so fall back to a uniform distribution over the pixel's labels instead.
+      if(!(minM_i < std::numeric_limits<float>::infinity()))
+      {
+        fill_uniform(m_crf->get_unaries_at(Eigen::Vector2i(x, y)), Q_i);
+        continue;
+      }
+
+      // Compute Q_i^t(L) = 1/Z_i * e^-M_i(L). Note that we subtract the smallest M_i(L) before exponentiating, which cancels out
+      // in the normalisation but stops the exponentials underflowing when the potentials are large.
+      float Z_i = 0.0f;
+      for(int k = 0; k < labelCount; ++k)
+      {
+        Q_i[k] = expf(minM_i - M_i[k]);
+        Z_i += Q_i[k];
+      }
+
+      const float oneOverZ_i = 1.0f / Z_i;
+      for(int k = 0; k < labelCount; ++k)
+      {
+        Q_i[k] *= oneOverZ_i;
+      }
+    }
+  }
+
+  /**
+   * \brief Fills the dense probabilities for a pixel with a uniform distribution over the pixel's labels.
+   *
+   * \param labels  The pixel's label -> probability map (only the labels are used). If this is empty, all of the labels are used.
+   * \param dest    The dense probabilities for the pixel.
+   */
+  void fill_uniform(const std::map<Label,float>& labels, float *dest) const
+  {
+    const size_t labelCount = m_labels.size();
+    if(labels.empty())
+    {
+      std::fill(dest, dest + labelCount, 1.0f / labelCount);
+      return;
+    }
+
+    std::fill(dest, dest + labelCount, 0.0f);
+
+    const float p = 1.0f / labels.size();
+    size_t k = 0;
+    for(typename std::map<Label,float>::const_iterator kt = labels.begin(), kend = labels.end(); kt != kend; ++kt)
+    {
+      while(m_labels[k] < kt->first) ++k;
+      dest[k] = p;
+    }
+  }
+
+  /**
+   * \brief Copies the dense probabilities for a pixel into the existing entries of the pixel's label -> probability map.
+   *
+   * \param src   The dense probabilities for the pixel.
+   * \param dest  The pixel's label -> probability map.
+   */
+  void gather(const float *src, std::map<Label,float>& dest) const
+  {
+    size_t k = 0;
+    for(typename std::map<Label,float>::iterator kt = dest.begin(), kend = dest.end(); kt != kend; ++kt)
+    {
+      while(m_labels[k] < kt->first) ++k;
+      kt->second = src[k];
+    }
+  }
+
+  /**
+   * \brief Runs a single mean-field update iteration on the dense arrays.
+   */
+  void run_iteration()
+  {
+    const int labelCount = static_cast<int>(m_labels.size());
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel
+#endif
+    {
+      std::vector<float> neighbourSums(m_width * labelCount), M_i(labelCount);
+
+#ifdef WITH_OPENMP
+      #pragma omp for schedule(static)
+#endif
+      for(int y = 0; y < m_height; ++y)
+      {
+        compute_updated_row(y, neighbourSums, M_i);
+      }
+    }
+
+    m_marginals.swap(m_newMarginals);
+  }
+
+  /**
+   * \brief Copies the entries of a pixel's label -> probability map into the corresponding elements of a dense array.
+   *
+   * \param src   The pixel's label -> probability map.
+   * \param dest  The dense array for the pixel (the elements for labels that are absent from the map are left unchanged).
+   */
+  void scatter(const std::map<Label,float>& src, float *dest) const
+  {
+    size_t k = 0;
+    for(typename std::map<Label,float>::const_iterator kt = src.begin(), kend = src.end(); kt != kend; ++kt)
+    {
+      while(m_labels[k] < kt->first) ++k;
+      dest[k] = kt->second;
+    }
+  }
+};
+
+}
+
+#endif
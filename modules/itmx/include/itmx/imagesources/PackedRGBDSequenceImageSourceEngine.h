@@ -0,0 +1,67 @@
+/**
+ * itmx: PackedRGBDSequenceImageSourceEngine.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_PACKEDRGBDSEQUENCEIMAGESOURCEENGINE
+#define H_ITMX_PACKEDRGBDSEQUENCEIMAGESOURCEENGINE
+
+#include <InputSource/ImageSourceEngine.h>
+
+#include "../persistence/PackedRGBDSequenceReader.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to yield the RGB-D images stored in a packed RGB-D sequence.
+ */
+class PackedRGBDSequenceImageSourceEngine : public InputSource::ImageSourceEngine
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The calibration parameters to yield for the images. */
+  ITMLib::ITMRGBDCalib m_calib;
+
+  /** The message into which each frame is read from the sequence. */
+  RGBDFrameMessage_Ptr m_frameMsg;
+
+  /** The index of the next frame to yield. */
+  size_t m_nextFrameIdx;
+
+  /** The reader used to read the frames from the sequence. */
+  PackedRGBDSequenceReader_Ptr m_reader;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an image source engine that yields the RGB-D images stored in a packed RGB-D sequence.
+   *
+   * \param filename            The path to the packed RGB-D sequence.
+   * \param calibrationFilename The path to a calibration file to use instead of the calibration stored in the sequence (if any).
+   * \param initialFrameNumber  The number of the initial frame that we want to use.
+   *
+   * \throws std::runtime_error If the sequence or the calibration file cannot be read.
+   */
+  explicit PackedRGBDSequenceImageSourceEngine(const std::string& filename, const std::string& calibrationFilename = "", size_t initialFrameNumber = 0);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual ITMLib::ITMRGBDCalib getCalib() const;
+
+  /** Override */
+  virtual Vector2i getDepthImageSize() const;
+
+  /** Override */
+  virtual void getImages(ORUChar4Image *rgb, ORShortImage *rawDepth);
+
+  /** Override */
+  virtual Vector2i getRGBImageSize() const;
+
+  /** Override */
+  virtual bool hasMoreImages() const;
+};
+
+}
+
+#endif
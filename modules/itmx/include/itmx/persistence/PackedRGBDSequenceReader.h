@@ -0,0 +1,180 @@
+/**
+ * itmx: PackedRGBDSequenceReader.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_PACKEDRGBDSEQUENCEREADER
+#define H_ITMX_PACKEDRGBDSEQUENCEREADER
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "../remotemapping/RGBDCalibrationMessage.h"
+#include "../remotemapping/RGBDFrameCompressor.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class provides read-only access to a packed RGB-D sequence written by a PackedRGBDSequenceWriter.
+ *
+ * The file is memory-mapped rather than read, so opening it is almost instantaneous, and reading a frame involves no more than
+ * copying its (compressed) record out of the mapping and uncompressing it. If the sequence was not closed properly (e.g. because
+ * the application recording it crashed), the frame index is rebuilt by scanning the frame records, and any incomplete final frame
+ * is ignored.
+ *
+ * \note Reading frames is not thread-safe, since the reader uses internal buffers and a stateful decompressor. The poses of the
+ *       frames, however, are held in memory, and can be obtained from multiple threads via get_pose.
+ */
+class PackedRGBDSequenceReader
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The calibration of the camera that captured the sequence. */
+  ITMLib::ITMRGBDCalib m_calib;
+
+  /** The message used to hold the compressed version of each frame as it is read (reused between frames). */
+  boost::shared_ptr<CompressedRGBDFrameMessage> m_compressedFrameMsg;
+
+  /** The message used to hold the header of the compressed version of each frame as it is read. */
+  CompressedRGBDFrameHeaderMessage m_compressedHeaderMsg;
+
+  /** The path to the file. */
+  std::string m_filename;
+
+  /** The compressor used to uncompress the frames. */
+  RGBDFrameCompressor_Ptr m_frameCompressor;
+
+  /** The offsets and sizes of the frame records in the file. */
+  std::vector<std::pair<uint64_t,uint64_t> > m_frameRecords;
+
+  /** The memory-mapped file. */
+  boost::interprocess::file_mapping m_mapping;
+
+  /** The poses of the frames. */
+  std::vector<Matrix4f> m_poses;
+
+  /** The mapped region covering the whole file. */
+  boost::interprocess::mapped_region m_region;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Opens a packed RGB-D sequence.
+   *
+   * \param filename  The path to the file.
+   *
+   * \throws std::runtime_error If the file cannot be opened, or is not a valid packed RGB-D sequence.
+   */
+  explicit PackedRGBDSequenceReader(const std::string& filename);
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Determines whether or not the specified file looks like a packed RGB-D sequence.
+   *
+   * \note  This only checks the magic string at the start of the file (it does not validate the rest of the file).
+   *
+   * \param filename  The path to the file.
+   * \return          true, if the file starts with the magic string for a packed RGB-D sequence, or false otherwise.
+   */
+  static bool is_packed_sequence(const std::string& filename);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the calibration of the camera that captured the sequence.
+   *
+   * \return  The calibration of the camera that captured the sequence.
+   */
+  const ITMLib::ITMRGBDCalib& get_calib() const;
+
+  /**
+   * \brief Gets the size of the depth images in the sequence.
+   *
+   * \return  The size of the depth images in the sequence.
+   */
+  Vector2i get_depth_image_size() const;
+
+  /**
+   * \brief Gets the number of frames in the sequence.
+   *
+   * \return  The number of frames in the sequence.
+   */
+  size_t get_frame_count() const;
+
+  /**
+   * \brief Gets the pose of the specified frame.
+   *
+   * \param frameIdx  The index of the frame.
+   * \return          The pose of the frame.
+   *
+   * \throws std::out_of_range  If the frame index is out of range.
+   */
+  ORUtils::SE3Pose get_pose(size_t frameIdx) const;
+
+  /**
+   * \brief Gets the size of the RGB images in the sequence.
+   *
+   * \return  The size of the RGB images in the sequence.
+   */
+  Vector2i get_rgb_image_size() const;
+
+  /**
+   * \brief Reads and uncompresses the specified frame.
+   *
+   * \param frameIdx  The index of the frame.
+   * \param frameMsg  A message into which to write the frame (its image sizes must match those of the sequence).
+   *
+   * \throws std::out_of_range    If the frame index is out of range.
+   * \throws std::runtime_error   If the frame record is corrupt.
+   */
+  void read_frame(size_t frameIdx, RGBDFrameMessage& frameMsg);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Checks that the specified frame index is in range.
+   *
+   * \param frameIdx  The index of the frame.
+   *
+   * \throws std::out_of_range  If the frame index is out of range.
+   */
+  void check_frame_index(size_t frameIdx) const;
+
+  /**
+   * \brief Attempts to read the frame index from the end of the file.
+   *
+   * \param dataOffset  The offset of the first frame record in the file.
+   * \return            true, if the file has a valid frame index, or false otherwise.
+   */
+  bool read_index(uint64_t dataOffset);
+
+  /**
+   * \brief Rebuilds the frame index by scanning the frame records in the file.
+   *
+   * \param dataOffset  The offset of the first frame record in the file.
+   */
+  void scan_records(uint64_t dataOffset);
+
+  /**
+   * \brief Copies the specified frame record into the compressed frame header and frame messages.
+   *
+   * \param frameIdx  The index of the frame.
+   * \return          true, if the record was consistent with the compressed frame header it contains, or false otherwise.
+   */
+  bool unpack_record(size_t frameIdx);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<PackedRGBDSequenceReader> PackedRGBDSequenceReader_Ptr;
+typedef boost::shared_ptr<const PackedRGBDSequenceReader> PackedRGBDSequenceReader_CPtr;
+
+}
+
+#endif
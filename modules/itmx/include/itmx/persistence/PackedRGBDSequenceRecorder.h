@@ -0,0 +1,116 @@
+/**
+ * itmx: PackedRGBDSequenceRecorder.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_PACKEDRGBDSEQUENCERECORDER
+#define H_ITMX_PACKEDRGBDSEQUENCERECORDER
+
+#include <boost/thread.hpp>
+
+#include <orx/base/ORImagePtrTypes.h>
+
+#include <tvgutil/containers/PooledQueue.h>
+
+#include "PackedRGBDSequenceWriter.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to record RGB-D frames to a packed RGB-D sequence in the background.
+ *
+ * Frames are copied into a fixed-size pool of frame messages, and compressed and written to disk on a separate thread.
+ * If the writer thread falls behind, the pool eventually runs dry, at which point record_frame blocks until a message
+ * becomes available again. This bounds the memory used by the recorder, and ensures that no frames are ever dropped.
+ */
+class PackedRGBDSequenceRecorder
+{
+  //#################### TYPEDEFS ####################
+private:
+  typedef tvgutil::PooledQueue<RGBDFrameMessage_Ptr> RGBDFrameMessageQueue;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The index to assign to the next frame that is recorded. */
+  int m_frameIndex;
+
+  /** A queue containing the frames that are waiting to be written to disk. */
+  RGBDFrameMessageQueue m_frameMessageQueue;
+
+  /** The writer used to write the frames to disk. */
+  PackedRGBDSequenceWriter_Ptr m_writer;
+
+  /** The thread on which the frames are written to disk. */
+  boost::shared_ptr<boost::thread> m_writerThread;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a packed RGB-D sequence recorder, and starts its writer thread.
+   *
+   * \param filename              The path to the file to which to record.
+   * \param calib                 The calibration of the camera that is capturing the frames.
+   * \param rgbImageSize          The size of the RGB images to be recorded.
+   * \param depthImageSize        The size of the depth images to be recorded.
+   * \param capacity              The maximum number of frames that can be waiting to be written to disk at any one time.
+   * \param rgbCompressionType    The type of compression to apply to the RGB images.
+   * \param depthCompressionType  The type of compression to apply to the depth images.
+   *
+   * \throws std::invalid_argument  If the specified compression types cannot be used.
+   * \throws std::runtime_error     If the file cannot be opened for writing.
+   */
+  PackedRGBDSequenceRecorder(const std::string& filename, const ITMLib::ITMRGBDCalib& calib, const Vector2i& rgbImageSize, const Vector2i& depthImageSize,
+                             size_t capacity = 30, RGBCompressionType rgbCompressionType = RGB_COMPRESSION_NONE,
+                             DepthCompressionType depthCompressionType = DEPTH_COMPRESSION_RVL);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the recorder, after first waiting for any frames that are still waiting to be written to disk.
+   */
+  ~PackedRGBDSequenceRecorder();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  PackedRGBDSequenceRecorder(const PackedRGBDSequenceRecorder&);
+  PackedRGBDSequenceRecorder& operator=(const PackedRGBDSequenceRecorder&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Records an RGB-D frame.
+   *
+   * \note  The images are copied before this function returns, so the caller is free to modify them afterwards.
+   * \note  This blocks if the maximum number of frames are already waiting to be written to disk.
+   *
+   * \param rgbImage    The RGB image.
+   * \param depthImage  The depth image.
+   * \param pose        The pose of the camera when the images were captured.
+   */
+  void record_frame(const ORUChar4Image_CPtr& rgbImage, const ORShortImage_CPtr& depthImage, const ORUtils::SE3Pose& pose);
+
+  /**
+   * \brief Stops the recorder, after first waiting for any frames that are still waiting to be written to disk.
+   *
+   * \throws std::runtime_error If the sequence could not be written successfully.
+   */
+  void stop();
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Writes frames to disk until a null frame message is encountered on the queue.
+   *
+   * This runs on the writer thread.
+   */
+  void run_writer();
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<PackedRGBDSequenceRecorder> PackedRGBDSequenceRecorder_Ptr;
+
+}
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ * itmx: PackedRGBDSequenceWriter.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_PACKEDRGBDSEQUENCEWRITER
+#define H_ITMX_PACKEDRGBDSEQUENCEWRITER
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "../remotemapping/RGBDCalibrationMessage.h"
+#include "../remotemapping/RGBDFrameCompressor.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to write a packed RGB-D sequence, i.e. a single file containing the calibration
+ *        of an RGB-D camera, followed by a sequence of (optionally compressed) RGB-D frames and their poses.
+ *
+ * The file is written in append-only fashion, so a recording that is interrupted before the writer is closed can still be read
+ * (the reader rebuilds the frame index by scanning the frame records if the index at the end of the file is missing). Each frame
+ * is compressed independently of the others, so that frames can be read in any order.
+ *
+ * \note File format (binary mode, native endianness):
+ *
+ * magic ("SPRGBDSQ"), version (uint32), calibration message size (uint32), calibration message
+ * for each frame: record size (uint64), compressed frame header message, compressed frame message
+ * index: for each frame, record offset (uint64), pose matrix (16 floats)
+ * trailer: index offset (uint64), frame count (uint64), magic ("SPRGBDIX")
+ */
+class PackedRGBDSequenceWriter
+{
+  //#################### CONSTANTS ####################
+public:
+  /** The magic string at the start of every packed RGB-D sequence. */
+  static const char *HEADER_MAGIC;
+
+  /** The size (in bytes) of each entry in the frame index. */
+  static const size_t INDEX_ENTRY_SIZE = sizeof(uint64_t) + 16 * sizeof(float);
+
+  /** The length of the magic strings in the file. */
+  static const size_t MAGIC_SIZE = 8;
+
+  /** The magic string at the end of every packed RGB-D sequence that was closed properly. */
+  static const char *TRAILER_MAGIC;
+
+  /** The size (in bytes) of the trailer at the end of the file. */
+  static const size_t TRAILER_SIZE = 2 * sizeof(uint64_t) + MAGIC_SIZE;
+
+  /** The version of the file format. */
+  static const uint32_t VERSION = 1;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The message used to hold the compressed version of each frame (reused between frames). */
+  boost::shared_ptr<CompressedRGBDFrameMessage> m_compressedFrameMsg;
+
+  /** The message used to hold the header of the compressed version of each frame. */
+  CompressedRGBDFrameHeaderMessage m_compressedHeaderMsg;
+
+  /** The path to the file being written. */
+  std::string m_filename;
+
+  /** The compressor used to compress the frames. */
+  RGBDFrameCompressor_Ptr m_frameCompressor;
+
+  /** The offsets of the frame records that have been written so far, together with the poses of the frames. */
+  std::vector<std::pair<uint64_t,Matrix4f> > m_frames;
+
+  /** The stream to which the file is being written. */
+  std::ofstream m_fs;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Starts writing a packed RGB-D sequence.
+   *
+   * \param filename              The path to the file.
+   * \param calib                 The calibration of the camera that captured the sequence.
+   * \param rgbImageSize          The size of the RGB images in the sequence.
+   * \param depthImageSize        The size of the depth images in the sequence.
+   * \param rgbCompressionType    The type of compression to apply to the RGB images.
+   * \param depthCompressionType  The type of compression to apply to the depth images.
+   *
+   * \throws std::invalid_argument  If the specified compression types cannot be used (temporal compression is not supported,
+   *                                since it would prevent the frames from being read independently).
+   * \throws std::runtime_error     If the file cannot be opened for writing.
+   */
+  PackedRGBDSequenceWriter(const std::string& filename, const ITMLib::ITMRGBDCalib& calib, const Vector2i& rgbImageSize, const Vector2i& depthImageSize,
+                           RGBCompressionType rgbCompressionType = RGB_COMPRESSION_NONE, DepthCompressionType depthCompressionType = DEPTH_COMPRESSION_RVL);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the writer, closing the file if it has not already been closed.
+   */
+  ~PackedRGBDSequenceWriter();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  PackedRGBDSequenceWriter(const PackedRGBDSequenceWriter&);
+  PackedRGBDSequenceWriter& operator=(const PackedRGBDSequenceWriter&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Finishes writing the sequence by appending the frame index and trailer.
+   *
+   * \throws std::runtime_error If the file could not be written successfully.
+   */
+  void close();
+
+  /**
+   * \brief Gets the number of frames that have been written so far.
+   *
+   * \return  The number of frames that have been written so far.
+   */
+  size_t get_frame_count() const;
+
+  /**
+   * \brief Compresses an RGB-D frame and appends it to the sequence.
+   *
+   * \param frameMsg  A message containing the RGB-D frame and its pose.
+   *
+   * \throws std::runtime_error If the writer has been closed, or the frame could not be written.
+   */
+  void write_frame(const RGBDFrameMessage& frameMsg);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<PackedRGBDSequenceWriter> PackedRGBDSequenceWriter_Ptr;
+
+}
+
+#endif
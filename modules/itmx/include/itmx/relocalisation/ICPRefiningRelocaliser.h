@@ -6,6 +6,7 @@
 #ifndef H_ITMX_ICPREFININGRELOCALISER
 #define H_ITMX_ICPREFININGRELOCALISER
 
+#include <boost/function.hpp>
 #include <boost/optional.hpp>
 
 #ifdef WITH_OPENCV
@@ -28,6 +29,12 @@ namespace itmx {
 /**
  * \brief An instance of this class can be used to refine the results of another relocaliser using ICP.
  *
+ * By default, the results of the inner relocaliser are refined one after another at full resolution. If batched refinement
+ * is enabled (via the ICPRefiningRelocaliser.batchRefinement setting), the candidates are first refined against downsampled
+ * versions of the input and a raycast of the scene, after which only the most promising few are refined at full resolution.
+ * Each stage is performed by a set of workers with their own trackers and render states, which (on the CPU) allows several
+ * candidates to be refined concurrently.
+ *
  * \tparam VoxelType  The type of voxel used to reconstruct the scene that will be used during the raycasting step.
  * \tparam IndexType  The type of indexing used to access the reconstructed scene.
  */
@@ -35,6 +42,10 @@ template <typename VoxelType, typename IndexType>
 class ICPRefiningRelocaliser : public orx::RefiningRelocaliser
 {
   //#################### TYPEDEFS ####################
+public:
+  /** A function that can be used to make an ICP tracker for images of the specified (colour and depth) sizes. */
+  typedef boost::function<Tracker_Ptr(const Vector2i&,const Vector2i&)> TrackerMaker;
+
 private:
   typedef ITMLib::ITMDenseMapper<VoxelType,IndexType> DenseMapper;
   typedef boost::shared_ptr<DenseMapper> DenseMapper_Ptr;
@@ -43,17 +54,60 @@ private:
   typedef ITMLib::ITMVisualisationEngine<VoxelType,IndexType> VisualisationEngine;
   typedef boost::shared_ptr<const VisualisationEngine> VisualisationEngine_CPtr;
 
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the objects needed to refine a single candidate pose during batched refinement.
+   *
+   * Each worker has its own tracker, tracking state and render state, so several workers can be used at the same time.
+   */
+  struct RefinementWorker
+  {
+    /** The dense mapper used to find visible blocks in the voxel scene. */
+    DenseMapper_Ptr m_denseVoxelMapper;
+
+    /** The ICP tracker used to refine the candidate poses. */
+    Tracker_Ptr m_tracker;
+
+    /** The tracking controller used to set up and perform the actual refinement. */
+    TrackingController_Ptr m_trackingController;
+
+    /** The tracking state used to hold the refinement results. */
+    TrackingState_Ptr m_trackingState;
+
+    /** The visualisation engine used to perform the raycasting. */
+    VisualisationEngine_CPtr m_visualisationEngine;
+
+    /** The voxel render state used to hold the raycasting results. */
+    VoxelRenderState_Ptr m_voxelRenderState;
+  };
+
   //#################### PRIVATE MEMBER VARIABLES ####################
 private:
+  /** Whether or not to prune the candidates using coarse ICP and refine the survivors using a set of workers. */
+  bool m_batchRefinement;
+
   /** Whether or not to choose the best result. */
   bool m_chooseBestResult;
 
+  /** The view used to hold downsampled versions of the input colour and depth images during batched refinement. */
+  View_Ptr m_coarseView;
+
+  /** The workers used to refine the candidates against the downsampled input during batched refinement. */
+  mutable std::vector<RefinementWorker> m_coarseWorkers;
+
   /** The dense mapper used to find visible blocks in the voxel scene. */
   DenseMapper_Ptr m_denseVoxelMapper;
 
   /** The depth visualiser. */
   DepthVisualiser_CPtr m_depthVisualiser;
 
+  /** The intermediate images used when downsampling the input colour image during batched refinement. */
+  std::vector<ORUChar4Image_Ptr> m_downsampledColourImages;
+
+  /** The intermediate images used when downsampling the input depth image during batched refinement. */
+  std::vector<ORFloatImage_Ptr> m_downsampledDepthImages;
+
   /** The path generator used to find the ground truth pose files. */
   mutable boost::optional<tvgutil::SequentialPathGenerator> m_gtPathGenerator;
 
@@ -63,6 +117,15 @@ private:
   /** The path generator used when saving the relocalised poses. */
   mutable boost::optional<tvgutil::SequentialPathGenerator> m_posePathGenerator;
 
+  /** The engine used to downsample the input depth image during batched refinement. */
+  LowLevelEngine_CPtr m_lowLevelEngine;
+
+  /** The maximum number of candidates that survive the coarse pruning during batched refinement. */
+  size_t m_maxCandidatesAfterPruning;
+
+  /** The workers used to refine the surviving candidates at full resolution during batched refinement. */
+  mutable std::vector<RefinementWorker> m_refinementWorkers;
+
   /** Whether or not to save the images rendered from the relocalised poses. */
   bool m_saveImages;
 
@@ -78,6 +141,9 @@ private:
   /** The settings to use for InfiniTAM. */
   Settings_CPtr m_settings;
 
+  /** The timer used to profile the coarse pruning of the candidates during batched refinement. */
+  mutable AverageTimer m_timerCoarsePruning;
+
   /** The timer used to profile the initial relocalisations. */
   mutable AverageTimer m_timerInitialRelocalisation;
 
@@ -127,11 +193,14 @@ public:
    * \param scene               The scene being viewed from the camera.
    * \param denseVoxelMapper    The dense mapper used to find visible blocks in the voxel scene.
    * \param settings            The settings to use for InfiniTAM.
+   * \param trackerMaker        A function that can be used to make the additional trackers needed for batched refinement (if enabled).
+   * \throws std::runtime_error  If batched refinement is enabled but no tracker maker has been specified.
    */
   ICPRefiningRelocaliser(const orx::Relocaliser_Ptr& innerRelocaliser, const Tracker_Ptr& tracker,
                          const Vector2i& rgbImageSize, const Vector2i& depthImageSize,
                          const ITMLib::ITMRGBDCalib& calib, const Scene_Ptr& scene,
-                         const DenseMapper_Ptr& denseVoxelMapper, const Settings_CPtr& settings);
+                         const DenseMapper_Ptr& denseVoxelMapper, const Settings_CPtr& settings,
+                         const TrackerMaker& trackerMaker = TrackerMaker());
 
   //#################### DESTRUCTOR ####################
 public:
@@ -180,6 +249,19 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Adds a refined result to the output, or (if we're choosing the best result) keeps it only if it is the best so far.
+   *
+   * \param candidateIdx    The index of the candidate (among the results of the inner relocaliser) from which the result was refined.
+   * \param initialPose     The initial pose from which the result was refined.
+   * \param refinedResult   The refined result.
+   * \param bestScore       The score of the best result so far (updated if we're choosing the best result and the new result is better).
+   * \param initialPoses    The initial poses corresponding to the output results.
+   * \param refinedResults  The output results.
+   */
+  void add_refined_result(size_t candidateIdx, const ORUtils::SE3Pose& initialPose, Result refinedResult, float& bestScore,
+                          std::vector<ORUtils::SE3Pose>& initialPoses, std::vector<Result>& refinedResults) const;
+
 #ifdef WITH_OPENCV
   /**
    * \brief Computes a difference image between two depth images, and saves it to disk.
@@ -202,6 +284,40 @@ private:
   void save_colourised_depth(const ORFloatImage *depthF, const ORUChar4Image_Ptr& depthU, const std::string& pattern) const;
 #endif
 
+  /**
+   * \brief Makes a worker that can be used to refine candidate poses against input images of the specified sizes.
+   *
+   * \param rgbImageSize    The size of the colour images against which the worker will refine poses.
+   * \param depthImageSize  The size of the depth images against which the worker will refine poses.
+   * \param trackerMaker    The function to use to make the worker's tracker.
+   * \return                The worker.
+   */
+  RefinementWorker make_refinement_worker(const Vector2i& rgbImageSize, const Vector2i& depthImageSize, const TrackerMaker& trackerMaker) const;
+
+  /**
+   * \brief Refines the results of the inner relocaliser in batched mode.
+   *
+   * The candidates are first refined against a downsampled version of the input. They are then ranked by how well that went
+   * (candidates for which tracking was good, then those for which it was poor, then those for which it failed, preserving the
+   * order of the inner relocaliser within each group), and the best few are refined at full resolution.
+   *
+   * \param initialResults  The results of the inner relocaliser.
+   * \param initialPoses    The initial poses corresponding to the output results.
+   * \param refinedResults  The output results.
+   */
+  void refine_batched(const std::vector<Result>& initialResults, std::vector<ORUtils::SE3Pose>& initialPoses, std::vector<Result>& refinedResults) const;
+
+  /**
+   * \brief Refines a candidate pose using the specified worker.
+   *
+   * The refined pose and the result of the tracking are left in the worker's tracking state.
+   *
+   * \param initialPose The candidate pose.
+   * \param view        The view containing the input images against which to refine the pose.
+   * \param worker      The worker to use.
+   */
+  void refine_pose(const ORUtils::SE3Pose& initialPose, const View_Ptr& view, RefinementWorker& worker) const;
+
   /**
    * \brief Saves the relocalised and refined poses in text files so that they can be used later (e.g. for evaluation).
    *
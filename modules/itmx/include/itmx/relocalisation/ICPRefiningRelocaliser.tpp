@@ -5,14 +5,21 @@
 
 #include "ICPRefiningRelocaliser.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
 #include <ITMLib/Core/ITMTrackingController.h>
+#include <ITMLib/Engines/LowLevel/ITMLowLevelEngineFactory.h>
 #include <ITMLib/Engines/Visualisation/ITMVisualisationEngineFactory.h>
 #include <ITMLib/Objects/RenderStates/ITMRenderStateFactory.h>
 #include <ITMLib/Trackers/ITMTrackerFactory.h>
 
+#include <orx/base/MemoryBlockFactory.h>
 #include <orx/base/ORImagePtrTypes.h>
 #include <orx/persistence/PosePersister.h>
 
@@ -35,12 +42,14 @@ template <typename VoxelType, typename IndexType>
 ICPRefiningRelocaliser<VoxelType,IndexType>::ICPRefiningRelocaliser(const orx::Relocaliser_Ptr& innerRelocaliser, const Tracker_Ptr& tracker,
                                                                     const Vector2i& rgbImageSize, const Vector2i& depthImageSize,
                                                                     const ITMLib::ITMRGBDCalib& calib, const Scene_Ptr& scene,
-                                                                    const DenseMapper_Ptr& denseVoxelMapper, const Settings_CPtr& settings)
+                                                                    const DenseMapper_Ptr& denseVoxelMapper, const Settings_CPtr& settings,
+                                                                    const TrackerMaker& trackerMaker)
 : RefiningRelocaliser(innerRelocaliser),
   m_denseVoxelMapper(denseVoxelMapper),
   m_depthVisualiser(DepthVisualiserFactory::make_depth_visualiser(settings->deviceType)),
   m_scene(scene),
   m_settings(settings),
+  m_timerCoarsePruning("Coarse ICP Pruning"),
   m_timerInitialRelocalisation("Initial Relocalisation"),
   m_timerRefinement("ICP Refinement"),
   m_timerRelocalisation("Relocalisation"),
@@ -61,12 +70,65 @@ ICPRefiningRelocaliser<VoxelType,IndexType>::ICPRefiningRelocaliser(const orx::R
 
   // Configure the relocaliser based on the settings that have been passed in.
   const static std::string settingsNamespace = "ICPRefiningRelocaliser.";
+  m_batchRefinement = m_settings->get_first_value<bool>(settingsNamespace + "batchRefinement", false);
   m_chooseBestResult = m_settings->get_first_value<bool>(settingsNamespace + "chooseBestResult", false);
   m_saveImages = m_settings->get_first_value<bool>(settingsNamespace + "saveRelocalisationImages", false);
   m_savePoses = m_settings->get_first_value<bool>(settingsNamespace + "saveRelocalisationPoses", false);
   m_saveTimes = m_settings->get_first_value<bool>(settingsNamespace + "saveRelocalisationTimes", false);
   m_timersEnabled = m_settings->get_first_value<bool>(settingsNamespace + "timersEnabled", false);
 
+  if(m_batchRefinement)
+  {
+    if(!trackerMaker)
+    {
+      throw std::runtime_error("Error: Batched ICP refinement requires a function that can make the trackers for the workers.");
+    }
+
+    m_maxCandidatesAfterPruning = std::max<size_t>(1, m_settings->get_first_value<size_t>(settingsNamespace + "maxCandidatesAfterPruning", 4));
+    const int coarseDownsamplingSteps = std::max(1, m_settings->get_first_value<int>(settingsNamespace + "coarseDownsamplingSteps", 2));
+
+    // Make the images needed to downsample the input colour and depth images, and a view to hold the downsampled images.
+    // Both images are downsampled, so that trackers that use colour as well as depth can be used for the coarse refinement.
+    orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
+    m_lowLevelEngine.reset(ITMLowLevelEngineFactory::MakeLowLevelEngine(m_settings->deviceType));
+
+    Vector2i coarseRGBImageSize = rgbImageSize, coarseDepthImageSize = depthImageSize;
+    for(int i = 0; i < coarseDownsamplingSteps; ++i)
+    {
+      coarseRGBImageSize /= 2;
+      coarseDepthImageSize /= 2;
+      if(i + 1 < coarseDownsamplingSteps)
+      {
+        m_downsampledColourImages.push_back(mbf.make_image<Vector4u>(coarseRGBImageSize, "relocaliser"));
+        m_downsampledDepthImages.push_back(mbf.make_image<float>(coarseDepthImageSize, "relocaliser"));
+      }
+    }
+
+    const float scale = 1.0f / (1 << coarseDownsamplingSteps);
+    const Vector4f& pD = calib.intrinsics_d.projectionParamsSimple.all;
+    const Vector4f& pRGB = calib.intrinsics_rgb.projectionParamsSimple.all;
+    ITMLib::ITMRGBDCalib coarseCalib = calib;
+    coarseCalib.intrinsics_d.SetFrom(coarseDepthImageSize.x, coarseDepthImageSize.y, pD.x * scale, pD.y * scale, pD.z * scale, pD.w * scale);
+    coarseCalib.intrinsics_rgb.SetFrom(coarseRGBImageSize.x, coarseRGBImageSize.y, pRGB.x * scale, pRGB.y * scale, pRGB.z * scale, pRGB.w * scale);
+    m_coarseView.reset(new ITMLib::ITMView(coarseCalib, coarseRGBImageSize, coarseDepthImageSize, m_settings->deviceType == ORUtils::DEVICE_CUDA));
+
+    // Make the workers. Since the CUDA engines keep intermediate results in internal buffers, the candidates can only
+    // safely be refined concurrently on the CPU, so we only make more than one worker for each stage in that case.
+    size_t workerCount = 1;
+#ifdef WITH_OPENMP
+    if(m_settings->deviceType == ORUtils::DEVICE_CPU)
+    {
+      workerCount = std::max<size_t>(1, std::min<size_t>(omp_get_max_threads(), m_settings->get_first_value<size_t>(settingsNamespace + "maxConcurrentRefinements", 4)));
+    }
+#endif
+
+    for(size_t i = 0; i < workerCount; ++i)
+    {
+      m_coarseWorkers.push_back(make_refinement_worker(coarseRGBImageSize, coarseDepthImageSize, trackerMaker));
+      if(i < m_maxCandidatesAfterPruning) m_refinementWorkers.push_back(make_refinement_worker(rgbImageSize, depthImageSize, trackerMaker));
+    }
+  }
+
   // Get the (global) experiment tag.
   const std::string experimentTag = m_settings->get_first_value<std::string>("experimentTag", tvgutil::TimeUtil::get_iso_timestamp());
 
@@ -123,6 +185,7 @@ ICPRefiningRelocaliser<VoxelType,IndexType>::~ICPRefiningRelocaliser()
     std::cout << "Training calls: " << m_timerTraining.count() << ", average duration: " << m_timerTraining.average_duration() << '\n';
     std::cout << "Update calls: " << m_timerUpdate.count() << ", average duration: " << m_timerUpdate.average_duration() << '\n';
     std::cout << "Initial Relocalisation calls: " << m_timerInitialRelocalisation.count() << ", average duration: " << m_timerInitialRelocalisation.average_duration() << '\n';
+    if(m_batchRefinement) std::cout << "Coarse ICP Pruning calls: " << m_timerCoarsePruning.count() << ", average duration: " << m_timerCoarsePruning.average_duration() << '\n';
     std::cout << "ICP Refinement calls: " << m_timerRefinement.count() << ", average duration: " << m_timerRefinement.average_duration() << '\n';
     std::cout << "Total Relocalisation calls: " << m_timerRelocalisation.count() << ", average duration: " << m_timerRelocalisation.average_duration() << '\n';
   }
@@ -138,7 +201,11 @@ ICPRefiningRelocaliser<VoxelType,IndexType>::~ICPRefiningRelocaliser()
        << m_timerUpdate.average_duration().count() << ' '
        << m_timerInitialRelocalisation.average_duration().count() << ' '
        << m_timerRefinement.average_duration().count() << ' '
-       << m_timerRelocalisation.average_duration().count() << '\n';
+       << m_timerRelocalisation.average_duration().count();
+
+    // The coarse pruning time (if any) is output last, so that the positions of the other columns are unchanged.
+    if(m_batchRefinement) fs << ' ' << m_timerCoarsePruning.average_duration().count();
+    fs << '\n';
   }
 }
 
@@ -203,10 +270,13 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
   }
 
   std::vector<Relocaliser::Result> refinedResults;
-  float bestScore = static_cast<float>(INT_MAX);
 
   start_timer_nosync(m_timerRefinement); // No need to synchronize the GPU again.
 
+  // Copy the depth and RGB images into the view. We only need to do this once, since the refinement never modifies them.
+  m_view->depth->SetFrom(depthImage, m_settings->deviceType == ORUtils::DEVICE_CUDA ? ORFloatImage::CUDA_TO_CUDA : ORFloatImage::CPU_TO_CPU);
+  m_view->rgb->SetFrom(colourImage, m_settings->deviceType == ORUtils::DEVICE_CUDA ? ORUChar4Image::CUDA_TO_CUDA : ORUChar4Image::CPU_TO_CPU);
+
   // Reset the render state before raycasting (we do this once for each relocalisation attempt).
   // FIXME: It would be nicer to simply create the render state once and then reuse it, but unfortunately this leads
   //        to the program randomly crashing after a while. The crash may be occurring because we don't use this render
@@ -215,64 +285,41 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
   //        be to pass in a render state that is being used elsewhere and reuse it here, but that feels messier.
   m_voxelRenderState->Reset();
 
-  // For each initial result from the inner relocaliser:
-  for(size_t resultIdx = 0; resultIdx < initialResults.size(); ++resultIdx)
+  if(m_batchRefinement)
   {
-    // Get the suggested pose.
-    const ORUtils::SE3Pose initialPose = initialResults[resultIdx].pose;
-
-    // Copy the depth and RGB images into the view.
-    m_view->depth->SetFrom(depthImage, m_settings->deviceType == ORUtils::DEVICE_CUDA ? ORFloatImage::CUDA_TO_CUDA : ORFloatImage::CPU_TO_CPU);
-    m_view->rgb->SetFrom(colourImage, m_settings->deviceType == ORUtils::DEVICE_CUDA ? ORUChar4Image::CUDA_TO_CUDA : ORUChar4Image::CPU_TO_CPU);
-
-    // Set up the tracking state using the initial pose.
-    m_trackingState->pose_d->SetFrom(&initialPose);
+    refine_batched(initialResults, initialPoses, refinedResults);
+  }
+  else
+  {
+    float bestScore = static_cast<float>(INT_MAX);
 
-    // Update the list of visible blocks.
-    const bool resetVisibleList = true;
-    m_denseVoxelMapper->UpdateVisibleList(m_view.get(), m_trackingState.get(), m_scene.get(), m_voxelRenderState.get(), resetVisibleList);
+    // For each initial result from the inner relocaliser:
+    for(size_t resultIdx = 0; resultIdx < initialResults.size(); ++resultIdx)
+    {
+      // Get the suggested pose.
+      const ORUtils::SE3Pose initialPose = initialResults[resultIdx].pose;
 
-    // Raycast from the initial pose to prepare for tracking.
-    m_trackingController->Prepare(m_trackingState.get(), m_scene.get(), m_view.get(), m_visualisationEngine.get(), m_voxelRenderState.get());
+      // Set up the tracking state using the initial pose.
+      m_trackingState->pose_d->SetFrom(&initialPose);
 
-    // Run the tracker to refine the initial pose.
-    m_trackingController->Track(m_trackingState.get(), m_view.get());
+      // Update the list of visible blocks.
+      const bool resetVisibleList = true;
+      m_denseVoxelMapper->UpdateVisibleList(m_view.get(), m_trackingState.get(), m_scene.get(), m_voxelRenderState.get(), resetVisibleList);
 
-    // If tracking succeeded:
-    if(m_trackingState->trackerResult != ITMLib::ITMTrackingState::TRACKING_FAILED)
-    {
-      // Set up the refined result.
-      Result refinedResult;
-      refinedResult.pose.SetFrom(m_trackingState->pose_d);
-      refinedResult.quality = m_trackingState->trackerResult == ITMLib::ITMTrackingState::TRACKING_GOOD ? RELOCALISATION_GOOD : RELOCALISATION_POOR;
-      refinedResult.score = m_trackingState->trackerScore;
-
-      // If we're trying to choose the best relocalisation after refinement:
-      if(m_chooseBestResult)
-      {
-        // Score the refined result.
-        refinedResult.score = score_pose(refinedResult.pose);
+      // Raycast from the initial pose to prepare for tracking.
+      m_trackingController->Prepare(m_trackingState.get(), m_scene.get(), m_view.get(), m_visualisationEngine.get(), m_voxelRenderState.get());
 
-#if DEBUGGING
-        std::cout << resultIdx << ": " << refinedResult.score << '\n';
-#endif
+      // Run the tracker to refine the initial pose.
+      m_trackingController->Track(m_trackingState.get(), m_view.get());
 
-        // If the score is better than the current best score, update the current best score and result.
-        if(refinedResult.score < bestScore)
-        {
-          bestScore = refinedResult.score;
-          initialPoses.clear();
-          initialPoses.push_back(initialPose);
-          refinedResults.clear();
-          refinedResults.push_back(refinedResult);
-        }
-      }
-      else
+      // If tracking succeeded, set up the refined result and add it to the output.
+      if(m_trackingState->trackerResult != ITMLib::ITMTrackingState::TRACKING_FAILED)
       {
-        // If we're not trying to choose the best relocalisation after refinement,
-        // simply store the initial pose and refined result without any scoring.
-        initialPoses.push_back(initialPose);
-        refinedResults.push_back(refinedResult);
+        Result refinedResult;
+        refinedResult.pose.SetFrom(m_trackingState->pose_d);
+        refinedResult.quality = m_trackingState->trackerResult == ITMLib::ITMTrackingState::TRACKING_GOOD ? RELOCALISATION_GOOD : RELOCALISATION_POOR;
+        refinedResult.score = m_trackingState->trackerScore;
+        add_refined_result(resultIdx, initialPose, refinedResult, bestScore, initialPoses, refinedResults);
       }
     }
   }
@@ -315,8 +362,9 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
   {
 #if WITH_OPENCV
     const cv::Size imgSize(m_view->depth->noDims.width, m_view->depth->noDims.height);
-    ORFloatImage_Ptr synthDepthF(new ORFloatImage(m_view->depth->noDims, true, true));
-    ORUChar4Image_Ptr synthDepthU(new ORUChar4Image(m_view->depth->noDims, true, true));
+    orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
+    ORFloatImage_Ptr synthDepthF = mbf.make_image<float>(m_view->depth->noDims, "relocaliser");
+    ORUChar4Image_Ptr synthDepthU = mbf.make_image<Vector4u>(m_view->depth->noDims, "relocaliser");
 
     // Step 1: Read in the ground truth pose (stored as a matrix in column-major order).
     std::ifstream poseFile(m_gtPathGenerator->make_path("frame-%06i.pose.txt").string().c_str());
@@ -432,6 +480,39 @@ void ICPRefiningRelocaliser<VoxelType,IndexType>::update()
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+template <typename VoxelType, typename IndexType>
+void ICPRefiningRelocaliser<VoxelType,IndexType>::add_refined_result(size_t candidateIdx, const ORUtils::SE3Pose& initialPose, Result refinedResult, float& bestScore,
+                                                                      std::vector<ORUtils::SE3Pose>& initialPoses, std::vector<Result>& refinedResults) const
+{
+  // If we're trying to choose the best relocalisation after refinement:
+  if(m_chooseBestResult)
+  {
+    // Score the refined result.
+    refinedResult.score = score_pose(refinedResult.pose);
+
+#if DEBUGGING
+    std::cout << candidateIdx << ": " << refinedResult.score << '\n';
+#endif
+
+    // If the score is better than the current best score, update the current best score and result.
+    if(refinedResult.score < bestScore)
+    {
+      bestScore = refinedResult.score;
+      initialPoses.clear();
+      initialPoses.push_back(initialPose);
+      refinedResults.clear();
+      refinedResults.push_back(refinedResult);
+    }
+  }
+  else
+  {
+    // If we're not trying to choose the best relocalisation after refinement,
+    // simply store the initial pose and refined result without any scoring.
+    initialPoses.push_back(initialPose);
+    refinedResults.push_back(refinedResult);
+  }
+}
+
 #ifdef WITH_OPENCV
 template <typename VoxelType, typename IndexType>
 void ICPRefiningRelocaliser<VoxelType,IndexType>::compute_and_save_diff(const cv::Mat& depthImage1, const cv::Mat& depthImage2, const std::string& pattern) const
@@ -457,6 +538,168 @@ void ICPRefiningRelocaliser<VoxelType,IndexType>::save_colourised_depth(const OR
 }
 #endif
 
+template <typename VoxelType, typename IndexType>
+typename ICPRefiningRelocaliser<VoxelType,IndexType>::RefinementWorker
+ICPRefiningRelocaliser<VoxelType,IndexType>::make_refinement_worker(const Vector2i& rgbImageSize, const Vector2i& depthImageSize, const TrackerMaker& trackerMaker) const
+{
+  RefinementWorker worker;
+  worker.m_denseVoxelMapper.reset(new DenseMapper(m_settings.get()));
+  worker.m_tracker = trackerMaker(rgbImageSize, depthImageSize);
+  worker.m_trackingController.reset(new ITMLib::ITMTrackingController(worker.m_tracker.get(), m_settings.get()));
+  worker.m_trackingState.reset(new ITMLib::ITMTrackingState(depthImageSize, m_settings->GetMemoryType()));
+  worker.m_visualisationEngine.reset(ITMVisualisationEngineFactory::MakeVisualisationEngine<VoxelType,IndexType>(m_settings->deviceType));
+  worker.m_voxelRenderState.reset(ITMLib::ITMRenderStateFactory<IndexType>::CreateRenderState(
+    worker.m_trackingController->GetTrackedImageSize(rgbImageSize, depthImageSize),
+    m_scene->sceneParams,
+    m_settings->GetMemoryType()
+  ));
+  return worker;
+}
+
+template <typename VoxelType, typename IndexType>
+void ICPRefiningRelocaliser<VoxelType,IndexType>::refine_batched(const std::vector<Result>& initialResults, std::vector<ORUtils::SE3Pose>& initialPoses,
+                                                                  std::vector<Result>& refinedResults) const
+{
+  const int candidateCount = static_cast<int>(initialResults.size());
+
+  start_timer_nosync(m_timerCoarsePruning);
+
+  // Downsample the input colour and depth images into the coarse view.
+  const ORUChar4Image *colourIn = m_view->rgb;
+  const ORFloatImage *depthIn = m_view->depth;
+  for(size_t i = 0, size = m_downsampledDepthImages.size(); i < size; ++i)
+  {
+    m_lowLevelEngine->FilterSubsample(m_downsampledColourImages[i].get(), colourIn);
+    m_lowLevelEngine->FilterSubsampleWithHoles(m_downsampledDepthImages[i].get(), depthIn);
+    colourIn = m_downsampledColourImages[i].get();
+    depthIn = m_downsampledDepthImages[i].get();
+  }
+  m_lowLevelEngine->FilterSubsample(m_coarseView->rgb, colourIn);
+  m_lowLevelEngine->FilterSubsampleWithHoles(m_coarseView->depth, depthIn);
+
+  // Reset the workers' render states (see the comment in relocalise for why this is needed).
+  for(size_t i = 0, size = m_coarseWorkers.size(); i < size; ++i) m_coarseWorkers[i].m_voxelRenderState->Reset();
+  for(size_t i = 0, size = m_refinementWorkers.size(); i < size; ++i) m_refinementWorkers[i].m_voxelRenderState->Reset();
+
+  // Refine each candidate against the downsampled input, dividing the candidates between the coarse workers.
+  std::vector<ITMLib::ITMTrackingState::TrackingResult> coarseResults(candidateCount);
+  std::vector<ORUtils::SE3Pose> coarsePoses(candidateCount);
+  std::vector<float> coarseScores(candidateCount);
+
+  // Only refine the candidates concurrently if there is more than one of them. If we do, then we divide the OpenMP threads
+  // between the workers, and allow the parallel regions in the raycaster and tracker to run nested inside the one that
+  // drives the workers, so that each refinement can still use its share of the cores rather than a single thread.
+  const int coarseWorkerCount = std::min(static_cast<int>(m_coarseWorkers.size()), candidateCount);
+
+#ifdef WITH_OPENMP
+  const int oldMaxActiveLevels = omp_get_max_active_levels();
+  const int maxOpenMPThreads = omp_get_max_threads();
+  omp_set_max_active_levels(std::max(oldMaxActiveLevels, 2));
+
+  #pragma omp parallel for schedule(dynamic) if(coarseWorkerCount > 1) num_threads(std::max(coarseWorkerCount, 1))
+#endif
+  for(int i = 0; i < candidateCount; ++i)
+  {
+#ifdef WITH_OPENMP
+    RefinementWorker& worker = m_coarseWorkers[omp_get_thread_num()];
+
+    // Note that this only affects the thread that is running this worker.
+    if(coarseWorkerCount > 1) omp_set_num_threads(std::max(maxOpenMPThreads / coarseWorkerCount, 1));
+#else
+    RefinementWorker& worker = m_coarseWorkers[0];
+#endif
+
+    refine_pose(initialResults[i].pose, m_coarseView, worker);
+    coarseResults[i] = worker.m_trackingState->trackerResult;
+    coarsePoses[i].SetFrom(worker.m_trackingState->pose_d);
+    coarseScores[i] = worker.m_trackingState->trackerScore;
+  }
+
+  // Rank the candidates by the results of the coarse refinement, breaking ties within each group using the scores
+  // assigned by the coarse tracker (higher is better) and then the order of the inner relocaliser, and keep only
+  // the best few of them (restoring their original order afterwards).
+  const ITMLib::ITMTrackingState::TrackingResult rankedResults[] = {
+    ITMLib::ITMTrackingState::TRACKING_GOOD, ITMLib::ITMTrackingState::TRACKING_POOR, ITMLib::ITMTrackingState::TRACKING_FAILED
+  };
+
+  std::vector<int> survivors;
+  for(int j = 0; j < 3 && survivors.size() < m_maxCandidatesAfterPruning; ++j)
+  {
+    std::vector<std::pair<float,int> > group;
+    for(int i = 0; i < candidateCount; ++i)
+    {
+      if(coarseResults[i] == rankedResults[j]) group.push_back(std::make_pair(-coarseScores[i], i));
+    }
+
+    std::sort(group.begin(), group.end());
+    for(size_t k = 0, size = group.size(); k < size && survivors.size() < m_maxCandidatesAfterPruning; ++k)
+    {
+      survivors.push_back(group[k].second);
+    }
+  }
+  std::sort(survivors.begin(), survivors.end());
+
+  stop_timer_sync(m_timerCoarsePruning);
+
+  // Refine the surviving candidates at full resolution, starting from their coarsely-refined poses (if the coarse
+  // refinement succeeded) or their initial poses (otherwise).
+  const int survivorCount = static_cast<int>(survivors.size());
+  std::vector<Result> survivorResults(survivorCount);
+  std::vector<bool> survivorSucceeded(survivorCount);
+  const int refinementWorkerCount = std::min(static_cast<int>(m_refinementWorkers.size()), survivorCount);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for schedule(dynamic) if(refinementWorkerCount > 1) num_threads(std::max(refinementWorkerCount, 1))
+#endif
+  for(int k = 0; k < survivorCount; ++k)
+  {
+#ifdef WITH_OPENMP
+    RefinementWorker& worker = m_refinementWorkers[omp_get_thread_num()];
+    if(refinementWorkerCount > 1) omp_set_num_threads(std::max(maxOpenMPThreads / refinementWorkerCount, 1));
+#else
+    RefinementWorker& worker = m_refinementWorkers[0];
+#endif
+
+    const int i = survivors[k];
+    refine_pose(coarseResults[i] != ITMLib::ITMTrackingState::TRACKING_FAILED ? coarsePoses[i] : initialResults[i].pose, m_view, worker);
+
+    const ITMLib::ITMTrackingState::TrackingResult trackerResult = worker.m_trackingState->trackerResult;
+    survivorSucceeded[k] = trackerResult != ITMLib::ITMTrackingState::TRACKING_FAILED;
+    survivorResults[k].pose.SetFrom(worker.m_trackingState->pose_d);
+    survivorResults[k].quality = trackerResult == ITMLib::ITMTrackingState::TRACKING_GOOD ? RELOCALISATION_GOOD : RELOCALISATION_POOR;
+    survivorResults[k].score = worker.m_trackingState->trackerScore;
+  }
+
+#ifdef WITH_OPENMP
+  omp_set_max_active_levels(oldMaxActiveLevels);
+#endif
+
+  // Add the results of the successful refinements to the output. Scoring the results (if we're choosing the best one)
+  // uses the shared render state, so this is done serially.
+  float bestScore = static_cast<float>(INT_MAX);
+  for(int k = 0; k < survivorCount; ++k)
+  {
+    if(survivorSucceeded[k]) add_refined_result(survivors[k], initialResults[survivors[k]].pose, survivorResults[k], bestScore, initialPoses, refinedResults);
+  }
+}
+
+template <typename VoxelType, typename IndexType>
+void ICPRefiningRelocaliser<VoxelType,IndexType>::refine_pose(const ORUtils::SE3Pose& initialPose, const View_Ptr& view, RefinementWorker& worker) const
+{
+  // Set up the tracking state using the initial pose.
+  worker.m_trackingState->pose_d->SetFrom(&initialPose);
+
+  // Update the list of visible blocks.
+  const bool resetVisibleList = true;
+  worker.m_denseVoxelMapper->UpdateVisibleList(view.get(), worker.m_trackingState.get(), m_scene.get(), worker.m_voxelRenderState.get(), resetVisibleList);
+
+  // Raycast from the initial pose to prepare for tracking.
+  worker.m_trackingController->Prepare(worker.m_trackingState.get(), m_scene.get(), view.get(), worker.m_visualisationEngine.get(), worker.m_voxelRenderState.get());
+
+  // Run the tracker to refine the initial pose.
+  worker.m_trackingController->Track(worker.m_trackingState.get(), view.get());
+}
+
 template <typename VoxelType, typename IndexType>
 void ICPRefiningRelocaliser<VoxelType,IndexType>::save_poses(const Matrix4f& relocalisedPose, const Matrix4f& refinedPose) const
 {
@@ -476,7 +719,7 @@ float ICPRefiningRelocaliser<VoxelType,IndexType>::score_pose(const ORUtils::SE3
   cv::Mat cvRealDepth(m_view->depth->noDims.y, m_view->depth->noDims.x, CV_32FC1, m_view->depth->GetData(MEMORYDEVICE_CPU));
 
   // Render a synthetic depth image of the scene from the suggested pose.
-  ORFloatImage_Ptr synthDepth(new ORFloatImage(m_view->depth->noDims, true, true));
+  ORFloatImage_Ptr synthDepth = orx::MemoryBlockFactory::instance().make_image<float>(m_view->depth->noDims, "relocaliser");
   DepthVisualisationUtil<VoxelType,IndexType>::generate_depth_from_voxels(
     synthDepth, m_scene, pose, m_view->calib.intrinsics_d, m_voxelRenderState,
     DepthVisualiser::DT_ORTHOGRAPHIC, m_visualisationEngine, m_depthVisualiser, m_settings
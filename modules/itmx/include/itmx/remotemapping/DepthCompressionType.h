@@ -6,6 +6,12 @@
 #ifndef H_ITMX_DEPTHCOMPRESSIONTYPE
 #define H_ITMX_DEPTHCOMPRESSIONTYPE
 
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/algorithm/string.hpp>
+
 namespace itmx {
 
 /**
@@ -20,8 +26,52 @@ enum DepthCompressionType
 
   /** The depth images will be compressed using lossless PNG compression (requires OpenCV). */
   DEPTH_COMPRESSION_PNG = 1,
+
+  /** The depth images will be compressed using lossless run-length variable-length (RVL) coding. */
+  DEPTH_COMPRESSION_RVL = 2,
+
+  /** The depth images will be compressed using lossless RVL coding of the differences between consecutive images. */
+  DEPTH_COMPRESSION_RVL_TEMPORAL = 3,
 };
 
+//#################### STREAM OPERATORS ####################
+
+inline std::ostream& operator<<(std::ostream& os, DepthCompressionType rhs)
+{
+  switch(rhs)
+  {
+    case DEPTH_COMPRESSION_NONE:          os << "none"; break;
+    case DEPTH_COMPRESSION_PNG:           os << "png"; break;
+    case DEPTH_COMPRESSION_RVL:           os << "rvl"; break;
+    case DEPTH_COMPRESSION_RVL_TEMPORAL:  os << "rvltemporal"; break;
+    default:
+    {
+      // This should never happen.
+      throw std::runtime_error("Error: Unknown depth compression type");
+    }
+  }
+
+  return os;
+}
+
+inline std::istream& operator>>(std::istream& is, DepthCompressionType& rhs)
+{
+  std::string temp;
+  is >> temp;
+  if(!is) return is;
+
+  boost::trim(temp);
+  boost::to_lower(temp);
+
+  if(temp == "none") rhs = DEPTH_COMPRESSION_NONE;
+  else if(temp == "png") rhs = DEPTH_COMPRESSION_PNG;
+  else if(temp == "rvl") rhs = DEPTH_COMPRESSION_RVL;
+  else if(temp == "rvltemporal") rhs = DEPTH_COMPRESSION_RVL_TEMPORAL;
+  else throw std::runtime_error("Error: Unknown depth compression type '" + temp + "'");
+
+  return is;
+}
+
 }
 
 #endif
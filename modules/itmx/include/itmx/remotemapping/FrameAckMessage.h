@@ -0,0 +1,25 @@
+/**
+ * itmx: FrameAckMessage.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_FRAMEACKMESSAGE
+#define H_ITMX_FRAMEACKMESSAGE
+
+#include <boost/cstdint.hpp>
+
+#include <tvgutil/net/SimpleMessage.h>
+
+namespace itmx {
+
+//#################### TYPES ####################
+
+/**
+ * \brief An instance of this type represents a cumulative acknowledgement from a mapping server, containing the sequence
+ *        number of the most recent frame it has received (and thereby acknowledging all of the frames that preceded it).
+ */
+typedef tvgutil::SimpleMessage<uint32_t> FrameAckMessage;
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * itmx: FrameSequenceMessage.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_FRAMESEQUENCEMESSAGE
+#define H_ITMX_FRAMESEQUENCEMESSAGE
+
+#include <boost/cstdint.hpp>
+
+#include "MappingMessage.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class represents a message that precedes a compressed RGB-D frame sent as part of a window of unacknowledged frames.
+ */
+class FrameSequenceMessage : public MappingMessage
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The byte segment within the message data that corresponds to the flag indicating whether or not the client wants the server to acknowledge the frame. */
+  Segment m_ackRequestedSegment;
+
+  /** The byte segment within the message data that corresponds to the sequence number of the frame. */
+  Segment m_sequenceNumberSegment;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a frame sequence message.
+   */
+  FrameSequenceMessage();
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Extracts from the message whether or not the client wants the server to acknowledge the frame.
+   *
+   * \return  true, if the client wants the server to acknowledge the frame, or false otherwise.
+   */
+  bool extract_ack_requested() const;
+
+  /**
+   * \brief Extracts the sequence number of the frame from the message.
+   *
+   * \return  The sequence number of the frame.
+   */
+  uint32_t extract_sequence_number() const;
+
+  /**
+   * \brief Sets whether or not the client wants the server to acknowledge the frame.
+   *
+   * \param ackRequested  Whether or not the client wants the server to acknowledge the frame.
+   */
+  void set_ack_requested(bool ackRequested);
+
+  /**
+   * \brief Sets the sequence number of the frame.
+   *
+   * \param sequenceNumber  The sequence number of the frame.
+   */
+  void set_sequence_number(uint32_t sequenceNumber);
+};
+
+}
+
+#endif
@@ -30,6 +30,9 @@ enum InteractionType
 
   /** An interaction in which the client sends a new rendering request to the server. */
   IT_UPDATERENDERINGREQUEST = 3,
+
+  /** An interaction in which the client sends a single sequence-numbered RGB-D frame to the server without waiting for it to be acknowledged. */
+  IT_SENDWINDOWEDFRAME = 4,
 };
 
 //#################### TYPES ####################
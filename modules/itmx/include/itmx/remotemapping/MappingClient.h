@@ -7,7 +7,7 @@
 #define H_ITMX_MAPPINGCLIENT
 
 #include <tvgutil/boost/WrappedAsio.h>
-#include <tvgutil/containers/PooledQueue.h>
+#include <tvgutil/containers/LockFreePooledQueue.h>
 
 #include "RGBDCalibrationMessage.h"
 #include "RGBDFrameCompressor.h"
@@ -22,7 +22,7 @@ class MappingClient
 {
   //#################### TYPEDEFS ####################
 public:
-  typedef tvgutil::PooledQueue<RGBDFrameMessage_Ptr> RGBDFrameMessageQueue;
+  typedef tvgutil::LockFreePooledQueue<RGBDFrameMessage_Ptr> RGBDFrameMessageQueue;
 
   //#################### PRIVATE VARIABLES ####################
 private:
@@ -32,15 +32,30 @@ private:
   /** A queue containing the RGB-D frame messages to be sent to the server. */
   RGBDFrameMessageQueue m_frameMessageQueue;
 
+  /** The maximum number of frames that can be sent to the server without having been acknowledged (1 means stop-and-wait). */
+  uint32_t m_frameWindowSize;
+
   /** A mutex used to synchronise interactions with the server to avoid overlaps. */
   mutable boost::mutex m_interactionMutex;
 
+  /** The maximum number of frame messages that the frame message queue's pool can grow to contain if its pool empty strategy is PES_GROW (0 means the queue's default). */
+  size_t m_maxFramePoolSize;
+
   /** The image in which remote scene renderings retrieved from the server are stored. */
   mutable ORUChar4Image_Ptr m_remoteImage;
 
+  /** The sequence number to assign to the next frame sent to the server in windowed mode. */
+  uint32_t m_nextSequenceNumber;
+
+  /** The number of acknowledgements that have been requested from the server in windowed mode, but not yet read. */
+  mutable uint32_t m_pendingAckCount;
+
   /** The TCP stream used as a wrapper around the connection to the server. */
   mutable boost::asio::ip::tcp::iostream m_stream;
 
+  /** The number of frames that have been sent to the server in windowed mode, but not yet acknowledged. */
+  mutable uint32_t m_unackedFrameCount;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -49,8 +64,14 @@ public:
    * \param host              The mapping host to which to connect.
    * \param port              The port on the mapping host to which to connect.
    * \param poolEmptyStrategy A strategy specifying what should happen when a push is attempted while the frame message queue's pool is empty.
+   * \param frameWindowSize   The maximum number of frames that can be sent to the server without having been acknowledged (1 means stop-and-wait).
+   * \param maxFramePoolSize  The maximum number of frame messages that the frame message queue's pool can grow to contain if the pool empty strategy
+   *                          is PES_GROW (0 means twice its initial size). Once the pool has reached this size, pushes wait for a frame to be sent.
+   * \throws std::runtime_error If the client cannot connect to the server, or the frame window size is zero.
    */
-  explicit MappingClient(const std::string& host = "localhost", const std::string& port = "7851", tvgutil::pooled_queue::PoolEmptyStrategy poolEmptyStrategy = tvgutil::pooled_queue::PES_DISCARD);
+  explicit MappingClient(const std::string& host = "localhost", const std::string& port = "7851",
+                         tvgutil::pooled_queue::PoolEmptyStrategy poolEmptyStrategy = tvgutil::pooled_queue::PES_DISCARD,
+                         uint32_t frameWindowSize = 1, size_t maxFramePoolSize = 0);
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -84,6 +105,23 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Reads all of the acknowledgements that have been requested from the server in windowed mode, but not yet read.
+   *
+   * This must be called (with the interaction mutex held) before starting any other type of interaction with the server,
+   * since the server will have written the acknowledgements onto the stream before its response to that interaction.
+   *
+   * \return true, if the acknowledgements were successfully read, or false otherwise.
+   */
+  bool drain_frame_acks() const;
+
+  /**
+   * \brief Reads the next of the acknowledgements that have been requested from the server in windowed mode.
+   *
+   * \return true, if the acknowledgement was successfully read, or false otherwise.
+   */
+  bool read_frame_ack() const;
+
   /**
    * \brief Sends frame messages from the message queue across to the server.
    */
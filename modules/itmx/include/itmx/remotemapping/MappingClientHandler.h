@@ -8,7 +8,7 @@
 
 #include <ITMLib/Objects/Camera/ITMRGBDCalib.h>
 
-#include <tvgutil/containers/PooledQueue.h>
+#include <tvgutil/containers/LockFreePooledQueue.h>
 #include <tvgutil/misc/ExclusiveHandle.h>
 #include <tvgutil/net/ClientHandler.h>
 
@@ -24,7 +24,9 @@ class MappingClientHandler : public tvgutil::ClientHandler
 {
   //#################### TYPEDEFS ####################
 private:
-  typedef tvgutil::PooledQueue<RGBDFrameMessage_Ptr> RGBDFrameMessageQueue;
+  typedef boost::shared_ptr<CompressedRGBDFrameMessage> CompressedRGBDFrameMessage_Ptr;
+  typedef tvgutil::LockFreePooledQueue<CompressedRGBDFrameMessage_Ptr> CompressedRGBDFrameMessageQueue;
+  typedef tvgutil::LockFreePooledQueue<RGBDFrameMessage_Ptr> RGBDFrameMessageQueue;
   typedef boost::shared_ptr<RGBDFrameMessageQueue> RGBDFrameMessageQueue_Ptr;
 
   //#################### PRIVATE VARIABLES ####################
@@ -32,12 +34,30 @@ private:
   /** The calibration parameters of the camera associated with the client. */
   ITMLib::ITMRGBDCalib m_calib;
 
-  /** A dummy frame message to consume messages that cannot be pushed onto the queue. */
+  /** A queue containing the compressed RGB-D frame messages received from the client in windowed mode that are waiting to be uncompressed. */
+  CompressedRGBDFrameMessageQueue m_compressedFrameMessageQueue;
+
+  /** A frame message into which the decompression thread uncompresses each frame before pushing it onto the frame message queue. */
+  RGBDFrameMessage_Ptr m_decompressedFrameMessage;
+
+  /** Whether or not the decompression thread has failed to uncompress a frame (in which case the connection to the client should be dropped). */
+  boost::atomic<bool> m_decompressionFailed;
+
+  /** The thread that uncompresses the frame messages received from the client in windowed mode (if it has been started). */
+  boost::shared_ptr<boost::thread> m_decompressionThread;
+
+  /** A frame message into which to uncompress frames received in non-windowed mode (swapped into the queue if there is space, and otherwise discarded). */
   RGBDFrameMessage_Ptr m_dummyFrameMessage;
 
+  /** The sequence number that the next frame received from the client in windowed mode should have. */
+  uint32_t m_expectedSequenceNumber;
+
   /** The frame compressor for the client. */
   RGBDFrameCompressor_Ptr m_frameCompressor;
 
+  /** A separate frame compressor used by the decompression thread (the compressors have internal state, so cannot be shared between threads). */
+  RGBDFrameCompressor_Ptr m_frameDecompressor;
+
   /** A place in which to store compressed RGB-D frame messages. */
   boost::shared_ptr<CompressedRGBDFrameMessage> m_frameMessage;
 
@@ -176,6 +196,27 @@ public:
    * \param sceneID The scene ID that is associated with the client.
    */
   void set_scene_id(const std::string& sceneID);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Receives a sequence-numbered frame from the client in windowed mode, and passes it on to the decompression thread.
+   */
+  void receive_windowed_frame();
+
+  /**
+   * \brief Uncompresses the frame messages received from the client in windowed mode, and pushes them onto the frame message queue.
+   *
+   * This runs on the decompression thread, and terminates when it encounters a null message on the compressed frame message queue.
+   * If a frame cannot be uncompressed (e.g. because it is a temporal delta that does not follow on from the previous frame), the
+   * failure is recorded so that the connection to the client can be dropped, and any further frames are discarded.
+   */
+  void run_decompressor();
+
+  /**
+   * \brief Stops the decompression thread (if it is running), after letting it uncompress any frames that are still waiting.
+   */
+  void stop_decompressor();
 };
 
 }
@@ -0,0 +1,110 @@
+/**
+ * itmx: RVLDepthCodec.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_RVLDEPTHCODEC
+#define H_ITMX_RVLDEPTHCODEC
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <orx/base/ORImagePtrTypes.h>
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to losslessly compress and uncompress depth images using run-length variable-length (RVL) coding.
+ *
+ * RVL (Wilson, "Fast Lossless Depth Image Compression", ISS 2017) alternates between run lengths of zero and non-zero pixels, and codes
+ * the difference between each non-zero pixel and the previous one in zig-zag form using variable-length 3-bit + continuation-bit nibbles.
+ * This is much cheaper than PNG, and typically compresses similarly well on depth data.
+ *
+ * If temporal deltas are enabled, each image (other than the first one, or the first one after a change of size) is coded as the per-pixel
+ * difference from the previous image, which turns the static parts of the scene into long runs of zeros. The codec keeps track of the most
+ * recently compressed and uncompressed images separately, so a single codec can be used to compress one stream and uncompress another,
+ * but each stream must be uncompressed in the same order in which it was compressed, without skipping any images.
+ *
+ * The compressed representation consists of three 32-bit integers (a flag indicating whether or not the image is a temporal delta, and the
+ * width and height of the image), followed by the RVL nibbles packed into 32-bit words.
+ */
+class RVLDepthCodec
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The size of the most recently compressed image (or (0,0) if no image has been compressed yet). */
+  Vector2i m_lastCompressedSize;
+
+  /** The pixels of the most recently compressed image (only maintained if temporal deltas are enabled). */
+  std::vector<uint16_t> m_lastCompressedValues;
+
+  /** The size of the most recently uncompressed image (or (0,0) if no image has been uncompressed yet). */
+  Vector2i m_lastUncompressedSize;
+
+  /** The pixels of the most recently uncompressed image (only maintained if temporal deltas are enabled). */
+  std::vector<uint16_t> m_lastUncompressedValues;
+
+  /** A buffer used to store the values to be coded or the values that have just been decoded. */
+  std::vector<uint16_t> m_residuals;
+
+  /** Whether or not to code images as differences from the previous image where possible. */
+  bool m_useTemporalDeltas;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an RVL depth codec.
+   *
+   * \param useTemporalDeltas Whether or not to code images as differences from the previous image where possible.
+   */
+  explicit RVLDepthCodec(bool useTemporalDeltas);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Compresses a depth image.
+   *
+   * \param depthImage  The depth image to compress.
+   * \param bytes       A vector into which to write the compressed representation of the image.
+   */
+  void compress(const ORShortImage *depthImage, std::vector<uint8_t>& bytes);
+
+  /**
+   * \brief Uncompresses a depth image.
+   *
+   * \param bytes       The compressed representation of the image.
+   * \param depthImage  The image into which to write the uncompressed depths (this will be resized as necessary).
+   *
+   * \throws std::runtime_error If the compressed representation is malformed, or is a temporal delta that does not follow on
+   *                            from the most recently uncompressed image.
+   */
+  void uncompress(const std::vector<uint8_t>& bytes, ORShortImage *depthImage);
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Decodes the specified number of values from an RVL-coded array of 32-bit words.
+   *
+   * \param words     The RVL-coded words.
+   * \param wordCount The number of RVL-coded words.
+   * \param values    The array into which to write the decoded values.
+   * \param count     The number of values to decode.
+   *
+   * \throws std::runtime_error If the words run out before the specified number of values have been decoded.
+   */
+  static void decode_rvl(const uint32_t *words, size_t wordCount, uint16_t *values, size_t count);
+
+  /**
+   * \brief Appends the RVL coding of the specified values to a vector of bytes.
+   *
+   * \param values  The values to code.
+   * \param count   The number of values to code.
+   * \param bytes   The vector of bytes to which to append the coded values.
+   */
+  static void encode_rvl(const uint16_t *values, size_t count, std::vector<uint8_t>& bytes);
+};
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * itmx: PackedRGBDSequenceTracker.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_PACKEDRGBDSEQUENCETRACKER
+#define H_ITMX_PACKEDRGBDSEQUENCETRACKER
+
+#include <ITMLib/Trackers/Interface/ITMTracker.h>
+
+#include "../persistence/PackedRGBDSequenceReader.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to yield the camera poses stored in a packed RGB-D sequence.
+ */
+class PackedRGBDSequenceTracker : public ITMLib::ITMTracker
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The index of the next frame whose pose is to be yielded. */
+  size_t m_nextFrameIdx;
+
+  /** The reader used to read the poses from the sequence. */
+  PackedRGBDSequenceReader_CPtr m_reader;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a packed RGB-D sequence tracker.
+   *
+   * \param filename            The path to the packed RGB-D sequence.
+   * \param initialFrameNumber  The number of the initial frame that we want to use.
+   *
+   * \throws std::runtime_error If the sequence cannot be read.
+   */
+  PackedRGBDSequenceTracker(const std::string& filename, size_t initialFrameNumber);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual bool requiresColourRendering() const;
+
+  /** Override */
+  virtual bool requiresDepthReliability() const;
+
+  /** Override */
+  virtual bool requiresPointCloudRendering() const;
+
+  /** Override */
+  virtual void TrackCamera(ITMLib::ITMTrackingState *trackingState, const ITMLib::ITMView *view);
+};
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * itmx: PackedRGBDSequenceImageSourceEngine.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "imagesources/PackedRGBDSequenceImageSourceEngine.h"
+using namespace ITMLib;
+
+#include <ITMLib/Objects/Camera/ITMCalibIO.h>
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+PackedRGBDSequenceImageSourceEngine::PackedRGBDSequenceImageSourceEngine(const std::string& filename, const std::string& calibrationFilename, size_t initialFrameNumber)
+: m_nextFrameIdx(initialFrameNumber), m_reader(new PackedRGBDSequenceReader(filename))
+{
+  // Use the calibration stored in the sequence unless the user has explicitly specified a calibration file.
+  m_calib = m_reader->get_calib();
+  if(calibrationFilename != "" && !readRGBDCalib(calibrationFilename.c_str(), m_calib))
+  {
+    throw std::runtime_error("Error: Could not read calibration file: " + calibrationFilename);
+  }
+
+  m_frameMsg = RGBDFrameMessage::make(m_reader->get_rgb_image_size(), m_reader->get_depth_image_size());
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+ITMRGBDCalib PackedRGBDSequenceImageSourceEngine::getCalib() const
+{
+  return m_calib;
+}
+
+Vector2i PackedRGBDSequenceImageSourceEngine::getDepthImageSize() const
+{
+  return m_reader->get_depth_image_size();
+}
+
+void PackedRGBDSequenceImageSourceEngine::getImages(ORUChar4Image *rgb, ORShortImage *rawDepth)
+{
+  m_reader->read_frame(m_nextFrameIdx++, *m_frameMsg);
+  m_frameMsg->extract_rgb_image(rgb);
+  m_frameMsg->extract_depth_image(rawDepth);
+}
+
+Vector2i PackedRGBDSequenceImageSourceEngine::getRGBImageSize() const
+{
+  return m_reader->get_rgb_image_size();
+}
+
+bool PackedRGBDSequenceImageSourceEngine::hasMoreImages() const
+{
+  return m_nextFrameIdx < m_reader->get_frame_count();
+}
+
+}
@@ -0,0 +1,234 @@
+/**
+ * itmx: PackedRGBDSequenceReader.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "persistence/PackedRGBDSequenceReader.h"
+using namespace boost::interprocess;
+using namespace ITMLib;
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/lexical_cast.hpp>
+
+#include "persistence/PackedRGBDSequenceWriter.h"
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+PackedRGBDSequenceReader::PackedRGBDSequenceReader(const std::string& filename)
+: m_filename(filename)
+{
+  try
+  {
+    m_mapping = file_mapping(filename.c_str(), read_only);
+    m_region = mapped_region(m_mapping, read_only);
+  }
+  catch(interprocess_exception&)
+  {
+    throw std::runtime_error("Error: Could not map packed RGB-D sequence: " + filename);
+  }
+
+  const char *base = static_cast<const char*>(m_region.get_address());
+  const uint64_t fileSize = m_region.get_size();
+
+  // Read and check the header.
+  const size_t magicSize = PackedRGBDSequenceWriter::MAGIC_SIZE;
+  const size_t headerSize = magicSize + 2 * sizeof(uint32_t);
+  if(fileSize < headerSize || memcmp(base, PackedRGBDSequenceWriter::HEADER_MAGIC, magicSize) != 0)
+  {
+    throw std::runtime_error("Error: Not a packed RGB-D sequence: " + filename);
+  }
+
+  uint32_t version, calibSize;
+  memcpy(&version, base + magicSize, sizeof(uint32_t));
+  memcpy(&calibSize, base + magicSize + sizeof(uint32_t), sizeof(uint32_t));
+
+  if(version != PackedRGBDSequenceWriter::VERSION)
+  {
+    throw std::runtime_error("Error: Unsupported packed RGB-D sequence version (" + boost::lexical_cast<std::string>(version) + "): " + filename);
+  }
+
+  // Read the calibration message, and set up a compressor that can uncompress the frames.
+  RGBDCalibrationMessage calibMsg;
+  if(calibSize != calibMsg.get_size() || fileSize - headerSize < calibSize)
+  {
+    throw std::runtime_error("Error: Corrupt calibration in packed RGB-D sequence: " + filename);
+  }
+
+  memcpy(calibMsg.get_data_ptr(), base + headerSize, calibSize);
+  m_calib = calibMsg.extract_calib();
+  m_frameCompressor.reset(new RGBDFrameCompressor(
+    get_rgb_image_size(), get_depth_image_size(), calibMsg.extract_rgb_compression_type(), calibMsg.extract_depth_compression_type()
+  ));
+
+  m_compressedFrameMsg.reset(new CompressedRGBDFrameMessage(m_compressedHeaderMsg));
+
+  // Read the frame index, or rebuild it if the sequence was not closed properly.
+  const uint64_t dataOffset = headerSize + calibSize;
+  if(!read_index(dataOffset)) scan_records(dataOffset);
+}
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+bool PackedRGBDSequenceReader::is_packed_sequence(const std::string& filename)
+{
+  char magic[PackedRGBDSequenceWriter::MAGIC_SIZE];
+  std::ifstream fs(filename.c_str(), std::ios::binary);
+  return fs.read(magic, sizeof(magic)) && memcmp(magic, PackedRGBDSequenceWriter::HEADER_MAGIC, sizeof(magic)) == 0;
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+const ITMRGBDCalib& PackedRGBDSequenceReader::get_calib() const
+{
+  return m_calib;
+}
+
+Vector2i PackedRGBDSequenceReader::get_depth_image_size() const
+{
+  return m_calib.intrinsics_d.imgSize;
+}
+
+size_t PackedRGBDSequenceReader::get_frame_count() const
+{
+  return m_frameRecords.size();
+}
+
+ORUtils::SE3Pose PackedRGBDSequenceReader::get_pose(size_t frameIdx) const
+{
+  check_frame_index(frameIdx);
+  ORUtils::SE3Pose pose;
+  pose.SetM(m_poses[frameIdx]);
+  return pose;
+}
+
+Vector2i PackedRGBDSequenceReader::get_rgb_image_size() const
+{
+  return m_calib.intrinsics_rgb.imgSize;
+}
+
+void PackedRGBDSequenceReader::read_frame(size_t frameIdx, RGBDFrameMessage& frameMsg)
+{
+  check_frame_index(frameIdx);
+
+  if(!unpack_record(frameIdx))
+  {
+    throw std::runtime_error("Error: Frame " + boost::lexical_cast<std::string>(frameIdx) + " of packed RGB-D sequence " + m_filename + " is corrupt");
+  }
+
+  m_frameCompressor->uncompress_rgbd_frame(*m_compressedFrameMsg, frameMsg);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void PackedRGBDSequenceReader::check_frame_index(size_t frameIdx) const
+{
+  if(frameIdx >= m_frameRecords.size())
+  {
+    throw std::out_of_range("Error: Frame index " + boost::lexical_cast<std::string>(frameIdx) + " is out of range for packed RGB-D sequence " + m_filename);
+  }
+}
+
+bool PackedRGBDSequenceReader::read_index(uint64_t dataOffset)
+{
+  const char *base = static_cast<const char*>(m_region.get_address());
+  const uint64_t fileSize = m_region.get_size();
+
+  // Check the trailer.
+  const size_t trailerSize = PackedRGBDSequenceWriter::TRAILER_SIZE;
+  if(fileSize - dataOffset < trailerSize) return false;
+
+  const char *trailer = base + fileSize - trailerSize;
+  if(memcmp(trailer + 2 * sizeof(uint64_t), PackedRGBDSequenceWriter::TRAILER_MAGIC, PackedRGBDSequenceWriter::MAGIC_SIZE) != 0) return false;
+
+  uint64_t indexOffset, frameCount;
+  memcpy(&indexOffset, trailer, sizeof(uint64_t));
+  memcpy(&frameCount, trailer + sizeof(uint64_t), sizeof(uint64_t));
+
+  const size_t entrySize = PackedRGBDSequenceWriter::INDEX_ENTRY_SIZE;
+  const uint64_t indexEnd = fileSize - trailerSize;
+  if(indexOffset < dataOffset || indexOffset > indexEnd || (indexEnd - indexOffset) / entrySize != frameCount) return false;
+
+  // Read the index entries, checking that every frame record lies within the data section of the file.
+  std::vector<std::pair<uint64_t,uint64_t> > frameRecords(frameCount);
+  std::vector<Matrix4f> poses(frameCount);
+
+  const char *entry = base + indexOffset;
+  for(uint64_t i = 0; i < frameCount; ++i, entry += entrySize)
+  {
+    uint64_t offset, recordSize;
+    memcpy(&offset, entry, sizeof(uint64_t));
+    memcpy(poses[i].m, entry + sizeof(uint64_t), 16 * sizeof(float));
+
+    if(offset < dataOffset || indexOffset - offset < sizeof(uint64_t)) return false;
+    memcpy(&recordSize, base + offset, sizeof(uint64_t));
+    if(recordSize > indexOffset - offset - sizeof(uint64_t)) return false;
+
+    frameRecords[i] = std::make_pair(offset + sizeof(uint64_t), recordSize);
+  }
+
+  m_frameRecords.swap(frameRecords);
+  m_poses.swap(poses);
+  return true;
+}
+
+void PackedRGBDSequenceReader::scan_records(uint64_t dataOffset)
+{
+  const char *base = static_cast<const char*>(m_region.get_address());
+  const uint64_t fileSize = m_region.get_size();
+
+  // Walk the chain of frame records, stopping at the first one that does not fit in the file (this will be a frame
+  // that was only partially written when the recording was interrupted).
+  uint64_t offset = dataOffset;
+  while(fileSize - offset >= sizeof(uint64_t))
+  {
+    uint64_t recordSize;
+    memcpy(&recordSize, base + offset, sizeof(uint64_t));
+    offset += sizeof(uint64_t);
+    if(recordSize > fileSize - offset) break;
+
+    m_frameRecords.push_back(std::make_pair(offset, recordSize));
+    offset += recordSize;
+  }
+
+  // Recover the poses of the frames from their records, discarding any frames from the first inconsistent record onwards.
+  m_poses.reserve(m_frameRecords.size());
+  for(size_t i = 0, size = m_frameRecords.size(); i < size; ++i)
+  {
+    if(!unpack_record(i))
+    {
+      m_frameRecords.resize(i);
+      break;
+    }
+
+    m_poses.push_back(m_compressedFrameMsg->extract_pose().GetM());
+  }
+}
+
+bool PackedRGBDSequenceReader::unpack_record(size_t frameIdx)
+{
+  const char *record = static_cast<const char*>(m_region.get_address()) + m_frameRecords[frameIdx].first;
+  const uint64_t recordSize = m_frameRecords[frameIdx].second;
+
+  // Copy the compressed frame header out of the record.
+  const size_t headerSize = m_compressedHeaderMsg.get_size();
+  if(recordSize < headerSize) return false;
+  memcpy(m_compressedHeaderMsg.get_data_ptr(), record, headerSize);
+
+  // Check that the image sizes in the header are plausible before resizing the frame message to accommodate them.
+  const uint64_t imageBytes = static_cast<uint64_t>(m_compressedHeaderMsg.extract_depth_image_byte_size()) + m_compressedHeaderMsg.extract_rgb_image_byte_size();
+  if(imageBytes > recordSize - headerSize) return false;
+
+  m_compressedFrameMsg->set_compressed_image_sizes(m_compressedHeaderMsg);
+  if(headerSize + m_compressedFrameMsg->get_size() != recordSize) return false;
+
+  // Copy the compressed frame itself out of the record.
+  memcpy(m_compressedFrameMsg->get_data_ptr(), record + headerSize, m_compressedFrameMsg->get_size());
+  return true;
+}
+
+}
@@ -0,0 +1,105 @@
+/**
+ * itmx: PackedRGBDSequenceRecorder.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "persistence/PackedRGBDSequenceRecorder.h"
+using namespace ITMLib;
+
+#include <iostream>
+
+#include <boost/bind.hpp>
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+PackedRGBDSequenceRecorder::PackedRGBDSequenceRecorder(const std::string& filename, const ITMRGBDCalib& calib, const Vector2i& rgbImageSize, const Vector2i& depthImageSize,
+                                                       size_t capacity, RGBCompressionType rgbCompressionType, DepthCompressionType depthCompressionType)
+: m_frameIndex(0),
+  m_frameMessageQueue(tvgutil::pooled_queue::PES_WAIT),
+  m_writer(new PackedRGBDSequenceWriter(filename, calib, rgbImageSize, depthImageSize, rgbCompressionType, depthCompressionType))
+{
+  m_frameMessageQueue.initialise(capacity, boost::bind(&RGBDFrameMessage::make, rgbImageSize, depthImageSize));
+  m_writerThread.reset(new boost::thread(&PackedRGBDSequenceRecorder::run_writer, this));
+}
+
+//#################### DESTRUCTOR ####################
+
+PackedRGBDSequenceRecorder::~PackedRGBDSequenceRecorder()
+{
+  try
+  {
+    stop();
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << e.what() << '\n';
+  }
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void PackedRGBDSequenceRecorder::record_frame(const ORUChar4Image_CPtr& rgbImage, const ORShortImage_CPtr& depthImage, const ORUtils::SE3Pose& pose)
+{
+  if(!m_writerThread) throw std::runtime_error("Error: Cannot record a frame using a packed RGB-D sequence recorder that has been stopped");
+
+  // Copy the frame into a message from the pool (this blocks if the writer thread has fallen too far behind).
+  RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue.begin_push();
+  boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
+  if(elt)
+  {
+    RGBDFrameMessage& msg = **elt;
+    msg.set_frame_index(m_frameIndex++);
+    msg.set_pose(pose);
+    msg.set_rgb_image(rgbImage);
+    msg.set_depth_image(depthImage);
+  }
+}
+
+void PackedRGBDSequenceRecorder::stop()
+{
+  if(!m_writerThread) return;
+
+  // Push a null message onto the queue to tell the writer thread to terminate once it has written any frames
+  // that are already waiting, and then wait for it to do so.
+  {
+    RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue.begin_push();
+    boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
+    if(elt) elt->reset();
+  }
+
+  m_writerThread->join();
+  m_writerThread.reset();
+
+  // Finish writing the sequence.
+  m_writer->close();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void PackedRGBDSequenceRecorder::run_writer()
+{
+  while(true)
+  {
+    // Wait for a frame message to become available. A null message is the signal to terminate.
+    RGBDFrameMessage_Ptr msg = m_frameMessageQueue.peek();
+    if(!msg) break;
+
+    // Compress the frame and append it to the sequence. If this fails (e.g. because the disk is full), we report the
+    // problem but keep draining the queue, so as to avoid deadlocking the thread that is recording the frames.
+    try
+    {
+      m_writer->write_frame(*msg);
+    }
+    catch(std::exception& e)
+    {
+      std::cerr << e.what() << '\n';
+    }
+
+    // Return the frame message to the pool so that it can be reused for a later frame.
+    m_frameMessageQueue.pop();
+  }
+}
+
+}
@@ -0,0 +1,117 @@
+/**
+ * itmx: PackedRGBDSequenceWriter.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "persistence/PackedRGBDSequenceWriter.h"
+using namespace ITMLib;
+
+#include <iostream>
+#include <stdexcept>
+
+namespace itmx {
+
+//#################### CONSTANTS ####################
+
+const char *PackedRGBDSequenceWriter::HEADER_MAGIC = "SPRGBDSQ";
+const char *PackedRGBDSequenceWriter::TRAILER_MAGIC = "SPRGBDIX";
+
+//#################### CONSTRUCTORS ####################
+
+PackedRGBDSequenceWriter::PackedRGBDSequenceWriter(const std::string& filename, const ITMRGBDCalib& calib, const Vector2i& rgbImageSize, const Vector2i& depthImageSize,
+                                                   RGBCompressionType rgbCompressionType, DepthCompressionType depthCompressionType)
+: m_filename(filename)
+{
+  if(depthCompressionType == DEPTH_COMPRESSION_RVL_TEMPORAL)
+  {
+    throw std::invalid_argument("Error: Packed RGB-D sequences cannot use temporal depth compression, since their frames must be readable independently");
+  }
+
+  m_frameCompressor.reset(new RGBDFrameCompressor(rgbImageSize, depthImageSize, rgbCompressionType, depthCompressionType));
+
+  m_fs.open(filename.c_str(), std::ios::binary);
+  if(!m_fs) throw std::runtime_error("Error: Could not open packed RGB-D sequence for writing: " + filename);
+
+  // Store the calibration and compression types in the same form in which they are sent to a mapping server. We make sure
+  // that the image sizes in the calibration match the actual image sizes, since the reader relies on them to size its images.
+  ITMRGBDCalib storedCalib = calib;
+  storedCalib.intrinsics_rgb.imgSize = rgbImageSize;
+  storedCalib.intrinsics_d.imgSize = depthImageSize;
+
+  RGBDCalibrationMessage calibMsg;
+  calibMsg.set_calib(storedCalib);
+  calibMsg.set_rgb_compression_type(rgbCompressionType);
+  calibMsg.set_depth_compression_type(depthCompressionType);
+
+  const uint32_t version = VERSION;
+  const uint32_t calibSize = static_cast<uint32_t>(calibMsg.get_size());
+  m_fs.write(HEADER_MAGIC, MAGIC_SIZE);
+  m_fs.write(reinterpret_cast<const char*>(&version), sizeof(uint32_t));
+  m_fs.write(reinterpret_cast<const char*>(&calibSize), sizeof(uint32_t));
+  m_fs.write(calibMsg.get_data_ptr(), calibSize);
+  if(!m_fs) throw std::runtime_error("Error: Could not write header of packed RGB-D sequence: " + filename);
+
+  m_compressedFrameMsg.reset(new CompressedRGBDFrameMessage(m_compressedHeaderMsg));
+}
+
+//#################### DESTRUCTOR ####################
+
+PackedRGBDSequenceWriter::~PackedRGBDSequenceWriter()
+{
+  // Unlike a half-written binary model, a sequence whose recording was cut short is still useful, so we close it here if need be.
+  try
+  {
+    close();
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << e.what() << '\n';
+  }
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void PackedRGBDSequenceWriter::close()
+{
+  if(!m_fs.is_open()) return;
+
+  // Write the frame index.
+  const uint64_t indexOffset = static_cast<uint64_t>(m_fs.tellp());
+  for(size_t i = 0, size = m_frames.size(); i < size; ++i)
+  {
+    m_fs.write(reinterpret_cast<const char*>(&m_frames[i].first), sizeof(uint64_t));
+    m_fs.write(reinterpret_cast<const char*>(m_frames[i].second.m), 16 * sizeof(float));
+  }
+
+  // Write the trailer.
+  const uint64_t frameCount = static_cast<uint64_t>(m_frames.size());
+  m_fs.write(reinterpret_cast<const char*>(&indexOffset), sizeof(uint64_t));
+  m_fs.write(reinterpret_cast<const char*>(&frameCount), sizeof(uint64_t));
+  m_fs.write(TRAILER_MAGIC, MAGIC_SIZE);
+
+  m_fs.close();
+  if(!m_fs) throw std::runtime_error("Error: Could not write packed RGB-D sequence: " + m_filename);
+}
+
+size_t PackedRGBDSequenceWriter::get_frame_count() const
+{
+  return m_frames.size();
+}
+
+void PackedRGBDSequenceWriter::write_frame(const RGBDFrameMessage& frameMsg)
+{
+  if(!m_fs.is_open()) throw std::runtime_error("Error: Cannot write a frame to a packed RGB-D sequence that has been closed: " + m_filename);
+
+  m_frameCompressor->compress_rgbd_frame(frameMsg, m_compressedHeaderMsg, *m_compressedFrameMsg);
+
+  const uint64_t offset = static_cast<uint64_t>(m_fs.tellp());
+  const uint64_t recordSize = static_cast<uint64_t>(m_compressedHeaderMsg.get_size() + m_compressedFrameMsg->get_size());
+  m_fs.write(reinterpret_cast<const char*>(&recordSize), sizeof(uint64_t));
+  m_fs.write(m_compressedHeaderMsg.get_data_ptr(), m_compressedHeaderMsg.get_size());
+  m_fs.write(m_compressedFrameMsg->get_data_ptr(), m_compressedFrameMsg->get_size());
+  if(!m_fs) throw std::runtime_error("Error: Could not write frame to packed RGB-D sequence: " + m_filename);
+
+  m_frames.push_back(std::make_pair(offset, frameMsg.extract_pose().GetM()));
+}
+
+}
@@ -0,0 +1,41 @@
+/**
+ * itmx: FrameSequenceMessage.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "remotemapping/FrameSequenceMessage.h"
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+FrameSequenceMessage::FrameSequenceMessage()
+{
+  m_sequenceNumberSegment = std::make_pair(0, sizeof(uint32_t));
+  m_ackRequestedSegment = std::make_pair(end_of(m_sequenceNumberSegment), sizeof(bool));
+  m_data.resize(end_of(m_ackRequestedSegment));
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+bool FrameSequenceMessage::extract_ack_requested() const
+{
+  return read_simple<bool>(m_ackRequestedSegment);
+}
+
+uint32_t FrameSequenceMessage::extract_sequence_number() const
+{
+  return read_simple<uint32_t>(m_sequenceNumberSegment);
+}
+
+void FrameSequenceMessage::set_ack_requested(bool ackRequested)
+{
+  write_simple(ackRequested, m_ackRequestedSegment);
+}
+
+void FrameSequenceMessage::set_sequence_number(uint32_t sequenceNumber)
+{
+  write_simple(sequenceNumber, m_sequenceNumberSegment);
+}
+
+}
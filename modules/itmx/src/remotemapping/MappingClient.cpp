@@ -5,6 +5,7 @@
 
 #include "remotemapping/MappingClient.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 #include <tvgutil/boost/WrappedAsio.h>
@@ -12,6 +13,8 @@
 using boost::asio::ip::tcp;
 using namespace tvgutil;
 
+#include "remotemapping/FrameAckMessage.h"
+#include "remotemapping/FrameSequenceMessage.h"
 #include "remotemapping/InteractionTypeMessage.h"
 #include "remotemapping/RenderingRequestMessage.h"
 
@@ -19,9 +22,16 @@ namespace itmx {
 
 //#################### CONSTRUCTORS ####################
 
-MappingClient::MappingClient(const std::string& host, const std::string& port, pooled_queue::PoolEmptyStrategy poolEmptyStrategy)
-: m_frameMessageQueue(poolEmptyStrategy), m_stream(host, port)
+MappingClient::MappingClient(const std::string& host, const std::string& port, pooled_queue::PoolEmptyStrategy poolEmptyStrategy, uint32_t frameWindowSize, size_t maxFramePoolSize)
+: m_frameMessageQueue(poolEmptyStrategy),
+  m_frameWindowSize(frameWindowSize),
+  m_maxFramePoolSize(maxFramePoolSize),
+  m_nextSequenceNumber(0),
+  m_pendingAckCount(0),
+  m_stream(host, port),
+  m_unackedFrameCount(0)
 {
+  if(frameWindowSize == 0) throw std::runtime_error("Error: The frame window size must be at least 1");
   if(!m_stream) throw std::runtime_error("Error: Could not connect to server");
 }
 
@@ -40,7 +50,7 @@ ORUChar4Image_CPtr MappingClient::get_remote_image() const
   boost::lock_guard<boost::mutex> lock(m_interactionMutex);
 
   // Ask the server whether it has ever rendered an RGB-D image for this client.
-  if(m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size()))
+  if(drain_frame_acks() && m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size()))
   {
     SimpleMessage<bool> flag;
     if(m_stream.read(flag.get_data_ptr(), flag.get_size()) && m_stream.write(ackMsg.get_data_ptr(), ackMsg.get_size()) && flag.extract_value())
@@ -101,7 +111,7 @@ void MappingClient::send_calibration_message(const RGBDCalibrationMessage& msg)
   const ITMLib::ITMRGBDCalib calib = msg.extract_calib();
   const Vector2i rgbImageSize = calib.intrinsics_rgb.imgSize;
   const Vector2i depthImageSize = calib.intrinsics_d.imgSize;
-  m_frameMessageQueue.initialise(capacity, boost::bind(&RGBDFrameMessage::make, rgbImageSize, depthImageSize));
+  m_frameMessageQueue.initialise(capacity, boost::bind(&RGBDFrameMessage::make, rgbImageSize, depthImageSize), m_maxFramePoolSize);
 
   // Set up the RGB-D frame compressor.
   m_frameCompressor.reset(new RGBDFrameCompressor(rgbImageSize, depthImageSize, msg.extract_rgb_compression_type(), msg.extract_depth_compression_type()));
@@ -122,9 +132,10 @@ void MappingClient::update_rendering_request(const Vector2i& imgSize, const ORUt
 
   boost::lock_guard<boost::mutex> lock(m_interactionMutex);
 
-  // First send the interaction type message, then send the rendering request message,
-  // then wait for an acknowledgement from the server. We chain all of these with &&
-  // so as to early out in case of failure.
+  // First read any outstanding frame acknowledgements, then send the interaction type message,
+  // then send the rendering request message, then wait for an acknowledgement from the server.
+  // We chain all of these with && so as to early out in case of failure.
+  drain_frame_acks() &&
   m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size()) &&
   m_stream.write(requestMsg.get_data_ptr(), requestMsg.get_size()) && 
   m_stream.read(ackMsg.get_data_ptr(), ackMsg.get_size());
@@ -132,12 +143,40 @@ void MappingClient::update_rendering_request(const Vector2i& imgSize, const ORUt
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+bool MappingClient::drain_frame_acks() const
+{
+  bool connectionOk = true;
+  while(connectionOk && m_pendingAckCount > 0)
+  {
+    connectionOk = read_frame_ack();
+  }
+  return connectionOk;
+}
+
+bool MappingClient::read_frame_ack() const
+{
+  FrameAckMessage frameAckMsg;
+  if(m_pendingAckCount == 0 || !m_stream.read(frameAckMsg.get_data_ptr(), frameAckMsg.get_size())) return false;
+
+  // The acknowledgement is cumulative, so every frame up to and including the acknowledged one has now been received.
+  // Note that the unsigned arithmetic here correctly handles wrap-around of the sequence numbers.
+  --m_pendingAckCount;
+  m_unackedFrameCount = m_nextSequenceNumber - (frameAckMsg.extract_value() + 1);
+  return true;
+}
+
 void MappingClient::run_message_sender()
 {
   AckMessage ackMsg;
   CompressedRGBDFrameHeaderMessage headerMsg;
   CompressedRGBDFrameMessage frameMsg(headerMsg);
-  InteractionTypeMessage interactionTypeMsg(IT_SENDFRAME);
+  FrameSequenceMessage sequenceMsg;
+  InteractionTypeMessage interactionTypeMsg(m_frameWindowSize > 1 ? IT_SENDWINDOWEDFRAME : IT_SENDFRAME);
+
+  // In windowed mode, we ask the server to acknowledge every ackInterval frames. Since the acknowledgements are cumulative,
+  // we never need more than a couple per window, and the fact that ackInterval <= m_frameWindowSize guarantees that a full
+  // window always contains at least one frame whose acknowledgement has been requested but not yet read.
+  const uint32_t ackInterval = std::max(m_frameWindowSize / 2, 1U);
 
   bool connectionOk = true;
 
@@ -154,14 +193,45 @@ void MappingClient::run_message_sender()
     {
       boost::lock_guard<boost::mutex> lock(m_interactionMutex);
 
-      // First send the interaction type message, then send the frame header message, then send
-      // the frame message itself, then wait for an acknowledgement from the server. We chain
-      // all of these with && so as to early out in case of failure.
-      connectionOk = connectionOk
-        && m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size())
-        && m_stream.write(headerMsg.get_data_ptr(), headerMsg.get_size())
-        && m_stream.write(frameMsg.get_data_ptr(), frameMsg.get_size())
-        && m_stream.read(ackMsg.get_data_ptr(), ackMsg.get_size());
+      if(m_frameWindowSize > 1)
+      {
+        // If the window is full, wait until the server has acknowledged enough frames to make space for this one.
+        while(connectionOk && m_unackedFrameCount >= m_frameWindowSize)
+        {
+          connectionOk = read_frame_ack();
+        }
+
+        const bool ackRequested = (m_nextSequenceNumber + 1) % ackInterval == 0;
+        sequenceMsg.set_sequence_number(m_nextSequenceNumber);
+        sequenceMsg.set_ack_requested(ackRequested);
+
+        // Send the interaction type message, then the sequence message, then the frame header message, then
+        // the frame message itself, but do not wait for an acknowledgement before moving on to the next frame.
+        connectionOk = connectionOk
+          && m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size())
+          && m_stream.write(sequenceMsg.get_data_ptr(), sequenceMsg.get_size())
+          && m_stream.write(headerMsg.get_data_ptr(), headerMsg.get_size())
+          && m_stream.write(frameMsg.get_data_ptr(), frameMsg.get_size())
+          && m_stream.flush();
+
+        if(connectionOk)
+        {
+          ++m_nextSequenceNumber;
+          ++m_unackedFrameCount;
+          if(ackRequested) ++m_pendingAckCount;
+        }
+      }
+      else
+      {
+        // First send the interaction type message, then send the frame header message, then send
+        // the frame message itself, then wait for an acknowledgement from the server. We chain
+        // all of these with && so as to early out in case of failure.
+        connectionOk = connectionOk
+          && m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size())
+          && m_stream.write(headerMsg.get_data_ptr(), headerMsg.get_size())
+          && m_stream.write(frameMsg.get_data_ptr(), frameMsg.get_size())
+          && m_stream.read(ackMsg.get_data_ptr(), ackMsg.get_size());
+      }
     }
 
     // Remove the frame message that we have just sent from the queue.
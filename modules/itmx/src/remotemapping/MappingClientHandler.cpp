@@ -5,6 +5,8 @@
 
 #include "remotemapping/MappingClientHandler.h"
 
+#include <boost/functional/factory.hpp>
+
 #include <tvgutil/net/AckMessage.h>
 using namespace tvgutil;
 
@@ -12,6 +14,8 @@ using namespace tvgutil;
 #include "ocv/OpenCVUtil.h"
 #endif
 
+#include "remotemapping/FrameAckMessage.h"
+#include "remotemapping/FrameSequenceMessage.h"
 #include "remotemapping/InteractionTypeMessage.h"
 #include "remotemapping/RenderingRequestMessage.h"
 #include "remotemapping/RGBDCalibrationMessage.h"
@@ -25,6 +29,9 @@ namespace itmx {
 MappingClientHandler::MappingClientHandler(int clientID, const boost::shared_ptr<boost::asio::ip::tcp::socket>& sock,
                                            const boost::shared_ptr<const boost::atomic<bool> >& shouldTerminate)
 : ClientHandler(clientID, sock, shouldTerminate),
+  m_compressedFrameMessageQueue(tvgutil::pooled_queue::PES_WAIT),
+  m_decompressionFailed(false),
+  m_expectedSequenceNumber(0),
   m_frameMessageQueue(new RGBDFrameMessageQueue(tvgutil::pooled_queue::PES_DISCARD)),
   m_imagesDirty(false),
   m_poseDirty(false)
@@ -152,29 +159,47 @@ void MappingClientHandler::run_iter()
             std::cout << "Message queue size (" << m_clientID << "): " << m_frameMessageQueue->size() << std::endl;
 #endif
 
-            RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue->begin_push();
-            boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
-            RGBDFrameMessage& msg = elt ? **elt : *m_dummyFrameMessage;
-            m_frameCompressor->uncompress_rgbd_frame(*m_frameMessage, msg);
-
-            m_connectionOk = write_message(AckMessage());
+            // Note that we uncompress the frame into the dummy frame message first, and only swap it into the queue if that succeeds,
+            // so that a frame that cannot be uncompressed never ends up on the queue.
+            try
+            {
+              m_frameCompressor->uncompress_rgbd_frame(*m_frameMessage, *m_dummyFrameMessage);
 
 #if DEBUGGING
-            std::cout << "Got message: " << msg.extract_frame_index() << std::endl;
-
-          #ifdef WITH_OPENCV
-            static ORUChar4Image_Ptr rgbImage(new ORUChar4Image(get_rgb_image_size(), true, false));
-            msg.extract_rgb_image(rgbImage.get());
-            cv::Mat3b cvRGB = OpenCVUtil::make_rgb_image(rgbImage->GetData(MEMORYDEVICE_CPU), rgbImage->noDims.x, rgbImage->noDims.y);
-            cv::imshow("RGB", cvRGB);
-            cv::waitKey(1);
-          #endif
+              const RGBDFrameMessage& msg = *m_dummyFrameMessage;
+              std::cout << "Got message: " << msg.extract_frame_index() << std::endl;
+
+            #ifdef WITH_OPENCV
+              static ORUChar4Image_Ptr rgbImage(new ORUChar4Image(get_rgb_image_size(), true, false));
+              msg.extract_rgb_image(rgbImage.get());
+              cv::Mat3b cvRGB = OpenCVUtil::make_rgb_image(rgbImage->GetData(MEMORYDEVICE_CPU), rgbImage->noDims.x, rgbImage->noDims.y);
+              cv::imshow("RGB", cvRGB);
+              cv::waitKey(1);
+            #endif
 #endif
+
+              RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue->begin_push();
+              boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
+              if(elt) std::swap(*elt, m_dummyFrameMessage);
+
+              m_connectionOk = write_message(AckMessage());
+            }
+            catch(std::exception& e)
+            {
+              // If the frame cannot be uncompressed, the client is sending frames we can't use, so drop the connection to it.
+              std::cerr << "Warning: Could not uncompress a frame from client " << m_clientID << ": " << e.what() << '\n';
+              m_connectionOk = false;
+            }
           }
         }
 
         break;
       }
+      case IT_SENDWINDOWEDFRAME:
+      {
+        receive_windowed_frame();
+        break;
+      }
       case IT_UPDATERENDERINGREQUEST:
       {
 #if DEBUGGING
@@ -202,8 +227,12 @@ void MappingClientHandler::run_iter()
 
 void MappingClientHandler::run_post()
 {
-  // Destroy the frame compressor prior to stopping the client handler (this cleanly deallocates CUDA memory and avoids a crash on exit).
+  // Stop the decompression thread before destroying the frame compressors that it might be using.
+  stop_decompressor();
+
+  // Destroy the frame compressors prior to stopping the client handler (this cleanly deallocates CUDA memory and avoids a crash on exit).
   m_frameCompressor.reset();
+  m_frameDecompressor.reset();
 }
 
 void MappingClientHandler::run_pre()
@@ -230,9 +259,18 @@ void MappingClientHandler::run_pre()
     // Set up the frame compressor.
     m_frameCompressor.reset(new RGBDFrameCompressor(rgbImageSize, depthImageSize, calibMsg.extract_rgb_compression_type(), calibMsg.extract_depth_compression_type()));
 
-    // Construct a dummy frame message to consume messages that cannot be pushed onto the queue.
+    // Construct a frame message into which to uncompress frames received in non-windowed mode.
     m_dummyFrameMessage.reset(new RGBDFrameMessage(rgbImageSize, depthImageSize));
 
+    // Set up the decompression stage used for frames that the client sends in windowed mode. Frames are read off the socket into the
+    // compressed frame message queue as soon as they arrive, and uncompressed into the frame message queue on a separate thread, so
+    // that decompression overlaps with the receipt of the next frame. The compressed queue blocks when full, which stops us reading
+    // from the socket and thereby throttles the client via TCP flow control rather than dropping frames we have already acknowledged.
+    m_compressedFrameMessageQueue.initialise(capacity, boost::bind(boost::factory<CompressedRGBDFrameMessage_Ptr>(), boost::cref(m_headerMessage)));
+    m_decompressedFrameMessage.reset(new RGBDFrameMessage(rgbImageSize, depthImageSize));
+    m_frameDecompressor.reset(new RGBDFrameCompressor(rgbImageSize, depthImageSize, calibMsg.extract_rgb_compression_type(), calibMsg.extract_depth_compression_type()));
+    m_decompressionThread.reset(new boost::thread(&MappingClientHandler::run_decompressor, this));
+
     // Signal to the client that the server is ready.
     m_connectionOk = write_message(AckMessage());
   }
@@ -253,4 +291,103 @@ void MappingClientHandler::set_scene_id(const std::string& sceneID)
   m_sceneID = sceneID;
 }
 
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void MappingClientHandler::receive_windowed_frame()
+{
+  // If the decompression thread has failed to uncompress an earlier frame, drop the connection to the client.
+  if(m_decompressionFailed)
+  {
+    m_connectionOk = false;
+    return;
+  }
+
+  FrameSequenceMessage sequenceMsg;
+
+  // Try to read the sequence message and the frame header message, and then the frame message itself.
+  if((m_connectionOk = read_message(sequenceMsg) && read_message(m_headerMessage)))
+  {
+    m_frameMessage->set_compressed_image_sizes(m_headerMessage);
+    m_connectionOk = read_message(*m_frameMessage);
+  }
+
+  if(!m_connectionOk) return;
+
+  // The frames arrive over TCP, so a sequence number other than the one we expect indicates a broken client.
+  const uint32_t sequenceNumber = sequenceMsg.extract_sequence_number();
+  if(sequenceNumber != m_expectedSequenceNumber)
+  {
+    std::cerr << "Warning: Client " << m_clientID << " sent frame " << sequenceNumber << " when frame " << m_expectedSequenceNumber << " was expected.\n";
+    m_connectionOk = false;
+    return;
+  }
+
+  ++m_expectedSequenceNumber;
+
+  // Hand the frame over to the decompression thread. Rather than copying the frame data, we swap the message we just read
+  // into with the one from the pool (this may block until the decompression thread has finished with an earlier frame).
+  {
+    CompressedRGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_compressedFrameMessageQueue.begin_push();
+    boost::optional<CompressedRGBDFrameMessage_Ptr&> elt = pushHandler->get();
+    if(elt) std::swap(*elt, m_frameMessage);
+  }
+
+  // If the client asked for one, send a (cumulative) acknowledgement for all frames up to and including this one. Note that we
+  // acknowledge the frame once it has been received rather than once it has been uncompressed, so that the client can keep
+  // sending whilst we decompress.
+  if(sequenceMsg.extract_ack_requested())
+  {
+    m_connectionOk = write_message(FrameAckMessage(sequenceNumber));
+  }
+}
+
+void MappingClientHandler::run_decompressor()
+{
+  while(true)
+  {
+    // Wait for a compressed frame message to become available. A null message is the signal to terminate.
+    CompressedRGBDFrameMessage_Ptr compressedMsg = m_compressedFrameMessageQueue.peek();
+    if(!compressedMsg) break;
+
+    // Uncompress the frame, and push it onto the frame message queue (if there is space). Note that we uncompress it into a separate
+    // message first, and only swap it into the queue if that succeeds, so that a frame that cannot be uncompressed never ends up on
+    // the queue. If an earlier frame could not be uncompressed, we simply discard the frame, since the connection is being dropped.
+    if(!m_decompressionFailed)
+    {
+      try
+      {
+        m_frameDecompressor->uncompress_rgbd_frame(*compressedMsg, *m_decompressedFrameMessage);
+
+        RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue->begin_push();
+        boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
+        if(elt) std::swap(*elt, m_decompressedFrameMessage);
+      }
+      catch(std::exception& e)
+      {
+        std::cerr << "Warning: Could not uncompress a frame from client " << m_clientID << ": " << e.what() << '\n';
+        m_decompressionFailed = true;
+      }
+    }
+
+    // Return the compressed frame message to the pool so that it can be reused for a later frame.
+    m_compressedFrameMessageQueue.pop();
+  }
+}
+
+void MappingClientHandler::stop_decompressor()
+{
+  if(!m_decompressionThread) return;
+
+  // Push a null message onto the compressed frame message queue to tell the decompression thread to terminate
+  // once it has uncompressed any frames that are already waiting, and then wait for it to do so.
+  {
+    CompressedRGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_compressedFrameMessageQueue.begin_push();
+    boost::optional<CompressedRGBDFrameMessage_Ptr&> elt = pushHandler->get();
+    if(elt) elt->reset();
+  }
+
+  m_decompressionThread->join();
+  m_decompressionThread.reset();
+}
+
 }
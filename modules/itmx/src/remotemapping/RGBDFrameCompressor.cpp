@@ -16,6 +16,8 @@
 #include <orx/base/MemoryBlockFactory.h>
 using orx::MemoryBlockFactory;
 
+#include "remotemapping/RVLDepthCodec.h"
+
 namespace itmx {
 
 //#################### NESTED TYPES ####################
@@ -34,6 +36,9 @@ struct RGBDFrameCompressor::Impl
   /** The type of compression algorithm to use for the RGB images. */
   RGBCompressionType rgbCompressionType;
 
+  /** The codec used to compress the depth images if we're using RVL compression. */
+  boost::shared_ptr<RVLDepthCodec> rvlDepthCodec;
+
   /** An image storing the temporary uncompressed depth data. */
   ORShortImage_Ptr uncompressedDepthImage;
 
@@ -75,6 +80,12 @@ RGBDFrameCompressor::RGBDFrameCompressor(const Vector2i& rgbImageSize, const Vec
 #endif
   }
 
+  // If we're using RVL compression for the depth images, set up the codec (this does not depend on OpenCV).
+  if(depthCompressionType == DEPTH_COMPRESSION_RVL || depthCompressionType == DEPTH_COMPRESSION_RVL_TEMPORAL)
+  {
+    m_impl->rvlDepthCodec.reset(new RVLDepthCodec(depthCompressionType == DEPTH_COMPRESSION_RVL_TEMPORAL));
+  }
+
   // If we're using either the JPG or PNG compression from OpenCV to compress RGB images, allocate a temporary OpenCV image accordingly.
   // The image we allocate will have 3 channels, and we will use cvtColor to fill it.
   if(rgbCompressionType == RGB_COMPRESSION_JPG || rgbCompressionType == RGB_COMPRESSION_PNG)
@@ -158,9 +169,14 @@ void RGBDFrameCompressor::compress_depth_image()
     cv::imencode(".png", m_impl->uncompressedDepthMat, m_impl->compressedDepthBytes);
 #endif
   }
+  else if(m_impl->rvlDepthCodec)
+  {
+    // If we're using RVL compression, let the codec compress the image directly into the internal buffer.
+    m_impl->rvlDepthCodec->compress(m_impl->uncompressedDepthImage.get(), m_impl->compressedDepthBytes);
+  }
   else
   {
-    // If we're not using PNG compression, simply copy the raw bytes of the image into the internal buffer.
+    // If we're not using compression, simply copy the raw bytes of the image into the internal buffer.
     m_impl->compressedDepthBytes.resize(m_impl->uncompressedDepthImage->dataSize * sizeof(short));
     memcpy(m_impl->compressedDepthBytes.data(), m_impl->uncompressedDepthImage->GetData(MEMORYDEVICE_CPU), m_impl->compressedDepthBytes.size());
   }
@@ -217,6 +233,11 @@ void RGBDFrameCompressor::uncompress_depth_image()
     m_impl->uncompressedDepthMat.convertTo(depthWrapper, CV_16S);
 #endif
   }
+  else if(m_impl->rvlDepthCodec)
+  {
+    // If we're using RVL compression, let the codec uncompress the image, resizing it as necessary.
+    m_impl->rvlDepthCodec->uncompress(m_impl->compressedDepthBytes, m_impl->uncompressedDepthImage.get());
+  }
   else
   {
     // Otherwise, first check that the size of the uncompressed image matches that of the compressed data.
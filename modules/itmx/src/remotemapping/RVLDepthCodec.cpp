@@ -0,0 +1,241 @@
+/**
+ * itmx: RVLDepthCodec.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "remotemapping/RVLDepthCodec.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace itmx {
+
+//#################### LOCAL CONSTANTS AND FUNCTIONS ####################
+
+/** The size (in bytes) of the header at the start of each compressed image (delta flag, width and height). */
+static const size_t HEADER_SIZE = 3 * sizeof(int32_t);
+
+/**
+ * \brief Reads the next variable-length-coded value from an array of RVL-coded words.
+ *
+ * \param words       A pointer to the next unread word (updated as words are consumed).
+ * \param wordsEnd    A pointer to the end of the words.
+ * \param word        The remaining nibbles of the word currently being read (in its top bits).
+ * \param nibblesLeft The number of nibbles remaining in the word currently being read.
+ * \return            The value.
+ *
+ * \throws std::runtime_error If the words run out before the value has been read.
+ */
+static inline uint32_t read_vle(const uint32_t *& words, const uint32_t *wordsEnd, uint32_t& word, int& nibblesLeft)
+{
+  uint32_t value = 0, nibble;
+  int shift = 0;
+  do
+  {
+    if(nibblesLeft == 0)
+    {
+      if(words == wordsEnd) throw std::runtime_error("Error: The compressed depth image is truncated");
+      word = *words++;
+      nibblesLeft = 8;
+    }
+
+    nibble = word >> 28;
+    word <<= 4;
+    --nibblesLeft;
+
+    value |= (nibble & 7) << shift;
+    shift += 3;
+  } while((nibble & 8) && shift < 32);
+
+  return value;
+}
+
+/**
+ * \brief Writes a value using variable-length coding (3 bits of the value per nibble, plus a continuation bit).
+ *
+ * \param value       The value to write.
+ * \param out         A pointer to the location at which to write the next complete word (updated as words are written).
+ * \param word        The word currently being written.
+ * \param nibbleCount The number of nibbles that have been written to the current word.
+ */
+static inline void write_vle(uint32_t value, uint8_t *& out, uint32_t& word, int& nibbleCount)
+{
+  do
+  {
+    uint32_t nibble = value & 7;
+    value >>= 3;
+    if(value) nibble |= 8;
+
+    word = (word << 4) | nibble;
+    if(++nibbleCount == 8)
+    {
+      memcpy(out, &word, sizeof(uint32_t));
+      out += sizeof(uint32_t);
+      word = 0;
+      nibbleCount = 0;
+    }
+  } while(value);
+}
+
+//#################### CONSTRUCTORS ####################
+
+RVLDepthCodec::RVLDepthCodec(bool useTemporalDeltas)
+: m_lastCompressedSize(0, 0), m_lastUncompressedSize(0, 0), m_useTemporalDeltas(useTemporalDeltas)
+{}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void RVLDepthCodec::compress(const ORShortImage *depthImage, std::vector<uint8_t>& bytes)
+{
+  const Vector2i& size = depthImage->noDims;
+  const size_t count = static_cast<size_t>(size.x) * size.y;
+  const uint16_t *values = reinterpret_cast<const uint16_t*>(depthImage->GetData(MEMORYDEVICE_CPU));
+
+  // If we can, code the image as the (wrapped) difference from the previous image we compressed.
+  const int32_t isDelta = m_useTemporalDeltas && size == m_lastCompressedSize ? 1 : 0;
+  const uint16_t *codedValues = values;
+  if(isDelta)
+  {
+    m_residuals.resize(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+      m_residuals[i] = static_cast<uint16_t>(values[i] - m_lastCompressedValues[i]);
+    }
+    codedValues = &m_residuals[0];
+  }
+
+  // Remember the image, so that we can code the next image relative to it.
+  m_lastCompressedSize = size;
+  if(m_useTemporalDeltas) m_lastCompressedValues.assign(values, values + count);
+
+  // Write the header, followed by the RVL-coded values.
+  const int32_t header[] = { isDelta, size.x, size.y };
+  bytes.resize(HEADER_SIZE);
+  memcpy(&bytes[0], header, HEADER_SIZE);
+  encode_rvl(codedValues, count, bytes);
+}
+
+void RVLDepthCodec::uncompress(const std::vector<uint8_t>& bytes, ORShortImage *depthImage)
+{
+  // Read and check the header.
+  if(bytes.size() < HEADER_SIZE || (bytes.size() - HEADER_SIZE) % sizeof(uint32_t) != 0)
+  {
+    throw std::runtime_error("Error: The compressed depth image is malformed");
+  }
+
+  int32_t header[3];
+  memcpy(header, &bytes[0], HEADER_SIZE);
+  const bool isDelta = header[0] != 0;
+  const Vector2i size(header[1], header[2]);
+  if(size.x < 0 || size.y < 0) throw std::runtime_error("Error: The compressed depth image has an invalid size");
+
+  if(isDelta && (!m_useTemporalDeltas || size != m_lastUncompressedSize))
+  {
+    throw std::runtime_error("Error: The compressed depth image is a temporal delta that does not follow on from the previous image");
+  }
+
+  // Decode the values, undoing the temporal delta if necessary.
+  const size_t count = static_cast<size_t>(size.x) * size.y;
+  const uint32_t *words = reinterpret_cast<const uint32_t*>(&bytes[0] + HEADER_SIZE);
+  const size_t wordCount = (bytes.size() - HEADER_SIZE) / sizeof(uint32_t);
+
+  depthImage->ChangeDims(size);
+  uint16_t *values = reinterpret_cast<uint16_t*>(depthImage->GetData(MEMORYDEVICE_CPU));
+
+  if(isDelta)
+  {
+    m_residuals.resize(count);
+    decode_rvl(words, wordCount, &m_residuals[0], count);
+    for(size_t i = 0; i < count; ++i)
+    {
+      values[i] = m_lastUncompressedValues[i] = static_cast<uint16_t>(m_lastUncompressedValues[i] + m_residuals[i]);
+    }
+  }
+  else
+  {
+    decode_rvl(words, wordCount, values, count);
+    if(m_useTemporalDeltas) m_lastUncompressedValues.assign(values, values + count);
+  }
+
+  m_lastUncompressedSize = size;
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+void RVLDepthCodec::decode_rvl(const uint32_t *words, size_t wordCount, uint16_t *values, size_t count)
+{
+  const uint32_t *wordsEnd = words + wordCount;
+  uint32_t word = 0;
+  int nibblesLeft = 0;
+
+  uint16_t previous = 0;
+  size_t i = 0;
+  while(i < count)
+  {
+    // Read a run of zeros.
+    const uint32_t zeroCount = read_vle(words, wordsEnd, word, nibblesLeft);
+    if(zeroCount > count - i) throw std::runtime_error("Error: The compressed depth image is malformed");
+    memset(values + i, 0, zeroCount * sizeof(uint16_t));
+    i += zeroCount;
+
+    // Read a run of non-zero values, each coded as the zig-zag-encoded difference from the previous non-zero value.
+    const uint32_t nonZeroCount = read_vle(words, wordsEnd, word, nibblesLeft);
+    if(nonZeroCount > count - i) throw std::runtime_error("Error: The compressed depth image is malformed");
+    for(const size_t end = i + nonZeroCount; i < end; ++i)
+    {
+      const uint32_t zigzag = read_vle(words, wordsEnd, word, nibblesLeft);
+      const uint16_t delta = static_cast<uint16_t>((zigzag >> 1) ^ (0u - (zigzag & 1)));
+      previous = static_cast<uint16_t>(previous + delta);
+      values[i] = previous;
+    }
+  }
+}
+
+void RVLDepthCodec::encode_rvl(const uint16_t *values, size_t count, std::vector<uint8_t>& bytes)
+{
+  // Make enough space for the worst case up-front (no value needs more than 6 nibbles, and each run of non-zero values
+  // is preceded by two run lengths of at most 11 nibbles each), so that we can write the words directly into the vector.
+  const size_t offset = bytes.size();
+  const size_t maxWordCount = (6 * count + 22 * (count / 2 + 1)) / 8 + 1;
+  bytes.resize(offset + maxWordCount * sizeof(uint32_t));
+
+  uint8_t *out = &bytes[offset];
+  uint32_t word = 0;
+  int nibbleCount = 0;
+
+  uint16_t previous = 0;
+  size_t i = 0;
+  while(i < count)
+  {
+    // Write the length of the run of zeros starting at i.
+    size_t j = i;
+    while(j < count && values[j] == 0) ++j;
+    write_vle(static_cast<uint32_t>(j - i), out, word, nibbleCount);
+    i = j;
+
+    // Write the length of the run of non-zero values that follows it, and then the values themselves.
+    while(j < count && values[j] != 0) ++j;
+    write_vle(static_cast<uint32_t>(j - i), out, word, nibbleCount);
+    for(; i < j; ++i)
+    {
+      // Zig-zag encode the difference (viewed as a signed 16-bit value). We do this using unsigned arithmetic only,
+      // since left-shifting a negative value is undefined behaviour (and right-shifting one is implementation-defined).
+      const uint32_t delta = static_cast<uint16_t>(values[i] - previous);
+      const uint32_t zigzag = ((delta << 1) ^ (0u - (delta >> 15))) & 0xFFFF;
+      write_vle(zigzag, out, word, nibbleCount);
+      previous = values[i];
+    }
+  }
+
+  // Flush any partial word, aligning the nibbles we've written to the top of the word.
+  if(nibbleCount > 0)
+  {
+    word <<= 4 * (8 - nibbleCount);
+    memcpy(out, &word, sizeof(uint32_t));
+    out += sizeof(uint32_t);
+  }
+
+  bytes.resize(out - &bytes[0]);
+}
+
+}
@@ -0,0 +1,47 @@
+/**
+ * itmx: PackedRGBDSequenceTracker.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "trackers/PackedRGBDSequenceTracker.h"
+using namespace ITMLib;
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+PackedRGBDSequenceTracker::PackedRGBDSequenceTracker(const std::string& filename, size_t initialFrameNumber)
+: m_nextFrameIdx(initialFrameNumber), m_reader(new PackedRGBDSequenceReader(filename))
+{}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+bool PackedRGBDSequenceTracker::requiresColourRendering() const
+{
+  return false;
+}
+
+bool PackedRGBDSequenceTracker::requiresDepthReliability() const
+{
+  return false;
+}
+
+bool PackedRGBDSequenceTracker::requiresPointCloudRendering() const
+{
+  return false;
+}
+
+void PackedRGBDSequenceTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView *view)
+{
+  // If we have run off the end of the sequence, report a tracking failure rather than yielding a bogus pose.
+  if(m_nextFrameIdx >= m_reader->get_frame_count())
+  {
+    trackingState->trackerResult = ITMTrackingState::TRACKING_FAILED;
+    return;
+  }
+
+  *trackingState->pose_d = m_reader->get_pose(m_nextFrameIdx++);
+  trackingState->trackerResult = ITMTrackingState::TRACKING_GOOD;
+}
+
+}
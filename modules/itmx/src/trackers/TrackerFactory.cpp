@@ -20,6 +20,7 @@ using namespace orx;
 using namespace tvgutil;
 
 #include "trackers/GlobalTracker.h"
+#include "trackers/PackedRGBDSequenceTracker.h"
 #include "trackers/RemoteTracker.h"
 
 #ifdef WITH_OVR
@@ -93,6 +94,26 @@ Tracker_Ptr TrackerFactory::make_simple_tracker(const std::string& trackerType,
       lowLevelEngine.get(), imuCalibrator.get(), &settings->sceneParams
     );
   }
+  else if(trackerType == "packed")
+  {
+    // The parameters have the form "path=<sequence file>,initialFrameNo=<number>" (the initial frame number is optional).
+    const std::string pathPrefix = "path=", frameNoPrefix = ",initialFrameNo=";
+    if(trackerParams.compare(0, pathPrefix.size(), pathPrefix) != 0)
+    {
+      throw std::runtime_error("Error: Invalid packed sequence tracker parameters '" + trackerParams + "'");
+    }
+
+    std::string path = trackerParams.substr(pathPrefix.size());
+    size_t initialFrameNumber = 0;
+    const size_t frameNoPos = path.rfind(frameNoPrefix);
+    if(frameNoPos != std::string::npos)
+    {
+      initialFrameNumber = boost::lexical_cast<size_t>(path.substr(frameNoPos + frameNoPrefix.size()));
+      path.erase(frameNoPos);
+    }
+
+    tracker = new PackedRGBDSequenceTracker(path, initialFrameNumber);
+  }
   else if(trackerType == "remote")
   {
     tracker = new RemoteTracker(mappingServer, boost::lexical_cast<int>(trackerParams));
@@ -6,6 +6,10 @@
 #ifndef H_ORX_MEMORYBLOCKFACTORY
 #define H_ORX_MEMORYBLOCKFACTORY
 
+#include <map>
+#include <string>
+#include <typeinfo>
+
 #include <boost/shared_ptr.hpp>
 
 #include <ORUtils/DeviceType.h>
@@ -16,14 +20,79 @@ namespace orx {
 
 /**
  * \brief An instance of this class can be used to make memory blocks.
+ *
+ * The memory blocks made by the factory are recycled: when the last pointer to a block is dropped, the block is returned to
+ * a pool (provided that the pool has not reached its capacity), from which it can be handed out again by a later request for
+ * a block of the same type and size. This avoids repeatedly allocating and freeing memory (on both the CPU and the GPU) for
+ * blocks that are made afresh on each frame. Recycled blocks are cleared before being handed out, just like new ones.
+ *
+ * Each block can also be tagged with the name of the subsystem that owns it, and the factory keeps track of the number of
+ * bytes used by the live blocks with each tag, and of the peak number of bytes used by them at any one time. Each block is
+ * accounted for at the size it had when it was made: the factory never inspects live blocks, since they may be in use
+ * (and resized) on other threads.
  */
 class MemoryBlockFactory
 {
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct records the memory used by the live blocks with a particular tag.
+   *
+   * The byte counts include both the CPU and (if allocated) the GPU storage for each block, and are based on the sizes of the blocks when they were made.
+   */
+  struct Usage
+  {
+    /** The number of live blocks with the tag. */
+    size_t m_liveBlockCount;
+
+    /** The number of bytes currently used by the live blocks with the tag. */
+    size_t m_liveBytes;
+
+    /** The largest number of bytes that has been used by the live blocks with the tag at any one time. */
+    size_t m_peakBytes;
+
+    /**
+     * \brief Constructs an empty usage record.
+     */
+    Usage();
+  };
+
+private:
+  /** The pool in which released blocks wait to be reused, and which keeps track of the memory usage for each tag. */
+  class Pool;
+
+  /** A function used to destroy a block of a particular type. */
+  typedef void (*Destroyer)(void*);
+
+  /**
+   * \brief An instance of an instantiation of this class template can be used to return a block to the pool when the last pointer to it is dropped.
+   *
+   * Each recycler holds on to the pool, so that blocks can safely be released even after the factory itself has been destroyed.
+   */
+  template <typename BlockType>
+  struct Recycler
+  {
+    boost::shared_ptr<Pool> m_pool;
+
+    explicit Recycler(const boost::shared_ptr<Pool>& pool)
+    : m_pool(pool)
+    {}
+
+    void operator()(BlockType *block) const
+    {
+      // Note: This is only called once the last pointer to the block has been dropped, so it is safe to read its size here.
+      release_block(m_pool, block, block->dataSize);
+    }
+  };
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The type of device on which the memory blocks will primarily be used. */
   ORUtils::DeviceType m_deviceType;
 
+  /** The pool in which released blocks wait to be reused, and which keeps track of the memory usage for each tag. */
+  boost::shared_ptr<Pool> m_pool;
+
   //#################### SINGLETON IMPLEMENTATION ####################
 private:
   /**
@@ -41,30 +110,66 @@ public:
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Gets the number of bytes currently held by the pool in released blocks that are waiting to be reused.
+   *
+   * \return  The number of bytes currently held by the pool.
+   */
+  size_t get_pooled_bytes() const;
+
+  /**
+   * \brief Gets the memory usage for each tag with which blocks have been made.
+   *
+   * The usage is taken from the factory's own records, so blocks that have been resized since they were made are counted at their original sizes.
+   *
+   * \return  A map from tags to their memory usage.
+   */
+  std::map<std::string,Usage> get_usages() const;
+
   /**
    * \brief Makes a memory block of the specified type and size.
    *
    * \param dataSize  The size of the memory block to make.
+   * \param tag       The name of the subsystem that will own the memory block (used for memory accounting).
    * \return          The memory block.
    */
   template <typename T>
-  boost::shared_ptr<ORUtils::MemoryBlock<T> > make_block(size_t dataSize = 0) const
+  boost::shared_ptr<ORUtils::MemoryBlock<T> > make_block(size_t dataSize = 0, const std::string& tag = "untagged") const
   {
+    typedef ORUtils::MemoryBlock<T> BlockType;
     bool allocateGPU = m_deviceType == ORUtils::DEVICE_CUDA;
-    return boost::shared_ptr<ORUtils::MemoryBlock<T> >(new ORUtils::MemoryBlock<T>(dataSize, true, allocateGPU));
+
+    BlockType *block = static_cast<BlockType*>(acquire_block(typeid(BlockType).name(), dataSize, allocateGPU));
+    if(block) block->Clear();
+    else block = new BlockType(dataSize, true, allocateGPU);
+
+    return wrap_block<T>(block, allocateGPU, tag);
   }
 
   /**
    * \brief Makes an image of the specified type and size.
    *
    * \param size  The size of the image to make.
+   * \param tag   The name of the subsystem that will own the image (used for memory accounting).
    * \return      The image.
    */
   template <typename T>
-  boost::shared_ptr<ORUtils::Image<T> > make_image(const ORUtils::Vector2<int> size = ORUtils::Vector2<int>(0, 0)) const
+  boost::shared_ptr<ORUtils::Image<T> > make_image(const ORUtils::Vector2<int> size = ORUtils::Vector2<int>(0, 0), const std::string& tag = "untagged") const
   {
+    typedef ORUtils::Image<T> BlockType;
     bool allocateGPU = m_deviceType == ORUtils::DEVICE_CUDA;
-    return boost::shared_ptr<ORUtils::Image<T> >(new ORUtils::Image<T>(size, true, allocateGPU));
+
+    // Note that a recycled image may have different dimensions to the ones requested (but the same number of pixels),
+    // so we need to change its dimensions before handing it out. This never causes its storage to be reallocated.
+    BlockType *image = static_cast<BlockType*>(acquire_block(typeid(BlockType).name(), static_cast<size_t>(size.x * size.y), allocateGPU));
+    if(image)
+    {
+      image->ChangeDims(size);
+      image->Clear();
+    }
+    else image = new BlockType(size, true, allocateGPU);
+
+    return wrap_block<T>(image, allocateGPU, tag);
   }
 
   /**
@@ -76,6 +181,83 @@ public:
    * \param deviceType  The type of device on which the memory blocks made by the factory will primarily be used.
    */
   void set_device_type(ORUtils::DeviceType deviceType);
+
+  /**
+   * \brief Sets the maximum number of bytes that the pool may hold in released blocks that are waiting to be reused.
+   *
+   * Blocks that are released when the pool is full are freed immediately. Setting the capacity to zero disables recycling.
+   *
+   * \param capacity  The maximum number of bytes that the pool may hold.
+   */
+  void set_pool_capacity(size_t capacity);
+
+  /**
+   * \brief Frees all of the released blocks that are currently held by the pool.
+   */
+  void trim_pool();
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Attempts to take a released block of the specified type and size from the pool.
+   *
+   * \param typeName  The name of the block type.
+   * \param dataSize  The number of elements in the block.
+   * \param gpu       Whether or not the block should have GPU storage.
+   * \return          The block, if a suitable one was available, or NULL otherwise.
+   */
+  void *acquire_block(const std::string& typeName, size_t dataSize, bool gpu) const;
+
+  /**
+   * \brief Records that the specified block is live, so that its memory usage can be tracked.
+   *
+   * \param block       The block.
+   * \param typeName    The name of the block type.
+   * \param dataSize    The number of elements in the block.
+   * \param elementSize The size of each element in the block (in bytes).
+   * \param gpu         Whether or not the block has GPU storage.
+   * \param tag         The name of the subsystem that owns the block.
+   * \param destroyer   The function to use to destroy the block.
+   */
+  void record_block(const void *block, const std::string& typeName, size_t dataSize, size_t elementSize, bool gpu,
+                    const std::string& tag, Destroyer destroyer) const;
+
+  /**
+   * \brief Records the specified block as live, and wraps it in a shared pointer that will return it to the pool when the last reference to it is dropped.
+   *
+   * \param block The block.
+   * \param gpu   Whether or not the block has GPU storage.
+   * \param tag   The name of the subsystem that will own the block.
+   * \return      The wrapped block.
+   */
+  template <typename T, typename BlockType>
+  boost::shared_ptr<BlockType> wrap_block(BlockType *block, bool gpu, const std::string& tag) const
+  {
+    record_block(block, typeid(BlockType).name(), block->dataSize, sizeof(T), gpu, tag, &destroy_block<BlockType>);
+    return boost::shared_ptr<BlockType>(block, Recycler<BlockType>(m_pool));
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Destroys a block of the specified type.
+   *
+   * \param block The block to destroy.
+   */
+  template <typename BlockType>
+  static void destroy_block(void *block)
+  {
+    delete static_cast<BlockType*>(block);
+  }
+
+  /**
+   * \brief Releases a block that is no longer in use, either by returning it to the specified pool (if there is room) or by destroying it.
+   *
+   * \param pool      The pool.
+   * \param block     The block.
+   * \param dataSize  The number of elements in the block when it was released.
+   */
+  static void release_block(const boost::shared_ptr<Pool>& pool, void *block, size_t dataSize);
 };
 
 }
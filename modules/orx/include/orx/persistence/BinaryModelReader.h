@@ -0,0 +1,136 @@
+/**
+ * orx: BinaryModelReader.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_ORX_BINARYMODELREADER
+#define H_ORX_BINARYMODELREADER
+
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <ORUtils/MemoryBlock.h>
+
+namespace orx {
+
+/**
+ * \brief An instance of this class provides read-only access to a binary model file written by a BinaryModelWriter.
+ *
+ * The file is memory-mapped rather than read, so opening it is almost instantaneous, and only the pages that are
+ * actually used are ever brought into memory. Chunks can either be accessed in place via get_chunk, or copied
+ * straight into memory blocks via read_block (a single memcpy per block, with no parsing).
+ *
+ * Note that loading a model into memory blocks is copy-based: the blocks are not backed by the mapped region. This is
+ * deliberate, since the blocks own their data (ORUtils::MemoryBlock cannot wrap external memory), may need to be copied
+ * across to the GPU anyway, and are modified in place when a loaded relocaliser is trained further, which a read-only
+ * mapping would not allow. What the format saves is the parsing and the separate files, not the copy itself.
+ */
+class BinaryModelReader
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The offsets and sizes of the chunks in the file, indexed by name. */
+  std::map<std::string,std::pair<uint64_t,uint64_t> > m_chunks;
+
+  /** The path to the file. */
+  std::string m_filename;
+
+  /** The memory-mapped file. */
+  boost::interprocess::file_mapping m_mapping;
+
+  /** The mapped region covering the whole file. */
+  boost::interprocess::mapped_region m_region;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Opens a binary model file.
+   *
+   * \param filename  The path to the file.
+   *
+   * \throws std::runtime_error If the file cannot be opened, or is not a valid binary model file.
+   */
+  explicit BinaryModelReader(const std::string& filename);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets a pointer to the data for the specified chunk (within the mapped file).
+   *
+   * \param name  The name of the chunk.
+   * \param size  A variable into which to write the size of the chunk (in bytes).
+   * \return      A pointer to the data for the chunk (valid for as long as the reader exists).
+   *
+   * \throws std::runtime_error If the file does not contain the specified chunk.
+   */
+  const void *get_chunk(const std::string& name, size_t& size) const;
+
+  /**
+   * \brief Determines whether or not the file contains the specified chunk.
+   *
+   * \param name  The name of the chunk.
+   * \return      true, if the file contains the chunk, or false otherwise.
+   */
+  bool has_chunk(const std::string& name) const;
+
+  /**
+   * \brief Copies the specified chunk into the CPU copy of a memory block.
+   *
+   * \note  The memory block keeps its own storage: after this call, it no longer refers to the mapped file in any way.
+   *
+   * \param name  The name of the chunk.
+   * \param block The memory block (must have exactly the same size as the chunk).
+   *
+   * \throws std::runtime_error If the file does not contain the chunk, or the memory block has the wrong size.
+   */
+  template <typename T>
+  void read_block(const std::string& name, ORUtils::MemoryBlock<T>& block) const
+  {
+    size_t size;
+    const void *data = get_chunk(name, size);
+    if(size != block.dataSize * sizeof(T)) throw_size_mismatch(name, size, block.dataSize * sizeof(T));
+    if(size > 0) memcpy(block.GetData(MEMORYDEVICE_CPU), data, size);
+  }
+
+  /**
+   * \brief Copies the specified chunk into a vector.
+   *
+   * \param name  The name of the chunk.
+   * \return      A vector containing the chunk data.
+   *
+   * \throws std::runtime_error If the file does not contain the chunk, or its size is not a multiple of sizeof(T).
+   */
+  template <typename T>
+  std::vector<T> read_vector(const std::string& name) const
+  {
+    size_t size;
+    const T *data = static_cast<const T*>(get_chunk(name, size));
+    if(size % sizeof(T) != 0) throw_size_mismatch(name, size, (size / sizeof(T)) * sizeof(T));
+    return std::vector<T>(data, data + size / sizeof(T));
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Throws an exception indicating that a chunk does not have the expected size.
+   *
+   * \param name          The name of the chunk.
+   * \param actualSize    The actual size of the chunk.
+   * \param expectedSize  The expected size of the chunk.
+   *
+   * \throws std::runtime_error Always.
+   */
+  void throw_size_mismatch(const std::string& name, size_t actualSize, size_t expectedSize) const;
+};
+
+}
+
+#endif
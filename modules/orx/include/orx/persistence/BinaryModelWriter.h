@@ -0,0 +1,145 @@
+/**
+ * orx: BinaryModelWriter.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_ORX_BINARYMODELWRITER
+#define H_ORX_BINARYMODELWRITER
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <ORUtils/MemoryBlock.h>
+
+namespace orx {
+
+/**
+ * \brief An instance of this class can be used to write a binary model file, i.e. a single file containing a set of named chunks of data
+ *        (e.g. the nodes of a forest, the contents of some memory blocks, etc.) that can later be memory-mapped by a BinaryModelReader.
+ *
+ * \note File format (binary mode, native endianness):
+ *
+ * magic ("ORXMODEL"), version (uint32), chunkCount (uint32), tableOffset (uint64)
+ * chunk data, each chunk starting at a multiple of ALIGNMENT bytes from the start of the file
+ * table: for each chunk, name (NAME_SIZE chars, zero-padded), offset (uint64), size (uint64)
+ */
+class BinaryModelWriter
+{
+  //#################### CONSTANTS ####################
+public:
+  /** The alignment (in bytes) of each chunk within the file. */
+  static const size_t ALIGNMENT = 64;
+
+  /** The maximum length of a chunk name (including the terminating zero). */
+  static const size_t NAME_SIZE = 32;
+
+  /** The version of the file format. */
+  static const uint32_t VERSION = 1;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct records where a chunk was written in the file.
+   */
+  struct ChunkEntry
+  {
+    /** The name of the chunk. */
+    std::string name;
+
+    /** The offset of the chunk data from the start of the file. */
+    uint64_t offset;
+
+    /** The size of the chunk data (in bytes). */
+    uint64_t size;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The chunks that have been written so far. */
+  std::vector<ChunkEntry> m_chunks;
+
+  /** The path to the file being written. */
+  std::string m_filename;
+
+  /** The stream to which the file is being written. */
+  std::ofstream m_fs;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Starts writing a binary model file.
+   *
+   * \param filename  The path to the file.
+   *
+   * \throws std::runtime_error If the file cannot be opened for writing.
+   */
+  explicit BinaryModelWriter(const std::string& filename);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the writer (the file will be incomplete unless close has been called).
+   */
+  ~BinaryModelWriter();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  BinaryModelWriter(const BinaryModelWriter&);
+  BinaryModelWriter& operator=(const BinaryModelWriter&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Finishes writing the file by writing the chunk table and patching the header.
+   *
+   * \throws std::runtime_error If the file cannot be written.
+   */
+  void close();
+
+  /**
+   * \brief Writes the CPU contents of a memory block as a chunk.
+   *
+   * \param name  The name of the chunk.
+   * \param block The memory block (its CPU copy must be up to date).
+   *
+   * \throws std::runtime_error If the chunk cannot be written.
+   */
+  template <typename T>
+  void write_block(const std::string& name, const ORUtils::MemoryBlock<T>& block)
+  {
+    write_chunk(name, block.GetData(MEMORYDEVICE_CPU), block.dataSize * sizeof(T));
+  }
+
+  /**
+   * \brief Writes a chunk of raw data.
+   *
+   * \param name  The name of the chunk (must be unique within the file and shorter than NAME_SIZE).
+   * \param data  A pointer to the data.
+   * \param size  The size of the data (in bytes).
+   *
+   * \throws std::runtime_error If the chunk cannot be written.
+   */
+  void write_chunk(const std::string& name, const void *data, size_t size);
+
+  /**
+   * \brief Writes the contents of a vector as a chunk.
+   *
+   * \param name  The name of the chunk.
+   * \param v     The vector.
+   *
+   * \throws std::runtime_error If the chunk cannot be written.
+   */
+  template <typename T>
+  void write_vector(const std::string& name, const std::vector<T>& v)
+  {
+    write_chunk(name, v.empty() ? NULL : &v[0], v.size() * sizeof(T));
+  }
+};
+
+}
+
+#endif
@@ -11,7 +11,7 @@
 #include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 
-#include <tvgutil/misc/ThreadPool.h>
+#include <tvgutil/misc/TaskScheduler.h>
 
 #include "../base/ORImagePtrTypes.h"
 
@@ -95,7 +95,7 @@ public:
   static void save_image_on_thread(const boost::shared_ptr<const ORUtils::Image<T> >& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN)
   {
     void (*p)(const boost::shared_ptr<const ORUtils::Image<T> >&, const std::string&, ImageFileType) = &save_image;
-    tvgutil::ThreadPool::instance().post_task(boost::bind(p, image, path, fileType));
+    tvgutil::TaskScheduler::instance().post(boost::bind(p, image, path, fileType), tvgutil::TP_LOW);
   }
 
   /**
@@ -6,12 +6,194 @@
 #include "base/MemoryBlockFactory.h"
 using namespace ORUtils;
 
+#include <algorithm>
+
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+
 namespace orx {
 
+//#################### LOCAL TYPES ####################
+
+class MemoryBlockFactory::Pool
+{
+  //~~~~~~~~~~~~~~~~~~~~ NESTED TYPES ~~~~~~~~~~~~~~~~~~~~
+private:
+  /** A released block that is waiting to be reused. */
+  struct Entry
+  {
+    void *m_block;
+    size_t m_bytes;
+    Destroyer m_destroyer;
+  };
+
+  /** The key used to look up released blocks: the block type, the number of elements and whether or not the block has GPU storage. */
+  typedef std::pair<std::string,std::pair<size_t,bool> > Key;
+
+  /** A record of a live block (the number of bytes it was accounted for when it was made, together with what is needed to release it). */
+  struct Record
+  {
+    size_t m_bytes;
+    Destroyer m_destroyer;
+    size_t m_elementSize;
+    bool m_gpu;
+    std::string m_tag;
+    std::string m_typeName;
+  };
+
+  //~~~~~~~~~~~~~~~~~~~~ PRIVATE VARIABLES ~~~~~~~~~~~~~~~~~~~~
+private:
+  /** The maximum number of bytes that the pool may hold in released blocks. */
+  size_t m_capacity;
+
+  /** The released blocks that are waiting to be reused. */
+  std::multimap<Key,Entry> m_entries;
+
+  /** The mutex used to synchronise access to the pool. */
+  boost::mutex m_mutex;
+
+  /** The number of bytes held by the pool in released blocks. */
+  size_t m_pooledBytes;
+
+  /** The records of the live blocks. */
+  std::map<const void*,Record> m_records;
+
+  /** The memory usage for each tag. */
+  std::map<std::string,Usage> m_usages;
+
+  //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+public:
+  Pool()
+  : m_capacity(256 * 1024 * 1024), m_pooledBytes(0)
+  {}
+
+  //~~~~~~~~~~~~~~~~~~~~ DESTRUCTOR ~~~~~~~~~~~~~~~~~~~~
+public:
+  ~Pool()
+  {
+    trim_to(0);
+  }
+
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+public:
+  void *acquire(const std::string& typeName, size_t dataSize, bool gpu)
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    std::multimap<Key,Entry>::iterator it = m_entries.find(std::make_pair(typeName, std::make_pair(dataSize, gpu)));
+    if(it == m_entries.end()) return NULL;
+
+    void *block = it->second.m_block;
+    m_pooledBytes -= it->second.m_bytes;
+    m_entries.erase(it);
+    return block;
+  }
+
+  size_t get_pooled_bytes()
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_pooledBytes;
+  }
+
+  std::map<std::string,Usage> get_usages()
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_usages;
+  }
+
+  void record(const void *block, const std::string& typeName, size_t dataSize, size_t elementSize, bool gpu, const std::string& tag, Destroyer destroyer)
+  {
+    Record record;
+    record.m_bytes = dataSize * elementSize * (gpu ? 2 : 1);
+    record.m_destroyer = destroyer;
+    record.m_elementSize = elementSize;
+    record.m_gpu = gpu;
+    record.m_tag = tag;
+    record.m_typeName = typeName;
+
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_records.insert(std::make_pair(block, record));
+
+    Usage& usage = m_usages[tag];
+    ++usage.m_liveBlockCount;
+    usage.m_liveBytes += record.m_bytes;
+    usage.m_peakBytes = std::max(usage.m_peakBytes, usage.m_liveBytes);
+  }
+
+  void release(void *block, size_t dataSize)
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+
+    // Note: This is called from the deleters of the blocks, so it must not throw. Every block with such a deleter has
+    //       a record, so the lookup can only fail if something has gone badly wrong, in which case we leak the block.
+    std::map<const void*,Record>::iterator it = m_records.find(block);
+    if(it == m_records.end()) return;
+
+    // Remove the block's contribution to the memory usage for its tag.
+    const Record& record = it->second;
+    Usage& usage = m_usages[record.m_tag];
+    --usage.m_liveBlockCount;
+    usage.m_liveBytes -= record.m_bytes;
+
+    // If there is room in the pool, add the block to it so that it can be reused; if not, destroy it. Note that the block
+    // may have been resized since it was made, so we pool it under its size at the point at which it was released.
+    const size_t bytes = dataSize * record.m_elementSize * (record.m_gpu ? 2 : 1);
+    if(bytes > 0 && m_pooledBytes + bytes <= m_capacity)
+    {
+      Entry entry;
+      entry.m_block = block;
+      entry.m_bytes = bytes;
+      entry.m_destroyer = record.m_destroyer;
+      m_entries.insert(std::make_pair(std::make_pair(record.m_typeName, std::make_pair(dataSize, record.m_gpu)), entry));
+      m_pooledBytes += bytes;
+      m_records.erase(it);
+    }
+    else
+    {
+      Destroyer destroyer = record.m_destroyer;
+      m_records.erase(it);
+      destroyer(block);
+    }
+  }
+
+  void set_capacity(size_t capacity)
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_capacity = capacity;
+    trim_to(capacity);
+  }
+
+  void trim()
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    trim_to(0);
+  }
+
+  //~~~~~~~~~~~~~~~~~~~~ PRIVATE MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+private:
+  void trim_to(size_t capacity)
+  {
+    // Destroy blocks from the pool until the number of bytes it holds is within the specified capacity.
+    std::multimap<Key,Entry>::iterator it = m_entries.begin();
+    while(m_pooledBytes > capacity && it != m_entries.end())
+    {
+      it->second.m_destroyer(it->second.m_block);
+      m_pooledBytes -= it->second.m_bytes;
+      m_entries.erase(it++);
+    }
+  }
+};
+
+//#################### CONSTRUCTORS ####################
+
+MemoryBlockFactory::Usage::Usage()
+: m_liveBlockCount(0), m_liveBytes(0), m_peakBytes(0)
+{}
+
 //#################### SINGLETON IMPLEMENTATION ####################
 
 MemoryBlockFactory::MemoryBlockFactory()
-: m_deviceType(DEVICE_CUDA)
+: m_deviceType(DEVICE_CUDA), m_pool(new Pool)
 {}
 
 MemoryBlockFactory& MemoryBlockFactory::instance()
@@ -22,9 +204,49 @@ MemoryBlockFactory& MemoryBlockFactory::instance()
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
+size_t MemoryBlockFactory::get_pooled_bytes() const
+{
+  return m_pool->get_pooled_bytes();
+}
+
+std::map<std::string,MemoryBlockFactory::Usage> MemoryBlockFactory::get_usages() const
+{
+  return m_pool->get_usages();
+}
+
 void MemoryBlockFactory::set_device_type(DeviceType deviceType)
 {
   m_deviceType = deviceType;
 }
 
+void MemoryBlockFactory::set_pool_capacity(size_t capacity)
+{
+  m_pool->set_capacity(capacity);
+}
+
+void MemoryBlockFactory::trim_pool()
+{
+  m_pool->trim();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void *MemoryBlockFactory::acquire_block(const std::string& typeName, size_t dataSize, bool gpu) const
+{
+  return m_pool->acquire(typeName, dataSize, gpu);
+}
+
+void MemoryBlockFactory::record_block(const void *block, const std::string& typeName, size_t dataSize, size_t elementSize, bool gpu,
+                                      const std::string& tag, Destroyer destroyer) const
+{
+  m_pool->record(block, typeName, dataSize, elementSize, gpu, tag, destroyer);
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+void MemoryBlockFactory::release_block(const boost::shared_ptr<Pool>& pool, void *block, size_t dataSize)
+{
+  pool->release(block, dataSize);
+}
+
 }
@@ -0,0 +1,99 @@
+/**
+ * orx: BinaryModelReader.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "persistence/BinaryModelReader.h"
+using namespace boost::interprocess;
+
+#include "persistence/BinaryModelWriter.h"
+
+namespace orx {
+
+//#################### CONSTRUCTORS ####################
+
+BinaryModelReader::BinaryModelReader(const std::string& filename)
+: m_filename(filename)
+{
+  try
+  {
+    m_mapping = file_mapping(filename.c_str(), read_only);
+    m_region = mapped_region(m_mapping, read_only);
+  }
+  catch(interprocess_exception&)
+  {
+    throw std::runtime_error("Error: Could not map binary model file: " + filename);
+  }
+
+  const char *base = static_cast<const char*>(m_region.get_address());
+  const uint64_t fileSize = m_region.get_size();
+
+  // Read and check the header.
+  const size_t headerSize = 24;
+  if(fileSize < headerSize || memcmp(base, "ORXMODEL", 8) != 0)
+  {
+    throw std::runtime_error("Error: Not a binary model file: " + filename);
+  }
+
+  uint32_t version, chunkCount;
+  uint64_t tableOffset;
+  memcpy(&version, base + 8, sizeof(uint32_t));
+  memcpy(&chunkCount, base + 12, sizeof(uint32_t));
+  memcpy(&tableOffset, base + 16, sizeof(uint64_t));
+
+  if(version != BinaryModelWriter::VERSION)
+  {
+    throw std::runtime_error("Error: Unsupported binary model file version (" + boost::lexical_cast<std::string>(version) + "): " + filename);
+  }
+
+  // Read the chunk table, checking that every chunk lies within the file.
+  const size_t entrySize = BinaryModelWriter::NAME_SIZE + 2 * sizeof(uint64_t);
+  if(tableOffset > fileSize || (fileSize - tableOffset) / entrySize < chunkCount)
+  {
+    throw std::runtime_error("Error: Corrupt chunk table in binary model file: " + filename);
+  }
+
+  const char *entry = base + tableOffset;
+  for(uint32_t i = 0; i < chunkCount; ++i, entry += entrySize)
+  {
+    const std::string name(entry, strnlen(entry, BinaryModelWriter::NAME_SIZE));
+    uint64_t offset, size;
+    memcpy(&offset, entry + BinaryModelWriter::NAME_SIZE, sizeof(uint64_t));
+    memcpy(&size, entry + BinaryModelWriter::NAME_SIZE + sizeof(uint64_t), sizeof(uint64_t));
+
+    if(offset > tableOffset || size > tableOffset - offset)
+    {
+      throw std::runtime_error("Error: Chunk '" + name + "' lies outside the data section of binary model file: " + filename);
+    }
+
+    m_chunks[name] = std::make_pair(offset, size);
+  }
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+const void *BinaryModelReader::get_chunk(const std::string& name, size_t& size) const
+{
+  std::map<std::string,std::pair<uint64_t,uint64_t> >::const_iterator it = m_chunks.find(name);
+  if(it == m_chunks.end()) throw std::runtime_error("Error: Binary model file " + m_filename + " has no chunk called '" + name + "'");
+
+  size = static_cast<size_t>(it->second.second);
+  return static_cast<const char*>(m_region.get_address()) + it->second.first;
+}
+
+bool BinaryModelReader::has_chunk(const std::string& name) const
+{
+  return m_chunks.find(name) != m_chunks.end();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void BinaryModelReader::throw_size_mismatch(const std::string& name, size_t actualSize, size_t expectedSize) const
+{
+  throw std::runtime_error(
+    "Error: Chunk '" + name + "' in binary model file " + m_filename + " has size " + boost::lexical_cast<std::string>(actualSize) +
+    " (expected " + boost::lexical_cast<std::string>(expectedSize) + ")"
+  );
+}
+
+}
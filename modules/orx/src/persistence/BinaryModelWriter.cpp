@@ -0,0 +1,86 @@
+/**
+ * orx: BinaryModelWriter.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "persistence/BinaryModelWriter.h"
+
+#include <stdexcept>
+
+namespace orx {
+
+//#################### CONSTRUCTORS ####################
+
+BinaryModelWriter::BinaryModelWriter(const std::string& filename)
+: m_filename(filename), m_fs(filename.c_str(), std::ios::binary)
+{
+  if(!m_fs) throw std::runtime_error("Error: Could not open binary model file for writing: " + filename);
+
+  // Write a placeholder header (it will be patched when the file is closed).
+  const char header[24] = {};
+  m_fs.write(header, sizeof(header));
+}
+
+//#################### DESTRUCTOR ####################
+
+BinaryModelWriter::~BinaryModelWriter()
+{
+  // Note: We deliberately don't call close here, since a half-written model file should not look valid.
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void BinaryModelWriter::close()
+{
+  if(!m_fs.is_open()) return;
+
+  // Write the chunk table.
+  const uint64_t tableOffset = static_cast<uint64_t>(m_fs.tellp());
+  for(size_t i = 0, size = m_chunks.size(); i < size; ++i)
+  {
+    char name[NAME_SIZE] = {};
+    m_chunks[i].name.copy(name, NAME_SIZE - 1);
+    m_fs.write(name, NAME_SIZE);
+    m_fs.write(reinterpret_cast<const char*>(&m_chunks[i].offset), sizeof(uint64_t));
+    m_fs.write(reinterpret_cast<const char*>(&m_chunks[i].size), sizeof(uint64_t));
+  }
+
+  // Patch the header.
+  const uint32_t version = VERSION;
+  const uint32_t chunkCount = static_cast<uint32_t>(m_chunks.size());
+  m_fs.seekp(0);
+  m_fs.write("ORXMODEL", 8);
+  m_fs.write(reinterpret_cast<const char*>(&version), sizeof(uint32_t));
+  m_fs.write(reinterpret_cast<const char*>(&chunkCount), sizeof(uint32_t));
+  m_fs.write(reinterpret_cast<const char*>(&tableOffset), sizeof(uint64_t));
+
+  m_fs.close();
+  if(!m_fs) throw std::runtime_error("Error: Could not write binary model file: " + m_filename);
+}
+
+void BinaryModelWriter::write_chunk(const std::string& name, const void *data, size_t size)
+{
+  if(name.empty() || name.size() >= NAME_SIZE) throw std::runtime_error("Error: Invalid chunk name: '" + name + "'");
+  for(size_t i = 0, chunkCount = m_chunks.size(); i < chunkCount; ++i)
+  {
+    if(m_chunks[i].name == name) throw std::runtime_error("Error: Duplicate chunk name: '" + name + "'");
+  }
+
+  // Pad the file so that the chunk starts on an aligned boundary (this allows the reader to access it in place).
+  uint64_t offset = static_cast<uint64_t>(m_fs.tellp());
+  const size_t padding = static_cast<size_t>((ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT);
+  const char zeros[ALIGNMENT] = {};
+  m_fs.write(zeros, padding);
+  offset += padding;
+
+  if(size > 0) m_fs.write(static_cast<const char*>(data), size);
+  if(!m_fs) throw std::runtime_error("Error: Could not write chunk '" + name + "' to binary model file: " + m_filename);
+
+  ChunkEntry entry;
+  entry.name = name;
+  entry.offset = offset;
+  entry.size = size;
+  m_chunks.push_back(entry);
+}
+
+}
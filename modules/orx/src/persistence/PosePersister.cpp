@@ -8,8 +8,10 @@
 #include <fstream>
 #include <stdexcept>
 
-#include <tvgutil/misc/ThreadPool.h>
-using tvgutil::ThreadPool;
+#include <boost/bind.hpp>
+
+#include <tvgutil/misc/TaskScheduler.h>
+using namespace tvgutil;
 
 namespace bf = boost::filesystem;
 
@@ -41,8 +43,8 @@ void PosePersister::save_pose_on_thread(const Matrix4f& pose, const std::string&
   // Select the save_pose overload that takes a string.
   void (*f)(const Matrix4f&, const std::string&) = &save_pose;
 
-  // Call it on a separate thread.
-  ThreadPool::instance().post_task(boost::bind(f, pose, path));
+  // Call it on a separate thread (as a low-priority background task, so as not to hold up any more urgent work).
+  TaskScheduler::instance().post(boost::bind(f, pose, path), TP_LOW);
 }
 
 void PosePersister::save_pose_on_thread(const Matrix4f& pose, const bf::path& path)
@@ -0,0 +1,249 @@
+/**
+ * rafl: FeatureMatrix.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_RAFL_FEATUREMATRIX
+#define H_RAFL_FEATUREMATRIX
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include "Descriptor.h"
+
+namespace rafl {
+
+/**
+ * \brief An instance of this class represents a contiguous matrix of feature descriptors, one descriptor per row.
+ *
+ * The matrix is stored in column-major order, so that the values of a single feature for all of the rows are contiguous
+ * in memory. This makes it cheap to evaluate decision functions that look at only one or two features for a large number
+ * of descriptors (as we do when scoring split candidates).
+ */
+class FeatureMatrix
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of rows for which space has been allocated in each column. */
+  size_t m_capacity;
+
+  /** The number of features in each descriptor (i.e. the number of columns in the matrix). */
+  size_t m_featureCount;
+
+  /** The number of rows currently in the matrix. */
+  size_t m_rowCount;
+
+  /** The feature values, stored column by column (the value of feature f for row r is at index f * m_capacity + r). */
+  std::vector<float> m_values;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty feature matrix.
+   */
+  FeatureMatrix()
+  : m_capacity(0), m_featureCount(0), m_rowCount(0)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Adds a new (uninitialised) row to the matrix.
+   *
+   * \param featureCount        The number of features in the descriptor that will be stored in the row.
+   * \return                    The index of the new row.
+   * \throws std::runtime_error If the matrix already contains descriptors with a different number of features.
+   */
+  size_t add_row(size_t featureCount)
+  {
+    if(featureCount != m_featureCount)
+    {
+      if(m_rowCount != 0) throw std::runtime_error("Error: Cannot add a descriptor with a different number of features to a non-empty feature matrix");
+      m_capacity = 0;
+      m_featureCount = featureCount;
+      m_values.clear();
+    }
+
+    if(m_rowCount == m_capacity) reserve(std::max<size_t>(16, m_capacity * 2));
+    return m_rowCount++;
+  }
+
+  /**
+   * \brief Removes all of the rows from the matrix and releases its memory.
+   */
+  void clear()
+  {
+    m_capacity = m_featureCount = m_rowCount = 0;
+    std::vector<float>().swap(m_values);
+  }
+
+  /**
+   * \brief Gets the values of the specified feature for all of the rows in the matrix.
+   *
+   * \param featureIndex  The index of the feature.
+   * \return              A pointer to the (contiguous) values of the feature for all of the rows in the matrix.
+   */
+  const float *get_column(size_t featureIndex) const
+  {
+    assert(featureIndex < m_featureCount);
+    return &m_values[featureIndex * m_capacity];
+  }
+
+  /**
+   * \brief Gets the number of features in each descriptor in the matrix.
+   *
+   * \return  The number of features in each descriptor in the matrix.
+   */
+  size_t get_feature_count() const
+  {
+    return m_featureCount;
+  }
+
+  /**
+   * \brief Copies the specified row of the matrix into a descriptor.
+   *
+   * \param row         The index of the row.
+   * \param descriptor  The descriptor into which to copy the row (this will be resized as necessary).
+   */
+  void get_row(size_t row, Descriptor& descriptor) const
+  {
+    assert(row < m_rowCount);
+    descriptor.resize(m_featureCount);
+    for(size_t i = 0; i < m_featureCount; ++i)
+    {
+      descriptor[i] = m_values[i * m_capacity + row];
+    }
+  }
+
+  /**
+   * \brief Gets the number of rows in the matrix.
+   *
+   * \return  The number of rows in the matrix.
+   */
+  size_t get_row_count() const
+  {
+    return m_rowCount;
+  }
+
+  /**
+   * \brief Gets the value of the specified feature in the specified row of the matrix.
+   *
+   * \param row           The index of the row.
+   * \param featureIndex  The index of the feature.
+   * \return              The value of the feature in the row.
+   */
+  float get_value(size_t row, size_t featureIndex) const
+  {
+    assert(row < m_rowCount && featureIndex < m_featureCount);
+    return m_values[featureIndex * m_capacity + row];
+  }
+
+  /**
+   * \brief Sets the specified row of the matrix from a contiguous array of feature values.
+   *
+   * \param row     The index of the row.
+   * \param values  The feature values (there must be get_feature_count() of them).
+   */
+  void set_row(size_t row, const float *values)
+  {
+    assert(row < m_rowCount);
+    for(size_t i = 0; i < m_featureCount; ++i)
+    {
+      m_values[i * m_capacity + row] = values[i];
+    }
+  }
+
+  /**
+   * \brief Sets the specified row of the matrix by copying a row from another matrix.
+   *
+   * \param row       The index of the row.
+   * \param source    The matrix from which to copy the row (this must have the same number of features).
+   * \param sourceRow The index of the row in the source matrix.
+   */
+  void set_row(size_t row, const FeatureMatrix& source, size_t sourceRow)
+  {
+    assert(row < m_rowCount && sourceRow < source.m_rowCount && source.m_featureCount == m_featureCount);
+    for(size_t i = 0; i < m_featureCount; ++i)
+    {
+      m_values[i * m_capacity + row] = source.m_values[i * source.m_capacity + sourceRow];
+    }
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Increases the number of rows for which space has been allocated in each column.
+   *
+   * \param capacity  The new capacity (must be at least the current number of rows).
+   */
+  void reserve(size_t capacity)
+  {
+    std::vector<float> values(m_featureCount * capacity);
+    for(size_t i = 0; i < m_featureCount; ++i)
+    {
+      std::copy(m_values.begin() + i * m_capacity, m_values.begin() + i * m_capacity + m_rowCount, values.begin() + i * capacity);
+    }
+
+    m_values.swap(values);
+    m_capacity = capacity;
+  }
+
+  //#################### SERIALIZATION ####################
+private:
+  /**
+   * \brief Loads the feature matrix from an archive.
+   *
+   * \param ar      The archive.
+   * \param version The file format version number.
+   */
+  template <typename Archive>
+  void load(Archive& ar, const unsigned int version)
+  {
+    ar & m_featureCount;
+    ar & m_rowCount;
+    ar & m_values;
+
+    if(m_values.size() != m_featureCount * m_rowCount)
+    {
+      throw std::runtime_error("Error: The serialized feature matrix is inconsistent");
+    }
+
+    m_capacity = m_rowCount;
+  }
+
+  /**
+   * \brief Saves the feature matrix to an archive.
+   *
+   * Only the rows that are in use are saved, so the archive does not depend on the matrix's current capacity.
+   *
+   * \param ar      The archive.
+   * \param version The file format version number.
+   */
+  template <typename Archive>
+  void save(Archive& ar, const unsigned int version) const
+  {
+    std::vector<float> values(m_featureCount * m_rowCount);
+    for(size_t i = 0; i < m_featureCount; ++i)
+    {
+      std::copy(m_values.begin() + i * m_capacity, m_values.begin() + i * m_capacity + m_rowCount, values.begin() + i * m_rowCount);
+    }
+
+    ar & m_featureCount;
+    ar & m_rowCount;
+    ar & values;
+  }
+
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+  friend class boost::serialization::access;
+};
+
+}
+
+#endif
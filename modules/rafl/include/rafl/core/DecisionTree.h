@@ -24,6 +24,24 @@ class DecisionTree
 {
   //#################### NESTED TYPES ####################
 private:
+  /**
+   * \brief An instance of this struct contains the parts of a node that are needed to pass a descriptor down the tree.
+   *
+   * The tree maintains a flat array of these alongside its nodes, so that batches of descriptors can be passed down
+   * it without having to chase a pointer to each node they visit.
+   */
+  struct FlatNode
+  {
+    /** The index of the node's left child in the tree's node array (or -1 if the node is a leaf). */
+    int m_leftChildIndex;
+
+    /** The index of the node's right child in the tree's node array (or -1 if the node is a leaf). */
+    int m_rightChildIndex;
+
+    /** The split function for the node (or NULL if the node is a leaf). */
+    const DecisionFunction *m_splitter;
+  };
+
   /**
    * \brief An instance of this class represents a node in the tree.
    */
@@ -272,6 +290,9 @@ private:
   /** The indices of nodes to which examples have been added during the current call to add_examples() and whose splittability may need recalculating. */
   std::set<int> m_dirtyNodes;
 
+  /** A flat array containing the parts of the nodes in the tree that are needed to pass descriptors down it (kept in sync with m_nodes). */
+  std::vector<FlatNode> m_flatNodes;
+
   /** The inverses of the L1-normalised class frequencies observed in the training data. */
   boost::optional<std::map<Label,float> > m_inverseClassWeights;
 
@@ -360,6 +381,40 @@ public:
     update_dirty_nodes();
   }
 
+  /**
+   * \brief Adds new training examples whose descriptors are stored in the rows of a feature matrix to the decision tree.
+   *
+   * This is equivalent to making an example from each row of the matrix and adding those, but avoids allocating
+   * a separate descriptor and example for each one.
+   *
+   * \param features            A feature matrix containing the descriptors of the examples, one per row.
+   * \param labels              The labels of the examples (the label of the example in row r of the matrix is labels[r]).
+   * \throws std::runtime_error If the numbers of rows and labels differ.
+   */
+  void add_examples(const FeatureMatrix& features, const std::vector<Label>& labels)
+  {
+    const size_t rowCount = features.get_row_count();
+    if(labels.size() != rowCount) throw std::runtime_error("Error: The numbers of descriptors and labels must be the same");
+
+    // Add each row of the matrix to the tree.
+    Descriptor descriptor;
+    for(size_t row = 0; row < rowCount; ++row)
+    {
+      features.get_row(row, descriptor);
+      int leafIndex = find_leaf(descriptor);
+      m_nodes[leafIndex]->m_reservoir.add_example(features, row, labels[row]);
+      m_dirtyNodes.insert(leafIndex);
+      m_classFrequencies.add(labels[row]);
+    }
+
+    // Provided we added at least one example, the tree is now valid if it wasn't already.
+    if(rowCount != 0) m_isValid = true;
+
+    // Update the inverse class weights and recalculate the splittabilities of the nodes to which examples have been added.
+    update_inverse_class_weights();
+    update_dirty_nodes();
+  }
+
   /**
    * \brief Calculates the average leaf entropy in the tree.
    *
@@ -380,6 +435,32 @@ public:
     return totalLeafEntropy / leafCount;
   }
 
+  /**
+   * \brief Finds the leaves to which examples with the specified descriptors would currently be added.
+   *
+   * This is equivalent to calling find_leaf on each descriptor in turn, but works directly on a block of features.
+   *
+   * \param features    A pointer to the features of the first descriptor.
+   * \param count       The number of descriptors.
+   * \param stride      The offset (in floats) between the features of consecutive descriptors.
+   * \param leafIndices An array into which to write the indices of the leaves (must have space for count elements).
+   */
+  void find_leaves(const float *features, size_t count, size_t stride, int *leafIndices) const
+  {
+    const FlatNode *nodes = &m_flatNodes[0];
+    for(size_t i = 0; i < count; ++i)
+    {
+      const float *descriptorFeatures = features + i * stride;
+      int curIndex = m_rootIndex;
+      while(nodes[curIndex].m_leftChildIndex != -1)
+      {
+        const FlatNode& node = nodes[curIndex];
+        curIndex = node.m_splitter->classify_features(descriptorFeatures) == DecisionFunction::DC_LEFT ? node.m_leftChildIndex : node.m_rightChildIndex;
+      }
+      leafIndices[i] = curIndex;
+    }
+  }
+
   /**
    * \brief Gets a histogram holding the class frequencies observed in the training data.
    *
@@ -434,6 +515,17 @@ public:
     return make_pmf(leafIndex);
   }
 
+  /**
+   * \brief Makes a probability mass function for the specified leaf.
+   *
+   * \param leafIndex The leaf for which to make the probability mass function.
+   * \return          The probability mass function.
+   */
+  tvgutil::ProbabilityMassFunction<Label> make_pmf(int leafIndex) const
+  {
+    return tvgutil::ProbabilityMassFunction<Label>(*m_nodes[leafIndex]->m_reservoir.get_histogram(), m_inverseClassWeights);
+  }
+
   /**
    * \brief Outputs the decision tree to a stream.
    *
@@ -525,6 +617,7 @@ private:
   int add_node(size_t depth)
   {
     m_nodes.push_back(Node_Ptr(new Node(depth, m_settings.maxClassSize, m_settings.randomNumberGenerator)));
+    m_flatNodes.push_back(make_flat_node(*m_nodes.back()));
     if(depth > m_treeDepth) m_treeDepth = depth;
 
     int id = static_cast<int>(m_nodes.size()) - 1;
@@ -535,23 +628,25 @@ private:
   }
 
   /**
-   * \brief Fills the specified reservoir with examples sampled from an input set of examples.
+   * \brief Fills the specified reservoir with examples sampled from a subset of the examples in a source reservoir.
    *
-   * \param inputExamples The set of examples from which to sample.
+   * \param inputRows     The rows of the source reservoir's feature matrix that contain the examples from which to sample.
+   * \param source        The source reservoir.
    * \param multipliers   The per-class ratios between the total number of examples seen for a class and the number of examples currently in the source reservoir.
    * \param reservoir     The reservoir to fill.
    */
-  void fill_reservoir(const std::vector<Example_CPtr>& inputExamples, const std::map<Label,float>& multipliers, ExampleReservoir<Label>& reservoir)
+  void fill_reservoir(const std::vector<size_t>& inputRows, const ExampleReservoir<Label>& source, const std::map<Label,float>& multipliers, ExampleReservoir<Label>& reservoir)
   {
-    // Group the input examples by label.
-    std::map<Label,std::vector<Example_CPtr> > inputExamplesByLabel;
-    for(typename std::vector<Example_CPtr>::const_iterator it = inputExamples.begin(), iend = inputExamples.end(); it != iend; ++it)
+    // Group the input rows by label.
+    const std::vector<Label>& labels = source.get_labels();
+    std::map<Label,std::vector<size_t> > inputRowsByLabel;
+    for(std::vector<size_t>::const_iterator it = inputRows.begin(), iend = inputRows.end(); it != iend; ++it)
     {
-      inputExamplesByLabel[(*it)->get_label()].push_back(*it);
+      inputRowsByLabel[labels[*it]].push_back(*it);
     }
 
     // For each group:
-    for(typename std::map<Label,std::vector<Example_CPtr> >::const_iterator it = inputExamplesByLabel.begin(), iend = inputExamplesByLabel.end(); it != iend; ++it)
+    for(typename std::map<Label,std::vector<size_t> >::const_iterator it = inputRowsByLabel.begin(), iend = inputRowsByLabel.end(); it != iend; ++it)
     {
 #if 1
       // Sample the appropriate number of examples (based on the multiplier for the group) and add them to the target reservoir.
@@ -560,16 +655,16 @@ private:
 
       float multiplier = jt->second;
       size_t sampleCount = static_cast<size_t>(it->second.size() * multiplier + 0.5f);
-      std::vector<Example_CPtr> sampledExamples = sample_examples(it->second, sampleCount);
+      std::vector<size_t> sampledRows = sample_rows(it->second, sampleCount);
       for(size_t j = 0; j < sampleCount; ++j)
       {
-        reservoir.add_example(sampledExamples[j]);
+        reservoir.add_example(source, sampledRows[j]);
       }
 #else
       // Simply add all of the examples for the group to the target reservoir (useful for debugging purposes).
       for(size_t j = 0, size = it->second.size(); j < size; ++j)
       {
-        reservoir.add_example(it->second[j]);
+        reservoir.add_example(source, it->second[j]);
       }
 #endif
     }
@@ -603,14 +698,18 @@ private:
   }
 
   /**
-   * \brief Makes a probability mass function for the specified leaf.
+   * \brief Makes a flat node containing the parts of the specified node that are needed to pass descriptors down the tree.
    *
-   * \param leafIndex The leaf for which to make the probability mass function.
-   * \return          The probability mass function.
+   * \param node  The node.
+   * \return      The flat node.
    */
-  tvgutil::ProbabilityMassFunction<Label> make_pmf(int leafIndex) const
+  static FlatNode make_flat_node(const Node& node)
   {
-    return tvgutil::ProbabilityMassFunction<Label>(*m_nodes[leafIndex]->m_reservoir.get_histogram(), m_inverseClassWeights);
+    FlatNode flatNode;
+    flatNode.m_leftChildIndex = node.m_leftChildIndex;
+    flatNode.m_rightChildIndex = node.m_rightChildIndex;
+    flatNode.m_splitter = node.m_splitter.get();
+    return flatNode;
   }
 
   /**
@@ -638,21 +737,22 @@ private:
   }
 
   /**
-   * \brief Randomly samples sampleCount examples (with replacement) from the specified set of input examples.
+   * \brief Randomly samples sampleCount rows (with replacement) from the specified set of input rows.
    *
-   * \param inputExamples The set of examples from which to sample.
-   * \param sampleCount   The number of samples to choose.
-   * \return              The chosen set of examples.
+   * \param inputRows   The set of rows from which to sample.
+   * \param sampleCount The number of samples to choose.
+   * \return            The chosen set of rows.
    */
-  std::vector<Example_CPtr> sample_examples(const std::vector<Example_CPtr>& inputExamples, size_t sampleCount)
+  std::vector<size_t> sample_rows(const std::vector<size_t>& inputRows, size_t sampleCount)
   {
-    std::vector<Example_CPtr> outputExamples;
+    std::vector<size_t> outputRows;
+    outputRows.reserve(sampleCount);
     for(size_t i = 0; i < sampleCount; ++i)
     {
-      int exampleIndex = m_settings.randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(inputExamples.size()) - 1);
-      outputExamples.push_back(inputExamples[exampleIndex]);
+      int rowIndex = m_settings.randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(inputRows.size()) - 1);
+      outputRows.push_back(inputRows[rowIndex]);
     }
-    return outputExamples;
+    return outputRows;
   }
 
   /**
@@ -680,9 +780,10 @@ private:
     size_t childDepth = n.m_depth + 1;
     n.m_leftChildIndex = add_node(childDepth);
     n.m_rightChildIndex = add_node(childDepth);
+    m_flatNodes[nodeIndex] = make_flat_node(n);
     std::map<Label,float> multipliers = n.m_reservoir.get_class_multipliers();
-    fill_reservoir(split->m_leftExamples, multipliers, m_nodes[n.m_leftChildIndex]->m_reservoir);
-    fill_reservoir(split->m_rightExamples, multipliers, m_nodes[n.m_rightChildIndex]->m_reservoir);
+    fill_reservoir(split->m_leftRows, n.m_reservoir, multipliers, m_nodes[n.m_leftChildIndex]->m_reservoir);
+    fill_reservoir(split->m_rightRows, n.m_reservoir, multipliers, m_nodes[n.m_rightChildIndex]->m_reservoir);
 
     // Update the splittability for the child nodes.
     update_splittability(n.m_leftChildIndex);
@@ -740,8 +841,8 @@ private:
 
     float count = static_cast<float>(m_classFrequencies.get_count());
 
-    const std::map<Label,size_t>& bins = m_classFrequencies.get_bins();
-    for(typename std::map<Label,size_t>::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    const typename tvgutil::Histogram<Label>::Bins& bins = m_classFrequencies.get_bins();
+    for(typename tvgutil::Histogram<Label>::Bins::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
     {
       (*m_inverseClassWeights)[it->first] = count / it->second;
     }
@@ -767,6 +868,16 @@ private:
     ar & m_settings;
     ar & m_splittabilityQueue;
     ar & m_treeDepth;
+
+    // The flat node array is not serialized, so rebuild it from the nodes when loading the tree.
+    if(Archive::is_loading::value)
+    {
+      m_flatNodes.clear();
+      for(size_t i = 0, size = m_nodes.size(); i < size; ++i)
+      {
+        m_flatNodes.push_back(make_flat_node(*m_nodes[i]));
+      }
+    }
   }
 
   friend class boost::serialization::access;
@@ -6,6 +6,12 @@
 #ifndef H_RAFL_RANDOMFOREST
 #define H_RAFL_RANDOMFOREST
 
+#include <algorithm>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
 #include "DecisionTree.h"
 
 namespace rafl {
@@ -88,6 +94,22 @@ public:
     }
   }
 
+  /**
+   * \brief Adds new training examples whose descriptors are stored in the rows of a feature matrix to the forest.
+   *
+   * \param features            A feature matrix containing the descriptors of the examples, one per row.
+   * \param labels              The labels of the examples (the label of the example in row r of the matrix is labels[r]).
+   * \throws std::runtime_error If the numbers of rows and labels differ.
+   */
+  void add_examples(const FeatureMatrix& features, const std::vector<Label>& labels)
+  {
+    // Add the new examples to the different trees.
+    for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
+    {
+      (*it)->add_examples(features, labels);
+    }
+  }
+
   /**
    * \brief Calculates an overall forest PMF for the specified descriptor.
    *
@@ -99,12 +121,12 @@ public:
   tvgutil::ProbabilityMassFunction<Label> calculate_pmf(const Descriptor_CPtr& descriptor) const
   {
     // Sum the masses from the individual tree PMFs for the descriptor.
-    std::map<Label,float> masses;
+    typename tvgutil::ProbabilityMassFunction<Label>::Masses masses;
     for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
     {
       tvgutil::ProbabilityMassFunction<Label> individualPMF = (*it)->lookup_pmf(descriptor);
-      const std::map<Label,float>& individualMasses = individualPMF.get_masses();
-      for(typename std::map<Label,float>::const_iterator jt = individualMasses.begin(), jend = individualMasses.end(); jt != jend; ++jt)
+      const typename tvgutil::ProbabilityMassFunction<Label>::Masses& individualMasses = individualPMF.get_masses();
+      for(typename tvgutil::ProbabilityMassFunction<Label>::Masses::const_iterator jt = individualMasses.begin(), jend = individualMasses.end(); jt != jend; ++jt)
       {
         masses[jt->first] += jt->second;
       }
@@ -198,6 +220,116 @@ public:
     return calculate_pmf(descriptor).calculate_best_label();
   }
 
+  /**
+   * \brief Predicts labels for a batch of descriptors whose features are stored in a contiguous block of memory.
+   *
+   * This yields the same labels as calling predict on each descriptor in turn, but is much cheaper: the descriptors
+   * do not need to be copied into individual Descriptor objects, they are passed down all of the trees a tile at a
+   * time using the trees' flat node arrays, the PMF for each leaf that is reached is computed only once per batch,
+   * and the votes from the different trees are accumulated in dense per-label arrays rather than maps.
+   *
+   * \param features  A pointer to the features of the first descriptor.
+   * \param count     The number of descriptors.
+   * \param stride    The offset (in floats) between the features of consecutive descriptors.
+   * \param out       An array into which to write the predicted labels (must have space for count elements).
+   */
+  void predict(const float *features, size_t count, size_t stride, Label *out) const
+  {
+    const size_t treeCount = m_trees.size();
+    if(count == 0 || treeCount == 0) return;
+
+    // Find the leaves reached by the descriptors in each of the trees. The descriptors are processed in tiles so that
+    // the features for a tile stay in the cache whilst they are passed down all of the trees. The leaf indices for
+    // each tree t are stored contiguously, starting at leafIndices[t * count].
+    const int tileSize = 64;
+    const int tileCount = static_cast<int>((count + tileSize - 1) / tileSize);
+    std::vector<int> leafIndices(treeCount * count);
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel for
+#endif
+    for(int tileIndex = 0; tileIndex < tileCount; ++tileIndex)
+    {
+      const size_t tileBegin = static_cast<size_t>(tileIndex) * tileSize;
+      const size_t tileEnd = std::min(tileBegin + tileSize, count);
+      for(size_t t = 0; t < treeCount; ++t)
+      {
+        m_trees[t]->find_leaves(features + tileBegin * stride, tileEnd - tileBegin, stride, &leafIndices[t * count + tileBegin]);
+      }
+    }
+
+    // Make the PMFs for the leaves that were reached (once each), and replace each leaf index with the index of the
+    // corresponding PMF. At the same time, determine the set of labels that can be predicted.
+    std::vector<tvgutil::ProbabilityMassFunction<Label> > leafPMFs;
+    std::set<Label> labelSet;
+    for(size_t t = 0; t < treeCount; ++t)
+    {
+      std::vector<int> pmfIndices(m_trees[t]->get_node_count(), -1);
+      for(int *leafIndex = &leafIndices[t * count], *end = leafIndex + count; leafIndex != end; ++leafIndex)
+      {
+        int& pmfIndex = pmfIndices[*leafIndex];
+        if(pmfIndex == -1)
+        {
+          pmfIndex = static_cast<int>(leafPMFs.size());
+          leafPMFs.push_back(m_trees[t]->make_pmf(*leafIndex));
+
+          const typename tvgutil::ProbabilityMassFunction<Label>::Masses& masses = leafPMFs.back().get_masses();
+          for(typename tvgutil::ProbabilityMassFunction<Label>::Masses::const_iterator it = masses.begin(), iend = masses.end(); it != iend; ++it)
+          {
+            labelSet.insert(it->first);
+          }
+        }
+
+        *leafIndex = pmfIndex;
+      }
+    }
+
+    // Convert the PMFs into a dense table of per-label masses (with the labels in ascending order).
+    const std::vector<Label> labels(labelSet.begin(), labelSet.end());
+    const size_t labelCount = labels.size();
+    std::vector<float> leafMasses(leafPMFs.size() * labelCount, 0.0f);
+    for(size_t i = 0, size = leafPMFs.size(); i < size; ++i)
+    {
+      const typename tvgutil::ProbabilityMassFunction<Label>::Masses& masses = leafPMFs[i].get_masses();
+      for(typename tvgutil::ProbabilityMassFunction<Label>::Masses::const_iterator it = masses.begin(), iend = masses.end(); it != iend; ++it)
+      {
+        const size_t labelIndex = std::lower_bound(labels.begin(), labels.end(), it->first) - labels.begin();
+        leafMasses[i * labelCount + labelIndex] = it->second;
+      }
+    }
+
+    // Sum the masses from the trees for each descriptor, normalise them and pick the label with the highest mass. This
+    // is done in exactly the same order as in calculate_pmf and calculate_best_label, so the results match those of predict.
+#ifdef WITH_OPENMP
+    #pragma omp parallel
+#endif
+    {
+      std::vector<float> votes(labelCount);
+
+#ifdef WITH_OPENMP
+      #pragma omp for
+#endif
+      for(int i = 0; i < static_cast<int>(count); ++i)
+      {
+        std::fill(votes.begin(), votes.end(), 0.0f);
+        for(size_t t = 0; t < treeCount; ++t)
+        {
+          const float *masses = &leafMasses[leafIndices[t * count + i] * labelCount];
+          for(size_t k = 0; k < labelCount; ++k)
+          {
+            votes[k] += masses[k];
+          }
+        }
+
+        float sum = 0.0f;
+        for(size_t k = 0; k < labelCount; ++k) sum += votes[k];
+        for(size_t k = 0; k < labelCount; ++k) votes[k] /= sum;
+
+        out[i] = labels[tvgutil::ArgUtil::argmax(votes)];
+      }
+    }
+  }
+
   /**
    * \brief Resets the specified tree.
    *
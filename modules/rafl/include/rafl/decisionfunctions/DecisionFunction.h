@@ -7,6 +7,7 @@
 #define H_RAFL_DECISIONFUNCTION
 
 #include <iosfwd>
+#include <vector>
 
 /*
 Note: It is CRUCIALLY IMPORTANT that the archive headers are included before the points at which we invoke BOOST_CLASS_EXPORT
@@ -21,7 +22,7 @@ header to avoid inadvertent mistakes.
 #include <boost/serialization/export.hpp>
 #include <boost/serialization/serialization.hpp>
 
-#include "../base/Descriptor.h"
+#include "../base/FeatureMatrix.h"
 
 namespace rafl {
 
@@ -59,6 +60,16 @@ public:
    */
   virtual DescriptorClassification classify_descriptor(const Descriptor& descriptor) const = 0;
 
+  /**
+   * \brief Classifies the descriptor whose features are stored in the specified array using the decision function.
+   *
+   * This allows descriptors to be classified directly from a block of features, without first copying them into a Descriptor.
+   *
+   * \param features  A pointer to the features of the descriptor to classify.
+   * \return          DC_LEFT, if the descriptor should be sent down the left subtree of the node, or DC_RIGHT otherwise.
+   */
+  virtual DescriptorClassification classify_features(const float *features) const = 0;
+
   /**
    * \brief Outputs the decision function to the specified stream.
    *
@@ -66,6 +77,30 @@ public:
    */
   virtual void output(std::ostream& os) const = 0;
 
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Classifies each row of the specified feature matrix using the decision function.
+   *
+   * The default implementation simply extracts each row into a descriptor and classifies it. Derived decision functions
+   * that only look at a small number of features should override this to scan the relevant columns directly.
+   *
+   * \param features        The feature matrix whose rows we want to classify.
+   * \param classifications A vector into which to write the classifications (this will be resized as necessary).
+   */
+  virtual void classify_rows(const FeatureMatrix& features, std::vector<DescriptorClassification>& classifications) const
+  {
+    const size_t rowCount = features.get_row_count();
+    classifications.resize(rowCount);
+
+    Descriptor descriptor;
+    for(size_t i = 0; i < rowCount; ++i)
+    {
+      features.get_row(i, descriptor);
+      classifications[i] = classify_descriptor(descriptor);
+    }
+  }
+
   //#################### SERIALIZATION #################### 
 private:
   /**
@@ -6,6 +6,8 @@
 #ifndef H_RAFL_DECISIONFUNCTIONGENERATOR
 #define H_RAFL_DECISIONFUNCTIONGENERATOR
 
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
 #ifdef WITH_OPENMP
@@ -25,10 +27,6 @@ namespace rafl {
 template <typename Label>
 class DecisionFunctionGenerator
 {
-  //#################### PROTECTED TYPEDEFS ####################
-protected:
-  typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
-
   //#################### NESTED TYPES ####################
 public:
   /**
@@ -40,11 +38,11 @@ public:
     /** The decision function that induced the split. */
     DecisionFunction_Ptr m_decisionFunction;
 
-    /** The examples that were sent left by the decision function. */
-    std::vector<Example_CPtr> m_leftExamples;
+    /** The rows of the split reservoir's feature matrix that contain the examples that were sent left by the decision function. */
+    std::vector<size_t> m_leftRows;
 
-    /** The examples that were sent right by the decision function. */
-    std::vector<Example_CPtr> m_rightExamples;
+    /** The rows of the split reservoir's feature matrix that contain the examples that were sent right by the decision function. */
+    std::vector<size_t> m_rightRows;
   };
 
   //#################### PUBLIC TYPEDEFS ####################
@@ -54,8 +52,8 @@ public:
 
   //#################### PRIVATE VARIABLES ####################
 private:
-  /* The split candidates. */
-  mutable std::vector<Split> m_splitCandidates;
+  /* The candidate decision functions. */
+  mutable std::vector<DecisionFunction_Ptr> m_candidateDecisionFunctions;
 
   //#################### DESTRUCTOR ####################
 public:
@@ -69,11 +67,11 @@ public:
   /**
    * \brief Generates a candidate decision function to split the specified set of examples.
    *
-   * \param examples              The examples to split.
+   * \param features              A feature matrix containing the descriptors of the examples to split, one per row.
    * \param randomNumberGenerator A random number generator.
    * \return                      The candidate decision function.
    */
-  virtual DecisionFunction_Ptr generate_candidate_decision_function(const std::vector<Example_CPtr>& examples, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const = 0;
+  virtual DecisionFunction_Ptr generate_candidate_decision_function(const FeatureMatrix& features, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const = 0;
 
   /**
    * \brief Gets the parameters of the decision function generator as a string.
@@ -94,6 +92,9 @@ public:
   /**
    * \brief Tries to pick an appropriate way in which to split the specified reservoir of examples.
    *
+   * The split candidates are scored using only per-class counts of the examples they send left and right,
+   * so the examples themselves are only partitioned (by row index) for the candidate that is chosen.
+   *
    * \param reservoir             The reservoir of examples to split.
    * \param candidateCount        The number of candidates to evaluate.
    * \param gainThreshold         The minimum information gain that must be obtained from a split to make it worthwhile.
@@ -104,106 +105,170 @@ public:
   Split_CPtr split_examples(const ExampleReservoir<Label>& reservoir, int candidateCount, float gainThreshold, const boost::optional<std::map<Label,float> >& inverseClassWeights,
                             const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const
   {
-    std::vector<Example_CPtr> examples = reservoir.get_examples();
+    const FeatureMatrix& features = reservoir.get_features();
+    const std::vector<Label>& labels = reservoir.get_labels();
+    const size_t rowCount = labels.size();
     float initialEntropy = ExampleUtil::calculate_entropy(*reservoir.get_histogram(), inverseClassWeights);
 
 #if 0
     std::cout << "\nP: " << *reservoir.get_histogram() << ' ' << initialEntropy << '\n';
 #endif
 
-    // Generate the split candidates.
-    if(static_cast<int>(m_splitCandidates.size()) != candidateCount) m_splitCandidates.resize(candidateCount);
+    // Assign a dense index to each class in the reservoir, and look up the multiplier for each class. Classes that do
+    // not have a multiplier are left unscaled (as in ProbabilityMassFunction).
+    std::map<Label,float> multipliers = reservoir.get_class_multipliers();
+    if(inverseClassWeights) multipliers = combine_multipliers(multipliers, *inverseClassWeights);
+
+    std::map<Label,size_t> classIndices;
+    std::vector<float> classMultipliers;
+    const typename tvgutil::Histogram<Label>::Bins& bins = reservoir.get_histogram()->get_bins();
+    for(typename tvgutil::Histogram<Label>::Bins::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    {
+      typename std::map<Label,float>::const_iterator jt = multipliers.find(it->first);
+      classIndices.insert(std::make_pair(it->first, classMultipliers.size()));
+      classMultipliers.push_back(jt != multipliers.end() ? jt->second : 1.0f);
+    }
+
+    const size_t classCount = classMultipliers.size();
+    std::vector<size_t> rowClasses(rowCount);
+    for(size_t j = 0; j < rowCount; ++j)
+    {
+      rowClasses[j] = classIndices.find(labels[j])->second;
+    }
+
+    // Generate the candidate decision functions.
+    if(static_cast<int>(m_candidateDecisionFunctions.size()) != candidateCount) m_candidateDecisionFunctions.resize(candidateCount);
     for(int i = 0; i < candidateCount; ++i)
     {
-      m_splitCandidates[i].m_decisionFunction = generate_candidate_decision_function(examples, randomNumberGenerator);
+      m_candidateDecisionFunctions[i] = generate_candidate_decision_function(features, randomNumberGenerator);
     }
 
-    // Pick the best split candidate and return it.
+    // Pick the best split candidate.
     float bestGain = static_cast<float>(INT_MIN);
     int bestIndex = -1;
 
 #ifdef WITH_OPENMP
-    #pragma omp parallel for
+    #pragma omp parallel
 #endif
-    for(int i = 0; i < candidateCount; ++i)
     {
-#if 0 && WITH_OPENMP
-      int threadID = omp_get_thread_num();
-      int threadCount = omp_get_num_threads();
-      std::cout << "threadID=" << threadID << " threadCount=" << threadCount << '\n';
-#endif
+      // Each thread classifies the examples and accumulates the per-class counts in its own scratch space.
+      std::vector<DecisionFunction::DescriptorClassification> classifications;
+      std::vector<size_t> leftCounts(classCount), rightCounts(classCount);
 
+#ifdef WITH_OPENMP
+      #pragma omp for
+#endif
+      for(int i = 0; i < candidateCount; ++i)
+      {
 #if 0
-      std::cout << *splitCandidate->m_decisionFunction << '\n';
+        std::cout << *m_candidateDecisionFunctions[i] << '\n';
 #endif
 
-      // Partition the examples using the split candidate's decision function.
-      m_splitCandidates[i].m_leftExamples.clear();
-      m_splitCandidates[i].m_rightExamples.clear();
-      for(size_t j = 0, size = examples.size(); j < size; ++j)
-      {
-        if(m_splitCandidates[i].m_decisionFunction->classify_descriptor(*examples[j]->get_descriptor()) == DecisionFunction::DC_LEFT)
-        {
-          m_splitCandidates[i].m_leftExamples.push_back(examples[j]);
-        }
-        else
+        // Count the examples of each class that the candidate's decision function would send left and right.
+        m_candidateDecisionFunctions[i]->classify_rows(features, classifications);
+
+        std::fill(leftCounts.begin(), leftCounts.end(), 0);
+        std::fill(rightCounts.begin(), rightCounts.end(), 0);
+        size_t leftCount = 0;
+        for(size_t j = 0; j < rowCount; ++j)
         {
-          m_splitCandidates[i].m_rightExamples.push_back(examples[j]);
+          if(classifications[j] == DecisionFunction::DC_LEFT)
+          {
+            ++leftCounts[rowClasses[j]];
+            ++leftCount;
+          }
+          else ++rightCounts[rowClasses[j]];
         }
-      }
 
-      // Calculate the information gain we would obtain from this split.
-      float gain = calculate_information_gain(reservoir, initialEntropy, m_splitCandidates[i].m_leftExamples, m_splitCandidates[i].m_rightExamples, inverseClassWeights);
+        const size_t rightCount = rowCount - leftCount;
+
+        // Calculate the information gain we would obtain from this split.
+        float gain = calculate_information_gain(initialEntropy, leftCounts, leftCount, rightCounts, rightCount, classMultipliers);
 
 #ifdef WITH_OPENMP
-      #pragma omp critical
+        #pragma omp critical
 #endif
-      {
-        if(gain > bestGain)
         {
-          if(gain > gainThreshold && !m_splitCandidates[i].m_leftExamples.empty() && !m_splitCandidates[i].m_rightExamples.empty())
+          if(gain > bestGain)
           {
-            bestGain = gain;
-            bestIndex = i;
+            if(gain > gainThreshold && leftCount != 0 && rightCount != 0)
+            {
+              bestGain = gain;
+              bestIndex = i;
+            }
           }
         }
       }
     }
 
+    // Return a split candidate that had maximum gain (note that this may be NULL if no split had a high enough gain).
     Split_Ptr bestSplitCandidate;
-    if(bestIndex != -1) bestSplitCandidate.reset(new Split(m_splitCandidates[bestIndex]));
+    if(bestIndex != -1)
+    {
+      bestSplitCandidate.reset(new Split);
+      bestSplitCandidate->m_decisionFunction = m_candidateDecisionFunctions[bestIndex];
+
+      // Partition the examples (by row index) using the chosen decision function.
+      std::vector<DecisionFunction::DescriptorClassification> classifications;
+      bestSplitCandidate->m_decisionFunction->classify_rows(features, classifications);
+      for(size_t j = 0; j < rowCount; ++j)
+      {
+        if(classifications[j] == DecisionFunction::DC_LEFT) bestSplitCandidate->m_leftRows.push_back(j);
+        else bestSplitCandidate->m_rightRows.push_back(j);
+      }
+    }
 
-    // Return a split candidate that had maximum gain (note that this may be NULL if no split had a high enough gain).
     return bestSplitCandidate;
   }
 
   //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Calculates the information gain that results from splitting an example reservoir in a particular way.
+   * \brief Calculates the entropy of a label distribution represented by a set of per-class counts.
    *
-   * \param reservoir           The reservoir.
-   * \param initialEntropy      The entropy of the example set before the split.
-   * \param leftExamples        The examples that end up in the left half of the split.
-   * \param rightExamples       The examples that end up in the right half of the split.
-   * \param inverseClassWeights The (optional) inverses of the L1-normalised class frequencies observed in the training data.
-   * \return                    The information gain resulting from the split.
+   * \param counts      The number of examples of each class.
+   * \param multipliers The per-class ratios that should be used to scale the probabilities for the different classes.
+   * \return            The entropy of the label distribution.
    */
-  static float calculate_information_gain(const ExampleReservoir<Label>& reservoir, float initialEntropy, const std::vector<Example_CPtr>& leftExamples, const std::vector<Example_CPtr>& rightExamples, const boost::optional<std::map<Label,float> >& inverseClassWeights)
+  static float calculate_entropy(const std::vector<size_t>& counts, const std::vector<float>& multipliers)
   {
-    float exampleCount = static_cast<float>(reservoir.current_size());
-    std::map<Label,float> multipliers = reservoir.get_class_multipliers();
-    if(inverseClassWeights) multipliers = combine_multipliers(multipliers, *inverseClassWeights);
+    float totalMass = 0.0f;
+    for(size_t c = 0, classCount = counts.size(); c < classCount; ++c)
+    {
+      totalMass += counts[c] * multipliers[c];
+    }
 
-    float leftEntropy = ExampleUtil::calculate_entropy(leftExamples, multipliers);
-    float rightEntropy = ExampleUtil::calculate_entropy(rightExamples, multipliers);
-    float leftWeight = leftExamples.size() / exampleCount;
-    float rightWeight = rightExamples.size() / exampleCount;
+    if(totalMass <= 0.0f) return 0.0f;
 
-#if 0
-    std::cout << "L: " << ExampleUtil::make_histogram(leftExamples) << ' ' << leftEntropy << '\n';
-    std::cout << "R: " << ExampleUtil::make_histogram(rightExamples) << ' ' << rightEntropy << '\n';
-#endif
+    float entropy = 0.0f;
+    for(size_t c = 0, classCount = counts.size(); c < classCount; ++c)
+    {
+      float mass = counts[c] * multipliers[c] / totalMass;
+      if(mass > 0) entropy += mass * log2(mass);
+    }
+
+    return -entropy;
+  }
+
+  /**
+   * \brief Calculates the information gain that results from splitting an example reservoir in a particular way.
+   *
+   * \param initialEntropy  The entropy of the example set before the split.
+   * \param leftCounts      The number of examples of each class that end up in the left half of the split.
+   * \param leftCount       The total number of examples that end up in the left half of the split.
+   * \param rightCounts     The number of examples of each class that end up in the right half of the split.
+   * \param rightCount      The total number of examples that end up in the right half of the split.
+   * \param multipliers     The per-class ratios that should be used to scale the probabilities for the different classes.
+   * \return                The information gain resulting from the split.
+   */
+  static float calculate_information_gain(float initialEntropy, const std::vector<size_t>& leftCounts, size_t leftCount,
+                                          const std::vector<size_t>& rightCounts, size_t rightCount, const std::vector<float>& multipliers)
+  {
+    float exampleCount = static_cast<float>(leftCount + rightCount);
+    float leftEntropy = calculate_entropy(leftCounts, multipliers);
+    float rightEntropy = calculate_entropy(rightCounts, multipliers);
+    float leftWeight = leftCount / exampleCount;
+    float rightWeight = rightCount / exampleCount;
 
     float gain = initialEntropy - (leftWeight * leftEntropy + rightWeight * rightEntropy);
 
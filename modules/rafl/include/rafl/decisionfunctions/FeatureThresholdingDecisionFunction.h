@@ -48,6 +48,12 @@ public:
   /** Override */
   virtual DescriptorClassification classify_descriptor(const Descriptor& descriptor) const;
 
+  /** Override */
+  virtual DescriptorClassification classify_features(const float *features) const;
+
+  /** Override */
+  virtual void classify_rows(const FeatureMatrix& features, std::vector<DescriptorClassification>& classifications) const;
+
   /** Override */
   virtual void output(std::ostream& os) const;
 
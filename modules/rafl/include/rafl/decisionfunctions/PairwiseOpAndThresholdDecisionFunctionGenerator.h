@@ -22,10 +22,9 @@ namespace rafl {
 template <typename Label>
 class PairwiseOpAndThresholdDecisionFunctionGenerator : public FeatureBasedDecisionFunctionGenerator<Label>
 {
-  //#################### TYPEDEFS AND USINGS ####################
+  //#################### TYPEDEFS ####################
 private:
   typedef boost::shared_ptr<DecisionFunctionGenerator<Label> > DecisionFunctionGenerator_Ptr;
-  using typename DecisionFunctionGenerator<Label>::Example_CPtr;
 
   //#################### CONSTRUCTORS ####################
 public:
@@ -65,11 +64,11 @@ public:
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /** Override */
-  virtual DecisionFunction_Ptr generate_candidate_decision_function(const std::vector<Example_CPtr>& examples, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const
+  virtual DecisionFunction_Ptr generate_candidate_decision_function(const FeatureMatrix& features, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const
   {
-    assert(!examples.empty());
+    assert(features.get_row_count() != 0);
 
-    int descriptorSize = static_cast<int>(examples[0]->get_descriptor()->size());
+    int descriptorSize = static_cast<int>(features.get_feature_count());
     std::pair<int,int> featureIndexRange = this->get_feature_index_range(descriptorSize);
 
     // Pick the first random feature in the descriptor.
@@ -85,9 +84,8 @@ public:
     // Select an appropriate threshold by picking a random example and using
     // the result of applying the pairwise operation to the chosen features
     // from that example as the threshold.
-    int exampleIndex = randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(examples.size()) - 1);
-    const Descriptor& descriptor = (*examples[exampleIndex]->get_descriptor());
-    float threshold = PairwiseOpAndThresholdDecisionFunction::apply_op(op, descriptor[firstFeatureIndex], descriptor[secondFeatureIndex]);
+    int exampleIndex = randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(features.get_row_count()) - 1);
+    float threshold = PairwiseOpAndThresholdDecisionFunction::apply_op(op, features.get_value(exampleIndex, firstFeatureIndex), features.get_value(exampleIndex, secondFeatureIndex));
 
     return DecisionFunction_Ptr(new PairwiseOpAndThresholdDecisionFunction(
       firstFeatureIndex,
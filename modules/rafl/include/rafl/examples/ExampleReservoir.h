@@ -6,16 +6,17 @@
 #ifndef H_RAFL_EXAMPLERESERVOIR
 #define H_RAFL_EXAMPLERESERVOIR
 
-#include <algorithm>
 #include <cassert>
 #include <iosfwd>
-#include <iterator>
 #include <map>
 #include <vector>
 
+#include <boost/optional.hpp>
+
 #include <tvgutil/numbers/RandomNumberGenerator.h>
 #include <tvgutil/statistics/Histogram.h>
 
+#include "../base/FeatureMatrix.h"
 #include "Example.h"
 
 namespace rafl {
@@ -34,21 +35,24 @@ private:
 
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The total number of examples currently in the reservoir. */
-  size_t m_curSize;
-
-  /** The examples in the reservoir. */
-  std::map<Label,std::vector<Example_CPtr> > m_examples;
+  /** The feature descriptors of the examples in the reservoir, one per row. */
+  FeatureMatrix m_features;
 
   /** The histogram of the label distribution of all of the examples that have ever been added to the reservoir. */
   Histogram_Ptr m_histogram;
 
+  /** The labels of the examples in the reservoir (the label of the example in row r of the feature matrix is m_labels[r]). */
+  std::vector<Label> m_labels;
+
   /** The maximum number of examples of each class allowed in the reservoir at any one time. */
   size_t m_maxClassSize;
 
   /** A random number generator. */
   tvgutil::RandomNumberGenerator_Ptr m_randomNumberGenerator;
 
+  /** The rows of the feature matrix that contain the examples for each class. */
+  std::map<Label,std::vector<size_t> > m_rowsByClass;
+
   /** The total number of examples that have been added to the reservoir over time. */
   size_t m_seenExamples;
 
@@ -64,7 +68,7 @@ public:
    * \param randomNumberGenerator A random number generator.
    */
   ExampleReservoir(size_t maxClassSize, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator)
-  : m_curSize(0), m_histogram(new tvgutil::Histogram<Label>), m_maxClassSize(maxClassSize), m_randomNumberGenerator(randomNumberGenerator), m_seenExamples(0)
+  : m_histogram(new tvgutil::Histogram<Label>), m_maxClassSize(maxClassSize), m_randomNumberGenerator(randomNumberGenerator), m_seenExamples(0)
   {}
 
   /**
@@ -88,31 +92,43 @@ public:
    */
   bool add_example(const Example_CPtr& example)
   {
-    bool changed = false;
+    const Descriptor& descriptor = *example->get_descriptor();
+    boost::optional<size_t> row = allocate_row(example->get_label(), descriptor.size());
+    if(row && !descriptor.empty()) m_features.set_row(*row, &descriptor[0]);
+    return row != boost::none;
+  }
 
-    std::vector<Example_CPtr>& examplesForClass = m_examples[example->get_label()];
-    if(examplesForClass.size() < m_maxClassSize)
-    {
-      // If we haven't yet reached the maximum number of examples for this class, simply add the new one.
-      examplesForClass.push_back(example);
-      ++m_curSize;
-      changed = true;
-    }
-    else
-    {
-      // Otherwise, randomly decide whether or not to replace one of the existing examples for this class with the new one.
-      size_t binSize = m_histogram->get_bins().find(example->get_label())->second;
-      size_t k = m_randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(binSize) - 1);
-      if(k < examplesForClass.size())
-      {
-        examplesForClass[k] = example;
-        changed = true;
-      }
-    }
+  /**
+   * \brief Adds an example that is stored in another reservoir to this one.
+   *
+   * This behaves in exactly the same way as adding the example itself, but copies the example's features
+   * directly from the source reservoir's feature matrix rather than going via a separate descriptor.
+   *
+   * \param source  The reservoir containing the example.
+   * \param row     The row of the source reservoir's feature matrix that contains the example.
+   * \return        true, if the example was actually added to the reservoir, or false otherwise.
+   */
+  bool add_example(const ExampleReservoir& source, size_t row)
+  {
+    return add_example(source.m_features, row, source.m_labels[row]);
+  }
 
-    m_histogram->add(example->get_label());
-    ++m_seenExamples;
-    return changed;
+  /**
+   * \brief Adds an example whose descriptor is stored in a row of a feature matrix to the reservoir.
+   *
+   * This behaves in exactly the same way as adding the example itself, but copies the example's features
+   * directly from the feature matrix rather than going via a separate descriptor.
+   *
+   * \param features  The feature matrix containing the example's descriptor.
+   * \param row       The row of the feature matrix that contains the example's descriptor.
+   * \param label     The example's label.
+   * \return          true, if the example was actually added to the reservoir, or false otherwise.
+   */
+  bool add_example(const FeatureMatrix& features, size_t row, const Label& label)
+  {
+    boost::optional<size_t> targetRow = allocate_row(label, features.get_feature_count());
+    if(targetRow) m_features.set_row(*targetRow, features, row);
+    return targetRow != boost::none;
   }
 
   /**
@@ -120,9 +136,11 @@ public:
    */
   void clear()
   {
-    m_examples.clear();
+    m_features.clear();
     m_histogram.reset();
+    std::vector<Label>().swap(m_labels);
     m_randomNumberGenerator.reset();
+    m_rowsByClass.clear();
   }
 
   /**
@@ -132,7 +150,7 @@ public:
    */
   size_t current_size() const
   {
-    return m_curSize;
+    return m_labels.size();
   }
 
   /**
@@ -144,9 +162,9 @@ public:
   {
     std::map<Label,float> result;
 
-    const std::map<Label,size_t>& bins = m_histogram->get_bins();
-    typename std::map<Label,std::vector<Example_CPtr> >::const_iterator it = m_examples.begin(), iend = m_examples.end();
-    typename std::map<Label,size_t>::const_iterator jt = bins.begin();
+    const typename tvgutil::Histogram<Label>::Bins& bins = m_histogram->get_bins();
+    typename std::map<Label,std::vector<size_t> >::const_iterator it = m_rowsByClass.begin(), iend = m_rowsByClass.end();
+    typename tvgutil::Histogram<Label>::Bins::const_iterator jt = bins.begin();
     for(; it != iend; ++it, ++jt)
     {
       assert(it->first == jt->first);
@@ -157,19 +175,13 @@ public:
   }
 
   /**
-   * \brief Gets the examples currently in the reservoir.
+   * \brief Gets the feature descriptors of the examples currently in the reservoir.
    *
-   * \return  The examples currently in the reservoir.
+   * \return  A feature matrix containing the descriptors of the examples currently in the reservoir, one per row.
    */
-  std::vector<Example_CPtr> get_examples() const
+  const FeatureMatrix& get_features() const
   {
-    std::vector<Example_CPtr> examples;
-    examples.reserve(m_curSize);
-    for(typename std::map<Label,std::vector<Example_CPtr> >::const_iterator it = m_examples.begin(), iend = m_examples.end(); it != iend; ++it)
-    {
-      std::copy(it->second.begin(), it->second.end(), std::back_inserter(examples));
-    }
-    return examples;
+    return m_features;
   }
 
   /**
@@ -182,6 +194,16 @@ public:
     return m_histogram;
   }
 
+  /**
+   * \brief Gets the labels of the examples currently in the reservoir.
+   *
+   * \return  The labels of the examples currently in the reservoir (the i'th label corresponds to the i'th row of the feature matrix).
+   */
+  const std::vector<Label>& get_labels() const
+  {
+    return m_labels;
+  }
+
   /**
    * \brief Gets the total number of examples that have been added to the reservoir over time.
    *
@@ -192,8 +214,46 @@ public:
     return m_seenExamples;
   }
 
-  //#################### STREAM OPERATORS ####################
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Decides where (if anywhere) to store a new example with the specified label in the reservoir.
+   *
+   * If there is still space for another example of the relevant class, a new row is appended to the feature matrix.
+   * Otherwise, the row of a randomly-chosen existing example of that class may be reused, or the new example may be
+   * discarded. In all cases, the reservoir's histogram and count of seen examples are updated.
+   *
+   * \param label         The label of the new example.
+   * \param featureCount  The number of features in the new example's descriptor.
+   * \return              The row into which the new example's features should be written, if any, or boost::none otherwise.
+   */
+  boost::optional<size_t> allocate_row(const Label& label, size_t featureCount)
+  {
+    boost::optional<size_t> row;
 
+    std::vector<size_t>& rowsForClass = m_rowsByClass[label];
+    if(rowsForClass.size() < m_maxClassSize)
+    {
+      // If we haven't yet reached the maximum number of examples for this class, simply add the new one.
+      row = m_features.add_row(featureCount);
+      m_labels.push_back(label);
+      rowsForClass.push_back(*row);
+    }
+    else
+    {
+      // Otherwise, randomly decide whether or not to replace one of the existing examples for this class with the new one.
+      size_t binSize = m_histogram->get_bins().find(label)->second;
+      size_t k = m_randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(binSize) - 1);
+      if(k < rowsForClass.size()) row = rowsForClass[k];
+    }
+
+    m_histogram->add(label);
+    ++m_seenExamples;
+    return row;
+  }
+
+  //#################### STREAM OPERATORS ####################
+public:
   /**
    * \brief Outputs a reservoir to a stream.
    *
@@ -203,9 +263,9 @@ public:
    */
   friend std::ostream& operator<<(std::ostream& os, const ExampleReservoir& rhs)
   {
-    for(typename std::vector<Example_CPtr>::const_iterator it = rhs.m_examples.begin(), iend = rhs.m_examples.end(); it != iend; ++it)
+    for(typename std::vector<Label>::const_iterator it = rhs.m_labels.begin(), iend = rhs.m_labels.end(); it != iend; ++it)
     {
-      os << (*it)->get_label() << ' ';
+      os << *it << ' ';
     }
 
     return os;
@@ -222,11 +282,12 @@ private:
   template <typename Archive>
   void serialize(Archive& ar, const unsigned int version)
   {
-    ar & m_curSize;
-    ar & m_examples;
+    ar & m_features;
     ar & m_histogram;
+    ar & m_labels;
     ar & m_maxClassSize;
     ar & m_randomNumberGenerator;
+    ar & m_rowsByClass;
     ar & m_seenExamples;
   }
 
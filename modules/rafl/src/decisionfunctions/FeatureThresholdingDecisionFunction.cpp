@@ -19,7 +19,25 @@ FeatureThresholdingDecisionFunction::FeatureThresholdingDecisionFunction(size_t
 
 DecisionFunction::DescriptorClassification FeatureThresholdingDecisionFunction::classify_descriptor(const Descriptor& descriptor) const
 {
-  return descriptor[m_featureIndex] < m_threshold ? DC_LEFT : DC_RIGHT;
+  return classify_features(&descriptor[0]);
+}
+
+DecisionFunction::DescriptorClassification FeatureThresholdingDecisionFunction::classify_features(const float *features) const
+{
+  return features[m_featureIndex] < m_threshold ? DC_LEFT : DC_RIGHT;
+}
+
+void FeatureThresholdingDecisionFunction::classify_rows(const FeatureMatrix& features, std::vector<DescriptorClassification>& classifications) const
+{
+  const size_t rowCount = features.get_row_count();
+  classifications.resize(rowCount);
+  if(rowCount == 0) return;
+
+  const float *values = features.get_column(m_featureIndex);
+  for(size_t i = 0; i < rowCount; ++i)
+  {
+    classifications[i] = values[i] < m_threshold ? DC_LEFT : DC_RIGHT;
+  }
 }
 
 void FeatureThresholdingDecisionFunction::output(std::ostream& os) const
@@ -25,10 +25,38 @@ PairwiseOpAndThresholdDecisionFunction::PairwiseOpAndThresholdDecisionFunction()
 
 DecisionFunction::DescriptorClassification PairwiseOpAndThresholdDecisionFunction::classify_descriptor(const Descriptor& descriptor) const
 {
-  float result = apply_op(m_op, descriptor[m_firstFeatureIndex], descriptor[m_secondFeatureIndex]);
+  return classify_features(&descriptor[0]);
+}
+
+DecisionFunction::DescriptorClassification PairwiseOpAndThresholdDecisionFunction::classify_features(const float *features) const
+{
+  float result = apply_op(m_op, features[m_firstFeatureIndex], features[m_secondFeatureIndex]);
   return result < m_threshold ? DC_LEFT : DC_RIGHT;
 }
 
+void PairwiseOpAndThresholdDecisionFunction::classify_rows(const FeatureMatrix& features, std::vector<DescriptorClassification>& classifications) const
+{
+  const size_t rowCount = features.get_row_count();
+  classifications.resize(rowCount);
+  if(rowCount == 0) return;
+
+  // Note: We switch on the operation once, outside the loop, so that the loop bodies are simple enough to vectorise.
+  const float *a = features.get_column(m_firstFeatureIndex);
+  const float *b = features.get_column(m_secondFeatureIndex);
+  switch(m_op)
+  {
+    case PO_ADD:
+      for(size_t i = 0; i < rowCount; ++i) classifications[i] = a[i] + b[i] < m_threshold ? DC_LEFT : DC_RIGHT;
+      break;
+    case PO_SUBTRACT:
+      for(size_t i = 0; i < rowCount; ++i) classifications[i] = a[i] - b[i] < m_threshold ? DC_LEFT : DC_RIGHT;
+      break;
+    default:
+      // This should never happen.
+      throw std::runtime_error("Unknown pairwise operation");
+  }
+}
+
 void PairwiseOpAndThresholdDecisionFunction::output(std::ostream& os) const
 {
   os << "First Feature " << m_firstFeatureIndex << ' '
@@ -12,6 +12,8 @@
 #include <itmx/remotemapping/MappingClient.h>
 #include <itmx/trackers/FallibleTracker.h>
 
+#include <tvgutil/misc/Setting.h>
+
 #include "SLAMContext.h"
 
 namespace spaint {
@@ -25,7 +27,9 @@ class SLAMComponent
 private:
   typedef boost::shared_ptr<ITMLib::ITMDenseMapper<SpaintVoxel,ITMVoxelIndex> > DenseMapper_Ptr;
   typedef boost::shared_ptr<ITMLib::ITMDenseSurfelMapper<SpaintSurfel> > DenseSurfelMapper_Ptr;
+  typedef boost::shared_ptr<const ITMLib::ITMSurfelVisualisationEngine<SpaintSurfel> > SurfelVisualisationEngine_CPtr;
   typedef ITMLib::ITMTrackingState::TrackingResult TrackingResult;
+  typedef boost::shared_ptr<const ITMLib::ITMVisualisationEngine<SpaintVoxel,ITMVoxelIndex> > VoxelVisualisationEngine_CPtr;
 
   //#################### ENUMERATIONS ####################
 public:
@@ -79,6 +83,9 @@ private:
   /** Whether or not the user wants fusion to be run. */
   bool m_fusionEnabled;
 
+  /** The specifier of the global poses (if any) that are being used for the scene (read each frame, so accessed via a setting handle). */
+  tvgutil::Setting<std::string> m_globalPosesSpecifier;
+
   /** The engine used to provide input images to the fusion process. */
   ImageSourceEngine_Ptr m_imageSourceEngine;
 
@@ -122,6 +129,12 @@ private:
   /** The namespace associated with the settings that are specific to SLAM components. */
   std::string m_settingsNamespace;
 
+  /**
+   * The surfel visualisation engine used when preparing for tracking. This is deliberately not shared with other SLAM components,
+   * since the engine contains scratch memory that is written during rendering, and SLAM components for different scenes may be run concurrently.
+   */
+  SurfelVisualisationEngine_CPtr m_surfelVisualisationEngine;
+
   /** The tracker. */
   Tracker_Ptr m_tracker;
 
@@ -137,6 +150,9 @@ private:
   /** The view builder. */
   ViewBuilder_Ptr m_viewBuilder;
 
+  /** The voxel visualisation engine used when preparing for tracking (not shared with other SLAM components, for the same reason as the surfel one). */
+  VoxelVisualisationEngine_CPtr m_voxelVisualisationEngine;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -162,6 +178,13 @@ public:
    */
   bool get_fusion_enabled() const;
 
+  /**
+   * \brief Gets the ID of the scene (if any) whose pose is being mirrored by this SLAM component.
+   *
+   * \return The ID of the scene (if any) whose pose is being mirrored by this SLAM component, or the empty string otherwise.
+   */
+  const std::string& get_mirror_scene_id() const;
+
   /**
    * \brief Gets the ID of the scene being reconstructed by this SLAM component.
    *
@@ -241,6 +264,15 @@ private:
    */
   std::vector<ORUtils::SE3Pose> load_ground_truth_relocalisation_trajectory() const;
 
+  /**
+   * \brief Makes an ICP tracker that can be used to refine the results of the relocaliser.
+   *
+   * \param rgbImageSize    The size of the colour images against which the tracker will be run.
+   * \param depthImageSize  The size of the depth images against which the tracker will be run.
+   * \return                The tracker.
+   */
+  Tracker_Ptr make_refinement_tracker(const Vector2i& rgbImageSize, const Vector2i& depthImageSize) const;
+
   /**
    * \brief Render from the live camera position to prepare for tracking.
    *
@@ -44,6 +44,9 @@ private:
   /** The side length of a VOP patch (must be odd). */
   size_t m_patchSize;
 
+  /** The labels predicted by the random forest for the various voxels (before they are packed into m_predictionLabelsMB). */
+  std::vector<SpaintVoxel::Label> m_predictedLabels;
+
   /** A memory block in which to store the feature vectors computed for the various voxels during prediction. */
   boost::shared_ptr<ORUtils::MemoryBlock<float> > m_predictionFeaturesMB;
 
@@ -8,12 +8,12 @@
 
 #include <ORUtils/MemoryBlock.h>
 
-#include <rafl/examples/Example.h>
+#include <rafl/base/FeatureMatrix.h>
 
 namespace spaint {
 
 /**
- * \brief This struct provides utility functions that can make feature descriptors and examples for use with rafl random forests.
+ * \brief This struct provides utility functions that can make feature descriptors and training data for use with rafl random forests.
  */
 struct ForestUtil
 {
@@ -30,55 +30,48 @@ struct ForestUtil
   static std::vector<rafl::Descriptor_CPtr> make_descriptors(const ORUtils::MemoryBlock<float>& featuresMB, size_t descriptorCount, size_t featureCount);
 
   /**
-   * \brief Makes rafl examples from feature descriptors that are stored implicitly and contiguously in an InfiniTAM memory block.
+   * \brief Makes rafl training data from feature descriptors that are stored implicitly and contiguously in an InfiniTAM memory block.
    *
    * The memory block contains feature descriptors that are grouped by the label that should be assigned to them. In particular,
    * the block is divided into equally-sized segments, each of which contains maxDescriptorsPerLabel feature descriptors. Within
-   * segment i, the first descriptorCounts[i] (<= maxDescriptorsPerLabel) feature descriptors are valid and can be used to make
-   * examples. Each feature descriptor in segment i is assigned label i when making examples.
+   * segment i, the first descriptorCounts[i] (<= maxDescriptorsPerLabel) feature descriptors are valid and can be used for
+   * training. Each feature descriptor in segment i is assigned label i.
+   *
+   * The valid descriptors are copied into the rows of a single feature matrix (rather than into one descriptor and example each),
+   * which can then be added to a forest in one go.
    *
    * \param featuresMB              The InfiniTAM memory block containing the feature descriptors.
    * \param descriptorCountsMB      An InfiniTAM memory block containing the numbers of descriptors in each label segment that are valid.
    * \param featureCount            The number of features in a feature descriptor.
    * \param maxDescriptorsPerLabel  The number of descriptors that could potentially be stored in a label segment.
    * \param labelCount              The number of labels for which the memory block contains descriptors.
-   * \return                        The rafl examples.
+   * \param features                A feature matrix into which to write the valid descriptors, one per row (any existing rows are discarded).
+   * \param labels                  A vector into which to write the labels of the valid descriptors (labels[r] is the label for row r).
    */
   template <typename Label>
-  static std::vector<boost::shared_ptr<const rafl::Example<Label> > > make_examples(const ORUtils::MemoryBlock<float>& featuresMB,
-                                                                                    const ORUtils::MemoryBlock<unsigned int>& descriptorCountsMB, 
-                                                                                    size_t featureCount, size_t maxDescriptorsPerLabel, size_t labelCount)
+  static void make_training_data(const ORUtils::MemoryBlock<float>& featuresMB, const ORUtils::MemoryBlock<unsigned int>& descriptorCountsMB,
+                                 size_t featureCount, size_t maxDescriptorsPerLabel, size_t labelCount,
+                                 rafl::FeatureMatrix& features, std::vector<Label>& labels)
   {
-    typedef boost::shared_ptr<const rafl::Example<Label> > Example_CPtr;
+    features.clear();
+    labels.clear();
 
-    // Determine the number of examples we are trying to make (one per valid descriptor).
     descriptorCountsMB.UpdateHostFromDevice();
     const unsigned int *descriptorCounts = descriptorCountsMB.GetData(MEMORYDEVICE_CPU);
-    size_t exampleCount = 0;
-    for(size_t i = 0, size = descriptorCountsMB.dataSize; i < size; ++i)
-    {
-      exampleCount += descriptorCounts[i];
-    }
 
-    // Make the examples.
     featuresMB.UpdateHostFromDevice();
-    const float *features = featuresMB.GetData(MEMORYDEVICE_CPU);
-    std::vector<Example_CPtr> examples(exampleCount);
-    size_t exampleIndex = 0;
+    const float *featuresData = featuresMB.GetData(MEMORYDEVICE_CPU);
+
     for(Label label = 0; label < static_cast<Label>(labelCount); ++label)
     {
       for(size_t i = 0; i < descriptorCounts[label]; ++i)
       {
-        // Copy the features for the example into a descriptor.
-        const float *featuresForExample = features + (label * maxDescriptorsPerLabel + i) * featureCount;
-        rafl::Descriptor_Ptr descriptor(new rafl::Descriptor(featuresForExample, featuresForExample + featureCount));
-
-        // Make the example and add it.
-        examples[exampleIndex++] = Example_CPtr(new rafl::Example<Label>(descriptor, label));
+        // Copy the features for the descriptor into a new row of the matrix.
+        size_t row = features.add_row(featureCount);
+        features.set_row(row, featuresData + (label * maxDescriptorsPerLabel + i) * featureCount);
+        labels.push_back(label);
       }
     }
-
-    return examples;
   }
 };
 
@@ -30,19 +30,18 @@ public:
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /** Override */
-  virtual void calculate_voxel_mask_prefix_sums(const ORUtils::MemoryBlock<bool>& labelMaskMB) const;
+  virtual void calculate_tile_label_offsets() const;
 
   /** Override */
-  virtual void calculate_voxel_masks(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData) const;
-
-  /** Override */
-  virtual void write_candidate_voxel_counts(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const;
+  virtual void count_candidate_voxels(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData) const;
 
   /** Override */
   virtual void write_candidate_voxel_locations(const ORFloat4Image *raycastResult) const;
 
   /** Override */
-  virtual void write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB) const;
+  virtual void write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB, unsigned int seed,
+                                             ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB,
+                                             ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const;
 };
 
 }
@@ -22,14 +22,22 @@ namespace spaint {
 
 /**
  * \brief An instance of a class deriving from this one can be used to sample voxels for each currently-used label from a scene.
+ *
+ * The raycast result is divided into tiles of consecutive pixels. The label (if any) for which each pixel's voxel is a candidate
+ * is first determined, and the candidates for each label are counted within each tile. An exclusive scan over these counts
+ * (ordered by label and then by tile) yields the position in a single candidate voxel locations array at which each tile's
+ * candidates for each label should be written, so that the candidates for each label end up contiguous. Finally, the voxels
+ * to sample for each label are chosen from its candidates on the device, using a seed that is passed in for each call.
  */
 class PerLabelVoxelSampler
 {
-  //#################### PROTECTED VARIABLES ####################
+  //#################### CONSTANTS ####################
 protected:
-  /** A memory block in which to store random indices when sampling from the candidate voxels for each label. */
-  boost::shared_ptr<ORUtils::MemoryBlock<int> > m_candidateVoxelIndicesMB;
+  /** The number of pixels in each tile of the raycast result. */
+  static const int TILE_SIZE = 64;
 
+  //#################### PROTECTED VARIABLES ####################
+protected:
   /** A memory block in which to store the locations of candidate voxels in the raycast result, grouped by label. */
   boost::shared_ptr<ORUtils::MemoryBlock<Vector3s> > m_candidateVoxelLocationsMB;
 
@@ -42,20 +50,26 @@ protected:
   /** The size of the raycast result (in pixels). */
   const int m_raycastResultSize;
 
-  /** A random number generator. */
+  /** A random number generator (used to generate the seed for each sampling call). */
   boost::shared_ptr<tvgutil::RandomNumberGenerator> m_rng;
 
+  /** The number of tiles into which the raycast result is divided. */
+  const int m_tileCount;
+
   /**
-   * A memory block in which to store the prefix sums for the voxel masks. These are used to determine the locations in the
-   * candidate voxel locations array into which to write candidate voxels.
+   * A memory block in which to store the numbers of candidate voxels for each label in each tile. The counts are stored
+   * label by label, and are followed by a dummy zero element so that an exclusive scan over them also yields the total.
    */
-  boost::shared_ptr<ORUtils::MemoryBlock<unsigned int> > m_voxelMaskPrefixSumsMB;
+  boost::shared_ptr<ORUtils::MemoryBlock<unsigned int> > m_tileLabelCountsMB;
 
   /**
-   * A memory block in which to store voxel masks indicating which voxels may be used as examples of which semantic labels.
-   * The masks for the different labels are concatenated into a single 1D array.
+   * A memory block in which to store the exclusive scan of the tile label counts. These are used to determine the locations in the
+   * candidate voxel locations array into which to write the candidate voxels for each label in each tile.
    */
-  boost::shared_ptr<ORUtils::MemoryBlock<unsigned char> > m_voxelMasksMB;
+  boost::shared_ptr<ORUtils::MemoryBlock<unsigned int> > m_tileLabelOffsetsMB;
+
+  /** A memory block in which to store the label (if any) for which the voxel at each pixel of the raycast result is a candidate (or -1 otherwise). */
+  boost::shared_ptr<ORUtils::MemoryBlock<int> > m_voxelLabelsMB;
 
   //#################### CONSTRUCTORS ####################
 protected:
@@ -79,43 +93,41 @@ public:
   //#################### PRIVATE ABSTRACT MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Calculates the prefix sums for the voxel masks.
-   *
-   * \param labelMaskMB A memory block containing a mask specifying which labels are currently in use.
+   * \brief Calculates the tile label offsets by performing an exclusive scan over the tile label counts.
    */
-  virtual void calculate_voxel_mask_prefix_sums(const ORUtils::MemoryBlock<bool>& labelMaskMB) const = 0;
+  virtual void calculate_tile_label_offsets() const = 0;
 
   /**
-   * \brief Calculates the voxel masks.
+   * \brief Determines the label (if any) for which each voxel in the raycast result is a candidate, and counts the candidates for each label in each tile.
    *
    * \param raycastResult The current raycast result.
    * \param voxelData     The scene's voxel data.
    * \param indexData     The scene's index data.
    */
-  virtual void calculate_voxel_masks(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData) const = 0;
-
-  /**
-   * \brief Writes the number of candidate voxels that are available for each label into the voxel counts for labels memory block.
-   *
-   * \param labelMaskMB             A memory block containing a mask specifying which labels are currently in use.
-   * \param voxelCountsForLabelsMB  A memory block into which to write voxel counts for each label.
-   */
-  virtual void write_candidate_voxel_counts(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const = 0;
+  virtual void count_candidate_voxels(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData) const = 0;
 
   /**
    * \brief Writes the locations of the candidate voxels into the candidate voxel locations memory block.
    *
+   * Note that this consumes the tile label counts, which are reduced to zero in the process.
+   *
    * \param raycastResult The current raycast result.
    */
   virtual void write_candidate_voxel_locations(const ORFloat4Image *raycastResult) const = 0;
 
   /**
-   * \brief Writes the locations of the sampled voxels into the sampled voxel locations memory block.
+   * \brief Chooses the voxels to sample for each used label, and writes their locations and the numbers of voxels sampled into the specified memory blocks.
+   *
+   * Once this function returns, the numbers of voxels sampled for each label must be available on both the CPU and the GPU (if any).
    *
    * \param labelMaskMB             A memory block containing a mask specifying which labels are currently in use.
+   * \param seed                    The seed to use when choosing the voxels to sample.
    * \param sampledVoxelLocationsMB A memory block into which to write the locations of the sampled voxels.
+   * \param voxelCountsForLabelsMB  A memory block into which to write the numbers of voxels sampled for each label.
    */
-  virtual void write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB) const = 0;
+  virtual void write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB, unsigned int seed,
+                                             ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB,
+                                             ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const = 0;
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -132,16 +144,6 @@ public:
                      const ORUtils::MemoryBlock<bool>& labelMaskMB,
                      ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB,
                      ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const;
-
-  //#################### PRIVATE MEMBER FUNCTIONS ####################
-private:
-  /**
-   * \brief Randomly chooses candidate voxel locations to sample for each used label.
-   *
-   * \param labelMaskMB             A memory block containing a mask specifying which labels are currently in use.
-   * \param voxelCountsForLabelsMB  A memory block containing the numbers of candidate voxels for each label.
-   */
-  void choose_candidate_voxel_indices(const ORUtils::MemoryBlock<bool>& labelMaskMB, const ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const;
 };
 
 //#################### TYPEDEFS ####################
@@ -11,124 +11,185 @@
 namespace spaint {
 
 /**
- * \brief Copies the location of a randomly-chosen candidate voxel for each label across to the sampled voxel locations array.
+ * \brief Counts the candidate voxels for each label in the specified tile of the raycast result.
  *
- * Note 1: The voxel locations to sample are chosen in advance and passed in.
- * Note 2: The numbers of voxel locations sampled for the various labels can differ (e.g. if there are not enough candidates for a given label).
- *         A candidate voxel index of -1 indicates that no voxel location has been sampled for a given label and voxel index.
+ * Each tile is processed by a single thread, so no synchronisation is needed when updating the counts.
  *
- * \param voxelIndex              The index of the voxel currently being processed for each label (each thread processes one voxel per label).
- * \param labelMask               A mask indicating which labels are currently in use.
- * \param maxLabelCount           The maximum number of labels that can be in use.
- * \param maxVoxelsPerLabel       The maximum number of voxels to sample for each label.
- * \param raycastResultSize       The size of the raycast result (in pixels).
- * \param candidateVoxelLocations An array containing the locations of the candidate voxels (grouped by label).
- * \param candidateVoxelIndices   An array specifying which candidate voxels should be sampled for each label.
- * \param sampledVoxelLocations   An array into which to write the locations of the sampled voxels.
+ * \param tileIndex         The index of the tile.
+ * \param tileSize          The number of pixels in each tile.
+ * \param tileCount         The number of tiles.
+ * \param raycastResultSize The size of the raycast result (in pixels).
+ * \param voxelLabels       An array containing the label (if any) for which each voxel in the raycast result is a candidate (or -1 otherwise).
+ * \param maxLabelCount     The maximum number of labels that can be in use.
+ * \param tileLabelCounts   An array into which to write the numbers of candidate voxels for each label in each tile (stored label by label).
  */
 _CPU_AND_GPU_CODE_
-inline void copy_sampled_voxel_locations(int voxelIndex, const bool *labelMask, size_t maxLabelCount, size_t maxVoxelsPerLabel, int raycastResultSize,
-                                         const Vector3s *candidateVoxelLocations, const int *candidateVoxelIndices, Vector3s *sampledVoxelLocations)
+inline void count_candidate_voxels_in_tile(int tileIndex, int tileSize, int tileCount, int raycastResultSize, const int *voxelLabels,
+                                           size_t maxLabelCount, unsigned int *tileLabelCounts)
 {
   for(size_t k = 0; k < maxLabelCount; ++k)
   {
-    if(labelMask[k])
-    {
-      int candidateVoxelIndex = candidateVoxelIndices[k * maxVoxelsPerLabel + voxelIndex];
-      if(candidateVoxelIndex != -1)
-      {
-        sampledVoxelLocations[k * maxVoxelsPerLabel + voxelIndex] = candidateVoxelLocations[k * raycastResultSize + candidateVoxelIndex];
-      }
-    }
+    tileLabelCounts[k * tileCount + tileIndex] = 0;
+  }
+
+  const int begin = tileIndex * tileSize;
+  const int end = begin + tileSize < raycastResultSize ? begin + tileSize : raycastResultSize;
+  for(int voxelIndex = begin; voxelIndex < end; ++voxelIndex)
+  {
+    const int label = voxelLabels[voxelIndex];
+    if(label != -1) ++tileLabelCounts[label * tileCount + tileIndex];
   }
 }
 
 /**
- * \brief Updates the voxel masks for the various labels based on the contents of the specified voxel (if it exists).
+ * \brief Generates a pseudo-random number for the specified sample, based on a seed and the index of the sample.
  *
- * \param voxelIndex        The index of the voxel whose entries in the mask should be updated.
- * \param raycastResult     The current raycast result.
- * \param raycastResultSize The size of the raycast result (in pixels).
- * \param voxelData         The scene's voxel data.
- * \param indexData         The scene's index data.
- * \param maxLabelCount     The maximum number of labels that can be in use.
- * \param voxelMasks        An array into which to write the voxel masks indicating which voxels may be used as examples of which labels.
+ * The number depends only on its inputs, so the samples can be chosen independently of each other (and in any order).
+ *
+ * \param seed        The seed.
+ * \param sampleIndex The index of the sample (across all labels).
+ * \return            The pseudo-random number.
  */
 _CPU_AND_GPU_CODE_
-inline void update_masks_for_voxel(int voxelIndex, const Vector4f *raycastResult, int raycastResultSize,
-                                   const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
-                                   size_t maxLabelCount, unsigned char *voxelMasks)
+inline unsigned int generate_sample_random_number(unsigned int seed, unsigned int sampleIndex)
 {
-  // Note: We do not need to explicitly use the label mask in this function, since no voxel will ever be marked with an unused label.
+  // Mix the seed, combine it with the sample index and mix the result, using the finaliser from MurmurHash3 to do the mixing.
+  unsigned int x = seed;
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
 
-  Vector3i loc = raycastResult[voxelIndex].toVector3().toIntRound();
-  bool isFound;
-  int voxelAddress = findVoxel(indexData, loc, isFound);
-  const SpaintVoxel *voxel = isFound ? &voxelData[voxelAddress] : NULL;
+  x ^= sampleIndex;
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
 
-  // Update the voxel masks for the various labels (even the ones that are not currently active).
-  for(size_t k = 0; k < maxLabelCount; ++k)
+  return x;
+}
+
+/**
+ * \brief Writes the locations of the candidate voxels in the specified tile of the raycast result to the segments of the
+ *        candidate voxel locations array corresponding to the labels for which they are candidate samples.
+ *
+ * The candidates for each label are written in raster order. To achieve this without needing any per-label state in the
+ * thread, the tile's counts are reused as cursors: the tile is traversed backwards, and each candidate is written to the
+ * position given by its tile's offset for the label plus the decremented count. The counts are thus all zero afterwards.
+ *
+ * \param tileIndex               The index of the tile.
+ * \param tileSize                The number of pixels in each tile.
+ * \param tileCount               The number of tiles.
+ * \param raycastResult           The current raycast result.
+ * \param raycastResultSize       The size of the raycast result (in pixels).
+ * \param voxelLabels             An array containing the label (if any) for which each voxel in the raycast result is a candidate (or -1 otherwise).
+ * \param tileLabelOffsets        An array containing the exclusive scan of the tile label counts.
+ * \param tileLabelCounts         An array containing the numbers of candidate voxels for each label in each tile.
+ * \param candidateVoxelLocations An array into which to write the locations of the candidate voxels.
+ */
+_CPU_AND_GPU_CODE_
+inline void write_candidate_voxel_locations_in_tile(int tileIndex, int tileSize, int tileCount, const Vector4f *raycastResult, int raycastResultSize,
+                                                    const int *voxelLabels, const unsigned int *tileLabelOffsets, unsigned int *tileLabelCounts,
+                                                    Vector3s *candidateVoxelLocations)
+{
+  const int begin = tileIndex * tileSize;
+  const int end = begin + tileSize < raycastResultSize ? begin + tileSize : raycastResultSize;
+  for(int voxelIndex = end - 1; voxelIndex >= begin; --voxelIndex)
   {
-    // FIXME: We shouldn't hard-code which labels we're training from here.
-    voxelMasks[k * (raycastResultSize + 1) + voxelIndex] = voxel && voxel->packedLabel.label == k && voxel->packedLabel.group != SpaintVoxel::LG_FOREST ? 1 : 0;
+    const int label = voxelLabels[voxelIndex];
+    if(label != -1)
+    {
+      const int i = label * tileCount + tileIndex;
+      candidateVoxelLocations[tileLabelOffsets[i] + --tileLabelCounts[i]] = raycastResult[voxelIndex].toVector3().toShortRound();
+    }
   }
 }
 
 /**
- * \brief Writes the number of candidate voxels that are available for the specified label into the voxel counts array.
+ * \brief Writes the number of voxels that will be sampled for the specified label into the voxel counts array.
  *
- * \param label                 The label for which to store the number of available candidate voxels.
- * \param raycastResultSize     The size of the raycast result (in pixels).
- * \param voxelMaskPrefixSums   The prefix sums for the voxel masks.
+ * \param label                 The label.
+ * \param tileCount             The number of tiles.
  * \param labelMask             A mask indicating which labels are currently in use.
- * \param voxelCountsForLabels  An array into which to write the numbers of candidate voxels that are available for each label.
+ * \param maxVoxelsPerLabel     The maximum number of voxels to sample for each label.
+ * \param tileLabelOffsets      An array containing the exclusive scan of the tile label counts.
+ * \param voxelCountsForLabels  An array into which to write the numbers of voxels sampled for each label.
  */
 _CPU_AND_GPU_CODE_
-inline void write_candidate_voxel_count(int label, int raycastResultSize, const bool *labelMask, const unsigned int *voxelMaskPrefixSums,
-                                        unsigned int *voxelCountsForLabels)
+inline void write_sampled_voxel_count(int label, int tileCount, const bool *labelMask, size_t maxVoxelsPerLabel, const unsigned int *tileLabelOffsets,
+                                      unsigned int *voxelCountsForLabels)
 {
-  voxelCountsForLabels[label] = labelMask[label] ? voxelMaskPrefixSums[label * (raycastResultSize+1) + raycastResultSize] : 0;
+  const unsigned int candidateCount = tileLabelOffsets[(label + 1) * tileCount] - tileLabelOffsets[label * tileCount];
+  voxelCountsForLabels[label] = labelMask[label] ? (candidateCount < maxVoxelsPerLabel ? candidateCount : static_cast<unsigned int>(maxVoxelsPerLabel)) : 0;
 }
 
 /**
- * \brief Writes the location of the specified candidate voxel to the segment of the candidate voxel
- *        locations array corresponding to the label (if any) for which it is a candidate sample.
+ * \brief Chooses a candidate voxel to sample for the specified label and sample index, and writes its location into the sampled voxel locations array.
  *
- * Note: If the voxel cannot serve as a sample for any label, nothing is written.
+ * If there are no more candidates for the label than the maximum number of voxels to sample, all of them are used, in order.
+ * Otherwise, each sample is chosen uniformly at random from the candidates (so different samples may occasionally choose
+ * the same candidate). Nothing is written for unused labels, or for sample indices beyond the number of candidates.
  *
- * \param voxelIndex              The index of the voxel whose location might be written.
- * \param raycastResult           The current raycast result.
- * \param raycastResultSize       The size of the raycast result (in pixels).
- * \param voxelMasks              An array containing the voxel masks indicating which voxels may be used as examples of which labels.
- * \param voxelMaskPrefixSums     The prefix sums for the voxel masks.
- * \param maxLabelCount           The maximum number of labels that can be in use.
- * \param candidateVoxelLocations An array into which to write the locations of the candidate voxels.
+ * \param label                   The label.
+ * \param voxelIndex              The index of the sample for the label.
+ * \param tileCount               The number of tiles.
+ * \param labelMask               A mask indicating which labels are currently in use.
+ * \param maxVoxelsPerLabel       The maximum number of voxels to sample for each label.
+ * \param tileLabelOffsets        An array containing the exclusive scan of the tile label counts.
+ * \param candidateVoxelLocations An array containing the locations of the candidate voxels (grouped by label).
+ * \param seed                    The seed to use when choosing the voxels to sample.
+ * \param sampledVoxelLocations   An array into which to write the locations of the sampled voxels.
  */
 _CPU_AND_GPU_CODE_
-inline void write_candidate_voxel_location(int voxelIndex, const Vector4f *raycastResult, int raycastResultSize,
-                                           const unsigned char *voxelMasks, const unsigned int *voxelMaskPrefixSums,
-                                           size_t maxLabelCount, Vector3s *candidateVoxelLocations)
+inline void write_sampled_voxel_location(int label, int voxelIndex, int tileCount, const bool *labelMask, size_t maxVoxelsPerLabel,
+                                         const unsigned int *tileLabelOffsets, const Vector3s *candidateVoxelLocations, unsigned int seed,
+                                         Vector3s *sampledVoxelLocations)
 {
-  // Note: We do not need to explicitly use the label mask in this function, since there will never be any candidates for unused labels.
+  if(!labelMask[label]) return;
 
-  // For each possible label:
-  for(size_t k = 0; k < maxLabelCount; ++k)
-  {
-    const size_t maskOffset = k * (raycastResultSize + 1) + voxelIndex;
+  const unsigned int candidatesBegin = tileLabelOffsets[label * tileCount];
+  const unsigned int candidateCount = tileLabelOffsets[(label + 1) * tileCount] - candidatesBegin;
+  const unsigned int sampleIndex = static_cast<unsigned int>(label * maxVoxelsPerLabel + voxelIndex);
 
-    // If the voxel we're processing is a candidate for this label:
-    if(voxelMasks[maskOffset])
+  if(candidateCount <= maxVoxelsPerLabel)
+  {
+    if(static_cast<unsigned int>(voxelIndex) < candidateCount)
     {
-      // Calculate its location.
-      Vector3s loc = raycastResult[voxelIndex].toVector3().toShortRound();
-
-      // Determine the index to which it should be written in the segment of the candidate voxel location array that corresponds to this label.
-      unsigned int i = voxelMaskPrefixSums[maskOffset];
-
-      // Write the candidate voxel's location to the candidate voxel locations array.
-      candidateVoxelLocations[k * raycastResultSize + i] = loc;
+      sampledVoxelLocations[sampleIndex] = candidateVoxelLocations[candidatesBegin + voxelIndex];
     }
   }
+  else
+  {
+    const unsigned int candidateIndex = generate_sample_random_number(seed, sampleIndex) % candidateCount;
+    sampledVoxelLocations[sampleIndex] = candidateVoxelLocations[candidatesBegin + candidateIndex];
+  }
+}
+
+/**
+ * \brief Determines the label (if any) for which the specified voxel is a candidate sample.
+ *
+ * \param voxelIndex        The index of the voxel in the raycast result.
+ * \param raycastResult     The current raycast result.
+ * \param voxelData         The scene's voxel data.
+ * \param indexData         The scene's index data.
+ * \param maxLabelCount     The maximum number of labels that can be in use.
+ * \param voxelLabels       An array into which to write the label (if any) for which each voxel is a candidate (or -1 otherwise).
+ */
+_CPU_AND_GPU_CODE_
+inline void write_voxel_label(int voxelIndex, const Vector4f *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                              size_t maxLabelCount, int *voxelLabels)
+{
+  // Note: We do not need to explicitly use the label mask in this function, since no voxel will ever be marked with an unused label.
+
+  Vector3i loc = raycastResult[voxelIndex].toVector3().toIntRound();
+  bool isFound;
+  int voxelAddress = findVoxel(indexData, loc, isFound);
+  const SpaintVoxel *voxel = isFound ? &voxelData[voxelAddress] : NULL;
+
+  // FIXME: We shouldn't hard-code which labels we're training from here.
+  voxelLabels[voxelIndex] = voxel && voxel->packedLabel.label < maxLabelCount && voxel->packedLabel.group != SpaintVoxel::LG_FOREST ? voxel->packedLabel.label : -1;
 }
 
 }
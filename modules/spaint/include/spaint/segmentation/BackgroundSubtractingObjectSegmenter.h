@@ -27,6 +27,9 @@ private:
   /** The colour appearance model to use to separate the user's hand from any object it's holding. */
   ColourAppearanceModel_Ptr m_handAppearanceModel;
 
+  /** An image in which to store the probability of each pixel in the current colour input image being part of the hand. */
+  mutable ORFloatImage_Ptr m_handProbs;
+
   /** The touch detector to use to make the change and hand masks. */
   mutable TouchDetector_Ptr m_touchDetector;
 
@@ -6,9 +6,9 @@
 #ifndef H_SPAINT_COLOURAPPEARANCEMODEL
 #define H_SPAINT_COLOURAPPEARANCEMODEL
 
-#include <orx/base/ORImagePtrTypes.h>
+#include <vector>
 
-#include <tvgutil/statistics/ProbabilityMassFunction.h>
+#include <orx/base/ORImagePtrTypes.h>
 
 namespace spaint {
 
@@ -19,10 +19,6 @@ namespace spaint {
  */
 class ColourAppearanceModel
 {
-  //#################### TYPEDEFS ####################
-private:
-  typedef boost::shared_ptr<tvgutil::ProbabilityMassFunction<int> > PMF_Ptr;
-
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The number of Cb bins in the histogram. */
@@ -31,17 +27,20 @@ private:
   /** The number of Cr bins in the histogram. */
   int m_binsCr;
 
-  // A (linearised) 2D histogram representing P(Colour | object).
-  tvgutil::Histogram<int> m_histColourGivenObject;
+  /** A (linearised) 2D histogram of the colours of the pixels that were part of the object, used to compute P(Colour | object). */
+  std::vector<size_t> m_histColourGivenObject;
 
-  // A (linearised) 2D histogram representing P(Colour | !object).
-  tvgutil::Histogram<int> m_histColourGivenNotObject;
+  /** A (linearised) 2D histogram of the colours of the pixels that were not part of the object, used to compute P(Colour | !object). */
+  std::vector<size_t> m_histColourGivenNotObject;
 
-  // A (linearised) 2D probability mass function representing P(Colour | object).
-  PMF_Ptr m_pmfColourGivenObject;
+  /** A (linearised) 2D table containing P(object | Colour) for each bin, rebuilt from the histograms whenever the model is trained. */
+  std::vector<float> m_posteriorTable;
 
-  // A (linearised) 2D probability mass function representing P(Colour | !object).
-  PMF_Ptr m_pmfColourGivenNotObject;
+  /** The total number of pixels that have been added to m_histColourGivenObject. */
+  size_t m_totalColourGivenObject;
+
+  /** The total number of pixels that have been added to m_histColourGivenNotObject. */
+  size_t m_totalColourGivenNotObject;
 
   //#################### CONSTRUCTORS ####################
 public:
@@ -63,6 +62,18 @@ public:
    */
   float compute_posterior_probability(const Vector3u& rgbColour) const;
 
+  /**
+   * \brief Computes the posterior probabilities of the pixels in an image being part of the object given their colours.
+   *
+   * If a mask is specified, the posterior probabilities are only computed for the pixels that are set in the mask (the
+   * posterior probabilities of the other pixels are set to zero).
+   *
+   * \param image       The image.
+   * \param posteriors  An image into which to write the posterior probabilities (this will be resized as necessary).
+   * \param mask        An optional mask (of the same size as the image) specifying the pixels for which to compute the posterior probabilities.
+   */
+  void compute_posterior_probabilities(const ORUChar4Image_CPtr& image, const ORFloatImage_Ptr& posteriors, const ORUCharImage_CPtr& mask = ORUCharImage_CPtr()) const;
+
   /**
    * \brief Trains the colour appearance model for the object.
    *
@@ -80,6 +91,11 @@ private:
    * \return          The 2D histogram bin index for the colour.
    */
   int compute_bin(const Vector3u& rgbColour) const;
+
+  /**
+   * \brief Rebuilds the table of posterior probabilities from the histograms.
+   */
+  void update_posterior_table();
 };
 
 //#################### TYPEDEFS ####################
@@ -15,9 +15,7 @@ class LeapSelector;
 #endif
 class NullSelector;
 class PickingSelector;
-#ifdef WITH_ARRAYFIRE
 class TouchSelector;
-#endif
 
 /**
  * \brief An instance of a class deriving from this one can be used to visit selectors (e.g. for the purpose of rendering them).
@@ -56,14 +54,12 @@ public:
    */
   virtual void visit(const PickingSelector& selector) const;
 
-#ifdef WITH_ARRAYFIRE
   /**
    * \brief Visits a touch selector.
    *
    * \param selector  The selector to visit.
    */
   virtual void visit(const TouchSelector& selector) const;
-#endif
 };
 
 }
@@ -0,0 +1,217 @@
+/**
+ * spaint: TouchComponentAnalyser.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_SPAINT_TOUCHCOMPONENTANALYSER
+#define H_SPAINT_TOUCHCOMPONENTANALYSER
+
+#include <vector>
+
+namespace spaint {
+
+/**
+ * \brief An instance of this class can be used to find and analyse the connected regions in which a live depth image
+ *        differs from a depth raycast of the reconstructed scene, as part of the process of detecting touch interactions.
+ *
+ * All of the work is done natively on the CPU (in parallel, if OpenMP is available), on row-major images, and all of the
+ * buffers needed are allocated up-front, so that the analysis of a frame does not need to allocate any memory.
+ *
+ * The morphological operations treat pixels outside the image as neutral (i.e. they never erode a region that touches
+ * the image boundary), since hands and arms will typically enter the image from one of its edges.
+ */
+class TouchComponentAnalyser
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct contains the statistics of a connected component in the change mask.
+   */
+  struct Component
+  {
+    /** The number of pixels in the component. */
+    int m_area;
+
+    /** The sum over the pixels in the component of the absolute depth differences (in mm, clamped to [0,255]). */
+    int m_diffSumMm;
+
+    /** The maximum x coordinate of any pixel in the component. */
+    int m_maxX;
+
+    /** The maximum y coordinate of any pixel in the component. */
+    int m_maxY;
+
+    /** The minimum x coordinate of any pixel in the component. */
+    int m_minX;
+
+    /** The minimum y coordinate of any pixel in the component. */
+    int m_minY;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** A mask of the changes that have been detected between the raw depth image and the depth raycast. */
+  std::vector<unsigned char> m_changeMask;
+
+  /** A buffer in which to store the column-wise prefix sums used when applying the vertical pass of a morphological operation. */
+  std::vector<int> m_columnSums;
+
+  /** The connected components of the change mask. */
+  std::vector<Component> m_components;
+
+  /** An image in which each pixel is the absolute difference (in mm, clamped to [0,255]) between the raw depth image and the depth raycast. */
+  std::vector<unsigned char> m_diffInMm;
+
+  /** The height of the images being analysed. */
+  int m_height;
+
+  /** An image in which each pixel contains the index of the connected component to which it belongs (or -1 if it is not in the change mask). */
+  std::vector<int> m_labels;
+
+  /** The union-find forest used when labelling the connected components (each entry is the index of the pixel's parent, or -1). */
+  std::vector<int> m_parents;
+
+  /** A buffer in which to store the result of the horizontal pass of a morphological operation. */
+  std::vector<unsigned char> m_scratch;
+
+  /** The width of the images being analysed. */
+  int m_width;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a touch component analyser.
+   *
+   * \param width   The width of the images to be analysed.
+   * \param height  The height of the images to be analysed.
+   */
+  TouchComponentAnalyser(int width, int height);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Calculates the histogram descriptor that is used to decide whether or not the specified component corresponds to a touch interaction.
+   *
+   * The descriptor is a 64-bin histogram of the absolute depth differences (in mm) over the whole image, in which the differences
+   * for pixels outside the component are treated as zero. This matches the descriptors used to train the touch forest.
+   *
+   * \param component   The index of the component.
+   * \param descriptor  A vector into which to write the descriptor.
+   */
+  void calculate_histogram_descriptor(int component, std::vector<float>& descriptor) const;
+
+  /**
+   * \brief Detects changes between a raw depth image and a depth raycast of the reconstructed scene, and finds the connected components of the result.
+   *
+   * In a single pass over the images, this masks out the parts of the raw depth image that are too far away, computes the absolute
+   * differences between the raw depth image and the depth raycast, and thresholds them to make a change mask. It then applies a
+   * morphological opening to the change mask to reduce noise, and labels its connected components.
+   *
+   * \param rawDepth            The raw depth image (in m).
+   * \param depthRaycast        The depth raycast (in m).
+   * \param maxRawDepth         The depth (in m) beyond which raw depth values should be treated as invalid (i.e. set to -1).
+   * \param changeThreshold     The difference (in m) above which a pixel is considered to have changed.
+   * \param morphKernelSize     The side length of the kernel to use for the morphological opening.
+   * \param thresholdedRawDepth An image into which to write the raw depth image, with the parts that are too far away set to -1.
+   * \param diffRawRaycast      An image into which to write the absolute differences (in m) between the raw depth image and the depth raycast (or -1, where either is invalid).
+   */
+  void detect_changes(const float *rawDepth, const float *depthRaycast, float maxRawDepth, float changeThreshold, int morphKernelSize,
+                      float *thresholdedRawDepth, float *diffRawRaycast);
+
+  /**
+   * \brief Gets the mask of the changes that were detected in the most recent call to detect_changes.
+   *
+   * \return  The change mask (1 = changed, 0 = unchanged).
+   */
+  const std::vector<unsigned char>& get_change_mask() const;
+
+  /**
+   * \brief Gets the connected components that were found by the most recent labelling.
+   *
+   * \return  The connected components.
+   */
+  const std::vector<Component>& get_components() const;
+
+  /**
+   * \brief Gets an image in which each pixel is the absolute difference (in mm, clamped to [0,255]) between the raw depth image and the depth raycast.
+   *
+   * \return  The image of absolute differences in mm.
+   */
+  const std::vector<unsigned char>& get_diff_in_mm() const;
+
+  /**
+   * \brief Gets an image in which each pixel contains the index of the connected component to which it belongs (or -1 if it is not in a component).
+   *
+   * \return  The connected-component image.
+   */
+  const std::vector<int>& get_labels() const;
+
+  /**
+   * \brief Labels the 4-connected components of the specified mask and calculates their statistics.
+   *
+   * \param mask  The mask (any non-zero pixel is considered to be in the mask).
+   */
+  void label_components(const unsigned char *mask);
+
+  /**
+   * \brief Makes an image containing the absolute differences (in mm) for the pixels in the specified component, and zeros elsewhere.
+   *
+   * \param component The index of the component.
+   * \param image     An image into which to write the result.
+   */
+  void make_component_diff_image(int component, unsigned char *image) const;
+
+  /**
+   * \brief Applies a morphological opening with a square kernel to the specified mask (in place).
+   *
+   * The erosion and dilation are each implemented as a pair of separable passes that use running counts, so the cost
+   * of the opening is independent of the size of the kernel.
+   *
+   * \param mask        The mask (in which each pixel must be either 0 or 1).
+   * \param kernelSize  The side length of the kernel (rounded up to the next odd number if necessary).
+   */
+  void open(unsigned char *mask, int kernelSize);
+
+  /**
+   * \brief Selects the connected components whose areas fall within the specified range.
+   *
+   * \param minArea The minimum area (in pixels) that a component can have if it is to be selected.
+   * \param maxArea The maximum area (in pixels) that a component can have if it is to be selected.
+   * \return        The indices of the selected components.
+   */
+  std::vector<int> select_candidate_components(int minArea, int maxArea) const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Applies a square erosion or dilation to the specified mask (in place).
+   *
+   * \param mask    The mask (in which each pixel must be either 0 or 1).
+   * \param radius  The radius of the kernel (i.e. the kernel's side length is 2 * radius + 1).
+   * \param erode   Whether to apply an erosion (true) or a dilation (false).
+   */
+  void apply_morphological_operation(unsigned char *mask, int radius, bool erode);
+
+  /**
+   * \brief Finds the root of the union-find tree containing the specified pixel, halving the path to it as we go.
+   *
+   * \param pixel The index of the pixel.
+   * \return      The index of the root pixel.
+   */
+  int find_root(int pixel);
+
+  /**
+   * \brief Merges the union-find trees containing the specified pixels.
+   *
+   * The root of the merged tree is always the pixel with the lower index, which ensures that the root of each
+   * component is its first pixel in raster order.
+   *
+   * \param pixel1  The index of the first pixel.
+   * \param pixel2  The index of the second pixel.
+   */
+  void unite(int pixel1, int pixel2);
+};
+
+}
+
+#endif
@@ -6,18 +6,6 @@
 #ifndef H_SPAINT_TOUCHDETECTOR
 #define H_SPAINT_TOUCHDETECTOR
 
-#ifdef _MSC_VER
-  // Suppress a VC++ warning that is produced when including ArrayFire headers.
-  #pragma warning(disable:4275)
-#endif
-
-#include <arrayfire.h>
-
-#ifdef _MSC_VER
-  // Reenable the suppressed warning for the rest of the translation unit.
-  #pragma warning(default:4275)
-#endif
-
 #include <itmx/base/ITMObjectPtrTypes.h>
 #include <itmx/visualisation/interface/DepthVisualiser.h>
 
@@ -27,19 +15,20 @@
 
 #include <tvgutil/persistence/PropertyUtil.h>
 
+#include "TouchComponentAnalyser.h"
 #include "TouchSettings.h"
-#include "../imageprocessing/interface/ImageProcessor.h"
 
 namespace spaint {
 
 /**
  * \brief An instance of this class can be used to detect a touch interaction.
+ *
+ * The change detection, connected-component analysis and touch point extraction are all performed natively on the CPU.
  */
 class TouchDetector
 {
   //#################### TYPEDEFS ####################
 private:
-  typedef boost::shared_ptr<af::array> AFArray_Ptr;
   typedef int Label;
   typedef rafl::RandomForest<Label> RF;
   typedef boost::shared_ptr<RF> RF_Ptr;
@@ -54,11 +43,8 @@ private:
 
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** An image in which to store a mask of the changes that have been detected in the scene with respect to the reconstructed model. */
-  AFArray_Ptr m_changeMask;
-
-  /** An image in which to store the connected components of the change mask. */
-  af::array m_connectedComponentImage;
+  /** The analyser used to find the connected regions in which the scene has changed with respect to the reconstructed model. */
+  TouchComponentAnalyser m_componentAnalyser;
 
   /** An image in which to store the depth of the reconstructed model as viewed from the current camera pose. */
   ORFloatImage_Ptr m_depthRaycast;
@@ -67,7 +53,7 @@ private:
   itmx::DepthVisualiser_CPtr m_depthVisualiser;
 
   /** An image in which each pixel is the absolute difference (in m) between the raw depth image and the depth raycast. */
-  AFArray_Ptr m_diffRawRaycast;
+  ORFloatImage_Ptr m_diffRawRaycast;
 
   /** The random forest used to score the candidate connected components. */
   RF_Ptr m_forest;
@@ -75,9 +61,6 @@ private:
   /** The height of the images on which the touch detector is running. */
   int m_imageHeight;
 
-  /** The image processor. */
-  ImageProcessor_CPtr m_imageProcessor;
-
   /** The width of the images on which the touch detector is running. */
   int m_imageWidth;
 
@@ -94,7 +77,10 @@ private:
   ORFloatImage_Ptr m_thresholdedRawDepth;
 
   /** An image in which to store a mask denoting the detected touch region. */
-  AFArray_Ptr m_touchMask;
+  ORUCharImage_Ptr m_touchMask;
+
+  /** A buffer in which to store the pixels at which the user appears to be touching the scene. */
+  std::vector<unsigned char> m_touchPixels;
 
   /** The settings needed to configure the touch detector. */
   TouchSettings_Ptr m_touchSettings;
@@ -169,40 +155,39 @@ public:
 private:
   /**
    * \brief Detects changes between the raw depth image from the camera and a depth raycast of the reconstructed model.
+   *
+   * \param rawDepth  The raw depth image from the camera.
    */
-  void detect_changes();
+  void detect_changes(const ORFloatImage_CPtr& rawDepth);
 
   /**
-   * \brief Extracts a set of touch points from the specified component in the connected component image.
+   * \brief Extracts a set of touch points from the specified connected component of the change mask.
    *
-   * \param component           The ID of a component in the connected component image.
-   * \param diffRawRaycastInMm  An image in which each pixel is the absolute difference in mm between the current and raycasted depths.
-   * \return                    The touch points extracted from the specified component.
+   * \param component The ID of a connected component of the change mask.
+   * \return          The touch points extracted from the specified component.
    */
-  std::vector<Eigen::Vector2i> extract_touch_points(int component, const af::array& diffRawRaycastInMm);
+  std::vector<Eigen::Vector2i> extract_touch_points(int component);
 
   /**
    * Picks the candidate component most likely to correspond to a touch interaction based on mean distance to the scene.
    *
-   * \param candidateComponents The IDs of components in the connected component image that denote candidate touch interactions.
-   * \param diffRawRaycastInMm  An image in which each pixel is the absolute difference in mm between the current and raycasted depths.
+   * \param candidateComponents The IDs of connected components of the change mask that denote candidate touch interactions.
    * \return                    The ID of the best candidate component.
    */
-  int pick_best_candidate_component_based_on_distance(const af::array& candidateComponents, const af::array& diffRawRaycastInMm) const;
+  int pick_best_candidate_component_based_on_distance(const std::vector<int>& candidateComponents) const;
 
   /**
    * \brief Picks the candidate component most likely to correspond to a touch interaction based on predictions made by a random forest.
    *
    * If no candidates are classified as interactions by the forest, there is no best candidate and we return -1.
    *
-   * \param candidateComponents The IDs of components in the connected component image that denote candidate touch interactions.
-   * \param diffRawRaycastInMm  An image in which each pixel is the absolute difference in mm between the current and raycasted depths.
+   * \param candidateComponents The IDs of connected components of the change mask that denote candidate touch interactions.
    * \return                    The ID of the best candidate component, or -1 if no candidates are classified as interactions by the forest.
    */
-  int pick_best_candidate_component_based_on_forest(const af::array& candidateComponents, const af::array& diffRawRaycastInMm) const;
+  int pick_best_candidate_component_based_on_forest(const std::vector<int>& candidateComponents) const;
 
   /**
-   * \brief Prepares a thresholded version of the raw depth image and a depth raycast ready for change detection.
+   * \brief Prepares the raw depth image and a depth raycast ready for change detection.
    *
    * \param camera        The camera from which the scene is being rendered.
    * \param rawDepth      The raw depth image from the camera.
@@ -220,30 +205,17 @@ private:
   /**
    * \brief Saves an image of each candidate component to disk for use with the touchtrain application.
    *
-   * \param candidateComponents The candidate components denoting candidate touch interactions.
-   * \param diffRawRaycast      An image in which each pixel is the absolute difference between the raw depth image and the depth raycast.
+   * \param candidateComponents The IDs of connected components of the change mask that denote candidate touch interactions.
    */
-  void save_candidate_components(const af::array& candidateComponents, const af::array& diffRawRaycastInMm) const;
+  void save_candidate_components(const std::vector<int>& candidateComponents) const;
 #endif
 
   /**
-   * \brief Select candidate connected components that fall within a certain size range.
-   *
-   * \return  The IDs of the candidate components.
-   */
-  af::array select_candidate_components();
-
-  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
-private:
-  /**
-   * \brief Makes a copy of an ArrayFire array in which the elements have been clamped to the specified range.
+   * \brief Updates the touch mask to denote the specified connected component of the change mask.
    *
-   * \param arr   An ArrayFire array.
-   * \param lower The lower bound of the range to which to clamp.
-   * \param upper The upper bound of the range to which to clamp.
-   * \return      A copy of the array in which the elements have been clamped to the specified range.
+   * \param component The ID of a connected component of the change mask (or -1, to clear the touch mask).
    */
-  static af::array clamp_to_range(const af::array& arr, float lower, float upper);
+  void update_touch_mask(int component);
 };
 
 //#################### TYPEDEFS ####################
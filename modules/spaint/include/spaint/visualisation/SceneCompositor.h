@@ -0,0 +1,93 @@
+/**
+ * spaint: SceneCompositor.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_SPAINT_SCENECOMPOSITOR
+#define H_SPAINT_SCENECOMPOSITOR
+
+#include <vector>
+
+#include <itmx/base/ITMObjectPtrTypes.h>
+
+#include <orx/base/ORImagePtrTypes.h>
+
+namespace spaint {
+
+/**
+ * \brief An instance of this class can be used to combine renderings of several scenes into a single image using per-pixel depth testing.
+ *
+ * Each scene is rendered into its own layer, which holds a colour image, a depth image and the render states used to produce them.
+ * Since the layers are independent, the scenes can be rendered into them concurrently. A compositor holds the storage for a single
+ * view, so a separate compositor should be used for each view that may be rendered at the same time.
+ */
+class SceneCompositor
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct holds the rendering of a single scene.
+   */
+  struct Layer
+  {
+    /** The colour image for the scene. */
+    ORUChar4Image_Ptr m_colourImage;
+
+    /** The depth image for the scene (in which pixels whose rays do not hit the scene have a depth of -1). */
+    ORFloatImage_Ptr m_depthImage;
+
+    /** Whether or not the scene should be drawn behind all non-background layers, regardless of its actual depth. */
+    bool m_pushedBack;
+
+    /** The surfel render state to use for intermediate storage when rendering the scene. */
+    SurfelRenderState_Ptr m_surfelRenderState;
+
+    /** The voxel render state to use for intermediate storage when rendering the scene. */
+    VoxelRenderState_Ptr m_voxelRenderState;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The layers into which the scenes are rendered. */
+  std::vector<Layer> m_layers;
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Combines the colour images of the layers into the specified output image, using their depth images for depth testing.
+   *
+   * Each output pixel takes its colour from the layer with the smallest valid depth at that pixel (pushed-back layers are
+   * treated as having an arbitrarily large depth wherever their depths are valid). Pixels for which no layer has a valid
+   * depth are cleared. The output image must be the same size as the layers.
+   *
+   * \param output  The output image.
+   */
+  void composite(const ORUChar4Image_Ptr& output) const;
+
+  /**
+   * \brief Gets the specified layer.
+   *
+   * \param i The index of the layer.
+   * \return  The layer.
+   */
+  Layer& get_layer(size_t i);
+
+  /**
+   * \brief Makes sure that the compositor has the specified number of layers of the specified size, and clears them.
+   *
+   * Existing layers (and their render states) are reused where possible, unless the size of the layers has changed.
+   *
+   * \param layerCount  The number of layers needed.
+   * \param imgSize     The size of the images in each layer.
+   */
+  void prepare_layers(size_t layerCount, const Vector2i& imgSize);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<SceneCompositor> SceneCompositor_Ptr;
+typedef boost::shared_ptr<const SceneCompositor> SceneCompositor_CPtr;
+
+}
+
+#endif
@@ -147,6 +147,30 @@ public:
                                     const ITMLib::ITMIntrinsics& intrinsics, VoxelRenderState_Ptr& renderState, VisualisationType visualisationType,
                                     const boost::optional<Postprocessor>& postprocessor = boost::none) const;
 
+  /**
+   * \brief Generates both a visualisation and a synthetic depth image of a voxel scene from the specified pose, using a single raycast.
+   *
+   * This is equivalent to calling generate_voxel_visualisation followed by generate_depth_from_voxels, except that the depth image
+   * is computed from the raycast that was performed to generate the visualisation, rather than by raycasting the scene again.
+   * Unlike the other functions, it is safe to call this concurrently for different scenes and render states in CPU mode.
+   *
+   * \param output              The location into which to put the output visualisation.
+   * \param depthOutput         The location into which to put the output depth image.
+   * \param scene               The scene to visualise.
+   * \param pose                The pose from which to visualise the scene.
+   * \param intrinsics          The camera intrinsics to use when visualising the scene.
+   * \param renderState         The render state to use for intermediate storage (can be null, in which case a new one will be created).
+   * \param visualisationType   The type of visualisation to generate.
+   * \param depthType           The type of depth calculation to use.
+   * \param postprocessor       An optional function with which to postprocess the visualisation before returning it.
+   *
+   * \throws std::runtime_error If supports_semantics() is false and we try to generate a semantic visualisation of the scene.
+   */
+  void generate_voxel_visualisation_and_depth(const ORUChar4Image_Ptr& output, const ORFloatImage_Ptr& depthOutput, const SpaintVoxelScene_CPtr& scene,
+                                              const ORUtils::SE3Pose& pose, const ITMLib::ITMIntrinsics& intrinsics, VoxelRenderState_Ptr& renderState,
+                                              VisualisationType visualisationType, itmx::DepthVisualiser::DepthType depthType,
+                                              const boost::optional<Postprocessor>& postprocessor = boost::none) const;
+
   /**
    * \brief Gets the depth image from the most recently processed frame for a scene.
    *
@@ -181,6 +205,17 @@ private:
    */
   void make_postprocessed_cpu_copy(const ORUChar4Image *inputRaycast, const boost::optional<Postprocessor>& postprocessor, const ORUChar4Image_Ptr& outputRaycast) const;
 
+  /**
+   * \brief Renders a synthetic depth image from the points that were hit by the most recent raycast into the specified render state.
+   *
+   * \param output      The location into which to put the output image (guaranteed to be accessible on the CPU).
+   * \param pose        The pose from which the raycast was performed.
+   * \param renderState The render state containing the raycast.
+   * \param depthType   The type of depth calculation to use.
+   */
+  void render_depth_from_raycast(const ORFloatImage_Ptr& output, const ORUtils::SE3Pose& pose, const VoxelRenderState_CPtr& renderState,
+                                 itmx::DepthVisualiser::DepthType depthType) const;
+
   /**
    * \brief Resizes the input image into the output image.
    *
@@ -6,6 +6,8 @@
 #ifndef H_SPAINT_SEMANTICVISUALISER
 #define H_SPAINT_SEMANTICVISUALISER
 
+#include <boost/thread/mutex.hpp>
+
 #include <ITMLib/Objects/Camera/ITMIntrinsics.h>
 #include <ITMLib/Objects/RenderStates/ITMRenderState.h>
 
@@ -30,6 +32,11 @@ protected:
   /** A memory block in which to store the colours to use for the semantic labels. */
   boost::shared_ptr<ORUtils::MemoryBlock<Vector3u> > m_labelColoursMB;
 
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** A mutex used to synchronise access to the label colours (so that several scenes can be rendered concurrently). */
+  mutable boost::mutex m_labelColoursMutex;
+
   //#################### CONSTRUCTORS ####################
 protected:
   /**
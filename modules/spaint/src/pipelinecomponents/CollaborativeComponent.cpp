@@ -17,6 +17,7 @@ using boost::bind;
 #include <itmx/ocv/OpenCVUtil.h>
 #endif
 
+#include <orx/base/MemoryBlockFactory.h>
 #include <orx/geometry/GeometryUtil.h>
 #include <orx/relocalisation/Relocaliser.h>
 using namespace orx;
@@ -380,8 +381,9 @@ void CollaborativeComponent::run_relocalisation()
     const SLAMState_CPtr slamStateJ = m_context->get_slam_state(m_bestCandidate->m_sceneJ);
     const View_CPtr viewI = slamStateI->get_view();
 
-    ORFloatImage_Ptr depth(new ORFloatImage(slamStateI->get_depth_image_size(), true, true));
-    ORUChar4Image_Ptr rgb(new ORUChar4Image(slamStateI->get_rgb_image_size(), true, true));
+    MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+    ORFloatImage_Ptr depth = mbf.make_image<float>(slamStateI->get_depth_image_size(), "collaboration");
+    ORUChar4Image_Ptr rgb = mbf.make_image<Vector4u>(slamStateI->get_rgb_image_size(), "collaboration");
 
     VoxelRenderState_Ptr& renderStateD = m_depthRenderStates[m_bestCandidate->m_sceneI];
     m_visualisationGenerator->generate_depth_from_voxels(
@@ -13,7 +13,7 @@
 
 #include "segmentation/SegmentationUtil.h"
 
-#if WITH_ARRAYFIRE && WITH_OPENCV
+#if WITH_OPENCV
 #include "segmentation/BackgroundSubtractingObjectSegmenter.h"
 #endif
 
@@ -108,7 +108,7 @@ void ObjectSegmentationComponent::toggle_output()
 
 const Segmenter_Ptr& ObjectSegmentationComponent::get_segmenter() const
 {
-#if WITH_ARRAYFIRE && WITH_OPENCV
+#if WITH_OPENCV
   if(!m_context->get_segmenter())
   {
     const TouchSettings_Ptr touchSettings(new TouchSettings(m_context->get_resources_dir() + "/TouchSettings.xml"));
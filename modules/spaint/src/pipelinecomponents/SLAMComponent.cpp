@@ -14,6 +14,8 @@ namespace bf = boost::filesystem;
 
 #include <ITMLib/Engines/LowLevel/ITMLowLevelEngineFactory.h>
 #include <ITMLib/Engines/ViewBuilding/ITMViewBuilderFactory.h>
+#include <ITMLib/Engines/Visualisation/ITMSurfelVisualisationEngineFactory.h>
+#include <ITMLib/Engines/Visualisation/ITMVisualisationEngineFactory.h>
 #include <ITMLib/Objects/Camera/ITMCalibIO.h>
 #include <ITMLib/Objects/RenderStates/ITMRenderStateFactory.h>
 using namespace InputSource;
@@ -48,6 +50,7 @@ SLAMComponent::SLAMComponent(const SLAMContext_Ptr& context, const std::string&
 : m_context(context),
   m_detectFiducials(detectFiducials),
   m_fallibleTracker(NULL),
+  m_globalPosesSpecifier(context->get_settings(), "globalPosesSpecifier", ""),
   m_imageSourceEngine(imageSourceEngine),
   m_initialFramesToFuse(50), // FIXME: This value should be passed in rather than hard-coded.
   m_mappingMode(mappingMode),
@@ -75,6 +78,13 @@ SLAMComponent::SLAMComponent(const SLAMContext_Ptr& context, const std::string&
   // Set up the view builder.
   m_viewBuilder.reset(ITMViewBuilderFactory::MakeViewBuilder(m_imageSourceEngine->getCalib(), settings->deviceType));
 
+  // Set up the visualisation engines used to prepare for tracking.
+  m_voxelVisualisationEngine.reset(ITMVisualisationEngineFactory::MakeVisualisationEngine<SpaintVoxel,ITMVoxelIndex>(settings->deviceType));
+  if(mappingMode != MAP_VOXELS_ONLY)
+  {
+    m_surfelVisualisationEngine.reset(ITMSurfelVisualisationEngineFactory<SpaintSurfel>::make_surfel_visualisation_engine(settings->deviceType));
+  }
+
   // Set up the scenes.
   MemoryDeviceType memoryType = settings->GetMemoryType();
   slamState->set_voxel_scene(SpaintVoxelScene_Ptr(new SpaintVoxelScene(&settings->sceneParams, settings->swappingMode == ITMLibSettings::SWAPPINGMODE_ENABLED, memoryType)));
@@ -127,6 +137,11 @@ bool SLAMComponent::get_fusion_enabled() const
   return m_fusionEnabled;
 }
 
+const std::string& SLAMComponent::get_mirror_scene_id() const
+{
+  return m_mirrorSceneID;
+}
+
 const std::string& SLAMComponent::get_scene_id() const
 {
   return m_sceneID;
@@ -326,12 +341,12 @@ bool SLAMComponent::process_frame()
   // If we're using surfel mapping, render a supersampled index image to use when finding surfel correspondences in the next frame.
   if(m_mappingMode != MAP_VOXELS_ONLY)
   {
-    m_context->get_surfel_visualisation_engine()->FindSurfaceSuper(surfelScene.get(), trackingState->pose_d, &view->calib.intrinsics_d, USR_RENDER, liveSurfelRenderState.get());
+    m_surfelVisualisationEngine->FindSurfaceSuper(surfelScene.get(), trackingState->pose_d, &view->calib.intrinsics_d, USR_RENDER, liveSurfelRenderState.get());
   }
 
   // If we're using a composite image source engine, the current sub-engine has run out of images and we're not using global poses, disable fusion.
   CompositeImageSourceEngine_CPtr compositeImageSourceEngine = boost::dynamic_pointer_cast<const CompositeImageSourceEngine>(m_imageSourceEngine);
-  const bool usingGlobalPoses = m_context->get_settings()->get_first_value<std::string>("globalPosesSpecifier", "") != "";
+  const bool usingGlobalPoses = *m_globalPosesSpecifier != "";
   if(compositeImageSourceEngine && !compositeImageSourceEngine->getCurrentSubengine()->hasMoreImages() && !usingGlobalPoses) m_fusionEnabled = false;
 
   // If we're using a fiducial detector and the user wants to detect fiducials and the tracking is good, try to detect fiducial markers
@@ -445,12 +460,21 @@ void SLAMComponent::set_mapping_client(const MappingClient_Ptr& mappingClient)
     RGBDCalibrationMessage calibMsg;
     calibMsg.set_calib(m_imageSourceEngine->getCalib());
 
-    // TODO: Allow these to be configured from the command line.
+    // Determine the depth compression type to use. Note that temporal RVL compression codes each depth image relative to the one
+    // before it, so the server will drop the connection if any depth image fails to arrive or cannot be decoded.
+#ifdef WITH_OPENCV
+    const DepthCompressionType defaultDepthCompressionType = DEPTH_COMPRESSION_PNG;
+#else
+    const DepthCompressionType defaultDepthCompressionType = DEPTH_COMPRESSION_NONE;
+#endif
+    calibMsg.set_depth_compression_type(
+      m_context->get_settings()->get_first_value<DepthCompressionType>("MappingClient.depthCompressionType", defaultDepthCompressionType)
+    );
+
+    // TODO: Allow this to be configured from the command line.
 #ifdef WITH_OPENCV
-    calibMsg.set_depth_compression_type(DEPTH_COMPRESSION_PNG);
     calibMsg.set_rgb_compression_type(RGB_COMPRESSION_JPG);
 #else
-    calibMsg.set_depth_compression_type(DEPTH_COMPRESSION_NONE);
     calibMsg.set_rgb_compression_type(RGB_COMPRESSION_NONE);
 #endif
 
@@ -500,6 +524,22 @@ std::vector<SE3Pose> SLAMComponent::load_ground_truth_relocalisation_trajectory(
   return groundTruthTrajectory;
 }
 
+Tracker_Ptr SLAMComponent::make_refinement_tracker(const Vector2i& rgbImageSize, const Vector2i& depthImageSize) const
+{
+  const Settings_CPtr& settings = m_context->get_settings();
+
+  std::string trackerConfig = "<tracker type='infinitam'>";
+  std::string trackerParams = settings->get_first_value<std::string>(m_settingsNamespace + "refinementTrackerParams", "");
+  if(trackerParams != "") trackerConfig += "<params>" + trackerParams + "</params>";
+  trackerConfig += "</tracker>";
+
+  const bool trackSurfels = false;
+  FallibleTracker *dummy;
+  return m_context->get_tracker_factory().make_tracker_from_string(
+    trackerConfig, m_sceneID, trackSurfels, rgbImageSize, depthImageSize, m_lowLevelEngine, m_imuCalibrator, settings, dummy
+  );
+}
+
 void SLAMComponent::prepare_for_tracking(TrackingMode trackingMode)
 {
   const SLAMState_Ptr& slamState = m_context->get_slam_state(m_sceneID);
@@ -512,7 +552,7 @@ void SLAMComponent::prepare_for_tracking(TrackingMode trackingMode)
     {
       const SpaintSurfelScene_Ptr& surfelScene = slamState->get_surfel_scene();
       const SurfelRenderState_Ptr& liveSurfelRenderState = slamState->get_live_surfel_render_state();
-      m_trackingController->Prepare(trackingState.get(), surfelScene.get(), view.get(), m_context->get_surfel_visualisation_engine().get(), liveSurfelRenderState.get());
+      m_trackingController->Prepare(trackingState.get(), surfelScene.get(), view.get(), m_surfelVisualisationEngine.get(), liveSurfelRenderState.get());
       break;
     }
     case TRACK_VOXELS:
@@ -520,7 +560,7 @@ void SLAMComponent::prepare_for_tracking(TrackingMode trackingMode)
     {
       const SpaintVoxelScene_Ptr& voxelScene = slamState->get_voxel_scene();
       const VoxelRenderState_Ptr& liveVoxelRenderState = slamState->get_live_voxel_render_state();
-      m_trackingController->Prepare(trackingState.get(), voxelScene.get(), view.get(), m_context->get_voxel_visualisation_engine().get(), liveVoxelRenderState.get());
+      m_trackingController->Prepare(trackingState.get(), voxelScene.get(), view.get(), m_voxelVisualisationEngine.get(), liveVoxelRenderState.get());
       break;
     }
   }
@@ -591,19 +631,12 @@ Relocaliser_Ptr SLAMComponent::refine_with_icp(const Relocaliser_Ptr& relocalise
   const Settings_CPtr& settings = m_context->get_settings();
   const SpaintVoxelScene_Ptr& voxelScene = m_context->get_slam_state(m_sceneID)->get_voxel_scene();
 
-  std::string trackerConfig = "<tracker type='infinitam'>";
-  std::string trackerParams = settings->get_first_value<std::string>(m_settingsNamespace + "refinementTrackerParams", "");
-  if(trackerParams != "") trackerConfig += "<params>" + trackerParams + "</params>";
-  trackerConfig += "</tracker>";
-
-  const bool trackSurfels = false;
-  FallibleTracker *dummy;
-  Tracker_Ptr tracker = m_context->get_tracker_factory().make_tracker_from_string(
-    trackerConfig, m_sceneID, trackSurfels, rgbImageSize, depthImageSize, m_lowLevelEngine, m_imuCalibrator, settings, dummy
-  );
+  typedef ICPRefiningRelocaliser<SpaintVoxel,ITMVoxelIndex> ICPRelocaliser;
+  const ICPRelocaliser::TrackerMaker trackerMaker = boost::bind(&SLAMComponent::make_refinement_tracker, this, _1, _2);
 
-  return Relocaliser_Ptr(new ICPRefiningRelocaliser<SpaintVoxel,ITMVoxelIndex>(
-    relocaliser, tracker, rgbImageSize, depthImageSize, m_imageSourceEngine->getCalib(), voxelScene, m_denseVoxelMapper, settings
+  return Relocaliser_Ptr(new ICPRelocaliser(
+    relocaliser, trackerMaker(rgbImageSize, depthImageSize), rgbImageSize, depthImageSize,
+    m_imageSourceEngine->getCalib(), voxelScene, m_denseVoxelMapper, settings, trackerMaker
   ));
 }
 
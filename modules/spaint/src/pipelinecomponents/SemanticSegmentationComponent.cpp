@@ -62,13 +62,15 @@ SemanticSegmentationComponent::SemanticSegmentationComponent(const SemanticSegme
   // Set up the memory blocks needed for prediction and training.
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
   const size_t featureCount = m_featureCalculator->get_feature_count();
-  m_predictionFeaturesMB = mbf.make_block<float>(m_maxPredictionVoxelCount * featureCount);
-  m_predictionLabelsMB = mbf.make_block<SpaintVoxel::PackedLabel>(m_maxPredictionVoxelCount);
-  m_predictionVoxelLocationsMB = mbf.make_block<Vector3s>(m_maxPredictionVoxelCount);
-  m_trainingFeaturesMB = mbf.make_block<float>(maxTrainingVoxelCount * featureCount);
-  m_trainingLabelMaskMB = mbf.make_block<bool>(maxLabelCount);
-  m_trainingVoxelCountsMB = mbf.make_block<unsigned int>(maxLabelCount);
-  m_trainingVoxelLocationsMB = mbf.make_block<Vector3s>(maxTrainingVoxelCount);
+  const std::string tag = "semantic segmentation";
+  m_predictionFeaturesMB = mbf.make_block<float>(m_maxPredictionVoxelCount * featureCount, tag);
+  m_predictionLabelsMB = mbf.make_block<SpaintVoxel::PackedLabel>(m_maxPredictionVoxelCount, tag);
+  m_predictedLabels.resize(m_maxPredictionVoxelCount);
+  m_predictionVoxelLocationsMB = mbf.make_block<Vector3s>(m_maxPredictionVoxelCount, tag);
+  m_trainingFeaturesMB = mbf.make_block<float>(maxTrainingVoxelCount * featureCount, tag);
+  m_trainingLabelMaskMB = mbf.make_block<bool>(maxLabelCount, tag);
+  m_trainingVoxelCountsMB = mbf.make_block<unsigned int>(maxLabelCount, tag);
+  m_trainingVoxelLocationsMB = mbf.make_block<Vector3s>(maxTrainingVoxelCount, tag);
 
   // Register the relevant decision function generators with the factory.
   DecisionFunctionGeneratorFactory<SpaintVoxel::Label>::instance().register_maker(
@@ -106,7 +108,7 @@ void SemanticSegmentationComponent::run_feature_inspection(const VoxelRenderStat
   if(!selection || selection->dataSize != 1) return;
 
   // Calculate the feature descriptor for the selected voxel.
-  boost::shared_ptr<ORUtils::MemoryBlock<float> > featuresMB = MemoryBlockFactory::instance().make_block<float>(m_featureCalculator->get_feature_count());
+  boost::shared_ptr<ORUtils::MemoryBlock<float> > featuresMB = MemoryBlockFactory::instance().make_block<float>(m_featureCalculator->get_feature_count(), "semantic segmentation");
   m_featureCalculator->calculate_features(*selection, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get(), *featuresMB);
 
 #ifdef WITH_OPENCV
@@ -138,17 +140,16 @@ void SemanticSegmentationComponent::run_prediction(const VoxelRenderState_CPtr&
 
   // Calculate feature descriptors for the sampled voxels.
   m_featureCalculator->calculate_features(*m_predictionVoxelLocationsMB, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get(), *m_predictionFeaturesMB);
-  std::vector<Descriptor_CPtr> descriptors = ForestUtil::make_descriptors(*m_predictionFeaturesMB, m_maxPredictionVoxelCount, m_featureCalculator->get_feature_count());
 
-  // Predict labels for the voxels based on the feature descriptors.
-  SpaintVoxel::PackedLabel *labels = m_predictionLabelsMB->GetData(MEMORYDEVICE_CPU);
+  // Predict labels for the voxels based on the feature descriptors (working directly on the feature memory block).
+  m_predictionFeaturesMB->UpdateHostFromDevice();
+  const size_t featureCount = m_featureCalculator->get_feature_count();
+  m_forest->predict(m_predictionFeaturesMB->GetData(MEMORYDEVICE_CPU), m_maxPredictionVoxelCount, featureCount, &m_predictedLabels[0]);
 
-#ifdef WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < static_cast<int>(m_maxPredictionVoxelCount); ++i)
+  SpaintVoxel::PackedLabel *labels = m_predictionLabelsMB->GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0; i < m_maxPredictionVoxelCount; ++i)
   {
-    labels[i] = SpaintVoxel::PackedLabel(m_forest->predict(descriptors[i]), SpaintVoxel::LG_FOREST);
+    labels[i] = SpaintVoxel::PackedLabel(m_predictedLabels[i], SpaintVoxel::LG_FOREST);
   }
 
   m_predictionLabelsMB->UpdateDeviceFromHost();
@@ -195,19 +196,22 @@ void SemanticSegmentationComponent::run_training(const VoxelRenderState_CPtr& re
   // Compute feature vectors for the sampled voxels.
   m_featureCalculator->calculate_features(*m_trainingVoxelLocationsMB, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get(), *m_trainingFeaturesMB);
 
-  // Make the training examples.
-  typedef boost::shared_ptr<const Example<SpaintVoxel::Label> > Example_CPtr;
-  std::vector<Example_CPtr> examples = ForestUtil::make_examples<SpaintVoxel::Label>(
+  // Make the training data.
+  FeatureMatrix features;
+  std::vector<SpaintVoxel::Label> labels;
+  ForestUtil::make_training_data(
     *m_trainingFeaturesMB,
     *m_trainingVoxelCountsMB,
     m_featureCalculator->get_feature_count(),
     m_maxTrainingVoxelsPerLabel,
-    maxLabelCount
+    maxLabelCount,
+    features,
+    labels
   );
 
   // Train the forest.
   const size_t splitBudget = 20;
-  m_forest->add_examples(examples);
+  m_forest->add_examples(features, labels);
   m_forest->train(splitBudget);
 }
 
@@ -5,6 +5,13 @@
 
 #include "sampling/cpu/PerLabelVoxelSampler_CPU.h"
 
+#include <algorithm>
+#include <vector>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
 #include "sampling/shared/PerLabelVoxelSampler_Shared.h"
 
 namespace spaint {
@@ -17,117 +24,138 @@ PerLabelVoxelSampler_CPU::PerLabelVoxelSampler_CPU(size_t maxLabelCount, size_t
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void PerLabelVoxelSampler_CPU::calculate_voxel_mask_prefix_sums(const ORUtils::MemoryBlock<bool>& labelMaskMB) const
+void PerLabelVoxelSampler_CPU::calculate_tile_label_offsets() const
 {
-  const bool *labelMask = labelMaskMB.GetData(MEMORYDEVICE_CPU);
-  const unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CPU);
-  unsigned int *voxelMaskPrefixSums = m_voxelMaskPrefixSumsMB->GetData(MEMORYDEVICE_CPU);
+  const unsigned int *tileLabelCounts = m_tileLabelCountsMB->GetData(MEMORYDEVICE_CPU);
+  unsigned int *tileLabelOffsets = m_tileLabelOffsetsMB->GetData(MEMORYDEVICE_CPU);
 
-  // For each possible label:
-  const int stride = m_raycastResultSize + 1;
-  for(size_t k = 0; k < m_maxLabelCount; ++k)
-  {
-    // If the label is not currently in use, continue.
-    if(!labelMask[k]) continue;
+  // Split the counts into chunks, one per thread, and scan each chunk independently (recording the total for each chunk).
+  const int elementCount = static_cast<int>(m_maxLabelCount) * m_tileCount + 1;
+#ifdef WITH_OPENMP
+  const int chunkCount = std::max(1, std::min(omp_get_max_threads(), elementCount));
+#else
+  const int chunkCount = 1;
+#endif
 
-    // Calculate the prefix sum of the voxel mask.
-    const size_t offset = k * stride;
-    voxelMaskPrefixSums[offset] = 0;
-    for(int i = 1; i < stride; ++i)
+  std::vector<unsigned int> chunkOffsets(chunkCount + 1, 0);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int chunk = 0; chunk < chunkCount; ++chunk)
+  {
+    const int begin = elementCount * chunk / chunkCount, end = elementCount * (chunk + 1) / chunkCount;
+    unsigned int sum = 0;
+    for(int i = begin; i < end; ++i)
     {
-      voxelMaskPrefixSums[offset + i] = voxelMaskPrefixSums[offset + (i - 1)] + voxelMasks[offset + (i - 1)];
+      tileLabelOffsets[i] = sum;
+      sum += tileLabelCounts[i];
     }
+    chunkOffsets[chunk + 1] = sum;
   }
-}
 
-void PerLabelVoxelSampler_CPU::calculate_voxel_masks(const ORFloat4Image *raycastResult,
-                                                     const SpaintVoxel *voxelData,
-                                                     const ITMVoxelIndex::IndexData *indexData) const
-{
-  const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
-  unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CPU);
+  // Scan the chunk totals to find the offset of each chunk, and add the offsets to the scans of the chunks.
+  for(int chunk = 1; chunk <= chunkCount; ++chunk)
+  {
+    chunkOffsets[chunk] += chunkOffsets[chunk - 1];
+  }
 
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
-  for(int voxelIndex = 0; voxelIndex < m_raycastResultSize; ++voxelIndex)
+  for(int chunk = 1; chunk < chunkCount; ++chunk)
   {
-    // Update the voxel masks based on the contents of the voxel.
-    update_masks_for_voxel(
-      voxelIndex,
-      raycastResultData,
-      m_raycastResultSize,
-      voxelData,
-      indexData,
-      m_maxLabelCount,
-      voxelMasks
-    );
+    const int begin = elementCount * chunk / chunkCount, end = elementCount * (chunk + 1) / chunkCount;
+    for(int i = begin; i < end; ++i)
+    {
+      tileLabelOffsets[i] += chunkOffsets[chunk];
+    }
   }
 }
 
-void PerLabelVoxelSampler_CPU::write_candidate_voxel_counts(const ORUtils::MemoryBlock<bool>& labelMaskMB,
-                                                            ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const
+void PerLabelVoxelSampler_CPU::count_candidate_voxels(const ORFloat4Image *raycastResult,
+                                                      const SpaintVoxel *voxelData,
+                                                      const ITMVoxelIndex::IndexData *indexData) const
 {
-  const bool *labelMask = labelMaskMB.GetData(MEMORYDEVICE_CPU);
-  const unsigned int *voxelMaskPrefixSums = m_voxelMaskPrefixSumsMB->GetData(MEMORYDEVICE_CPU);
-  unsigned int *voxelCountsForLabels = voxelCountsForLabelsMB.GetData(MEMORYDEVICE_CPU);
+  const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
+  unsigned int *tileLabelCounts = m_tileLabelCountsMB->GetData(MEMORYDEVICE_CPU);
+  int *voxelLabels = m_voxelLabelsMB->GetData(MEMORYDEVICE_CPU);
 
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
-  for(int k = 0; k < static_cast<int>(m_maxLabelCount); ++k)
+  for(int tileIndex = 0; tileIndex < m_tileCount; ++tileIndex)
   {
-    write_candidate_voxel_count(k, m_raycastResultSize, labelMask, voxelMaskPrefixSums, voxelCountsForLabels);
+    // Determine the labels for which the voxels in the tile are candidates.
+    const int begin = tileIndex * TILE_SIZE, end = std::min(begin + TILE_SIZE, m_raycastResultSize);
+    for(int voxelIndex = begin; voxelIndex < end; ++voxelIndex)
+    {
+      write_voxel_label(voxelIndex, raycastResultData, voxelData, indexData, m_maxLabelCount, voxelLabels);
+    }
+
+    // Count the candidates for each label in the tile.
+    count_candidate_voxels_in_tile(tileIndex, TILE_SIZE, m_tileCount, m_raycastResultSize, voxelLabels, m_maxLabelCount, tileLabelCounts);
   }
 }
 
 void PerLabelVoxelSampler_CPU::write_candidate_voxel_locations(const ORFloat4Image *raycastResult) const
 {
   const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
-  const unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CPU);
-  const unsigned int *voxelMaskPrefixSums = m_voxelMaskPrefixSumsMB->GetData(MEMORYDEVICE_CPU);
+  const unsigned int *tileLabelOffsets = m_tileLabelOffsetsMB->GetData(MEMORYDEVICE_CPU);
+  const int *voxelLabels = m_voxelLabelsMB->GetData(MEMORYDEVICE_CPU);
   Vector3s *candidateVoxelLocations = m_candidateVoxelLocationsMB->GetData(MEMORYDEVICE_CPU);
+  unsigned int *tileLabelCounts = m_tileLabelCountsMB->GetData(MEMORYDEVICE_CPU);
 
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
-  for(int voxelIndex = 0; voxelIndex < m_raycastResultSize; ++voxelIndex)
+  for(int tileIndex = 0; tileIndex < m_tileCount; ++tileIndex)
   {
-    write_candidate_voxel_location(
-      voxelIndex,
+    write_candidate_voxel_locations_in_tile(
+      tileIndex,
+      TILE_SIZE,
+      m_tileCount,
       raycastResultData,
       m_raycastResultSize,
-      voxelMasks,
-      voxelMaskPrefixSums,
-      m_maxLabelCount,
+      voxelLabels,
+      tileLabelOffsets,
+      tileLabelCounts,
       candidateVoxelLocations
     );
   }
 }
 
-void PerLabelVoxelSampler_CPU::write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB,
-                                                             ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB) const
+void PerLabelVoxelSampler_CPU::write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB, unsigned int seed,
+                                                             ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB,
+                                                             ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const
 {
   const Vector3s *candidateVoxelLocations = m_candidateVoxelLocationsMB->GetData(MEMORYDEVICE_CPU);
-  const int *candidateVoxelIndices = m_candidateVoxelIndicesMB->GetData(MEMORYDEVICE_CPU);
   const bool *labelMask = labelMaskMB.GetData(MEMORYDEVICE_CPU);
+  const unsigned int *tileLabelOffsets = m_tileLabelOffsetsMB->GetData(MEMORYDEVICE_CPU);
   Vector3s *sampledVoxelLocations = sampledVoxelLocationsMB.GetData(MEMORYDEVICE_CPU);
+  unsigned int *voxelCountsForLabels = voxelCountsForLabelsMB.GetData(MEMORYDEVICE_CPU);
 
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
-  for(int voxelIndex = 0; voxelIndex < static_cast<int>(m_maxVoxelsPerLabel); ++voxelIndex)
+  for(int k = 0; k < static_cast<int>(m_maxLabelCount); ++k)
   {
-    copy_sampled_voxel_locations(
-      voxelIndex,
-      labelMask,
-      m_maxLabelCount,
-      m_maxVoxelsPerLabel,
-      m_raycastResultSize,
-      candidateVoxelLocations,
-      candidateVoxelIndices,
-      sampledVoxelLocations
-    );
+    write_sampled_voxel_count(k, m_tileCount, labelMask, m_maxVoxelsPerLabel, tileLabelOffsets, voxelCountsForLabels);
+
+    for(int voxelIndex = 0; voxelIndex < static_cast<int>(m_maxVoxelsPerLabel); ++voxelIndex)
+    {
+      write_sampled_voxel_location(
+        k,
+        voxelIndex,
+        m_tileCount,
+        labelMask,
+        m_maxVoxelsPerLabel,
+        tileLabelOffsets,
+        candidateVoxelLocations,
+        seed,
+        sampledVoxelLocations
+      );
+    }
   }
 }
 
@@ -5,8 +5,6 @@
 
 #include "sampling/cuda/PerLabelVoxelSampler_CUDA.h"
 
-#include <cassert>
-
 #ifdef _MSC_VER
   // Suppress some VC++ warnings that are produced when including the Thrust headers.
   #pragma warning(disable:4267)
@@ -28,44 +26,49 @@ namespace spaint {
 
 //#################### CUDA KERNELS ####################
 
-__global__ void ck_calculate_voxel_masks(const Vector4f *raycastResult, int raycastResultSize,
-                                         const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
-                                         size_t maxLabelCount, unsigned char *voxelMasks)
+__global__ void ck_count_candidate_voxels(int tileSize, int tileCount, int raycastResultSize, const int *voxelLabels,
+                                          size_t maxLabelCount, unsigned int *tileLabelCounts)
 {
-  int voxelIndex = threadIdx.x + blockDim.x * blockIdx.x;
-  if(voxelIndex < raycastResultSize)
+  int tileIndex = threadIdx.x + blockDim.x * blockIdx.x;
+  if(tileIndex < tileCount)
   {
-    update_masks_for_voxel(voxelIndex, raycastResult, raycastResultSize, voxelData, indexData, maxLabelCount, voxelMasks);
+    count_candidate_voxels_in_tile(tileIndex, tileSize, tileCount, raycastResultSize, voxelLabels, maxLabelCount, tileLabelCounts);
   }
 }
 
-__global__ void ck_copy_sampled_voxel_locations(const bool *labelMask, size_t maxLabelCount, size_t maxVoxelsPerLabel, int raycastResultSize,
-                                                const Vector3s *voxelLocationsByClass, const int *randomVoxelIndices,
-                                                Vector3s *sampledVoxelLocations)
+__global__ void ck_write_candidate_voxel_locations(int tileSize, int tileCount, const Vector4f *raycastResult, int raycastResultSize,
+                                                   const int *voxelLabels, const unsigned int *tileLabelOffsets, unsigned int *tileLabelCounts,
+                                                   Vector3s *candidateVoxelLocations)
 {
-  int voxelIndex = threadIdx.x + blockDim.x * blockIdx.x;
-  if(voxelIndex < maxVoxelsPerLabel)
+  int tileIndex = threadIdx.x + blockDim.x * blockIdx.x;
+  if(tileIndex < tileCount)
   {
-    copy_sampled_voxel_locations(voxelIndex, labelMask, maxLabelCount, maxVoxelsPerLabel, raycastResultSize, voxelLocationsByClass, randomVoxelIndices,
-                                 sampledVoxelLocations);
+    write_candidate_voxel_locations_in_tile(tileIndex, tileSize, tileCount, raycastResult, raycastResultSize, voxelLabels,
+                                            tileLabelOffsets, tileLabelCounts, candidateVoxelLocations);
   }
 }
 
-__global__ void ck_write_candidate_voxel_counts(int raycastResultSize, const bool *labelMask, const unsigned int *voxelMaskPrefixSums,
-                                                unsigned int *voxelCountsForLabels)
+__global__ void ck_write_sampled_voxel_locations(int tileCount, const bool *labelMask, size_t maxLabelCount, size_t maxVoxelsPerLabel,
+                                                 const unsigned int *tileLabelOffsets, const Vector3s *candidateVoxelLocations, unsigned int seed,
+                                                 Vector3s *sampledVoxelLocations, unsigned int *voxelCountsForLabels)
 {
-  int label = threadIdx.x + blockDim.x * blockIdx.x;
-  write_candidate_voxel_count(label, raycastResultSize, labelMask, voxelMaskPrefixSums, voxelCountsForLabels);
+  int tid = threadIdx.x + blockDim.x * blockIdx.x;
+  if(tid < static_cast<int>(maxLabelCount * maxVoxelsPerLabel))
+  {
+    const int label = tid / static_cast<int>(maxVoxelsPerLabel), voxelIndex = tid % static_cast<int>(maxVoxelsPerLabel);
+    if(voxelIndex == 0) write_sampled_voxel_count(label, tileCount, labelMask, maxVoxelsPerLabel, tileLabelOffsets, voxelCountsForLabels);
+    write_sampled_voxel_location(label, voxelIndex, tileCount, labelMask, maxVoxelsPerLabel, tileLabelOffsets, candidateVoxelLocations, seed, sampledVoxelLocations);
+  }
 }
 
-__global__ void ck_write_candidate_voxel_locations(const Vector4f *raycastResult, int raycastResultSize,
-                                                   const unsigned char *voxelMasks, const unsigned int *voxelMaskPrefixSums,
-                                                   size_t maxLabelCount, Vector3s *voxelLocations)
+__global__ void ck_write_voxel_labels(const Vector4f *raycastResult, int raycastResultSize,
+                                      const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                      size_t maxLabelCount, int *voxelLabels)
 {
   int voxelIndex = threadIdx.x + blockDim.x * blockIdx.x;
   if(voxelIndex < raycastResultSize)
   {
-    write_candidate_voxel_location(voxelIndex, raycastResult, raycastResultSize, voxelMasks, voxelMaskPrefixSums, maxLabelCount, voxelLocations);
+    write_voxel_label(voxelIndex, raycastResult, voxelData, indexData, maxLabelCount, voxelLabels);
   }
 }
 
@@ -77,82 +80,69 @@ PerLabelVoxelSampler_CUDA::PerLabelVoxelSampler_CUDA(size_t maxLabelCount, size_
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void PerLabelVoxelSampler_CUDA::calculate_voxel_mask_prefix_sums(const ORUtils::MemoryBlock<bool>& labelMaskMB) const
+void PerLabelVoxelSampler_CUDA::calculate_tile_label_offsets() const
 {
-  const bool *labelMask = labelMaskMB.GetData(MEMORYDEVICE_CPU);
-  const unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CUDA);
-  unsigned int *voxelMaskPrefixSums = m_voxelMaskPrefixSumsMB->GetData(MEMORYDEVICE_CUDA);
-
-  // For each possible label:
-  const int stride = m_raycastResultSize + 1;
-  for(size_t k = 0; k < m_maxLabelCount; ++k)
-  {
-    // If the label is not currently in use, continue.
-    if(!labelMask[k]) continue;
-
-    // Calculate the prefix sum of the voxel mask.
-    thrust::device_ptr<const unsigned char> voxelMask(voxelMasks + k * stride);
-    thrust::device_ptr<unsigned int> voxelMaskPrefixSum(voxelMaskPrefixSums + k * stride);
-
-    thrust::exclusive_scan(
-      voxelMask,
-      voxelMask + stride,
-      voxelMaskPrefixSum
-    );
-  }
+  thrust::device_ptr<const unsigned int> tileLabelCounts(m_tileLabelCountsMB->GetData(MEMORYDEVICE_CUDA));
+  thrust::device_ptr<unsigned int> tileLabelOffsets(m_tileLabelOffsetsMB->GetData(MEMORYDEVICE_CUDA));
+
+  // Scan the counts for all labels and tiles in one go (the dummy element at the end of the counts means that the final offset is the total).
+  thrust::exclusive_scan(
+    tileLabelCounts,
+    tileLabelCounts + (m_maxLabelCount * m_tileCount + 1),
+    tileLabelOffsets
+  );
 
 #if DEBUGGING
-  m_voxelMaskPrefixSumsMB->UpdateHostFromDevice();
+  m_tileLabelOffsetsMB->UpdateHostFromDevice();
 #endif
 }
 
-void PerLabelVoxelSampler_CUDA::calculate_voxel_masks(const ORFloat4Image *raycastResult,
-                                                      const SpaintVoxel *voxelData,
-                                                      const ITMVoxelIndex::IndexData *indexData) const
+void PerLabelVoxelSampler_CUDA::count_candidate_voxels(const ORFloat4Image *raycastResult,
+                                                       const SpaintVoxel *voxelData,
+                                                       const ITMVoxelIndex::IndexData *indexData) const
 {
+  // Determine the labels for which the voxels are candidates. We do this in a separate pass with one thread per voxel, so that
+  // the scene lookups (which dominate the cost) can be spread across the whole device rather than just one thread per tile.
   int threadsPerBlock = 256;
   int numBlocks = (m_raycastResultSize + threadsPerBlock - 1) / threadsPerBlock;
-  ck_calculate_voxel_masks<<<numBlocks,threadsPerBlock>>>(
+  ck_write_voxel_labels<<<numBlocks,threadsPerBlock>>>(
     raycastResult->GetData(MEMORYDEVICE_CUDA),
     m_raycastResultSize,
     voxelData,
     indexData,
     m_maxLabelCount,
-    m_voxelMasksMB->GetData(MEMORYDEVICE_CUDA)
+    m_voxelLabelsMB->GetData(MEMORYDEVICE_CUDA)
   );
 
-#if DEBUGGING
-  m_voxelMasksMB->UpdateHostFromDevice();
-#endif
-}
-
-void PerLabelVoxelSampler_CUDA::write_candidate_voxel_counts(const ORUtils::MemoryBlock<bool>& labelMaskMB,
-                                                             ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const
-{
-  // If the label count starts getting too large, we should consider splitting this into multiple thread blocks.
-  int maxLabelCount = static_cast<int>(m_maxLabelCount);
-  assert(maxLabelCount <= 256);
-
-  ck_write_candidate_voxel_counts<<<1,maxLabelCount>>>(
+  // Count the candidates for each label in each tile.
+  numBlocks = (m_tileCount + threadsPerBlock - 1) / threadsPerBlock;
+  ck_count_candidate_voxels<<<numBlocks,threadsPerBlock>>>(
+    TILE_SIZE,
+    m_tileCount,
     m_raycastResultSize,
-    labelMaskMB.GetData(MEMORYDEVICE_CUDA),
-    m_voxelMaskPrefixSumsMB->GetData(MEMORYDEVICE_CUDA),
-    voxelCountsForLabelsMB.GetData(MEMORYDEVICE_CUDA)
+    m_voxelLabelsMB->GetData(MEMORYDEVICE_CUDA),
+    m_maxLabelCount,
+    m_tileLabelCountsMB->GetData(MEMORYDEVICE_CUDA)
   );
 
-  voxelCountsForLabelsMB.UpdateHostFromDevice();
+#if DEBUGGING
+  m_voxelLabelsMB->UpdateHostFromDevice();
+  m_tileLabelCountsMB->UpdateHostFromDevice();
+#endif
 }
 
 void PerLabelVoxelSampler_CUDA::write_candidate_voxel_locations(const ORFloat4Image *raycastResult) const
 {
   int threadsPerBlock = 256;
-  int numBlocks = (m_raycastResultSize + threadsPerBlock - 1) / threadsPerBlock;
+  int numBlocks = (m_tileCount + threadsPerBlock - 1) / threadsPerBlock;
   ck_write_candidate_voxel_locations<<<numBlocks,threadsPerBlock>>>(
+    TILE_SIZE,
+    m_tileCount,
     raycastResult->GetData(MEMORYDEVICE_CUDA),
     m_raycastResultSize,
-    m_voxelMasksMB->GetData(MEMORYDEVICE_CUDA),
-    m_voxelMaskPrefixSumsMB->GetData(MEMORYDEVICE_CUDA),
-    m_maxLabelCount,
+    m_voxelLabelsMB->GetData(MEMORYDEVICE_CUDA),
+    m_tileLabelOffsetsMB->GetData(MEMORYDEVICE_CUDA),
+    m_tileLabelCountsMB->GetData(MEMORYDEVICE_CUDA),
     m_candidateVoxelLocationsMB->GetData(MEMORYDEVICE_CUDA)
   );
 
@@ -161,21 +151,27 @@ void PerLabelVoxelSampler_CUDA::write_candidate_voxel_locations(const ORFloat4Im
 #endif
 }
 
-void PerLabelVoxelSampler_CUDA::write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB,
-                                                              ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB) const
+void PerLabelVoxelSampler_CUDA::write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB, unsigned int seed,
+                                                              ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB,
+                                                              ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const
 {
   int threadsPerBlock = 256;
-  int numBlocks = (static_cast<int>(m_maxVoxelsPerLabel) + threadsPerBlock - 1) / threadsPerBlock;
-  ck_copy_sampled_voxel_locations<<<numBlocks,threadsPerBlock>>>(
+  int numBlocks = (static_cast<int>(m_maxLabelCount * m_maxVoxelsPerLabel) + threadsPerBlock - 1) / threadsPerBlock;
+  ck_write_sampled_voxel_locations<<<numBlocks,threadsPerBlock>>>(
+    m_tileCount,
     labelMaskMB.GetData(MEMORYDEVICE_CUDA),
     m_maxLabelCount,
     m_maxVoxelsPerLabel,
-    m_raycastResultSize,
+    m_tileLabelOffsetsMB->GetData(MEMORYDEVICE_CUDA),
     m_candidateVoxelLocationsMB->GetData(MEMORYDEVICE_CUDA),
-    m_candidateVoxelIndicesMB->GetData(MEMORYDEVICE_CUDA),
-    sampledVoxelLocationsMB.GetData(MEMORYDEVICE_CUDA)
+    seed,
+    sampledVoxelLocationsMB.GetData(MEMORYDEVICE_CUDA),
+    voxelCountsForLabelsMB.GetData(MEMORYDEVICE_CUDA)
   );
 
+  // The numbers of voxels sampled for each label are needed on the CPU to make the training examples.
+  voxelCountsForLabelsMB.UpdateHostFromDevice();
+
 #if DEBUGGING
   sampledVoxelLocationsMB.UpdateHostFromDevice();
 #endif
@@ -65,10 +65,19 @@ ORUCharImage_CPtr BackgroundSubtractingObjectSegmenter::segment(const ORUtils::S
 
   // Make the hand mask.
   static cv::Mat1b handMask = cv::Mat1b::zeros(m_view->rgb->noDims.y, m_view->rgb->noDims.x);
-  const Vector4u *rgbPtr = rgbInput->GetData(MEMORYDEVICE_CPU);
   const uchar *changeMaskPtr = changeMask->GetData(MEMORYDEVICE_CPU);
   const int pixelCount = static_cast<int>(rgbInput->dataSize);
 
+  // Compute the probability of each pixel in the change mask being part of the hand (the pixels outside the change mask
+  // can never be part of the hand mask, so we skip them). If the size of the colour input image has changed since the
+  // last call, the image in which we store the probabilities is reallocated.
+  if(!m_handProbs || m_handProbs->noDims != rgbInput->noDims) m_handProbs.reset(new ORFloatImage(rgbInput->noDims, true, false));
+  if(m_handAppearanceModel) m_handAppearanceModel->compute_posterior_probabilities(rgbInput, m_handProbs, changeMask);
+  else m_handProbs->Clear();
+
+  const float *handProbsPtr = m_handProbs->GetData(MEMORYDEVICE_CPU);
+  const float handProbThreshold = (100 - objectProbThreshold) / 100.0f;
+
   // For each pixel in the current colour input image:
 #if WITH_OPENMP
   #pragma omp parallel for
@@ -76,21 +85,12 @@ ORUCharImage_CPtr BackgroundSubtractingObjectSegmenter::segment(const ORUtils::S
   for(int i = 0; i < pixelCount; ++i)
   {
     // Update the hand mask based on whether the pixel is part of the hand.
-    unsigned char value = 0;
-    if(changeMaskPtr[i])
-    {
-      float handProb = m_handAppearanceModel ? m_handAppearanceModel->compute_posterior_probability(rgbPtr[i].toVector3()) : 0.0f;
-      int handProbThreshold = 100 - objectProbThreshold;
-
 #if 1
-      if(handProb >= handProbThreshold / 100.0f) value = 255;
+    handMask.data[i] = changeMaskPtr[i] && handProbsPtr[i] >= handProbThreshold ? 255 : 0;
 #else
-      // For debugging purposes
-      if(handProb >= handProbThreshold / 100.0f) value = (uchar)(handProb * 255);
+    // For debugging purposes
+    handMask.data[i] = changeMaskPtr[i] && handProbsPtr[i] >= handProbThreshold ? (uchar)(handProbsPtr[i] * 255) : 0;
 #endif
-    }
-
-    handMask.data[i] = value;
   }
 
   // If desired, update the hand mask to only contain components over a certain size.
@@ -8,40 +8,44 @@
 #include <itmx/util/ColourConversion_Shared.h>
 using namespace itmx;
 
-#include <tvgutil/containers/MapUtil.h>
-using namespace tvgutil;
-
 namespace spaint {
 
 //#################### CONSTRUCTORS ####################
 
 ColourAppearanceModel::ColourAppearanceModel(int binsCb, int binsCr)
-: m_binsCb(binsCb), m_binsCr(binsCr)
+: m_binsCb(binsCb),
+  m_binsCr(binsCr),
+  m_histColourGivenObject(binsCb * binsCr, 0),
+  m_histColourGivenNotObject(binsCb * binsCr, 0),
+  m_posteriorTable(binsCb * binsCr, 0.5f),
+  m_totalColourGivenObject(0),
+  m_totalColourGivenNotObject(0)
 {}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
 float ColourAppearanceModel::compute_posterior_probability(const Vector3u& rgbColour) const
 {
-  // If we haven't yet seen enough training data to successfully build our appearance model, early out.
-  if(!m_pmfColourGivenObject || !m_pmfColourGivenNotObject) return 0.5f;
-
-  /*
-  P(object | colour) =                   P(colour | object) * P(object)
-                       -----------------------------------------------------------------
-                       P(colour | object) * P(object) + P(colour | !object) * P(!object)
+  return m_posteriorTable[compute_bin(rgbColour)];
+}
 
-  For simplicity, assume that P(object) = P(!object) = 0.5. Then:
+void ColourAppearanceModel::compute_posterior_probabilities(const ORUChar4Image_CPtr& image, const ORFloatImage_Ptr& posteriors, const ORUCharImage_CPtr& mask) const
+{
+  posteriors->ChangeDims(image->noDims);
 
-  P(object | colour) =            P(colour | object)
-                       ----------------------------------------
-                       P(colour | object) + P(colour | !object)
-  */
-  int bin = compute_bin(rgbColour);
-  float colourGivenObject = MapUtil::lookup(m_pmfColourGivenObject->get_masses(), bin, 0.0f);
-  float colourGivenNotObject = MapUtil::lookup(m_pmfColourGivenNotObject->get_masses(), bin, 0.0f);
-  float denom = colourGivenObject + colourGivenNotObject;
-  return denom > 0.0f ? colourGivenObject / denom : 0.5f;
+  const Vector4u *imagePtr = image->GetData(MEMORYDEVICE_CPU);
+  const uchar *maskPtr = mask ? mask->GetData(MEMORYDEVICE_CPU) : NULL;
+  float *posteriorsPtr = posteriors->GetData(MEMORYDEVICE_CPU);
+  const float *posteriorTable = &m_posteriorTable[0];
+  const int pixelCount = static_cast<int>(image->dataSize);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < pixelCount; ++i)
+  {
+    posteriorsPtr[i] = !maskPtr || maskPtr[i] ? posteriorTable[compute_bin(imagePtr[i].toVector3())] : 0.0f;
+  }
 }
 
 void ColourAppearanceModel::train(const ORUChar4Image_CPtr& image, const ORUCharImage_CPtr& objectMask)
@@ -52,12 +56,20 @@ void ColourAppearanceModel::train(const ORUChar4Image_CPtr& image, const ORUChar
   for(int i = 0, size = static_cast<int>(image->dataSize); i < size; ++i)
   {
     int bin = compute_bin(imagePtr[i].toVector3());
-    (objectMaskPtr[i] ? m_histColourGivenObject : m_histColourGivenNotObject).add(bin);
+    if(objectMaskPtr[i])
+    {
+      ++m_histColourGivenObject[bin];
+      ++m_totalColourGivenObject;
+    }
+    else
+    {
+      ++m_histColourGivenNotObject[bin];
+      ++m_totalColourGivenNotObject;
+    }
   }
 
-  // Update the likelihood PMFs from the histograms.
-  if(m_histColourGivenObject.get_count() > 0) m_pmfColourGivenObject.reset(new ProbabilityMassFunction<int>(m_histColourGivenObject));
-  if(m_histColourGivenNotObject.get_count() > 0) m_pmfColourGivenNotObject.reset(new ProbabilityMassFunction<int>(m_histColourGivenNotObject));
+  // Update the posterior table from the histograms.
+  update_posterior_table();
 }
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
@@ -72,4 +84,31 @@ int ColourAppearanceModel::compute_bin(const Vector3u& rgbColour) const
   return y * m_binsCb + x;
 }
 
+void ColourAppearanceModel::update_posterior_table()
+{
+  // If we haven't yet seen enough training data to successfully build our appearance model, leave the table alone.
+  if(m_totalColourGivenObject == 0 || m_totalColourGivenNotObject == 0) return;
+
+  /*
+  P(object | colour) =                   P(colour | object) * P(object)
+                       -----------------------------------------------------------------
+                       P(colour | object) * P(object) + P(colour | !object) * P(!object)
+
+  For simplicity, assume that P(object) = P(!object) = 0.5. Then:
+
+  P(object | colour) =            P(colour | object)
+                       ----------------------------------------
+                       P(colour | object) + P(colour | !object)
+  */
+  const float oneOverTotalColourGivenObject = 1.0f / m_totalColourGivenObject;
+  const float oneOverTotalColourGivenNotObject = 1.0f / m_totalColourGivenNotObject;
+  for(size_t bin = 0, binCount = m_posteriorTable.size(); bin < binCount; ++bin)
+  {
+    float colourGivenObject = m_histColourGivenObject[bin] * oneOverTotalColourGivenObject;
+    float colourGivenNotObject = m_histColourGivenNotObject[bin] * oneOverTotalColourGivenNotObject;
+    float denom = colourGivenObject + colourGivenNotObject;
+    m_posteriorTable[bin] = denom > 0.0f ? colourGivenObject / denom : 0.5f;
+  }
+}
+
 }
@@ -0,0 +1,305 @@
+/**
+ * spaint: TouchComponentAnalyser.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "touch/TouchComponentAnalyser.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+namespace spaint {
+
+//#################### CONSTRUCTORS ####################
+
+TouchComponentAnalyser::TouchComponentAnalyser(int width, int height)
+: m_changeMask(width * height, 0),
+  m_columnSums((height + 1) * width, 0),
+  m_diffInMm(width * height, 0),
+  m_height(height),
+  m_labels(width * height, -1),
+  m_parents(width * height, -1),
+  m_scratch(width * height, 0),
+  m_width(width)
+{}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void TouchComponentAnalyser::calculate_histogram_descriptor(int component, std::vector<float>& descriptor) const
+{
+  const int binCount = 64;
+  descriptor.assign(binCount, 0.0f);
+
+  // Accumulate the histogram of the differences within the component, which can only be found within its bounding box.
+  const Component& c = m_components[component];
+  for(int y = c.m_minY; y <= c.m_maxY; ++y)
+  {
+    for(int x = c.m_minX; x <= c.m_maxX; ++x)
+    {
+      const int i = y * m_width + x;
+      if(m_labels[i] == component) ++descriptor[std::min(binCount - 1, m_diffInMm[i] * binCount / 255)];
+    }
+  }
+
+  // All of the pixels outside the component have a difference of zero, and so fall into the first bin.
+  descriptor[0] += static_cast<float>(m_width * m_height - c.m_area);
+}
+
+void TouchComponentAnalyser::detect_changes(const float *rawDepth, const float *depthRaycast, float maxRawDepth, float changeThreshold, int morphKernelSize,
+                                            float *thresholdedRawDepth, float *diffRawRaycast)
+{
+  const int pixelCount = m_width * m_height;
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < pixelCount; ++i)
+  {
+    // Mask out the parts of the raw depth image that are too far away.
+    float raw = rawDepth[i];
+    if(raw > maxRawDepth) raw = -1.0f;
+    thresholdedRawDepth[i] = raw;
+
+    // Calculate the absolute difference between the raw depth and the raycasted depth (if both are valid).
+    const float raycast = depthRaycast[i];
+    const float diff = raw >= 0.0f && raycast >= 0.0f ? fabs(raw - raycast) : -1.0f;
+    diffRawRaycast[i] = diff;
+
+    // Convert the difference to millimetres, and threshold it to determine whether the pixel has changed.
+    m_diffInMm[i] = static_cast<unsigned char>(std::min(std::max(diff * 1000.0f, 0.0f), 255.0f));
+    m_changeMask[i] = diff > changeThreshold ? 1 : 0;
+  }
+
+  // Apply a morphological opening operation to the change mask to reduce noise.
+  open(&m_changeMask[0], morphKernelSize);
+
+  // Find the connected components of the change mask.
+  label_components(&m_changeMask[0]);
+}
+
+const std::vector<unsigned char>& TouchComponentAnalyser::get_change_mask() const
+{
+  return m_changeMask;
+}
+
+const std::vector<TouchComponentAnalyser::Component>& TouchComponentAnalyser::get_components() const
+{
+  return m_components;
+}
+
+const std::vector<unsigned char>& TouchComponentAnalyser::get_diff_in_mm() const
+{
+  return m_diffInMm;
+}
+
+const std::vector<int>& TouchComponentAnalyser::get_labels() const
+{
+  return m_labels;
+}
+
+void TouchComponentAnalyser::label_components(const unsigned char *mask)
+{
+  const int pixelCount = m_width * m_height;
+
+  // Split the image into horizontal strips, and build a union-find forest for each strip in parallel. Since the trees
+  // for each strip only ever refer to pixels within that strip, the strips can be processed without any synchronisation.
+#ifdef WITH_OPENMP
+  const int stripCount = std::max(1, std::min(omp_get_max_threads(), m_height));
+#else
+  const int stripCount = 1;
+#endif
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int strip = 0; strip < stripCount; ++strip)
+  {
+    const int yBegin = m_height * strip / stripCount, yEnd = m_height * (strip + 1) / stripCount;
+    for(int y = yBegin; y < yEnd; ++y)
+    {
+      for(int x = 0; x < m_width; ++x)
+      {
+        const int i = y * m_width + x;
+        if(!mask[i])
+        {
+          m_parents[i] = -1;
+          continue;
+        }
+
+        m_parents[i] = i;
+        if(x > 0 && mask[i - 1]) unite(i, i - 1);
+        if(y > yBegin && mask[i - m_width]) unite(i, i - m_width);
+      }
+    }
+  }
+
+  // Merge the trees that span the boundaries between the strips.
+  for(int strip = 1; strip < stripCount; ++strip)
+  {
+    const int y = m_height * strip / stripCount;
+    for(int x = 0; x < m_width; ++x)
+    {
+      const int i = y * m_width + x;
+      if(mask[i] && mask[i - m_width]) unite(i, i - m_width);
+    }
+  }
+
+  // Find the root of each pixel's tree in parallel (this only reads the forest, so no synchronisation is needed).
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < pixelCount; ++i)
+  {
+    int root = m_parents[i];
+    if(root != -1)
+    {
+      while(m_parents[root] != root) root = m_parents[root];
+    }
+    m_labels[i] = root;
+  }
+
+  // Assign consecutive indices to the components and calculate their statistics. Since the root of each component is its first
+  // pixel in raster order, each root is encountered before the other pixels in its component. Once a root has been encountered,
+  // we no longer need its entry in the forest, so we reuse it to record the index of the component.
+  m_components.clear();
+  for(int y = 0, i = 0; y < m_height; ++y)
+  {
+    for(int x = 0; x < m_width; ++x, ++i)
+    {
+      const int root = m_labels[i];
+      if(root == -1) continue;
+
+      if(root == i)
+      {
+        m_parents[i] = static_cast<int>(m_components.size());
+        const Component c = { 0, 0, x, y, x, y };
+        m_components.push_back(c);
+      }
+
+      const int component = m_parents[root];
+      m_labels[i] = component;
+
+      Component& c = m_components[component];
+      ++c.m_area;
+      c.m_diffSumMm += m_diffInMm[i];
+      c.m_maxX = std::max(c.m_maxX, x);
+      c.m_maxY = y;
+      c.m_minX = std::min(c.m_minX, x);
+    }
+  }
+}
+
+void TouchComponentAnalyser::make_component_diff_image(int component, unsigned char *image) const
+{
+  const int pixelCount = m_width * m_height;
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < pixelCount; ++i)
+  {
+    image[i] = m_labels[i] == component ? m_diffInMm[i] : 0;
+  }
+}
+
+void TouchComponentAnalyser::open(unsigned char *mask, int kernelSize)
+{
+  if(kernelSize < 1) kernelSize = 1;
+  if(kernelSize % 2 == 0) ++kernelSize;
+
+  const int radius = kernelSize / 2;
+  apply_morphological_operation(mask, radius, true);
+  apply_morphological_operation(mask, radius, false);
+}
+
+std::vector<int> TouchComponentAnalyser::select_candidate_components(int minArea, int maxArea) const
+{
+  std::vector<int> candidates;
+  for(int i = 0, componentCount = static_cast<int>(m_components.size()); i < componentCount; ++i)
+  {
+    const int area = m_components[i].m_area;
+    if(minArea <= area && area <= maxArea) candidates.push_back(i);
+  }
+  return candidates;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void TouchComponentAnalyser::apply_morphological_operation(unsigned char *mask, int radius, bool erode)
+{
+  // Apply the horizontal pass, using a running count of the set pixels in the window around each pixel.
+  // A pixel survives an erosion if every pixel in its (clipped) window is set, and is set by a dilation
+  // if any pixel in its window is set.
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int y = 0; y < m_height; ++y)
+  {
+    const unsigned char *in = mask + y * m_width;
+    unsigned char *out = &m_scratch[y * m_width];
+
+    int count = 0;
+    for(int x = 0; x < radius && x < m_width; ++x) count += in[x];
+
+    for(int x = 0; x < m_width; ++x)
+    {
+      if(x + radius < m_width) count += in[x + radius];
+      if(x - radius - 1 >= 0) count -= in[x - radius - 1];
+
+      const int windowSize = std::min(x + radius, m_width - 1) - std::max(x - radius, 0) + 1;
+      out[x] = (erode ? count == windowSize : count > 0) ? 1 : 0;
+    }
+  }
+
+  // Calculate column-wise prefix sums of the result of the horizontal pass. We process the image a row at a
+  // time so that the accesses to memory are contiguous.
+  std::fill(m_columnSums.begin(), m_columnSums.begin() + m_width, 0);
+  for(int y = 0; y < m_height; ++y)
+  {
+    const int *prev = &m_columnSums[y * m_width];
+    int *cur = &m_columnSums[(y + 1) * m_width];
+    const unsigned char *in = &m_scratch[y * m_width];
+    for(int x = 0; x < m_width; ++x) cur[x] = prev[x] + in[x];
+  }
+
+  // Apply the vertical pass, using the prefix sums to count the set pixels in the window around each pixel.
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int y = 0; y < m_height; ++y)
+  {
+    const int yBegin = std::max(y - radius, 0), yEnd = std::min(y + radius + 1, m_height);
+    const int windowSize = yEnd - yBegin;
+    const int *top = &m_columnSums[yBegin * m_width];
+    const int *bottom = &m_columnSums[yEnd * m_width];
+    unsigned char *out = mask + y * m_width;
+    for(int x = 0; x < m_width; ++x)
+    {
+      const int count = bottom[x] - top[x];
+      out[x] = (erode ? count == windowSize : count > 0) ? 1 : 0;
+    }
+  }
+}
+
+int TouchComponentAnalyser::find_root(int pixel)
+{
+  while(m_parents[pixel] != pixel)
+  {
+    m_parents[pixel] = m_parents[m_parents[pixel]];
+    pixel = m_parents[pixel];
+  }
+  return pixel;
+}
+
+void TouchComponentAnalyser::unite(int pixel1, int pixel2)
+{
+  const int root1 = find_root(pixel1), root2 = find_root(pixel2);
+  if(root1 < root2) m_parents[root2] = root1;
+  else if(root2 < root1) m_parents[root1] = root2;
+}
+
+}
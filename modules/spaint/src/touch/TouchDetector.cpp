@@ -7,6 +7,8 @@
 using namespace ITMLib;
 using namespace rafl;
 
+#include <algorithm>
+
 #include <boost/format.hpp>
 #include <boost/serialization/shared_ptr.hpp>
 
@@ -23,15 +25,11 @@ using namespace orx;
 #include <tvgutil/misc/ArgUtil.h>
 using namespace tvgutil;
 
-#include "imageprocessing/ImageProcessorFactory.h"
-#include "touch/TouchDescriptorCalculator.h"
-
 //#define DEBUG_TOUCH_DISPLAY
 //#define DEBUG_TOUCH_OUTPUT_FOREST_STATISTICS 
 //#define DEBUG_TOUCH_DISPLAY_CONNECTED_COMPONENTS
 //#define DEBUG_TOUCH_DISPLAY_TOUCH_POINTS
 //#define DEBUG_TOUCH_DISPLAY_RAW_DEPTH_AND_DEPTH_RAYCAST
-//#define DEBUG_TOUCH_DISPLAY_DENOISED_CHANGE_MASK
 //#define DEBUG_TOUCH_DISPLAY_TOUCH_PIXELS
 //#define DEBUG_TOUCH_DISPLAY_BEST_CANDIDATE_MASK_AND_DIFF
 //#define DEBUG_TOUCH_OUTPUT_PMF
@@ -40,6 +38,7 @@ using namespace tvgutil;
 
 namespace spaint {
 
+
 //#################### CONSTRUCTORS ####################
 
 TouchDetector::TouchDetector(const Vector2i& imgSize, const Settings_CPtr& itmSettings, const TouchSettings_Ptr& touchSettings)
@@ -49,17 +48,16 @@ TouchDetector::TouchDetector(const Vector2i& imgSize, const Settings_CPtr& itmSe
   m_touchDebuggingOutputWindowName("TouchDebuggingOutputWindow"),
 
   // Normal variables.
-  m_changeMask(new af::array(imgSize.y, imgSize.x)),
-  m_connectedComponentImage(imgSize.y, imgSize.x, u32),
+  m_componentAnalyser(imgSize.x, imgSize.y),
   m_depthRaycast(new ORFloatImage(imgSize, true, true)),
   m_depthVisualiser(DepthVisualiserFactory::make_depth_visualiser(itmSettings->deviceType)),
-  m_diffRawRaycast(new af::array(imgSize.y, imgSize.x, f32)),
+  m_diffRawRaycast(new ORFloatImage(imgSize, true, true)),
   m_imageHeight(imgSize.y),
-  m_imageProcessor(ImageProcessorFactory::make_image_processor(itmSettings->deviceType)),
   m_imageWidth(imgSize.x),
   m_itmSettings(itmSettings),
   m_thresholdedRawDepth(new ORFloatImage(imgSize, true, true)),
-  m_touchMask(new af::array(imgSize.y, imgSize.x, u8)),
+  m_touchMask(new ORUCharImage(imgSize, true, true)),
+  m_touchPixels(imgSize.x * imgSize.y, 0),
   m_touchSettings(touchSettings)
 {
   // Set the maximum and minimum areas (in pixels) of a connected change component for it to be considered a candidate touch interaction.
@@ -68,6 +66,9 @@ TouchDetector::TouchDetector(const Vector2i& imgSize, const Settings_CPtr& itmSe
   m_minCandidateArea = static_cast<int>(m_touchSettings->minCandidateFraction * imageArea);
   m_maxCandidateArea = static_cast<int>(m_touchSettings->maxCandidateFraction * imageArea);
 
+  // Start with an empty touch mask.
+  update_touch_mask(-1);
+
   // Load the random forest used to score the candidate connected components.
   m_forest = m_touchSettings->load_forest();
 
@@ -80,58 +81,68 @@ TouchDetector::TouchDetector(const Vector2i& imgSize, const Settings_CPtr& itmSe
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
 std::vector<Eigen::Vector2i> TouchDetector::determine_touch_points(const rigging::MoveableCamera_CPtr& camera, const ORFloatImage_CPtr& rawDepth, const VoxelRenderState_CPtr& renderState)
-try
 {
 #if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY)
   process_debug_windows();
 #endif
 
-  // Prepare a thresholded version of the raw depth image and a depth raycast ready for change detection.
+  // Prepare the raw depth image and a depth raycast ready for change detection.
   prepare_inputs(camera, rawDepth, renderState);
 
-  // Detect changes in the scene with respect to the reconstructed model.
-  detect_changes();
-
-  // Make a connected-component image from the change mask.
-  m_connectedComponentImage = af::regions(*m_changeMask);
+  // Detect changes in the scene with respect to the reconstructed model, and find the connected components of the change mask.
+  detect_changes(rawDepth);
 
 #if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY_CONNECTED_COMPONENTS)
   // Display the connected components.
-  int componentCount = af::max<int>(m_connectedComponentImage) + 1;
-  af::array connectedComponentDebugImage = m_connectedComponentImage * (255.0f / componentCount);
-  OpenCVUtil::show_greyscale_figure("connectedComponentDebugImage", connectedComponentDebugImage.as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
+  {
+    const std::vector<int>& labels = m_componentAnalyser.get_labels();
+    const float componentCount = static_cast<float>(m_componentAnalyser.get_components().size()) + 1.0f;
+    std::vector<unsigned char> connectedComponentDebugImage(labels.size());
+    for(size_t i = 0, size = labels.size(); i < size; ++i)
+    {
+      connectedComponentDebugImage[i] = static_cast<unsigned char>((labels[i] + 1) * 255.0f / componentCount);
+    }
+    OpenCVUtil::show_greyscale_figure("connectedComponentDebugImage", &connectedComponentDebugImage[0], m_imageWidth, m_imageHeight, OpenCVUtil::ROW_MAJOR);
+  }
 #endif
 
   // Select candidate connected components that fall within a certain size range. If no components meet the size constraints, clear the touch mask and early out.
-  af::array candidateComponents = select_candidate_components();
-  if(candidateComponents.isempty())
+  std::vector<int> candidateComponents = m_componentAnalyser.select_candidate_components(m_minCandidateArea, m_maxCandidateArea);
+
+#if defined(DEBUG_TOUCH_OUTPUT_COMPONENT_AREAS)
+  const std::vector<TouchComponentAnalyser::Component>& components = m_componentAnalyser.get_components();
+  for(size_t i = 0, size = components.size(); i < size; ++i)
   {
-    *m_touchMask = 0;
-    return std::vector<Eigen::Vector2i>();
+    std::cout << "Component " << i << ": " << components[i].m_area << '\n';
   }
+  std::cout << "Candidates: " << candidateComponents.size() << '\n';
+#endif
 
-  // Convert the differences between the raw depth image and the depth raycast to millimetres.
-  af::array diffRawRaycastInMm = clamp_to_range(*m_diffRawRaycast * 1000.0f, 0.0f, 255.0f).as(u8);
+  if(candidateComponents.empty())
+  {
+    update_touch_mask(-1);
+    return std::vector<Eigen::Vector2i>();
+  }
 
 #ifdef WITH_OPENCV
   // If desired, save the candidate connected components for use with the touchtrain application.
   if(m_touchSettings->should_save_candidate_components())
   {
-    save_candidate_components(candidateComponents, diffRawRaycastInMm);
+    save_candidate_components(candidateComponents);
   }
 #endif
 
   // Pick the candidate component most likely to correspond to a touch interaction.
-  int bestConnectedComponent = pick_best_candidate_component_based_on_forest(candidateComponents, diffRawRaycastInMm);
+  int bestConnectedComponent = pick_best_candidate_component_based_on_forest(candidateComponents);
   if(bestConnectedComponent == -1)
   {
-    *m_touchMask = 0;
+    update_touch_mask(-1);
     return std::vector<Eigen::Vector2i>();
   }
 
   // Extract a set of touch points from the chosen connected component that denote the parts of the scene touched by the user.
   // Note that the set of touch points may end up being empty if the user is not touching the scene.
-  std::vector<Eigen::Vector2i> touchPoints = extract_touch_points(bestConnectedComponent, diffRawRaycastInMm);
+  std::vector<Eigen::Vector2i> touchPoints = extract_touch_points(bestConnectedComponent);
 
 #if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY_TOUCH_POINTS)
   // Display the touch points.
@@ -146,29 +157,19 @@ try
 
   return touchPoints;
 }
-catch(af::exception&)
-{
-  // Prevent the touch detector from crashing when tracking is lost.
-  return std::vector<Eigen::Vector2i>();
-}
 
 ORUChar4Image_CPtr TouchDetector::generate_touch_image(const View_CPtr& view) const
 {
-  static Vector2i imgSize = ImageProcessor::image_size(m_touchMask);
-  static ORUCharImage_Ptr touchMask(new ORUCharImage(imgSize, true, true));
+  const Vector2i imgSize = m_touchMask->noDims;
   ORUChar4Image_Ptr touchImage(new ORUChar4Image(imgSize, true, false));
 
   // Get the current RGB and depth images.
   const ORUChar4Image *rgb = view->rgb;
   const ORFloatImage *depth = view->depth;
 
-  // Copy the touch mask across to an InfiniTAM image.
-  m_imageProcessor->copy_af_to_itm(m_touchMask, touchMask);
-
-  // Copy the RGB and depth images and the touch mask across to the CPU.
+  // Copy the RGB and depth images across to the CPU (the touch mask is already there).
   rgb->UpdateHostFromDevice();
   depth->UpdateHostFromDevice();
-  touchMask->UpdateHostFromDevice();
 
   // Calculate a matrix that maps points in 3D depth image coordinates to 3D RGB image coordinates.
   Matrix4f depthToRGB3D = RGBDUtil::calculate_depth_to_rgb_matrix_3D(view->calib);
@@ -177,7 +178,7 @@ ORUChar4Image_CPtr TouchDetector::generate_touch_image(const View_CPtr& view) co
   const float *depthData = depth->GetData(MEMORYDEVICE_CPU);
   const Vector4u *rgbData = rgb->GetData(MEMORYDEVICE_CPU);
   Vector4u *touchImageData = touchImage->GetData(MEMORYDEVICE_CPU);
-  const unsigned char *touchMaskData = touchMask->GetData(MEMORYDEVICE_CPU);
+  const unsigned char *touchMaskData = m_touchMask->GetData(MEMORYDEVICE_CPU);
 
   // Copy the RGB pixels to the touch image, using the touch mask to fill in the alpha values.
   const int width = imgSize.x;
@@ -225,14 +226,12 @@ ORFloatImage_CPtr TouchDetector::get_depth_raycast() const
 
 ORFloatImage_CPtr TouchDetector::get_diff_raw_raycast() const
 {
-  static ORFloatImage_Ptr diffRawRaycast;
-  return m_imageProcessor->convert_af_to_itm(m_diffRawRaycast, diffRawRaycast);
+  return m_diffRawRaycast;
 }
 
 ORUCharImage_CPtr TouchDetector::get_touch_mask() const
 {
-  static ORUCharImage_Ptr touchMask;
-  return m_imageProcessor->convert_af_to_itm(m_touchMask, touchMask);
+  return m_touchMask;
 }
 
 ORFloatImage_CPtr TouchDetector::get_thresholded_raw_depth() const
@@ -247,144 +246,149 @@ float TouchDetector::invalid_depth_value() const
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void TouchDetector::detect_changes()
+void TouchDetector::detect_changes(const ORFloatImage_CPtr& rawDepth)
 {
-  // Calculate the difference between the raw depth image and the depth raycast.
-  m_imageProcessor->calculate_depth_difference(m_thresholdedRawDepth, m_depthRaycast, m_diffRawRaycast);
+  // Threshold the raw depth image and calculate its difference from the depth raycast, and then threshold the difference
+  // image to find significant differences between the two. Such differences indicate locations in which the scene has
+  // changed since it was originally reconstructed, e.g. the locations of moving objects such as hands. Finally, apply a
+  // morphological opening operation to the resulting change mask to reduce noise, and find its connected components.
+  //
+  // We deliberately ignore parts of the scene that are > 2m away, since although they are picked up by the camera,
+  // they are not fused into the scene by InfiniTAM (which has a depth threshold hard-coded into its scene settings).
+  // As a result, there will always be large expected differences between the raw and raycasted depth images in those
+  // parts of the scene. A 2m threshold is reasonable because we assume that the camera is positioned close to the user
+  // and that the user's hand or leg will therefore not extend more than two metres away from the camera position.
+  const float maxRawDepth = 2.0f;
+  int morphKernelSize = m_touchSettings->morphKernelSize;
+  if(morphKernelSize < 3) morphKernelSize = 3;
+
+  m_componentAnalyser.detect_changes(
+    rawDepth->GetData(MEMORYDEVICE_CPU),
+    m_depthRaycast->GetData(MEMORYDEVICE_CPU),
+    maxRawDepth,
+    m_touchSettings->lowerDepthThresholdMm / 1000.0f,
+    morphKernelSize,
+    m_thresholdedRawDepth->GetData(MEMORYDEVICE_CPU),
+    m_diffRawRaycast->GetData(MEMORYDEVICE_CPU)
+  );
+
+  // Make sure that any clients that read the thresholded raw depth image or the difference image from the device see the new versions.
+  m_thresholdedRawDepth->UpdateDeviceFromHost();
+  m_diffRawRaycast->UpdateDeviceFromHost();
 
 #if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY_RAW_DEPTH_AND_DEPTH_RAYCAST)
   // Display the raw depth image and the depth raycast.
   const float mToCm = 100.0f; // the scaling factor needed to convert metres to centimetres
-  m_thresholdedRawDepth->UpdateHostFromDevice();
-  m_depthRaycast->UpdateHostFromDevice();
   OpenCVUtil::show_scaled_greyscale_figure("Current raw depth from camera in centimetres", m_thresholdedRawDepth->GetData(MEMORYDEVICE_CPU), m_imageWidth, m_imageHeight, OpenCVUtil::ROW_MAJOR, mToCm);
   OpenCVUtil::show_scaled_greyscale_figure("Current depth raycast in centimetres", m_depthRaycast->GetData(MEMORYDEVICE_CPU), m_imageWidth, m_imageHeight, OpenCVUtil::ROW_MAJOR, mToCm);
-
-  // Display the absolute difference between the raw depth image and the depth raycast.
-  af::array diffRawRaycastInCm = clamp_to_range(*m_diffRawRaycast * mToCm, 0.0f, 255.0f);
-  OpenCVUtil::show_greyscale_figure("Diff image in centimetres", diffRawRaycastInCm.as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
+  OpenCVUtil::show_scaled_greyscale_figure("Diff image in centimetres", m_diffRawRaycast->GetData(MEMORYDEVICE_CPU), m_imageWidth, m_imageHeight, OpenCVUtil::ROW_MAJOR, mToCm);
 #endif
 
-  // Threshold the difference image to find significant differences between the raw depth image
-  // and the depth raycast. Such differences indicate locations in which the scene has changed
-  // since it was originally reconstructed, e.g. the locations of moving objects such as hands.
-  *m_changeMask = *m_diffRawRaycast > (m_touchSettings->lowerDepthThresholdMm / 1000.0f);
-
 #if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY)
-  // Display the change mask.
-  OpenCVUtil::show_greyscale_figure(m_touchDebuggingOutputWindowName, (m_changeMask.copy() * 255.0f).as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
-#endif
-
-  // Apply a morphological opening operation to the change mask to reduce noise.
-  int morphKernelSize = m_touchSettings->morphKernelSize;
-  if(morphKernelSize < 3) morphKernelSize = 3;
-  if(morphKernelSize % 2 == 0) ++morphKernelSize;
-  af::array morphKernel = af::constant(1, morphKernelSize, morphKernelSize);
-  *m_changeMask = af::erode(*m_changeMask, morphKernel);
-  *m_changeMask = af::dilate(*m_changeMask, morphKernel);
-
-#if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY_DENOISED_CHANGE_MASK)
-  // Display the change mask after applying morphological operations.
-  OpenCVUtil::show_greyscale_figure("MorphologicalOperatorWindow", (m_changeMask.copy() * 255.0f).as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
+  // Display the (denoised) change mask.
+  cv::imshow(m_touchDebuggingOutputWindowName, OpenCVUtil::make_greyscale_image(&m_componentAnalyser.get_change_mask()[0], m_imageWidth, m_imageHeight, OpenCVUtil::ROW_MAJOR, 255.0f));
 #endif
 }
 
-std::vector<Eigen::Vector2i> TouchDetector::extract_touch_points(int component, const af::array& diffRawRaycastInMm)
+std::vector<Eigen::Vector2i> TouchDetector::extract_touch_points(int component)
 {
-  // Determine the component's binary mask and difference image.
-  *m_touchMask = m_connectedComponentImage == component;
-  af::array diffImage = diffRawRaycastInMm * *m_touchMask;
-
-  // Quantize the intensites in the difference image to 32 levels (from a starting point of 256 levels).
-  diffImage = (diffImage / 8).as(u8) * 8;
+  // Make the touch mask denote the chosen component.
+  update_touch_mask(component);
+
+  // Find the pixels in the component that are close to the surface. To do this, we quantize the component's differences
+  // to 32 levels (from a starting point of 256 levels) and threshold them. The component lies entirely within its bounding
+  // box, so we only need to look there.
+  const TouchComponentAnalyser::Component& c = m_componentAnalyser.get_components()[component];
+  const std::vector<unsigned char>& diffInMm = m_componentAnalyser.get_diff_in_mm();
+  const std::vector<int>& labels = m_componentAnalyser.get_labels();
+  const int lowerDepthThresholdMm = m_touchSettings->lowerDepthThresholdMm;
+  const int upperDepthThresholdMm = lowerDepthThresholdMm + 15;
+
+  std::fill(m_touchPixels.begin(), m_touchPixels.end(), 0);
+  for(int y = c.m_minY; y <= c.m_maxY; ++y)
+  {
+    for(int x = c.m_minX; x <= c.m_maxX; ++x)
+    {
+      const int i = y * m_imageWidth + x;
+      if(labels[i] != component) continue;
 
-  // Threshold the difference image, keeping only parts that are close to the surface.
-  const int upperDepthThresholdMm = m_touchSettings->lowerDepthThresholdMm + 15;
-  diffImage = (diffImage > m_touchSettings->lowerDepthThresholdMm) && (diffImage < upperDepthThresholdMm);
+      const int quantizedDiff = diffInMm[i] / 8 * 8;
+      m_touchPixels[i] = quantizedDiff > lowerDepthThresholdMm && quantizedDiff < upperDepthThresholdMm ? 1 : 0;
+    }
+  }
 
-  // Apply a morphological opening operation to the difference image to reduce noise.
-  af::array morphKernel = af::constant(1, 5, 5);
-  diffImage = af::erode(diffImage, morphKernel);
-  diffImage = af::dilate(diffImage, morphKernel);
+  // Apply a morphological opening operation to the touch pixels to reduce noise.
+  m_componentAnalyser.open(&m_touchPixels[0], 5);
 
 #if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY_TOUCH_PIXELS)
   // Display the touch pixels.
-  OpenCVUtil::show_greyscale_figure("diffImage", (diffImage * 255).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
+  cv::imshow("diffImage", OpenCVUtil::make_greyscale_image(&m_touchPixels[0], m_imageWidth, m_imageHeight, OpenCVUtil::ROW_MAJOR, 255.0f));
 #endif
 
-  // Spatially quantize the difference image by resizing it to 50% of its current size. This has the effect of reducing the eventual number of touch points.
+  // Spatially quantize the touch pixels by sampling them (using nearest neighbour) at 30% of the original resolution. This has the
+  // effect of reducing the eventual number of touch points. The points are generated in column-major order, as they always have been.
   const float scaleFactor = 0.3f;
-  diffImage = af::resize(scaleFactor, diffImage);
-
-  // Make a 1D array whose elements denote the pixels at which the user is touching the scene. Each element is a column-major index into the resized difference image.
-  af::array touchIndicesImage = af::where(diffImage);
-
-  // If there are too few touch indices, assume the user is not touching the scene in a meaningful way and early out.
-  const float touchAreaLowerThreshold = m_touchSettings->minTouchAreaFraction * m_imageWidth * m_imageHeight;
-  if(touchIndicesImage.elements() <= touchAreaLowerThreshold) return std::vector<Eigen::Vector2i>();
-
-  // Otherwise, convert the touch indices to touch points and return them.
-  const int resizedDiffHeight = static_cast<int>(m_imageHeight * scaleFactor);
-  const int *touchIndices = touchIndicesImage.as(s32).host<int>();
+  const int resizedWidth = static_cast<int>(m_imageWidth * scaleFactor);
+  const int resizedHeight = static_cast<int>(m_imageHeight * scaleFactor);
   std::vector<Eigen::Vector2i> touchPoints;
-  for(int i = 0, touchPointCount = static_cast<int>(touchIndicesImage.elements()); i < touchPointCount; ++i)
+  for(int x = 0; x < resizedWidth; ++x)
   {
-    Eigen::Vector2f point(touchIndices[i] / resizedDiffHeight, touchIndices[i] % resizedDiffHeight);
-    touchPoints.push_back((point / scaleFactor).cast<int>());
+    const int sourceX = std::min(static_cast<int>(x / scaleFactor), m_imageWidth - 1);
+    for(int y = 0; y < resizedHeight; ++y)
+    {
+      const int sourceY = std::min(static_cast<int>(y / scaleFactor), m_imageHeight - 1);
+      if(m_touchPixels[sourceY * m_imageWidth + sourceX])
+      {
+        touchPoints.push_back((Eigen::Vector2f(static_cast<float>(x), static_cast<float>(y)) / scaleFactor).cast<int>());
+      }
+    }
   }
 
+  // If there are too few touch points, assume the user is not touching the scene in a meaningful way.
+  const float touchAreaLowerThreshold = m_touchSettings->minTouchAreaFraction * m_imageWidth * m_imageHeight;
+  if(touchPoints.size() <= touchAreaLowerThreshold) return std::vector<Eigen::Vector2i>();
+
   return touchPoints;
 }
 
-int TouchDetector::pick_best_candidate_component_based_on_distance(const af::array& candidateComponents, const af::array& diffRawRaycastInMm) const
+int TouchDetector::pick_best_candidate_component_based_on_distance(const std::vector<int>& candidateComponents) const
 {
-  const int *candidateIDs = candidateComponents.host<int>();
-  const int candidateCount = static_cast<int>(candidateComponents.dims(0));
-
   int bestCandidateID = -1;
-  af::array mask;
 
+  const int candidateCount = static_cast<int>(candidateComponents.size());
   if(candidateCount == 1)
   {
     // If there is only one candidate, then by definition it's the best candidate.
-    bestCandidateID = candidateIDs[0];
+    bestCandidateID = candidateComponents[0];
   }
   else
   {
-    // Otherwise, select the candidate that is closest to a surface.
-    std::vector<float> meanDistances(candidateCount);
+    // Otherwise, select the candidate that is closest to a surface. Note that this is measured using the sum of the depth
+    // differences over each component rather than their mean, which favours smaller components.
+    const std::vector<TouchComponentAnalyser::Component>& components = m_componentAnalyser.get_components();
+    std::vector<int> distanceSums(candidateCount);
     for(int i = 0; i < candidateCount; ++i)
     {
-      mask = m_connectedComponentImage == candidateIDs[i];
-      meanDistances[i] = af::mean<float>(diffRawRaycastInMm * mask);
+      distanceSums[i] = components[candidateComponents[i]].m_diffSumMm;
     }
-    size_t minIndex = ArgUtil::argmin(meanDistances);
-    bestCandidateID = candidateIDs[minIndex];
+    size_t minIndex = ArgUtil::argmin(distanceSums);
+    bestCandidateID = candidateComponents[minIndex];
   }
 
-#if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY_BEST_CANDIDATE_MASK_AND_DIFF)
-  // Display the best candidate's mask and difference image.
-  mask = m_connectedComponentImage.as(s32) == bestCandidateID;
-  OpenCVUtil::show_greyscale_figure("bestCandidateMask", (mask * 255).as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
-  OpenCVUtil::show_greyscale_figure("bestCandidateDiff", (diffRawRaycastInMm * mask).as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
-#endif
-
   return bestCandidateID;
 }
 
-int TouchDetector::pick_best_candidate_component_based_on_forest(const af::array& candidateComponents, const af::array& diffRawRaycastInMm) const
+int TouchDetector::pick_best_candidate_component_based_on_forest(const std::vector<int>& candidateComponents) const
 {
-  const int *candidateIDs = candidateComponents.host<int>();
-  const int candidateCount = static_cast<int>(candidateComponents.dims(0));
+  const int candidateCount = static_cast<int>(candidateComponents.size());
   const Label isTouchLabel = 1;
 
   std::vector<float> touchProb(candidateCount);
-  af::array candidateDiff;
+  Descriptor_Ptr descriptor(new Descriptor);
   for(int i = 0; i < candidateCount; ++i)
   {
-    candidateDiff = (m_connectedComponentImage == candidateIDs[i]) * diffRawRaycastInMm;
-    Descriptor_CPtr descriptor = TouchDescriptorCalculator::calculate_histogram_descriptor(candidateDiff);
-    touchProb[i] = MapUtil::lookup(m_forest->calculate_pmf(descriptor).get_masses(), isTouchLabel);
+    m_componentAnalyser.calculate_histogram_descriptor(candidateComponents[i], *descriptor);
+    touchProb[i] = m_forest->calculate_pmf(descriptor).get_mass(isTouchLabel);
 
 #if defined(DEBUG_TOUCH_OUTPUT_PMF)
     std::cout << "The PMF is: " << m_forest->calculate_pmf(descriptor) << '\n';
@@ -392,18 +396,23 @@ int TouchDetector::pick_best_candidate_component_based_on_forest(const af::array
 
 #if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY_CANDIDATE_COMPONENTS)
     // Display each candidate difference image.
-    OpenCVUtil::show_greyscale_figure("diff mask[" + boost::lexical_cast<std::string>(i) + "]", candidateDiff.as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
+    std::vector<unsigned char> candidateDiff(m_imageWidth * m_imageHeight);
+    m_componentAnalyser.make_component_diff_image(candidateComponents[i], &candidateDiff[0]);
+    OpenCVUtil::show_greyscale_figure("diff mask[" + boost::lexical_cast<std::string>(i) + "]", &candidateDiff[0], m_imageWidth, m_imageHeight, OpenCVUtil::ROW_MAJOR);
 #endif
   }
 
   const size_t maxIndex = ArgUtil::argmax(touchProb);
-  int bestCandidateID = touchProb[maxIndex] > 0.5f ? candidateIDs[maxIndex] : -1;
+  int bestCandidateID = touchProb[maxIndex] > 0.5f ? candidateComponents[maxIndex] : -1;
 
 #if defined(WITH_OPENCV) && defined(DEBUG_TOUCH_DISPLAY_BEST_CANDIDATE_MASK_AND_DIFF)
-  // Display the best candidate's mask and difference image.
-  af::array mask = m_connectedComponentImage.as(s32) == bestCandidateID;
-  OpenCVUtil::show_greyscale_figure("bestCandidateMask", (mask * 255).as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
-  OpenCVUtil::show_greyscale_figure("bestCandidateDiff", (diffRawRaycastInMm * mask).as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
+  // Display the best candidate's difference image.
+  if(bestCandidateID != -1)
+  {
+    std::vector<unsigned char> bestCandidateDiff(m_imageWidth * m_imageHeight);
+    m_componentAnalyser.make_component_diff_image(bestCandidateID, &bestCandidateDiff[0]);
+    OpenCVUtil::show_greyscale_figure("bestCandidateDiff", &bestCandidateDiff[0], m_imageWidth, m_imageHeight, OpenCVUtil::ROW_MAJOR);
+  }
 #endif
 
   return bestCandidateID;
@@ -411,14 +420,6 @@ int TouchDetector::pick_best_candidate_component_based_on_forest(const af::array
 
 void TouchDetector::prepare_inputs(const rigging::MoveableCamera_CPtr& camera, const ORFloatImage_CPtr& rawDepth, const VoxelRenderState_CPtr& renderState)
 {
-  // Make a copy of the raw depth image in which any parts of the scene that are at a distance of > 2m are set to -1.
-  // We deliberately ignore parts of the scene that are > 2m away, since although they are picked up by the camera,
-  // they are not fused into the scene by InfiniTAM (which has a depth threshold hard-coded into its scene settings).
-  // As a result, there will always be large expected differences between the raw and raycasted depth images in those
-  // parts of the scene. A 2m threshold is reasonable because we assume that the camera is positioned close to the user
-  // and that the user's hand or leg will therefore not extend more than two metres away from the camera position.
-  m_imageProcessor->set_on_threshold(rawDepth, ImageProcessor::CO_GREATER, 2.0f, -1.0f, m_thresholdedRawDepth);
-
   // Generate an orthographic depth raycast of the current scene from the current camera position.
   // As with the raw depth image, the pixel values of this raycast denote depth values in metres.
   // We assume that parts of the scene for which we have no information are far away (at an
@@ -432,6 +433,10 @@ void TouchDetector::prepare_inputs(const rigging::MoveableCamera_CPtr& camera, c
     invalid_depth_value(),
     m_depthRaycast
   );
+
+  // Make sure that both the raw depth image and the depth raycast are available on the CPU.
+  rawDepth->UpdateHostFromDevice();
+  m_depthRaycast->UpdateHostFromDevice();
 }
 
 #ifdef WITH_OPENCV
@@ -457,18 +462,15 @@ void TouchDetector::process_debug_windows()
   cv::waitKey(m_debugDelayMs);
 }
 
-void TouchDetector::save_candidate_components(const af::array& candidateComponents, const af::array& diffRawRaycastInMm) const
+void TouchDetector::save_candidate_components(const std::vector<int>& candidateComponents) const
 {
   static size_t imageCounter = 0;
 
-  const int *candidateIDs = candidateComponents.host<int>();
-  const int candidateCount = static_cast<int>(candidateComponents.dims(0));
-  af::array candidateDiffAF(m_imageHeight, m_imageWidth, u8);
-
-  for(int i = 0; i < candidateCount; ++i)
+  std::vector<unsigned char> candidateDiff(m_imageWidth * m_imageHeight);
+  for(size_t i = 0, candidateCount = candidateComponents.size(); i < candidateCount; ++i)
   {
-    candidateDiffAF = (m_connectedComponentImage == candidateIDs[i]) * diffRawRaycastInMm;
-    cv::Mat1b candidateDiffCV = OpenCVUtil::make_greyscale_image(candidateDiffAF.as(u8).host<unsigned char>(), m_imageWidth, m_imageHeight, OpenCVUtil::COL_MAJOR);
+    m_componentAnalyser.make_component_diff_image(candidateComponents[i], &candidateDiff[0]);
+    cv::Mat1b candidateDiffCV = OpenCVUtil::make_greyscale_image(&candidateDiff[0], m_imageWidth, m_imageHeight, OpenCVUtil::ROW_MAJOR);
 
     if(imageCounter < 1e5)
     {
@@ -479,49 +481,21 @@ void TouchDetector::save_candidate_components(const af::array& candidateComponen
 }
 #endif
 
-af::array TouchDetector::select_candidate_components()
+void TouchDetector::update_touch_mask(int component)
 {
-  // Add one to every pixel in the connected component image to allow for a special zero component.
-  m_connectedComponentImage += 1;
-
-  // Set all regions in the connected component image which are in the static scene to zero.
-  m_connectedComponentImage *= *m_changeMask;
-
-  // Calculate the areas of the connected components.
-  const int componentCount = af::max<int>(m_connectedComponentImage) + 1;
-  af::array componentAreas = af::histogram(m_connectedComponentImage, componentCount);
+  const std::vector<int>& labels = m_componentAnalyser.get_labels();
+  unsigned char *touchMaskData = m_touchMask->GetData(MEMORYDEVICE_CPU);
+  const int pixelCount = m_imageWidth * m_imageHeight;
 
-  // Zero out the connected component corresponding to the static scene.
-  componentAreas(0) = 0;
-
-  // Zero out connected components that are either too small or too large.
-  componentAreas -= (componentAreas < m_minCandidateArea) * componentAreas;
-  componentAreas -= (componentAreas > m_maxCandidateArea) * componentAreas;
-
-  // Keep the remaining non-zero components as candidates.
-  af::array candidates = af::where(componentAreas).as(s32);
-
-#if defined(DEBUG_TOUCH_OUTPUT_COMPONENT_AREAS)
-  af::print("componentAreas", componentAreas);
-  if(candidates.elements() > 0) af::print("candidates", candidates);
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
 #endif
+  for(int i = 0; i < pixelCount; ++i)
+  {
+    touchMaskData[i] = component != -1 && labels[i] == component ? 1 : 0;
+  }
 
-  return candidates;
-}
-
-//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
-
-af::array TouchDetector::clamp_to_range(const af::array& arr, float lower, float upper)
-{
-  static af::array lowerMask, upperMask;
-  lowerMask = arr < lower;
-  upperMask = arr > upper;
-
-  static af::array arrayCopy;
-  arrayCopy = arr - lowerMask * arr;
-  arrayCopy = arrayCopy - (upperMask * arrayCopy) + (upperMask * upper);
-
-  return arrayCopy;
+  m_touchMask->UpdateDeviceFromHost();
 }
 
 }
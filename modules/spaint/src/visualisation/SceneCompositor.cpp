@@ -0,0 +1,102 @@
+/**
+ * spaint: SceneCompositor.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "visualisation/SceneCompositor.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <orx/base/MemoryBlockFactory.h>
+using namespace orx;
+
+namespace spaint {
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void SceneCompositor::composite(const ORUChar4Image_Ptr& output) const
+{
+  const int width = output->noDims.x, height = output->noDims.y;
+  const int layerCount = static_cast<int>(m_layers.size());
+  const float arbitrarilyLargeDepth = 100.0f;
+
+  std::vector<const Vector4u*> colourData(layerCount);
+  std::vector<const float*> depthData(layerCount);
+  for(int i = 0; i < layerCount; ++i)
+  {
+    colourData[i] = m_layers[i].m_colourImage->GetData(MEMORYDEVICE_CPU);
+    depthData[i] = m_layers[i].m_depthImage->GetData(MEMORYDEVICE_CPU);
+  }
+
+  Vector4u *outputData = output->GetData(MEMORYDEVICE_CPU);
+
+  // Depth test the layers a row at a time. For each row, we visit the layers in turn and make a single pass over the row
+  // for each one, keeping track of the smallest depth seen so far at each pixel. The inner loops are simple enough to be
+  // vectorised by the compiler, and the rows are processed in parallel.
+#ifdef WITH_OPENMP
+  #pragma omp parallel
+#endif
+  {
+    std::vector<float> smallestDepths(width);
+
+#ifdef WITH_OPENMP
+    #pragma omp for
+#endif
+    for(int y = 0; y < height; ++y)
+    {
+      const int rowOffset = y * width;
+      Vector4u *outputRow = outputData + rowOffset;
+      std::fill(smallestDepths.begin(), smallestDepths.end(), std::numeric_limits<float>::max());
+      std::fill(outputRow, outputRow + width, Vector4u((uchar)0));
+
+      for(int i = 0; i < layerCount; ++i)
+      {
+        const Vector4u *colourRow = colourData[i] + rowOffset;
+        const float *depthRow = depthData[i] + rowOffset;
+        const bool pushedBack = m_layers[i].m_pushedBack;
+
+        for(int x = 0; x < width; ++x)
+        {
+          const bool valid = depthRow[x] != -1.0f;
+          const float depth = pushedBack ? arbitrarilyLargeDepth : depthRow[x];
+          if(valid && depth < smallestDepths[x])
+          {
+            smallestDepths[x] = depth;
+            outputRow[x] = colourRow[x];
+          }
+        }
+      }
+    }
+  }
+}
+
+SceneCompositor::Layer& SceneCompositor::get_layer(size_t i)
+{
+  return m_layers[i];
+}
+
+void SceneCompositor::prepare_layers(size_t layerCount, const Vector2i& imgSize)
+{
+  // If the size of the layers has changed, discard the existing layers.
+  if(!m_layers.empty() && m_layers[0].m_colourImage->noDims != imgSize) m_layers.clear();
+
+  // Allocate any layers that are needed, and clear all of the layers ready for rendering.
+  m_layers.resize(layerCount);
+  for(size_t i = 0; i < layerCount; ++i)
+  {
+    Layer& layer = m_layers[i];
+    if(!layer.m_colourImage)
+    {
+      MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+      layer.m_colourImage = mbf.make_image<Vector4u>(imgSize, "rendering");
+      layer.m_depthImage = mbf.make_image<float>(imgSize, "rendering");
+    }
+
+    layer.m_colourImage->Clear();
+    layer.m_depthImage->Fill(-1.0f);
+    layer.m_pushedBack = false;
+  }
+}
+
+}
@@ -14,6 +14,8 @@ using namespace ITMLib;
 #include <itmx/visualisation/DepthVisualisationUtil.tpp>
 #include <itmx/visualisation/DepthVisualiserFactory.h>
 using namespace itmx;
+
+#include <orx/geometry/GeometryUtil.h>
 using namespace orx;
 using namespace rigging;
 
@@ -184,6 +186,33 @@ void VisualisationGenerator::generate_voxel_visualisation(const ORUChar4Image_Pt
   make_postprocessed_cpu_copy(renderState->raycastImage, postprocessor, output);
 }
 
+void VisualisationGenerator::generate_voxel_visualisation_and_depth(const ORUChar4Image_Ptr& output, const ORFloatImage_Ptr& depthOutput, const SpaintVoxelScene_CPtr& scene,
+                                                                    const ORUtils::SE3Pose& pose, const ITMIntrinsics& intrinsics, VoxelRenderState_Ptr& renderState,
+                                                                    VisualisationType visualisationType, DepthVisualiser::DepthType depthType,
+                                                                    const boost::optional<Postprocessor>& postprocessor) const
+{
+  if(!scene)
+  {
+    output->Clear();
+    depthOutput->Fill(-1.0f);
+    return;
+  }
+
+  if(visualisationType == VT_SCENE_DEPTH)
+  {
+    // A depth visualisation is just a colourised version of the depth image, so generate the depth image first and then colourise it.
+    generate_depth_from_voxels(depthOutput, scene, pose, intrinsics, renderState, depthType);
+    IITMVisualisationEngine::DepthToUchar4(output.get(), depthOutput.get());
+    if(m_settings->deviceType == DEVICE_CUDA) output->UpdateDeviceFromHost();
+  }
+  else
+  {
+    // Generating the visualisation leaves the points hit by its raycast in the render state, so we can compute the depth image from those.
+    generate_voxel_visualisation(output, scene, pose, intrinsics, renderState, visualisationType, postprocessor);
+    render_depth_from_raycast(depthOutput, pose, renderState, depthType);
+  }
+}
+
 void VisualisationGenerator::get_depth_input(const ORUChar4Image_Ptr& output, const View_CPtr& view) const
 {
   output->Clear();
@@ -269,6 +298,18 @@ void VisualisationGenerator::make_postprocessed_cpu_copy(const ORUChar4Image *in
   }
 }
 
+void VisualisationGenerator::render_depth_from_raycast(const ORFloatImage_Ptr& output, const ORUtils::SE3Pose& pose, const VoxelRenderState_CPtr& renderState,
+                                                       DepthVisualiser::DepthType depthType) const
+{
+  const SimpleCamera camera = CameraPoseConverter::pose_to_camera(pose);
+  m_depthVisualiser->render_depth(
+    depthType, GeometryUtil::to_itm(camera.p()), GeometryUtil::to_itm(camera.n()),
+    renderState.get(), m_settings->sceneParams.voxelSize, -1.0f, output
+  );
+
+  if(m_settings->deviceType == DEVICE_CUDA) output->UpdateHostFromDevice();
+}
+
 void VisualisationGenerator::resize_into(const ORUChar4Image_Ptr& output, const ORUChar4Image *input) const
 {
 #ifdef WITH_OPENCV
@@ -5,6 +5,8 @@
 
 #include "visualisation/interface/SemanticVisualiser.h"
 
+#include <boost/thread/lock_guard.hpp>
+
 #include <orx/base/MemoryBlockFactory.h>
 using orx::MemoryBlockFactory;
 
@@ -14,7 +16,10 @@ namespace spaint {
 
 SemanticVisualiser::SemanticVisualiser(size_t maxLabelCount)
 : m_labelColoursMB(MemoryBlockFactory::instance().make_block<Vector3u>(maxLabelCount))
-{}
+{
+  // Start from a known state, so that render can tell which label colours need to be updated.
+  m_labelColoursMB->Clear();
+}
 
 //#################### DESTRUCTOR ####################
 
@@ -25,15 +30,23 @@ SemanticVisualiser::~SemanticVisualiser() {}
 void SemanticVisualiser::render(const SpaintVoxelScene *scene, const ORUtils::SE3Pose *pose, const ITMLib::ITMIntrinsics *intrinsics, const ITMLib::ITMRenderState *renderState,
                                 const std::vector<Vector3u>& labelColours, LightingType lightingType, float labelAlpha, ORUChar4Image *outputImage) const
 {
-  // Update the label colours in the memory block.
+  // Update the label colours in the memory block, and render using them. The lock is held throughout, since the
+  // label colours must not be changed by a concurrent render (e.g. of another scene) while they are being read.
+  boost::lock_guard<boost::mutex> lock(m_labelColoursMutex);
+
+  bool changed = false;
   Vector3u *labelColoursData = m_labelColoursMB->GetData(MEMORYDEVICE_CPU);
   for(size_t i = 0, size = std::min(m_labelColoursMB->dataSize, labelColours.size()); i < size; ++i)
   {
-    labelColoursData[i] = labelColours[i];
+    if(labelColoursData[i] != labelColours[i])
+    {
+      labelColoursData[i] = labelColours[i];
+      changed = true;
+    }
   }
-  m_labelColoursMB->UpdateDeviceFromHost();
 
-  // Render using the new label colours.
+  if(changed) m_labelColoursMB->UpdateDeviceFromHost();
+
   render_internal(scene, pose, intrinsics, renderState, lightingType, labelAlpha, outputImage);
 }
 
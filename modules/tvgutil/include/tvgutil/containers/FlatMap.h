@@ -0,0 +1,165 @@
+/**
+ * tvgutil: FlatMap.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_FLATMAP
+#define H_TVGUTIL_FLATMAP
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of an instantiation of this class template represents an ordered map that stores its entries contiguously.
+ *
+ * The entries are kept in a vector sorted by key, so iteration visits them in the same order as it would for a std::map,
+ * but lookups are binary searches over contiguous memory and no per-entry nodes need to be allocated. This makes it well
+ * suited to maps that are small, frequently built and frequently queried (e.g. the histograms and PMFs used by the random
+ * forests). Insertions of new keys are linear in the size of the map, so it is not suited to maps with many keys.
+ */
+template <typename K, typename V>
+class FlatMap
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef K key_type;
+  typedef V mapped_type;
+  typedef std::pair<K,V> value_type;
+  typedef typename std::vector<value_type>::const_iterator const_iterator;
+  typedef typename std::vector<value_type>::const_reverse_iterator const_reverse_iterator;
+  typedef typename std::vector<value_type>::iterator iterator;
+  typedef typename std::vector<value_type>::size_type size_type;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this predicate can be used to compare an entry's key with a key.
+   */
+  struct KeyLess
+  {
+    bool operator()(const value_type& lhs, const K& rhs) const
+    {
+      return lhs.first < rhs;
+    }
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The entries in the map, sorted by key. */
+  std::vector<value_type> m_entries;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty map.
+   */
+  FlatMap() {}
+
+  /**
+   * \brief Constructs a map containing the same entries as the specified std::map.
+   *
+   * \param m The std::map.
+   */
+  explicit FlatMap(const std::map<K,V>& m)
+  : m_entries(m.begin(), m.end())
+  {}
+
+  //#################### PUBLIC OPERATORS ####################
+public:
+  /**
+   * \brief Gets the value associated with the specified key, inserting a value-initialised one if it is not yet in the map.
+   *
+   * \param key The key.
+   * \return    The value associated with the key.
+   */
+  V& operator[](const K& key)
+  {
+    iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), key, KeyLess());
+    if(it == m_entries.end() || key < it->first) it = m_entries.insert(it, std::make_pair(key, V()));
+    return it->second;
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  const_iterator begin() const  { return m_entries.begin(); }
+  iterator begin()              { return m_entries.begin(); }
+  bool empty() const            { return m_entries.empty(); }
+  const_iterator end() const    { return m_entries.end(); }
+  iterator end()                { return m_entries.end(); }
+  const_reverse_iterator rbegin() const { return m_entries.rbegin(); }
+  const_reverse_iterator rend() const   { return m_entries.rend(); }
+  size_type size() const        { return m_entries.size(); }
+
+  /**
+   * \brief Removes all of the entries from the map.
+   */
+  void clear()
+  {
+    m_entries.clear();
+  }
+
+  /**
+   * \brief Finds the entry with the specified key (if any).
+   *
+   * \param key The key.
+   * \return    An iterator pointing to the entry with the specified key, if it exists, or end() otherwise.
+   */
+  const_iterator find(const K& key) const
+  {
+    const_iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), key, KeyLess());
+    return it != m_entries.end() && !(key < it->first) ? it : m_entries.end();
+  }
+
+  /**
+   * \brief Finds the entry with the specified key (if any).
+   *
+   * \param key The key.
+   * \return    An iterator pointing to the entry with the specified key, if it exists, or end() otherwise.
+   */
+  iterator find(const K& key)
+  {
+    iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), key, KeyLess());
+    return it != m_entries.end() && !(key < it->first) ? it : m_entries.end();
+  }
+
+  /**
+   * \brief Inserts the specified entry into the map, unless an entry with the same key already exists.
+   *
+   * \param entry The entry to insert.
+   * \return      A pair containing an iterator pointing to the entry with the specified key, and a flag indicating whether the insertion took place.
+   */
+  std::pair<iterator,bool> insert(const value_type& entry)
+  {
+    iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), entry.first, KeyLess());
+    if(it != m_entries.end() && !(entry.first < it->first)) return std::make_pair(it, false);
+    return std::make_pair(m_entries.insert(it, entry), true);
+  }
+
+  /**
+   * \brief Reserves space for the specified number of entries.
+   *
+   * \param n The number of entries for which to reserve space.
+   */
+  void reserve(size_type n)
+  {
+    m_entries.reserve(n);
+  }
+
+  /**
+   * \brief Makes a std::map containing the same entries as this map.
+   *
+   * \return  The std::map.
+   */
+  std::map<K,V> to_map() const
+  {
+    return std::map<K,V>(m_entries.begin(), m_entries.end());
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,574 @@
+/**
+ * tvgutil: LockFreePooledQueue.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_LOCKFREEPOOLEDQUEUE
+#define H_TVGUTIL_LOCKFREEPOOLEDQUEUE
+
+#include <algorithm>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+
+#include "PooledQueue.h"
+
+namespace tvgutil {
+
+namespace lock_free_pooled_queue {
+
+/**
+ * \brief An instance of an instantiation of this class template represents a fixed-capacity, lock-free, multi-producer multi-consumer ring buffer.
+ *
+ * The implementation is a bounded queue in which each cell carries a sequence number that tells producers and consumers whether
+ * the cell is ready to be written or read on the current lap of the ring, so that the only shared read-modify-write operations
+ * are the compare-and-swaps that claim positions.
+ */
+template <typename T>
+class RingBuffer
+{
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct represents a cell in the ring buffer.
+   */
+  struct Cell
+  {
+    /** The sequence number of the cell. */
+    boost::atomic<size_t> sequence;
+
+    /** The element stored in the cell. */
+    T elt;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The cells in the ring buffer. */
+  boost::scoped_array<Cell> m_cells;
+
+  /** The position from which the next element will be dequeued. */
+  boost::atomic<size_t> m_dequeuePos;
+
+  /** Padding to keep the dequeue and enqueue positions on separate cache lines (to avoid false sharing between producers and consumers). */
+  char m_padding[64];
+
+  /** The position at which the next element will be enqueued. */
+  boost::atomic<size_t> m_enqueuePos;
+
+  /** A mask used to convert positions into cell indices (the number of cells is always a power of two). */
+  size_t m_mask;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a ring buffer.
+   *
+   * \param capacity  The minimum number of elements that the ring buffer should be able to hold (this will be rounded up to a power of two).
+   */
+  explicit RingBuffer(size_t capacity)
+  : m_dequeuePos(0), m_enqueuePos(0)
+  {
+    size_t cellCount = 2;
+    while(cellCount < capacity) cellCount <<= 1;
+
+    m_cells.reset(new Cell[cellCount]);
+    for(size_t i = 0; i < cellCount; ++i)
+    {
+      m_cells[i].sequence.store(i, boost::memory_order_relaxed);
+    }
+
+    m_mask = cellCount - 1;
+  }
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  RingBuffer(const RingBuffer&);
+  RingBuffer& operator=(const RingBuffer&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the number of elements that the ring buffer can hold.
+   *
+   * \return  The number of elements that the ring buffer can hold.
+   */
+  size_t capacity() const
+  {
+    return m_mask + 1;
+  }
+
+  /**
+   * \brief Gets the (approximate, if other threads are using the ring buffer) number of elements in the ring buffer.
+   *
+   * \return  The number of elements in the ring buffer.
+   */
+  size_t size() const
+  {
+    const size_t dequeuePos = m_dequeuePos.load(boost::memory_order_acquire);
+    const size_t enqueuePos = m_enqueuePos.load(boost::memory_order_acquire);
+    return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+  }
+
+  /**
+   * \brief Attempts to remove the oldest element from the ring buffer.
+   *
+   * \param elt A place in which to store the element (if any).
+   * \return    true, if an element was removed, or false if the ring buffer was empty.
+   */
+  bool try_dequeue(T& elt)
+  {
+    size_t pos = m_dequeuePos.load(boost::memory_order_relaxed);
+    Cell *cell;
+    while(true)
+    {
+      cell = &m_cells[pos & m_mask];
+      const size_t sequence = cell->sequence.load(boost::memory_order_acquire);
+      const ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos + 1);
+      if(diff == 0)
+      {
+        if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, boost::memory_order_relaxed)) break;
+      }
+      else if(diff < 0) return false;
+      else pos = m_dequeuePos.load(boost::memory_order_relaxed);
+    }
+
+    // Reset the cell once its element has been read, so that the ring buffer does not keep a stale copy of it
+    // (e.g. an extra reference to a shared element) alive until the cell is next overwritten.
+    elt = cell->elt;
+    cell->elt = T();
+    cell->sequence.store(pos + m_mask + 1, boost::memory_order_release);
+    return true;
+  }
+
+  /**
+   * \brief Attempts to add an element to the ring buffer.
+   *
+   * \param elt The element to add.
+   * \return    true, if the element was added, or false if the ring buffer was full.
+   */
+  bool try_enqueue(const T& elt)
+  {
+    size_t pos = m_enqueuePos.load(boost::memory_order_relaxed);
+    Cell *cell;
+    while(true)
+    {
+      cell = &m_cells[pos & m_mask];
+      const size_t sequence = cell->sequence.load(boost::memory_order_acquire);
+      const ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos);
+      if(diff == 0)
+      {
+        if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, boost::memory_order_relaxed)) break;
+      }
+      else if(diff < 0) return false;
+      else pos = m_enqueuePos.load(boost::memory_order_relaxed);
+    }
+
+    cell->elt = elt;
+    cell->sequence.store(pos + 1, boost::memory_order_release);
+    return true;
+  }
+};
+
+/**
+ * \brief An instance of this class allows threads to sleep until a lock-free condition (e.g. a ring buffer becoming non-empty) might have become true.
+ *
+ * Notifying is lock-free unless some thread is actually waiting, so the common (uncontended) case never touches the mutex.
+ */
+class Signal
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** A condition variable used to sleep until the signal is notified. */
+  boost::condition_variable m_cond;
+
+  /** The mutex associated with the condition variable. */
+  boost::mutex m_mutex;
+
+  /** The number of threads that are currently waiting (or about to wait). */
+  boost::atomic<int> m_waiterCount;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a signal.
+   */
+  Signal()
+  : m_waiterCount(0)
+  {}
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  Signal(const Signal&);
+  Signal& operator=(const Signal&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Wakes up any threads that are waiting on the signal.
+   *
+   * Note: This must be called after the state change that might make the waiting threads' condition true has been published.
+   */
+  void notify()
+  {
+    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+    if(m_waiterCount.load(boost::memory_order_relaxed) > 0)
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_cond.notify_all();
+    }
+  }
+
+  /**
+   * \brief Repeatedly attempts an operation until it succeeds, sleeping until the signal is notified whenever it fails.
+   *
+   * The operation is first retried a few times without sleeping, since the condition will often become true almost immediately.
+   *
+   * \param attempt The operation to attempt (returns true if it succeeded).
+   */
+  template <typename Attempt>
+  void wait_until(Attempt attempt)
+  {
+    for(int i = 0; i < 64; ++i)
+    {
+      if(attempt()) return;
+      boost::this_thread::yield();
+    }
+
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_waiterCount.fetch_add(1, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+    while(!attempt()) m_cond.wait(lock);
+    m_waiterCount.fetch_sub(1, boost::memory_order_relaxed);
+  }
+};
+
+}
+
+/**
+ * \brief An instance of an instantiation of this class template represents a lock-free queue that is backed by a fixed-capacity pool of reusable elements.
+ *
+ * This has the same begin_push/peek/pop semantics as PooledQueue, but both the queue and the pool are lock-free ring buffers,
+ * so a producer and a consumer running on different threads never contend for a lock on the fast path (a mutex is only used
+ * to put a thread to sleep when it genuinely has to wait). Pushes may be started from any number of threads, but the
+ * peek/pop side must only be used by one thread at a time (as is already implicitly the case for PooledQueue, since peek
+ * returns a reference to the front of the queue).
+ *
+ * The pool empty strategies behave as follows:
+ *
+ * - PES_DISCARD: The new element is discarded.
+ * - PES_GROW: A new element is created, until the pool reaches its maximum capacity, after which the push waits.
+ *   (Unlike PooledQueue, the pool cannot grow without bound, since the ring buffers have a fixed size: the maximum
+ *   capacity is specified when the queue is initialised, and defaults to twice the initial capacity.)
+ * - PES_REPLACE_RANDOM: The oldest element on the queue that the consumer has not yet started reading is replaced.
+ *   (Unlike PooledQueue, we can only take elements from the front of a ring buffer, but replacing the oldest
+ *   element has the useful property that the consumer always sees the most recent elements. Note also that,
+ *   unlike PooledQueue, the element the consumer is currently peeking at is never replaced.)
+ * - PES_WAIT: The push waits until the consumer pops an element from the queue.
+ */
+template <typename T>
+class LockFreePooledQueue
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this class can be used to handle the process of pushing an element onto the queue.
+   */
+  class PushHandler
+  {
+    //~~~~~~~~~~~~~~~~~~~~ PRIVATE VARIABLES ~~~~~~~~~~~~~~~~~~~~
+  private:
+    /** A pointer to the pooled queue on which push was called. */
+    LockFreePooledQueue<T> *m_base;
+
+    /** The element that is to be pushed onto the queue (if any). */
+    boost::optional<T> m_elt;
+
+    //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Constructs a push handler.
+     *
+     * \param base  A pointer to the pooled queue on which push was called.
+     * \param elt   The element that is to be pushed onto the queue (if any).
+     */
+    PushHandler(LockFreePooledQueue<T> *base, const boost::optional<T>& elt)
+    : m_base(base), m_elt(elt)
+    {}
+
+    //~~~~~~~~~~~~~~~~~~~~ DESTRUCTOR ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Completes the push by pushing the element (if any) onto the queue.
+     */
+    ~PushHandler()
+    {
+      if(m_elt) m_base->end_push(*m_elt);
+    }
+
+    //~~~~~~~~~~~~~~~~~~~~ COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ~~~~~~~~~~~~~~~~~~~~
+  private:
+    // Deliberately private and unimplemented.
+    PushHandler(const PushHandler&);
+    PushHandler& operator=(const PushHandler&);
+
+    //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Gets a reference to the element that is to be pushed onto the queue (if any).
+     *
+     * \return  A reference to the element that is to be pushed onto the queue (if any).
+     */
+    boost::optional<T&> get()
+    {
+      return m_elt ? boost::optional<T&>(*m_elt) : boost::none;
+    }
+  };
+
+  //#################### TYPEDEFS ####################
+public:
+  typedef boost::shared_ptr<PushHandler> PushHandler_Ptr;
+
+private:
+  typedef lock_free_pooled_queue::RingBuffer<T> RingBuffer;
+  typedef boost::shared_ptr<RingBuffer> RingBuffer_Ptr;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The element that the consumer is currently reading (if any), i.e. the front of the queue from the caller's perspective. */
+  boost::optional<T> m_current;
+
+  /** The number of elements that have been created so far. */
+  boost::atomic<size_t> m_eltCount;
+
+  /** Whether or not the consumer is currently reading an element (this is needed because size() may be called from other threads). */
+  boost::atomic<bool> m_hasCurrent;
+
+  /** A function that can be used to construct new elements (by default, the default constructor for the element type). */
+  boost::function<T()> m_maker;
+
+  /** The maximum number of elements that can be created. */
+  size_t m_maxCapacity;
+
+  /** The pool of reusable elements that backs the queue. */
+  RingBuffer_Ptr m_pool;
+
+  /** A strategy specifying what should happen when a push is attempted while the pool is empty. */
+  pooled_queue::PoolEmptyStrategy m_poolEmptyStrategy;
+
+  /** A signal used to wait for the pool to become non-empty. */
+  lock_free_pooled_queue::Signal m_poolNonEmpty;
+
+  /** The queue itself. */
+  RingBuffer_Ptr m_queue;
+
+  /** A signal used to wait for the queue to become non-empty. */
+  lock_free_pooled_queue::Signal m_queueNonEmpty;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a lock-free pooled queue.
+   *
+   * \param poolEmptyStrategy A strategy specifying what should happen when a push is attempted while the pool is empty.
+   */
+  explicit LockFreePooledQueue(pooled_queue::PoolEmptyStrategy poolEmptyStrategy = pooled_queue::PES_GROW)
+  : m_eltCount(0), m_hasCurrent(false), m_maxCapacity(0), m_poolEmptyStrategy(poolEmptyStrategy)
+  {}
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  LockFreePooledQueue(const LockFreePooledQueue&);
+  LockFreePooledQueue& operator=(const LockFreePooledQueue&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Starts a push operation.
+   *
+   * See PooledQueue::begin_push for details of how pushes work.
+   *
+   * \return  A push handler that will handle the process of pushing an element onto the queue.
+   */
+  PushHandler_Ptr begin_push()
+  {
+    using namespace pooled_queue;
+
+    // Try to take an element from the pool. If the pool is empty, apply the pool empty strategy.
+    T elt;
+    if(!m_pool->try_dequeue(elt))
+    {
+      switch(m_poolEmptyStrategy)
+      {
+        case PES_DISCARD:
+        {
+          return PushHandler_Ptr(new PushHandler(this, boost::none));
+        }
+        case PES_GROW:
+        {
+          if(try_grow(elt)) break;
+          m_poolNonEmpty.wait_until(boost::bind(&RingBuffer::try_dequeue, m_pool.get(), boost::ref(elt)));
+          break;
+        }
+        case PES_REPLACE_RANDOM:
+        {
+          // Take the oldest element from the queue if there is one. If not (because every element is currently either being
+          // written by a producer or read by the consumer), wait for an element to be returned to the pool.
+          m_poolNonEmpty.wait_until(boost::bind(&LockFreePooledQueue<T>::try_take_for_replacement, this, boost::ref(elt)));
+          break;
+        }
+        case PES_WAIT:
+        {
+          m_poolNonEmpty.wait_until(boost::bind(&RingBuffer::try_dequeue, m_pool.get(), boost::ref(elt)));
+          break;
+        }
+      }
+    }
+
+    return PushHandler_Ptr(new PushHandler(this, elt));
+  }
+
+  /**
+   * \brief Gets whether or not the queue is empty.
+   *
+   * \return  true, if the queue is empty, or false otherwise.
+   */
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  /**
+   * \brief Initialises the pool backing the queue.
+   *
+   * \param capacity    The initial capacity of the pool.
+   * \param maker       A function that can be used to construct new elements (by default, the default constructor for the element type).
+   * \param maxCapacity The maximum capacity of the pool if we're using the 'grow' strategy (0 means twice the initial capacity).
+   */
+  void initialise(size_t capacity, const boost::function<T()>& maker = boost::value_factory<T>(), size_t maxCapacity = 0)
+  {
+    m_maker = maker;
+    m_maxCapacity = m_poolEmptyStrategy == pooled_queue::PES_GROW ? std::max(maxCapacity > 0 ? maxCapacity : 2 * capacity, capacity) : capacity;
+
+    // Note that both ring buffers must be able to hold every element at once, so that returning an element never fails.
+    m_pool.reset(new RingBuffer(m_maxCapacity));
+    m_queue.reset(new RingBuffer(m_maxCapacity));
+
+    for(size_t i = 0; i < capacity; ++i)
+    {
+      m_pool->try_enqueue(maker());
+    }
+
+    m_eltCount = capacity;
+  }
+
+  /**
+   * \brief Gets a reference to the first element in the queue.
+   *
+   * Note: This will block until the queue is non-empty.
+   *
+   * \return  A reference to the first element in the queue.
+   */
+  T& peek()
+  {
+    if(!m_current)
+    {
+      T elt;
+      m_queueNonEmpty.wait_until(boost::bind(&RingBuffer::try_dequeue, m_queue.get(), boost::ref(elt)));
+      m_current = elt;
+      m_hasCurrent.store(true, boost::memory_order_release);
+    }
+
+    return *m_current;
+  }
+
+  /**
+   * \brief Gets a reference to the first element in the queue.
+   *
+   * Note: This will block until the queue is non-empty.
+   *
+   * \return  A reference to the first element in the queue.
+   */
+  const T& peek() const
+  {
+    return const_cast<LockFreePooledQueue<T>*>(this)->peek();
+  }
+
+  /**
+   * \brief Pops the first element from the queue and returns it to the pool.
+   *
+   * Note: This will block until the queue is non-empty.
+   */
+  void pop()
+  {
+    peek();
+    m_pool->try_enqueue(*m_current);
+    m_current.reset();
+    m_hasCurrent.store(false, boost::memory_order_release);
+    m_poolNonEmpty.notify();
+  }
+
+  /**
+   * \brief Gets the size of the queue.
+   *
+   * \return  The size of the queue (if other threads are using the queue, this is necessarily approximate).
+   */
+  size_t size() const
+  {
+    return m_queue->size() + (m_hasCurrent.load(boost::memory_order_acquire) ? 1 : 0);
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Completes a push operation by pushing the specified element onto the queue.
+   *
+   * Note: This is called automatically when the push handler associated with the push is destroyed.
+   *
+   * \param elt The element to be pushed onto the queue.
+   */
+  void end_push(const T& elt)
+  {
+    m_queue->try_enqueue(elt);
+    m_queueNonEmpty.notify();
+  }
+
+  /**
+   * \brief Attempts to create a new element (if the pool has not yet reached its maximum capacity).
+   *
+   * \param elt A place in which to store the new element.
+   * \return    true, if a new element was created, or false otherwise.
+   */
+  bool try_grow(T& elt)
+  {
+    size_t eltCount = m_eltCount.load(boost::memory_order_relaxed);
+    while(eltCount < m_maxCapacity)
+    {
+      if(m_eltCount.compare_exchange_weak(eltCount, eltCount + 1, boost::memory_order_relaxed))
+      {
+        elt = m_maker();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * \brief Attempts to take an element that can be overwritten by a new push, preferring the pool but falling back to the oldest element on the queue.
+   *
+   * \param elt A place in which to store the element.
+   * \return    true, if an element was found, or false otherwise.
+   */
+  bool try_take_for_replacement(T& elt)
+  {
+    return m_pool->try_dequeue(elt) || m_queue->try_dequeue(elt);
+  }
+};
+
+}
+
+#endif
@@ -11,6 +11,8 @@
 #include <map>
 #include <vector>
 
+#include "../containers/FlatMap.h"
+
 namespace tvgutil {
 
 /**
@@ -50,6 +52,21 @@ public:
     return std::min_element(m.begin(), m.end(), SndPred<K,V,std::greater<V> >())->first;
   }
 
+  /**
+   * \brief Calculates argmax_k m[k].
+   *
+   * This function finds a key in the map whose corresponding value is largest (using std::greater).
+   * If there are several keys with the largest value, one of them is returned deterministically.
+   *
+   * \param m The map over which to perform the argmax.
+   * \return  A key in the map with the largest corresponding value.
+   */
+  template <typename K, typename V>
+  static const K& argmax(const FlatMap<K,V>& m)
+  {
+    return std::min_element(m.begin(), m.end(), SndPred<K,V,std::greater<V> >())->first;
+  }
+
   /**
    * \brief Calculates argmax_k m[k].
    *
@@ -80,6 +97,21 @@ public:
     return std::min_element(m.begin(), m.end(), SndPred<K,V,std::less<V> >())->first;
   }
 
+  /**
+   * \brief Calculates argmin_k m[k].
+   *
+   * This function finds a key in the map whose corresponding value is smallest (using std::less).
+   * If there are several keys with the smallest value, one of them is returned deterministically.
+   *
+   * \param m The map over which to perform the argmin.
+   * \return  A key in the map with the smallest corresponding value.
+   */
+  template <typename K, typename V>
+  static const K& argmin(const FlatMap<K,V>& m)
+  {
+    return std::min_element(m.begin(), m.end(), SndPred<K,V,std::less<V> >())->first;
+  }
+
   /**
    * \brief Calculates argmin_k m[k].
    *
@@ -0,0 +1,141 @@
+/**
+ * tvgutil: Setting.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_SETTING
+#define H_TVGUTIL_SETTING
+
+#include <limits>
+
+#include <boost/optional.hpp>
+
+#include "SettingsContainer.h"
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of an instantiation of this class template provides typed, pre-resolved access to a setting in a settings container.
+ *
+ * The setting's value is looked up and parsed when the handle is first used, and is then cached until the settings
+ * in the container change (e.g. when they are reloaded), at which point it is transparently re-parsed. This makes it
+ * cheap to read settings on hot paths. Constructing a handle also registers the setting (and its default value, if any)
+ * with the container, so that the effective configuration of a run can be output.
+ *
+ * Note that a handle is not itself thread-safe: each thread that needs to read a setting should use its own handle.
+ */
+template <typename T>
+class Setting
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The cached value of the setting. */
+  mutable T m_cachedValue;
+
+  /** The generation of the settings container from which the cached value was obtained. */
+  mutable size_t m_cachedGeneration;
+
+  /** The default value of the setting (if any). */
+  boost::optional<T> m_defaultValue;
+
+  /** The name of the setting. */
+  std::string m_key;
+
+  /** The settings container from which to read the setting. */
+  SettingsContainer_CPtr m_settings;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a handle for a setting that must be specified by the user.
+   *
+   * \param settings  The settings container from which to read the setting.
+   * \param key       The name of the setting.
+   */
+  Setting(const SettingsContainer_CPtr& settings, const std::string& key)
+  : m_cachedValue(), m_cachedGeneration(std::numeric_limits<size_t>::max()), m_key(key), m_settings(settings)
+  {
+    m_settings->register_setting(m_key, std::vector<std::string>());
+  }
+
+  /**
+   * \brief Constructs a handle for a setting that has a default value.
+   *
+   * \param settings      The settings container from which to read the setting.
+   * \param key           The name of the setting.
+   * \param defaultValue  The value to use for the setting if the user has not specified one.
+   */
+  Setting(const SettingsContainer_CPtr& settings, const std::string& key, const T& defaultValue)
+  : m_cachedValue(), m_cachedGeneration(std::numeric_limits<size_t>::max()), m_defaultValue(defaultValue), m_key(key), m_settings(settings)
+  {
+    m_settings->register_setting(m_key, std::vector<std::string>(1, boost::lexical_cast<std::string>(defaultValue)));
+  }
+
+  //#################### PUBLIC OPERATORS ####################
+public:
+  /**
+   * \brief Gets the current value of the setting.
+   *
+   * \return  The current value of the setting.
+   *
+   * \throws std::runtime_error       If the setting has no default value and has not been specified by the user.
+   * \throws boost::bad_lexical_cast  If the setting's value cannot be converted to the handle's type.
+   */
+  const T& operator*() const
+  {
+    return get();
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the current value of the setting.
+   *
+   * \return  The current value of the setting.
+   *
+   * \throws std::runtime_error       If the setting has no default value and has not been specified by the user.
+   * \throws boost::bad_lexical_cast  If the setting's value cannot be converted to the handle's type.
+   */
+  const T& get() const
+  {
+    if(m_cachedGeneration != m_settings->get_generation()) refresh();
+    return m_cachedValue;
+  }
+
+  /**
+   * \brief Gets the name of the setting.
+   *
+   * \return  The name of the setting.
+   */
+  const std::string& key() const
+  {
+    return m_key;
+  }
+
+  /**
+   * \brief Re-reads the value of the setting from the settings container if the settings have changed since it was last read.
+   *
+   * \return  true, if the value of the setting changed as a result, or false otherwise.
+   *
+   * \throws std::runtime_error       If the setting has no default value and has not been specified by the user.
+   * \throws boost::bad_lexical_cast  If the setting's value cannot be converted to the handle's type.
+   */
+  bool refresh() const
+  {
+    // Read the generation before the value, so that a concurrent change to the settings will be picked up next time.
+    const size_t generation = m_settings->get_generation();
+    if(generation == m_cachedGeneration) return false;
+
+    const bool firstRead = m_cachedGeneration == std::numeric_limits<size_t>::max();
+    T value = m_defaultValue ? m_settings->get_first_value<T>(m_key, *m_defaultValue) : m_settings->get_first_value<T>(m_key);
+    const bool changed = firstRead || !(value == m_cachedValue);
+
+    m_cachedValue = value;
+    m_cachedGeneration = generation;
+    return changed;
+  }
+};
+
+}
+
+#endif
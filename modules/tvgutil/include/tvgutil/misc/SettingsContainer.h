@@ -9,7 +9,11 @@
 #include <ostream>
 #include <vector>
 
+#include <boost/atomic.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "../containers/MapUtil.h"
 #include "ConversionUtil.h"
@@ -20,6 +24,11 @@ namespace tvgutil {
  * \brief An instance of this class can be used to store named settings for an application.
  *
  * The settings are represented as a key -> [value] map, i.e. there can be multiple values for the same setting.
+ *
+ * Code that reads a setting frequently (e.g. once per frame) should use a typed Setting handle rather than calling
+ * get_first_value each time. A handle only re-parses its value when the container's settings change. Both handles and
+ * calls to get_first_value that supply a default register the key (and default) with the container, so that the
+ * effective configuration of a run can later be output.
  */
 class SettingsContainer
 {
@@ -30,9 +39,25 @@ public:
 
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** A counter that is incremented whenever any of the settings change (used by setting handles to detect when they need to re-parse their values). */
+  boost::atomic<size_t> m_generation;
+
+  /** A map from the keys of the settings that have been registered by setting handles to their default values (if any). */
+  mutable std::map<std::string,std::vector<std::string> > m_registeredDefaults;
+
+  /** A mutex used to synchronise access to the registered defaults. */
+  mutable boost::mutex m_registeredDefaultsMutex;
+
   /** The key -> [value] map storing the values for the settings. */
   std::map<std::string,std::vector<std::string> > m_settings;
 
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty settings container.
+   */
+  SettingsContainer();
+
   //#################### DESTRUCTOR ####################
 public:
   /**
@@ -40,6 +65,12 @@ public:
    */
   virtual ~SettingsContainer();
 
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  SettingsContainer(const SettingsContainer&);
+  SettingsContainer& operator=(const SettingsContainer&);
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /**
@@ -71,6 +102,8 @@ public:
    * \brief Gets the first value associated with the specified setting and converts it to the specified type.
    *        If no such setting exists, the specified default value is returned.
    *
+   * The default value is registered with the container, so that it appears in the effective configuration.
+   *
    * \param key           The name of the setting whose values are to be looked up.
    * \param defaultValue  The default value to return if the specified setting does not exist.
    * \return              The first value associated with the specified setting, if the setting exists, or the default value otherwise.
@@ -80,6 +113,8 @@ public:
   template <typename T>
   T get_first_value(const std::string& key, typename boost::mpl::identity<const T>::type& defaultValue) const
   {
+    register_default(key, defaultValue);
+
     static std::vector<std::string> defaultEmptyVector;
     const std::vector<std::string>& values = MapUtil::lookup(m_settings, key, defaultEmptyVector);
     return values.empty() || values[0] == NOT_SET ? defaultValue : from_string<T>(values[0]);
@@ -108,6 +143,21 @@ public:
     return typedValues;
   }
 
+  /**
+   * \brief Gets the current generation of the settings (this changes whenever any of the settings change).
+   *
+   * \return  The current generation of the settings.
+   */
+  size_t get_generation() const;
+
+  /**
+   * \brief Gets the raw values associated with the specified setting (without any conversion).
+   *
+   * \param key The name of the setting whose values are to be looked up.
+   * \return    The values associated with the specified setting, or an empty vector if there are none.
+   */
+  std::vector<std::string> get_raw_values(const std::string& key) const;
+
   /**
    * \brief Gets whether or not the specified setting has any values.
    *
@@ -116,6 +166,55 @@ public:
    */
   bool has_values(const std::string& key) const;
 
+  /**
+   * \brief Outputs the effective configuration, i.e. every setting that has a value or has been registered (by a setting handle or get_first_value), to a stream.
+   *
+   * The settings are output one value per line in "key=value" form, so the output can be used as a configuration file to reproduce a run.
+   * Registered settings that have not been set are output with their default values (or are commented out if they have no default).
+   *
+   * \param os  The stream.
+   */
+  void output_effective_settings(std::ostream& os) const;
+
+  /**
+   * \brief Registers the specified setting (this is called by setting handles and get_first_value, so that the effective configuration can later be output).
+   *
+   * \param key           The name of the setting.
+   * \param defaultValues The default value(s) of the setting (if any), converted to strings.
+   */
+  void register_setting(const std::string& key, const std::vector<std::string>& defaultValues) const;
+
+  /**
+   * \brief Replaces any existing values for the specified setting with the specified values (e.g. when reloading the settings).
+   *
+   * Any setting handles for the setting will pick up the new values the next time they are used.
+   *
+   * \param key     The name of the setting.
+   * \param values  The new values for the setting.
+   */
+  void set_values(const std::string& key, const std::vector<std::string>& values);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Registers the specified setting with a single default value, unless it has already been registered.
+   *
+   * The default is only converted to a string the first time the setting is registered, so that repeated calls
+   * to get_first_value for the same setting stay cheap.
+   *
+   * \param key           The name of the setting.
+   * \param defaultValue  The default value of the setting.
+   */
+  template <typename T>
+  void register_default(const std::string& key, const T& defaultValue) const
+  {
+    boost::lock_guard<boost::mutex> lock(m_registeredDefaultsMutex);
+    if(m_registeredDefaults.find(key) == m_registeredDefaults.end())
+    {
+      m_registeredDefaults.insert(std::make_pair(key, std::vector<std::string>(1, boost::lexical_cast<std::string>(defaultValue))));
+    }
+  }
+
   //#################### STREAM OPERATORS ####################
 public:
   /**
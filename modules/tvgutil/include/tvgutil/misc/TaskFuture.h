@@ -0,0 +1,309 @@
+/**
+ * tvgutil: TaskFuture.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_TASKFUTURE
+#define H_TVGUTIL_TASKFUTURE
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/exception_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility/result_of.hpp>
+
+#include "TaskPriority.h"
+
+namespace tvgutil {
+
+//#################### FORWARD DECLARATIONS ####################
+
+class TaskScheduler;
+
+namespace task_detail {
+
+/**
+ * \brief An instance of an instantiation of this class template holds the result of a task that returns a value of type T.
+ */
+template <typename T>
+struct TaskResult
+{
+  /** The result of the task (if it has finished successfully). */
+  boost::optional<T> value;
+
+  /** Runs the specified function and stores its result. */
+  template <typename F>
+  void compute(F& f) { value = f(); }
+
+  /** Gets the stored result. */
+  const T& get() const { return *value; }
+};
+
+/**
+ * \brief A specialisation of TaskResult for tasks that do not return a value.
+ */
+template <>
+struct TaskResult<void>
+{
+  /** Runs the specified function. */
+  template <typename F>
+  void compute(F& f) { f(); }
+
+  /** Does nothing (there is no result to get). */
+  void get() const {}
+};
+
+/**
+ * \brief An instance of an instantiation of this class template represents the shared state of a task that returns a value of type T.
+ */
+template <typename T>
+class TaskState
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The functions to call once the task has finished. */
+  std::vector<boost::function<void()> > m_continuations;
+
+  /** The exception thrown by the task (if any). */
+  boost::exception_ptr m_error;
+
+  /** A condition variable used to wait for the task to finish. */
+  mutable boost::condition_variable m_finished;
+
+  /** A mutex used to synchronise access to the state. */
+  mutable boost::mutex m_mutex;
+
+  /** Whether or not the task has finished. */
+  bool m_ready;
+
+  /** The result of the task. */
+  TaskResult<T> m_result;
+
+  /** The scheduler on which the task is being run. */
+  TaskScheduler *m_scheduler;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs the shared state for a task that will be run on the specified scheduler.
+   *
+   * \param scheduler The scheduler on which the task will be run.
+   */
+  explicit TaskState(TaskScheduler *scheduler)
+  : m_ready(false), m_scheduler(scheduler)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Adds a function to call once the task has finished (if the task has already finished, the function is called immediately).
+   *
+   * \param continuation  The function to call.
+   */
+  void add_continuation(const boost::function<void()>& continuation)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      if(!m_ready)
+      {
+        m_continuations.push_back(continuation);
+        return;
+      }
+    }
+
+    continuation();
+  }
+
+  /**
+   * \brief Gets the result of the task, blocking until it has finished.
+   *
+   * \return  The result of the task.
+   * \throws  Any exception thrown by the task.
+   */
+  const TaskResult<T>& get_result() const
+  {
+    wait();
+    if(m_error) boost::rethrow_exception(m_error);
+    return m_result;
+  }
+
+  /**
+   * \brief Gets the scheduler on which the task is being run.
+   *
+   * \return  The scheduler on which the task is being run.
+   */
+  TaskScheduler *get_scheduler() const
+  {
+    return m_scheduler;
+  }
+
+  /**
+   * \brief Gets whether or not the task has finished.
+   *
+   * \return  true, if the task has finished, or false otherwise.
+   */
+  bool is_ready() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_ready;
+  }
+
+  /**
+   * \brief Runs the task, stores its result (or the exception it throws), and then calls any continuations.
+   *
+   * \param f The function to run.
+   */
+  template <typename F>
+  void run(F& f)
+  {
+    try
+    {
+      m_result.compute(f);
+    }
+    catch(...)
+    {
+      m_error = boost::current_exception();
+    }
+
+    std::vector<boost::function<void()> > continuations;
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_ready = true;
+      continuations.swap(m_continuations);
+    }
+
+    m_finished.notify_all();
+
+    for(size_t i = 0, size = continuations.size(); i < size; ++i)
+    {
+      continuations[i]();
+    }
+  }
+
+  /**
+   * \brief Blocks until the task has finished.
+   */
+  void wait() const
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while(!m_ready) m_finished.wait(lock);
+  }
+};
+
+}
+
+/**
+ * \brief An instance of an instantiation of this class template represents the eventual result of a task (returning a value of type T)
+ *        that has been submitted to a task scheduler.
+ *
+ * Futures are cheap to copy: all copies refer to the same underlying task.
+ */
+template <typename T>
+class TaskFuture
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef task_detail::TaskState<T> State;
+  typedef boost::shared_ptr<State> State_Ptr;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The shared state of the task (if any). */
+  State_Ptr m_state;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an invalid future (i.e. one that does not refer to a task).
+   */
+  TaskFuture() {}
+
+  /**
+   * \brief Constructs a future that refers to the task with the specified shared state.
+   *
+   * \param state The shared state of the task.
+   */
+  explicit TaskFuture(const State_Ptr& state)
+  : m_state(state)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the result of the task, blocking until it has finished.
+   *
+   * \return                    The result of the task.
+   * \throws std::runtime_error If the future is invalid.
+   * \throws                    Any exception thrown by the task.
+   */
+  T get() const
+  {
+    return checked_state().get_result().get();
+  }
+
+  /**
+   * \brief Gets whether or not the task has finished.
+   *
+   * \return                    true, if the task has finished, or false otherwise.
+   * \throws std::runtime_error If the future is invalid.
+   */
+  bool is_ready() const
+  {
+    return checked_state().is_ready();
+  }
+
+  /**
+   * \brief Schedules a continuation to run (on the same scheduler) once the task has finished.
+   *
+   * The continuation is passed this future, on which it can call get() to retrieve the task's result (or rethrow its exception).
+   *
+   * \param f                   The continuation.
+   * \param priority            The priority with which to schedule the continuation.
+   * \return                    A future representing the eventual result of the continuation.
+   * \throws std::runtime_error If the future is invalid.
+   */
+  template <typename F>
+  TaskFuture<typename boost::result_of<F(TaskFuture<T>)>::type> then(F f, TaskPriority priority = TP_NORMAL) const;
+
+  /**
+   * \brief Gets whether or not the future refers to a task.
+   *
+   * \return  true, if the future refers to a task, or false otherwise.
+   */
+  bool valid() const
+  {
+    return m_state.get() != NULL;
+  }
+
+  /**
+   * \brief Blocks until the task has finished.
+   *
+   * \throws std::runtime_error If the future is invalid.
+   */
+  void wait() const
+  {
+    checked_state().wait();
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets the shared state of the task, checking that the future is valid.
+   *
+   * \return                    The shared state of the task.
+   * \throws std::runtime_error If the future is invalid.
+   */
+  State& checked_state() const
+  {
+    if(!m_state) throw std::runtime_error("Error: Cannot use an invalid task future");
+    return *m_state;
+  }
+};
+
+}
+
+#endif
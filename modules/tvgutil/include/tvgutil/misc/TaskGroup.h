@@ -0,0 +1,118 @@
+/**
+ * tvgutil: TaskGroup.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_TASKGROUP
+#define H_TVGUTIL_TASKGROUP
+
+#include "TaskScheduler.h"
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of this class represents a group of tasks, run on a task scheduler, that can be waited for as a whole.
+ *
+ * The group keeps its own queue of tasks that have not yet been started, and posts one runner per task to the scheduler.
+ * A thread that waits for the group helps by running the group's own pending tasks (and never any unrelated tasks, which
+ * could take arbitrarily long), and blocks once all of the group's remaining tasks are running elsewhere. This makes it
+ * safe to wait for a group from within a task running on the same scheduler.
+ */
+class TaskGroup
+{
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the state of a task group.
+   *
+   * The state is shared with the runners posted to the scheduler, since a runner can still be started after the group
+   * has been destroyed (if its task has already been run by a thread waiting for the group).
+   */
+  struct State
+  {
+    /** The first exception thrown by any of the tasks in the group since the group was last waited for (if any). */
+    boost::exception_ptr error;
+
+    /** A mutex used to synchronise access to the state. */
+    boost::mutex mutex;
+
+    /** The number of tasks in the group that have not yet finished. */
+    size_t outstandingTaskCount;
+
+    /** The tasks in the group that have not yet been started, indexed by priority. */
+    std::deque<TaskScheduler::Task> pendingTasks[TP_COUNT];
+
+    /** A condition variable used to wait for a task in the group to finish or become pending. */
+    boost::condition_variable stateChanged;
+
+    State()
+    : outstandingTaskCount(0)
+    {}
+  };
+
+  typedef boost::shared_ptr<State> State_Ptr;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The scheduler on which to run the tasks. */
+  TaskScheduler& m_scheduler;
+
+  /** The state of the group. */
+  State_Ptr m_state;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty task group.
+   *
+   * \param scheduler The scheduler on which to run the tasks.
+   */
+  explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance());
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the task group, waiting for any outstanding tasks to finish.
+   */
+  ~TaskGroup();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  TaskGroup(const TaskGroup&);
+  TaskGroup& operator=(const TaskGroup&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Adds a task to the group and schedules it to be run.
+   *
+   * \param task      The task to run.
+   * \param priority  The priority with which to schedule the task.
+   */
+  void run(const TaskScheduler::Task& task, TaskPriority priority = TP_NORMAL);
+
+  /**
+   * \brief Waits for all of the tasks in the group to finish (helping to run the group's pending tasks in the meantime).
+   *
+   * \throws  The first exception thrown by any of the tasks in the group since the group was last waited for (if any).
+   */
+  void wait();
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Runs the highest-priority pending task in a group (if any), recording any exception it throws and then marking it as finished.
+   *
+   * This is called both by the runners posted to the scheduler and by threads that are waiting for the group. Since each task is only
+   * ever run once, some of the runners will find that there is no task left for them to run.
+   *
+   * \param state The state of the group.
+   * \return      true, if a task was run, or false if the group had no pending tasks.
+   */
+  static bool run_pending_task(const State_Ptr& state);
+};
+
+}
+
+#endif
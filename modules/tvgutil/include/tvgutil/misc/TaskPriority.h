@@ -0,0 +1,33 @@
+/**
+ * tvgutil: TaskPriority.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_TASKPRIORITY
+#define H_TVGUTIL_TASKPRIORITY
+
+namespace tvgutil {
+
+/**
+ * \brief The values of this enumeration denote the priorities with which tasks can be scheduled on a task scheduler.
+ *
+ * Pending tasks of a higher priority are always started before pending tasks of a lower priority.
+ */
+enum TaskPriority
+{
+  /** Tasks that are on the critical path of the current frame (e.g. processing the scenes in a multi-scene pipeline). */
+  TP_HIGH,
+
+  /** Tasks that should be run promptly, but that are not on the critical path. */
+  TP_NORMAL,
+
+  /** Background tasks (e.g. saving images or poses to disk). */
+  TP_LOW,
+
+  /** The number of different task priorities (not itself a valid priority). */
+  TP_COUNT
+};
+
+}
+
+#endif
@@ -0,0 +1,337 @@
+/**
+ * tvgutil: TaskScheduler.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_TASKSCHEDULER
+#define H_TVGUTIL_TASKSCHEDULER
+
+#include <deque>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "TaskFuture.h"
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of this class can be used to run tasks asynchronously on a fixed-size pool of worker threads.
+ *
+ * Each worker thread has its own deques of pending tasks (one per priority). Tasks submitted by a worker (e.g. continuations,
+ * or the subtasks of a task group) are pushed onto the back of its own deques and popped from the back again (so that
+ * recently-submitted, cache-hot tasks are run first), whereas tasks submitted from other threads are pushed onto a shared
+ * queue. A worker that runs out of tasks of its own steals them from the front of the other workers' deques. Pending tasks
+ * of a higher priority are always started before pending tasks of a lower priority.
+ *
+ * The number of pending tasks can optionally be bounded: submitting a task from outside the scheduler when the bound has been
+ * reached blocks until space becomes available. Tasks submitted by the workers themselves are never blocked, since that could
+ * deadlock the scheduler.
+ *
+ * A single scheduler (sized to match the hardware) is intended to be shared by the whole process, to avoid oversubscribing
+ * the cores with several independent pools of threads. For the same reason, when OpenMP is enabled, the OpenMP threads are
+ * divided between the workers, so that parallel regions inside tasks that run concurrently do not each try to use every core.
+ */
+class TaskScheduler
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef boost::function<void()> Task;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the pending tasks in a single queue, one deque per priority.
+   */
+  struct TaskQueue
+  {
+    /** A mutex used to synchronise access to the deques. */
+    boost::mutex mutex;
+
+    /** The pending tasks, indexed by priority. */
+    std::deque<Task> tasks[TP_COUNT];
+  };
+
+  typedef boost::shared_ptr<TaskQueue> TaskQueue_Ptr;
+
+  /**
+   * \brief An instance of an instantiation of this struct template runs a function and stores its result in the shared state of a task.
+   */
+  template <typename R, typename F>
+  struct TaskRunner
+  {
+    typename TaskFuture<R>::State_Ptr state;
+    F f;
+
+    TaskRunner(const typename TaskFuture<R>::State_Ptr& state_, const F& f_)
+    : state(state_), f(f_)
+    {}
+
+    void operator()()
+    {
+      state->run(f);
+    }
+  };
+
+  /**
+   * \brief An instance of this struct identifies a worker thread (it is stored in thread-specific storage on each worker).
+   */
+  struct WorkerContext
+  {
+    /** The scheduler to which the worker belongs. */
+    const TaskScheduler *scheduler;
+
+    /** The index of the worker within the scheduler. */
+    size_t workerIndex;
+
+    WorkerContext(const TaskScheduler *scheduler_, size_t workerIndex_)
+    : scheduler(scheduler_), workerIndex(workerIndex_)
+    {}
+  };
+
+  // Futures need to be able to create task runners for their continuations.
+  template <typename T> friend class TaskFuture;
+
+  //#################### PRIVATE STATIC VARIABLES ####################
+private:
+  /** The context of the calling thread (if it is a worker thread for any scheduler). */
+  static boost::thread_specific_ptr<WorkerContext> s_workerContext;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The maximum number of tasks that can be pending at any one time (0 means unbounded). */
+  size_t m_maxPendingTaskCount;
+
+  /** A mutex used to synchronise access to the pending task count and the stop flag. */
+  boost::mutex m_mutex;
+
+  /** The maximum number of OpenMP threads used by a parallel region inside a task (at least one). */
+  int m_openMPThreadsPerWorker;
+
+  /** The number of tasks that have been submitted but not yet started. */
+  size_t m_pendingTaskCount;
+
+  /** The queue onto which tasks submitted from outside the scheduler are pushed. */
+  TaskQueue m_sharedQueue;
+
+  /** A condition variable used to wait for space to become available for a new task (if the number of pending tasks is bounded). */
+  boost::condition_variable m_spaceAvailable;
+
+  /** Whether or not the worker threads should stop once there are no more pending tasks. */
+  bool m_stopping;
+
+  /** A condition variable used by idle worker threads to wait for new tasks. */
+  boost::condition_variable m_taskAvailable;
+
+  /** The worker threads' own task queues. */
+  std::vector<TaskQueue_Ptr> m_workerQueues;
+
+  /** The worker threads. */
+  boost::thread_group m_workers;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a task scheduler.
+   *
+   * When OpenMP is enabled, each worker limits the OpenMP parallel regions it runs to its share of the OpenMP threads
+   * that are available to the calling thread (i.e. omp_get_max_threads() / workerCount, rounded down, but at least one).
+   *
+   * \param workerCount           The number of worker threads to use (0 means one per hardware thread).
+   * \param maxPendingTaskCount   The maximum number of tasks that can be pending at any one time (0 means unbounded).
+   */
+  explicit TaskScheduler(size_t workerCount = 0, size_t maxPendingTaskCount = 0);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the task scheduler.
+   *
+   * \note  Any pending tasks are run before the worker threads are joined, so this can block.
+   */
+  ~TaskScheduler();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  TaskScheduler(const TaskScheduler&);
+  TaskScheduler& operator=(const TaskScheduler&);
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets a global instance of the task scheduler that has been constructed with default parameters.
+   *
+   * This can be used when there is no need to control the lifecycle of the scheduler.
+   *
+   * \return The default global instance of the task scheduler.
+   */
+  static TaskScheduler& instance();
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the maximum number of OpenMP threads used by a parallel region inside a task.
+   *
+   * \return  The maximum number of OpenMP threads used by a parallel region inside a task (1 if OpenMP is disabled).
+   */
+  int get_openmp_threads_per_worker() const;
+
+  /**
+   * \brief Gets the number of worker threads used by the scheduler.
+   *
+   * \return  The number of worker threads used by the scheduler.
+   */
+  size_t get_worker_count() const;
+
+  /**
+   * \brief Schedules a task to be run asynchronously, without any way of waiting for it or retrieving its result.
+   *
+   * If the number of pending tasks is bounded and the bound has been reached, this blocks until space becomes available
+   * (unless it is called from one of the scheduler's own worker threads).
+   *
+   * \note  Any exception thrown by the task will be reported on std::cerr and otherwise ignored.
+   *
+   * \param task      The task to run.
+   * \param priority  The priority with which to schedule the task.
+   */
+  void post(const Task& task, TaskPriority priority = TP_NORMAL);
+
+  /**
+   * \brief Schedules a function to be run asynchronously.
+   *
+   * If the number of pending tasks is bounded and the bound has been reached, this blocks until space becomes available
+   * (unless it is called from one of the scheduler's own worker threads).
+   *
+   * \param f         The function to run.
+   * \param priority  The priority with which to schedule the function.
+   * \return          A future representing the eventual result of the function.
+   */
+  template <typename F>
+  TaskFuture<typename boost::result_of<F()>::type> submit(F f, TaskPriority priority = TP_NORMAL)
+  {
+    typedef typename boost::result_of<F()>::type R;
+    typename TaskFuture<R>::State_Ptr state(new typename TaskFuture<R>::State(this));
+    post(TaskRunner<R,F>(state, f), priority);
+    return TaskFuture<R>(state);
+  }
+
+  /**
+   * \brief Attempts to schedule a task to be run asynchronously, without blocking if the number of pending tasks is bounded and the bound has been reached.
+   *
+   * \param task      The task to run.
+   * \param priority  The priority with which to schedule the task.
+   * \return          true, if the task was successfully scheduled, or false otherwise.
+   */
+  bool try_post(const Task& task, TaskPriority priority = TP_NORMAL);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets the index of the calling thread within the scheduler's worker threads (if it is one of them).
+   *
+   * \return  The index of the calling thread, or -1 if it is not one of the scheduler's worker threads.
+   */
+  int get_current_worker_index() const;
+
+  /**
+   * \brief Schedules a task to be run asynchronously.
+   *
+   * \param task      The task to run.
+   * \param priority  The priority with which to schedule the task.
+   * \param block     Whether or not to wait for space to become available if the number of pending tasks is bounded and the bound has been reached.
+   * \return          true, if the task was successfully scheduled, or false otherwise.
+   */
+  bool post_task(const Task& task, TaskPriority priority, bool block);
+
+  /**
+   * \brief Runs a task, reporting (and otherwise ignoring) any exception it throws.
+   *
+   * \param task  The task to run.
+   */
+  static void run_task(const Task& task);
+
+  /**
+   * \brief Runs the main loop of a worker thread.
+   *
+   * \param workerIndex The index of the worker thread.
+   */
+  void run_worker(size_t workerIndex);
+
+  /**
+   * \brief Attempts to take a pending task from the scheduler's queues.
+   *
+   * Higher-priority tasks are preferred over lower-priority ones. Within each priority, the calling worker's own deque (if any)
+   * is tried first, then the shared queue, and finally the other workers' deques.
+   *
+   * \param workerIndex The index of the calling worker thread (or -1 if it is not one of the scheduler's worker threads).
+   * \param task        A place in which to store the task (if one is found).
+   * \return            true, if a task was found, or false otherwise.
+   */
+  bool try_take_task(int workerIndex, Task& task);
+};
+
+//#################### TEMPLATE MEMBER FUNCTION DEFINITIONS ####################
+
+namespace task_detail {
+
+/**
+ * \brief An instance of an instantiation of this struct template calls a continuation with the future of the task it continues.
+ */
+template <typename R, typename F, typename T>
+struct ContinuationCaller
+{
+  F f;
+  TaskFuture<T> antecedent;
+
+  ContinuationCaller(const F& f_, const TaskFuture<T>& antecedent_)
+  : f(f_), antecedent(antecedent_)
+  {}
+
+  R operator()()
+  {
+    return f(antecedent);
+  }
+};
+
+/**
+ * \brief An instance of this struct posts a task to a scheduler (it is used to schedule a continuation once its antecedent has finished).
+ */
+struct TaskPoster
+{
+  TaskPriority priority;
+  TaskScheduler *scheduler;
+  TaskScheduler::Task task;
+
+  TaskPoster(TaskScheduler *scheduler_, const TaskScheduler::Task& task_, TaskPriority priority_)
+  : priority(priority_), scheduler(scheduler_), task(task_)
+  {}
+
+  void operator()() const
+  {
+    scheduler->post(task, priority);
+  }
+};
+
+}
+
+template <typename T>
+template <typename F>
+TaskFuture<typename boost::result_of<F(TaskFuture<T>)>::type> TaskFuture<T>::then(F f, TaskPriority priority) const
+{
+  typedef typename boost::result_of<F(TaskFuture<T>)>::type R;
+  typedef task_detail::ContinuationCaller<R,F,T> Caller;
+
+  TaskScheduler *scheduler = checked_state().get_scheduler();
+  typename TaskFuture<R>::State_Ptr state(new typename TaskFuture<R>::State(scheduler));
+  TaskScheduler::TaskRunner<R,Caller> runner(state, Caller(f, *this));
+  m_state->add_continuation(task_detail::TaskPoster(scheduler, runner, priority));
+  return TaskFuture<R>(state);
+}
+
+}
+
+#endif
@@ -9,8 +9,10 @@
 #include <map>
 #include <stdexcept>
 
-#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/split_member.hpp>
 
+#include "../containers/FlatMap.h"
 #include "../containers/LimitedContainer.h"
 
 namespace tvgutil {
@@ -21,10 +23,18 @@ namespace tvgutil {
 template <typename Label>
 class Histogram
 {
+  //#################### TYPEDEFS ####################
+public:
+  /**
+   * The type of the bins. Histograms are built and queried on hot paths (e.g. during forest training and prediction),
+   * and typically only contain a handful of labels, so the bins are stored contiguously rather than in a std::map.
+   */
+  typedef FlatMap<Label,size_t> Bins;
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The bins that record the number of instances of each label that have been seen. */
-  std::map<Label,size_t> m_bins;
+  Bins m_bins;
 
   /** The total number of instances that are in the histogram. */
   size_t m_count;
@@ -66,7 +76,7 @@ public:
    *
    * \return The bins that record the number of instances of each label that have been seen.
    */
-  const std::map<Label,size_t>& get_bins() const
+  const Bins& get_bins() const
   {
     return m_bins;
   }
@@ -84,18 +94,38 @@ public:
   //#################### SERIALIZATION #################### 
 private:
   /**
-   * \brief Serializes the histogram to/from an archive.
+   * \brief Loads the histogram from an archive.
+   *
+   * The bins are serialized as a std::map, so that the format is compatible with that of existing saved forests.
+   *
+   * \param ar      The archive.
+   * \param version The file format version number.
+   */
+  template<typename Archive>
+  void load(Archive& ar, const unsigned int version)
+  {
+    std::map<Label,size_t> bins;
+    ar & bins;
+    ar & m_count;
+    m_bins = Bins(bins);
+  }
+
+  /**
+   * \brief Saves the histogram to an archive.
    *
    * \param ar      The archive.
    * \param version The file format version number.
    */
   template<typename Archive>
-  void serialize(Archive& ar, const unsigned int version)
+  void save(Archive& ar, const unsigned int version) const
   {
-    ar & m_bins;
+    const std::map<Label,size_t> bins = m_bins.to_map();
+    ar & bins;
     ar & m_count;
   }
 
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
   friend class boost::serialization::access;
 };
 
@@ -29,10 +29,15 @@ const float SMALL_EPSILON = 1e-9f;
 template <typename Label>
 class ProbabilityMassFunction
 {
+  //#################### TYPEDEFS ####################
+public:
+  /** The type of the map from labels to masses (stored contiguously, since PMFs are built for every forest prediction). */
+  typedef FlatMap<Label,float> Masses;
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The masses for the various labels. */
-  std::map<Label,float> m_masses;
+  Masses m_masses;
 
   //#################### CONSTRUCTORS ####################
 public:
@@ -54,6 +59,24 @@ public:
     ensure_invariant();
   }
 
+  /**
+   * \brief Constructs a probability mass function (PMF) by normalising a map from labels -> masses.
+   *
+   * \pre
+   *   - !masses.empty()
+   *   - Each mass >= 0
+   *   - At least one mass > 0
+   *
+   * \param masses  The label -> masses map to normalise.
+   */
+  explicit ProbabilityMassFunction(const Masses& masses)
+  : m_masses(masses)
+  {
+    assert(!masses.empty());
+    normalise();
+    ensure_invariant();
+  }
+
   /**
    * \brief Constructs a probability mass function (PMF) as a normalised version of the specified histogram.
    *
@@ -63,10 +86,11 @@ public:
   explicit ProbabilityMassFunction(const Histogram<Label>& histogram, const boost::optional<std::map<Label,float> >& multipliers = boost::none)
   {
     // Determine the masses for the labels in the histogram by dividing the number of instances in each bin by the histogram count.
-    const std::map<Label,size_t>& bins = histogram.get_bins();
+    const typename Histogram<Label>::Bins& bins = histogram.get_bins();
     size_t count = histogram.get_count();
     if(count == 0) throw std::runtime_error("Cannot make a probability mass function from an empty histogram");
-    for(typename std::map<Label,size_t>::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    m_masses.reserve(bins.size());
+    for(typename Histogram<Label>::Bins::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
     {
       float mass = static_cast<float>(it->second) / count;
 
@@ -112,7 +136,7 @@ public:
   float calculate_entropy() const
   {
     float entropy = 0.0f;
-    for(typename std::map<Label,float>::const_iterator it = m_masses.begin(), iend = m_masses.end(); it != iend; ++it)
+    for(typename Masses::const_iterator it = m_masses.begin(), iend = m_masses.end(); it != iend; ++it)
     {
       float mass = it->second;
       if(mass > 0)
@@ -129,11 +153,23 @@ public:
    *
    * \return The masses for the various labels.
    */
-  const std::map<Label,float>& get_masses() const
+  const Masses& get_masses() const
   {
     return m_masses;
   }
 
+  /**
+   * \brief Gets the mass for the specified label.
+   *
+   * \param label The label.
+   * \return      The mass for the label (0, if the PMF does not contain the label).
+   */
+  float get_mass(const Label& label) const
+  {
+    typename Masses::const_iterator it = m_masses.find(label);
+    return it != m_masses.end() ? it->second : 0.0f;
+  }
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
@@ -144,7 +180,7 @@ private:
   float calculate_sum()
   {
     float sum = 0.0f;
-    for(typename std::map<Label,float>::const_iterator it = m_masses.begin(), iend = m_masses.end(); it != iend; ++it)
+    for(typename Masses::const_iterator it = m_masses.begin(), iend = m_masses.end(); it != iend; ++it)
     {
       assert(it->second >= 0.0f);
       sum += it->second;
@@ -175,7 +211,7 @@ private:
     if(fabs(sum) < SMALL_EPSILON) throw std::runtime_error("Cannot normalise the probability mass function: denominator too small");
 
     // Normalise the PMF by dividing each mass by the sum.
-    for(typename std::map<Label,float>::iterator it = m_masses.begin(), iend = m_masses.end(); it != iend; ++it)
+    for(typename Masses::iterator it = m_masses.begin(), iend = m_masses.end(); it != iend; ++it)
     {
       it->second /= sum;
     }
@@ -5,12 +5,20 @@
 
 #include "misc/SettingsContainer.h"
 
+#include <boost/thread/lock_guard.hpp>
+
 namespace tvgutil {
 
 //#################### CONSTANTS ####################
 
 const std::string SettingsContainer::NOT_SET = "<Not Set>";
 
+//#################### CONSTRUCTORS ####################
+
+SettingsContainer::SettingsContainer()
+: m_generation(0)
+{}
+
 //#################### DESTRUCTOR ####################
 
 SettingsContainer::~SettingsContainer() {}
@@ -20,6 +28,18 @@ SettingsContainer::~SettingsContainer() {}
 void SettingsContainer::add_value(const std::string& key, const std::string& value)
 {
   m_settings[key].push_back(value);
+  ++m_generation;
+}
+
+size_t SettingsContainer::get_generation() const
+{
+  return m_generation;
+}
+
+std::vector<std::string> SettingsContainer::get_raw_values(const std::string& key) const
+{
+  static std::vector<std::string> defaultEmptyVector;
+  return MapUtil::lookup(m_settings, key, defaultEmptyVector);
 }
 
 bool SettingsContainer::has_values(const std::string& key) const
@@ -27,6 +47,47 @@ bool SettingsContainer::has_values(const std::string& key) const
   return MapUtil::contains(m_settings, key);
 }
 
+void SettingsContainer::output_effective_settings(std::ostream& os) const
+{
+  // Combine the settings that have been explicitly set with the defaults of any registered settings that have not.
+  std::map<std::string,std::vector<std::string> > effectiveSettings = m_settings;
+  {
+    boost::lock_guard<boost::mutex> lock(m_registeredDefaultsMutex);
+    for(std::map<std::string,std::vector<std::string> >::const_iterator it = m_registeredDefaults.begin(), iend = m_registeredDefaults.end(); it != iend; ++it)
+    {
+      std::vector<std::string>& values = effectiveSettings[it->first];
+      if(values.empty() || values[0] == NOT_SET) values = it->second;
+    }
+  }
+
+  for(std::map<std::string,std::vector<std::string> >::const_iterator it = effectiveSettings.begin(), iend = effectiveSettings.end(); it != iend; ++it)
+  {
+    const std::vector<std::string>& values = it->second;
+    if(values.empty() || values[0] == NOT_SET)
+    {
+      os << "#" << it->first << "=\n";
+      continue;
+    }
+
+    for(std::vector<std::string>::const_iterator jt = values.begin(), jend = values.end(); jt != jend; ++jt)
+    {
+      os << it->first << '=' << *jt << '\n';
+    }
+  }
+}
+
+void SettingsContainer::register_setting(const std::string& key, const std::vector<std::string>& defaultValues) const
+{
+  boost::lock_guard<boost::mutex> lock(m_registeredDefaultsMutex);
+  m_registeredDefaults.insert(std::make_pair(key, defaultValues));
+}
+
+void SettingsContainer::set_values(const std::string& key, const std::vector<std::string>& values)
+{
+  m_settings[key] = values;
+  ++m_generation;
+}
+
 //#################### STREAM OPERATORS ####################
 
 std::ostream& operator<<(std::ostream& os, const SettingsContainer& rhs)
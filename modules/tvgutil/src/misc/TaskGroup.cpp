@@ -0,0 +1,120 @@
+/**
+ * tvgutil: TaskGroup.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "misc/TaskGroup.h"
+
+#include <boost/bind.hpp>
+
+namespace tvgutil {
+
+//#################### CONSTRUCTORS ####################
+
+TaskGroup::TaskGroup(TaskScheduler& scheduler)
+: m_scheduler(scheduler), m_state(new State)
+{}
+
+//#################### DESTRUCTOR ####################
+
+TaskGroup::~TaskGroup()
+{
+  // Make sure that no task can outlive the group, but don't let any exception escape from the destructor.
+  try
+  {
+    wait();
+  }
+  catch(...) {}
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void TaskGroup::run(const TaskScheduler::Task& task, TaskPriority priority)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_state->mutex);
+    ++m_state->outstandingTaskCount;
+    m_state->pendingTasks[priority].push_back(task);
+  }
+
+  // Wake up any thread that is waiting for the group, so that it can help to run the new task.
+  m_state->stateChanged.notify_all();
+
+  m_scheduler.post(boost::bind(&TaskGroup::run_pending_task, m_state), priority);
+}
+
+void TaskGroup::wait()
+{
+  // Help to run the group's pending tasks until either all of them have finished, or the remaining ones are all running
+  // on other threads (in which case, wait for them to finish or for new tasks to be added to the group).
+  while(true)
+  {
+    if(run_pending_task(m_state)) continue;
+
+    boost::unique_lock<boost::mutex> lock(m_state->mutex);
+    if(m_state->outstandingTaskCount == 0) break;
+
+    bool hasPendingTasks = false;
+    for(int priority = 0; priority < TP_COUNT && !hasPendingTasks; ++priority)
+    {
+      hasPendingTasks = !m_state->pendingTasks[priority].empty();
+    }
+
+    if(!hasPendingTasks) m_state->stateChanged.wait(lock);
+  }
+
+  // Propagate the first exception thrown by any of the tasks (if any).
+  boost::exception_ptr error;
+  {
+    boost::lock_guard<boost::mutex> lock(m_state->mutex);
+    error = m_state->error;
+    m_state->error = boost::exception_ptr();
+  }
+
+  if(error) boost::rethrow_exception(error);
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+bool TaskGroup::run_pending_task(const State_Ptr& state)
+{
+  // Take the highest-priority pending task (if any).
+  TaskScheduler::Task task;
+  {
+    boost::lock_guard<boost::mutex> lock(state->mutex);
+    for(int priority = 0; priority < TP_COUNT && task.empty(); ++priority)
+    {
+      std::deque<TaskScheduler::Task>& tasks = state->pendingTasks[priority];
+      if(!tasks.empty())
+      {
+        task.swap(tasks.front());
+        tasks.pop_front();
+      }
+    }
+  }
+
+  if(task.empty()) return false;
+
+  // Run the task, recording any exception it throws.
+  boost::exception_ptr error;
+  try
+  {
+    task();
+  }
+  catch(...)
+  {
+    error = boost::current_exception();
+  }
+
+  // Mark the task as finished.
+  {
+    boost::lock_guard<boost::mutex> lock(state->mutex);
+    if(error && !state->error) state->error = error;
+    --state->outstandingTaskCount;
+  }
+
+  state->stateChanged.notify_all();
+  return true;
+}
+
+}
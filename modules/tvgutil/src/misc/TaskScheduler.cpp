@@ -0,0 +1,249 @@
+/**
+ * tvgutil: TaskScheduler.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "misc/TaskScheduler.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <boost/bind.hpp>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+namespace tvgutil {
+
+//#################### PRIVATE STATIC VARIABLES ####################
+
+boost::thread_specific_ptr<TaskScheduler::WorkerContext> TaskScheduler::s_workerContext;
+
+//#################### CONSTRUCTORS ####################
+
+TaskScheduler::TaskScheduler(size_t workerCount, size_t maxPendingTaskCount)
+: m_maxPendingTaskCount(maxPendingTaskCount), m_openMPThreadsPerWorker(1), m_pendingTaskCount(0), m_stopping(false)
+{
+  if(workerCount == 0) workerCount = std::max(boost::thread::hardware_concurrency(), 1U);
+
+#ifdef WITH_OPENMP
+  // Divide the OpenMP threads between the workers, so that tasks that use OpenMP and run concurrently don't oversubscribe the cores.
+  m_openMPThreadsPerWorker = std::max(omp_get_max_threads() / static_cast<int>(workerCount), 1);
+#endif
+
+  // Note that the worker queues must all be created before any of the workers are started, since the workers may try to steal from each other.
+  for(size_t i = 0; i < workerCount; ++i)
+  {
+    m_workerQueues.push_back(TaskQueue_Ptr(new TaskQueue));
+  }
+
+  for(size_t i = 0; i < workerCount; ++i)
+  {
+    m_workers.create_thread(boost::bind(&TaskScheduler::run_worker, this, i));
+  }
+}
+
+//#################### DESTRUCTOR ####################
+
+TaskScheduler::~TaskScheduler()
+{
+  // Tell the workers to stop once they have run any pending tasks, and wait for them to do so.
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+
+  m_taskAvailable.notify_all();
+  m_workers.join_all();
+}
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+TaskScheduler& TaskScheduler::instance()
+{
+  static TaskScheduler s_instance;
+  return s_instance;
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+int TaskScheduler::get_openmp_threads_per_worker() const
+{
+  return m_openMPThreadsPerWorker;
+}
+
+size_t TaskScheduler::get_worker_count() const
+{
+  return m_workerQueues.size();
+}
+
+void TaskScheduler::post(const Task& task, TaskPriority priority)
+{
+  post_task(task, priority, true);
+}
+
+bool TaskScheduler::try_post(const Task& task, TaskPriority priority)
+{
+  return post_task(task, priority, false);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+int TaskScheduler::get_current_worker_index() const
+{
+  const WorkerContext *context = s_workerContext.get();
+  return context && context->scheduler == this ? static_cast<int>(context->workerIndex) : -1;
+}
+
+bool TaskScheduler::post_task(const Task& task, TaskPriority priority, bool block)
+{
+  const int workerIndex = get_current_worker_index();
+
+  // Reserve a slot for the task. If the number of pending tasks is bounded and the bound has been reached, either wait
+  // for space to become available or give up. Note that we never make a worker wait, since that could deadlock the scheduler.
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    if(m_maxPendingTaskCount > 0 && workerIndex == -1)
+    {
+      while(m_pendingTaskCount >= m_maxPendingTaskCount)
+      {
+        if(!block) return false;
+        m_spaceAvailable.wait(lock);
+      }
+    }
+
+    ++m_pendingTaskCount;
+  }
+
+  // Push the task onto the calling worker's own queue (if any), or onto the shared queue otherwise.
+  TaskQueue& queue = workerIndex != -1 ? *m_workerQueues[workerIndex] : m_sharedQueue;
+  {
+    boost::lock_guard<boost::mutex> lock(queue.mutex);
+    queue.tasks[priority].push_back(task);
+  }
+
+  // Wake up an idle worker to run the task.
+  m_taskAvailable.notify_one();
+  return true;
+}
+
+void TaskScheduler::run_task(const Task& task)
+{
+  try
+  {
+    task();
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << "Warning: Task failed: " << e.what() << '\n';
+  }
+  catch(...)
+  {
+    std::cerr << "Warning: Task failed with an unknown exception\n";
+  }
+}
+
+void TaskScheduler::run_worker(size_t workerIndex)
+{
+  s_workerContext.reset(new WorkerContext(this, workerIndex));
+
+#ifdef WITH_OPENMP
+  // Limit the OpenMP parallel regions run by this worker to its share of the OpenMP threads.
+  omp_set_num_threads(m_openMPThreadsPerWorker);
+#endif
+
+  while(true)
+  {
+    // Run the next pending task (if any).
+    Task task;
+    if(try_take_task(static_cast<int>(workerIndex), task))
+    {
+      run_task(task);
+      continue;
+    }
+
+    // If there are no pending tasks, either stop (if the scheduler is being destroyed) or go to sleep until a new task is submitted.
+    // If a task has been submitted but not yet pushed onto its queue, yield briefly rather than sleeping.
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    if(m_pendingTaskCount == 0)
+    {
+      if(m_stopping) break;
+      m_taskAvailable.wait(lock);
+    }
+    else
+    {
+      lock.unlock();
+      boost::this_thread::yield();
+    }
+  }
+}
+
+bool TaskScheduler::try_take_task(int workerIndex, Task& task)
+{
+  const int workerCount = static_cast<int>(m_workerQueues.size());
+
+  bool found = false;
+  for(int priority = 0; priority < TP_COUNT && !found; ++priority)
+  {
+    // First, try to pop the most recently submitted task from the calling worker's own queue.
+    if(workerIndex != -1)
+    {
+      TaskQueue& queue = *m_workerQueues[workerIndex];
+      boost::lock_guard<boost::mutex> lock(queue.mutex);
+      std::deque<Task>& tasks = queue.tasks[priority];
+      if(!tasks.empty())
+      {
+        task.swap(tasks.back());
+        tasks.pop_back();
+        found = true;
+        break;
+      }
+    }
+
+    // Next, try to take the oldest task from the shared queue.
+    {
+      boost::lock_guard<boost::mutex> lock(m_sharedQueue.mutex);
+      std::deque<Task>& tasks = m_sharedQueue.tasks[priority];
+      if(!tasks.empty())
+      {
+        task.swap(tasks.front());
+        tasks.pop_front();
+        found = true;
+        break;
+      }
+    }
+
+    // Finally, try to steal the oldest task from one of the other workers' queues.
+    for(int k = 1; k <= workerCount && !found; ++k)
+    {
+      const int victimIndex = (workerIndex + k + workerCount) % workerCount;
+      if(victimIndex == workerIndex) continue;
+
+      TaskQueue& queue = *m_workerQueues[victimIndex];
+      boost::lock_guard<boost::mutex> lock(queue.mutex);
+      std::deque<Task>& tasks = queue.tasks[priority];
+      if(!tasks.empty())
+      {
+        task.swap(tasks.front());
+        tasks.pop_front();
+        found = true;
+      }
+    }
+  }
+
+  // If we found a task, release its slot so that another task can be submitted.
+  if(found)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      --m_pendingTaskCount;
+    }
+
+    m_spaceAvailable.notify_one();
+  }
+
+  return found;
+}
+
+}
@@ -14,8 +14,8 @@ int main()
   for(int i=0; i<5; ++i) hist.add(84);
   for(int i=0; i<500; ++i) hist.add(24);
   ProbabilityMassFunction<int> pmf(hist);
-  const std::map<int,float>& masses = pmf.get_masses();
-  /*for(std::map<int,float>::const_iterator it = masses.begin(), iend = masses.end(); it != iend; ++it)
+  const ProbabilityMassFunction<int>::Masses& masses = pmf.get_masses();
+  /*for(ProbabilityMassFunction<int>::Masses::const_iterator it = masses.begin(), iend = masses.end(); it != iend; ++it)
   {
     std::cout << it->first << ' ' << it->second << '\n';
   }*/
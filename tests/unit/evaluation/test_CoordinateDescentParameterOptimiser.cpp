@@ -1,8 +1,13 @@
 #define BOOST_TEST_MAIN
 #include <boost/test/unit_test.hpp>
 
+#include <cstdio>
+#include <fstream>
+
 #include <boost/assign/list_of.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
 using boost::assign::list_of;
 using boost::assign::map_list_of;
 
@@ -25,6 +30,36 @@ float sum_squares_cost_fn(const ParamSet& params)
   return cost;
 }
 
+/**
+ * \brief A cost function that records how many times it has been called (for testing memoisation).
+ */
+struct CountingCostFn
+{
+  boost::shared_ptr<size_t> callCount;
+  boost::shared_ptr<boost::mutex> mutex;
+
+  CountingCostFn()
+  : callCount(new size_t(0)), mutex(new boost::mutex)
+  {}
+
+  float operator()(const ParamSet& params) const
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(*mutex);
+      ++*callCount;
+    }
+    return sum_squares_cost_fn(params);
+  }
+};
+
+void add_test_params(CoordinateDescentParameterOptimiser& optimiser)
+{
+  optimiser.add_param("Foo", NumberSequenceGenerator::generate_stepped<float>(-5.5f, 1.5f, 5.0f))
+           .add_param("Bar", NumberSequenceGenerator::generate_stepped<float>(-1000.0f, 1.0f, 5.0f))
+           .add_param("Boo", list_of<float>(-10.0f)(-5.0f)(-2.0f)(0.0f)(5.0f)(15.0f))
+           .add_param("Dum", list_of<float>(0.0f));
+}
+
 //#################### TESTS ####################
 
 BOOST_AUTO_TEST_SUITE(test_CoordinateDescentParameterOptimiser)
@@ -58,4 +93,76 @@ BOOST_AUTO_TEST_CASE(optimise_for_parameters_test)
   BOOST_CHECK_CLOSE(cost, expectedCost, TOL);
 }
 
+BOOST_AUTO_TEST_CASE(concurrent_evaluation_test)
+{
+  const unsigned int seed = 12345;
+  const size_t epochCount = 10;
+
+  // Optimise sequentially.
+  CountingCostFn sequentialCostFn;
+  CoordinateDescentParameterOptimiser sequentialOptimiser(sequentialCostFn, epochCount, seed);
+  add_test_params(sequentialOptimiser);
+  float sequentialCost;
+  ParamSet sequentialParams = sequentialOptimiser.optimise_for_parameters(&sequentialCost);
+
+  // Optimise concurrently.
+  CountingCostFn concurrentCostFn;
+  CoordinateDescentParameterOptimiser concurrentOptimiser(concurrentCostFn, epochCount, seed);
+  add_test_params(concurrentOptimiser);
+  concurrentOptimiser.set_max_concurrent_evaluations(4);
+  float concurrentCost;
+  ParamSet concurrentParams = concurrentOptimiser.optimise_for_parameters(&concurrentCost);
+
+  // Check that the results are the same, and that each parameter set was only evaluated once in both cases.
+  BOOST_CHECK_EQUAL(ParamSetUtil::param_set_to_string(sequentialParams), ParamSetUtil::param_set_to_string(concurrentParams));
+  BOOST_CHECK_EQUAL(sequentialCost, concurrentCost);
+  BOOST_CHECK_EQUAL(*sequentialCostFn.callCount, *concurrentCostFn.callCount);
+
+  // Check that memoisation avoided at least some re-evaluations (there are far fewer distinct parameter sets near the optimum than evaluations).
+  const size_t paramSetCount = 5 * 1006 * 6;
+  BOOST_CHECK_LT(*sequentialCostFn.callCount, paramSetCount);
+}
+
+BOOST_AUTO_TEST_CASE(cost_cache_file_test)
+{
+  const unsigned int seed = 12345;
+  const size_t epochCount = 10;
+  const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("costcache-%%%%-%%%%.txt")).string();
+
+  // Run the optimisation once, persisting the costs to the cache file.
+  CountingCostFn firstCostFn;
+  float firstCost;
+  ParamSet firstParams;
+  {
+    CoordinateDescentParameterOptimiser optimiser(firstCostFn, epochCount, seed);
+    add_test_params(optimiser);
+    optimiser.set_cost_cache_file(path);
+    firstParams = optimiser.optimise_for_parameters(&firstCost);
+  }
+
+  // Simulate an interruption by appending a partially-written line to the file.
+  {
+    std::ofstream fs(path.c_str(), std::ios::app);
+    fs << "0.1\tFoo=";
+  }
+
+  // Run the optimisation again: every cost should now come from the cache file, and the results should be the same.
+  CountingCostFn secondCostFn;
+  float secondCost;
+  ParamSet secondParams;
+  {
+    CoordinateDescentParameterOptimiser optimiser(secondCostFn, epochCount, seed);
+    add_test_params(optimiser);
+    optimiser.set_cost_cache_file(path);
+    secondParams = optimiser.optimise_for_parameters(&secondCost);
+  }
+
+  std::remove(path.c_str());
+
+  BOOST_CHECK_GT(*firstCostFn.callCount, 0);
+  BOOST_CHECK_EQUAL(*secondCostFn.callCount, 0);
+  BOOST_CHECK_EQUAL(ParamSetUtil::param_set_to_string(firstParams), ParamSetUtil::param_set_to_string(secondParams));
+  BOOST_CHECK_EQUAL(firstCost, secondCost);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
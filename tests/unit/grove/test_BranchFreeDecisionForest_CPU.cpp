@@ -0,0 +1,218 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+namespace bf = boost::filesystem;
+
+#include <grove/features/interface/RGBDPatchFeatureCalculator.h>
+#include <grove/forests/cpu/BranchFreeDecisionForest_CPU.h>
+#include <grove/forests/cpu/DecisionForest_CPU.h>
+using namespace grove;
+
+#include <orx/base/MemoryBlockFactory.h>
+using namespace orx;
+
+#include <tvgutil/misc/SettingsContainer.h>
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+using namespace tvgutil;
+
+//#################### TYPEDEFS ####################
+
+typedef BranchFreeDecisionForest_CPU<RGBDPatchDescriptor,5> BranchFreeForest;
+typedef DecisionForest_CPU<RGBDPatchDescriptor,5> ReferenceForest;
+
+//#################### CONSTANTS ####################
+
+/** The size of the synthetic descriptor images (deliberately not a multiple of the block size used by the branch-free forest). */
+const Vector2i IMAGE_SIZE(37, 23);
+
+/** The maximum depth of the trees in the unbalanced forests. */
+const int MAX_TREE_DEPTH = 12;
+
+/** The number of distinct values used for the features and thresholds (kept small so that features often equal the thresholds). */
+const int VALUE_COUNT = 7;
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Checks that two forests assign the same leaves to the same descriptors.
+ *
+ * \param forest          The forest to check.
+ * \param referenceForest The reference forest.
+ * \param descriptors     The descriptors.
+ */
+void check_leaves_match(const BranchFreeForest& forest, const ReferenceForest& referenceForest, const RGBDPatchDescriptorImage_CPtr& descriptors)
+{
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  ReferenceForest::LeafIndicesImage_Ptr leafIndices = mbf.make_image<ReferenceForest::LeafIndices>();
+  ReferenceForest::LeafIndicesImage_Ptr referenceLeafIndices = mbf.make_image<ReferenceForest::LeafIndices>();
+
+  forest.find_leaves(descriptors, leafIndices);
+  referenceForest.find_leaves(descriptors, referenceLeafIndices);
+
+  BOOST_REQUIRE_EQUAL(leafIndices->noDims, referenceLeafIndices->noDims);
+
+  const ReferenceForest::LeafIndices *leafIndicesPtr = leafIndices->GetData(MEMORYDEVICE_CPU);
+  const ReferenceForest::LeafIndices *referenceLeafIndicesPtr = referenceLeafIndices->GetData(MEMORYDEVICE_CPU);
+  for(int i = 0, size = static_cast<int>(leafIndices->dataSize); i < size; ++i)
+  {
+    for(int treeIdx = 0; treeIdx < ReferenceForest::TREE_COUNT; ++treeIdx)
+    {
+      BOOST_REQUIRE_EQUAL(leafIndicesPtr[i][treeIdx], referenceLeafIndicesPtr[i][treeIdx]);
+    }
+  }
+}
+
+/**
+ * \brief Makes an image of random descriptors, some of whose features are NaN.
+ *
+ * \param rng The random number generator to use.
+ * \return    The image of descriptors.
+ */
+RGBDPatchDescriptorImage_Ptr make_random_descriptors(RandomNumberGenerator& rng)
+{
+  RGBDPatchDescriptorImage_Ptr descriptors = MemoryBlockFactory::instance().make_image<RGBDPatchDescriptor>(IMAGE_SIZE);
+
+  RGBDPatchDescriptor *descriptorsPtr = descriptors->GetData(MEMORYDEVICE_CPU);
+  for(int i = 0, size = static_cast<int>(descriptors->dataSize); i < size; ++i)
+  {
+    for(int j = 0; j < RGBDPatchDescriptor::FEATURE_COUNT; ++j)
+    {
+      const int value = rng.generate_int_from_uniform(0, VALUE_COUNT);
+      descriptorsPtr[i].data[j] = value == VALUE_COUNT ? std::numeric_limits<float>::quiet_NaN() : static_cast<float>(value);
+    }
+  }
+
+  return descriptors;
+}
+
+/**
+ * \brief Writes a forest of random, unbalanced trees to a file, in the format expected by DecisionForest::load_structure_from_file.
+ *
+ * \param rng       The random number generator to use.
+ * \param filename  The name of the file.
+ */
+void write_unbalanced_forest(RandomNumberGenerator& rng, const std::string& filename)
+{
+  typedef ReferenceForest::NodeEntry NodeEntry;
+  std::vector<std::vector<NodeEntry> > trees(ReferenceForest::TREE_COUNT);
+  std::vector<int> leafCounts(ReferenceForest::TREE_COUNT, 0);
+
+  for(int treeIdx = 0; treeIdx < ReferenceForest::TREE_COUNT; ++treeIdx)
+  {
+    std::vector<NodeEntry>& nodes = trees[treeIdx];
+    std::vector<int> nodeDepths(1, 0);
+    nodes.resize(1);
+
+    // Grow the tree in depth-first order. Each branch node reserves a consecutive pair of slots for its children.
+    std::vector<int> stack(1, 0);
+    while(!stack.empty())
+    {
+      const int nodeIdx = stack.back();
+      stack.pop_back();
+
+      NodeEntry node;
+      const int depth = nodeDepths[nodeIdx];
+      if(depth == MAX_TREE_DEPTH || (depth > 0 && rng.generate_real_from_uniform<float>(0.0f, 1.0f) < 0.3f))
+      {
+        node.featureIdx = 0;
+        node.featureThreshold = 0.0f;
+        node.leafIdx = leafCounts[treeIdx]++;
+        node.leftChildIdx = -1;
+      }
+      else
+      {
+        node.featureIdx = rng.generate_int_from_uniform(0, RGBDPatchDescriptor::FEATURE_COUNT - 1);
+        node.featureThreshold = static_cast<float>(rng.generate_int_from_uniform(0, VALUE_COUNT - 1));
+        node.leafIdx = -1;
+        node.leftChildIdx = static_cast<int>(nodes.size());
+
+        nodes.resize(nodes.size() + 2);
+        nodeDepths.push_back(depth + 1);
+        nodeDepths.push_back(depth + 1);
+        stack.push_back(node.leftChildIdx + 1);
+        stack.push_back(node.leftChildIdx);
+      }
+
+      nodes[nodeIdx] = node;
+    }
+  }
+
+  std::ofstream fs(filename.c_str());
+  fs << ReferenceForest::TREE_COUNT << '\n';
+  for(int treeIdx = 0; treeIdx < ReferenceForest::TREE_COUNT; ++treeIdx)
+  {
+    fs << trees[treeIdx].size() << ' ' << leafCounts[treeIdx] << '\n';
+  }
+
+  for(int treeIdx = 0; treeIdx < ReferenceForest::TREE_COUNT; ++treeIdx)
+  {
+    for(size_t nodeIdx = 0, nodeCount = trees[treeIdx].size(); nodeIdx < nodeCount; ++nodeIdx)
+    {
+      const NodeEntry& node = trees[treeIdx][nodeIdx];
+      fs << node.leftChildIdx << ' ' << node.leafIdx << ' ' << node.featureIdx << ' ' << node.featureThreshold << '\n';
+    }
+  }
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_BranchFreeDecisionForest_CPU)
+
+BOOST_AUTO_TEST_CASE(balanced_forest_test)
+{
+  MemoryBlockFactory::instance().set_device_type(ORUtils::DEVICE_CPU);
+
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  settings->add_value("DecisionForest.treeDepth", "8");
+
+  BranchFreeForest forest(settings);
+  ReferenceForest referenceForest(settings);
+
+  // The randomly-generated thresholds are drawn from a wide Gaussian, so use correspondingly spread-out features.
+  RandomNumberGenerator rng(12345);
+  RGBDPatchDescriptorImage_Ptr descriptors = MemoryBlockFactory::instance().make_image<RGBDPatchDescriptor>(IMAGE_SIZE);
+  RGBDPatchDescriptor *descriptorsPtr = descriptors->GetData(MEMORYDEVICE_CPU);
+  for(int i = 0, size = static_cast<int>(descriptors->dataSize); i < size; ++i)
+  {
+    for(int j = 0; j < RGBDPatchDescriptor::FEATURE_COUNT; ++j)
+    {
+      descriptorsPtr[i].data[j] = rng.generate_from_gaussian<float>(0.0f, 500.0f);
+    }
+  }
+
+  check_leaves_match(forest, referenceForest, descriptors);
+}
+
+BOOST_AUTO_TEST_CASE(unbalanced_forest_test)
+{
+  MemoryBlockFactory::instance().set_device_type(ORUtils::DEVICE_CPU);
+
+  RandomNumberGenerator rng(42);
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("grove-%%%%-%%%%.rf")).string();
+  write_unbalanced_forest(rng, filename);
+
+  BranchFreeForest forest(filename);
+  ReferenceForest referenceForest(filename);
+
+  // Also check that the compact layout is rebuilt when a new structure is loaded into an existing forest.
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  settings->add_value("DecisionForest.treeDepth", "3");
+  BranchFreeForest reloadedForest(settings);
+  reloadedForest.load_structure_from_file(filename);
+
+  bf::remove(filename);
+
+  for(int i = 0; i < 5; ++i)
+  {
+    RGBDPatchDescriptorImage_Ptr descriptors = make_random_descriptors(rng);
+    check_leaves_match(forest, referenceForest, descriptors);
+    check_leaves_match(reloadedForest, referenceForest, descriptors);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
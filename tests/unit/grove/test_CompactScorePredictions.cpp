@@ -0,0 +1,110 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/filesystem.hpp>
+namespace bf = boost::filesystem;
+
+#include <grove/scoreforests/CompactScorePredictions.h>
+using namespace grove;
+
+#include <orx/base/MemoryBlockFactory.h>
+#include <orx/persistence/BinaryModelReader.h>
+#include <orx/persistence/BinaryModelWriter.h>
+using namespace orx;
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Makes a block of SCoRe predictions whose sizes range from empty to full.
+ *
+ * \param predictionCount The number of predictions to make.
+ * \return                The block of SCoRe predictions.
+ */
+ScorePredictionsMemoryBlock_Ptr make_predictions(int predictionCount)
+{
+  ScorePredictionsMemoryBlock_Ptr predictions = MemoryBlockFactory::instance().make_block<ScorePrediction>(predictionCount, "test");
+  predictions->Clear();
+
+  ScorePrediction *predictionsPtr = predictions->GetData(MEMORYDEVICE_CPU);
+  for(int i = 0; i < predictionCount; ++i)
+  {
+    ScorePrediction& prediction = predictionsPtr[i];
+    prediction.size = i % (ScorePrediction::Capacity + 1);
+    for(int j = 0; j < prediction.size; ++j)
+    {
+      Keypoint3DColourCluster& mode = prediction.elts[j];
+      mode.colour = Vector3u(static_cast<unsigned char>(i % 256), static_cast<unsigned char>(j), 7);
+      mode.determinant = i * 0.5f + j;
+      mode.nbInliers = i + j;
+      mode.position = Vector3f(i * 1.0f, j * 2.0f, -3.0f);
+      mode.positionInvCovariance.setIdentity();
+      mode.positionInvCovariance.m[4] = static_cast<float>(j);
+    }
+  }
+
+  return predictions;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_CompactScorePredictions)
+
+BOOST_AUTO_TEST_CASE(round_trip_test)
+{
+  MemoryBlockFactory::instance().set_device_type(ORUtils::DEVICE_CPU);
+
+  const int predictionCount = 3 * (ScorePrediction::Capacity + 1) + 5;
+  ScorePredictionsMemoryBlock_Ptr predictions = make_predictions(predictionCount);
+
+  // Compact the predictions, and check that only the modes that are actually in use are stored.
+  CompactScorePredictions compactPredictions(*predictions);
+  uint32_t expectedModeCount = 0;
+  for(int i = 0; i < predictionCount; ++i) expectedModeCount += predictions->GetData(MEMORYDEVICE_CPU)[i].size;
+  BOOST_CHECK_EQUAL(compactPredictions.get_prediction_count(), static_cast<uint32_t>(predictionCount));
+  BOOST_CHECK_EQUAL(compactPredictions.get_mode_count(), expectedModeCount);
+
+  // Save them to a binary model file and load them back in again.
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("grove-%%%%-%%%%.model")).string();
+  {
+    BinaryModelWriter writer(filename);
+    compactPredictions.save_to_model(writer);
+    writer.close();
+  }
+
+  CompactScorePredictions loadedPredictions;
+  {
+    BinaryModelReader reader(filename);
+    loadedPredictions.load_from_model(reader);
+  }
+  bf::remove(filename);
+
+  BOOST_CHECK_EQUAL(loadedPredictions.get_prediction_count(), static_cast<uint32_t>(predictionCount));
+  BOOST_CHECK_EQUAL(loadedPredictions.get_mode_count(), expectedModeCount);
+
+  // Expand them into a fixed-capacity block again, and check that the modes in use are exactly the same as in the original.
+  ScorePredictionsMemoryBlock_Ptr expandedPredictions = MemoryBlockFactory::instance().make_block<ScorePrediction>(predictionCount, "test");
+  loadedPredictions.expand_into(*expandedPredictions);
+
+  const ScorePrediction *originalPtr = predictions->GetData(MEMORYDEVICE_CPU);
+  const ScorePrediction *expandedPtr = expandedPredictions->GetData(MEMORYDEVICE_CPU);
+  for(int i = 0; i < predictionCount; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(expandedPtr[i].size, originalPtr[i].size);
+    for(int j = 0; j < originalPtr[i].size; ++j)
+    {
+      const Keypoint3DColourCluster& a = originalPtr[i].elts[j];
+      const Keypoint3DColourCluster& b = expandedPtr[i].elts[j];
+      BOOST_CHECK(a.colour == b.colour);
+      BOOST_CHECK_EQUAL(a.determinant, b.determinant);
+      BOOST_CHECK_EQUAL(a.nbInliers, b.nbInliers);
+      BOOST_CHECK(a.position == b.position);
+      for(int k = 0; k < 9; ++k) BOOST_CHECK_EQUAL(a.positionInvCovariance.m[k], b.positionInvCovariance.m[k]);
+    }
+  }
+
+  // Expanding into a block of the wrong size should fail.
+  ScorePredictionsMemoryBlock_Ptr wrongSizePredictions = MemoryBlockFactory::instance().make_block<ScorePrediction>(predictionCount - 1, "test");
+  BOOST_CHECK_THROW(loadedPredictions.expand_into(*wrongSizePredictions), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
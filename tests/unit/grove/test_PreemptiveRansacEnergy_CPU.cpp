@@ -0,0 +1,245 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+#include <ORUtils/SE3Pose.h>
+
+#include <grove/ransac/cpu/PreemptiveRansacEnergy_CPU.h>
+#include <grove/ransac/shared/PreemptiveRansac_Shared.h>
+using namespace grove;
+using namespace grove::ransac_detail;
+
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+using namespace tvgutil;
+
+//#################### HELPER TYPES ####################
+
+/**
+ * \brief An instance of this struct holds a set of packed energy inputs, in the same format as used by PreemptiveRansac_CPU.
+ */
+struct PackedEnergyInputs
+{
+  std::vector<float> inlierLogModeCounts;
+  std::vector<uint32_t> inlierModeOffsets;
+  std::vector<float> inlierPoints;
+  std::vector<float> packedModes;
+  std::vector<float> packedPoses;
+  size_t poseStride;
+};
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Makes a set of random packed energy inputs.
+ *
+ * \param rng             The random number generator to use.
+ * \param candidateCount  The number of pose candidates (must be a multiple of CANDIDATE_BATCH_SIZE).
+ * \param inlierCount     The number of sampled inliers.
+ * \param maxModeCount    The maximum number of modes per inlier.
+ * \return                The packed energy inputs.
+ */
+PackedEnergyInputs make_random_inputs(RandomNumberGenerator& rng, int candidateCount, int inlierCount, int maxModeCount)
+{
+  PackedEnergyInputs inputs;
+
+  inputs.poseStride = candidateCount;
+  inputs.packedPoses.resize(PACKED_POSE_ROWS * candidateCount);
+  for(size_t i = 0, size = inputs.packedPoses.size(); i < size; ++i)
+  {
+    inputs.packedPoses[i] = rng.generate_real_from_uniform<float>(-1.0f, 1.0f);
+  }
+
+  inputs.inlierModeOffsets.push_back(0);
+  for(int i = 0; i < inlierCount; ++i)
+  {
+    const int modeCount = rng.generate_int_from_uniform(1, maxModeCount);
+    inputs.inlierModeOffsets.push_back(inputs.inlierModeOffsets.back() + modeCount);
+    inputs.inlierLogModeCounts.push_back(logf(static_cast<float>(modeCount)));
+
+    for(int k = 0; k < 3; ++k)
+    {
+      inputs.inlierPoints.push_back(rng.generate_real_from_uniform<float>(-2.0f, 2.0f));
+    }
+
+    for(int j = 0; j < modeCount; ++j)
+    {
+      // The position.
+      for(int k = 0; k < 3; ++k) inputs.packedModes.push_back(rng.generate_real_from_uniform<float>(-2.0f, 2.0f));
+
+      // The inverse covariance matrix (a random symmetric positive definite matrix, stored column by column).
+      const float a = rng.generate_real_from_uniform<float>(0.5f, 4.0f);
+      const float b = rng.generate_real_from_uniform<float>(0.5f, 4.0f);
+      const float c = rng.generate_real_from_uniform<float>(0.5f, 4.0f);
+      const float d = rng.generate_real_from_uniform<float>(-0.25f, 0.25f);
+      const float invCov[9] = { a, d, 0.0f, d, b, d, 0.0f, d, c };
+      for(int k = 0; k < 9; ++k) inputs.packedModes.push_back(invCov[k]);
+
+      // The log weight and the log inlier count.
+      inputs.packedModes.push_back(rng.generate_real_from_uniform<float>(-3.0f, 0.0f));
+      inputs.packedModes.push_back(logf(static_cast<float>(rng.generate_int_from_uniform(1, 100))));
+    }
+  }
+
+  return inputs;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_PreemptiveRansacEnergy_CPU)
+
+BOOST_AUTO_TEST_CASE(clamping_test)
+{
+  RandomNumberGenerator rng(12345);
+  const int candidateCount = CANDIDATE_BATCH_SIZE, inlierCount = 10;
+  PackedEnergyInputs inputs = make_random_inputs(rng, candidateCount, inlierCount, 3);
+
+  // Move all of the modes a long way from the inliers, so that every inlier's energy is clamped to the minimum.
+  for(size_t i = 0, size = inputs.packedModes.size(); i < size; i += PACKED_MODE_SIZE)
+  {
+    inputs.packedModes[i] += 1000.0f;
+  }
+
+  for(int i = 0; i < candidateCount; ++i)
+  {
+    const float logEnergySum = compute_log_energy_sum(
+      &inputs.packedPoses[0], inputs.poseStride, i, &inputs.inlierPoints[0], &inputs.inlierLogModeCounts[0],
+      &inputs.inlierModeOffsets[0], &inputs.packedModes[0], inlierCount
+    );
+    BOOST_CHECK_CLOSE(logEnergySum, inlierCount * LOG_MIN_ENERGY, 1e-4f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(matches_original_energy_test)
+{
+  RandomNumberGenerator rng(1234);
+
+  for(int trial = 0; trial < 20; ++trial)
+  {
+    const int candidateCount = rng.generate_int_from_uniform(1, 20);
+    const int inlierCount = rng.generate_int_from_uniform(1, 100);
+
+    // Make some random inliers, together with predictions whose modes are scattered around the positions of the inliers
+    // in world space under a reference pose, so that the inliers agree well with some pose candidates and badly with others.
+    const Matrix4f referencePose = ORUtils::SE3Pose(
+      rng.generate_real_from_uniform<float>(-1.0f, 1.0f), rng.generate_real_from_uniform<float>(-1.0f, 1.0f), rng.generate_real_from_uniform<float>(-1.0f, 1.0f),
+      rng.generate_real_from_uniform<float>(-1.0f, 1.0f), rng.generate_real_from_uniform<float>(-1.0f, 1.0f), rng.generate_real_from_uniform<float>(-1.0f, 1.0f)
+    ).GetM();
+
+    std::vector<Keypoint3DColour> keypoints(inlierCount);
+    std::vector<ScorePrediction> predictions(inlierCount);
+    std::vector<int> inlierRasterIndices(inlierCount);
+
+    PackedEnergyInputs inputs;
+    inputs.inlierModeOffsets.push_back(0);
+
+    for(int i = 0; i < inlierCount; ++i)
+    {
+      Keypoint3DColour& keypoint = keypoints[i];
+      keypoint.position = Vector3f(
+        rng.generate_real_from_uniform<float>(-2.0f, 2.0f), rng.generate_real_from_uniform<float>(-2.0f, 2.0f), rng.generate_real_from_uniform<float>(0.5f, 4.0f)
+      );
+      keypoint.valid = true;
+
+      const Vector3f worldPosition = referencePose * keypoint.position;
+
+      ScorePrediction& prediction = predictions[i];
+      prediction.size = rng.generate_int_from_uniform(1, 10);
+      for(int j = 0; j < prediction.size; ++j)
+      {
+        Keypoint3DColourCluster& mode = prediction.elts[j];
+        mode.nbInliers = rng.generate_int_from_uniform(1, 100);
+
+        const float noise = rng.generate_real_from_uniform<float>(0.0f, 0.5f);
+        mode.position = worldPosition + Vector3f(
+          rng.generate_from_gaussian<float>(0.0f, noise), rng.generate_from_gaussian<float>(0.0f, noise), rng.generate_from_gaussian<float>(0.0f, noise)
+        );
+
+        // A random symmetric positive definite inverse covariance matrix, and the determinant of the corresponding covariance matrix.
+        const float a = rng.generate_real_from_uniform<float>(1.0f, 100.0f);
+        const float b = rng.generate_real_from_uniform<float>(1.0f, 100.0f);
+        const float c = rng.generate_real_from_uniform<float>(1.0f, 100.0f);
+        const float d = rng.generate_real_from_uniform<float>(-0.5f, 0.5f);
+        mode.positionInvCovariance = Matrix3f(a, d, 0.0f, d, b, 0.0f, 0.0f, 0.0f, c);
+        mode.determinant = 1.0f / ((a * b - d * d) * c);
+      }
+
+      inlierRasterIndices[i] = i;
+
+      inputs.inlierModeOffsets.push_back(inputs.inlierModeOffsets.back() + prediction.size);
+      inputs.inlierLogModeCounts.push_back(logf(static_cast<float>(prediction.size)));
+      inputs.inlierPoints.push_back(keypoint.position.x);
+      inputs.inlierPoints.push_back(keypoint.position.y);
+      inputs.inlierPoints.push_back(keypoint.position.z);
+
+      inputs.packedModes.resize(inputs.inlierModeOffsets.back() * PACKED_MODE_SIZE);
+      for(int j = 0; j < prediction.size; ++j)
+      {
+        pack_mode(prediction.elts[j], &inputs.packedModes[(inputs.inlierModeOffsets[i] + j) * PACKED_MODE_SIZE]);
+      }
+    }
+
+    // Make some pose candidates by perturbing the reference pose by varying amounts, and check that the energies computed
+    // from the packed inputs in the log domain match the ones computed by the original implementation.
+    inputs.poseStride = candidateCount;
+    inputs.packedPoses.resize(PACKED_POSE_ROWS * candidateCount);
+
+    for(int i = 0; i < candidateCount; ++i)
+    {
+      const float scale = i == 0 ? 0.0f : rng.generate_real_from_uniform<float>(0.0f, 0.2f);
+      const Matrix4f perturbation = ORUtils::SE3Pose(
+        rng.generate_from_gaussian<float>(0.0f, scale), rng.generate_from_gaussian<float>(0.0f, scale), rng.generate_from_gaussian<float>(0.0f, scale),
+        rng.generate_from_gaussian<float>(0.0f, scale), rng.generate_from_gaussian<float>(0.0f, scale), rng.generate_from_gaussian<float>(0.0f, scale)
+      ).GetM();
+      const Matrix4f candidatePose = perturbation * referencePose;
+
+      pack_pose(candidatePose, &inputs.packedPoses[0], inputs.poseStride, i);
+
+      const float expected = compute_energy_sum_for_inliers(candidatePose, &keypoints[0], &predictions[0], &inlierRasterIndices[0], inlierCount);
+      const float logEnergySum = compute_log_energy_sum(
+        &inputs.packedPoses[0], inputs.poseStride, i, &inputs.inlierPoints[0], &inputs.inlierLogModeCounts[0],
+        &inputs.inlierModeOffsets[0], &inputs.packedModes[0], inlierCount
+      );
+
+      // The original energies are negative log10s, whereas the log energy sums are natural logarithms.
+      BOOST_CHECK_SMALL(-logEnergySum / logf(10.0f) - expected, 1e-3f * std::max(1.0f, fabsf(expected)));
+    }
+  }
+}
+
+#ifdef WITH_AVX2
+BOOST_AUTO_TEST_CASE(avx2_matches_scalar_test)
+{
+  RandomNumberGenerator rng(42);
+
+  for(int trial = 0; trial < 20; ++trial)
+  {
+    const int candidateCount = CANDIDATE_BATCH_SIZE * rng.generate_int_from_uniform(1, 4);
+    const int inlierCount = rng.generate_int_from_uniform(1, 100);
+    PackedEnergyInputs inputs = make_random_inputs(rng, candidateCount, inlierCount, 10);
+
+    for(int firstCandidateIdx = 0; firstCandidateIdx < candidateCount; firstCandidateIdx += CANDIDATE_BATCH_SIZE)
+    {
+      float logEnergySums[CANDIDATE_BATCH_SIZE];
+      compute_log_energy_sums_avx2(
+        &inputs.packedPoses[0], inputs.poseStride, firstCandidateIdx, &inputs.inlierPoints[0], &inputs.inlierLogModeCounts[0],
+        &inputs.inlierModeOffsets[0], &inputs.packedModes[0], inlierCount, logEnergySums
+      );
+
+      for(int i = 0; i < CANDIDATE_BATCH_SIZE; ++i)
+      {
+        const float expected = compute_log_energy_sum(
+          &inputs.packedPoses[0], inputs.poseStride, firstCandidateIdx + i, &inputs.inlierPoints[0], &inputs.inlierLogModeCounts[0],
+          &inputs.inlierModeOffsets[0], &inputs.packedModes[0], inlierCount
+        );
+
+        // The AVX2 kernel uses fused multiply-adds, so the results can differ slightly from the scalar ones.
+        BOOST_CHECK_SMALL(logEnergySums[i] - expected, 1e-4f * std::max(1.0f, fabsf(expected)));
+      }
+    }
+  }
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,198 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <grove/relocalisation/ScoreRelocaliserFactory.h>
+using namespace grove;
+
+#include <orx/base/MemoryBlockFactory.h>
+using namespace orx;
+
+#include <tvgutil/misc/SettingsContainer.h>
+using namespace tvgutil;
+
+//#################### CONSTANTS ####################
+
+/** The size of the synthetic RGB-D images. */
+const Vector2i IMAGE_SIZE(160, 120);
+
+/** The number of calls to relocalise made by each thread in the concurrency tests. */
+const int CALLS_PER_THREAD = 3;
+
+/** The number of threads used in the concurrency tests. */
+const int THREAD_COUNT = 4;
+
+//#################### HELPER TYPES ####################
+
+/**
+ * \brief An RGB-D frame of a synthetic scene.
+ */
+struct Frame
+{
+  ORUChar4Image_Ptr colourImage;
+  ORFloatImage_Ptr depthImage;
+  Vector4f depthIntrinsics;
+};
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Makes an RGB-D frame of a synthetic (textured, non-planar) scene, as seen from the origin.
+ *
+ * \return  The frame.
+ */
+Frame make_frame()
+{
+  Frame frame;
+  frame.colourImage.reset(new ORUChar4Image(IMAGE_SIZE, true, false));
+  frame.depthImage.reset(new ORFloatImage(IMAGE_SIZE, true, false));
+  frame.depthIntrinsics = Vector4f(160.0f, 160.0f, IMAGE_SIZE.x / 2.0f, IMAGE_SIZE.y / 2.0f);
+
+  Vector4u *colours = frame.colourImage->GetData(MEMORYDEVICE_CPU);
+  float *depths = frame.depthImage->GetData(MEMORYDEVICE_CPU);
+  for(int y = 0; y < IMAGE_SIZE.y; ++y)
+  {
+    for(int x = 0; x < IMAGE_SIZE.x; ++x)
+    {
+      const int i = y * IMAGE_SIZE.x + x;
+      colours[i] = Vector4u(
+        static_cast<unsigned char>((x * 7) % 256), static_cast<unsigned char>((y * 5) % 256),
+        static_cast<unsigned char>(((x / 8 + y / 8) % 2) * 255), 255
+      );
+      depths[i] = 1.5f + 0.2f * sinf(x * 0.1f) * cosf(y * 0.1f);
+    }
+  }
+
+  return frame;
+}
+
+/**
+ * \brief Makes a CPU-based SCoRe relocaliser of the specified type.
+ *
+ * \param relocaliserType The type of relocaliser to make.
+ * \return                The relocaliser.
+ */
+ScoreRelocaliser_Ptr make_relocaliser(const std::string& relocaliserType)
+{
+  MemoryBlockFactory::instance().set_device_type(ORUtils::DEVICE_CPU);
+
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  settings->add_value("DecisionForest.treeDepth", "6");
+  settings->add_value("ScoreRelocaliser.randomlyGenerateForest", "true");
+  settings->add_value("ScoreRelocaliser.reservoirCapacity", "64");
+  settings->add_value("ScoreRelocaliser.PreemptiveRansac.maxPoseCandidates", "256");
+  return ScoreRelocaliserFactory::make_score_relocaliser(relocaliserType, "ScoreRelocaliser.", settings, ORUtils::DEVICE_CPU);
+}
+
+/**
+ * \brief Repeatedly relocalises the specified frame, recording the results of each call.
+ *
+ * \param relocaliser The relocaliser to use.
+ * \param frame       The frame to relocalise.
+ * \param results     A vector into which to write the results of each call.
+ * \param failed      A flag to set if any of the calls throws.
+ */
+void relocalise_repeatedly(const ScoreRelocaliser_CPtr& relocaliser, const Frame& frame, std::vector<std::vector<Relocaliser::Result> >& results, bool& failed)
+{
+  try
+  {
+    for(int i = 0; i < CALLS_PER_THREAD; ++i)
+    {
+      results.push_back(relocaliser->relocalise(frame.colourImage.get(), frame.depthImage.get(), frame.depthIntrinsics));
+    }
+  }
+  catch(...)
+  {
+    failed = true;
+  }
+}
+
+/**
+ * \brief Relocalises the specified frame from several threads at once.
+ *
+ * \param relocaliser The relocaliser to use.
+ * \param frame       The frame to relocalise.
+ * \return            The results of all of the calls.
+ */
+std::vector<std::vector<Relocaliser::Result> > relocalise_concurrently(const ScoreRelocaliser_CPtr& relocaliser, const Frame& frame)
+{
+  std::vector<std::vector<std::vector<Relocaliser::Result> > > threadResults(THREAD_COUNT);
+  bool failed[THREAD_COUNT] = { false };
+
+  boost::thread_group threads;
+  for(int i = 0; i < THREAD_COUNT; ++i)
+  {
+    threads.create_thread(boost::bind(&relocalise_repeatedly, relocaliser, boost::cref(frame), boost::ref(threadResults[i]), boost::ref(failed[i])));
+  }
+  threads.join_all();
+
+  std::vector<std::vector<Relocaliser::Result> > results;
+  for(int i = 0; i < THREAD_COUNT; ++i)
+  {
+    BOOST_REQUIRE(!failed[i]);
+    BOOST_REQUIRE_EQUAL(threadResults[i].size(), static_cast<size_t>(CALLS_PER_THREAD));
+    results.insert(results.end(), threadResults[i].begin(), threadResults[i].end());
+  }
+
+  return results;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_ScoreRelocaliser)
+
+BOOST_AUTO_TEST_CASE(concurrent_relocalise_forest_test)
+{
+  ScoreRelocaliser_Ptr relocaliser = make_relocaliser("forest");
+  Frame frame = make_frame();
+
+  // Train the relocaliser on the frame (seen from the origin), and make sure all of the clusters are up to date.
+  ORUtils::SE3Pose identity;
+  for(int i = 0; i < 5; ++i)
+  {
+    relocaliser->train(frame.colourImage.get(), frame.depthImage.get(), frame.depthIntrinsics, identity);
+  }
+  relocaliser->update_all_clusters();
+
+  // Relocalise the frame from several threads at once. Each call should succeed and produce a pose,
+  // and afterwards the relocaliser should still expose the images produced by the most recent call.
+  std::vector<std::vector<Relocaliser::Result> > results = relocalise_concurrently(relocaliser, frame);
+  for(size_t i = 0, size = results.size(); i < size; ++i)
+  {
+    BOOST_CHECK(!results[i].empty());
+  }
+
+  BOOST_CHECK(relocaliser->get_keypoints_image());
+  BOOST_CHECK(relocaliser->get_predictions_image());
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_relocalise_gt_test)
+{
+  ScoreRelocaliser_Ptr relocaliser = make_relocaliser("gt");
+  Frame frame = make_frame();
+
+  // Give the relocaliser a ground truth pose (at the origin) for every call we're going to make.
+  relocaliser->set_ground_truth_trajectory(std::vector<ORUtils::SE3Pose>(THREAD_COUNT * CALLS_PER_THREAD, ORUtils::SE3Pose()));
+
+  // Since the SCoRe predictions are exact, every concurrent call should recover the pose at the origin.
+  std::vector<std::vector<Relocaliser::Result> > results = relocalise_concurrently(relocaliser, frame);
+  for(size_t i = 0, size = results.size(); i < size; ++i)
+  {
+    BOOST_REQUIRE(!results[i].empty());
+
+    const Matrix4f m = results[i][0].pose.GetM();
+    for(int row = 0; row < 4; ++row)
+    {
+      for(int col = 0; col < 4; ++col)
+      {
+        BOOST_CHECK_SMALL(m(col,row) - (row == col ? 1.0f : 0.0f), 1e-2f);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
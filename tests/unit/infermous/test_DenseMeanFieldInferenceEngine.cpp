@@ -0,0 +1,146 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <infermous/engines/DenseMeanFieldInferenceEngine.h>
+#include <infermous/engines/MeanFieldInferenceEngine.h>
+using namespace infermous;
+
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+using namespace tvgutil;
+
+typedef int Label;
+
+//#################### HELPERS ####################
+
+/**
+ * \brief A pairwise potential calculator that penalises neighbouring pixels with different labels (more so for labels that are further apart).
+ */
+struct PPC : PairwisePotentialCalculator<Label>
+{
+  float calculate_potential(const Label& l1, const Label& l2) const
+  {
+    return 0.1f * abs(l1 - l2);
+  }
+};
+
+/**
+ * \brief Makes a grid of random unaries.
+ *
+ * Some of the pixels deliberately omit one of the labels, to check that missing labels are handled in the same way by both engines.
+ *
+ * \param width   The width of the grid.
+ * \param height  The height of the grid.
+ * \return        The grid of unaries.
+ */
+ProbabilitiesGrid_Ptr<Label> make_unaries(int width, int height)
+{
+  const int labelCount = 4;
+  RandomNumberGenerator rng(1234);
+  ProbabilitiesGrid_Ptr<Label> unaries(new ProbabilitiesGrid<Label>(height, width));
+  for(int y = 0; y < height; ++y)
+  {
+    for(int x = 0; x < width; ++x)
+    {
+      std::map<Label,float>& psi = (*unaries)(y, x);
+      float total = 0.0f;
+      for(Label L = 0; L < labelCount; ++L)
+      {
+        if(L == 3 && (x + y) % 3 == 0) continue;
+        psi[L] = rng.generate_real_from_uniform<float>(0.05f, 1.0f);
+        total += psi[L];
+      }
+
+      for(std::map<Label,float>::iterator it = psi.begin(), iend = psi.end(); it != iend; ++it)
+      {
+        it->second /= total;
+      }
+    }
+  }
+  return unaries;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_DenseMeanFieldInferenceEngine)
+
+BOOST_AUTO_TEST_CASE(update_crf_test)
+{
+  const int width = 13, height = 9;
+  ProbabilitiesGrid_Ptr<Label> unaries = make_unaries(width, height);
+  PairwisePotentialCalculator_CPtr<Label> ppc(new PPC);
+  std::vector<Eigen::Vector2i> neighbourOffsets = CRFUtil::make_circular_neighbour_offsets(2);
+
+  // Run both engines on separate CRFs with the same unaries.
+  CRF2D_Ptr<Label> crf(new CRF2D<Label>(ProbabilitiesGrid_Ptr<Label>(new ProbabilitiesGrid<Label>(*unaries)), ppc));
+  MeanFieldInferenceEngine<Label> engine(crf, neighbourOffsets);
+  engine.update_crf(3);
+
+  CRF2D_Ptr<Label> denseCRF(new CRF2D<Label>(ProbabilitiesGrid_Ptr<Label>(new ProbabilitiesGrid<Label>(*unaries)), ppc));
+  DenseMeanFieldInferenceEngine<Label> denseEngine(denseCRF, neighbourOffsets);
+  denseEngine.update_crf(1);
+  denseEngine.update_crf(2);
+
+  // Check that the marginals they produce are the same.
+  for(int y = 0; y < height; ++y)
+  {
+    for(int x = 0; x < width; ++x)
+    {
+      const Eigen::Vector2i loc(x, y);
+      const std::map<Label,float>& expected = crf->get_marginals_at(loc);
+      const std::map<Label,float>& actual = denseCRF->get_marginals_at(loc);
+      BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+      for(std::map<Label,float>::const_iterator it = expected.begin(), iend = expected.end(); it != iend; ++it)
+      {
+        BOOST_CHECK_CLOSE(actual.find(it->first)->second, it->second, 1e-3f);
+      }
+
+      // Check that the dense marginals agree with the ones written back into the CRF.
+      const std::vector<Label>& labels = denseEngine.get_labels();
+      for(size_t k = 0; k < labels.size(); ++k)
+      {
+        std::map<Label,float>::const_iterator jt = actual.find(labels[k]);
+        float dense = denseEngine.get_marginals()[(y * width + x) * labels.size() + k];
+        BOOST_CHECK_EQUAL(dense, jt != actual.end() ? jt->second : 0.0f);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(zero_unaries_test)
+{
+  const int width = 7, height = 5;
+  ProbabilitiesGrid_Ptr<Label> unaries = make_unaries(width, height);
+
+  // Give one pixel unary probabilities that are all zero, so that none of its labels has a finite potential.
+  const Eigen::Vector2i zeroLoc(3, 2);
+  std::map<Label,float>& psi = (*unaries)(zeroLoc.y(), zeroLoc.x());
+  for(std::map<Label,float>::iterator it = psi.begin(), iend = psi.end(); it != iend; ++it)
+  {
+    it->second = 0.0f;
+  }
+
+  PairwisePotentialCalculator_CPtr<Label> ppc(new PPC);
+  CRF2D_Ptr<Label> crf(new CRF2D<Label>(unaries, ppc));
+  DenseMeanFieldInferenceEngine<Label> engine(crf, CRFUtil::make_circular_neighbour_offsets(2));
+  engine.update_crf(3);
+
+  // Check that the pixel ends up with a uniform distribution over its labels, and that every pixel's marginals are a valid distribution.
+  for(int y = 0; y < height; ++y)
+  {
+    for(int x = 0; x < width; ++x)
+    {
+      const Eigen::Vector2i loc(x, y);
+      const std::map<Label,float>& marginals = crf->get_marginals_at(loc);
+      float total = 0.0f;
+      for(std::map<Label,float>::const_iterator it = marginals.begin(), iend = marginals.end(); it != iend; ++it)
+      {
+        BOOST_REQUIRE(it->second >= 0.0f && it->second <= 1.0f);
+        if(loc == zeroLoc) BOOST_CHECK_CLOSE(it->second, 1.0f / marginals.size(), 1e-3f);
+        total += it->second;
+      }
+      BOOST_CHECK_CLOSE(total, 1.0f, 1e-3f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,171 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+namespace bf = boost::filesystem;
+
+#include <itmx/persistence/PackedRGBDSequenceReader.h>
+#include <itmx/persistence/PackedRGBDSequenceRecorder.h>
+using namespace itmx;
+
+//#################### HELPER FUNCTIONS ####################
+
+ORShortImage_Ptr make_depth_image(const Vector2i& size, int frameIndex)
+{
+  ORShortImage_Ptr image(new ORShortImage(size, true, false));
+  short *depths = image->GetData(MEMORYDEVICE_CPU);
+  for(int i = 0, pixelCount = size.x * size.y; i < pixelCount; ++i)
+  {
+    depths[i] = i % 7 == 0 ? 0 : static_cast<short>(1000 + 3 * frameIndex + i % 50);
+  }
+  return image;
+}
+
+ORUtils::SE3Pose make_pose(int frameIndex)
+{
+  ORUtils::SE3Pose pose;
+  pose.SetFrom(0.5f * frameIndex, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+  return pose;
+}
+
+ORUChar4Image_Ptr make_rgb_image(const Vector2i& size, int frameIndex)
+{
+  ORUChar4Image_Ptr image(new ORUChar4Image(size, true, false));
+  Vector4u *pixels = image->GetData(MEMORYDEVICE_CPU);
+  for(int i = 0, pixelCount = size.x * size.y; i < pixelCount; ++i)
+  {
+    pixels[i] = Vector4u(static_cast<unsigned char>(i + frameIndex), static_cast<unsigned char>(frameIndex), static_cast<unsigned char>(3 * i), 255);
+  }
+  return image;
+}
+
+void check_sequence(const std::string& filename, size_t expectedFrameCount, const Vector2i& rgbImageSize, const Vector2i& depthImageSize)
+{
+  PackedRGBDSequenceReader reader(filename);
+  BOOST_REQUIRE_EQUAL(reader.get_frame_count(), expectedFrameCount);
+  BOOST_CHECK(reader.get_rgb_image_size() == rgbImageSize);
+  BOOST_CHECK(reader.get_depth_image_size() == depthImageSize);
+
+  RGBDFrameMessage msg(rgbImageSize, depthImageSize);
+  ORUChar4Image rgbImage(rgbImageSize, true, false);
+  ORShortImage depthImage(depthImageSize, true, false);
+
+  // Read the frames in reverse order, to check that they can be read independently of each other.
+  for(int i = static_cast<int>(expectedFrameCount) - 1; i >= 0; --i)
+  {
+    reader.read_frame(i, msg);
+    msg.extract_rgb_image(&rgbImage);
+    msg.extract_depth_image(&depthImage);
+
+    BOOST_CHECK_EQUAL(msg.extract_frame_index(), i);
+    BOOST_CHECK_CLOSE(msg.extract_pose().GetM().m[12], 0.5f * i, 1e-4f);
+    BOOST_CHECK_CLOSE(reader.get_pose(i).GetM().m[12], 0.5f * i, 1e-4f);
+
+    ORUChar4Image_Ptr expectedRgbImage = make_rgb_image(rgbImageSize, i);
+    ORShortImage_Ptr expectedDepthImage = make_depth_image(depthImageSize, i);
+    const unsigned char *er = reinterpret_cast<const unsigned char*>(expectedRgbImage->GetData(MEMORYDEVICE_CPU));
+    const unsigned char *ar = reinterpret_cast<const unsigned char*>(rgbImage.GetData(MEMORYDEVICE_CPU));
+    const short *ed = expectedDepthImage->GetData(MEMORYDEVICE_CPU);
+    const short *ad = depthImage.GetData(MEMORYDEVICE_CPU);
+    BOOST_CHECK_EQUAL_COLLECTIONS(er, er + 4 * expectedRgbImage->dataSize, ar, ar + 4 * rgbImage.dataSize);
+    BOOST_CHECK_EQUAL_COLLECTIONS(ed, ed + expectedDepthImage->dataSize, ad, ad + depthImage.dataSize);
+  }
+
+  BOOST_CHECK_THROW(reader.read_frame(expectedFrameCount, msg), std::out_of_range);
+}
+
+ITMLib::ITMRGBDCalib make_calib()
+{
+  ITMLib::ITMRGBDCalib calib;
+  calib.intrinsics_d.SetFrom(0, 0, 500.0f, 500.0f, 16.0f, 12.0f);
+  calib.intrinsics_rgb.SetFrom(0, 0, 520.0f, 520.0f, 32.0f, 24.0f);
+  return calib;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_PackedRGBDSequence)
+
+BOOST_AUTO_TEST_CASE(recorder_test)
+{
+  const Vector2i rgbImageSize(64,48), depthImageSize(32,24);
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("%%%%-%%%%.rgbd")).string();
+
+  // Record more frames than the recorder can buffer, so that recording has to wait for the writer thread.
+  {
+    PackedRGBDSequenceRecorder recorder(filename, make_calib(), rgbImageSize, depthImageSize, 3);
+    for(int i = 0; i < 20; ++i)
+    {
+      recorder.record_frame(make_rgb_image(rgbImageSize, i), make_depth_image(depthImageSize, i), make_pose(i));
+    }
+  }
+
+  BOOST_CHECK(PackedRGBDSequenceReader::is_packed_sequence(filename));
+  check_sequence(filename, 20, rgbImageSize, depthImageSize);
+
+  PackedRGBDSequenceReader reader(filename);
+  BOOST_CHECK_CLOSE(reader.get_calib().intrinsics_d.projectionParamsSimple.fx, 500.0f, 1e-4f);
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(recovery_test)
+{
+  const Vector2i rgbImageSize(64,48), depthImageSize(32,24);
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("%%%%-%%%%.rgbd")).string();
+  const int frameCount = 10;
+
+  {
+    PackedRGBDSequenceWriter writer(filename, make_calib(), rgbImageSize, depthImageSize, RGB_COMPRESSION_NONE, DEPTH_COMPRESSION_NONE);
+    for(int i = 0; i < frameCount; ++i)
+    {
+      RGBDFrameMessage msg(rgbImageSize, depthImageSize);
+      msg.set_frame_index(i);
+      msg.set_pose(make_pose(i));
+      msg.set_rgb_image(make_rgb_image(rgbImageSize, i));
+      msg.set_depth_image(make_depth_image(depthImageSize, i));
+      writer.write_frame(msg);
+    }
+  }
+
+  std::string contents;
+  {
+    std::ifstream fs(filename.c_str(), std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+  }
+
+  const size_t indexSize = frameCount * PackedRGBDSequenceWriter::INDEX_ENTRY_SIZE + PackedRGBDSequenceWriter::TRAILER_SIZE;
+
+  // Simulate a recording that was interrupted after the last frame was written, but before the index was written.
+  {
+    std::ofstream fs(filename.c_str(), std::ios::binary);
+    fs.write(contents.data(), contents.size() - indexSize);
+  }
+
+  check_sequence(filename, frameCount, rgbImageSize, depthImageSize);
+
+  // Simulate a recording that was interrupted part-way through writing the last frame.
+  {
+    std::ofstream fs(filename.c_str(), std::ios::binary);
+    fs.write(contents.data(), contents.size() - indexSize - 100);
+  }
+
+  check_sequence(filename, frameCount - 1, rgbImageSize, depthImageSize);
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(temporal_compression_test)
+{
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("%%%%-%%%%.rgbd")).string();
+  BOOST_CHECK_THROW(
+    PackedRGBDSequenceWriter(filename, make_calib(), Vector2i(64,48), Vector2i(32,24), RGB_COMPRESSION_NONE, DEPTH_COMPRESSION_RVL_TEMPORAL),
+    std::invalid_argument
+  );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
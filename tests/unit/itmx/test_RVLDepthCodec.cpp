@@ -0,0 +1,98 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+
+#include <itmx/remotemapping/RVLDepthCodec.h>
+using namespace itmx;
+
+//#################### HELPER FUNCTIONS ####################
+
+ORShortImage_Ptr make_depth_image(const Vector2i& size, int frameIndex)
+{
+  ORShortImage_Ptr image(new ORShortImage(size, true, false));
+  short *depths = image->GetData(MEMORYDEVICE_CPU);
+  for(int y = 0; y < size.y; ++y)
+  {
+    for(int x = 0; x < size.x; ++x)
+    {
+      // A slanted plane with a hole in it, a few extreme values, and a patch that changes over time.
+      short depth = static_cast<short>(1000 + 3 * x + 5 * y);
+      if(x >= 2 && x < 6 && y >= 1 && y < 4) depth = 0;
+      if(x == size.x - 1) depth = y % 2 == 0 ? 32767 : -32768;
+      if(x < 3 && y >= size.y - 3) depth = static_cast<short>(depth + 17 * frameIndex);
+      depths[y * size.x + x] = depth;
+    }
+  }
+  return image;
+}
+
+void check_equal(const ORShortImage *expected, const ORShortImage *actual)
+{
+  BOOST_REQUIRE(expected->noDims == actual->noDims);
+  const short *e = expected->GetData(MEMORYDEVICE_CPU);
+  const short *a = actual->GetData(MEMORYDEVICE_CPU);
+  BOOST_CHECK_EQUAL_COLLECTIONS(e, e + expected->dataSize, a, a + actual->dataSize);
+}
+
+void check_round_trip(bool useTemporalDeltas)
+{
+  RVLDepthCodec encoder(useTemporalDeltas), decoder(useTemporalDeltas);
+  ORShortImage_Ptr decodedImage(new ORShortImage(Vector2i(1,1), true, false));
+  std::vector<uint8_t> bytes;
+
+  // Compress and uncompress a sequence of frames, including a change of size part-way through.
+  for(int i = 0; i < 6; ++i)
+  {
+    ORShortImage_Ptr image = make_depth_image(i < 4 ? Vector2i(16,12) : Vector2i(9,7), i);
+    encoder.compress(image.get(), bytes);
+    decoder.uncompress(bytes, decodedImage.get());
+    check_equal(image.get(), decodedImage.get());
+  }
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_RVLDepthCodec)
+
+BOOST_AUTO_TEST_CASE(round_trip_test)
+{
+  check_round_trip(false);
+  check_round_trip(true);
+}
+
+BOOST_AUTO_TEST_CASE(temporal_delta_test)
+{
+  RVLDepthCodec codec(true);
+  std::vector<uint8_t> keyframeBytes, deltaBytes;
+
+  // An unchanged frame should compress much better than the keyframe that preceded it.
+  ORShortImage_Ptr image = make_depth_image(Vector2i(32,24), 0);
+  codec.compress(image.get(), keyframeBytes);
+  codec.compress(image.get(), deltaBytes);
+  BOOST_CHECK_LT(deltaBytes.size() * 4, keyframeBytes.size());
+
+  // A temporal delta that does not follow on from a previously uncompressed image should be rejected.
+  RVLDepthCodec decoder(true);
+  ORShortImage_Ptr decodedImage(new ORShortImage(Vector2i(1,1), true, false));
+  BOOST_CHECK_THROW(decoder.uncompress(deltaBytes, decodedImage.get()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(malformed_input_test)
+{
+  RVLDepthCodec encoder(false), decoder(false);
+  ORShortImage_Ptr decodedImage(new ORShortImage(Vector2i(1,1), true, false));
+  std::vector<uint8_t> bytes;
+
+  ORShortImage_Ptr image = make_depth_image(Vector2i(16,12), 0);
+  encoder.compress(image.get(), bytes);
+
+  // Truncating the compressed data should cause uncompression to throw rather than reading past the end of it.
+  bytes.resize(bytes.size() - 2 * sizeof(uint32_t));
+  BOOST_CHECK_THROW(decoder.uncompress(bytes, decodedImage.get()), std::runtime_error);
+
+  bytes.resize(5);
+  BOOST_CHECK_THROW(decoder.uncompress(bytes, decodedImage.get()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
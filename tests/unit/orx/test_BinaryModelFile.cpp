@@ -0,0 +1,98 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/filesystem.hpp>
+namespace bf = boost::filesystem;
+
+#include <orx/persistence/BinaryModelReader.h>
+#include <orx/persistence/BinaryModelWriter.h>
+using namespace orx;
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_BinaryModelFile)
+
+BOOST_AUTO_TEST_CASE(test_round_trip)
+{
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("orx-%%%%-%%%%.model")).string();
+
+  ORUtils::MemoryBlock<float> block(1000, true, false);
+  float *blockData = block.GetData(MEMORYDEVICE_CPU);
+  for(int i = 0; i < 1000; ++i) blockData[i] = i * 0.5f;
+
+  std::vector<uint32_t> v;
+  v.push_back(23);
+  v.push_back(9);
+  v.push_back(84);
+
+  // Write a model containing a vector, a memory block and an empty chunk.
+  {
+    BinaryModelWriter writer(filename);
+    writer.write_vector("vector", v);
+    writer.write_block("block", block);
+    writer.write_chunk("empty", NULL, 0);
+    writer.close();
+  }
+
+  {
+    BinaryModelReader reader(filename);
+
+    BOOST_CHECK(reader.has_chunk("vector"));
+    BOOST_CHECK(reader.has_chunk("empty"));
+    BOOST_CHECK(!reader.has_chunk("missing"));
+    BOOST_CHECK(reader.read_vector<uint32_t>("vector") == v);
+
+    // Check that the chunks are aligned within the mapped file.
+    size_t size;
+    const void *data = reader.get_chunk("block", size);
+    BOOST_CHECK_EQUAL(size, 1000 * sizeof(float));
+    BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(data) % BinaryModelWriter::ALIGNMENT, 0);
+
+    ORUtils::MemoryBlock<float> loadedBlock(1000, true, false);
+    reader.read_block("block", loadedBlock);
+    const float *loadedBlockData = loadedBlock.GetData(MEMORYDEVICE_CPU);
+    BOOST_CHECK(std::equal(blockData, blockData + 1000, loadedBlockData));
+
+    // Check that reading a chunk into a block of the wrong size, or reading a non-existent chunk, fails.
+    ORUtils::MemoryBlock<float> smallBlock(10, true, false);
+    BOOST_CHECK_THROW(reader.read_block("block", smallBlock), std::runtime_error);
+    BOOST_CHECK_THROW(reader.get_chunk("missing", size), std::runtime_error);
+  }
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(test_invalid_files)
+{
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("orx-%%%%-%%%%.model")).string();
+
+  // A model whose writer was never closed should not be accepted.
+  {
+    BinaryModelWriter writer(filename);
+    writer.write_chunk("empty", NULL, 0);
+  }
+  BOOST_CHECK_THROW(BinaryModelReader reader(filename), std::runtime_error);
+
+  // Nor should a model that was truncated after being written.
+  {
+    const std::vector<float> data(1024, 1.0f);
+    BinaryModelWriter writer(filename);
+    writer.write_vector("data", data);
+    writer.close();
+  }
+  bf::resize_file(filename, bf::file_size(filename) / 2);
+  BOOST_CHECK_THROW(BinaryModelReader reader(filename), std::runtime_error);
+
+  // Neither should a non-existent file.
+  bf::remove(filename);
+  BOOST_CHECK_THROW(BinaryModelReader reader(filename), std::runtime_error);
+
+  // Duplicate chunk names should be rejected.
+  BinaryModelWriter writer(filename);
+  writer.write_chunk("chunk", NULL, 0);
+  BOOST_CHECK_THROW(writer.write_chunk("chunk", NULL, 0), std::runtime_error);
+  writer.close();
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
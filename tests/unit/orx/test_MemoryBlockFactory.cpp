@@ -0,0 +1,133 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <orx/base/MemoryBlockFactory.h>
+using namespace orx;
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Gets the memory usage for the specified tag.
+ *
+ * \param tag The tag.
+ * \return    The memory usage for the tag.
+ */
+MemoryBlockFactory::Usage get_usage(const std::string& tag)
+{
+  std::map<std::string,MemoryBlockFactory::Usage> usages = MemoryBlockFactory::instance().get_usages();
+  return usages[tag];
+}
+
+/**
+ * \brief Prepares the memory block factory for a test.
+ *
+ * \param poolCapacity  The capacity of the pool to use for the test.
+ */
+void prepare_factory(size_t poolCapacity)
+{
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  mbf.set_device_type(ORUtils::DEVICE_CPU);
+  mbf.trim_pool();
+  mbf.set_pool_capacity(poolCapacity);
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_MemoryBlockFactory)
+
+BOOST_AUTO_TEST_CASE(test_accounting)
+{
+  prepare_factory(1024 * 1024);
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+
+  {
+    boost::shared_ptr<ORUtils::MemoryBlock<float> > block = mbf.make_block<float>(100, "accounting");
+    boost::shared_ptr<ORUtils::Image<int> > image = mbf.make_image<int>(Vector2i(10, 20), "accounting");
+
+    MemoryBlockFactory::Usage usage = get_usage("accounting");
+    BOOST_CHECK_EQUAL(usage.m_liveBlockCount, 2);
+    BOOST_CHECK_EQUAL(usage.m_liveBytes, 100 * sizeof(float) + 200 * sizeof(int));
+
+    // Resizing an image should not affect the usage, which is based on the sizes of the blocks when they were made.
+    image->ChangeDims(Vector2i(20, 20));
+    usage = get_usage("accounting");
+    BOOST_CHECK_EQUAL(usage.m_liveBytes, 100 * sizeof(float) + 200 * sizeof(int));
+    BOOST_CHECK_EQUAL(usage.m_peakBytes, usage.m_liveBytes);
+  }
+
+  // Once the blocks have been released, they should no longer count towards the live usage, but the peak usage should be retained.
+  MemoryBlockFactory::Usage usage = get_usage("accounting");
+  BOOST_CHECK_EQUAL(usage.m_liveBlockCount, 0);
+  BOOST_CHECK_EQUAL(usage.m_liveBytes, 0);
+  BOOST_CHECK_EQUAL(usage.m_peakBytes, 100 * sizeof(float) + 200 * sizeof(int));
+
+  // The released blocks should now be in the pool, at the sizes they had when they were released.
+  BOOST_CHECK_EQUAL(mbf.get_pooled_bytes(), 100 * sizeof(float) + 400 * sizeof(int));
+  mbf.trim_pool();
+  BOOST_CHECK_EQUAL(mbf.get_pooled_bytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_recycling)
+{
+  prepare_factory(1024 * 1024);
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+
+  // Make a block, fill it with data and then release it.
+  const ORUtils::MemoryBlock<float> *firstBlock = NULL;
+  {
+    boost::shared_ptr<ORUtils::MemoryBlock<float> > block = mbf.make_block<float>(100);
+    float *data = block->GetData(MEMORYDEVICE_CPU);
+    for(int i = 0; i < 100; ++i) data[i] = 1.0f;
+    firstBlock = block.get();
+  }
+
+  // A block of a different size should not reuse the released block.
+  boost::shared_ptr<ORUtils::MemoryBlock<float> > differentBlock = mbf.make_block<float>(50);
+  BOOST_CHECK(differentBlock.get() != firstBlock);
+
+  // A block of the same type and size should reuse the released block, which should have been cleared.
+  boost::shared_ptr<ORUtils::MemoryBlock<float> > sameBlock = mbf.make_block<float>(100);
+  BOOST_CHECK(sameBlock.get() == firstBlock);
+  BOOST_CHECK_EQUAL(sameBlock->dataSize, 100);
+
+  const float *data = sameBlock->GetData(MEMORYDEVICE_CPU);
+  for(int i = 0; i < 100; ++i) BOOST_CHECK_EQUAL(data[i], 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_recycling_images)
+{
+  prepare_factory(16 * 1024 * 1024);
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+
+  const ORUtils::Image<float> *firstImage = mbf.make_image<float>(Vector2i(640, 480)).get();
+
+  // An image with the same number of pixels should reuse the released image, but should have the requested dimensions.
+  boost::shared_ptr<ORUtils::Image<float> > image = mbf.make_image<float>(Vector2i(480, 640));
+  BOOST_CHECK(image.get() == firstImage);
+  BOOST_CHECK_EQUAL(image->noDims.x, 480);
+  BOOST_CHECK_EQUAL(image->noDims.y, 640);
+
+  // A memory block of the same size should not reuse an image (or vice versa).
+  const ORUtils::MemoryBlock<float> *block = mbf.make_block<float>(640 * 480).get();
+  BOOST_CHECK(block != image.get());
+}
+
+BOOST_AUTO_TEST_CASE(test_capacity)
+{
+  prepare_factory(100 * sizeof(float));
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+
+  // A block that fits within the capacity of the pool should be kept for reuse.
+  mbf.make_block<float>(100);
+  BOOST_CHECK_EQUAL(mbf.get_pooled_bytes(), 100 * sizeof(float));
+
+  // A block that would take the pool over its capacity should be freed immediately.
+  mbf.make_block<float>(10);
+  BOOST_CHECK_EQUAL(mbf.get_pooled_bytes(), 100 * sizeof(float));
+
+  // Reducing the capacity of the pool should free any blocks that no longer fit.
+  mbf.set_pool_capacity(0);
+  BOOST_CHECK_EQUAL(mbf.get_pooled_bytes(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,147 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/assign/list_of.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/vector.hpp>
+using boost::assign::list_of;
+
+#include <rafl/decisionfunctions/FeatureThresholdingDecisionFunctionGenerator.h>
+#include <rafl/examples/ExampleReservoir.h>
+using namespace rafl;
+using namespace tvgutil;
+
+typedef int Label;
+typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Makes an example with a two-element descriptor.
+ *
+ * \param x     The first feature of the descriptor.
+ * \param y     The second feature of the descriptor.
+ * \param label The label for the example.
+ * \return      The example.
+ */
+Example_CPtr make_example(float x, float y, Label label)
+{
+  Descriptor_Ptr descriptor(new Descriptor(list_of(x)(y)));
+  return Example_CPtr(new Example<Label>(descriptor, label));
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_ExampleReservoir)
+
+BOOST_AUTO_TEST_CASE(add_example_test)
+{
+  RandomNumberGenerator_Ptr rng(new RandomNumberGenerator(12345));
+  const size_t maxClassSize = 3;
+  ExampleReservoir<Label> reservoir(maxClassSize, rng);
+
+  // Check that the examples are stored in the feature matrix in the order in which they were added.
+  reservoir.add_example(make_example(1.0f, 2.0f, 7));
+  reservoir.add_example(make_example(3.0f, 4.0f, 9));
+  BOOST_REQUIRE_EQUAL(reservoir.current_size(), 2);
+
+  const FeatureMatrix& features = reservoir.get_features();
+  BOOST_REQUIRE_EQUAL(features.get_feature_count(), 2);
+  BOOST_CHECK_EQUAL(features.get_value(0, 0), 1.0f);
+  BOOST_CHECK_EQUAL(features.get_value(0, 1), 2.0f);
+  BOOST_CHECK_EQUAL(features.get_value(1, 0), 3.0f);
+  BOOST_CHECK_EQUAL(features.get_value(1, 1), 4.0f);
+  BOOST_CHECK_EQUAL(features.get_column(1)[1], 4.0f);
+  BOOST_CHECK_EQUAL(reservoir.get_labels()[0], 7);
+  BOOST_CHECK_EQUAL(reservoir.get_labels()[1], 9);
+
+  // Check that adding lots of examples of one class never exceeds the maximum class size, and that the rows survive the matrix growing.
+  for(int i = 0; i < 100; ++i)
+  {
+    reservoir.add_example(make_example(static_cast<float>(i), 0.0f, 7));
+  }
+
+  BOOST_CHECK_EQUAL(reservoir.current_size(), maxClassSize + 1);
+  BOOST_CHECK_EQUAL(reservoir.seen_examples(), 102);
+  BOOST_CHECK_EQUAL(features.get_value(1, 0), 3.0f);
+  BOOST_CHECK_CLOSE(reservoir.get_class_multipliers()[7], 101.0f / maxClassSize, 1e-4f);
+
+  // Check that examples can be copied directly from one reservoir to another.
+  ExampleReservoir<Label> target(maxClassSize, rng);
+  BOOST_CHECK(target.add_example(reservoir, 1));
+  BOOST_REQUIRE_EQUAL(target.current_size(), 1);
+  BOOST_CHECK_EQUAL(target.get_labels()[0], 9);
+  BOOST_CHECK_EQUAL(target.get_features().get_value(0, 0), 3.0f);
+  BOOST_CHECK_EQUAL(target.get_features().get_value(0, 1), 4.0f);
+}
+
+BOOST_AUTO_TEST_CASE(serialization_test)
+{
+  RandomNumberGenerator_Ptr rng(new RandomNumberGenerator(12345));
+  ExampleReservoir<Label> reservoir(2, rng);
+  reservoir.add_example(make_example(1.0f, 2.0f, 7));
+  reservoir.add_example(make_example(3.0f, 4.0f, 9));
+  reservoir.add_example(make_example(5.0f, 6.0f, 7));
+
+  // Check that a reservoir survives a round trip through an archive.
+  std::stringstream stream;
+  {
+    const ExampleReservoir<Label>& r = reservoir;
+    boost::archive::text_oarchive ar(stream);
+    ar & r;
+  }
+
+  ExampleReservoir<Label> loadedReservoir;
+  {
+    boost::archive::text_iarchive ar(stream);
+    ar & loadedReservoir;
+  }
+
+  BOOST_REQUIRE_EQUAL(loadedReservoir.current_size(), 3);
+  BOOST_CHECK_EQUAL(loadedReservoir.seen_examples(), 3);
+  BOOST_CHECK(loadedReservoir.get_labels() == reservoir.get_labels());
+  for(size_t row = 0; row < 3; ++row)
+  {
+    BOOST_CHECK_EQUAL(loadedReservoir.get_features().get_value(row, 0), reservoir.get_features().get_value(row, 0));
+    BOOST_CHECK_EQUAL(loadedReservoir.get_features().get_value(row, 1), reservoir.get_features().get_value(row, 1));
+  }
+
+  // Check that the loaded reservoir can still grow.
+  BOOST_CHECK(loadedReservoir.add_example(make_example(7.0f, 8.0f, 11)));
+  BOOST_REQUIRE_EQUAL(loadedReservoir.current_size(), 4);
+  BOOST_CHECK_EQUAL(loadedReservoir.get_features().get_value(0, 1), 2.0f);
+  BOOST_CHECK_EQUAL(loadedReservoir.get_features().get_value(3, 1), 8.0f);
+}
+
+BOOST_AUTO_TEST_CASE(split_examples_test)
+{
+  RandomNumberGenerator_Ptr rng(new RandomNumberGenerator(12345));
+  ExampleReservoir<Label> reservoir(100, rng);
+
+  // Add examples that can be perfectly separated by thresholding their first feature.
+  for(int i = 0; i < 20; ++i)
+  {
+    reservoir.add_example(make_example(i < 10 ? -1.0f - i : 1.0f + i, 0.0f, i < 10 ? 0 : 1));
+  }
+
+  // Check that the best split we find separates the two classes.
+  FeatureThresholdingDecisionFunctionGenerator<Label> generator(std::make_pair(0, 0));
+  DecisionFunctionGenerator<Label>::Split_CPtr split = generator.split_examples(reservoir, 100, 0.0f, boost::none, rng);
+  BOOST_REQUIRE(split);
+  BOOST_REQUIRE_EQUAL(split->m_leftRows.size(), 10);
+  BOOST_REQUIRE_EQUAL(split->m_rightRows.size(), 10);
+
+  const std::vector<Label>& labels = reservoir.get_labels();
+  for(size_t i = 0; i < 10; ++i)
+  {
+    BOOST_CHECK_EQUAL(labels[split->m_leftRows[i]], 0);
+    BOOST_CHECK_EQUAL(labels[split->m_rightRows[i]], 1);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,127 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/assign/list_of.hpp>
+using boost::assign::list_of;
+
+#include <rafl/core/RandomForest.h>
+#include <rafl/decisionfunctions/FeatureThresholdingDecisionFunctionGenerator.h>
+#include <rafl/examples/UnitCircleExampleGenerator.h>
+using namespace rafl;
+using namespace tvgutil;
+
+typedef int Label;
+typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+typedef RandomForest<Label> RF;
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Makes an untrained random forest.
+ *
+ * \return  The random forest.
+ */
+boost::shared_ptr<RF> make_empty_forest()
+{
+  DecisionTree<Label>::Settings settings;
+  settings.candidateCount = 64;
+  settings.decisionFunctionGenerator.reset(new FeatureThresholdingDecisionFunctionGenerator<Label>);
+  settings.gainThreshold = 0.0f;
+  settings.maxClassSize = 1000;
+  settings.maxTreeHeight = 10;
+  settings.randomNumberGenerator.reset(new RandomNumberGenerator(12345));
+  settings.seenExamplesThreshold = 20;
+  settings.splittabilityThreshold = 0.5f;
+  settings.usePMFReweighting = true;
+
+  const size_t treeCount = 4;
+  return boost::shared_ptr<RF>(new RF(treeCount, settings));
+}
+
+/**
+ * \brief Makes a random forest that has been trained on examples generated around the unit circle.
+ *
+ * \param labels  The labels of the classes on which to train the forest.
+ * \return        The random forest.
+ */
+boost::shared_ptr<RF> make_forest(const std::set<Label>& labels)
+{
+  boost::shared_ptr<RF> forest = make_empty_forest();
+
+  UnitCircleExampleGenerator<Label> generator(labels, 1234, 0.1f, 0.2f);
+  forest->add_examples(generator.generate_examples(labels, 200));
+  forest->train(100);
+
+  return forest;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_RandomForest)
+
+BOOST_AUTO_TEST_CASE(batch_predict_test)
+{
+  std::set<Label> labels = list_of(1)(2)(3)(4);
+  boost::shared_ptr<RF> forest = make_forest(labels);
+
+  // Lay out the descriptors for some test examples in a contiguous block of features, with some padding after each one.
+  UnitCircleExampleGenerator<Label> generator(labels, 5678, 0.1f, 0.2f);
+  std::vector<Example_CPtr> examples = generator.generate_examples(labels, 100);
+  const size_t featureCount = 2, stride = 3;
+  std::vector<float> features(examples.size() * stride, -1.0f);
+  for(size_t i = 0, size = examples.size(); i < size; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(examples[i]->get_descriptor()->size(), featureCount);
+    std::copy(examples[i]->get_descriptor()->begin(), examples[i]->get_descriptor()->end(), features.begin() + i * stride);
+  }
+
+  // Check that predicting the labels in a batch gives the same results as predicting them one at a time.
+  std::vector<Label> batchLabels(examples.size());
+  forest->predict(&features[0], examples.size(), stride, &batchLabels[0]);
+
+  size_t correctCount = 0;
+  for(size_t i = 0, size = examples.size(); i < size; ++i)
+  {
+    BOOST_CHECK_EQUAL(batchLabels[i], forest->predict(examples[i]->get_descriptor()));
+    if(batchLabels[i] == examples[i]->get_label()) ++correctCount;
+  }
+
+  // Check that the forest has actually learnt something.
+  BOOST_CHECK_GT(correctCount, examples.size() / 2);
+}
+
+BOOST_AUTO_TEST_CASE(feature_matrix_training_test)
+{
+  std::set<Label> labels = list_of(1)(2)(3)(4);
+  boost::shared_ptr<RF> forest = make_forest(labels);
+
+  // Train a second forest on the same examples, but pass them in as the rows of a feature matrix.
+  UnitCircleExampleGenerator<Label> generator(labels, 1234, 0.1f, 0.2f);
+  std::vector<Example_CPtr> examples = generator.generate_examples(labels, 200);
+  FeatureMatrix features;
+  std::vector<Label> exampleLabels;
+  for(size_t i = 0, size = examples.size(); i < size; ++i)
+  {
+    size_t row = features.add_row(examples[i]->get_descriptor()->size());
+    features.set_row(row, &(*examples[i]->get_descriptor())[0]);
+    exampleLabels.push_back(examples[i]->get_label());
+  }
+
+  boost::shared_ptr<RF> matrixForest = make_empty_forest();
+  matrixForest->add_examples(features, exampleLabels);
+  matrixForest->train(100);
+
+  // Check that the two forests make the same predictions.
+  UnitCircleExampleGenerator<Label> testGenerator(labels, 5678, 0.1f, 0.2f);
+  std::vector<Example_CPtr> testExamples = testGenerator.generate_examples(labels, 100);
+  for(size_t i = 0, size = testExamples.size(); i < size; ++i)
+  {
+    BOOST_CHECK_EQUAL(matrixForest->predict(testExamples[i]->get_descriptor()), forest->predict(testExamples[i]->get_descriptor()));
+  }
+
+  // Check that mismatched numbers of descriptors and labels are rejected.
+  exampleLabels.pop_back();
+  BOOST_CHECK_THROW(matrixForest->add_examples(features, exampleLabels), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,216 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <stack>
+
+#include <spaint/touch/TouchComponentAnalyser.h>
+using namespace spaint;
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Labels the 4-connected components of a mask using a simple flood fill (for use as a reference).
+ *
+ * \param mask    The mask.
+ * \param width   The width of the mask.
+ * \param height  The height of the mask.
+ * \return        An image in which each pixel contains the index of its component (in order of first appearance), or -1.
+ */
+std::vector<int> flood_fill_components(const std::vector<unsigned char>& mask, int width, int height)
+{
+  std::vector<int> labels(mask.size(), -1);
+  int componentCount = 0;
+  for(int i = 0, pixelCount = width * height; i < pixelCount; ++i)
+  {
+    if(!mask[i] || labels[i] != -1) continue;
+
+    std::stack<int> pixels;
+    pixels.push(i);
+    labels[i] = componentCount;
+    while(!pixels.empty())
+    {
+      const int p = pixels.top();
+      pixels.pop();
+
+      const int x = p % width, y = p / width;
+      const int neighbours[] = { x > 0 ? p - 1 : -1, x < width - 1 ? p + 1 : -1, y > 0 ? p - width : -1, y < height - 1 ? p + width : -1 };
+      for(int k = 0; k < 4; ++k)
+      {
+        const int n = neighbours[k];
+        if(n != -1 && mask[n] && labels[n] == -1)
+        {
+          labels[n] = componentCount;
+          pixels.push(n);
+        }
+      }
+    }
+
+    ++componentCount;
+  }
+  return labels;
+}
+
+/**
+ * \brief Makes a mask from a set of strings, one per row, in which '#' denotes a set pixel.
+ *
+ * \param rows    The rows of the mask.
+ * \param width   The width of the mask.
+ * \param height  The height of the mask.
+ * \return        The mask.
+ */
+std::vector<unsigned char> make_mask(const char **rows, int width, int height)
+{
+  std::vector<unsigned char> mask(width * height);
+  for(int y = 0; y < height; ++y)
+  {
+    for(int x = 0; x < width; ++x)
+    {
+      mask[y * width + x] = rows[y][x] == '#' ? 1 : 0;
+    }
+  }
+  return mask;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_TouchComponentAnalyser)
+
+BOOST_AUTO_TEST_CASE(detect_changes_test)
+{
+  const int width = 4, height = 2;
+  const float rawDepth[] =     { 1.0f, 1.0f, 2.5f, -1.0f, 1.0f,  1.0f, 1.0f, 1.0f };
+  const float depthRaycast[] = { 1.0f, 1.1f, 1.0f,  1.0f, 1.02f, 1.3f, 1.5f, 1.5f };
+  float thresholdedRawDepth[width * height], diffRawRaycast[width * height];
+
+  TouchComponentAnalyser analyser(width, height);
+  analyser.detect_changes(rawDepth, depthRaycast, 2.0f, 0.05f, 1, thresholdedRawDepth, diffRawRaycast);
+
+  // Depths beyond the maximum should have been masked out, and the differences should be invalid wherever either depth is.
+  BOOST_CHECK_EQUAL(thresholdedRawDepth[2], -1.0f);
+  BOOST_CHECK_EQUAL(diffRawRaycast[2], -1.0f);
+  BOOST_CHECK_EQUAL(diffRawRaycast[3], -1.0f);
+  BOOST_CHECK_CLOSE(diffRawRaycast[1], 0.1f, 1e-3f);
+
+  // The differences in mm should have been clamped to [0,255].
+  const std::vector<unsigned char>& diffInMm = analyser.get_diff_in_mm();
+  BOOST_CHECK_EQUAL(diffInMm[0], 0);
+  BOOST_CHECK_EQUAL(diffInMm[2], 0);
+  BOOST_CHECK_EQUAL(diffInMm[4], 19);
+  BOOST_CHECK_EQUAL(diffInMm[6], 255);
+
+  // With a 1x1 kernel, the opening has no effect, so the change mask is just the thresholded differences.
+  const unsigned char expectedMask[] = { 0, 1, 0, 0, 0, 1, 1, 1 };
+  const std::vector<unsigned char>& changeMask = analyser.get_change_mask();
+  BOOST_CHECK_EQUAL_COLLECTIONS(changeMask.begin(), changeMask.end(), expectedMask, expectedMask + width * height);
+
+  // The changed pixels are all 4-connected, so they should form a single component.
+  const std::vector<TouchComponentAnalyser::Component>& components = analyser.get_components();
+  BOOST_REQUIRE_EQUAL(components.size(), 1);
+  BOOST_CHECK_EQUAL(components[0].m_area, 4);
+  BOOST_CHECK_EQUAL(components[0].m_diffSumMm, 100 + 255 + 255 + 255);
+
+  // The histogram descriptor should count the pixels outside the component in the first bin.
+  std::vector<float> descriptor;
+  analyser.calculate_histogram_descriptor(0, descriptor);
+  BOOST_REQUIRE_EQUAL(descriptor.size(), 64);
+  BOOST_CHECK_EQUAL(descriptor[0], 4.0f);
+  BOOST_CHECK_EQUAL(descriptor[100 * 64 / 255], 1.0f);
+  BOOST_CHECK_EQUAL(descriptor[63], 3.0f);
+}
+
+BOOST_AUTO_TEST_CASE(label_components_test)
+{
+  const char *rows[] = {
+    "##..#...",
+    "#...#.##",
+    "#.###.#.",
+    "......#.",
+    ".#.....#"
+  };
+  const int width = 8, height = 5;
+  std::vector<unsigned char> mask = make_mask(rows, width, height);
+
+  TouchComponentAnalyser analyser(width, height);
+  analyser.label_components(&mask[0]);
+
+  // Diagonal neighbours are not connected, so there should be five components, ordered by their first pixel in raster order.
+  const std::vector<TouchComponentAnalyser::Component>& components = analyser.get_components();
+  BOOST_REQUIRE_EQUAL(components.size(), 5);
+
+  const int expectedAreas[] = { 4, 5, 4, 1, 1 };
+  const int expectedBoxes[][4] = { { 0, 0, 1, 2 }, { 2, 0, 4, 2 }, { 6, 1, 7, 3 }, { 1, 4, 1, 4 }, { 7, 4, 7, 4 } };
+  for(int i = 0; i < 5; ++i)
+  {
+    BOOST_CHECK_EQUAL(components[i].m_area, expectedAreas[i]);
+    BOOST_CHECK_EQUAL(components[i].m_minX, expectedBoxes[i][0]);
+    BOOST_CHECK_EQUAL(components[i].m_minY, expectedBoxes[i][1]);
+    BOOST_CHECK_EQUAL(components[i].m_maxX, expectedBoxes[i][2]);
+    BOOST_CHECK_EQUAL(components[i].m_maxY, expectedBoxes[i][3]);
+  }
+
+  // Only the components whose areas fall within the specified range should be selected as candidates.
+  std::vector<int> candidates = analyser.select_candidate_components(2, 4);
+  const int expectedCandidates[] = { 0, 2 };
+  BOOST_CHECK_EQUAL_COLLECTIONS(candidates.begin(), candidates.end(), expectedCandidates, expectedCandidates + 2);
+}
+
+BOOST_AUTO_TEST_CASE(label_components_random_test)
+{
+  const int width = 97, height = 61;
+  std::srand(12345);
+
+  for(int iteration = 0; iteration < 10; ++iteration)
+  {
+    std::vector<unsigned char> mask(width * height);
+    for(size_t i = 0, size = mask.size(); i < size; ++i) mask[i] = std::rand() % 100 < 55 ? 1 : 0;
+
+    TouchComponentAnalyser analyser(width, height);
+    analyser.label_components(&mask[0]);
+
+    // The labelling should match the one produced by the reference flood fill exactly, since both number the components in raster order.
+    std::vector<int> expectedLabels = flood_fill_components(mask, width, height);
+    const std::vector<int>& labels = analyser.get_labels();
+    BOOST_CHECK(labels == expectedLabels);
+
+    int totalArea = 0;
+    const std::vector<TouchComponentAnalyser::Component>& components = analyser.get_components();
+    for(size_t i = 0, size = components.size(); i < size; ++i) totalArea += components[i].m_area;
+
+    int setPixelCount = 0;
+    for(size_t i = 0, size = mask.size(); i < size; ++i) setPixelCount += mask[i];
+    BOOST_CHECK_EQUAL(totalArea, setPixelCount);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(open_test)
+{
+  const char *rows[] = {
+    "###.....#.",
+    "###.......",
+    "###..####.",
+    ".....####.",
+    ".#...####.",
+    "......###."
+  };
+  const int width = 10, height = 6;
+  std::vector<unsigned char> mask = make_mask(rows, width, height);
+
+  TouchComponentAnalyser analyser(width, height);
+  analyser.open(&mask[0], 3);
+
+  // The isolated pixels should be removed, but both blocks should survive intact. In particular, the blocks that touch
+  // the image boundary should not be eroded away, since pixels outside the image are treated as neutral.
+  const char *expectedRows[] = {
+    "###.......",
+    "###.......",
+    "###..####.",
+    ".....####.",
+    ".....####.",
+    "......###."
+  };
+  std::vector<unsigned char> expectedMask = make_mask(expectedRows, width, height);
+  BOOST_CHECK_EQUAL_COLLECTIONS(mask.begin(), mask.end(), expectedMask.begin(), expectedMask.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
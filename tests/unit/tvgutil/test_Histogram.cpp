@@ -0,0 +1,115 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+
+#include <tvgutil/statistics/ProbabilityMassFunction.h>
+using namespace tvgutil;
+
+typedef unsigned char Label;
+
+//#################### HELPER TYPES ####################
+
+/**
+ * \brief A histogram in the format that was used when histograms stored their bins in a std::map.
+ */
+struct LegacyHistogram
+{
+  std::map<Label,size_t> bins;
+  size_t count;
+
+  template <typename Archive>
+  void serialize(Archive& ar, const unsigned int version)
+  {
+    ar & bins;
+    ar & count;
+  }
+};
+
+//#################### HELPER FUNCTIONS ####################
+
+Histogram<Label> make_histogram()
+{
+  Histogram<Label> histogram;
+  for(int i = 0; i < 5; ++i) histogram.add(23);
+  for(int i = 0; i < 2; ++i) histogram.add(9);
+  for(int i = 0; i < 3; ++i) histogram.add(255);
+  return histogram;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_Histogram)
+
+BOOST_AUTO_TEST_CASE(bins_test)
+{
+  Histogram<Label> histogram = make_histogram();
+  BOOST_CHECK_EQUAL(histogram.get_count(), 10);
+
+  const Histogram<Label>::Bins& bins = histogram.get_bins();
+  BOOST_REQUIRE_EQUAL(bins.size(), 3);
+
+  // The bins should be in label order, as they would be in a std::map.
+  Histogram<Label>::Bins::const_iterator it = bins.begin();
+  BOOST_CHECK_EQUAL(it->first, 9);    BOOST_CHECK_EQUAL(it->second, 2);  ++it;
+  BOOST_CHECK_EQUAL(it->first, 23);   BOOST_CHECK_EQUAL(it->second, 5);  ++it;
+  BOOST_CHECK_EQUAL(it->first, 255);  BOOST_CHECK_EQUAL(it->second, 3);
+
+  BOOST_CHECK(bins.find(23) != bins.end());
+  BOOST_CHECK(bins.find(24) == bins.end());
+}
+
+BOOST_AUTO_TEST_CASE(pmf_test)
+{
+  ProbabilityMassFunction<Label> pmf(make_histogram());
+  BOOST_CHECK_EQUAL(pmf.calculate_best_label(), 23);
+  BOOST_CHECK_CLOSE(pmf.get_mass(9), 0.2f, 1e-4f);
+  BOOST_CHECK_EQUAL(pmf.get_mass(10), 0.0f);
+
+  std::map<Label,float> multipliers;
+  multipliers[255] = 4.0f;
+  ProbabilityMassFunction<Label> weightedPMF(make_histogram(), multipliers);
+  BOOST_CHECK_EQUAL(weightedPMF.calculate_best_label(), 255);
+  BOOST_CHECK_CLOSE(weightedPMF.get_mass(255), 12.0f / 19.0f, 1e-4f);
+}
+
+BOOST_AUTO_TEST_CASE(serialization_test)
+{
+  // Histograms should be serialized in the same format as when their bins were stored in a std::map.
+  LegacyHistogram legacyHistogram;
+  legacyHistogram.bins[9] = 2;
+  legacyHistogram.bins[23] = 5;
+  legacyHistogram.bins[255] = 3;
+  legacyHistogram.count = 10;
+
+  std::stringstream legacyStream;
+  {
+    const LegacyHistogram& h = legacyHistogram;
+    boost::archive::text_oarchive ar(legacyStream);
+    ar & h;
+  }
+
+  std::stringstream histogramStream;
+  {
+    const Histogram<Label> h = make_histogram();
+    boost::archive::text_oarchive ar(histogramStream);
+    ar & h;
+  }
+
+  BOOST_CHECK_EQUAL(histogramStream.str(), legacyStream.str());
+
+  // It should also be possible to load histograms that were saved in the legacy format.
+  Histogram<Label> loadedHistogram;
+  {
+    boost::archive::text_iarchive ar(legacyStream);
+    ar & loadedHistogram;
+  }
+
+  BOOST_CHECK_EQUAL(loadedHistogram.get_count(), legacyHistogram.count);
+  BOOST_CHECK(loadedHistogram.get_bins().to_map() == legacyHistogram.bins);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
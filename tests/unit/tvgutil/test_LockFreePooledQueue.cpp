@@ -0,0 +1,135 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/make_shared.hpp>
+
+#include <tvgutil/containers/LockFreePooledQueue.h>
+using namespace tvgutil;
+using namespace tvgutil::pooled_queue;
+
+typedef boost::shared_ptr<int> Int_Ptr;
+typedef LockFreePooledQueue<Int_Ptr> Queue;
+
+//#################### HELPER FUNCTIONS ####################
+
+Int_Ptr make_int()
+{
+  return boost::make_shared<int>(-1);
+}
+
+bool push(Queue& queue, int value)
+{
+  Queue::PushHandler_Ptr pushHandler = queue.begin_push();
+  boost::optional<Int_Ptr&> elt = pushHandler->get();
+  if(elt) **elt = value;
+  return static_cast<bool>(elt);
+}
+
+void push_sequence(Queue *queue, int count)
+{
+  for(int i = 0; i < count; ++i) push(*queue, i);
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_LockFreePooledQueue)
+
+BOOST_AUTO_TEST_CASE(discard_test)
+{
+  Queue queue(PES_DISCARD);
+  queue.initialise(2, &make_int);
+
+  BOOST_CHECK(push(queue, 0));
+  BOOST_CHECK(push(queue, 1));
+  BOOST_CHECK(!push(queue, 2));
+  BOOST_CHECK_EQUAL(queue.size(), 2);
+
+  // Peeking should not change the size of the queue, but popping should.
+  BOOST_CHECK_EQUAL(*queue.peek(), 0);
+  BOOST_CHECK_EQUAL(queue.size(), 2);
+  queue.pop();
+  BOOST_CHECK_EQUAL(queue.size(), 1);
+
+  // Popping should return the element to the pool so that it can be reused.
+  BOOST_CHECK(push(queue, 3));
+  BOOST_CHECK_EQUAL(*queue.peek(), 1);
+  queue.pop();
+  BOOST_CHECK_EQUAL(*queue.peek(), 3);
+  queue.pop();
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(grow_test)
+{
+  Queue queue(PES_GROW);
+  queue.initialise(1, &make_int, 3);
+
+  for(int i = 0; i < 3; ++i) push(queue, i);
+  BOOST_CHECK_EQUAL(queue.size(), 3);
+
+  for(int i = 0; i < 3; ++i)
+  {
+    BOOST_CHECK_EQUAL(*queue.peek(), i);
+    queue.pop();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ownership_test)
+{
+  Queue queue(PES_DISCARD);
+  queue.initialise(1, &make_int);
+
+  // Once an element has been taken from one of the ring buffers, the ring buffer should no longer refer to it.
+  BOOST_CHECK(push(queue, 0));
+  Int_Ptr elt = queue.peek();
+  BOOST_CHECK_EQUAL(elt.use_count(), 2);
+
+  // Once the element has been popped, only the pool should refer to it (besides our own copy).
+  queue.pop();
+  BOOST_CHECK_EQUAL(elt.use_count(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(replace_test)
+{
+  Queue queue(PES_REPLACE_RANDOM);
+  queue.initialise(3, &make_int);
+
+  // Start reading the first element: it must not be replaced by later pushes.
+  for(int i = 0; i < 3; ++i) push(queue, i);
+  BOOST_CHECK_EQUAL(*queue.peek(), 0);
+
+  // Each further push should replace the oldest element that has not yet been read.
+  push(queue, 3);
+  push(queue, 4);
+  BOOST_CHECK_EQUAL(queue.size(), 3);
+
+  const int expected[] = { 0, 3, 4 };
+  for(int i = 0; i < 3; ++i)
+  {
+    BOOST_CHECK_EQUAL(*queue.peek(), expected[i]);
+    queue.pop();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(wait_test)
+{
+  // Push a long sequence through a small queue from another thread, and check that it arrives intact and in order.
+  const int count = 100000;
+  Queue queue(PES_WAIT);
+  queue.initialise(4, &make_int);
+
+  boost::thread producer(&push_sequence, &queue, count);
+
+  bool inOrder = true;
+  for(int i = 0; i < count; ++i)
+  {
+    if(*queue.peek() != i) inOrder = false;
+    queue.pop();
+  }
+
+  producer.join();
+  BOOST_CHECK(inOrder);
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,86 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+#include <tvgutil/misc/Setting.h>
+using namespace tvgutil;
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_Setting)
+
+BOOST_AUTO_TEST_CASE(default_test)
+{
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  Setting<int> s(settings, "Foo", 23);
+  BOOST_CHECK_EQUAL(s.key(), "Foo");
+  BOOST_CHECK_EQUAL(*s, 23);
+
+  settings->add_value("Foo", "84");
+  BOOST_CHECK_EQUAL(*s, 84);
+}
+
+BOOST_AUTO_TEST_CASE(missing_test)
+{
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  Setting<float> s(settings, "Foo");
+  BOOST_CHECK_THROW(s.get(), std::runtime_error);
+
+  settings->add_value("Foo", "0.5");
+  BOOST_CHECK_EQUAL(*s, 0.5f);
+}
+
+BOOST_AUTO_TEST_CASE(output_effective_settings_test)
+{
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  settings->add_value("Bar", "x");
+  settings->add_value("Bar", "y");
+
+  Setting<bool> b(settings, "Baz", false);
+  Setting<std::string> f(settings, "Foo");
+  Setting<std::string> bar(settings, "Bar", "z");
+
+  std::ostringstream oss;
+  settings->output_effective_settings(oss);
+  BOOST_CHECK_EQUAL(oss.str(), "Bar=x\nBar=y\nBaz=0\n#Foo=\n");
+}
+
+BOOST_AUTO_TEST_CASE(output_effective_settings_get_first_value_test)
+{
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  settings->add_value("Bar", "x");
+
+  BOOST_CHECK_EQUAL(settings->get_first_value<std::string>("Bar", "z"), "x");
+  BOOST_CHECK_EQUAL(settings->get_first_value<int>("Foo", 23), 23);
+
+  // Only the first default for a setting should be recorded.
+  BOOST_CHECK_EQUAL(settings->get_first_value<int>("Foo", 24), 24);
+
+  std::ostringstream oss;
+  settings->output_effective_settings(oss);
+  BOOST_CHECK_EQUAL(oss.str(), "Bar=x\nFoo=23\n");
+}
+
+BOOST_AUTO_TEST_CASE(refresh_test)
+{
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  Setting<bool> s(settings, "Foo", false);
+  BOOST_CHECK(s.refresh());
+  BOOST_CHECK(!s.refresh());
+  BOOST_CHECK_EQUAL(*s, false);
+
+  // Changing an unrelated setting should not be reported as a change to this one.
+  settings->add_value("Bar", "1");
+  BOOST_CHECK(!s.refresh());
+
+  // Reloading this setting should be reported as a change, and should be picked up by the handle.
+  settings->set_values("Foo", std::vector<std::string>(1, "true"));
+  BOOST_CHECK(s.refresh());
+  BOOST_CHECK_EQUAL(*s, true);
+
+  settings->set_values("Foo", std::vector<std::string>(1, "false"));
+  BOOST_CHECK_EQUAL(*s, false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,177 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+
+#include <tvgutil/misc/TaskGroup.h>
+using namespace tvgutil;
+
+//#################### HELPER FUNCTIONS ####################
+
+int add(int a, int b)
+{
+  return a + b;
+}
+
+void block_until(boost::atomic<bool> *started, const boost::atomic<bool> *released)
+{
+  *started = true;
+  while(!*released) boost::this_thread::yield();
+}
+
+void fail()
+{
+  throw std::runtime_error("Failed");
+}
+
+int fail_int()
+{
+  throw std::runtime_error("Failed");
+}
+
+void increment(boost::atomic<int> *counter)
+{
+  ++*counter;
+}
+
+void record(boost::mutex *mutex, std::vector<int> *order, int value)
+{
+  boost::lock_guard<boost::mutex> lock(*mutex);
+  order->push_back(value);
+}
+
+void run_nested_group(TaskScheduler *scheduler, boost::atomic<int> *counter)
+{
+  TaskGroup group(*scheduler);
+  for(int i = 0; i < 10; ++i)
+  {
+    group.run(boost::bind(&increment, counter));
+  }
+  group.wait();
+}
+
+int square_result(const TaskFuture<int>& antecedent)
+{
+  int x = antecedent.get();
+  return x * x;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_TaskScheduler)
+
+BOOST_AUTO_TEST_CASE(bounded_test)
+{
+  // Block the only worker, so that the tasks we post stay pending.
+  TaskScheduler scheduler(1, 2);
+  boost::atomic<bool> started(false), released(false);
+  scheduler.post(boost::bind(&block_until, &started, &released));
+  while(!started) boost::this_thread::yield();
+
+  // Fill the queue, and check that further submissions are refused.
+  boost::atomic<int> counter(0);
+  BOOST_CHECK(scheduler.try_post(boost::bind(&increment, &counter)));
+  BOOST_CHECK(scheduler.try_post(boost::bind(&increment, &counter)));
+  BOOST_CHECK(!scheduler.try_post(boost::bind(&increment, &counter)));
+
+  // Release the worker, and check that a blocking submission then succeeds.
+  released = true;
+  TaskGroup group(scheduler);
+  group.run(boost::bind(&increment, &counter));
+  group.wait();
+  BOOST_CHECK_GE(counter.load(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(continuation_test)
+{
+  TaskScheduler scheduler(4);
+  TaskFuture<int> f = scheduler.submit(boost::bind(&add, 2, 3));
+  TaskFuture<int> g = f.then(&square_result);
+  BOOST_CHECK_EQUAL(g.get(), 25);
+  BOOST_CHECK(f.is_ready());
+
+  // A failed task should rethrow its exception when get() is called.
+  TaskFuture<void> h = scheduler.submit(&fail);
+  BOOST_CHECK_THROW(h.get(), std::runtime_error);
+  BOOST_CHECK_EQUAL(scheduler.submit(boost::bind(&add, 1, 1)).then(&square_result).then(&square_result).get(), 16);
+
+  // A continuation of a failed task should be run, and should see the failure when it calls get() on its antecedent.
+  TaskFuture<int> k = scheduler.submit(boost::bind(&add, 1, 1)).then(boost::bind(&fail_int)).then(&square_result);
+  BOOST_CHECK_THROW(k.get(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(priority_test)
+{
+  // Block the only worker whilst tasks of different priorities are submitted, then check that they are run in priority order.
+  TaskScheduler scheduler(1);
+  boost::atomic<bool> started(false), released(false);
+  boost::mutex mutex;
+  std::vector<int> order;
+
+  TaskGroup group(scheduler);
+  group.run(boost::bind(&block_until, &started, &released));
+  while(!started) boost::this_thread::yield();
+  group.run(boost::bind(&record, &mutex, &order, TP_LOW), TP_LOW);
+  group.run(boost::bind(&record, &mutex, &order, TP_NORMAL), TP_NORMAL);
+  group.run(boost::bind(&record, &mutex, &order, TP_HIGH), TP_HIGH);
+  released = true;
+  group.wait();
+
+  BOOST_REQUIRE_EQUAL(order.size(), 3);
+  BOOST_CHECK_EQUAL(order[0], TP_HIGH);
+  BOOST_CHECK_EQUAL(order[1], TP_NORMAL);
+  BOOST_CHECK_EQUAL(order[2], TP_LOW);
+}
+
+BOOST_AUTO_TEST_CASE(task_group_test)
+{
+  TaskScheduler scheduler(4);
+  boost::atomic<int> counter(0);
+
+  // Run groups nested within the tasks of another group: waiting for the inner groups must not deadlock the workers.
+  {
+    TaskGroup group(scheduler);
+    for(int i = 0; i < 100; ++i)
+    {
+      group.run(boost::bind(&run_nested_group, &scheduler, &counter));
+    }
+    group.wait();
+  }
+  BOOST_CHECK_EQUAL(counter.load(), 1000);
+
+  // Check that an exception thrown by a task in a group is propagated by wait().
+  TaskGroup group(scheduler);
+  group.run(&fail);
+  group.run(boost::bind(&increment, &counter));
+  BOOST_CHECK_THROW(group.wait(), std::runtime_error);
+  BOOST_CHECK_EQUAL(counter.load(), 1001);
+}
+
+BOOST_AUTO_TEST_CASE(task_group_wait_test)
+{
+  // Block the only worker, and then post an unrelated task followed by a task in a group.
+  TaskScheduler scheduler(1);
+  boost::atomic<bool> started(false), released(false);
+  scheduler.post(boost::bind(&block_until, &started, &released));
+  while(!started) boost::this_thread::yield();
+
+  boost::atomic<int> unrelatedCounter(0), groupCounter(0);
+  scheduler.post(boost::bind(&increment, &unrelatedCounter));
+
+  // Waiting for the group should run the group's task on this thread, but must not run the unrelated task.
+  TaskGroup group(scheduler);
+  group.run(boost::bind(&increment, &groupCounter));
+  group.wait();
+  BOOST_CHECK_EQUAL(groupCounter.load(), 1);
+  BOOST_CHECK_EQUAL(unrelatedCounter.load(), 0);
+
+  // Once the worker is released, it should run the unrelated task (and skip the group's task, which has already been run).
+  released = true;
+  while(unrelatedCounter.load() == 0) boost::this_thread::yield();
+  BOOST_CHECK_EQUAL(groupCounter.load(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()